@@ -16,6 +16,8 @@ this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "LibBoolEE.h"
 
+#include <mutex>
+
 std::vector<std::string> LibBoolEE::singleParse(const std::string & formula, const char op, ErrorReport* errorReport) {
     int start_pos = -1;
     int parity_count = 0;
@@ -68,10 +70,40 @@ std::vector<std::string> LibBoolEE::singleParse(const std::string & formula, con
 }
 
 bool LibBoolEE::resolve(const std::string &source, const Vals & valuation, ErrorReport* errorReport) {
-    return resolveRec(removeWhitespaces(source), valuation, errorReport);
+    return compile(source, errorReport)->eval(valuation, errorReport);
 }
 
-bool LibBoolEE::resolveRec(const std::string &source, const Vals & valuation, ErrorReport* errorReport) {
+std::shared_ptr<const LibBoolEE::Compiled> LibBoolEE::compile(const std::string &source, ErrorReport* errorReport) {
+    const std::string formula = removeWhitespaces(source);
+
+    // Parsing dominates evaluation, so compiled formulas are kept keyed by
+    // their source text; repeated evaluations of the same verifier (once per
+    // restricted transfer per block) reuse the node arena. Only formulas
+    // that compiled are cached---failures re-parse and re-throw every time.
+    static std::mutex cacheMutex;
+    static std::map<std::string, std::shared_ptr<const Compiled> > cache;
+    static const size_t MAX_CACHE_SIZE = 1000;
+
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        std::map<std::string, std::shared_ptr<const Compiled> >::const_iterator it = cache.find(formula);
+        if (it != cache.end()) {
+            return it->second;
+        }
+    }
+
+    std::shared_ptr<Compiled> compiled(new Compiled());
+    compiled->root = compileRec(formula, compiled->nodes, errorReport);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (cache.size() >= MAX_CACHE_SIZE) {
+        cache.clear();
+    }
+    cache[formula] = compiled;
+    return compiled;
+}
+
+int LibBoolEE::compileRec(const std::string &source, std::vector<Node> & nodes, ErrorReport* errorReport) {
     if (source.empty()) {
         if (errorReport) {
             errorReport->type = ErrorReport::ErrorType::EmptySubExpression;
@@ -81,7 +113,6 @@ bool LibBoolEE::resolveRec(const std::string &source, const Vals & valuation, Er
         throw std::runtime_error("An empty subexpression was encountered");
     }
 
-    std::string formula = source;
     char current_op = '|';
     // Try to divide by |
     std::vector<std::string> subexpressions = singleParse(source, current_op, errorReport);
@@ -104,44 +135,78 @@ bool LibBoolEE::resolveRec(const std::string &source, const Vals & valuation, Er
     // No binary top level operator found
     else if (subexpressions.size() == 1) {
         if (source[0] == '!') {
-            return !resolve(source.substr(1), valuation, errorReport);
+            const int child = compileRec(source.substr(1), nodes, errorReport);
+            nodes.push_back(Node('!'));
+            nodes.back().children.push_back(child);
         }
         else if (source[0] == '(') {
-            return resolve(source.substr(1, source.size() - 2), valuation, errorReport);
+            return compileRec(source.substr(1, source.size() - 2), nodes, errorReport);
         }
         else if (source == "1") {
-            return true;
+            nodes.push_back(Node('1'));
         }
         else if (source == "0") {
-            return false;
+            nodes.push_back(Node('0'));
         }
-        else if (valuation.count(source) == 0) {
+        else {
+            // Whether the variable is known depends on the valuation, so the
+            // lookup (and its error) is deferred to evaluation time
+            nodes.push_back(Node('v'));
+            nodes.back().name = source;
+        }
+        return static_cast<int>(nodes.size()) - 1;
+    }
+    else {
+        std::vector<int> children;
+        children.reserve(subexpressions.size());
+        for (std::vector<std::string>::iterator it = subexpressions.begin(); it != subexpressions.end(); it++) {
+            children.push_back(compileRec(*it, nodes, errorReport));
+        }
+        nodes.push_back(Node(current_op));
+        nodes.back().children = children;
+        return static_cast<int>(nodes.size()) - 1;
+    }
+}
+
+bool LibBoolEE::Compiled::eval(const Vals & valuation, ErrorReport* errorReport) const {
+    return evalNode(root, valuation, errorReport);
+}
+
+bool LibBoolEE::Compiled::evalNode(const int index, const Vals & valuation, ErrorReport* errorReport) const {
+    const Node & node = nodes[index];
+    switch (node.op) {
+    case '1':
+        return true;
+    case '0':
+        return false;
+    case '!':
+        return !evalNode(node.children[0], valuation, errorReport);
+    case 'v':
+        if (valuation.count(node.name) == 0) {
             if (errorReport) {
                 errorReport->type = ErrorReport::ErrorType::VariableNotFound;
-                errorReport->vecUserData.emplace_back(source);
+                errorReport->vecUserData.emplace_back(node.name);
                 errorReport->strDevData = "bad-txns-null-verifier-variable-not-found";
             }
-            throw std::runtime_error("Variable '" + source + "' not found in the interpretation.");
+            throw std::runtime_error("Variable '" + node.name + "' not found in the interpretation.");
         }
-        else {
-            return valuation.at(source);
+        return valuation.at(node.name);
+    case '|': {
+        // Deliberately no short-circuit: an unknown variable in any operand
+        // must throw, exactly as the interpreting evaluator did
+        bool result = false;
+        for (std::vector<int>::const_iterator it = node.children.begin(); it != node.children.end(); it++) {
+            result |= evalNode(*it, valuation, errorReport);
         }
+        return result;
     }
-    else {
-        if (current_op == '|') {
-            bool result = false;
-            for (std::vector<std::string>::iterator it = subexpressions.begin(); it != subexpressions.end(); it++) {
-                result |= resolve(*it, valuation, errorReport);
-            }
-            return result;
-        }
-        else { // The operator was set to &
-            bool result = true;
-            for (std::vector<std::string>::iterator it = subexpressions.begin(); it != subexpressions.end(); it++) {
-                result &= resolve(*it, valuation, errorReport);
-            }
-            return result;
+    default: { // The operator was set to &
+        bool result = true;
+        for (std::vector<int>::const_iterator it = node.children.begin(); it != node.children.end(); it++) {
+            result &= evalNode(*it, valuation, errorReport);
         }
+        return result;
+    }
     }
 }
 
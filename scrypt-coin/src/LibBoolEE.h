@@ -32,6 +32,7 @@ this program.  If not, see <http://www.gnu.org/licenses/>.
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <utility>
@@ -64,6 +65,31 @@ public:
     typedef std::map<std::string, bool> Vals; ///< Valuation of atomic propositions
     typedef std::pair<std::string, bool> Val; ///< A single proposition valuation
 
+    /// A single operator or operand of a compiled formula.
+    struct Node {
+        char op;                   ///< '|', '&', '!', 'v' for a variable, or the literal '1'/'0'
+        std::string name;          ///< variable name, set when op == 'v'
+        std::vector<int> children; ///< indices into the owning arena
+
+        explicit Node(const char op) : op(op) {}
+    };
+
+    /// A formula parsed once into an arena of nodes; evaluation walks the
+    /// nodes and never looks at the source text again.
+    struct Compiled {
+        std::vector<Node> nodes; ///< arena; the root is the last node compiled
+        int root;
+
+        // @return	true iff the formula is true under the valuation
+        bool eval(const Vals & valuation, ErrorReport* errorReport = nullptr) const;
+
+    private:
+        bool evalNode(const int index, const Vals & valuation, ErrorReport* errorReport) const;
+    };
+
+    // @return	the compiled form of the formula, parsed on first sight and cached by source text afterwards
+    static std::shared_ptr<const Compiled> compile(const std::string & source, ErrorReport* errorReport = nullptr);
+
     // @return	true iff the formula is true under the valuation (where the valuation are pairs (variable,value))
     static bool resolve(const std::string & source, const Vals & valuation,  ErrorReport* errorReport = nullptr);
 
@@ -79,8 +105,8 @@ private:
     // @return	true iff ch is possibly part of a valid name
     static bool belongsToName(const char ch);
 
-    // @return	true iff the formula is true under the valuation (where the valuation are pairs (variable,value))---used internally
-    static bool resolveRec(const std::string & source, const Vals & valuation, ErrorReport* errorReport = nullptr);
+    // @return	the arena index of the node the (sub)expression compiled to---used internally
+    static int compileRec(const std::string & source, std::vector<Node> & nodes, ErrorReport* errorReport = nullptr);
 
 
     // @return	new string made from the source by removing the leading and trailing white spaces
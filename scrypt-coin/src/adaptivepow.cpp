@@ -5,10 +5,30 @@
 #include "adaptivepow.h"
 #include "hash.h"
 #include "util.h"
+#include "sync.h"
 #include "chainparams.h"
+#include "net_processing.h"
 
+#include <array>
 #include <cstring>
 #include <algorithm>
+#include <atomic>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+#if defined(__x86_64__) || defined(__amd64__)
+#if defined(ENABLE_AVX2)
+#include <cpuid.h>
+namespace adaptivepow_avx2 {
+void CalcDAGItem(uint32_t index, uint32_t* out, const uint32_t* cache, uint64_t cacheItems);
+}
+#endif
+#endif
 
 // Platform-specific intrinsics for bit operations
 #ifdef _MSC_VER
@@ -123,12 +143,140 @@ static uint32_t random_math_op(uint32_t a, uint32_t b, uint32_t op) {
     }
 }
 
+// ==================== Persistent DAG cache ====================
+
+// DAG cache files live in <datadir>/powdag/, one per epoch, so each epoch's
+// dataset is generated at most once per node. Generation streams items
+// straight into a temp file that is renamed into place; readers map the
+// finished file read-only and let the page cache back the random lookups.
+static const uint32_t DAG_FILE_MAGIC = 0x31474144; // "DAG1"
+static const size_t DAG_FILE_HEADER_SIZE = 4 + 4 + 8; // magic, epoch, size
+
+static fs::path GetDAGFilePath(uint32_t epoch) {
+    return GetDataDir() / "powdag" / strprintf("dag-%u.dat", epoch);
+}
+
+// Serializes write-and-rename so the foreground Generate() and the
+// background pre-generation thread never produce the same file at once
+static CCriticalSection cs_dagFile;
+
 // ==================== AdaptivePowDAG Implementation ====================
 
 AdaptivePowDAG::AdaptivePowDAG()
-    : m_epoch(0), m_size(0), m_cacheSize(0), m_valid(false) {}
+    : m_epoch(0), m_size(0), m_cacheSize(0),
+      m_dagData(nullptr), m_mapBase(nullptr), m_mapLen(0), m_valid(false) {}
+
+AdaptivePowDAG::~AdaptivePowDAG() {
+    ReleaseDAG();
+}
+
+void AdaptivePowDAG::ReleaseDAG() {
+#ifndef WIN32
+    if (m_mapBase) {
+        munmap(m_mapBase, m_mapLen);
+        m_mapBase = nullptr;
+        m_mapLen = 0;
+    }
+#endif
+    std::vector<uint32_t>().swap(m_dag);
+    m_dagData = nullptr;
+}
+
+bool AdaptivePowDAG::WriteDAGFile() const {
+    fs::path path = GetDAGFilePath(m_epoch);
+    fs::path pathTmp = fs::path(path.string() + ".tmp");
+    TryCreateDirectories(path.parent_path());
+
+    FILE* file = fsbridge::fopen(pathTmp, "wb");
+    if (!file)
+        return error("AdaptivePow: cannot open %s for writing", pathTmp.string());
+
+    uint64_t dagItems = m_size / ADAPTIVEPOW_HASH_BYTES;
+    if (fwrite(&DAG_FILE_MAGIC, 4, 1, file) != 1 ||
+        fwrite(&m_epoch, 4, 1, file) != 1 ||
+        fwrite(&m_size, 8, 1, file) != 1) {
+        fclose(file);
+        fs::remove(pathTmp);
+        return error("AdaptivePow: failed to write header to %s", pathTmp.string());
+    }
+    // Generate a chunk of items in parallel, then write it out sequentially
+    static const uint64_t DAG_WRITE_CHUNK_ITEMS = 1 << 18; // 16 MiB per batch
+    uint64_t chunkItems = std::min(dagItems, DAG_WRITE_CHUNK_ITEMS);
+    std::vector<uint32_t> chunk(chunkItems * 16);
+    for (uint64_t i = 0; i < dagItems; i += chunkItems) {
+        uint64_t n = std::min(chunkItems, dagItems - i);
+        GenerateItemsParallel(i, n, &chunk[0]);
+        if (fwrite(&chunk[0], ADAPTIVEPOW_HASH_BYTES, n, file) != n) {
+            fclose(file);
+            fs::remove(pathTmp);
+            return error("AdaptivePow: failed to write DAG items to %s", pathTmp.string());
+        }
+        LogPrintf("AdaptivePow: DAG file generation %.1f%% complete\n",
+                  (float)(i + n) / dagItems * 100);
+    }
+    FileCommit(file);
+    fclose(file);
+    if (!RenameOver(pathTmp, path))
+        return error("AdaptivePow: failed to rename %s into place", pathTmp.string());
+    return true;
+}
 
-AdaptivePowDAG::~AdaptivePowDAG() {}
+bool AdaptivePowDAG::LoadDAGFile() {
+    fs::path path = GetDAGFilePath(m_epoch);
+    FILE* file = fsbridge::fopen(path, "rb");
+    if (!file)
+        return false;
+
+    uint32_t magic = 0, epoch = 0;
+    uint64_t size = 0;
+    if (fread(&magic, 4, 1, file) != 1 ||
+        fread(&epoch, 4, 1, file) != 1 ||
+        fread(&size, 8, 1, file) != 1 ||
+        magic != DAG_FILE_MAGIC || epoch != m_epoch || size != m_size) {
+        fclose(file);
+        return error("AdaptivePow: DAG file %s is stale or corrupt, ignoring it", path.string());
+    }
+
+#ifndef WIN32
+    m_mapLen = DAG_FILE_HEADER_SIZE + m_size;
+    void* base = mmap(nullptr, m_mapLen, PROT_READ, MAP_SHARED, fileno(file), 0);
+    fclose(file); // the mapping keeps its own reference to the file
+    if (base == MAP_FAILED) {
+        m_mapLen = 0;
+        return error("AdaptivePow: mmap of %s failed", path.string());
+    }
+    m_mapBase = base;
+    m_dagData = (const uint32_t*)((const unsigned char*)base + DAG_FILE_HEADER_SIZE);
+#else
+    // No mmap on Windows builds; read the dataset into memory instead
+    m_dag.resize(m_size / sizeof(uint32_t));
+    if (fread(&m_dag[0], 1, m_size, file) != m_size) {
+        fclose(file);
+        std::vector<uint32_t>().swap(m_dag);
+        return error("AdaptivePow: short read from %s", path.string());
+    }
+    fclose(file);
+    m_dagData = &m_dag[0];
+#endif
+    LogPrintf("AdaptivePow: loaded DAG for epoch %u from %s\n", m_epoch, path.string());
+    return true;
+}
+
+bool AdaptivePowDAG::PreGenerateFile(uint32_t epoch, const Consensus::Params& params) {
+    {
+        FILE* file = fsbridge::fopen(GetDAGFilePath(epoch), "rb");
+        if (file) {
+            fclose(file);
+            return true; // already on disk
+        }
+    }
+    AdaptivePowDAG dag;
+    dag.m_epoch = epoch;
+    dag.m_size = GetAdaptivePowDAGSize(epoch, params);
+    dag.GenerateCache(GetSeedHash(epoch), GetAdaptivePowCacheSize(epoch, params));
+    LOCK(cs_dagFile);
+    return dag.WriteDAGFile();
+}
 
 uint256 AdaptivePowDAG::GetSeedHash(uint32_t epoch) {
     uint256 seed;
@@ -186,18 +334,18 @@ void AdaptivePowDAG::GenerateCache(const uint256& seed, uint64_t cacheSize) {
     m_cacheSize = cacheSize;
 }
 
-void AdaptivePowDAG::CalcDAGItem(uint32_t index, uint32_t* out) const {
-    uint64_t cacheItems = m_cacheSize / ADAPTIVEPOW_HASH_BYTES;
-
+// Scalar DAG item mixing; AdaptivePowAutoDetect() may replace the dispatch
+// pointer below with the AVX2 version
+static void CalcDAGItemGeneric(uint32_t index, uint32_t* out, const uint32_t* cache, uint64_t cacheItems) {
     // Initialize from cache
     uint32_t cacheIndex = index % cacheItems;
-    memcpy(out, &m_cache[cacheIndex * 16], 64);
+    memcpy(out, &cache[(uint64_t)cacheIndex * 16], 64);
     out[0] ^= index;
 
     // Mix with parent cache items
     for (uint32_t round = 0; round < ADAPTIVEPOW_DAG_PARENTS; round++) {
         uint32_t parent = fnv1a(index ^ round, out[0]) % cacheItems;
-        const uint32_t* parentData = &m_cache[parent * 16];
+        const uint32_t* parentData = &cache[(uint64_t)parent * 16];
 
         for (int i = 0; i < 16; i++) {
             out[i] = fnv1a(out[i], parentData[i]);
@@ -205,31 +353,118 @@ void AdaptivePowDAG::CalcDAGItem(uint32_t index, uint32_t* out) const {
     }
 }
 
-bool AdaptivePowDAG::Generate(uint32_t epoch, const Consensus::Params& params) {
-    LogPrintf("AdaptivePow: Generating DAG for epoch %u...\n", epoch);
+typedef void (*CalcDAGItemType)(uint32_t index, uint32_t* out, const uint32_t* cache, uint64_t cacheItems);
+static CalcDAGItemType CalcDAGItemImpl = CalcDAGItemGeneric;
+
+#if (defined(__x86_64__) || defined(__amd64__)) && defined(ENABLE_AVX2)
+/** Check whether the OS has enabled AVX registers (XCR0 bits 1 and 2). */
+static bool AVXEnabled() {
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+
+// Verify a candidate implementation against the scalar one on a small
+// synthetic cache before dispatching to it
+static bool SelfTestCalcDAGItem(CalcDAGItemType tr) {
+    uint32_t cache[8 * 16];
+    for (int i = 0; i < 8 * 16; i++)
+        cache[i] = fnv1a(FNV_OFFSET, (uint32_t)i);
+    uint32_t expect[16], got[16];
+    for (uint32_t index = 0; index < 16; index++) {
+        CalcDAGItemGeneric(index, expect, cache, 8);
+        tr(index, got, cache, 8);
+        if (memcmp(expect, got, 64) != 0)
+            return false;
+    }
+    return true;
+}
+#endif
+
+std::string AdaptivePowAutoDetect() {
+    std::string ret = "standard";
+#if (defined(__x86_64__) || defined(__amd64__)) && defined(ENABLE_AVX2)
+    uint32_t eax, ebx, ecx, edx;
+    uint32_t eax7 = 0, ebx7 = 0, ecx7 = 0, edx7 = 0;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        __cpuid_count(7, 0, eax7, ebx7, ecx7, edx7);
+        // AVX2 in the CPU is not enough: the OS must save the ymm registers too.
+        if (((ebx7 >> 5) & 1) && ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && AVXEnabled()) {
+            assert(SelfTestCalcDAGItem(adaptivepow_avx2::CalcDAGItem));
+            CalcDAGItemImpl = adaptivepow_avx2::CalcDAGItem;
+            ret = "avx2";
+        }
+    }
+#endif
+    return ret;
+}
+
+void AdaptivePowDAG::CalcDAGItem(uint32_t index, uint32_t* out) const {
+    CalcDAGItemImpl(index, out, &m_cache[0], m_cacheSize / ADAPTIVEPOW_HASH_BYTES);
+}
+
+void AdaptivePowDAG::CalcDAGRange(uint64_t nFirst, uint64_t nCount, uint32_t* out) const {
+    for (uint64_t i = 0; i < nCount; i++)
+        CalcDAGItem(nFirst + i, out + i * 16);
+}
 
+void AdaptivePowDAG::GenerateItemsParallel(uint64_t nFirst, uint64_t nCount, uint32_t* out) const {
+    size_t nThreads = (size_t)std::min<uint64_t>(nCount, (uint64_t)std::max(1, nHashCalcThreads));
+    if (nThreads <= 1) {
+        CalcDAGRange(nFirst, nCount, out);
+        return;
+    }
+
+    // Items are independent, so split the range into one contiguous chunk
+    // per worker; same thread budget as scrypt_hash_batch()
+    uint64_t nPerThread = nCount / nThreads;
+    boost::thread_group workers;
+    for (size_t i = 1; i < nThreads; i++) {
+        uint64_t nBegin = i * nPerThread;
+        uint64_t nChunk = (i == nThreads - 1) ? nCount - nBegin : nPerThread;
+        workers.create_thread(
+            boost::bind(&AdaptivePowDAG::CalcDAGRange, this, nFirst + nBegin, nChunk, out + nBegin * 16));
+    }
+    CalcDAGRange(nFirst, nPerThread, out);
+    workers.join_all();
+}
+
+bool AdaptivePowDAG::Generate(uint32_t epoch, const Consensus::Params& params) {
+    ReleaseDAG();
+    m_valid = false;
     m_epoch = epoch;
     m_size = GetAdaptivePowDAGSize(epoch, params);
     uint64_t cacheSize = GetAdaptivePowCacheSize(epoch, params);
 
-    LogPrintf("AdaptivePow: DAG size: %.2f GB, Cache size: %.2f MB\n",
-              m_size / 1e9, cacheSize / 1e6);
-
-    // Generate seed and cache
+    // The cache is always built in memory: it seeds DAG generation and backs
+    // GetItem() for indexes past the dataset
     uint256 seed = GetSeedHash(epoch);
     GenerateCache(seed, cacheSize);
 
-    // Generate full DAG
-    uint64_t dagItems = m_size / ADAPTIVEPOW_HASH_BYTES;
-    m_dag.resize(dagItems * 16);
+    // Fast path: an earlier run (or the pre-generation thread) already wrote
+    // this epoch's DAG file, so just map it
+    if (LoadDAGFile()) {
+        m_valid = true;
+        return true;
+    }
 
-    for (uint64_t i = 0; i < dagItems; i++) {
-        CalcDAGItem(i, &m_dag[i * 16]);
+    LogPrintf("AdaptivePow: Generating DAG for epoch %u...\n", epoch);
+    LogPrintf("AdaptivePow: DAG size: %.2f GB, Cache size: %.2f MB\n",
+              m_size / 1e9, cacheSize / 1e6);
 
-        if (i % 1000000 == 0) {
-            LogPrintf("AdaptivePow: DAG generation %.1f%% complete\n",
-                      (float)i / dagItems * 100);
-        }
+    {
+        LOCK(cs_dagFile);
+        // The pre-generation thread may have finished the file while we
+        // waited for the lock; otherwise generate straight into it
+        if (!LoadDAGFile() && WriteDAGFile())
+            LoadDAGFile();
+    }
+    if (!m_dagData) {
+        // File cache unusable (e.g. datadir full); keep the dataset in memory
+        uint64_t dagItems = m_size / ADAPTIVEPOW_HASH_BYTES;
+        m_dag.resize(dagItems * 16);
+        GenerateItemsParallel(0, dagItems, &m_dag[0]);
+        m_dagData = &m_dag[0];
     }
 
     m_valid = true;
@@ -238,14 +473,20 @@ bool AdaptivePowDAG::Generate(uint32_t epoch, const Consensus::Params& params) {
 }
 
 void AdaptivePowDAG::GetItem(uint32_t index, uint32_t* out) const {
-    if (m_valid && index * 16 < m_dag.size()) {
-        memcpy(out, &m_dag[index * 16], 64);
+    if (m_valid && m_dagData && (uint64_t)index * ADAPTIVEPOW_HASH_BYTES < m_size) {
+        memcpy(out, m_dagData + (uint64_t)index * 16, 64);
     } else {
         // Fallback to cache-based calculation
         CalcDAGItem(index, out);
     }
 }
 
+const uint32_t* AdaptivePowDAG::GetItemPtr(uint32_t index) const {
+    if (m_valid && m_dagData && (uint64_t)index * ADAPTIVEPOW_HASH_BYTES < m_size)
+        return m_dagData + (uint64_t)index * 16;
+    return nullptr;
+}
+
 // ==================== Hash Functions ====================
 
 AdaptivePowResult AdaptivePowHash(
@@ -338,6 +579,98 @@ AdaptivePowResult AdaptivePowHash(
     return result;
 }
 
+void AdaptivePowHashBatch(
+    const std::vector<std::pair<uint256, uint64_t> >& vWork,
+    std::vector<AdaptivePowResult>& vResults,
+    const AdaptivePowDAG* dag,
+    const Consensus::Params& params
+) {
+    const size_t nLanes = vWork.size();
+    vResults.resize(nLanes);
+
+    // Without a resident dataset there is no memory latency to overlap;
+    // just take the scalar path per solution.
+    if (!dag || !dag->GetItemPtr(0)) {
+        for (size_t i = 0; i < nLanes; i++)
+            vResults[i] = AdaptivePowHash(vWork[i].first, vWork[i].second, dag, params);
+        return;
+    }
+
+    uint32_t dagItems = dag->GetSize() / ADAPTIVEPOW_HASH_BYTES;
+
+    // Per-lane state, seeded exactly as in AdaptivePowHash
+    std::vector<std::array<uint32_t, 64> > vMix(nLanes);
+    std::vector<Kiss99> vRng;
+    vRng.reserve(nLanes);
+    std::vector<uint32_t> vDagIdx(nLanes);
+
+    for (size_t i = 0; i < nLanes; i++) {
+        uint32_t state[25];
+        memcpy(state, vWork[i].first.begin(), 32);
+        state[8] = (uint32_t)(vWork[i].second);
+        state[9] = (uint32_t)(vWork[i].second >> 32);
+        for (int j = 10; j < 25; j++) state[j] = 0;
+        keccak_f800(state);
+        for (int j = 0; j < 64; j++) vMix[i][j] = state[j % 25];
+        vRng.emplace_back(
+            fnv1a(FNV_OFFSET, state[0]),
+            fnv1a(state[0], state[1]),
+            fnv1a(state[1], state[2]),
+            fnv1a(state[2], state[3])
+        );
+    }
+
+    uint32_t dagData[16];
+    for (uint32_t round = 0; round < ADAPTIVEPOW_DAG_LOADS; round++) {
+        // First pass: every lane's index for this round, each item touched
+        // with a prefetch so the reads overlap in the memory system
+        for (size_t i = 0; i < nLanes; i++) {
+            const uint32_t* mix = vMix[i].data();
+            uint32_t dagIdx = fnv1a(round ^ mix[round % 64], mix[(round + 1) % 64]);
+            dagIdx %= dagItems;
+            vDagIdx[i] = dagIdx;
+            const uint32_t* p = dag->GetItemPtr(dagIdx);
+            if (p) {
+                __builtin_prefetch(p);
+                __builtin_prefetch(p + 15); // items may straddle two lines
+            }
+        }
+
+        // Second pass: by now the items are on their way in; finish the
+        // round's FNV mix and random math for each lane
+        for (size_t i = 0; i < nLanes; i++) {
+            uint32_t* mix = vMix[i].data();
+            dag->GetItem(vDagIdx[i], dagData);
+            for (int j = 0; j < 16; j++)
+                mix[j] = fnv1a(mix[j], dagData[j]);
+            for (uint32_t op = 0; op < ADAPTIVEPOW_MATH_OPS; op++) {
+                uint32_t src1 = vRng[i].next() % 64;
+                uint32_t src2 = vRng[i].next() % 64;
+                uint32_t dst = vRng[i].next() % 64;
+                uint32_t opType = vRng[i].next();
+                mix[dst] = random_math_op(mix[src1], mix[src2], opType);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < nLanes; i++) {
+        const uint32_t* mix = vMix[i].data();
+        uint32_t compressed[8];
+        for (int j = 0; j < 8; j++) {
+            compressed[j] = mix[j * 8];
+            for (int k = 1; k < 8; k++)
+                compressed[j] = fnv1a(compressed[j], mix[j * 8 + k]);
+        }
+        memcpy(vResults[i].hashMix.begin(), compressed, 32);
+
+        uint32_t state[25];
+        memcpy(state, compressed, 32);
+        for (int j = 8; j < 25; j++) state[j] = 0;
+        keccak_f800(state);
+        memcpy(vResults[i].hashFinal.begin(), state, 32);
+    }
+}
+
 uint256 AdaptivePowLightVerify(
     const uint256& headerHash,
     uint64_t nonce,
@@ -402,11 +735,39 @@ uint64_t GetAdaptivePowCacheSize(uint32_t epoch, const Consensus::Params& params
     return GetAdaptivePowDAGSize(epoch, params) / 64;
 }
 
+// Only one pre-generation thread at a time; the flag is released by the
+// thread itself once the file is on disk
+static std::atomic<bool> fDagPreGenRunning(false);
+
+static void ThreadDAGPreGeneration(uint32_t epoch, const Consensus::Params* pparams) {
+    RenameThread("scrypt-dagpregen");
+    LogPrintf("AdaptivePow: pre-generating DAG file for epoch %u\n", epoch);
+    AdaptivePowDAG::PreGenerateFile(epoch, *pparams);
+    fDagPreGenRunning.store(false);
+}
+
+void StartAdaptivePowDAGPreGeneration(uint32_t epoch, const Consensus::Params& params) {
+    bool fExpected = false;
+    if (!fDagPreGenRunning.compare_exchange_strong(fExpected, true))
+        return; // a pre-generation is already in flight
+
+    // The Consensus::Params live in the global CChainParams, which outlives
+    // every thread, so passing a pointer is safe
+    boost::thread worker(&ThreadDAGPreGeneration, epoch, &params);
+    worker.detach();
+}
+
 bool InitAdaptivePowDAG(uint32_t epoch, const Consensus::Params& params) {
     if (g_adaptivePowDAG && g_adaptivePowDAG->IsValid(epoch)) {
         return true; // Already initialized for this epoch
     }
 
     g_adaptivePowDAG.reset(new AdaptivePowDAG());
-    return g_adaptivePowDAG->Generate(epoch, params);
+    if (!g_adaptivePowDAG->Generate(epoch, params))
+        return false;
+
+    // Warm the next epoch's file in the background so the transition only
+    // has to map it
+    StartAdaptivePowDAGPreGeneration(epoch + 1, params);
+    return true;
 }
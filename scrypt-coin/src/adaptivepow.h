@@ -10,6 +10,7 @@
 #include <vector>
 #include <cstdint>
 #include <memory>
+#include <utility>
 
 /**
  * AdaptivePow - Novel GPU Mining Algorithm
@@ -47,6 +48,10 @@ public:
     // Get DAG item at index
     void GetItem(uint32_t index, uint32_t* out) const;
 
+    // Address of a resident DAG item, for software prefetch; nullptr when
+    // the index would fall back to cache-based calculation
+    const uint32_t* GetItemPtr(uint32_t index) const;
+
     // Get current epoch
     uint32_t GetEpoch() const { return m_epoch; }
 
@@ -59,6 +64,10 @@ public:
     // Get seed hash for epoch
     static uint256 GetSeedHash(uint32_t epoch);
 
+    // Generate an epoch's DAG cache file without touching the global DAG;
+    // used by the background pre-generation thread. No-op if the file exists.
+    static bool PreGenerateFile(uint32_t epoch, const Consensus::Params& params);
+
 private:
     // Generate cache from seed
     void GenerateCache(const uint256& seed, uint64_t cacheSize);
@@ -66,11 +75,30 @@ private:
     // Generate single DAG item from cache
     void CalcDAGItem(uint32_t index, uint32_t* out) const;
 
+    // Generate items [nFirst, nFirst + nCount) into out
+    void CalcDAGRange(uint64_t nFirst, uint64_t nCount, uint32_t* out) const;
+
+    // CalcDAGRange split over the -hashcalcthreads workers; items are
+    // independent of each other, so the ranges need no coordination
+    void GenerateItemsParallel(uint64_t nFirst, uint64_t nCount, uint32_t* out) const;
+
+    // Stream the epoch's dataset into its cache file (temp file + rename)
+    bool WriteDAGFile() const;
+
+    // Map (mmap, or read on Windows) the epoch's cache file into m_dagData
+    bool LoadDAGFile();
+
+    // Drop the mapping / in-memory dataset
+    void ReleaseDAG();
+
     uint32_t m_epoch;
     uint64_t m_size;
     uint64_t m_cacheSize;
     std::vector<uint32_t> m_cache;
-    std::vector<uint32_t> m_dag;
+    std::vector<uint32_t> m_dag;    // in-memory dataset when no cache file is usable
+    const uint32_t* m_dagData;      // points into m_dag or the mapped file
+    void* m_mapBase;                // mmap()ed DAG cache file, if any
+    uint64_t m_mapLen;
     bool m_valid;
 };
 
@@ -111,6 +139,26 @@ AdaptivePowResult AdaptivePowHash(
  * @param params      Consensus parameters
  * @return            Final hash
  */
+//! Number of solutions AdaptivePowHashBatch advances in lockstep
+static const uint32_t ADAPTIVEPOW_BATCH_LANES = 16;
+
+/**
+ * Compute AdaptivePow for several (headerHash, nonce) pairs against one DAG.
+ *
+ * Each round's DAG index depends on the item read the round before, so one
+ * solution's dataset accesses cannot be precomputed or sorted. Instead the
+ * batch advances all lanes in lockstep: per round every lane's next item is
+ * prefetched before any lane's mix is completed, so the random reads of the
+ * whole batch are in flight together instead of costing one serialized
+ * cache miss per solution. Results are written in input order.
+ */
+void AdaptivePowHashBatch(
+    const std::vector<std::pair<uint256, uint64_t> >& vWork,
+    std::vector<AdaptivePowResult>& vResults,
+    const AdaptivePowDAG* dag,
+    const Consensus::Params& params
+);
+
 uint256 AdaptivePowLightVerify(
     const uint256& headerHash,
     uint64_t nonce,
@@ -175,4 +223,12 @@ extern std::unique_ptr<AdaptivePowDAG> g_adaptivePowDAG;
 // Initialize/update global DAG
 bool InitAdaptivePowDAG(uint32_t epoch, const Consensus::Params& params);
 
+// Kick off a background thread that writes the given epoch's DAG cache file
+// if it does not exist yet, so the next epoch transition only has to map it
+void StartAdaptivePowDAGPreGeneration(uint32_t epoch, const Consensus::Params& params);
+
+// Pick the best DAG item mixing implementation for the running CPU; returns
+// the name of the chosen implementation for logging
+std::string AdaptivePowAutoDetect();
+
 #endif // SCRYPT_ADAPTIVEPOW_H
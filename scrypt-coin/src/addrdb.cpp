@@ -34,8 +34,7 @@ bool SerializeDB(Stream& stream, const Data& data)
     return true;
 }
 
-template <typename Data>
-bool SerializeFileDB(const std::string& prefix, const fs::path& path, const Data& data)
+bool WriteFileDB(const std::string& prefix, const fs::path& path, const CDataStream& ssData)
 {
     // Generate random temporary filename
     unsigned short randv = 0;
@@ -49,8 +48,11 @@ bool SerializeFileDB(const std::string& prefix, const fs::path& path, const Data
     if (fileout.IsNull())
         return error("%s: Failed to open file %s", __func__, pathTmp.string());
 
-    // Serialize
-    if (!SerializeDB(fileout, data)) return false;
+    try {
+        fileout.write(ssData.data(), ssData.size());
+    } catch (const std::exception& e) {
+        return error("%s: I/O error - %s", __func__, e.what());
+    }
     FileCommit(fileout.Get());
     fileout.fclose();
 
@@ -61,6 +63,17 @@ bool SerializeFileDB(const std::string& prefix, const fs::path& path, const Data
     return true;
 }
 
+template <typename Data>
+bool SerializeFileDB(const std::string& prefix, const fs::path& path, const Data& data)
+{
+    // Serialize into memory first, then hand the bytes to the file writer;
+    // for CAddrMan this keeps its lock held only for the in-memory copy
+    // rather than across the file write and fsync.
+    CDataStream ssData(SER_DISK, CLIENT_VERSION);
+    if (!SerializeDB(ssData, data)) return false;
+    return WriteFileDB(prefix, path, ssData);
+}
+
 template <typename Stream, typename Data>
 bool DeserializeDB(Stream& stream, Data& data, bool fCheckSum = true)
 {
@@ -121,6 +134,21 @@ bool CBanDB::Read(banmap_t& banSet)
     return DeserializeFileDB(pathBanlist, banSet);
 }
 
+CPeerScoreDB::CPeerScoreDB()
+{
+    pathPeerScores = GetDataDir() / "peerscores.dat";
+}
+
+bool CPeerScoreDB::Write(const peerscoremap_t& scoreMap)
+{
+    return SerializeFileDB("peerscores", pathPeerScores, scoreMap);
+}
+
+bool CPeerScoreDB::Read(peerscoremap_t& scoreMap)
+{
+    return DeserializeFileDB(pathPeerScores, scoreMap);
+}
+
 CAddrDB::CAddrDB()
 {
     pathAddr = GetDataDir() / "peers.dat";
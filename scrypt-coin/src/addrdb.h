@@ -16,6 +16,7 @@
 class CSubNet;
 class CAddrMan;
 class CDataStream;
+class CNetAddr;
 
 typedef enum BanReason
 {
@@ -101,4 +102,73 @@ public:
     bool Read(banmap_t& banSet);
 };
 
+/** Persistent performance record for one peer address.
+ *
+ * Collected by net_processing as blocks and transactions come in, and
+ * consulted by CConnman when picking an inbound connection to evict or an
+ * outbound address to connect to, so a restart does not forget which peers
+ * historically served us well.
+ */
+class CPeerScore
+{
+public:
+    static const int CURRENT_VERSION=1;
+    int nVersion;
+    //! moving average of getdata-to-block delivery time in microseconds (0 = no sample yet)
+    int64_t nBlockLatencyUsec;
+    //! blocks this peer delivered in response to our requests
+    uint64_t nBlocksDelivered;
+    //! transactions from this peer that made it into our mempool
+    uint64_t nTxUseful;
+    //! transactions from this peer we processed in total
+    uint64_t nTxTotal;
+    //! block downloads from this peer that hit the stall timeout
+    uint64_t nStallCount;
+    //! last time any counter was updated (unix time, used for pruning)
+    int64_t nLastUpdate;
+
+    CPeerScore()
+    {
+        SetNull();
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(this->nVersion);
+        READWRITE(nBlockLatencyUsec);
+        READWRITE(nBlocksDelivered);
+        READWRITE(nTxUseful);
+        READWRITE(nTxTotal);
+        READWRITE(nStallCount);
+        READWRITE(nLastUpdate);
+    }
+
+    void SetNull()
+    {
+        nVersion = CPeerScore::CURRENT_VERSION;
+        nBlockLatencyUsec = 0;
+        nBlocksDelivered = 0;
+        nTxUseful = 0;
+        nTxTotal = 0;
+        nStallCount = 0;
+        nLastUpdate = 0;
+    }
+};
+
+typedef std::map<CNetAddr, CPeerScore> peerscoremap_t;
+
+/** Access to the peer performance database (peerscores.dat) */
+class CPeerScoreDB
+{
+private:
+    fs::path pathPeerScores;
+public:
+    CPeerScoreDB();
+    bool Write(const peerscoremap_t& scoreMap);
+    bool Read(peerscoremap_t& scoreMap);
+};
+
 #endif // YACOIN_ADDRDB_H
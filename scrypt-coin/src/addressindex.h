@@ -312,6 +312,82 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+/** Key of a materialized per-(address, token) balance rollup. Unlike the raw
+ * address index, which stores one delta per touched output, there is exactly
+ * one rollup record per (type, address, token), so balance queries are point
+ * reads instead of a walk over the address's whole history. */
+struct CAddressBalanceKey {
+    unsigned int type;
+    uint160 hashBytes;
+    std::string token;
+
+    size_t GetSerializeSize() const {
+        return 21 + token.size();
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        ::Serialize(s, token);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        ::Unserialize(s, token);
+    }
+
+    CAddressBalanceKey(unsigned int addressType, uint160 addressHash, std::string tokenName) {
+        type = addressType;
+        hashBytes = addressHash;
+        token = tokenName;
+    }
+
+    CAddressBalanceKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type = 0;
+        hashBytes.SetNull();
+        token.clear();
+    }
+
+    bool operator<(const CAddressBalanceKey& other) const {
+        if (type != other.type) return type < other.type;
+        if (hashBytes != other.hashBytes) return hashBytes < other.hashBytes;
+        return token < other.token;
+    }
+};
+
+struct CAddressBalanceValue {
+    CAmount balance;
+    CAmount received;
+
+    size_t GetSerializeSize() const {
+        return 16;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata64(s, balance);
+        ser_writedata64(s, received);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        balance = ser_readdata64(s);
+        received = ser_readdata64(s);
+    }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+    }
+};
+
 struct CMempoolAddressDelta
 {
     int64_t time;
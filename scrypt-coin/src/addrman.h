@@ -16,6 +16,7 @@
 
 #include <map>
 #include <set>
+#include <unordered_map>
 #include <stdint.h>
 #include <vector>
 
@@ -213,6 +214,9 @@ private:
     //! last time Good was called (memory only)
     int64_t nLastGood;
 
+    //! cumulative count of state changes, used to skip unchanged dumps (memory only)
+    int64_t nChanges;
+
 protected:
     //! secret key to randomize bucket select with
     uint256 nKey;
@@ -313,7 +317,7 @@ public:
 
         int nUBuckets = ADDRMAN_NEW_BUCKET_COUNT ^ (1 << 30);
         s << nUBuckets;
-        std::map<int, int> mapUnkIds;
+        std::unordered_map<int, int> mapUnkIds(mapInfo.size());
         int nIds = 0;
         for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
             mapUnkIds[(*it).first] = nIds;
@@ -457,7 +461,11 @@ public:
 
     void Clear()
     {
-        std::vector<int>().swap(vRandom);
+        // Keep vRandom's storage preallocated for the full table so Add
+        // floods never reallocate it; at the maximum table size this is a
+        // few hundred kilobytes.
+        vRandom.clear();
+        vRandom.reserve((ADDRMAN_NEW_BUCKET_COUNT + ADDRMAN_TRIED_BUCKET_COUNT) * ADDRMAN_BUCKET_SIZE);
         nKey = GetRandHash();
         for (size_t bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
             for (size_t entry = 0; entry < ADDRMAN_BUCKET_SIZE; entry++) {
@@ -474,12 +482,14 @@ public:
         nTried = 0;
         nNew = 0;
         nLastGood = 1; //Initially at 1 so that "never" is strictly worse.
+        nChanges++;
         mapInfo.clear();
         mapAddr.clear();
     }
 
     CAddrMan()
     {
+        nChanges = 0;
         Clear();
     }
 
@@ -495,6 +505,14 @@ public:
         return vRandom.size();
     }
 
+    //! Cumulative number of state changes; lets the dump timer skip
+    //! serializing a table that has not changed since the last flush.
+    int64_t GetChangeCount() const
+    {
+        LOCK(cs);
+        return nChanges;
+    }
+
     //! Consistency check
     void Check()
     {
@@ -517,6 +535,7 @@ public:
         fRet |= Add_(addr, source, nTimePenalty);
         Check();
         if (fRet) {
+            nChanges++;
             LogPrint(BCLog::ADDRMAN, "Added %s from %s: %i tried, %i new\n", addr.ToStringIPPort(), source.ToString(), nTried, nNew);
         }
         return fRet;
@@ -532,6 +551,7 @@ public:
             nAdd += Add_(*it, source, nTimePenalty) ? 1 : 0;
         Check();
         if (nAdd) {
+            nChanges += nAdd;
             LogPrint(BCLog::ADDRMAN, "Added %i addresses from %s: %i tried, %i new\n", nAdd, source.ToString(), nTried, nNew);
         }
         return nAdd > 0;
@@ -543,6 +563,7 @@ public:
         LOCK(cs);
         Check();
         Good_(addr, nTime);
+        nChanges++;
         Check();
     }
 
@@ -552,6 +573,7 @@ public:
         LOCK(cs);
         Check();
         Attempt_(addr, fCountFailure, nTime);
+        nChanges++;
         Check();
     }
 
@@ -602,6 +624,7 @@ public:
         LOCK(cs);
         Check();
         Connected_(addr, nTime);
+        nChanges++;
         Check();
     }
 
@@ -610,6 +633,7 @@ public:
         LOCK(cs);
         Check();
         SetServices_(addr, nServices);
+        nChanges++;
         Check();
     }
 
@@ -111,6 +111,20 @@ base_uint<BITS>& base_uint<BITS>::operator/=(const base_uint& b)
 template <unsigned int BITS>
 int base_uint<BITS>::CompareTo(const base_uint<BITS>& b) const
 {
+    if (WIDTH % 2 == 0) {
+        // Compare a 64-bit limb pair at a time; for the 256-bit case the
+        // compiler unrolls this into four wide compares instead of eight,
+        // and PoW target checks hit this on every header.
+        for (int i = WIDTH / 2 - 1; i >= 0; i--) {
+            uint64_t n = ((uint64_t)pn[2 * i + 1] << 32) | pn[2 * i];
+            uint64_t bn = ((uint64_t)b.pn[2 * i + 1] << 32) | b.pn[2 * i];
+            if (n < bn)
+                return -1;
+            if (n > bn)
+                return 1;
+        }
+        return 0;
+    }
     for (int i = WIDTH - 1; i >= 0; i--) {
         if (pn[i] < b.pn[i])
             return -1;
@@ -140,6 +140,22 @@ public:
 
     base_uint& operator+=(const base_uint& b)
     {
+        if (WIDTH % 2 == 0) {
+            // add a 64-bit limb pair at a time; halves the carry chain for
+            // the 256-bit case used by chainwork accumulation
+            uint64_t carry = 0;
+            for (int i = 0; i < WIDTH; i += 2)
+            {
+                uint64_t n = ((uint64_t)pn[i + 1] << 32) | pn[i];
+                uint64_t bn = ((uint64_t)b.pn[i + 1] << 32) | b.pn[i];
+                uint64_t sum = n + bn;
+                uint64_t r = sum + carry;
+                carry = (sum < n) | (r < sum);
+                pn[i] = (uint32_t)r;
+                pn[i + 1] = (uint32_t)(r >> 32);
+            }
+            return *this;
+        }
         uint64_t carry = 0;
         for (int i = 0; i < WIDTH; i++)
         {
@@ -3,14 +3,22 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include "config/scrypt-config.h"
+#endif
+
 #include "base58.h"
 
+#include "crypto/common.h"
+#include "crypto/sha256.h"
 #include "hash.h"
+#include "sync.h"
 #include "uint256.h"
 
 #include <assert.h>
 #include <stdint.h>
 #include <string.h>
+#include <map>
 #include <vector>
 #include <string>
 #include <boost/variant/apply_visitor.hpp>
@@ -19,6 +27,35 @@
 /** All alphanumeric characters except for "0", "I", "O", and "l" */
 static const char* pszBase58 = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
 
+/** Character-to-digit table for pszBase58; -1 marks invalid characters */
+static const int8_t mapBase58[256] = {
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1, 0, 1, 2, 3, 4, 5, 6,  7, 8,-1,-1,-1,-1,-1,-1,
+    -1, 9,10,11,12,13,14,15, 16,-1,17,18,19,20,21,-1,
+    22,23,24,25,26,27,28,29, 30,31,32,-1,-1,-1,-1,-1,
+    -1,33,34,35,36,37,38,39, 40,41,42,43,-1,44,45,46,
+    47,48,49,50,51,52,53,54, 55,56,57,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+};
+
+/** 58^5; the largest power of 58 that fits a 32-bit limb, so one multiword
+ *  division produces five base58 digits */
+static const uint32_t BASE58_POW5 = 656356768;
+
+/** Limb counts the conversion buffers below keep on the stack; covers every
+ *  base58check payload in the codebase (addresses, secrets, extended keys)
+ *  with room to spare. Larger inputs fall back to the heap. */
+static const size_t BASE58_STACK_LIMBS = 32;
+
 bool DecodeBase58(const char* psz, std::vector<unsigned char>& vch)
 {
     // Skip leading spaces.
@@ -26,46 +63,63 @@ bool DecodeBase58(const char* psz, std::vector<unsigned char>& vch)
         psz++;
     // Skip and count leading '1's.
     int zeroes = 0;
-    int length = 0;
     while (*psz == '1') {
         zeroes++;
         psz++;
     }
-    // Allocate enough space in big-endian base256 representation.
-    int size = strlen(psz) * 733 /1000 + 1; // log(58) / log(256), rounded up.
-    std::vector<unsigned char> b256(size);
+    // Measure the run of base58 characters; only trailing spaces may follow.
+    size_t len = 0;
+    while (psz[len] && !isspace(psz[len]))
+        len++;
+    {
+        const char* p = psz + len;
+        while (isspace(*p))
+            p++;
+        if (*p != 0)
+            return false;
+    }
+    // Allocate enough space in big-endian base 2^32 representation.
+    size_t nLimbs = (len * 733 / 1000 + 1 + 3) / 4; // log(58) / log(256), rounded up.
+    uint32_t limbsStack[BASE58_STACK_LIMBS];
+    std::vector<uint32_t> limbsHeap;
+    uint32_t* limbs = limbsStack;
+    if (nLimbs > BASE58_STACK_LIMBS) {
+        limbsHeap.resize(nLimbs);
+        limbs = limbsHeap.data();
+    }
+    memset(limbs, 0, nLimbs * sizeof(uint32_t));
     // Process the characters.
-    while (*psz && !isspace(*psz)) {
+    size_t nUsed = 0; // limbs in use at the little end
+    for (size_t i = 0; i < len; i++) {
         // Decode base58 character
-        const char* ch = strchr(pszBase58, *psz);
-        if (ch == nullptr)
+        int8_t d = mapBase58[(unsigned char)psz[i]];
+        if (d < 0)
             return false;
-        // Apply "b256 = b256 * 58 + ch".
-        int carry = ch - pszBase58;
-        int i = 0;
-        for (std::vector<unsigned char>::reverse_iterator it = b256.rbegin(); (carry != 0 || i < length) && (it != b256.rend()); ++it, ++i) {
-            carry += 58 * (*it);
-            *it = carry % 256;
-            carry /= 256;
+        // Apply "limbs = limbs * 58 + d".
+        uint64_t carry = d;
+        size_t j = 0;
+        for (size_t k = nLimbs; k-- > 0 && (carry != 0 || j < nUsed); j++) {
+            carry += (uint64_t)limbs[k] * 58;
+            limbs[k] = (uint32_t)carry;
+            carry >>= 32;
         }
         assert(carry == 0);
-        length = i;
-        psz++;
+        nUsed = j;
     }
-    // Skip trailing spaces.
-    while (isspace(*psz))
-        psz++;
-    if (*psz != 0)
-        return false;
-    // Skip leading zeroes in b256.
-    std::vector<unsigned char>::iterator it = b256.begin() + (size - length);
-    while (it != b256.end() && *it == 0)
-        it++;
-    // Copy result into output vector.
-    vch.reserve(zeroes + (b256.end() - it));
+    // Copy result into output vector, skipping leading zero bytes.
+    vch.clear();
+    vch.reserve(zeroes + nUsed * 4);
     vch.assign(zeroes, 0x00);
-    while (it != b256.end())
-        vch.push_back(*(it++));
+    bool fLeading = true;
+    for (size_t k = nLimbs - nUsed; k < nLimbs; k++) {
+        for (int b = 24; b >= 0; b -= 8) {
+            unsigned char c = (limbs[k] >> b) & 0xff;
+            if (fLeading && c == 0)
+                continue;
+            fLeading = false;
+            vch.push_back(c);
+        }
+    }
     return true;
 }
 
@@ -74,39 +128,62 @@ std::string EncodeBase58(const unsigned char* pbegin, const unsigned char* pend)
 {
     // Skip & count leading zeroes.
     int zeroes = 0;
-    int length = 0;
     while (pbegin != pend && *pbegin == 0) {
         pbegin++;
         zeroes++;
     }
-    // Allocate enough space in big-endian base58 representation.
-    int size = (pend - pbegin) * 138 / 100 + 1; // log(256) / log(58), rounded up.
-    std::vector<unsigned char> b58(size);
-    // Process the bytes.
-    while (pbegin != pend) {
-        int carry = *pbegin;
-        int i = 0;
-        // Apply "b58 = b58 * 256 + ch".
-        for (std::vector<unsigned char>::reverse_iterator it = b58.rbegin(); (carry != 0 || i < length) && (it != b58.rend()); it++, i++) {
-            carry += 256 * (*it);
-            *it = carry % 58;
-            carry /= 58;
+    // Pack the bytes big-endian into 32-bit limbs.
+    size_t len = pend - pbegin;
+    size_t nLimbs = (len + 3) / 4;
+    uint32_t limbsStack[BASE58_STACK_LIMBS];
+    std::vector<uint32_t> limbsHeap;
+    uint32_t* limbs = limbsStack;
+    if (nLimbs > BASE58_STACK_LIMBS) {
+        limbsHeap.resize(nLimbs);
+        limbs = limbsHeap.data();
+    }
+    memset(limbs, 0, nLimbs * sizeof(uint32_t));
+    size_t nPad = nLimbs * 4 - len;
+    for (size_t i = 0; i < len; i++)
+        limbs[(nPad + i) / 4] |= (uint32_t)pbegin[i] << (8 * (3 - (nPad + i) % 4));
+    // Divide out 58^5 per pass, collecting five digits each time
+    // (least-significant first). Each pass strips at most 29 bits, so cap
+    // the digit count accordingly (the final pass always emits all five).
+    size_t nDigitsCap = 5 * (nLimbs * 32 / 29 + 2);
+    char digitsStack[5 * (BASE58_STACK_LIMBS * 32 / 29 + 2)];
+    std::vector<char> digitsHeap;
+    char* digits = digitsStack;
+    if (nDigitsCap > sizeof(digitsStack)) {
+        digitsHeap.resize(nDigitsCap);
+        digits = digitsHeap.data();
+    }
+    size_t nDigits = 0;
+    size_t nStart = 0; // first limb that can still be non-zero
+    while (true) {
+        while (nStart < nLimbs && limbs[nStart] == 0)
+            nStart++;
+        if (nStart == nLimbs)
+            break;
+        uint64_t rem = 0;
+        for (size_t k = nStart; k < nLimbs; k++) {
+            uint64_t cur = (rem << 32) | limbs[k];
+            limbs[k] = (uint32_t)(cur / BASE58_POW5);
+            rem = cur % BASE58_POW5;
+        }
+        for (int d = 0; d < 5; d++) {
+            digits[nDigits++] = (char)(rem % 58);
+            rem /= 58;
         }
-
-        assert(carry == 0);
-        length = i;
-        pbegin++;
     }
-    // Skip leading zeroes in base58 result.
-    std::vector<unsigned char>::iterator it = b58.begin() + (size - length);
-    while (it != b58.end() && *it == 0)
-        it++;
+    // Skip zero digits at the big end of the last group.
+    while (nDigits > 0 && digits[nDigits - 1] == 0)
+        nDigits--;
     // Translate the result into a string.
     std::string str;
-    str.reserve(zeroes + (b58.end() - it));
+    str.reserve(zeroes + nDigits);
     str.assign(zeroes, '1');
-    while (it != b58.end())
-        str += pszBase58[*(it++)];
+    for (size_t i = nDigits; i-- > 0;)
+        str += pszBase58[(int)digits[i]];
     return str;
 }
 
@@ -129,6 +206,88 @@ std::string EncodeBase58Check(const std::vector<unsigned char>& vchIn)
     return EncodeBase58(vch);
 }
 
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__))
+namespace sha256_avx2_mb
+{
+void Initialize_8way(uint32_t* s);
+void Transform_8way(uint32_t* s, const unsigned char* in);
+}
+
+/** Largest message that still fits a single padded SHA256 block; every
+ *  base58check payload in the codebase is well under this. */
+static const size_t BASE58_8WAY_MAX_PAYLOAD = 55;
+
+/** Double-SHA256 of eight independent single-block messages, one per
+ *  32-bit lane of the 8-way AVX2 transform. */
+static void DoubleSHA256_8way(const unsigned char* const data[8], const size_t len[8], unsigned char digest[8][32])
+{
+    uint32_t s[64];
+    unsigned char block[8 * 64];
+
+    // First hash: each padded message is one compression.
+    sha256_avx2_mb::Initialize_8way(s);
+    for (size_t l = 0; l < 8; l++) {
+        unsigned char* p = block + 64 * l;
+        memcpy(p, data[l], len[l]);
+        memset(p + len[l], 0, 64 - len[l]);
+        p[len[l]] = 0x80;
+        WriteBE64(p + 56, len[l] * 8);
+    }
+    sha256_avx2_mb::Transform_8way(s, block);
+
+    // Scatter the lane digests (word-major state layout) back into blocks
+    // padded for the second hash.
+    for (size_t l = 0; l < 8; l++) {
+        unsigned char* p = block + 64 * l;
+        for (int w = 0; w < 8; w++)
+            WriteBE32(p + 4 * w, s[8 * w + l]);
+        memset(p + 32, 0, 32);
+        p[32] = 0x80;
+        WriteBE64(p + 56, 32 * 8);
+    }
+    sha256_avx2_mb::Initialize_8way(s);
+    sha256_avx2_mb::Transform_8way(s, block);
+    for (size_t l = 0; l < 8; l++)
+        for (int w = 0; w < 8; w++)
+            WriteBE32(digest[l] + 4 * w, s[8 * w + l]);
+}
+#endif
+
+std::vector<std::string> EncodeBase58CheckBatch(const std::vector<std::vector<unsigned char> >& vchInputs)
+{
+    std::vector<std::string> vstr(vchInputs.size());
+    size_t i = 0;
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__))
+    if (SHA256Has8WayAVX2()) {
+        while (i + 8 <= vchInputs.size()) {
+            // Lanes must stay in lockstep, so every payload of the group
+            // has to fit a single block; address payloads always do.
+            bool fSingleBlock = true;
+            const unsigned char* data[8];
+            size_t len[8];
+            for (size_t l = 0; l < 8; l++) {
+                data[l] = vchInputs[i + l].data();
+                len[l] = vchInputs[i + l].size();
+                fSingleBlock &= len[l] <= BASE58_8WAY_MAX_PAYLOAD;
+            }
+            if (!fSingleBlock)
+                break;
+            unsigned char digest[8][32];
+            DoubleSHA256_8way(data, len, digest);
+            for (size_t l = 0; l < 8; l++) {
+                std::vector<unsigned char> vch(vchInputs[i + l]);
+                vch.insert(vch.end(), digest[l], digest[l] + 4);
+                vstr[i + l] = EncodeBase58(vch);
+            }
+            i += 8;
+        }
+    }
+#endif
+    for (; i < vchInputs.size(); i++)
+        vstr[i] = EncodeBase58Check(vchInputs[i]);
+    return vstr;
+}
+
 bool DecodeBase58Check(const char* psz, std::vector<unsigned char>& vchRet)
 {
     if (!DecodeBase58(psz, vchRet) ||
@@ -199,6 +358,18 @@ std::string CBase58Data::ToString() const
     return EncodeBase58Check(vch);
 }
 
+std::vector<std::string> CBase58Data::ToStringBatch(const std::vector<const CBase58Data*>& vData)
+{
+    std::vector<std::vector<unsigned char> > vchInputs;
+    vchInputs.reserve(vData.size());
+    for (const CBase58Data* pb58 : vData) {
+        std::vector<unsigned char> vch = pb58->vchVersion;
+        vch.insert(vch.end(), pb58->vchData.begin(), pb58->vchData.end());
+        vchInputs.push_back(vch);
+    }
+    return EncodeBase58CheckBatch(vchInputs);
+}
+
 int CBase58Data::CompareTo(const CBase58Data& b58) const
 {
     if (vchVersion < b58.vchVersion)
@@ -235,6 +406,45 @@ public:
  * Script-hash-addresses have version 139
  * The data vector contains RIPEMD160(SHA256(cscript)), where cscript is the serialized redemption script.
  */
+/**
+ * Decoded-address cache: validateaddress and explorer dashboards decode the
+ * same handful of addresses over and over, and a full base58check decode
+ * costs a double-SHA256 plus the base conversion. Keyed by the presented
+ * string; failed decodes are cached too (as an empty version) so invalid
+ * strings are also answered from the map. Only addresses go through this —
+ * CBitcoinSecret keeps its own SetString path so private key material never
+ * lands in a long-lived global. Cleared wholesale when full.
+ */
+static const size_t MAX_ADDRESS_DECODE_CACHE = 10000;
+static CCriticalSection cs_addressDecodeCache;
+static std::map<std::string, std::pair<std::vector<unsigned char>, std::vector<unsigned char> > > mapAddressDecodeCache;
+
+bool CBitcoinAddress::SetString(const std::string& strAddress)
+{
+    {
+        LOCK(cs_addressDecodeCache);
+        std::map<std::string, std::pair<std::vector<unsigned char>, std::vector<unsigned char> > >::const_iterator it =
+            mapAddressDecodeCache.find(strAddress);
+        if (it != mapAddressDecodeCache.end()) {
+            vchVersion = it->second.first;
+            vchData.assign(it->second.second.begin(), it->second.second.end());
+            return !vchVersion.empty();
+        }
+    }
+    bool fRet = CBase58Data::SetString(strAddress);
+    LOCK(cs_addressDecodeCache);
+    if (mapAddressDecodeCache.size() >= MAX_ADDRESS_DECODE_CACHE)
+        mapAddressDecodeCache.clear();
+    mapAddressDecodeCache[strAddress] = std::make_pair(
+        vchVersion, std::vector<unsigned char>(vchData.begin(), vchData.end()));
+    return fRet;
+}
+
+bool CBitcoinAddress::SetString(const char* pszAddress)
+{
+    return SetString(std::string(pszAddress));
+}
+
 bool CBitcoinAddress::Set(const CKeyID& id)
 {
     SetData(Params().Base58Prefix(CChainParams::PUBKEY_ADDRESS), &id, 20);
@@ -54,6 +54,13 @@ bool DecodeBase58(const std::string& str, std::vector<unsigned char>& vchRet);
  */
 std::string EncodeBase58Check(const std::vector<unsigned char>& vchIn);
 
+/**
+ * Encode several byte vectors at once, including checksums. Groups of eight
+ * checksums are hashed together through the 8-way AVX2 SHA256 transform when
+ * the CPU supports it; use this from loops that emit many addresses.
+ */
+std::vector<std::string> EncodeBase58CheckBatch(const std::vector<std::vector<unsigned char> >& vchInputs);
+
 /**
  * Decode a base58-encoded string (psz) that includes a checksum into a byte
  * vector (vchRet), return true if decoding is successful
@@ -87,6 +94,9 @@ public:
     bool SetString(const char* psz, unsigned int nVersionBytes = 1);
     bool SetString(const std::string& str);
     std::string ToString() const;
+    /** Encode several items at once, batching the checksum hashing; see
+     *  EncodeBase58CheckBatch. */
+    static std::vector<std::string> ToStringBatch(const std::vector<const CBase58Data*>& vData);
     int CompareTo(const CBase58Data& b58) const;
 
     bool operator==(const CBase58Data& b58) const { return CompareTo(b58) == 0; }
@@ -116,6 +126,11 @@ public:
     CBitcoinAddress(const std::string& strAddress) { SetString(strAddress); }
     CBitcoinAddress(const char* pszAddress) { SetString(pszAddress); }
 
+    //! Decode through the shared address cache (see base58.cpp); these hide
+    //! the CBase58Data overloads for addresses only.
+    bool SetString(const std::string& strAddress);
+    bool SetString(const char* pszAddress);
+
     CTxDestination Get() const;
     bool GetKeyID(CKeyID &keyID) const;
     bool IsScript() const;
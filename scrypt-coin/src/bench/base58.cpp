@@ -0,0 +1,52 @@
+// Copyright (c) 2016-2017 The Bitcoin Core developers
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "base58.h"
+
+#include <string>
+#include <vector>
+
+static void Base58Encode(benchmark::State& state)
+{
+    unsigned char buff[32] = {
+        17, 79, 8, 99, 150, 189, 208, 162, 22, 23, 203, 163, 36, 58, 147,
+        227, 139, 2, 215, 100, 91, 38, 11, 141, 253, 40, 117, 21, 16, 90,
+        200, 24
+    };
+    unsigned char* b = buff;
+    while (state.KeepRunning()) {
+        EncodeBase58(b, b + 32);
+    }
+}
+
+static void Base58CheckEncode(benchmark::State& state)
+{
+    unsigned char buff[32] = {
+        18, 60, 211, 127, 95, 182, 161, 228, 31, 96, 205, 183, 61, 104, 45,
+        157, 134, 254, 55, 137, 83, 24, 111, 60, 185, 83, 233, 139, 172, 81,
+        102, 37
+    };
+    unsigned char* b = buff;
+    std::vector<unsigned char> vch;
+    vch.assign(b, b + 32);
+    while (state.KeepRunning()) {
+        EncodeBase58Check(vch);
+    }
+}
+
+static void Base58Decode(benchmark::State& state)
+{
+    const char* addr = "17VZNX1SN5NtKa8UQFxwQbFeFc3iqRYhem";
+    std::vector<unsigned char> vch;
+    while (state.KeepRunning()) {
+        DecodeBase58(addr, vch);
+    }
+}
+
+BENCHMARK(Base58Encode);
+BENCHMARK(Base58CheckEncode);
+BENCHMARK(Base58Decode);
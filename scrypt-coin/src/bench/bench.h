@@ -0,0 +1,68 @@
+// Copyright (c) 2015-2017 The Bitcoin Core developers
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YACOIN_BENCH_BENCH_H
+#define YACOIN_BENCH_BENCH_H
+
+#include <functional>
+#include <limits>
+#include <map>
+#include <string>
+
+#include <stdint.h>
+
+/** Simple micro benchmarking framework. Benchmarks self-register through the
+ * BENCHMARK macro and are all run by bench_scrypt:
+ *
+ * static void CODE_TO_TIME(benchmark::State& state)
+ * {
+ *     ... initialization that should not be timed ...
+ *     while (state.KeepRunning()) {
+ *        ... do stuff you want to time ...
+ *     }
+ * }
+ * BENCHMARK(CODE_TO_TIME);
+ *
+ * KeepRunning calibrates an iteration mask so the steady-clock is only
+ * queried every 2^n iterations, keeping timer overhead out of fast paths.
+ */
+namespace benchmark {
+
+    class State {
+        std::string name;
+        double maxElapsed;
+        double beginTime, lastTime, minTime, maxTime;
+        uint64_t count;
+        uint64_t countMask;
+        double countMaskInv;
+    public:
+        State(std::string _name, double _maxElapsed) :
+            name(_name), maxElapsed(_maxElapsed),
+            beginTime(0), lastTime(0),
+            minTime(std::numeric_limits<double>::max()),
+            maxTime(std::numeric_limits<double>::min()),
+            count(0), countMask(1), countMaskInv(0.5) {}
+        bool KeepRunning();
+    };
+
+    typedef std::function<void(State&)> BenchFunction;
+
+    class BenchRunner
+    {
+        typedef std::map<std::string, BenchFunction> BenchmarkMap;
+        static BenchmarkMap &benchmarks();
+
+    public:
+        BenchRunner(std::string name, BenchFunction func);
+
+        static void RunAll(double elapsedTimeForOne = 1.0);
+    };
+}
+
+// BENCHMARK(foo) expands to:  benchmark::BenchRunner BENCH_foo("foo", foo);
+#define BENCHMARK(n) \
+    benchmark::BenchRunner BENCH_##n(#n, n);
+
+#endif // YACOIN_BENCH_BENCH_H
@@ -0,0 +1,27 @@
+// Copyright (c) 2015-2017 The Bitcoin Core developers
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "crypto/sha256.h"
+#include "key.h"
+#include "random.h"
+#include "util.h"
+
+int
+main(int argc, char** argv)
+{
+    SHA256AutoDetect();
+    RandomInit();
+    ECC_Start();
+    SetupEnvironment();
+    fPrintToDebugLog = false; // don't want to write to debug.log file
+    SelectParams(CBaseChainParams::MAIN);
+
+    benchmark::BenchRunner::RunAll();
+
+    ECC_Stop();
+}
@@ -0,0 +1,60 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "coins.h"
+#include "random.h"
+#include "script/script.h"
+
+#include <vector>
+
+static const size_t NUM_COINS = 10000;
+
+static void FillCoins(CCoinsViewCache& cache, std::vector<COutPoint>& outpoints)
+{
+    CScript scriptPubKey = CScript() << std::vector<unsigned char>(20, 0x99) << OP_CHECKSIG;
+    outpoints.reserve(NUM_COINS);
+    for (size_t i = 0; i < NUM_COINS; i++) {
+        COutPoint outpoint(GetRandHash(), 0);
+        cache.AddCoin(outpoint, Coin(CTxOut(1000, scriptPubKey), 1, false, false, 0), false);
+        outpoints.push_back(outpoint);
+    }
+}
+
+/* Hot lookups against a populated cache; this is the lookup every input of
+ * every validated transaction pays. */
+static void CCoinsViewCacheLookup(benchmark::State& state)
+{
+    CCoinsView base;
+    CCoinsViewCache cache(&base);
+    std::vector<COutPoint> outpoints;
+    FillCoins(cache, outpoints);
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        const Coin& coin = cache.AccessCoin(outpoints[i]);
+        assert(!coin.IsSpent());
+        i = (i + 1) % outpoints.size();
+    }
+}
+
+/* Add a batch of fresh coins and flush them down to the base view, the
+ * pattern block connection follows. */
+static void CCoinsViewCacheFlush(benchmark::State& state)
+{
+    CCoinsView base;
+    CScript scriptPubKey = CScript() << std::vector<unsigned char>(20, 0x99) << OP_CHECKSIG;
+
+    while (state.KeepRunning()) {
+        CCoinsViewCache cache(&base);
+        for (size_t i = 0; i < 1000; i++) {
+            cache.AddCoin(COutPoint(GetRandHash(), 0), Coin(CTxOut(1000, scriptPubKey), 1, false, false, 0), false);
+        }
+        cache.Flush();
+    }
+}
+
+BENCHMARK(CCoinsViewCacheLookup);
+BENCHMARK(CCoinsViewCacheFlush);
@@ -0,0 +1,70 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "amount.h"
+#include "chainparams.h"
+#include "consensus/validation.h"
+#include "primitives/block.h"
+#include "primitives/transaction.h"
+#include "random.h"
+#include "timedata.h"
+#include "validation.h"
+
+#include <vector>
+
+/* Build a synthetic proof-of-work block: a coinbase plus nTx simple spends
+ * of (nonexistent) outputs. CheckBlock is context-free, so the inputs do
+ * not need to exist; this times the syntactic pass every relayed block
+ * goes through, dominated by CheckTransaction and the merkle rebuild. */
+static CBlock BuildTestBlock(size_t nTx)
+{
+    CBlock block;
+    block.nTime = GetAdjustedTime();
+
+    CMutableTransaction coinbase;
+    coinbase.nTime = block.nTime;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig = CScript() << std::vector<unsigned char>(4, 0xab);
+    coinbase.vout.resize(1);
+    coinbase.vout[0].nValue = 50 * COIN;
+    coinbase.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    block.vtx.push_back(CTransaction(coinbase));
+
+    for (size_t i = 0; i < nTx; i++) {
+        CMutableTransaction mtx;
+        mtx.nTime = block.nTime;
+        mtx.vin.resize(2);
+        mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+        mtx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(72, 0x30);
+        mtx.vin[1].prevout = COutPoint(GetRandHash(), 1);
+        mtx.vin[1].scriptSig = CScript() << std::vector<unsigned char>(72, 0x30);
+        mtx.vout.resize(2);
+        mtx.vout[0].nValue = 1 * COIN;
+        mtx.vout[0].scriptPubKey = CScript() << std::vector<unsigned char>(20, 0x99) << OP_CHECKSIG;
+        mtx.vout[1].nValue = 2 * COIN;
+        mtx.vout[1].scriptPubKey = CScript() << std::vector<unsigned char>(20, 0x77) << OP_CHECKSIG;
+        block.vtx.push_back(CTransaction(mtx));
+    }
+
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    return block;
+}
+
+static void CheckBlockBench(benchmark::State& state)
+{
+    CBlock block = BuildTestBlock(500);
+    const Consensus::Params& params = Params().GetConsensus();
+
+    while (state.KeepRunning()) {
+        block.fChecked = false;
+        block.vMerkleTree.clear();
+        CValidationState validationState;
+        bool fOk = CheckBlock(block, validationState, params, false /* fCheckPOW */, true /* fCheckMerkleRoot */, false /* fCheckSig */);
+        assert(fOk);
+    }
+}
+
+BENCHMARK(CheckBlockBench);
@@ -0,0 +1,100 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "Yassert.h"
+#include "checkqueue.h"
+#include "cuckoocache.h"
+#include "random.h"
+#include "script/sigcache.h"
+#include "uint256.h"
+
+#include <boost/thread/thread.hpp>
+
+#include <atomic>
+#include <vector>
+
+/* The batch size ConnectBlock uses for its script check queue. */
+static const unsigned int QUEUE_BATCH_SIZE = 128;
+/* Worker count; fixed rather than GetNumCores() so results stay comparable
+ * across runs on the same machine. */
+static const int BENCH_CHECK_THREADS = 4;
+static const size_t BENCH_BATCHES = 100;
+static const size_t BENCH_CHECKS_PER_BATCH = 30;
+
+/* A check that does almost no work, so the benchmark measures the queue's
+ * dispatch and wakeup overhead rather than the check bodies. */
+struct FakeCheck {
+    bool operator()() { return true; }
+    void swap(FakeCheck& x) {}
+};
+
+/* One master pushing batches at BENCH_CHECK_THREADS workers and then joining
+ * them, the shape of every ConnectBlock script verification round. The CSV
+ * line this emits is what CI compares run-over-run to catch dispatch-path
+ * regressions. */
+static void CCheckQueueDispatch(benchmark::State& state)
+{
+    CCheckQueue<FakeCheck> queue(QUEUE_BATCH_SIZE);
+    boost::thread_group threadGroup;
+    for (int i = 0; i < BENCH_CHECK_THREADS; i++)
+        threadGroup.create_thread(boost::bind(&CCheckQueue<FakeCheck>::Thread, &queue));
+
+    while (state.KeepRunning()) {
+        CCheckQueueControl<FakeCheck> control(&queue);
+        for (size_t j = 0; j < BENCH_BATCHES; j++) {
+            std::vector<FakeCheck> vChecks(BENCH_CHECKS_PER_BATCH);
+            control.Add(vChecks);
+        }
+        control.Wait();
+    }
+
+    queue.Quit();
+    threadGroup.join_all();
+}
+
+/* Lookup latency in a mostly-hitting CuckooCache while BENCH_CHECK_THREADS
+ * other threads hammer it with reads, the way the signature cache is hit by
+ * parallel script check workers. Reads never mutate the table (erasure is
+ * deferred in sigcache.cpp for the same reason), so this isolates the cost
+ * of cache-line sharing between the readers. */
+static void CuckooCacheContention(benchmark::State& state)
+{
+    CuckooCache::cache<uint256, SignatureCacheHasher> set;
+    set.setup_bytes(4 * 1024 * 1024);
+
+    // Fill to well below capacity so lookups are mostly hits
+    std::vector<uint256> keys;
+    keys.reserve(50000);
+    for (size_t i = 0; i < 50000; i++) {
+        uint256 key = GetRandHash();
+        set.insert(key);
+        keys.push_back(key);
+    }
+
+    std::atomic<bool> fDone(false);
+    boost::thread_group threadGroup;
+    for (int t = 0; t < BENCH_CHECK_THREADS; t++) {
+        threadGroup.create_thread([&, t] {
+            size_t i = t;
+            while (!fDone) {
+                set.contains(keys[i], false);
+                i = (i + 7) % keys.size();
+            }
+        });
+    }
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        set.contains(keys[i], false);
+        i = (i + 1) % keys.size();
+    }
+
+    fDone = true;
+    threadGroup.join_all();
+}
+
+BENCHMARK(CCheckQueueDispatch);
+BENCHMARK(CuckooCacheContention);
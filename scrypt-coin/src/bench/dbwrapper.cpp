@@ -0,0 +1,28 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "dbwrapper.h"
+#include "random.h"
+#include "uint256.h"
+
+/* Batched key/value writes through CDBWrapper, the path every block's
+ * coin and index updates take. Uses an in-memory LevelDB so the numbers
+ * reflect batch construction and memtable insertion, not disk latency. */
+static void DBWrapperBatchWrite(benchmark::State& state)
+{
+    CDBWrapper dbw(fs::temp_directory_path() / "bench_dbwrapper", 1 << 20, true /* fMemory */, true /* fWipe */);
+
+    uint64_t nKey = 0;
+    while (state.KeepRunning()) {
+        CDBBatch batch(dbw);
+        for (int i = 0; i < 100; i++) {
+            batch.Write(std::make_pair('b', nKey++), GetRandHash());
+        }
+        dbw.WriteBatch(batch);
+    }
+}
+
+BENCHMARK(DBWrapperBatchWrite);
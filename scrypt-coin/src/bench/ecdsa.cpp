@@ -0,0 +1,56 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "key.h"
+#include "pubkey.h"
+#include "random.h"
+#include "uint256.h"
+
+#include <vector>
+
+/* Exercise the global libsecp256k1 contexts on the operations that dominate
+ * the wallet (signing) and CScriptCheck (verification). */
+static void ECDSASign(benchmark::State& state)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    uint256 hash = GetRandHash();
+    std::vector<unsigned char> vchSig;
+    while (state.KeepRunning()) {
+        key.Sign(hash, vchSig);
+    }
+}
+
+static void ECDSAVerify(benchmark::State& state)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CPubKey pubkey = key.GetPubKey();
+    uint256 hash = GetRandHash();
+    std::vector<unsigned char> vchSig;
+    key.Sign(hash, vchSig);
+    while (state.KeepRunning()) {
+        pubkey.Verify(hash, vchSig);
+    }
+}
+
+/* Compact signature recovery, the signmessage/verifymessage path. */
+static void ECDSARecover(benchmark::State& state)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    uint256 hash = GetRandHash();
+    std::vector<unsigned char> vchSig;
+    key.SignCompact(hash, vchSig);
+    while (state.KeepRunning()) {
+        CPubKey pubkey;
+        pubkey.RecoverCompact(hash, vchSig);
+    }
+}
+
+BENCHMARK(ECDSASign);
+BENCHMARK(ECDSAVerify);
+BENCHMARK(ECDSARecover);
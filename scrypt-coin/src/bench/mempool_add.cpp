@@ -0,0 +1,44 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "amount.h"
+#include "primitives/transaction.h"
+#include "random.h"
+#include "txmempool.h"
+#include "util.h"
+
+#include <vector>
+
+/* Time addUnchecked across a batch of independent transactions: the
+ * multi-index insertion plus ancestor bookkeeping that runs for every
+ * accepted transaction after validation proper is done. */
+static void MempoolAddUnchecked(benchmark::State& state)
+{
+    std::vector<CTransactionRef> vtx;
+    vtx.reserve(1000);
+    for (size_t i = 0; i < 1000; i++) {
+        CMutableTransaction mtx;
+        mtx.nTime = GetTime();
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+        mtx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(72, 0x30);
+        mtx.vout.resize(1);
+        mtx.vout[0].nValue = 1 * COIN;
+        mtx.vout[0].scriptPubKey = CScript() << std::vector<unsigned char>(20, 0x99) << OP_CHECKSIG;
+        vtx.push_back(MakeTransactionRef(std::move(mtx)));
+    }
+
+    CTxMemPool pool;
+    LockPoints lp;
+    while (state.KeepRunning()) {
+        for (const CTransactionRef& tx : vtx) {
+            pool.addUnchecked(tx->GetHash(), CTxMemPoolEntry(tx, 1000, GetTime(), 1, false, 1, lp));
+        }
+        pool.clear();
+    }
+}
+
+BENCHMARK(MempoolAddUnchecked);
@@ -0,0 +1,31 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "scrypt.h"
+#include "uint256.h"
+
+#include <string.h>
+
+/* Hash an 80-byte header-sized input at several of the Nfactors the chain
+ * moves through as block spacing grows. The scratchpad doubles with each
+ * step, so these also exercise very different cache footprints. */
+static void ScryptHashAtNfactor(benchmark::State& state, unsigned char Nfactor)
+{
+    unsigned char input[80];
+    memset(input, 0x3a, sizeof(input));
+    ::uint32_t res[8];
+    while (state.KeepRunning()) {
+        scrypt_hash(input, sizeof(input), res, Nfactor);
+    }
+}
+
+static void ScryptHashN4(benchmark::State& state) { ScryptHashAtNfactor(state, 4); }
+static void ScryptHashN9(benchmark::State& state) { ScryptHashAtNfactor(state, 9); }
+static void ScryptHashN14(benchmark::State& state) { ScryptHashAtNfactor(state, 14); }
+
+BENCHMARK(ScryptHashN4);
+BENCHMARK(ScryptHashN9);
+BENCHMARK(ScryptHashN14);
@@ -19,16 +19,55 @@
 #include <utility>
 #include <unordered_map>
 
-CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block) :
+#include <boost/thread/tss.hpp>
+
+namespace {
+/** Scratch space for compact block reconstruction, reused across InitData
+ *  calls on the same message-handler thread. Compact blocks arrive in bursts
+ *  during header races and reorgs; keeping the short-ID table and match
+ *  bitmap warm makes the common reconstruct path allocation-free once a
+ *  thread has seen one block of comparable size (unordered_map::clear and
+ *  vector::clear both retain their storage). */
+struct BlockReconstructScratch {
+    std::unordered_map<uint64_t, uint16_t> shorttxids;
+    std::vector<bool> have_txn;
+    std::vector<uint256> vChunkHashes;
+    std::vector<uint64_t> vChunkShortIDs;
+};
+boost::thread_specific_ptr<BlockReconstructScratch> reconstructScratch;
+
+BlockReconstructScratch& GetReconstructScratch()
+{
+    if (!reconstructScratch.get())
+        reconstructScratch.reset(new BlockReconstructScratch());
+    return *reconstructScratch.get();
+}
+} // namespace
+
+CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, const CTxMemPool* poolIn) :
         nonce(GetRand(std::numeric_limits<uint64_t>::max())),
-        shorttxids(block.vtx.size() - 1), prefilledtxn(1), header(block) {
+        header(block) {
     FillShortTxIDSelector();
-    //TODO: Use our mempool prior to block acceptance to predictively fill more than just the coinbase
-    prefilledtxn[0] = {0, std::make_shared<CTransaction>(block.vtx[0])};
-    for (size_t i = 1; i < block.vtx.size(); i++) {
+    shorttxids.reserve(block.vtx.size() - 1);
+    // The coinbase is always prefilled. Beyond that, use our mempool to
+    // predict what peers are missing: a transaction that never entered our
+    // mempool (coinstake, locally mined txns) almost certainly isn't in
+    // theirs, so prefilling it saves them a getblocktxn round trip.
+    int32_t nLastPrefilledIndex = -1;
+    std::vector<uint256> vShortIDHashes;
+    vShortIDHashes.reserve(block.vtx.size() - 1);
+    for (size_t i = 0; i < block.vtx.size(); i++) {
         const CTransaction& tx = block.vtx[i];
-        shorttxids[i - 1] = GetShortID(tx.GetHash());
+        if (i == 0 || (poolIn && !poolIn->exists(tx.GetHash()))) {
+            // PrefilledTransaction indexes are differentially encoded
+            prefilledtxn.push_back({(uint16_t)(i - nLastPrefilledIndex - 1), std::make_shared<CTransaction>(tx)});
+            nLastPrefilledIndex = i;
+        } else {
+            vShortIDHashes.push_back(tx.GetHash());
+        }
     }
+    // One vectorized SipHash pass over the non-prefilled hashes
+    GetShortIDs(vShortIDHashes, shorttxids);
 }
 
 void CBlockHeaderAndShortTxIDs::FillShortTxIDSelector() const {
@@ -47,6 +86,16 @@ uint64_t CBlockHeaderAndShortTxIDs::GetShortID(const uint256& txhash) const {
     return SipHashUint256(shorttxidk0, shorttxidk1, txhash) & 0xffffffffffffL;
 }
 
+void CBlockHeaderAndShortTxIDs::GetShortIDs(const std::vector<uint256>& hashes, std::vector<uint64_t>& out) const {
+    static_assert(SHORTTXIDS_LENGTH == 6, "shorttxids calculation assumes 6-byte shorttxids");
+    out.resize(hashes.size());
+    if (hashes.empty())
+        return;
+    SipHashUint256Batch(shorttxidk0, shorttxidk1, hashes.data(), hashes.size(), out.data());
+    for (uint64_t& shortid : out)
+        shortid &= 0xffffffffffffL;
+}
+
 
 
 ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn) {
@@ -81,7 +130,10 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     // Because well-formed cmpctblock messages will have a (relatively) uniform distribution
     // of short IDs, any highly-uneven distribution of elements can be safely treated as a
     // READ_STATUS_FAILED.
-    std::unordered_map<uint64_t, uint16_t> shorttxids(cmpctblock.shorttxids.size());
+    BlockReconstructScratch& scratch = GetReconstructScratch();
+    std::unordered_map<uint64_t, uint16_t>& shorttxids = scratch.shorttxids;
+    shorttxids.clear();
+    shorttxids.reserve(cmpctblock.shorttxids.size());
     uint16_t index_offset = 0;
     for (size_t i = 0; i < cmpctblock.shorttxids.size(); i++) {
         while (txn_available[i + index_offset])
@@ -105,12 +157,27 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     if (shorttxids.size() != cmpctblock.shorttxids.size())
         return READ_STATUS_FAILED; // Short ID collision
 
-    std::vector<bool> have_txn(txn_available.size());
+    std::vector<bool>& have_txn = scratch.have_txn;
+    have_txn.assign(txn_available.size(), false);
     {
         LOCK(pool->cs);
         const std::vector<std::pair<uint256, CTxMemPool::txiter> >& vTxHashes = pool->vTxHashes;
+        // Short IDs for the mempool scan are computed in chunks through the
+        // vectorized batch API; chunking keeps the everything-matched early
+        // exit below from wasting SipHash work on the rest of the mempool.
+        const size_t nShortIDBatch = 1024;
+        std::vector<uint256>& vChunkHashes = scratch.vChunkHashes;
+        std::vector<uint64_t>& vChunkShortIDs = scratch.vChunkShortIDs;
+        vChunkHashes.clear();
+        vChunkHashes.reserve(nShortIDBatch);
         for (size_t i = 0; i < vTxHashes.size(); i++) {
-            uint64_t shortid = cmpctblock.GetShortID(vTxHashes[i].first);
+            if (i % nShortIDBatch == 0) {
+                vChunkHashes.clear();
+                for (size_t j = i; j < std::min(i + nShortIDBatch, vTxHashes.size()); j++)
+                    vChunkHashes.push_back(vTxHashes[j].first);
+                cmpctblock.GetShortIDs(vChunkHashes, vChunkShortIDs);
+            }
+            uint64_t shortid = vChunkShortIDs[i % nShortIDBatch];
             std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
             if (idit != shorttxids.end()) {
                 if (!have_txn[idit->second]) {
@@ -177,6 +244,26 @@ bool PartiallyDownloadedBlock::IsTxAvailable(size_t index) const {
     return txn_available[index] != nullptr;
 }
 
+void PartiallyDownloadedBlock::GetPrefetchOutpoints(std::vector<COutPoint>& vOutpoints) const {
+    // Txids of the transactions we already have; outpoints they create
+    // do not exist in the coins DB yet, so spending them in-block is not
+    // worth a lookup
+    std::set<uint256> setAvailableTxids;
+    for (const CTransactionRef& tx : txn_available) {
+        if (tx)
+            setAvailableTxids.insert(tx->GetHash());
+    }
+    for (const CTransactionRef& tx : txn_available) {
+        if (!tx || tx->IsCoinBase())
+            continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (setAvailableTxids.count(txin.prevout.hash))
+                continue;
+            vOutpoints.push_back(txin.prevout);
+        }
+    }
+}
+
 ReadStatus PartiallyDownloadedBlock::FillBlock(CBlock& block, const std::vector<CTransactionRef>& vtx_missing) {
     assert(!header.IsNull());
     uint256 hash = header.GetHash();
@@ -150,10 +150,17 @@ public:
     // Dummy for deserialization
     CBlockHeaderAndShortTxIDs() {}
 
-    CBlockHeaderAndShortTxIDs(const CBlock& block);
+    // If poolIn is given, transactions missing from our mempool (coinbase,
+    // coinstake and other never-relayed transactions) are prefilled rather
+    // than sent as short IDs, since peers are unlikely to have them either.
+    CBlockHeaderAndShortTxIDs(const CBlock& block, const CTxMemPool* poolIn = nullptr);
 
     uint64_t GetShortID(const uint256& txhash) const;
 
+    // Batch form: one SipHash pass over a contiguous run of tx hashes,
+    // vectorized when the CPU allows. out is resized to hashes.size().
+    void GetShortIDs(const std::vector<uint256>& hashes, std::vector<uint64_t>& out) const;
+
     size_t BlockTxCount() const { return shorttxids.size() + prefilledtxn.size(); }
 
     ADD_SERIALIZE_METHODS;
@@ -206,6 +213,133 @@ public:
     ReadStatus InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn);
     bool IsTxAvailable(size_t index) const;
     ReadStatus FillBlock(CBlock& block, const std::vector<CTransactionRef>& vtx_missing);
+    // Collect the outpoints the already-known transactions spend, skipping
+    // inputs created inside the block itself. Fed to the background coins
+    // prefetcher so ConnectBlock's UTXO reads hit a warm coins DB.
+    void GetPrefetchOutpoints(std::vector<COutPoint>& vOutpoints) const;
+};
+
+/** Delta-coded payload of the cmpcthdrs message, a drop-in replacement for
+ * headers negotiated with the NODE_COMPACT_HEADERS service bit.
+ *
+ * Consecutive headers almost always repeat nVersion and nBits, carry a
+ * timestamp close to their predecessor's, and their hashPrevBlock IS the
+ * predecessor's hash. Only the first header ships in full; every later one
+ * gets a flags byte, the merkle root, the nonce fields, and whichever of
+ * version/bits/time actually changed. The receiver restores hashPrevBlock by
+ * hashing the predecessor — work it was about to do in AcceptBlockHeader
+ * anyway, shared through the pow hash cache.
+ */
+class CompressedHeaders {
+public:
+    std::vector<CBlockHeader> headers;
+
+    //! same limit as MAX_HEADERS_RESULTS for the plain headers message
+    static const unsigned int MAX_COMPRESSED_HEADERS = 2000;
+
+    //! flag bits for every header after the first
+    static const uint8_t SAME_VERSION = 1 << 0; //!< nVersion equals the previous header's
+    static const uint8_t SAME_BITS = 1 << 1;    //!< nBits equals the previous header's
+    static const uint8_t SHORT_TIME = 1 << 2;   //!< nTime is the previous nTime plus a uint16 delta
+
+    CompressedHeaders() {}
+    explicit CompressedHeaders(const std::vector<CBlock>& vHeadersIn) : headers(vHeadersIn.begin(), vHeadersIn.end()) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        uint64_t nCount = headers.size();
+        READWRITE(COMPACTSIZE(nCount));
+        if (ser_action.ForRead()) {
+            if (nCount > MAX_COMPRESSED_HEADERS)
+                throw std::ios_base::failure("too many compressed headers");
+            headers.resize(nCount);
+        }
+        for (uint64_t i = 0; i < nCount; i++) {
+            CBlockHeader& header = headers[i];
+            if (i == 0) {
+                READWRITE(header);
+                continue;
+            }
+            const CBlockHeader& prev = headers[i - 1];
+            uint8_t nFlags = 0;
+            if (!ser_action.ForRead()) {
+                if (header.nVersion == prev.nVersion)
+                    nFlags |= SAME_VERSION;
+                if (header.nBits == prev.nBits)
+                    nFlags |= SAME_BITS;
+                ::int64_t nDelta = header.nTime - prev.nTime;
+                if (nDelta >= 0 && nDelta <= std::numeric_limits<uint16_t>::max())
+                    nFlags |= SHORT_TIME;
+            }
+            READWRITE(nFlags);
+            if (nFlags & SAME_VERSION) {
+                if (ser_action.ForRead())
+                    header.nVersion = prev.nVersion;
+            } else {
+                READWRITE(header.nVersion);
+            }
+            READWRITE(header.hashMerkleRoot);
+            if (nFlags & SHORT_TIME) {
+                uint16_t nDelta = 0;
+                if (!ser_action.ForRead())
+                    nDelta = (uint16_t)(header.nTime - prev.nTime);
+                READWRITE(nDelta);
+                if (ser_action.ForRead())
+                    header.nTime = prev.nTime + nDelta;
+            } else {
+                READWRITE(header.nTime);
+            }
+            if (nFlags & SAME_BITS) {
+                if (ser_action.ForRead())
+                    header.nBits = prev.nBits;
+            } else {
+                READWRITE(header.nBits);
+            }
+            READWRITE(header.nNonce);
+            if (header.nVersion >= VERSION_of_block_for_scrypt_adaptivepow) {
+                READWRITE(header.nNonce64);
+                READWRITE(header.hashMix);
+            }
+            if (ser_action.ForRead())
+                header.hashPrevBlock = prev.GetHash();
+        }
+    }
+};
+
+/** Payload of the bulkhdrs message: a run of consecutive headers starting at
+ * a known height, used to fast-forward header sync through checkpointed
+ * history. Headers ship in full rather than delta-coded so the receiver can
+ * hand the whole run to the batched hash calculation queue without resolving
+ * any pow hash during deserialization.
+ */
+class BulkHeaders {
+public:
+    ::int32_t nStartHeight;
+    std::vector<CBlockHeader> headers;
+
+    //! about 1.1 MB of adaptivepow headers per message, comfortably under
+    //! MAX_PROTOCOL_MESSAGE_LENGTH
+    static const unsigned int MAX_BULK_HEADERS = 10000;
+
+    BulkHeaders() : nStartHeight(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nStartHeight);
+        uint64_t nCount = headers.size();
+        READWRITE(COMPACTSIZE(nCount));
+        if (ser_action.ForRead()) {
+            if (nCount > MAX_BULK_HEADERS)
+                throw std::ios_base::failure("too many bulk headers");
+            headers.resize(nCount);
+        }
+        for (uint64_t i = 0; i < nCount; i++)
+            READWRITE(headers[i]);
+    }
 };
 
 #endif
@@ -0,0 +1,254 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+
+#include "crypto/siphash.h"
+#include "hash.h"
+#include "streams.h"
+
+#include <algorithm>
+
+/// SerType and SerVersion used for the filter encoding.
+static const int GCS_SER_TYPE = SER_NETWORK;
+static const int GCS_SER_VERSION = 0;
+
+// BIP 158 basic filter parameters
+static const uint8_t BASIC_FILTER_P = 19;
+static const uint32_t BASIC_FILTER_M = 784931;
+
+template <typename OStream>
+static void GolombRiceEncode(BitStreamWriter<OStream>& bitwriter, uint8_t P, uint64_t x)
+{
+    // Write quotient as unary-encoded: q 1's followed by one 0.
+    uint64_t q = x >> P;
+    while (q > 0) {
+        int nbits = q <= 64 ? static_cast<int>(q) : 64;
+        bitwriter.Write(~0ULL, nbits);
+        q -= nbits;
+    }
+    bitwriter.Write(0, 1);
+
+    // Write the remainder in P bits. Since the remainder is just the bottom
+    // P bits of x, there is no need to mask first.
+    bitwriter.Write(x, P);
+}
+
+template <typename IStream>
+static uint64_t GolombRiceDecode(BitStreamReader<IStream>& bitreader, uint8_t P)
+{
+    // Read unary-encoded quotient: q 1's followed by one 0.
+    uint64_t q = 0;
+    while (bitreader.Read(1) == 1) {
+        ++q;
+    }
+
+    uint64_t r = bitreader.Read(P);
+
+    return (q << P) + r;
+}
+
+// Map a value x that is uniformly distributed in the range [0, 2^64) to a
+// value uniformly distributed in [0, n) by returning the upper 64 bits of
+// x * n.
+//
+// See: https://lemire.me/blog/2016/06/27/a-fast-alternative-to-the-modulo-reduction/
+static uint64_t MapIntoRange(uint64_t x, uint64_t n)
+{
+    return ((unsigned __int128)x * (unsigned __int128)n) >> 64;
+}
+
+uint64_t GCSFilter::HashToRange(const Element& element) const
+{
+    uint64_t hash = CSipHasher(m_params.m_siphash_k0, m_params.m_siphash_k1)
+        .Write(element.data(), element.size())
+        .Finalize();
+    return MapIntoRange(hash, m_F);
+}
+
+std::vector<uint64_t> GCSFilter::BuildHashedSet(const ElementSet& elements) const
+{
+    std::vector<uint64_t> hashed_elements;
+    hashed_elements.reserve(elements.size());
+    for (ElementSet::const_iterator it = elements.begin(); it != elements.end(); ++it) {
+        hashed_elements.push_back(HashToRange(*it));
+    }
+    std::sort(hashed_elements.begin(), hashed_elements.end());
+    return hashed_elements;
+}
+
+GCSFilter::GCSFilter(const Params& params)
+    : m_params(params), m_N(0), m_F(0), m_encoded(1, 0)
+{}
+
+GCSFilter::GCSFilter(const Params& params, std::vector<unsigned char> encoded_filter)
+    : m_params(params), m_encoded(std::move(encoded_filter))
+{
+    CDataStream stream(m_encoded, GCS_SER_TYPE, GCS_SER_VERSION);
+
+    uint64_t N = ReadCompactSize(stream);
+    m_N = static_cast<uint32_t>(N);
+    if (m_N != N) {
+        throw std::ios_base::failure("N must be <2^32");
+    }
+    m_F = static_cast<uint64_t>(m_N) * static_cast<uint64_t>(m_params.m_M);
+
+    // Verify that the encoded filter contains exactly N elements. If it has
+    // too much or too little data, a std::ios_base::failure exception will be
+    // raised.
+    BitStreamReader<CDataStream> bitreader(stream);
+    for (uint64_t i = 0; i < m_N; ++i) {
+        GolombRiceDecode(bitreader, m_params.m_P);
+    }
+    if (!stream.empty()) {
+        throw std::ios_base::failure("encoded_filter contains excess data");
+    }
+}
+
+GCSFilter::GCSFilter(const Params& params, const ElementSet& elements)
+    : m_params(params)
+{
+    size_t N = elements.size();
+    m_N = static_cast<uint32_t>(N);
+    if (m_N != N) {
+        throw std::invalid_argument("N must be <2^32");
+    }
+    m_F = static_cast<uint64_t>(m_N) * static_cast<uint64_t>(m_params.m_M);
+
+    CDataStream stream(GCS_SER_TYPE, GCS_SER_VERSION);
+
+    WriteCompactSize(stream, m_N);
+
+    if (elements.empty()) {
+        m_encoded.assign(stream.begin(), stream.end());
+        return;
+    }
+
+    BitStreamWriter<CDataStream> bitwriter(stream);
+
+    uint64_t last_value = 0;
+    std::vector<uint64_t> hashed_elements = BuildHashedSet(elements);
+    for (size_t i = 0; i < hashed_elements.size(); ++i) {
+        uint64_t delta = hashed_elements[i] - last_value;
+        GolombRiceEncode(bitwriter, m_params.m_P, delta);
+        last_value = hashed_elements[i];
+    }
+
+    bitwriter.Flush();
+
+    m_encoded.assign(stream.begin(), stream.end());
+}
+
+bool GCSFilter::MatchInternal(const uint64_t* element_hashes, size_t size) const
+{
+    CDataStream stream(m_encoded, GCS_SER_TYPE, GCS_SER_VERSION);
+
+    // Seek forward by the size of N
+    uint64_t N = ReadCompactSize(stream);
+    assert(N == m_N);
+
+    BitStreamReader<CDataStream> bitreader(stream);
+
+    uint64_t value = 0;
+    size_t hashes_index = 0;
+    for (uint32_t i = 0; i < m_N; ++i) {
+        uint64_t delta = GolombRiceDecode(bitreader, m_params.m_P);
+        value += delta;
+
+        while (true) {
+            if (hashes_index == size) {
+                return false;
+            } else if (element_hashes[hashes_index] == value) {
+                return true;
+            } else if (element_hashes[hashes_index] > value) {
+                break;
+            }
+
+            hashes_index++;
+        }
+    }
+
+    return false;
+}
+
+bool GCSFilter::Match(const Element& element) const
+{
+    uint64_t query = HashToRange(element);
+    return MatchInternal(&query, 1);
+}
+
+bool GCSFilter::MatchAny(const ElementSet& elements) const
+{
+    const std::vector<uint64_t> queries = BuildHashedSet(elements);
+    return MatchInternal(queries.data(), queries.size());
+}
+
+/**
+ * Collect the filter elements for a block: every output script paid to by the
+ * block and every script spent by it, excluding empty scripts and
+ * data-carrier (OP_RETURN) outputs.
+ */
+static GCSFilter::ElementSet BasicFilterElements(const CBlock& block,
+                                                const std::vector<CScript>& vPrevoutScripts)
+{
+    GCSFilter::ElementSet elements;
+
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        const CTransaction& tx = block.vtx[i];
+        for (size_t j = 0; j < tx.vout.size(); ++j) {
+            const CScript& script = tx.vout[j].scriptPubKey;
+            if (script.empty() || script[0] == OP_RETURN) continue;
+            elements.insert(GCSFilter::Element(script.begin(), script.end()));
+        }
+    }
+
+    for (size_t i = 0; i < vPrevoutScripts.size(); ++i) {
+        const CScript& script = vPrevoutScripts[i];
+        if (script.empty()) continue;
+        elements.insert(GCSFilter::Element(script.begin(), script.end()));
+    }
+
+    return elements;
+}
+
+GCSFilter::Params BlockFilter::BasicParams(const uint256& block_hash)
+{
+    // The filter key is the first 16 bytes of the block hash, interpreted as
+    // two little-endian 64-bit integers
+    return GCSFilter::Params(block_hash.GetUint64(0), block_hash.GetUint64(1),
+                             BASIC_FILTER_P, BASIC_FILTER_M);
+}
+
+BlockFilter::BlockFilter(const uint256& block_hash, std::vector<unsigned char> filter)
+    : m_block_hash(block_hash),
+      m_filter(BasicParams(block_hash), std::move(filter))
+{}
+
+BlockFilter::BlockFilter(const uint256& block_hash, const CBlock& block,
+                         const std::vector<CScript>& vPrevoutScripts)
+    : m_block_hash(block_hash),
+      m_filter(BasicParams(block_hash), BasicFilterElements(block, vPrevoutScripts))
+{}
+
+uint256 BlockFilter::GetHash() const
+{
+    const std::vector<unsigned char>& data = GetEncodedFilter();
+
+    uint256 result;
+    CHash256().Write(data.data(), data.size()).Finalize(result.begin());
+    return result;
+}
+
+uint256 BlockFilter::ComputeHeader(const uint256& prev_header) const
+{
+    const uint256 filter_hash = GetHash();
+
+    uint256 result;
+    CHash256()
+        .Write(filter_hash.begin(), filter_hash.size())
+        .Write(prev_header.begin(), prev_header.size())
+        .Finalize(result.begin());
+    return result;
+}
@@ -50,19 +50,28 @@ CBloomFilter::CBloomFilter(const unsigned int nElements, const double nFPRate, c
 {
 }
 
-inline unsigned int CBloomFilter::Hash(unsigned int nHashNum, const std::vector<unsigned char>& vDataToHash) const
+void CBloomFilter::HashAll(const std::vector<unsigned char>& vDataToHash, unsigned int* pnIndexOut) const
 {
-    // 0xFBA4C795 chosen as it guarantees a reasonable bit difference between nHashNum values.
-    return MurmurHash3(nHashNum * 0xFBA4C795 + nTweak, vDataToHash) % (vData.size() * 8);
+    uint32_t anSeeds[MAX_HASH_FUNCS];
+    uint32_t anHashes[MAX_HASH_FUNCS];
+    for (unsigned int i = 0; i < nHashFuncs; i++)
+        // 0xFBA4C795 chosen as it guarantees a reasonable bit difference between nHashNum values.
+        anSeeds[i] = i * 0xFBA4C795 + nTweak;
+    // One pass over the data serves all hash functions
+    MurmurHash3Many(anSeeds, nHashFuncs, vDataToHash, anHashes);
+    for (unsigned int i = 0; i < nHashFuncs; i++)
+        pnIndexOut[i] = anHashes[i] % (vData.size() * 8);
 }
 
 void CBloomFilter::insert(const std::vector<unsigned char>& vKey)
 {
     if (isFull)
         return;
+    unsigned int anIndex[MAX_HASH_FUNCS];
+    HashAll(vKey, anIndex);
     for (unsigned int i = 0; i < nHashFuncs; i++)
     {
-        unsigned int nIndex = Hash(i, vKey);
+        unsigned int nIndex = anIndex[i];
         // Sets bit nIndex of vData
         vData[nIndex >> 3] |= (1 << (7 & nIndex));
     }
@@ -89,9 +98,11 @@ bool CBloomFilter::contains(const std::vector<unsigned char>& vKey) const
         return true;
     if (isEmpty)
         return false;
+    unsigned int anIndex[MAX_HASH_FUNCS];
+    HashAll(vKey, anIndex);
     for (unsigned int i = 0; i < nHashFuncs; i++)
     {
-        unsigned int nIndex = Hash(i, vKey);
+        unsigned int nIndex = anIndex[i];
         // Checks bit nIndex of vData
         if (!(vData[nIndex >> 3] & (1 << (7 & nIndex))))
             return false;
@@ -131,61 +142,32 @@ bool CBloomFilter::IsWithinSizeConstraints() const
     return vData.size() <= MAX_BLOOM_FILTER_SIZE && nHashFuncs <= MAX_HASH_FUNCS;
 }
 
-bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx)
+CTxBloomElements::CTxBloomElements(const CTransaction& tx)
 {
-    bool fFound = false;
-    // Match if the filter contains the hash of tx
-    //  for finding tx when they appear in a block
-    if (isFull)
-        return true;
-    if (isEmpty)
-        return false;
     const uint256& hash = tx.GetHash();
-    if (contains(hash))
-        fFound = true;
+    vHash.assign(hash.begin(), hash.end());
 
     for (unsigned int i = 0; i < tx.vout.size(); i++)
     {
-        const CTxOut& txout = tx.vout[i];
-        // Match if the filter contains any arbitrary script data element in any scriptPubKey in tx
-        // If this matches, also add the specific output that was matched.
-        // This means clients don't have to update the filter themselves when a new relevant tx 
-        // is discovered in order to find spending transactions, which avoids round-tripping and race conditions.
-        CScript::const_iterator pc = txout.scriptPubKey.begin();
+        CScript::const_iterator pc = tx.vout[i].scriptPubKey.begin();
         std::vector<unsigned char> data;
-        while (pc < txout.scriptPubKey.end())
+        while (pc < tx.vout[i].scriptPubKey.end())
         {
             opcodetype opcode;
-            if (!txout.scriptPubKey.GetOp(pc, opcode, data))
-                break;
-            if (data.size() != 0 && contains(data))
-            {
-                fFound = true;
-                if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_ALL)
-                    insert(COutPoint(hash, i));
-                else if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_P2PUBKEY_ONLY)
-                {
-                    txnouttype type;
-                    std::vector<std::vector<unsigned char> > vSolutions;
-                    if (Solver(txout.scriptPubKey, type, vSolutions) &&
-                            (type == TX_PUBKEY || type == TX_MULTISIG))
-                        insert(COutPoint(hash, i));
-                }
+            if (!tx.vout[i].scriptPubKey.GetOp(pc, opcode, data))
                 break;
-            }
+            if (data.size() != 0)
+                vOutputElements.push_back(std::make_pair(i, data));
         }
     }
 
-    if (fFound)
-        return true;
-
+    vPrevOuts.reserve(tx.vin.size());
     for (const CTxIn& txin : tx.vin)
     {
-        // Match if the filter contains an outpoint tx spends
-        if (contains(txin.prevout))
-            return true;
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << txin.prevout;
+        vPrevOuts.push_back(std::vector<unsigned char>(stream.begin(), stream.end()));
 
-        // Match if the filter contains any arbitrary script data element in any scriptSig in tx
         CScript::const_iterator pc = txin.scriptSig.begin();
         std::vector<unsigned char> data;
         while (pc < txin.scriptSig.end())
@@ -193,11 +175,75 @@ bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx)
             opcodetype opcode;
             if (!txin.scriptSig.GetOp(pc, opcode, data))
                 break;
-            if (data.size() != 0 && contains(data))
-                return true;
+            if (data.size() != 0)
+                vInputElements.push_back(data);
+        }
+    }
+}
+
+bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx)
+{
+    // Decide trivial filters before paying for the element extraction
+    if (isFull)
+        return true;
+    if (isEmpty)
+        return false;
+    return IsRelevantAndUpdate(tx, CTxBloomElements(tx));
+}
+
+bool CBloomFilter::IsRelevantAndUpdate(const CTransaction& tx, const CTxBloomElements& elements)
+{
+    bool fFound = false;
+    // Match if the filter contains the hash of tx
+    //  for finding tx when they appear in a block
+    if (isFull)
+        return true;
+    if (isEmpty)
+        return false;
+    const uint256& hash = tx.GetHash();
+    if (contains(elements.vHash))
+        fFound = true;
+
+    // Match if the filter contains any arbitrary script data element in any scriptPubKey in tx
+    // If this matches, also add the specific output that was matched.
+    // This means clients don't have to update the filter themselves when a new relevant tx
+    // is discovered in order to find spending transactions, which avoids round-tripping and race conditions.
+    unsigned int nMatchedOut = tx.vout.size();
+    for (const std::pair<unsigned int, std::vector<unsigned char> >& element : elements.vOutputElements)
+    {
+        // Only the first matching element of each output triggers an update
+        if (element.first == nMatchedOut)
+            continue;
+        if (contains(element.second))
+        {
+            fFound = true;
+            nMatchedOut = element.first;
+            if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_ALL)
+                insert(COutPoint(hash, element.first));
+            else if ((nFlags & BLOOM_UPDATE_MASK) == BLOOM_UPDATE_P2PUBKEY_ONLY)
+            {
+                txnouttype type;
+                std::vector<std::vector<unsigned char> > vSolutions;
+                if (Solver(tx.vout[element.first].scriptPubKey, type, vSolutions) &&
+                        (type == TX_PUBKEY || type == TX_MULTISIG))
+                    insert(COutPoint(hash, element.first));
+            }
         }
     }
 
+    if (fFound)
+        return true;
+
+    // Match if the filter contains an outpoint tx spends
+    for (const std::vector<unsigned char>& prevout : elements.vPrevOuts)
+        if (contains(prevout))
+            return true;
+
+    // Match if the filter contains any arbitrary script data element in any scriptSig in tx
+    for (const std::vector<unsigned char>& element : elements.vInputElements)
+        if (contains(element))
+            return true;
+
     return false;
 }
 
@@ -10,6 +10,8 @@
 
 #include <vector>
 
+#include <utility>
+
 class COutPoint;
 class CTransaction;
 class uint256;
@@ -31,6 +33,29 @@ enum bloomflags
     BLOOM_UPDATE_MASK = 3,
 };
 
+/**
+ * The matchable elements of a transaction, extracted once so that the same
+ * transaction can be tested against many peer filters without re-parsing its
+ * scripts per peer. Matching against a cached extraction gives the same
+ * answer as CBloomFilter::IsRelevantAndUpdate(tx) walking the scripts itself.
+ */
+class CTxBloomElements
+{
+public:
+    explicit CTxBloomElements(const CTransaction& tx);
+
+private:
+    friend class CBloomFilter;
+    //! txid bytes
+    std::vector<unsigned char> vHash;
+    //! data elements pushed by each scriptPubKey, tagged with the output index
+    std::vector<std::pair<unsigned int, std::vector<unsigned char> > > vOutputElements;
+    //! serialized prevouts spent by the transaction
+    std::vector<std::vector<unsigned char> > vPrevOuts;
+    //! data elements pushed by the scriptSigs
+    std::vector<std::vector<unsigned char> > vInputElements;
+};
+
 /**
  * BloomFilter is a probabilistic filter which SPV clients provide
  * so that we can filter the transactions we send them.
@@ -52,7 +77,9 @@ private:
     unsigned int nTweak;
     unsigned char nFlags;
 
-    unsigned int Hash(unsigned int nHashNum, const std::vector<unsigned char>& vDataToHash) const;
+    //! Compute all nHashFuncs bit positions for an element in a single pass
+    //! over its bytes; pnIndexOut must have room for nHashFuncs entries
+    void HashAll(const std::vector<unsigned char>& vDataToHash, unsigned int* pnIndexOut) const;
 
     // Private constructor for CRollingBloomFilter, no restrictions on size
     CBloomFilter(const unsigned int nElements, const double nFPRate, const unsigned int nTweak);
@@ -96,9 +123,17 @@ public:
     //! (catch a filter which was just deserialized which was too big)
     bool IsWithinSizeConstraints() const;
 
+    //! True if matching can be decided without hashing anything (the filter is
+    //! degenerate full or empty, e.g. the default filter every peer starts with)
+    bool IsTrivial() const { return isFull || isEmpty; }
+
     //! Also adds any outputs which match the filter to the filter (to match their spending txes)
     bool IsRelevantAndUpdate(const CTransaction& tx);
 
+    //! Same as above but matches against a cached element extraction, so the
+    //! transaction's scripts are parsed once however many filters it is tested against
+    bool IsRelevantAndUpdate(const CTransaction& tx, const CTxBloomElements& elements);
+
     //! Checks for empty and full filters to avoid wasting cpu
     void UpdateEmptyFull();
 };
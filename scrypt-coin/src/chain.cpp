@@ -9,6 +9,117 @@
 #include "consensus/consensus.h"
 #include "validation.h"
 
+#include <list>
+#include <map>
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// Cold block-index field store
+//
+// The fields in CBlockIndexColdData are written once when a block connects
+// and then essentially never read again outside of RPC/explorer queries,
+// yet used to sit resident in every mapBlockIndex entry. They now live
+// here: a bounded cache in front of the block tree DB record. Entries
+// whose fields have not been flushed to disk yet are dirty and pinned;
+// clean entries are evicted in LRU order once the cache is full.
+//
+
+static CCriticalSection cs_coldIndex;
+
+namespace {
+struct ColdIndexEntry
+{
+    CBlockIndexColdData data;
+    bool fDirty;
+    std::list<const CBlockIndex*>::iterator itLru; // valid only when clean
+};
+} // anon namespace
+
+//! Bounded number of clean entries kept in memory; dirty entries are
+//! pinned on top of this until WriteBatchSync persists them
+static const size_t nColdIndexCacheSize = 4096;
+
+static std::map<const CBlockIndex*, ColdIndexEntry> mapColdIndex;
+//! Clean entries only, most recently used at the front
+static std::list<const CBlockIndex*> listColdIndexLru;
+static ColdIndexLoader pfnColdIndexLoader = nullptr;
+
+void RegisterColdIndexLoader(ColdIndexLoader loader)
+{
+    LOCK(cs_coldIndex);
+    pfnColdIndexLoader = loader;
+}
+
+static void ColdIndexTrim()
+{
+    // caller holds cs_coldIndex
+    while (listColdIndexLru.size() > nColdIndexCacheSize) {
+        const CBlockIndex* pevict = listColdIndexLru.back();
+        listColdIndexLru.pop_back();
+        mapColdIndex.erase(pevict);
+    }
+}
+
+CBlockIndexColdData CBlockIndex::GetColdData() const
+{
+    LOCK(cs_coldIndex);
+    std::map<const CBlockIndex*, ColdIndexEntry>::iterator mi = mapColdIndex.find(this);
+    if (mi != mapColdIndex.end()) {
+        if (!mi->second.fDirty)
+            listColdIndexLru.splice(listColdIndexLru.begin(), listColdIndexLru, mi->second.itLru);
+        return mi->second.data;
+    }
+
+    CBlockIndexColdData cold;
+    if (pfnColdIndexLoader && phashBlock && pfnColdIndexLoader(*phashBlock, cold)) {
+        ColdIndexEntry& entry = mapColdIndex[this];
+        entry.data = cold;
+        entry.fDirty = false;
+        listColdIndexLru.push_front(this);
+        entry.itLru = listColdIndexLru.begin();
+        ColdIndexTrim();
+    }
+    // no record anywhere yet: the defaults from SetNull() are what the
+    // removed member fields used to hold for a fresh entry
+    return cold;
+}
+
+void CBlockIndex::SetColdData(const CBlockIndexColdData& cold)
+{
+    LOCK(cs_coldIndex);
+    std::map<const CBlockIndex*, ColdIndexEntry>::iterator mi = mapColdIndex.find(this);
+    if (mi != mapColdIndex.end()) {
+        if (!mi->second.fDirty) // was clean: unpin from the LRU list
+            listColdIndexLru.erase(mi->second.itLru);
+        mi->second.data = cold;
+        mi->second.fDirty = true;
+        return;
+    }
+    ColdIndexEntry& entry = mapColdIndex[this];
+    entry.data = cold;
+    entry.fDirty = true;
+    entry.itLru = listColdIndexLru.end(); // unused while dirty
+}
+
+void UnloadColdIndexData()
+{
+    LOCK(cs_coldIndex);
+    mapColdIndex.clear();
+    listColdIndexLru.clear();
+}
+
+void CBlockIndex::ColdDataWritten() const
+{
+    LOCK(cs_coldIndex);
+    std::map<const CBlockIndex*, ColdIndexEntry>::iterator mi = mapColdIndex.find(this);
+    if (mi == mapColdIndex.end() || !mi->second.fDirty)
+        return;
+    mi->second.fDirty = false;
+    listColdIndexLru.push_front(this);
+    mi->second.itLru = listColdIndexLru.begin();
+    ColdIndexTrim();
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // CChain implementation
@@ -50,7 +161,7 @@ CBlockLocator CChain::GetLocator(const CBlockIndex *pindex) const {
             nStep *= 2;
     }
 
-    return CBlockLocator(vHave);
+    return CBlockLocator(std::move(vHave));
 }
 
 const CBlockIndex *CChain::FindFork(const CBlockIndex *pindex) const {
@@ -99,8 +210,22 @@ CBigNum CBlockIndex::GetBlockTrust() const
         // PoW trust calculation
         if (IsProofOfWork())
         {
-            // set trust to the amount of work done in this block
-            CBigNum bnTrust = bnProofOfWorkLimit / bnTarget;
+            // set trust to the amount of work done in this block; runs of
+            // blocks share nBits, so cache the last division by target
+            static CCriticalSection cs_trustCache;
+            static uint32_t nBitsTrustCached = 0;
+            static CBigNum bnTrustCached;
+            CBigNum bnTrust;
+            {
+                LOCK(cs_trustCache);
+                if (nBits == nBitsTrustCached) {
+                    bnTrust = bnTrustCached;
+                } else {
+                    bnTrust = bnProofOfWorkLimit / bnTarget;
+                    nBitsTrustCached = nBits;
+                    bnTrustCached = bnTrust;
+                }
+            }
 
             // double the trust if previous block was PoS
             // (to prevent orphaning of PoS)
@@ -178,11 +303,21 @@ arith_uint256 GetBlockProof(const CBlockIndex& block)
     bnTarget.SetCompact(block.nBits, &fNegative, &fOverflow);
     if (fNegative || fOverflow || bnTarget == 0)
         return 0;
+    // The work delta only depends on nBits, and consecutive blocks
+    // overwhelmingly share it, so remember the last division.
+    static CCriticalSection cs_proofCache;
+    static uint32_t nBitsProofCached = 0;
+    static arith_uint256 bnProofCached;
+    LOCK(cs_proofCache);
+    if (block.nBits == nBitsProofCached)
+        return bnProofCached;
     // We need to compute 2**256 / (bnTarget+1), but we can't represent 2**256
     // as it's too large for an arith_uint256. However, as 2**256 is at least as large
     // as bnTarget+1, it is equal to ((2**256 - bnTarget - 1) / (bnTarget+1)) + 1,
     // or ~bnTarget / (nTarget+1) + 1.
-    return (~bnTarget / (bnTarget + 1)) + 1;
+    bnProofCached = (~bnTarget / (bnTarget + 1)) + 1;
+    nBitsProofCached = block.nBits;
+    return bnProofCached;
 }
 
 int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& from, const CBlockIndex& tip, const Consensus::Params& params)
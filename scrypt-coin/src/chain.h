@@ -178,6 +178,48 @@ enum BlockStatus: uint32_t {
     BLOCK_FAILED_MASK        =   BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
 };
 
+/** Cold block-index fields: the PoS/supply bookkeeping that is written
+ * once when a block connects and then almost never read again (RPC
+ * queries, the explorer, stake checksum recomputation). Keeping a copy
+ * resident for every entry in mapBlockIndex costs ~90 bytes per block,
+ * so these live in a small LRU-managed side store (chain.cpp) and are
+ * reloaded from the block tree DB record on demand; only entries not yet
+ * flushed to disk are pinned in memory. */
+struct CBlockIndexColdData
+{
+    ::int64_t nMint;
+    ::int64_t nMoneySupply;
+
+    // proof-of-stake specific fields
+    COutPoint prevoutStake;
+    ::uint32_t nStakeTime;
+    uint256 hashProofOfStake;
+
+    void SetNull()
+    {
+        nMint = 0;
+        nMoneySupply = INITIAL_MONEY_SUPPLY;
+        prevoutStake.SetNull();
+        nStakeTime = 0;
+        hashProofOfStake = 0;
+    }
+
+    CBlockIndexColdData()
+    {
+        SetNull();
+    }
+};
+
+/** Loader used by the cold-field store on a cache miss; installed by the
+ * block tree DB once it is open (txdb.cpp). Returns false when the block
+ * has no record on disk yet. */
+typedef bool (*ColdIndexLoader)(const uint256& hashBlock, CBlockIndexColdData& cold);
+void RegisterColdIndexLoader(ColdIndexLoader loader);
+
+/** Drop every cached cold-field entry. Must accompany any wholesale
+ * deletion of mapBlockIndex (the store is keyed by index pointers). */
+void UnloadColdIndexData();
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -210,6 +252,12 @@ public:
     //! (memory only) Total amount of work in the chain up to and including this block
     CBigNum bnChainTrust; // ppcoin: trust score of block chain
 
+    //! (memory only) Order-preserving 64-bit projection of bnChainTrust: the
+    //! bit length in the top 16 bits, the leading 48 bits of the value below.
+    //! Chainwork comparators check this first and only fall back to the full
+    //! OpenSSL compare when the projections tie. Set via SetChainTrust().
+    ::uint64_t nChainTrustKey;
+
     //! Number of transactions in this block.
     //! Note: in a potential headers-first mode, this number cannot be relied upon
     unsigned int nTx;
@@ -236,9 +284,6 @@ public:
     //! (memory only) Maximum nTime in the chain up to and including this block.
     ::int64_t nTimeMax;
 
-    //! (memory only)
-    ::int64_t nMint;
-    ::int64_t nMoneySupply;
     ::uint32_t nFlags;  // ppcoin: block index flags
 
     enum
@@ -251,11 +296,6 @@ public:
     ::uint64_t nStakeModifier; // hash modifier for proof-of-stake
     ::uint32_t nStakeModifierChecksum; // checksum of index; in-memory only
 
-    // proof-of-stake specific fields
-    COutPoint prevoutStake;
-    ::uint32_t nStakeTime;
-    uint256 hashProofOfStake;
-
 public:
     void SetNull()
     {
@@ -267,8 +307,7 @@ public:
         nDataPos = 0;
         nUndoPos = 0;
         bnChainTrust = CBigNum(0);
-        nMint = 0;
-        nMoneySupply = INITIAL_MONEY_SUPPLY;
+        nChainTrustKey = 0;
         nTx = 0;
         nChainTx = 0;
         nStatus = 0;
@@ -278,9 +317,6 @@ public:
         nFlags = 0;
         nStakeModifier = 0;
         nStakeModifierChecksum = 0;
-        hashProofOfStake = 0;
-        prevoutStake.SetNull();
-        nStakeTime = 0;
 
         nVersion       = 0;
         hashMerkleRoot = uint256();
@@ -311,6 +347,24 @@ public:
         blockHash      = blockHeader.blockHash;
     }
 
+    //! Assign the cumulative chain trust and refresh its 64-bit projection.
+    //! Ordering holds because a longer bit length always means a larger value,
+    //! and equal bit lengths compare correctly on their leading 48 bits.
+    void SetChainTrust(const CBigNum& bnTrust)
+    {
+        bnChainTrust = bnTrust;
+        const int nTrustBits = bnChainTrust.bitSize();
+        ::uint64_t nTop;
+        if (nTrustBits > 48) {
+            CBigNum bnTop = bnChainTrust;
+            bnTop >>= (unsigned int)(nTrustBits - 48);
+            nTop = bnTop.getuint64();
+        } else {
+            nTop = bnChainTrust.getuint64();
+        }
+        nChainTrustKey = ((::uint64_t)nTrustBits << 48) | nTop;
+    }
+
     CDiskBlockPos GetBlockPos() const {
         CDiskBlockPos ret;
         if (nStatus & BLOCK_HAVE_DATA) {
@@ -375,6 +429,7 @@ public:
 
     std::string ToString() const
     {
+        const CBlockIndexColdData cold = GetColdData();
         return strprintf(
                          "CBlockIndex(pprev=%p, nFile=%u, "
                          "nHeight=%d, nMint=%s, nMoneySupply=%s, nFlags=(%s)(%d)(%s), "
@@ -382,11 +437,11 @@ public:
                          "hashProofOfStake=%s, prevoutStake=(%s), nStakeTime=%d merkle=%s, "
                          "hashBlock=%s)",
                          pprev, nFile, nHeight,
-                         FormatMoney(nMint).c_str(), FormatMoney(nMoneySupply).c_str(),
+                         FormatMoney(cold.nMint).c_str(), FormatMoney(cold.nMoneySupply).c_str(),
                          GeneratedStakeModifier() ? "MOD" : "-", GetStakeEntropyBit(), IsProofOfStake()? "PoS" : "PoW",
                          nStakeModifier, nStakeModifierChecksum,
-                         hashProofOfStake.ToString().c_str(),
-                         prevoutStake.ToString().c_str(), nStakeTime,
+                         cold.hashProofOfStake.ToString().c_str(),
+                         cold.prevoutStake.ToString().c_str(), cold.nStakeTime,
                          hashMerkleRoot.ToString().c_str(),
                          GetBlockHash().ToString().c_str()
                         );
@@ -470,6 +525,36 @@ public:
         if (fGeneratedStakeModifier)
             nFlags |= BLOCK_STAKE_MODIFIER;
     }
+
+    //! Cold-field accessors. These go through the side store in chain.cpp:
+    //! a miss reloads the fields from this block's tree DB record, so they
+    //! are returned by value (the cached entry may be evicted at any time).
+    CBlockIndexColdData GetColdData() const;
+    void SetColdData(const CBlockIndexColdData& cold);
+    //! Mark this entry's cold fields as persisted; until then they are
+    //! pinned in the store and never evicted (called from WriteBatchSync)
+    void ColdDataWritten() const;
+
+    ::int64_t GetMint() const { return GetColdData().nMint; }
+    ::int64_t GetMoneySupply() const { return GetColdData().nMoneySupply; }
+    COutPoint GetPrevoutStake() const { return GetColdData().prevoutStake; }
+    ::uint32_t GetStakeTime() const { return GetColdData().nStakeTime; }
+    uint256 GetHashProofOfStake() const { return GetColdData().hashProofOfStake; }
+
+    void SetMoneySupplyStats(::int64_t nMintIn, ::int64_t nMoneySupplyIn)
+    {
+        CBlockIndexColdData cold = GetColdData();
+        cold.nMint = nMintIn;
+        cold.nMoneySupply = nMoneySupplyIn;
+        SetColdData(cold);
+    }
+
+    void SetHashProofOfStake(const uint256& hashProof)
+    {
+        CBlockIndexColdData cold = GetColdData();
+        cold.hashProofOfStake = hashProof;
+        SetColdData(cold);
+    }
     // yac: Specific for YAC END
 
     bool IsInMainChain() const;
@@ -492,12 +577,17 @@ class CDiskBlockIndex : public CBlockIndex
 public:
     uint256 hashPrev;
 
+    //! On-disk copies of the cold fields; the in-memory CBlockIndex keeps
+    //! these in the side store instead of carrying them per entry
+    CBlockIndexColdData cold;
+
     CDiskBlockIndex() {
         hashPrev = uint256();
     }
 
     explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
+        cold = pindex->GetColdData();
     }
 
     ADD_SERIALIZE_METHODS;
@@ -520,21 +610,21 @@ public:
             READWRITE(VARINT(nUndoPos));
 
         // BEGIN: Specific for YAC
-        READWRITE(nMint);
-        READWRITE(nMoneySupply);
+        READWRITE(cold.nMint);
+        READWRITE(cold.nMoneySupply);
         READWRITE(nFlags);
         READWRITE(nStakeModifier);
         if (IsProofOfStake())
         {
-            READWRITE(prevoutStake);
-            READWRITE(nStakeTime);
-            READWRITE(hashProofOfStake);
+            READWRITE(cold.prevoutStake);
+            READWRITE(cold.nStakeTime);
+            READWRITE(cold.hashProofOfStake);
         }
         else if (ser_action.ForRead())
         {
-            const_cast<CDiskBlockIndex*>(this)->prevoutStake.SetNull();
-            const_cast<CDiskBlockIndex*>(this)->nStakeTime = 0;
-            const_cast<CDiskBlockIndex*>(this)->hashProofOfStake = 0;
+            const_cast<CDiskBlockIndex*>(this)->cold.prevoutStake.SetNull();
+            const_cast<CDiskBlockIndex*>(this)->cold.nStakeTime = 0;
+            const_cast<CDiskBlockIndex*>(this)->cold.hashProofOfStake = 0;
         }
         // END: Specific for YAC
 
@@ -606,6 +696,9 @@ public:
     uint256 hashPrev;
     uint256 hashNext;
 
+    //! On-disk copies of the cold fields (see CDiskBlockIndex)
+    CBlockIndexColdData cold;
+
     CDiskBlockIndexOld()
     {
         hashPrev = 0;
@@ -616,6 +709,7 @@ public:
     {
         hashPrev = (pprev ? pprev->GetBlockHash() : 0);
         hashNext = 0;
+        cold = pindex->GetColdData();
     }
 
     ADD_SERIALIZE_METHODS;
@@ -630,21 +724,21 @@ public:
         READWRITE(nFile);
         READWRITE(nDataPos);
         READWRITE(nHeight);
-        READWRITE(nMint);
-        READWRITE(nMoneySupply);
+        READWRITE(cold.nMint);
+        READWRITE(cold.nMoneySupply);
         READWRITE(nFlags);
         READWRITE(nStakeModifier);
         if (IsProofOfStake())
         {
-            READWRITE(prevoutStake);
-            READWRITE(nStakeTime);
-            READWRITE(hashProofOfStake);
+            READWRITE(cold.prevoutStake);
+            READWRITE(cold.nStakeTime);
+            READWRITE(cold.hashProofOfStake);
         }
         else if (ser_action.ForRead())
         {
-            const_cast<CDiskBlockIndexOld*>(this)->prevoutStake.SetNull();
-            const_cast<CDiskBlockIndexOld*>(this)->nStakeTime = 0;
-            const_cast<CDiskBlockIndexOld*>(this)->hashProofOfStake = 0;
+            const_cast<CDiskBlockIndexOld*>(this)->cold.prevoutStake.SetNull();
+            const_cast<CDiskBlockIndexOld*>(this)->cold.nStakeTime = 0;
+            const_cast<CDiskBlockIndexOld*>(this)->cold.hashProofOfStake = 0;
         }
 
         // block header
@@ -771,5 +865,56 @@ public:
     CBlockIndex* FindEarliestAtLeast(int64_t nTime) const;
 };
 
+/** An immutable, lock-free view of the active chain as of one tip.
+ *
+ * A snapshot is nothing more than a tip pointer: CBlockIndex entries are
+ * never freed and their pprev/pskip/nHeight fields never change once the
+ * entry is in mapBlockIndex, so every by-height lookup can be answered from
+ * the tip through the skiplist (GetAncestor) without touching cs_main. The
+ * tip pointer itself is published with an atomic store after every
+ * chainActive.SetTip (see GetChainSnapshot in validation.h), so readers see
+ * either the old chain or the new one, never a half-updated state.
+ *
+ * Lookups cost O(log height) instead of CChain's O(1), which is the price
+ * of not copying the height vector on every tip change.
+ */
+class CChainSnapshot {
+private:
+    const CBlockIndex* pindexTip;
+
+public:
+    explicit CChainSnapshot(const CBlockIndex* pindexTipIn) : pindexTip(pindexTipIn) {}
+
+    /** Returns the index entry for the tip of this view, or nullptr if none. */
+    const CBlockIndex* Tip() const {
+        return pindexTip;
+    }
+
+    /** Returns the index entry at a particular height in this view, or nullptr if no such height exists. */
+    const CBlockIndex* operator[](int nHeight) const {
+        if (pindexTip == nullptr || nHeight < 0 || nHeight > pindexTip->nHeight)
+            return nullptr;
+        return pindexTip->GetAncestor(nHeight);
+    }
+
+    /** Efficiently check whether a block is present in this view. */
+    bool Contains(const CBlockIndex* pindex) const {
+        return (*this)[pindex->nHeight] == pindex;
+    }
+
+    /** Find the successor of a block in this view, or nullptr if the given index is not found or is the tip. */
+    const CBlockIndex* Next(const CBlockIndex* pindex) const {
+        if (Contains(pindex))
+            return (*this)[pindex->nHeight + 1];
+        else
+            return nullptr;
+    }
+
+    /** Return the maximal height in the view. Is equal to snapshot.Tip() ? snapshot.Tip()->nHeight : -1. */
+    int Height() const {
+        return pindexTip ? pindexTip->nHeight : -1;
+    }
+};
+
 CBlockIndex* FindBlockByHeight(int nHeight);
 #endif // YACOIN_CHAIN_H
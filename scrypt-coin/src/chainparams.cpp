@@ -20,7 +20,10 @@
 
 #include "chainparamsseeds.h"
 
-// Multi-threaded genesis block mining helper
+#ifdef MINE_GENESIS_BLOCK
+// Multi-threaded genesis block mining helper. Only compiled into dedicated
+// mining builds (-DMINE_GENESIS_BLOCK); production nodes use the pinned
+// constants below instead.
 static std::atomic<bool> g_found{false};
 static std::atomic<uint32_t> g_foundNonce{0};
 static uint256 g_foundHash;
@@ -92,6 +95,7 @@ static void MineGenesisBlock(CBlock& genesis, const arith_uint256& bnTarget)
         printf("Nonce space exhausted! Need to change timestamp.\n");
     }
 }
+#endif // MINE_GENESIS_BLOCK
 
 //
 // SCRYPT COIN - A new cryptocurrency with AdaptivePow
@@ -206,18 +210,28 @@ public:
         // Genesis block - easy difficulty for instant mining
         genesis = CreateGenesisBlock(nGenesisTime, nGenesisNonce, 0x207fffff, 1);
 
+#ifdef MINE_GENESIS_BLOCK
         // Mine genesis if nonce is placeholder (0)
         if (nGenesisNonce == 0) {
             arith_uint256 genesisTarget;
             genesisTarget.SetCompact(0x207fffff);
             MineGenesisBlock(genesis, genesisTarget);
         }
-
-        consensus.hashGenesisBlock = genesis.GetHash();
-
-        // These assertions will fail until genesis is mined
-        // assert(consensus.hashGenesisBlock == hashGenesisBlock);
-        // assert(genesis.hashMerkleRoot == hashGenesisMerkleRoot);
+#endif
+
+        if (!hashGenesisBlock.IsNull()) {
+            // Trust the pinned constants instead of recomputing the genesis
+            // pow hash on every process start. The merkle root is a cheap
+            // SHA256d, so it stays a hard assert; the pow hash is re-derived
+            // at most once per process by VerifyGenesisBlock(), before a
+            // fresh datadir writes genesis to disk.
+            assert(genesis.hashMerkleRoot == hashGenesisMerkleRoot);
+            consensus.hashGenesisBlock = hashGenesisBlock;
+        } else {
+            // Placeholder constants (pre-launch): derive the hash here, as
+            // MINE_GENESIS_BLOCK builds do
+            consensus.hashGenesisBlock = genesis.GetHash();
+        }
 
         // DNS seeds - to be added
         vSeeds.clear();
@@ -410,6 +424,19 @@ public:
     }
 };
 
+bool CChainParams::VerifyGenesisBlock() const
+{
+    // Re-deriving the hash costs a full pow hash at the genesis N-factor,
+    // so run it at most once per process
+    static bool fGenesisVerified = false;
+    if (fGenesisVerified)
+        return true;
+    if (genesis.GetHash() != consensus.hashGenesisBlock)
+        return false;
+    fGenesisVerified = true;
+    return true;
+}
+
 static std::unique_ptr<CChainParams> globalChainParams;
 
 const CChainParams &Params() {
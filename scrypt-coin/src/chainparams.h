@@ -63,6 +63,10 @@ public:
     int GetDefaultPort() const { return nDefaultPort; }
 
     const CBlock& GenesisBlock() const { return genesis; }
+    /** Re-derive the genesis pow hash and check it against the compiled-in
+     * constant. Expensive, so it runs at most once per process; called
+     * before a fresh datadir writes genesis to disk. */
+    bool VerifyGenesisBlock() const;
     /** Default value for -checkmempool and -checkblockindex argument */
     bool DefaultConsistencyChecks() const { return fDefaultConsistencyChecks; }
     /** Policy: Filter transactions that do not match well-defined patterns */
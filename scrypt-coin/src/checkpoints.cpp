@@ -114,6 +114,12 @@ namespace Checkpoints
         return checkpoints.rbegin()->second.second;
     }
 
+    const uint256& GetLastCheckpointHash()
+    {
+        MapCheckpoints& checkpoints = mapCheckpoints;
+        return checkpoints.rbegin()->second.first;
+    }
+
     CBlockIndex* GetLastCheckpoint(const BlockMap& mapBlockIndex)
     {
         MapCheckpoints& checkpoints = mapCheckpoints;
@@ -42,6 +42,9 @@ namespace Checkpoints
 
     // Returns last checkpoint timestamp
     unsigned int GetLastCheckpointTime();
+
+    // Returns last checkpoint block hash (the default -assumevalid block)
+    const uint256& GetLastCheckpointHash();
 }
 
 #endif
@@ -6,6 +6,7 @@
 #define CHECKQUEUE_H
 
 #include <algorithm>
+#include <deque>
 #include <vector>
 
 #include <boost/foreach.hpp>
@@ -24,10 +25,25 @@ template<typename T> class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Work is distributed over per-worker deques. A worker pops batches from
+  * the back of its own deque and, only when that runs dry, steals from the
+  * front of another worker's deque. The global mutex is limited to worker
+  * registration and sleep/wakeup, so throughput keeps scaling when many
+  * verification threads are configured instead of serializing on a single
+  * queue lock.
   */
 template<typename T> class CCheckQueue {
 private:
-    // Mutex to protect the inner state
+    // A per-worker slice of the queue. Other workers may steal from the
+    // front, so every slice carries its own (rarely contended) lock.
+    struct CWorkShard
+    {
+        boost::mutex mutex;
+        std::deque<T> jobs;
+    };
+
+    // Mutex to protect the control state (registration and sleep/wakeup)
     boost::mutex mutex;
 
     // Worker threads block on this when out of work
@@ -39,9 +55,18 @@ private:
     // Quit method blocks on this until all workers are gone
     boost::condition_variable condQuit;
 
-    // The queue of elements to be processed.
-    // As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    // One shard per worker; preallocated so lock-free indexing by other
+    // workers never races with reallocation. Indices of workers that left
+    // Loop() are recycled through vFreeShards.
+    std::vector<CWorkShard*> vShards;
+    std::vector<unsigned int> vFreeShards;
+
+    // Highest shard index ever handed out, plus one. Add() and stealing
+    // only look at shards below this mark.
+    boost::atomic<unsigned int> nShardsUsed;
+
+    // Round-robin cursor used by Add() to spread batches over the shards.
+    unsigned int nPushShard;
 
     // The number of workers (including the master) that are idle.
     int nIdle;
@@ -50,127 +75,218 @@ private:
     boost::atomic<int> nTotal;
 
     // The temporary evaluation result.
-    bool fAllOk;
+    boost::atomic<bool> fAllOk;
 
     // Number of verifications that haven't completed yet.
-    // This includes elements that are not anymore in queue, but still in
+    // This includes elements that are not anymore in a shard, but still in
     // worker's own batches.
     boost::atomic<unsigned int> nTodo;
 
+    // Number of verifications currently sitting in the shards, i.e. not yet
+    // picked up by any worker. Only used to decide whether going to sleep
+    // is safe, so a worker can never doze off while work is available.
+    boost::atomic<unsigned int> nQueued;
+
     // Whether we're shutting down.
     bool fQuit;
 
     // The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    // Grab a shard index for a worker entering Loop(). Requires mutex.
+    unsigned int AcquireShard()
+    {
+        if (!vFreeShards.empty())
+        {
+            unsigned int nShard = vFreeShards.back();
+            vFreeShards.pop_back();
+            return nShard;
+        }
+        unsigned int nShard = nShardsUsed;
+        Yassert(nShard < vShards.size());
+        nShardsUsed = nShard + 1;
+        return nShard;
+    }
+
+    // Give a shard index back when a worker leaves Loop(). Requires mutex.
+    // The shard is necessarily drained at this point (nTodo == 0).
+    void ReleaseShard(unsigned int nShard)
+    {
+        vFreeShards.push_back(nShard);
+    }
+
+    // Move up to nMax jobs into vChecks: first from the back of our own
+    // shard, and if that is empty, steal from the front of somebody else's.
+    void FetchWork(unsigned int nMyShard, std::vector<T>& vChecks, unsigned int nMax)
+    {
+        {
+            CWorkShard &shard = *vShards[nMyShard];
+            boost::unique_lock<boost::mutex> lock(shard.mutex);
+            while (!shard.jobs.empty() && vChecks.size() < nMax)
+            {
+                vChecks.push_back(T());
+                vChecks.back().swap(shard.jobs.back());
+                shard.jobs.pop_back();
+            }
+        }
+        if (!vChecks.empty())
+        {
+            nQueued -= vChecks.size();
+            return;
+        }
+        unsigned int nShards = nShardsUsed;
+        for (unsigned int i = 1; i < nShards && vChecks.empty(); i++)
+        {
+            CWorkShard &victim = *vShards[(nMyShard + i) % nShards];
+            boost::unique_lock<boost::mutex> lock(victim.mutex, boost::try_to_lock);
+            if (!lock.owns_lock())
+                continue;
+            // steal half of the victim's deque, oldest jobs first, so both
+            // threads keep a decent amount of local work
+            unsigned int nSteal = std::min(nMax, (unsigned int)(victim.jobs.size() + 1) / 2);
+            for (unsigned int j = 0; j < nSteal; j++)
+            {
+                vChecks.push_back(T());
+                vChecks.back().swap(victim.jobs.front());
+                victim.jobs.pop_front();
+            }
+        }
+        if (!vChecks.empty())
+            nQueued -= vChecks.size();
+    }
+
     // Internal function that does bulk of the verification work.
-    bool Loop(bool fMaster = false) 
+    bool Loop(bool fMaster = false)
     {
-        boost::condition_variable 
+        boost::condition_variable
             &cond = fMaster ? condMaster : condWorker;
 
-        std::vector<T> 
+        unsigned int
+            nMyShard;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            nMyShard = AcquireShard();
+            ++nTotal;
+        }
+        std::vector<T>
             vChecks;
-
         vChecks.reserve(nBatchSize);
-        unsigned int 
-            nNow = 0;
-        bool 
-            fOk = true;
-        do 
+        do
         {
+            // Decide how many work units to process now.
+            // * Do not try to do everything at once, but aim for increasingly smaller batches so
+            //   all workers finish approximately simultaneously.
+            // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
+            unsigned int
+                nMax = std::max(1U, std::min(nBatchSize, (unsigned int)nTodo / (nTotal + 1)));
+            FetchWork(nMyShard, vChecks, nMax);
+            bool
+                fLastDone = false;
+            if (!vChecks.empty())
+            {
+                // execute work without holding any lock
+                bool
+                    fOk = fAllOk;
+                BOOST_FOREACH(T &check, vChecks)
+                    if (fOk)
+                        fOk = check();
+                // Publish a failure before the decrement below, so whoever
+                // observes nTodo == 0 is guaranteed to see it.
+                if (!fOk)
+                    fAllOk = false;
+                unsigned int
+                    nDone = vChecks.size();
+                vChecks.clear();
+                fLastDone = (nTodo.fetch_sub(nDone) == nDone);
+                if (!fLastDone)
+                    // there may well be more work around; go look for it
+                    continue;
+            }
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (fLastDone)
+                // We processed the last element; inform the master he can exit and return the result.
+                // Taking the mutex ensures the notification cannot fall between the master's check
+                // of nTodo and his going to sleep.
+                condMaster.notify_one();
+            if ((fMaster || fQuit) && nTodo == 0)
             {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) 
-                {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master he can exit and return the result
-                        condMaster.notify_one();
-                } 
-                else 
-                {   // first iteration
-                    ++nTotal;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) 
-                {
-                    if ((fMaster || fQuit) && nTodo == 0) 
-                    {
-                        --nTotal;
-                        if (nTotal==0)
-                            condQuit.notify_one();
-                        bool 
-                            fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    ++nIdle;
-                    cond.wait(lock); // wait
-                    --nIdle;
-                }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(
-                                1U, 
-                                std::min(
-                                         nBatchSize, 
-                                         (unsigned int)queue.size() / (nTotal + nIdle + 1)
-                                        )
-                               );
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; ++i) 
-                {
-                     // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                     // queue to the local batch vector instead of copying.
-                     vChecks[i].swap(queue.back());
-                     queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+                --nTotal;
+                ReleaseShard(nMyShard);
+                if (nTotal==0)
+                    condQuit.notify_one();
+                bool
+                    fRet = fAllOk;
+                // reset the status for new work later
+                if (fMaster)
+                    fAllOk = true;
+                // return the current status
+                return fRet;
             }
-            // execute work
-            BOOST_FOREACH(T &check, vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
-        } 
+            if (nQueued > 0)
+                // Add() refilled the shards between our (empty) scan and
+                // taking the mutex; scan again instead of going to sleep.
+                continue;
+            ++nIdle;
+            cond.wait(lock); // wait
+            --nIdle;
+        }
         while(true);
     }
 
 public:
-    // Create a new check queue
-    CCheckQueue(unsigned int nBatchSizeIn) :
-        nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
+    // Create a new check queue. nMaxWorkersIn bounds the number of threads
+    // (including the master) that may run Loop() concurrently.
+    CCheckQueue(unsigned int nBatchSizeIn, unsigned int nMaxWorkersIn = 64) :
+        nShardsUsed(0), nPushShard(0), nIdle(0), nTotal(0), fAllOk(true),
+        nTodo(0), nQueued(0), fQuit(false), nBatchSize(nBatchSizeIn)
+    {
+        vShards.reserve(nMaxWorkersIn);
+        for (unsigned int i = 0; i < nMaxWorkersIn; i++)
+            vShards.push_back(new CWorkShard());
+    }
 
     // Worker thread
-    void Thread() 
+    void Thread()
     {
         Loop();
     }
 
     // Wait until execution finishes, and return whether all evaluations where succesful.
-    bool Wait() 
+    bool Wait()
     {
         return Loop(true);
     }
 
     // Add a batch of checks to the queue
-    void Add(std::vector<T> &vChecks) 
+    void Add(std::vector<T> &vChecks)
     {
+        if (vChecks.empty())
+            return;
         boost::unique_lock<boost::mutex> lock(mutex);
-        BOOST_FOREACH(T &check, vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
+        // Spread the batch over the shards of the registered workers, so
+        // each worker mostly pops from its own deque and only occasionally
+        // has to steal.
+        unsigned int
+            nShards = nShardsUsed;
+        if (nShards == 0)
+            // no worker has registered yet; queue everything on the first
+            // shard, whoever shows up first will drain or redistribute it
+            nShardsUsed = nShards = 1;
+        unsigned int
+            nPerShard = (unsigned int)vChecks.size() / nShards + 1;
+        unsigned int
+            i = 0;
+        while (i < vChecks.size())
+        {
+            CWorkShard &shard = *vShards[nPushShard++ % nShards];
+            boost::unique_lock<boost::mutex> shardlock(shard.mutex);
+            for (unsigned int j = 0; j < nPerShard && i < vChecks.size(); j++, i++)
+            {
+                shard.jobs.push_back(T());
+                vChecks[i].swap(shard.jobs.back());
+            }
         }
+        nQueued += vChecks.size();
         nTodo += vChecks.size();
         if (vChecks.size() == 1)
             condWorker.notify_one();
@@ -179,13 +295,13 @@ public:
     }
 
     // Shut the queue down
-    void Quit() 
+    void Quit()
     {
         boost::unique_lock<boost::mutex> lock(mutex);
         fQuit = true;
         // No need to wake the master, as he will quit automatically when all jobs are
         // done.
-        condWorker.notify_all(); 
+        condWorker.notify_all();
 
         while (nTotal > 0)
         {
@@ -196,12 +312,17 @@ public:
 
     ~CCheckQueue() {
         Quit();
+        BOOST_FOREACH(CWorkShard *pshard, vShards)
+            delete pshard;
     }
 
     bool IsIdle()
     {
         boost::unique_lock<boost::mutex> lock(mutex);
-        return (nTotal == nIdle && nTodo == 0 && fAllOk == true);
+        // A worker may still be on its way from finishing its last batch to
+        // going to sleep; that is harmless, what matters is that no work and
+        // no unconsumed failure is left behind.
+        return (nTodo == 0 && nQueued == 0 && fAllOk == true);
     }
 };
 
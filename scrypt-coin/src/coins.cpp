@@ -8,6 +8,7 @@
 #include "base58.h"
 #include "consensus/consensus.h"
 #include "memusage.h"
+#include "metrics.h"
 #include "random.h"
 #include "util.h"
 #include "validation.h"
@@ -19,12 +20,63 @@
 
 extern bool AreTokensDeployed();
 
+/** Global rolling hash accumulator; shadows the state below the view stack.
+ *  Protected by cs_main: every flush and the seeding scan hold it. */
+static uint256 hashUtxoSetRolling;
+static bool fUtxoSetHashSeeded = false;
+
+uint256 UtxoSetHashTerm(const COutPoint& outpoint, const Coin& coin)
+{
+    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << outpoint;
+    ss << coin;
+    return ss.GetHash();
+}
+
+bool GetUtxoSetRollingHash(uint256& hashOut)
+{
+    if (!fUtxoSetHashSeeded)
+        return false;
+    hashOut = hashUtxoSetRolling;
+    return true;
+}
+
+void SeedUtxoSetRollingHash(const uint256& hashSeed)
+{
+    hashUtxoSetRolling = hashSeed;
+    fUtxoSetHashSeeded = true;
+}
+
+void ResetUtxoSetRollingHash()
+{
+    fUtxoSetHashSeeded = false;
+    hashUtxoSetRolling.SetNull();
+}
+
 bool CCoinsView::GetCoin(const COutPoint &outpoint, Coin &coin) const { return false; }
 uint256 CCoinsView::GetBestBlock() const { return uint256(); }
 std::vector<uint256> CCoinsView::GetHeadBlocks() const { return std::vector<uint256>(); }
-bool CCoinsView::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) { return false; }
+bool CCoinsView::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fFinalWrite) { return false; }
 CCoinsViewCursor *CCoinsView::Cursor() const { return nullptr; }
 
+void CCoinsView::AddUtxoHashDelta(const uint256& hashDelta)
+{
+    // Bottom of the view stack: deltas reaching the database layer are
+    // absorbed into the global accumulator. Before seeding there is no base
+    // to drift from, so they are simply dropped.
+    if (fUtxoSetHashSeeded)
+        hashUtxoSetRolling ^= hashDelta;
+}
+
+void CCoinsView::GetCoins(std::vector<COutPoint> &vOutpoints, std::vector<std::pair<COutPoint, Coin> > &vCoins) const
+{
+    for (const COutPoint& outpoint : vOutpoints) {
+        Coin coin;
+        if (GetCoin(outpoint, coin))
+            vCoins.push_back(std::make_pair(outpoint, std::move(coin)));
+    }
+}
+
 bool CCoinsView::HaveCoin(const COutPoint &outpoint) const
 {
     Coin coin;
@@ -33,26 +85,37 @@ bool CCoinsView::HaveCoin(const COutPoint &outpoint) const
 
 CCoinsViewBacked::CCoinsViewBacked(CCoinsView *viewIn) : base(viewIn) { }
 bool CCoinsViewBacked::GetCoin(const COutPoint &outpoint, Coin &coin) const { return base->GetCoin(outpoint, coin); }
+void CCoinsViewBacked::GetCoins(std::vector<COutPoint> &vOutpoints, std::vector<std::pair<COutPoint, Coin> > &vCoins) const { base->GetCoins(vOutpoints, vCoins); }
 bool CCoinsViewBacked::HaveCoin(const COutPoint &outpoint) const { return base->HaveCoin(outpoint); }
 uint256 CCoinsViewBacked::GetBestBlock() const { return base->GetBestBlock(); }
 std::vector<uint256> CCoinsViewBacked::GetHeadBlocks() const { return base->GetHeadBlocks(); }
 void CCoinsViewBacked::SetBackend(CCoinsView &viewIn) { base = &viewIn; }
-bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) { return base->BatchWrite(mapCoins, hashBlock); }
+bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fFinalWrite) { return base->BatchWrite(mapCoins, hashBlock, fFinalWrite); }
+void CCoinsViewBacked::AddUtxoHashDelta(const uint256& hashDelta) { base->AddUtxoHashDelta(hashDelta); }
 CCoinsViewCursor *CCoinsViewBacked::Cursor() const { return base->Cursor(); }
 size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
 
 SaltedOutpointHasher::SaltedOutpointHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {}
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn)
+    : CCoinsViewBacked(baseIn),
+      cacheCoins(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), CCoinsMap::allocator_type(&cachePoolResource)),
+      cachedCoinsUsage(0) {}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
-    return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
+    // The nodes live in the arena, whose chunks are counted directly; only
+    // the bucket array still comes from the heap.
+    return memusage::MallocUsage(sizeof(void*) * cacheCoins.bucket_count()) +
+           cachePoolResource.DynamicMemoryUsage() + cachedCoinsUsage;
 }
 
 CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const {
     CCoinsMap::iterator it = cacheCoins.find(outpoint);
-    if (it != cacheCoins.end())
+    if (it != cacheCoins.end()) {
+        g_metrics.nCoinsCacheHits.fetch_add(1, std::memory_order_relaxed);
         return it;
+    }
+    g_metrics.nCoinsCacheMisses.fetch_add(1, std::memory_order_relaxed);
     Coin tmp;
     if (!base->GetCoin(outpoint, tmp))
         return cacheCoins.end();
@@ -75,6 +138,46 @@ bool CCoinsViewCache::GetCoin(const COutPoint &outpoint, Coin &coin) const {
     return false;
 }
 
+void CCoinsViewCache::FetchCoins(std::vector<COutPoint> &vOutpoints) const {
+    std::vector<COutPoint> vMissing;
+    vMissing.reserve(vOutpoints.size());
+    for (const COutPoint& outpoint : vOutpoints) {
+        if (cacheCoins.count(outpoint) == 0)
+            vMissing.push_back(outpoint);
+    }
+    if (vMissing.empty())
+        return;
+    std::vector<std::pair<COutPoint, Coin> > vCoins;
+    vCoins.reserve(vMissing.size());
+    base->GetCoins(vMissing, vCoins);
+    for (std::pair<COutPoint, Coin>& item : vCoins) {
+        CCoinsMap::iterator it;
+        bool inserted;
+        std::tie(it, inserted) = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(item.first), std::forward_as_tuple(std::move(item.second)));
+        // GetCoins only returns unspent coins, so unlike FetchCoin there is
+        // no spent-in-parent case to mark FRESH here.
+        if (inserted)
+            cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+    }
+}
+
+void CCoinsViewCache::GetCachedOutpoints(std::vector<COutPoint> &vOutpoints, size_t nMax) const {
+    vOutpoints.reserve(std::min(nMax, cacheCoins.size()));
+    for (CCoinsMap::const_iterator it = cacheCoins.begin(); it != cacheCoins.end() && vOutpoints.size() < nMax; ++it) {
+        if (!it->second.coin.IsSpent())
+            vOutpoints.push_back(it->first);
+    }
+}
+
+void CCoinsViewCache::GetCoins(std::vector<COutPoint> &vOutpoints, std::vector<std::pair<COutPoint, Coin> > &vCoins) const {
+    FetchCoins(vOutpoints);
+    for (const COutPoint& outpoint : vOutpoints) {
+        CCoinsMap::const_iterator it = cacheCoins.find(outpoint);
+        if (it != cacheCoins.end() && !it->second.coin.IsSpent())
+            vCoins.push_back(std::make_pair(outpoint, it->second.coin));
+    }
+}
+
 void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possible_overwrite) {
     assert(!coin.IsSpent());
     if (coin.out.scriptPubKey.IsUnspendable()) return;
@@ -84,6 +187,16 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
     bool fresh = false;
     if (!inserted) {
         cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+        // An overwritten unspent coin leaves the set; take its term back out.
+        if (!it->second.coin.IsSpent())
+            hashUtxoDelta ^= UtxoSetHashTerm(outpoint, it->second.coin);
+    } else if (possible_overwrite) {
+        // The entry was created without consulting the base, so a pre-BIP30
+        // duplicate coinbase hiding below must be unaccounted here. One base
+        // lookup per coinbase output, a miss on every block but those.
+        Coin overwritten;
+        if (base->GetCoin(outpoint, overwritten))
+            hashUtxoDelta ^= UtxoSetHashTerm(outpoint, overwritten);
     }
     if (!possible_overwrite) {
         if (!it->second.coin.IsSpent()) {
@@ -94,6 +207,7 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
     it->second.coin = std::move(coin);
     it->second.flags |= CCoinsCacheEntry::DIRTY | (fresh ? CCoinsCacheEntry::FRESH : 0);
     cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+    hashUtxoDelta ^= UtxoSetHashTerm(outpoint, it->second.coin);
 }
 
 void AddCoins(CCoinsViewCache& cache, const CTransaction &tx, int nHeight, uint256 blockHash, bool check, CTokensCache* tokensCache, std::pair<std::string, CBlockTokenUndo>* undoTokenData) {
@@ -213,6 +327,9 @@ bool CCoinsViewCache::SpendCoin(const COutPoint &outpoint, Coin* moveout, CToken
     Coin tempCoin = it->second.coin;
     /** YAC_TOKEN END */
 
+    if (!tempCoin.IsSpent())
+        hashUtxoDelta ^= UtxoSetHashTerm(outpoint, tempCoin);
+
     if (moveout) {
         *moveout = std::move(it->second.coin);
     }
@@ -267,7 +384,7 @@ void CCoinsViewCache::SetBestBlock(const uint256 &hashBlockIn) {
     hashBlock = hashBlockIn;
 }
 
-bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn) {
+bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn, bool fFinalWrite) {
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) { // Ignore non-dirty entries (optimization).
             CCoinsMap::iterator itUs = cacheCoins.find(it->first);
@@ -323,13 +440,47 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
     return true;
 }
 
+void CCoinsViewCache::AddUtxoHashDelta(const uint256& hashDelta) {
+    hashUtxoDelta ^= hashDelta;
+}
+
 bool CCoinsViewCache::Flush() {
     bool fOk = base->BatchWrite(cacheCoins, hashBlock);
+    if (fOk) {
+        // The base now logically contains our modifications; hand the
+        // rolling-hash delta down with them. FlushPartial() deliberately
+        // leaves the delta alone: the coins it trickles out stay part of
+        // the set, and the delta keeps shadowing them until the final flush.
+        base->AddUtxoHashDelta(hashUtxoDelta);
+        hashUtxoDelta.SetNull();
+    }
     cacheCoins.clear();
+    // The map is empty, so every node is back in the arena's freelists and
+    // the chunks can be returned to the heap in one go.
+    cachePoolResource.Clear();
     cachedCoinsUsage = 0;
     return fOk;
 }
 
+bool CCoinsViewCache::FlushPartial(size_t nMaxEntries) {
+    // Carve a bounded chunk out of the cache and push it down without
+    // finalizing, so block connection never stalls behind a full flush.
+    CCoinsMap mapPartial;
+    size_t nUsageReleased = 0;
+    CCoinsMap::iterator it = cacheCoins.begin();
+    while (it != cacheCoins.end() && mapPartial.size() < nMaxEntries) {
+        CCoinsMap::iterator itOld = it++;
+        nUsageReleased += itOld->second.coin.DynamicMemoryUsage();
+        mapPartial.emplace(itOld->first, std::move(itOld->second));
+        cacheCoins.erase(itOld);
+    }
+    if (mapPartial.empty())
+        return true;
+    bool fOk = base->BatchWrite(mapPartial, hashBlock, false);
+    cachedCoinsUsage -= nUsageReleased;
+    return fOk;
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
@@ -15,6 +15,7 @@
 #include "hash.h"
 #include "memusage.h"
 #include "serialize.h"
+#include "support/allocators/pool.h"
 #include "uint256.h"
 
 #include <assert.h>
@@ -161,7 +162,38 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+// The cache map's nodes come out of a CPoolResource arena: with -dbcache in
+// the gigabytes, per-node heap allocations fragment badly and the allocator
+// overhead is invisible to memusage accounting. A default-constructed map
+// (no resource) still works and simply uses the heap.
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>,
+                           pool_allocator<std::pair<const COutPoint, CCoinsCacheEntry> > > CCoinsMap;
+
+/**
+ * Rolling hash of the UTXO set, for fleet-wide chainstate auditing.
+ *
+ * The set hash is the XOR of one salt-free SHA256 term per unspent output,
+ * so it is order-independent and can be updated incrementally: adding a coin
+ * XORs its term in, spending it XORs the same term back out. Every
+ * CCoinsViewCache accumulates the delta of its own modifications and folds it
+ * into its base on Flush(); deltas of caches that are discarded without
+ * flushing (failed block connection, mempool views, verification passes) die
+ * with them. The bottom of the view stack folds into a global accumulator,
+ * seeded once from a full database scan by the getutxosethash RPC.
+ *
+ * XOR composition is not collision-resistant against an adversary choosing
+ * outputs, but the fleet audit compares nodes running identical consensus
+ * code, where divergence is accidental, not crafted.
+ */
+uint256 UtxoSetHashTerm(const COutPoint& outpoint, const Coin& coin);
+
+//! Returns false until the rolling hash has been seeded from a full scan.
+//! Protected by cs_main, like the view stack it shadows.
+bool GetUtxoSetRollingHash(uint256& hashOut);
+//! Install the result of a full UTXO scan as the rolling hash base.
+void SeedUtxoSetRollingHash(const uint256& hashSeed);
+//! Forget the rolling hash, e.g. after a seed scan failed half way.
+void ResetUtxoSetRollingHash();
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -193,6 +225,11 @@ public:
      */
     virtual bool GetCoin(const COutPoint &outpoint, Coin &coin) const;
 
+    //! Bulk form of GetCoin: append every unspent coin found among vOutpoints
+    //! to vCoins. Backends may reorder vOutpoints to suit their access
+    //! pattern. The default implementation loops over GetCoin.
+    virtual void GetCoins(std::vector<COutPoint> &vOutpoints, std::vector<std::pair<COutPoint, Coin> > &vCoins) const;
+
     //! Just check whether a given outpoint is unspent.
     virtual bool HaveCoin(const COutPoint &outpoint) const;
 
@@ -207,7 +244,16 @@ public:
 
     //! Do a bulk modification (multiple Coin changes + BestBlock change).
     //! The passed mapCoins can be modified.
-    virtual bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
+    //! When fFinalWrite is false the write is part of an incremental flush
+    //! sequence: the backing store must keep itself marked as mid-transition
+    //! (crash recovery replays the affected blocks) until a final write
+    //! arrives for the same or a later best block.
+    virtual bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fFinalWrite = true);
+
+    //! Fold a rolling-hash delta for changes flushed into this view. The
+    //! default implementation is the bottom of the stack and absorbs the
+    //! delta into the global accumulator.
+    virtual void AddUtxoHashDelta(const uint256& hashDelta);
 
     //! Get a cursor to iterate over the whole state
     virtual CCoinsViewCursor *Cursor() const;
@@ -229,11 +275,13 @@ protected:
 public:
     CCoinsViewBacked(CCoinsView *viewIn);
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    void GetCoins(std::vector<COutPoint> &vOutpoints, std::vector<std::pair<COutPoint, Coin> > &vCoins) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
     void SetBackend(CCoinsView &viewIn);
-    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fFinalWrite = true) override;
+    void AddUtxoHashDelta(const uint256& hashDelta) override;
     CCoinsViewCursor *Cursor() const override;
     size_t EstimateSize() const override;
 };
@@ -248,24 +296,35 @@ protected:
      * declared as "const".
      */
     mutable uint256 hashBlock;
+    /* Arena the cacheCoins nodes live in; declared first so it outlives the map. */
+    mutable CPoolResource cachePoolResource;
     mutable CCoinsMap cacheCoins;
 
     /* Cached dynamic memory usage for the inner Coin objects. */
     mutable size_t cachedCoinsUsage;
 
+    /* Rolling-hash delta of the modifications held in this cache, relative
+     * to the base view. Folded into the base on Flush(). */
+    uint256 hashUtxoDelta;
+
 public:
     CCoinsViewCache(CCoinsView *baseIn);
 
     // Standard CCoinsView methods
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    void GetCoins(std::vector<COutPoint> &vOutpoints, std::vector<std::pair<COutPoint, Coin> > &vCoins) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
     void SetBestBlock(const uint256 &hashBlock);
-    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fFinalWrite = true) override;
+    void AddUtxoHashDelta(const uint256& hashDelta) override;
     CCoinsViewCursor* Cursor() const override {
         throw std::logic_error("CCoinsViewCache cursor iteration not supported.");
     }
 
+    //! Rolling-hash delta of this cache's unflushed modifications.
+    const uint256& GetUtxoHashDelta() const { return hashUtxoDelta; }
+
     /**
      * Check if we have the given utxo already loaded in this cache.
      * The semantics are the same as HaveCoin(), but no calls to
@@ -273,6 +332,21 @@ public:
      */
     bool HaveCoinInCache(const COutPoint &outpoint) const;
 
+    /**
+     * Pull the listed outpoints into the cache with a single bulk request to
+     * the base view, so subsequent AccessCoin calls hit the cache. Outpoints
+     * already cached or unknown to the base are left alone. vOutpoints may be
+     * reordered.
+     */
+    void FetchCoins(std::vector<COutPoint> &vOutpoints) const;
+
+    /**
+     * Collect up to nMax outpoints of unspent coins held in this cache. The
+     * cache contents approximate the validation hot set, so the list serves
+     * as a warm-up hint for a paired node (see the "hotset" p2p message).
+     */
+    void GetCachedOutpoints(std::vector<COutPoint> &vOutpoints, size_t nMax) const;
+
     /**
      * Return a reference to Coin in the cache, or a pruned one if not found. This is
      * more efficient than GetCoin.
@@ -305,6 +379,15 @@ public:
      */
     bool Flush();
 
+    /**
+     * Push up to nMaxEntries cache entries (dirty or not) to the base without
+     * finalizing the on-disk state, trickling a large dirty cache out in
+     * bounded chunks so the eventual Flush() only has a small residue left.
+     * Crash consistency is preserved: the base stays marked mid-transition
+     * until the next full Flush() completes.
+     */
+    bool FlushPartial(size_t nMaxEntries);
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is
      * not modified.
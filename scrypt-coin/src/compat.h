@@ -46,6 +46,14 @@
 #include <unistd.h>
 #endif
 
+// Event-notification backend for the socket handler: epoll on Linux, kqueue
+// on the BSDs and macOS, select() everywhere else.
+#if defined(__linux__)
+#define USE_EPOLL
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__) || defined(__DragonFly__)
+#define USE_KQUEUE
+#endif
+
 #ifndef WIN32
 typedef unsigned int SOCKET;
 #include "errno.h"
@@ -79,7 +87,8 @@ size_t strnlen( const char *start, size_t max_len);
 #endif // HAVE_DECL_STRNLEN
 
 bool static inline IsSelectableSocket(const SOCKET& s) {
-#ifdef WIN32
+#if defined(WIN32) || defined(USE_EPOLL) || defined(USE_KQUEUE)
+    // epoll and kqueue have no FD_SETSIZE-style descriptor cap.
     return true;
 #else
     return (s < FD_SETSIZE);
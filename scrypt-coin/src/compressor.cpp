@@ -183,3 +183,131 @@ uint64_t CTxOutCompressor::DecompressAmount(uint64_t x)
     }
     return n;
 }
+
+namespace {
+
+const size_t LZ_MIN_MATCH = 4;
+const size_t LZ_WINDOW_SIZE = 65535;
+const unsigned int LZ_HASH_BITS = 14;
+
+inline uint32_t LZReadU32(const unsigned char* p)
+{
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+inline unsigned int LZHash(const unsigned char* p)
+{
+    return (LZReadU32(p) * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+void LZWriteLength(std::vector<unsigned char>& vchOut, size_t nLength)
+{
+    while (nLength >= 255) {
+        vchOut.push_back(255);
+        nLength -= 255;
+    }
+    vchOut.push_back((unsigned char)nLength);
+}
+
+bool LZReadLength(const std::vector<unsigned char>& vchIn, size_t& nPos, size_t& nLength)
+{
+    unsigned char ch;
+    do {
+        if (nPos >= vchIn.size())
+            return false;
+        ch = vchIn[nPos++];
+        nLength += ch;
+    } while (ch == 255);
+    return true;
+}
+
+void LZEmit(std::vector<unsigned char>& vchOut, const unsigned char* pLiterals,
+            size_t nLiterals, size_t nOffset, size_t nMatchLen)
+{
+    // Match code 0 marks a literal-only token; real matches start at 1
+    size_t nMatchCode = nMatchLen == 0 ? 0 : nMatchLen - LZ_MIN_MATCH + 1;
+    unsigned char chToken = (unsigned char)((std::min(nLiterals, (size_t)15) << 4) |
+                                            std::min(nMatchCode, (size_t)15));
+    vchOut.push_back(chToken);
+    if (nLiterals >= 15)
+        LZWriteLength(vchOut, nLiterals - 15);
+    vchOut.insert(vchOut.end(), pLiterals, pLiterals + nLiterals);
+    if (nMatchLen > 0) {
+        vchOut.push_back((unsigned char)(nOffset & 0xff));
+        vchOut.push_back((unsigned char)(nOffset >> 8));
+        if (nMatchCode >= 15)
+            LZWriteLength(vchOut, nMatchCode - 15);
+    }
+}
+
+} // namespace
+
+void CompressChunk(const std::vector<unsigned char>& vchIn, std::vector<unsigned char>& vchOut)
+{
+    vchOut.clear();
+    const size_t n = vchIn.size();
+    const unsigned char* p = vchIn.data();
+    std::vector<int64_t> vHashTable((size_t)1 << LZ_HASH_BITS, -1);
+
+    size_t nAnchor = 0;
+    size_t i = 0;
+    while (n >= LZ_MIN_MATCH && i + LZ_MIN_MATCH <= n) {
+        unsigned int h = LZHash(p + i);
+        int64_t nCandidate = vHashTable[h];
+        vHashTable[h] = (int64_t)i;
+        if (nCandidate >= 0 && i - (size_t)nCandidate <= LZ_WINDOW_SIZE &&
+            LZReadU32(p + nCandidate) == LZReadU32(p + i)) {
+            size_t nMatchLen = LZ_MIN_MATCH;
+            while (i + nMatchLen < n && p[(size_t)nCandidate + nMatchLen] == p[i + nMatchLen])
+                nMatchLen++;
+            LZEmit(vchOut, p + nAnchor, i - nAnchor, i - (size_t)nCandidate, nMatchLen);
+            i += nMatchLen;
+            nAnchor = i;
+        } else {
+            i++;
+        }
+    }
+    // Trailing literals, or the whole input when nothing matched
+    LZEmit(vchOut, p + nAnchor, n - nAnchor, 0, 0);
+}
+
+bool DecompressChunk(const std::vector<unsigned char>& vchIn, std::vector<unsigned char>& vchOut, size_t nExpectedSize)
+{
+    vchOut.clear();
+    vchOut.reserve(nExpectedSize);
+
+    size_t nPos = 0;
+    while (nPos < vchIn.size()) {
+        unsigned char chToken = vchIn[nPos++];
+
+        size_t nLiterals = chToken >> 4;
+        if (nLiterals == 15 && !LZReadLength(vchIn, nPos, nLiterals))
+            return false;
+        if (nPos + nLiterals > vchIn.size() || vchOut.size() + nLiterals > nExpectedSize)
+            return false;
+        vchOut.insert(vchOut.end(), vchIn.begin() + nPos, vchIn.begin() + nPos + nLiterals);
+        nPos += nLiterals;
+
+        size_t nMatchCode = chToken & 15;
+        if (nMatchCode == 0)
+            continue;
+        if (nPos + 2 > vchIn.size())
+            return false;
+        size_t nOffset = vchIn[nPos] | ((size_t)vchIn[nPos + 1] << 8);
+        nPos += 2;
+        if (nMatchCode == 15 && !LZReadLength(vchIn, nPos, nMatchCode))
+            return false;
+        size_t nMatchLen = nMatchCode - 1 + LZ_MIN_MATCH;
+        if (nOffset == 0 || nOffset > vchOut.size() || vchOut.size() + nMatchLen > nExpectedSize)
+            return false;
+
+        // Copy byte by byte: the match is allowed to overlap its own output
+        size_t nFrom = vchOut.size() - nOffset;
+        for (size_t k = 0; k < nMatchLen; k++)
+            vchOut.push_back(vchOut[nFrom + k]);
+    }
+
+    return vchOut.size() == nExpectedSize;
+}
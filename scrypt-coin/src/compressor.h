@@ -118,4 +118,24 @@ public:
     }
 };
 
+/** General-purpose LZ compression for disk chunks.
+ *
+ *  A greedy byte-oriented LZ77 variant with a 64 KiB window, intended for
+ *  highly repetitive serialized structures (e.g. block undo data, where the
+ *  same scripts and heights recur). The format is a sequence of tokens: the
+ *  high nibble holds the literal run length, the low nibble the match length
+ *  minus the 4-byte minimum, each extended with 255-continuation bytes when
+ *  it saturates, followed by the literals and a 2-byte little-endian match
+ *  offset. The final token carries only literals (match length nibble 0).
+ *
+ *  This is a storage codec, not a consensus format: both sides of a
+ *  round-trip run the same code.
+ */
+void CompressChunk(const std::vector<unsigned char>& vchIn, std::vector<unsigned char>& vchOut);
+
+/** Inverse of CompressChunk. nExpectedSize is the known size of the original
+ *  data; decompression fails (returns false) on malformed input or a size
+ *  mismatch. */
+bool DecompressChunk(const std::vector<unsigned char>& vchIn, std::vector<unsigned char>& vchOut, size_t nExpectedSize);
+
 #endif // BITCOIN_COMPRESSOR_H
@@ -12,6 +12,27 @@ extern "C" {
 #include "crypto/ctaes/ctaes.c"
 }
 
+#ifdef ENABLE_AESNI
+#include <cpuid.h>
+
+namespace aesni
+{
+void Expand256(unsigned char* rk, const unsigned char key[32]);
+void ExpandDecrypt256(unsigned char* rk, const unsigned char key[32]);
+void Encrypt256(const unsigned char* rk, unsigned char* out, const unsigned char* in);
+void Decrypt256(const unsigned char* rk, unsigned char* out, const unsigned char* in);
+} // namespace aesni
+
+static bool AESNIDetect()
+{
+    uint32_t eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return (ecx >> 25) & 1;
+    return false;
+}
+static const bool fUseAESNI = AESNIDetect();
+#endif
+
 AES128Encrypt::AES128Encrypt(const unsigned char key[16])
 {
     AES128_init(&ctx, key);
@@ -44,31 +65,57 @@ void AES128Decrypt::Decrypt(unsigned char plaintext[16], const unsigned char cip
 
 AES256Encrypt::AES256Encrypt(const unsigned char key[32])
 {
+#ifdef ENABLE_AESNI
+    if (fUseAESNI) {
+        aesni::Expand256(sched.rk, key);
+        return;
+    }
+#endif
     AES256_init(&ctx, key);
 }
 
 AES256Encrypt::~AES256Encrypt()
 {
     memset(&ctx, 0, sizeof(ctx));
+    memset(&sched, 0, sizeof(sched));
 }
 
 void AES256Encrypt::Encrypt(unsigned char ciphertext[16], const unsigned char plaintext[16]) const
 {
+#ifdef ENABLE_AESNI
+    if (fUseAESNI) {
+        aesni::Encrypt256(sched.rk, ciphertext, plaintext);
+        return;
+    }
+#endif
     AES256_encrypt(&ctx, 1, ciphertext, plaintext);
 }
 
 AES256Decrypt::AES256Decrypt(const unsigned char key[32])
 {
+#ifdef ENABLE_AESNI
+    if (fUseAESNI) {
+        aesni::ExpandDecrypt256(sched.rk, key);
+        return;
+    }
+#endif
     AES256_init(&ctx, key);
 }
 
 AES256Decrypt::~AES256Decrypt()
 {
     memset(&ctx, 0, sizeof(ctx));
+    memset(&sched, 0, sizeof(sched));
 }
 
 void AES256Decrypt::Decrypt(unsigned char plaintext[16], const unsigned char ciphertext[16]) const
 {
+#ifdef ENABLE_AESNI
+    if (fUseAESNI) {
+        aesni::Decrypt256(sched.rk, plaintext, ciphertext);
+        return;
+    }
+#endif
     AES256_decrypt(&ctx, 1, plaintext, ciphertext);
 }
 
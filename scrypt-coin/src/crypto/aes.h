@@ -15,6 +15,14 @@ static const int AES_BLOCKSIZE = 16;
 static const int AES128_KEYSIZE = 16;
 static const int AES256_KEYSIZE = 32;
 
+/** Expanded round keys for the AES-NI code path (see crypto/aes_aesni.cpp).
+ *  Only filled in when AES-NI support is compiled in and detected at runtime;
+ *  otherwise the ctaes context below is used instead. */
+struct AESNIKeySchedule
+{
+    unsigned char rk[15 * AES_BLOCKSIZE];
+};
+
 /** An encryption class for AES-128. */
 class AES128Encrypt
 {
@@ -44,6 +52,7 @@ class AES256Encrypt
 {
 private:
     AES256_ctx ctx;
+    AESNIKeySchedule sched;
 
 public:
     AES256Encrypt(const unsigned char key[32]);
@@ -56,6 +65,7 @@ class AES256Decrypt
 {
 private:
     AES256_ctx ctx;
+    AESNIKeySchedule sched;
 
 public:
     AES256Decrypt(const unsigned char key[32]);
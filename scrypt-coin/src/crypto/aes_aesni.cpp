@@ -0,0 +1,120 @@
+// Copyright (c) 2025 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// AES-256 using the AES-NI instruction set. Dispatched to at runtime from
+// crypto/aes.cpp after a cpuid check. The key expansion follows the Intel
+// AES-NI whitepaper; round keys are stored unaligned in the caller-provided
+// AESNIKeySchedule.
+
+#ifdef ENABLE_AESNI
+
+#include <immintrin.h>
+#include <string.h>
+
+namespace {
+
+void KeyExpansionAssist1(__m128i& temp1, __m128i temp2)
+{
+    __m128i temp4;
+    temp2 = _mm_shuffle_epi32(temp2, 0xff);
+    temp4 = _mm_slli_si128(temp1, 0x4);
+    temp1 = _mm_xor_si128(temp1, temp4);
+    temp4 = _mm_slli_si128(temp4, 0x4);
+    temp1 = _mm_xor_si128(temp1, temp4);
+    temp4 = _mm_slli_si128(temp4, 0x4);
+    temp1 = _mm_xor_si128(temp1, temp4);
+    temp1 = _mm_xor_si128(temp1, temp2);
+}
+
+void KeyExpansionAssist2(__m128i temp1, __m128i& temp3)
+{
+    __m128i temp2, temp4;
+    temp4 = _mm_aeskeygenassist_si128(temp1, 0x0);
+    temp2 = _mm_shuffle_epi32(temp4, 0xaa);
+    temp4 = _mm_slli_si128(temp3, 0x4);
+    temp3 = _mm_xor_si128(temp3, temp4);
+    temp4 = _mm_slli_si128(temp4, 0x4);
+    temp3 = _mm_xor_si128(temp3, temp4);
+    temp4 = _mm_slli_si128(temp4, 0x4);
+    temp3 = _mm_xor_si128(temp3, temp4);
+    temp3 = _mm_xor_si128(temp3, temp2);
+}
+
+} // namespace
+
+namespace aesni {
+
+void Expand256(unsigned char* rk, const unsigned char key[32])
+{
+    __m128i* ks = (__m128i*)rk;
+    __m128i temp1 = _mm_loadu_si128((const __m128i*)key);
+    __m128i temp3 = _mm_loadu_si128((const __m128i*)(key + 16));
+    _mm_storeu_si128(ks + 0, temp1);
+    _mm_storeu_si128(ks + 1, temp3);
+    KeyExpansionAssist1(temp1, _mm_aeskeygenassist_si128(temp3, 0x01));
+    _mm_storeu_si128(ks + 2, temp1);
+    KeyExpansionAssist2(temp1, temp3);
+    _mm_storeu_si128(ks + 3, temp3);
+    KeyExpansionAssist1(temp1, _mm_aeskeygenassist_si128(temp3, 0x02));
+    _mm_storeu_si128(ks + 4, temp1);
+    KeyExpansionAssist2(temp1, temp3);
+    _mm_storeu_si128(ks + 5, temp3);
+    KeyExpansionAssist1(temp1, _mm_aeskeygenassist_si128(temp3, 0x04));
+    _mm_storeu_si128(ks + 6, temp1);
+    KeyExpansionAssist2(temp1, temp3);
+    _mm_storeu_si128(ks + 7, temp3);
+    KeyExpansionAssist1(temp1, _mm_aeskeygenassist_si128(temp3, 0x08));
+    _mm_storeu_si128(ks + 8, temp1);
+    KeyExpansionAssist2(temp1, temp3);
+    _mm_storeu_si128(ks + 9, temp3);
+    KeyExpansionAssist1(temp1, _mm_aeskeygenassist_si128(temp3, 0x10));
+    _mm_storeu_si128(ks + 10, temp1);
+    KeyExpansionAssist2(temp1, temp3);
+    _mm_storeu_si128(ks + 11, temp3);
+    KeyExpansionAssist1(temp1, _mm_aeskeygenassist_si128(temp3, 0x20));
+    _mm_storeu_si128(ks + 12, temp1);
+    KeyExpansionAssist2(temp1, temp3);
+    _mm_storeu_si128(ks + 13, temp3);
+    KeyExpansionAssist1(temp1, _mm_aeskeygenassist_si128(temp3, 0x40));
+    _mm_storeu_si128(ks + 14, temp1);
+}
+
+void ExpandDecrypt256(unsigned char* rk, const unsigned char key[32])
+{
+    // The decryption schedule is the encryption schedule in reverse order,
+    // with InvMixColumns applied to all but the first and last round keys.
+    unsigned char enc[15 * 16];
+    Expand256(enc, key);
+    __m128i* out = (__m128i*)rk;
+    const __m128i* in = (const __m128i*)enc;
+    _mm_storeu_si128(out + 0, _mm_loadu_si128(in + 14));
+    for (int i = 1; i != 14; i++)
+        _mm_storeu_si128(out + i, _mm_aesimc_si128(_mm_loadu_si128(in + 14 - i)));
+    _mm_storeu_si128(out + 14, _mm_loadu_si128(in + 0));
+    memset(enc, 0, sizeof(enc));
+}
+
+void Encrypt256(const unsigned char* rk, unsigned char* out, const unsigned char* in)
+{
+    const __m128i* ks = (const __m128i*)rk;
+    __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)in), _mm_loadu_si128(ks + 0));
+    for (int i = 1; i != 14; i++)
+        x = _mm_aesenc_si128(x, _mm_loadu_si128(ks + i));
+    x = _mm_aesenclast_si128(x, _mm_loadu_si128(ks + 14));
+    _mm_storeu_si128((__m128i*)out, x);
+}
+
+void Decrypt256(const unsigned char* rk, unsigned char* out, const unsigned char* in)
+{
+    const __m128i* ks = (const __m128i*)rk;
+    __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)in), _mm_loadu_si128(ks + 0));
+    for (int i = 1; i != 14; i++)
+        x = _mm_aesdec_si128(x, _mm_loadu_si128(ks + i));
+    x = _mm_aesdeclast_si128(x, _mm_loadu_si128(ks + 14));
+    _mm_storeu_si128((__m128i*)out, x);
+}
+
+} // namespace aesni
+
+#endif // ENABLE_AESNI
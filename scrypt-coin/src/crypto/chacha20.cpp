@@ -12,6 +12,15 @@
 
 #include <string.h>
 
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__))
+#include "crypto/sha256.h"
+
+namespace chacha20_avx2
+{
+void Blocks8(const uint32_t input[16], unsigned char* c);
+}
+#endif
+
 constexpr static inline uint32_t rotl32(uint32_t v, int c) { return (v << c) | (v >> (32 - c)); }
 
 #define QUARTERROUND(a,b,c,d) \
@@ -83,6 +92,21 @@ void ChaCha20::Output(unsigned char* c, size_t bytes)
 
     if (!bytes) return;
 
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__))
+    // Bulk keystream: compute eight blocks per pass while the remaining
+    // length covers full batches. Stay clear of a 32-bit counter wrap within
+    // a batch; the scalar loop below handles the carry into input[13].
+    if (bytes >= 512 && SHA256Has8WayAVX2()) {
+        while (bytes >= 512 && input[12] < 0xfffffff8) {
+            chacha20_avx2::Blocks8(input, c);
+            input[12] += 8;
+            c += 512;
+            bytes -= 512;
+        }
+        if (!bytes) return;
+    }
+#endif
+
     j0 = input[0];
     j1 = input[1];
     j2 = input[2];
@@ -0,0 +1,100 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// 8-way ChaCha20 block function using AVX2: eight consecutive keystream
+// blocks are computed in parallel, one per 32-bit lane of the ymm registers,
+// then transposed into their serial order. Compiled in its own object with
+// -mavx2; only called after the runtime CPU probe has verified AVX2 support.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace {
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline Rotl(__m256i x, int b)
+{
+    return _mm256_or_si256(_mm256_slli_epi32(x, b), _mm256_srli_epi32(x, 32 - b));
+}
+
+#define QUARTERROUND8(a,b,c,d) \
+    a = Add(a, b); d = Rotl(Xor(d, a), 16); \
+    c = Add(c, d); b = Rotl(Xor(b, c), 12); \
+    a = Add(a, b); d = Rotl(Xor(d, a), 8); \
+    c = Add(c, d); b = Rotl(Xor(b, c), 7);
+
+/** Transpose eight ymm registers holding one state word of all eight blocks
+ *  each into eight registers holding half of one block each. */
+void inline Transpose8x8(__m256i v[8])
+{
+    __m256i t0 = _mm256_unpacklo_epi32(v[0], v[1]);
+    __m256i t1 = _mm256_unpackhi_epi32(v[0], v[1]);
+    __m256i t2 = _mm256_unpacklo_epi32(v[2], v[3]);
+    __m256i t3 = _mm256_unpackhi_epi32(v[2], v[3]);
+    __m256i t4 = _mm256_unpacklo_epi32(v[4], v[5]);
+    __m256i t5 = _mm256_unpackhi_epi32(v[4], v[5]);
+    __m256i t6 = _mm256_unpacklo_epi32(v[6], v[7]);
+    __m256i t7 = _mm256_unpackhi_epi32(v[6], v[7]);
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+    v[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    v[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    v[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    v[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    v[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    v[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    v[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    v[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+} // namespace
+
+namespace chacha20_avx2
+{
+/** Produce the eight 64-byte keystream blocks at counters input[12]..input[12]+7
+ *  into c. The caller handles the counter increment (no carry may occur within
+ *  the batch). Same per-block construction as ChaCha20::Output(). */
+void Blocks8(const uint32_t input[16], unsigned char* c)
+{
+    __m256i j[16], x[16];
+    for (int i = 0; i < 16; i++)
+        j[i] = _mm256_set1_epi32((int)input[i]);
+    j[12] = Add(j[12], _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+
+    for (int i = 0; i < 16; i++)
+        x[i] = j[i];
+    for (int i = 20; i > 0; i -= 2) {
+        QUARTERROUND8(x[0], x[4], x[ 8], x[12])
+        QUARTERROUND8(x[1], x[5], x[ 9], x[13])
+        QUARTERROUND8(x[2], x[6], x[10], x[14])
+        QUARTERROUND8(x[3], x[7], x[11], x[15])
+        QUARTERROUND8(x[0], x[5], x[10], x[15])
+        QUARTERROUND8(x[1], x[6], x[11], x[12])
+        QUARTERROUND8(x[2], x[7], x[ 8], x[13])
+        QUARTERROUND8(x[3], x[4], x[ 9], x[14])
+    }
+    for (int i = 0; i < 16; i++)
+        x[i] = Add(x[i], j[i]);
+
+    // Lane l of x[w] is word w of block l; transpose the two 8x8 word halves
+    // so each block's words come out contiguous, in little-endian dword order.
+    Transpose8x8(x);
+    Transpose8x8(x + 8);
+    for (int b = 0; b < 8; b++) {
+        _mm256_storeu_si256((__m256i*)(c + 64 * b), x[b]);
+        _mm256_storeu_si256((__m256i*)(c + 64 * b + 32), x[8 + b]);
+    }
+}
+} // namespace chacha20_avx2
+
+#endif // ENABLE_AVX2
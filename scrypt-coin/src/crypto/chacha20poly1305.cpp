@@ -0,0 +1,75 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/chacha20poly1305.h"
+
+#include "support/cleanse.h"
+
+#include <string.h>
+
+void ChaCha20Poly1305::SetKey(const unsigned char* key, size_t keylen)
+{
+    chacha.SetKey(key, keylen);
+}
+
+void ChaCha20Poly1305::CryptInPlace(unsigned char* data, size_t len)
+{
+    // ChaCha20::Output produces raw keystream, so XOR it in through a bounce
+    // block; the counter was left at one by the Poly1305 key block.
+    unsigned char keystream[64];
+    while (len > 0) {
+        size_t nChunk = len < 64 ? len : 64;
+        chacha.Output(keystream, 64);
+        for (size_t i = 0; i < nChunk; i++)
+            data[i] ^= keystream[i];
+        data += nChunk;
+        len -= nChunk;
+    }
+    memory_cleanse(keystream, sizeof(keystream));
+}
+
+//! Per-frame one-time Poly1305 key: the frame's keystream block zero.
+static void GetPolyKey(ChaCha20& chacha, uint64_t nSeq, unsigned char polykey[Poly1305::KEYLEN])
+{
+    unsigned char block0[64];
+    chacha.SetIV(nSeq);
+    chacha.Seek(0);
+    chacha.Output(block0, 64);
+    memcpy(polykey, block0, Poly1305::KEYLEN);
+    memory_cleanse(block0, sizeof(block0));
+}
+
+void ChaCha20Poly1305::Seal(uint64_t nSeq, const unsigned char* aad, size_t aadlen,
+                            unsigned char* data, size_t datalen, unsigned char* tag)
+{
+    unsigned char polykey[Poly1305::KEYLEN];
+    GetPolyKey(chacha, nSeq, polykey);
+    CryptInPlace(data, datalen);
+    Poly1305().SetKey(polykey).Write(aad, aadlen).Write(data, datalen).Finalize(tag);
+    memory_cleanse(polykey, sizeof(polykey));
+}
+
+bool ChaCha20Poly1305::Open(uint64_t nSeq, const unsigned char* aad, size_t aadlen,
+                            unsigned char* data, size_t datalen, const unsigned char* tag)
+{
+    unsigned char polykey[Poly1305::KEYLEN];
+    GetPolyKey(chacha, nSeq, polykey);
+
+    unsigned char expected[Poly1305::TAGLEN];
+    Poly1305().SetKey(polykey).Write(aad, aadlen).Write(data, datalen).Finalize(expected);
+    memory_cleanse(polykey, sizeof(polykey));
+
+    // constant-time comparison; an attacker must learn nothing from timing
+    unsigned char diff = 0;
+    for (size_t i = 0; i < Poly1305::TAGLEN; i++)
+        diff |= expected[i] ^ tag[i];
+    if (diff != 0)
+        return false;
+
+    // re-derive the keystream position past the Poly1305 key block
+    chacha.SetIV(nSeq);
+    chacha.Seek(1);
+    CryptInPlace(data, datalen);
+    return true;
+}
@@ -0,0 +1,48 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YACOIN_CRYPTO_CHACHA20POLY1305_H
+#define YACOIN_CRYPTO_CHACHA20POLY1305_H
+
+#include "crypto/chacha20.h"
+#include "crypto/poly1305.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** One direction of an authenticated-encryption stream built from ChaCha20
+ * and Poly1305, keyed once and used for a sequence of frames.
+ *
+ * Each frame is numbered by the caller with a strictly increasing 64-bit
+ * sequence number, used as the ChaCha20 IV. As in RFC 7539, the first
+ * keystream block of a frame keys a fresh Poly1305 instance and the payload
+ * is enciphered with the keystream from block one onward; the tag covers the
+ * associated data followed by the ciphertext. Reusing a sequence number under
+ * the same key destroys both confidentiality and authenticity, so callers
+ * must never rewind.
+ */
+class ChaCha20Poly1305
+{
+private:
+    ChaCha20 chacha;
+
+    void CryptInPlace(unsigned char* data, size_t len);
+
+public:
+    static const size_t TAGLEN = Poly1305::TAGLEN;
+    static const size_t KEYLEN = 32;
+
+    void SetKey(const unsigned char* key, size_t keylen);
+
+    //! Encrypt data in place as frame nSeq and write its tag.
+    void Seal(uint64_t nSeq, const unsigned char* aad, size_t aadlen,
+              unsigned char* data, size_t datalen, unsigned char* tag);
+
+    //! Verify the tag of frame nSeq and, on success, decrypt data in place.
+    //! Returns false (leaving data untouched) when the tag does not match.
+    bool Open(uint64_t nSeq, const unsigned char* aad, size_t aadlen,
+              unsigned char* data, size_t datalen, const unsigned char* tag);
+};
+
+#endif // YACOIN_CRYPTO_CHACHA20POLY1305_H
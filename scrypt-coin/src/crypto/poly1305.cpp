@@ -0,0 +1,148 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Based on the public domain poly1305-donna-32 by Andrew Moon.
+
+#include "crypto/poly1305.h"
+#include "crypto/common.h"
+
+#include <string.h>
+
+Poly1305& Poly1305::SetKey(const unsigned char* key)
+{
+    // r with the clamping required by the spec; 26-bit limbs
+    r[0] = (ReadLE32(key + 0)) & 0x3ffffff;
+    r[1] = (ReadLE32(key + 3) >> 2) & 0x3ffff03;
+    r[2] = (ReadLE32(key + 6) >> 4) & 0x3ffc0ff;
+    r[3] = (ReadLE32(key + 9) >> 6) & 0x3f03fff;
+    r[4] = (ReadLE32(key + 12) >> 8) & 0x00fffff;
+
+    pad[0] = ReadLE32(key + 16);
+    pad[1] = ReadLE32(key + 20);
+    pad[2] = ReadLE32(key + 24);
+    pad[3] = ReadLE32(key + 28);
+
+    h[0] = h[1] = h[2] = h[3] = h[4] = 0;
+    num = 0;
+    return *this;
+}
+
+void Poly1305::Blocks(const unsigned char* m, size_t len, uint32_t hibit)
+{
+    const uint32_t r0 = r[0], r1 = r[1], r2 = r[2], r3 = r[3], r4 = r[4];
+    const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+    uint32_t h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+
+    while (len >= 16) {
+        // h += m[i], the block extended with hibit (2^128 for full blocks)
+        h0 += (ReadLE32(m + 0)) & 0x3ffffff;
+        h1 += (ReadLE32(m + 3) >> 2) & 0x3ffffff;
+        h2 += (ReadLE32(m + 6) >> 4) & 0x3ffffff;
+        h3 += (ReadLE32(m + 9) >> 6) & 0x3ffffff;
+        h4 += (ReadLE32(m + 12) >> 8) | hibit;
+
+        // h *= r mod 2^130 - 5
+        uint64_t d0 = (uint64_t)h0 * r0 + (uint64_t)h1 * s4 + (uint64_t)h2 * s3 + (uint64_t)h3 * s2 + (uint64_t)h4 * s1;
+        uint64_t d1 = (uint64_t)h0 * r1 + (uint64_t)h1 * r0 + (uint64_t)h2 * s4 + (uint64_t)h3 * s3 + (uint64_t)h4 * s2;
+        uint64_t d2 = (uint64_t)h0 * r2 + (uint64_t)h1 * r1 + (uint64_t)h2 * r0 + (uint64_t)h3 * s4 + (uint64_t)h4 * s3;
+        uint64_t d3 = (uint64_t)h0 * r3 + (uint64_t)h1 * r2 + (uint64_t)h2 * r1 + (uint64_t)h3 * r0 + (uint64_t)h4 * s4;
+        uint64_t d4 = (uint64_t)h0 * r4 + (uint64_t)h1 * r3 + (uint64_t)h2 * r2 + (uint64_t)h3 * r1 + (uint64_t)h4 * r0;
+
+        // partial carry propagation
+        uint64_t c;
+        c = d0 >> 26; h0 = d0 & 0x3ffffff; d1 += c;
+        c = d1 >> 26; h1 = d1 & 0x3ffffff; d2 += c;
+        c = d2 >> 26; h2 = d2 & 0x3ffffff; d3 += c;
+        c = d3 >> 26; h3 = d3 & 0x3ffffff; d4 += c;
+        c = d4 >> 26; h4 = d4 & 0x3ffffff; h0 += (uint32_t)c * 5;
+        c = h0 >> 26; h0 &= 0x3ffffff; h1 += (uint32_t)c;
+
+        m += 16;
+        len -= 16;
+    }
+
+    h[0] = h0; h[1] = h1; h[2] = h2; h[3] = h3; h[4] = h4;
+}
+
+Poly1305& Poly1305::Write(const unsigned char* data, size_t len)
+{
+    // top up a partial block first
+    if (num) {
+        size_t nFill = 16 - num;
+        if (nFill > len)
+            nFill = len;
+        memcpy(buf + num, data, nFill);
+        num += nFill;
+        data += nFill;
+        len -= nFill;
+        if (num < 16)
+            return *this;
+        Blocks(buf, 16, 1 << 24);
+        num = 0;
+    }
+
+    size_t nWhole = len & ~(size_t)15;
+    if (nWhole) {
+        Blocks(data, nWhole, 1 << 24);
+        data += nWhole;
+        len -= nWhole;
+    }
+    if (len) {
+        memcpy(buf, data, len);
+        num = len;
+    }
+    return *this;
+}
+
+void Poly1305::Finalize(unsigned char tag[TAGLEN])
+{
+    // process the trailing partial block, padded with 1 then zeros
+    if (num) {
+        buf[num] = 1;
+        memset(buf + num + 1, 0, 16 - num - 1);
+        Blocks(buf, 16, 0);
+    }
+
+    uint32_t h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+
+    // full carry propagation
+    uint32_t c;
+    c = h1 >> 26; h1 &= 0x3ffffff; h2 += c;
+    c = h2 >> 26; h2 &= 0x3ffffff; h3 += c;
+    c = h3 >> 26; h3 &= 0x3ffffff; h4 += c;
+    c = h4 >> 26; h4 &= 0x3ffffff; h0 += c * 5;
+    c = h0 >> 26; h0 &= 0x3ffffff; h1 += c;
+
+    // select h or h - p in constant time
+    uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+    uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+    uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+    uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+    uint32_t g4 = h4 + c - (1 << 26);
+
+    uint32_t mask = (g4 >> 31) - 1; // all ones iff h >= p
+    h0 = (h0 & ~mask) | (g0 & mask);
+    h1 = (h1 & ~mask) | (g1 & mask);
+    h2 = (h2 & ~mask) | (g2 & mask);
+    h3 = (h3 & ~mask) | (g3 & mask);
+    h4 = (h4 & ~mask) | (g4 & mask);
+
+    // h mod 2^128, repacked into 32-bit words
+    h0 = (h0 | (h1 << 26));
+    h1 = ((h1 >> 6) | (h2 << 20));
+    h2 = ((h2 >> 12) | (h3 << 14));
+    h3 = ((h3 >> 18) | (h4 << 8));
+
+    // tag = (h + pad) mod 2^128
+    uint64_t f;
+    f = (uint64_t)h0 + pad[0];              h0 = (uint32_t)f;
+    f = (uint64_t)h1 + pad[1] + (f >> 32);  h1 = (uint32_t)f;
+    f = (uint64_t)h2 + pad[2] + (f >> 32);  h2 = (uint32_t)f;
+    f = (uint64_t)h3 + pad[3] + (f >> 32);  h3 = (uint32_t)f;
+
+    WriteLE32(tag + 0, h0);
+    WriteLE32(tag + 4, h1);
+    WriteLE32(tag + 8, h2);
+    WriteLE32(tag + 12, h3);
+}
@@ -0,0 +1,38 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YACOIN_CRYPTO_POLY1305_H
+#define YACOIN_CRYPTO_POLY1305_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** A streaming Poly1305 one-time authenticator (RFC 7539).
+ *
+ * The 32-byte key is one-time: authenticating two different messages under
+ * the same key forfeits all security. Callers derive a fresh key per message
+ * from a cipher keystream (see ChaCha20Poly1305).
+ */
+class Poly1305
+{
+private:
+    uint32_t r[5];
+    uint32_t h[5];
+    uint32_t pad[4];
+    unsigned char buf[16];
+    size_t num;
+
+    void Blocks(const unsigned char* m, size_t len, uint32_t hibit);
+
+public:
+    static const size_t TAGLEN = 16;
+    static const size_t KEYLEN = 32;
+
+    //! Begin authenticating a message under a fresh 32-byte one-time key.
+    Poly1305& SetKey(const unsigned char* key);
+    Poly1305& Write(const unsigned char* data, size_t len);
+    void Finalize(unsigned char tag[TAGLEN]);
+};
+
+#endif // YACOIN_CRYPTO_POLY1305_H
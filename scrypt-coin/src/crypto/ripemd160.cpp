@@ -236,6 +236,245 @@ void Transform(uint32_t* s, const unsigned char* chunk)
 
 } // namespace ripemd160
 
+#if defined(__x86_64__) || defined(__amd64__) || defined(__SSE2__)
+#define RIPEMD160_4WAY_SSE2
+#include <emmintrin.h>
+
+/// 4-way SSE2 RIPEMD-160 for fixed 32-byte messages (one lane per message).
+namespace ripemd160_4way
+{
+__m128i inline Add(__m128i a, __m128i b) { return _mm_add_epi32(a, b); }
+__m128i inline Xor(__m128i a, __m128i b) { return _mm_xor_si128(a, b); }
+__m128i inline Or(__m128i a, __m128i b) { return _mm_or_si128(a, b); }
+__m128i inline And(__m128i a, __m128i b) { return _mm_and_si128(a, b); }
+__m128i inline Not(__m128i a) { return _mm_xor_si128(a, _mm_set1_epi32(-1)); }
+__m128i inline Rol(__m128i x, int i) { return Or(_mm_slli_epi32(x, i), _mm_srli_epi32(x, 32 - i)); }
+__m128i inline K(uint32_t k) { return _mm_set1_epi32(k); }
+
+__m128i inline F1(__m128i x, __m128i y, __m128i z) { return Xor(x, Xor(y, z)); }
+__m128i inline F2(__m128i x, __m128i y, __m128i z) { return Or(And(x, y), _mm_andnot_si128(x, z)); }
+__m128i inline F3(__m128i x, __m128i y, __m128i z) { return Xor(Or(x, Not(y)), z); }
+__m128i inline F4(__m128i x, __m128i y, __m128i z) { return Or(And(x, z), _mm_andnot_si128(z, y)); }
+__m128i inline F5(__m128i x, __m128i y, __m128i z) { return Xor(x, Or(y, Not(z))); }
+
+void inline Round(__m128i& a, __m128i& c, __m128i e, __m128i f, __m128i x, uint32_t k, int r)
+{
+    a = Add(Rol(Add(Add(Add(a, f), x), K(k)), r), e);
+    c = Rol(c, 10);
+}
+
+void inline R11(__m128i& a, __m128i b, __m128i& c, __m128i d, __m128i e, __m128i x, int r) { Round(a, c, e, F1(b, c, d), x, 0, r); }
+void inline R21(__m128i& a, __m128i b, __m128i& c, __m128i d, __m128i e, __m128i x, int r) { Round(a, c, e, F2(b, c, d), x, 0x5A827999ul, r); }
+void inline R31(__m128i& a, __m128i b, __m128i& c, __m128i d, __m128i e, __m128i x, int r) { Round(a, c, e, F3(b, c, d), x, 0x6ED9EBA1ul, r); }
+void inline R41(__m128i& a, __m128i b, __m128i& c, __m128i d, __m128i e, __m128i x, int r) { Round(a, c, e, F4(b, c, d), x, 0x8F1BBCDCul, r); }
+void inline R51(__m128i& a, __m128i b, __m128i& c, __m128i d, __m128i e, __m128i x, int r) { Round(a, c, e, F5(b, c, d), x, 0xA953FD4Eul, r); }
+
+void inline R12(__m128i& a, __m128i b, __m128i& c, __m128i d, __m128i e, __m128i x, int r) { Round(a, c, e, F5(b, c, d), x, 0x50A28BE6ul, r); }
+void inline R22(__m128i& a, __m128i b, __m128i& c, __m128i d, __m128i e, __m128i x, int r) { Round(a, c, e, F4(b, c, d), x, 0x5C4DD124ul, r); }
+void inline R32(__m128i& a, __m128i b, __m128i& c, __m128i d, __m128i e, __m128i x, int r) { Round(a, c, e, F3(b, c, d), x, 0x6D703EF3ul, r); }
+void inline R42(__m128i& a, __m128i b, __m128i& c, __m128i d, __m128i e, __m128i x, int r) { Round(a, c, e, F2(b, c, d), x, 0x7A6D76E9ul, r); }
+void inline R52(__m128i& a, __m128i b, __m128i& c, __m128i d, __m128i e, __m128i x, int r) { Round(a, c, e, F1(b, c, d), x, 0, r); }
+
+__m128i inline ReadLane32(const unsigned char* input, int nWord)
+{
+    return _mm_set_epi32(ReadLE32(input + 96 + 4 * nWord), ReadLE32(input + 64 + 4 * nWord),
+                         ReadLE32(input + 32 + 4 * nWord), ReadLE32(input + 4 * nWord));
+}
+
+/** Hash four independent 32-byte messages. Each message pads out to a single
+ *  64-byte block (0x80, zeros, 256-bit length), so the whole digest is one
+ *  pass over the dual pipelines with the padding words held as constants. */
+void Transform(const unsigned char* input, unsigned char* output)
+{
+    __m128i A1 = K(0x67452301ul), B1 = K(0xEFCDAB89ul), C1 = K(0x98BADCFEul), D1 = K(0x10325476ul), E1 = K(0xC3D2E1F0ul);
+    __m128i A2 = A1, B2 = B1, C2 = C1, D2 = D1, E2 = E1;
+    __m128i W0 = ReadLane32(input, 0), W1 = ReadLane32(input, 1), W2 = ReadLane32(input, 2), W3 = ReadLane32(input, 3);
+    __m128i W4 = ReadLane32(input, 4), W5 = ReadLane32(input, 5), W6 = ReadLane32(input, 6), W7 = ReadLane32(input, 7);
+    const __m128i W8 = K(0x80ul), W9 = K(0), W10 = K(0), W11 = K(0), W12 = K(0), W13 = K(0), W14 = K(32 << 3), W15 = K(0);
+
+    R11(A1, B1, C1, D1, E1, W0, 11);
+    R12(A2, B2, C2, D2, E2, W5, 8);
+    R11(E1, A1, B1, C1, D1, W1, 14);
+    R12(E2, A2, B2, C2, D2, W14, 9);
+    R11(D1, E1, A1, B1, C1, W2, 15);
+    R12(D2, E2, A2, B2, C2, W7, 9);
+    R11(C1, D1, E1, A1, B1, W3, 12);
+    R12(C2, D2, E2, A2, B2, W0, 11);
+    R11(B1, C1, D1, E1, A1, W4, 5);
+    R12(B2, C2, D2, E2, A2, W9, 13);
+    R11(A1, B1, C1, D1, E1, W5, 8);
+    R12(A2, B2, C2, D2, E2, W2, 15);
+    R11(E1, A1, B1, C1, D1, W6, 7);
+    R12(E2, A2, B2, C2, D2, W11, 15);
+    R11(D1, E1, A1, B1, C1, W7, 9);
+    R12(D2, E2, A2, B2, C2, W4, 5);
+    R11(C1, D1, E1, A1, B1, W8, 11);
+    R12(C2, D2, E2, A2, B2, W13, 7);
+    R11(B1, C1, D1, E1, A1, W9, 13);
+    R12(B2, C2, D2, E2, A2, W6, 7);
+    R11(A1, B1, C1, D1, E1, W10, 14);
+    R12(A2, B2, C2, D2, E2, W15, 8);
+    R11(E1, A1, B1, C1, D1, W11, 15);
+    R12(E2, A2, B2, C2, D2, W8, 11);
+    R11(D1, E1, A1, B1, C1, W12, 6);
+    R12(D2, E2, A2, B2, C2, W1, 14);
+    R11(C1, D1, E1, A1, B1, W13, 7);
+    R12(C2, D2, E2, A2, B2, W10, 14);
+    R11(B1, C1, D1, E1, A1, W14, 9);
+    R12(B2, C2, D2, E2, A2, W3, 12);
+    R11(A1, B1, C1, D1, E1, W15, 8);
+    R12(A2, B2, C2, D2, E2, W12, 6);
+
+    R21(E1, A1, B1, C1, D1, W7, 7);
+    R22(E2, A2, B2, C2, D2, W6, 9);
+    R21(D1, E1, A1, B1, C1, W4, 6);
+    R22(D2, E2, A2, B2, C2, W11, 13);
+    R21(C1, D1, E1, A1, B1, W13, 8);
+    R22(C2, D2, E2, A2, B2, W3, 15);
+    R21(B1, C1, D1, E1, A1, W1, 13);
+    R22(B2, C2, D2, E2, A2, W7, 7);
+    R21(A1, B1, C1, D1, E1, W10, 11);
+    R22(A2, B2, C2, D2, E2, W0, 12);
+    R21(E1, A1, B1, C1, D1, W6, 9);
+    R22(E2, A2, B2, C2, D2, W13, 8);
+    R21(D1, E1, A1, B1, C1, W15, 7);
+    R22(D2, E2, A2, B2, C2, W5, 9);
+    R21(C1, D1, E1, A1, B1, W3, 15);
+    R22(C2, D2, E2, A2, B2, W10, 11);
+    R21(B1, C1, D1, E1, A1, W12, 7);
+    R22(B2, C2, D2, E2, A2, W14, 7);
+    R21(A1, B1, C1, D1, E1, W0, 12);
+    R22(A2, B2, C2, D2, E2, W15, 7);
+    R21(E1, A1, B1, C1, D1, W9, 15);
+    R22(E2, A2, B2, C2, D2, W8, 12);
+    R21(D1, E1, A1, B1, C1, W5, 9);
+    R22(D2, E2, A2, B2, C2, W12, 7);
+    R21(C1, D1, E1, A1, B1, W2, 11);
+    R22(C2, D2, E2, A2, B2, W4, 6);
+    R21(B1, C1, D1, E1, A1, W14, 7);
+    R22(B2, C2, D2, E2, A2, W9, 15);
+    R21(A1, B1, C1, D1, E1, W11, 13);
+    R22(A2, B2, C2, D2, E2, W1, 13);
+    R21(E1, A1, B1, C1, D1, W8, 12);
+    R22(E2, A2, B2, C2, D2, W2, 11);
+
+    R31(D1, E1, A1, B1, C1, W3, 11);
+    R32(D2, E2, A2, B2, C2, W15, 9);
+    R31(C1, D1, E1, A1, B1, W10, 13);
+    R32(C2, D2, E2, A2, B2, W5, 7);
+    R31(B1, C1, D1, E1, A1, W14, 6);
+    R32(B2, C2, D2, E2, A2, W1, 15);
+    R31(A1, B1, C1, D1, E1, W4, 7);
+    R32(A2, B2, C2, D2, E2, W3, 11);
+    R31(E1, A1, B1, C1, D1, W9, 14);
+    R32(E2, A2, B2, C2, D2, W7, 8);
+    R31(D1, E1, A1, B1, C1, W15, 9);
+    R32(D2, E2, A2, B2, C2, W14, 6);
+    R31(C1, D1, E1, A1, B1, W8, 13);
+    R32(C2, D2, E2, A2, B2, W6, 6);
+    R31(B1, C1, D1, E1, A1, W1, 15);
+    R32(B2, C2, D2, E2, A2, W9, 14);
+    R31(A1, B1, C1, D1, E1, W2, 14);
+    R32(A2, B2, C2, D2, E2, W11, 12);
+    R31(E1, A1, B1, C1, D1, W7, 8);
+    R32(E2, A2, B2, C2, D2, W8, 13);
+    R31(D1, E1, A1, B1, C1, W0, 13);
+    R32(D2, E2, A2, B2, C2, W12, 5);
+    R31(C1, D1, E1, A1, B1, W6, 6);
+    R32(C2, D2, E2, A2, B2, W2, 14);
+    R31(B1, C1, D1, E1, A1, W13, 5);
+    R32(B2, C2, D2, E2, A2, W10, 13);
+    R31(A1, B1, C1, D1, E1, W11, 12);
+    R32(A2, B2, C2, D2, E2, W0, 13);
+    R31(E1, A1, B1, C1, D1, W5, 7);
+    R32(E2, A2, B2, C2, D2, W4, 7);
+    R31(D1, E1, A1, B1, C1, W12, 5);
+    R32(D2, E2, A2, B2, C2, W13, 5);
+
+    R41(C1, D1, E1, A1, B1, W1, 11);
+    R42(C2, D2, E2, A2, B2, W8, 15);
+    R41(B1, C1, D1, E1, A1, W9, 12);
+    R42(B2, C2, D2, E2, A2, W6, 5);
+    R41(A1, B1, C1, D1, E1, W11, 14);
+    R42(A2, B2, C2, D2, E2, W4, 8);
+    R41(E1, A1, B1, C1, D1, W10, 15);
+    R42(E2, A2, B2, C2, D2, W1, 11);
+    R41(D1, E1, A1, B1, C1, W0, 14);
+    R42(D2, E2, A2, B2, C2, W3, 14);
+    R41(C1, D1, E1, A1, B1, W8, 15);
+    R42(C2, D2, E2, A2, B2, W11, 14);
+    R41(B1, C1, D1, E1, A1, W12, 9);
+    R42(B2, C2, D2, E2, A2, W15, 6);
+    R41(A1, B1, C1, D1, E1, W4, 8);
+    R42(A2, B2, C2, D2, E2, W0, 14);
+    R41(E1, A1, B1, C1, D1, W13, 9);
+    R42(E2, A2, B2, C2, D2, W5, 6);
+    R41(D1, E1, A1, B1, C1, W3, 14);
+    R42(D2, E2, A2, B2, C2, W12, 9);
+    R41(C1, D1, E1, A1, B1, W7, 5);
+    R42(C2, D2, E2, A2, B2, W2, 12);
+    R41(B1, C1, D1, E1, A1, W15, 6);
+    R42(B2, C2, D2, E2, A2, W13, 9);
+    R41(A1, B1, C1, D1, E1, W14, 8);
+    R42(A2, B2, C2, D2, E2, W9, 12);
+    R41(E1, A1, B1, C1, D1, W5, 6);
+    R42(E2, A2, B2, C2, D2, W7, 5);
+    R41(D1, E1, A1, B1, C1, W6, 5);
+    R42(D2, E2, A2, B2, C2, W10, 15);
+    R41(C1, D1, E1, A1, B1, W2, 12);
+    R42(C2, D2, E2, A2, B2, W14, 8);
+
+    R51(B1, C1, D1, E1, A1, W4, 9);
+    R52(B2, C2, D2, E2, A2, W12, 8);
+    R51(A1, B1, C1, D1, E1, W0, 15);
+    R52(A2, B2, C2, D2, E2, W15, 5);
+    R51(E1, A1, B1, C1, D1, W5, 5);
+    R52(E2, A2, B2, C2, D2, W10, 12);
+    R51(D1, E1, A1, B1, C1, W9, 11);
+    R52(D2, E2, A2, B2, C2, W4, 9);
+    R51(C1, D1, E1, A1, B1, W7, 6);
+    R52(C2, D2, E2, A2, B2, W1, 12);
+    R51(B1, C1, D1, E1, A1, W12, 8);
+    R52(B2, C2, D2, E2, A2, W5, 5);
+    R51(A1, B1, C1, D1, E1, W2, 13);
+    R52(A2, B2, C2, D2, E2, W8, 14);
+    R51(E1, A1, B1, C1, D1, W10, 12);
+    R52(E2, A2, B2, C2, D2, W7, 6);
+    R51(D1, E1, A1, B1, C1, W14, 5);
+    R52(D2, E2, A2, B2, C2, W6, 8);
+    R51(C1, D1, E1, A1, B1, W1, 12);
+    R52(C2, D2, E2, A2, B2, W2, 13);
+    R51(B1, C1, D1, E1, A1, W3, 13);
+    R52(B2, C2, D2, E2, A2, W13, 6);
+    R51(A1, B1, C1, D1, E1, W8, 14);
+    R52(A2, B2, C2, D2, E2, W14, 5);
+    R51(E1, A1, B1, C1, D1, W11, 11);
+    R52(E2, A2, B2, C2, D2, W0, 15);
+    R51(D1, E1, A1, B1, C1, W6, 8);
+    R52(D2, E2, A2, B2, C2, W3, 13);
+    R51(C1, D1, E1, A1, B1, W15, 5);
+    R52(C2, D2, E2, A2, B2, W9, 11);
+    R51(B1, C1, D1, E1, A1, W13, 6);
+    R52(B2, C2, D2, E2, A2, W11, 11);
+
+    uint32_t vs[5][4];
+    _mm_storeu_si128((__m128i*)vs[0], Add(Add(K(0xEFCDAB89ul), C1), D2));
+    _mm_storeu_si128((__m128i*)vs[1], Add(Add(K(0x98BADCFEul), D1), E2));
+    _mm_storeu_si128((__m128i*)vs[2], Add(Add(K(0x10325476ul), E1), A2));
+    _mm_storeu_si128((__m128i*)vs[3], Add(Add(K(0xC3D2E1F0ul), A1), B2));
+    _mm_storeu_si128((__m128i*)vs[4], Add(Add(K(0x67452301ul), B1), C2));
+    for (int j = 0; j < 4; j++) {
+        WriteLE32(output + 20 * j, vs[0][j]);
+        WriteLE32(output + 20 * j + 4, vs[1][j]);
+        WriteLE32(output + 20 * j + 8, vs[2][j]);
+        WriteLE32(output + 20 * j + 12, vs[3][j]);
+        WriteLE32(output + 20 * j + 16, vs[4][j]);
+    }
+}
+
+} // namespace ripemd160_4way
+#endif // x86
+
 } // namespace
 
 ////// RIPEMD160
@@ -291,3 +530,13 @@ CRIPEMD160& CRIPEMD160::Reset()
     ripemd160::Initialize(s);
     return *this;
 }
+
+void RIPEMD160D32_4Way(const unsigned char* input, unsigned char* output)
+{
+#ifdef RIPEMD160_4WAY_SSE2
+    ripemd160_4way::Transform(input, output);
+#else
+    for (int j = 0; j < 4; j++)
+        CRIPEMD160().Write(input + 32 * j, 32).Finalize(output + 20 * j);
+#endif
+}
@@ -26,4 +26,16 @@ public:
     CRIPEMD160& Reset();
 };
 
+/** Compute four independent RIPEMD-160 digests of 32-byte messages.
+ *  input:  pointer to a 4*32 byte buffer (the four messages, concatenated)
+ *  output: pointer to a 4*20 byte buffer receiving the four digests
+ *
+ *  The fixed 32-byte message size matches a SHA256 digest, which is the only
+ *  multi-buffer shape the node needs (Hash160 batching, see Hash160Batch() in
+ *  hash.h); each message pads out to a single block, so the SSE2 transform
+ *  runs exactly once with one message per lane. Falls back to four scalar
+ *  digests on targets without SSE2.
+ */
+void RIPEMD160D32_4Way(const unsigned char* input, unsigned char* output);
+
 #endif // YACOIN_CRYPTO_RIPEMD160_H
@@ -11,13 +11,36 @@
 #include <atomic>
 
 #if defined(__x86_64__) || defined(__amd64__)
-#if defined(EXPERIMENTAL_ASM)
+#if defined(EXPERIMENTAL_ASM) || defined(ENABLE_SHANI) || defined(ENABLE_AVX2)
 #include <cpuid.h>
+#endif
+#if defined(EXPERIMENTAL_ASM)
 namespace sha256_sse4
 {
 void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
 }
 #endif
+#if defined(ENABLE_SHANI)
+namespace sha256_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
+}
+namespace sha256d64_shani
+{
+void Transform_2way(unsigned char* out, const unsigned char* in);
+}
+#endif
+#if defined(ENABLE_AVX2)
+namespace sha256d64_avx2
+{
+void Transform_8way(unsigned char* out, const unsigned char* in);
+}
+namespace sha256_avx2_mb
+{
+void Initialize_8way(uint32_t* s);
+void Transform_8way(uint32_t* s, const unsigned char* in);
+}
+#endif
 #endif
 
 // Internal implementation code.
@@ -175,21 +198,141 @@ bool SelfTest(TransformType tr) {
 
 TransformType Transform = sha256::Transform;
 
+typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+
+/** Double-SHA256 a 64-byte input through any single-block Transform. */
+template<TransformType tr>
+void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
+{
+    uint32_t s[8];
+    static const unsigned char padding1[64] = {
+        0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0
+    };
+    unsigned char buffer2[64] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0
+    };
+    sha256::Initialize(s);
+    tr(s, in, 1);
+    tr(s, padding1, 1);
+    WriteBE32(buffer2 + 0, s[0]);
+    WriteBE32(buffer2 + 4, s[1]);
+    WriteBE32(buffer2 + 8, s[2]);
+    WriteBE32(buffer2 + 12, s[3]);
+    WriteBE32(buffer2 + 16, s[4]);
+    WriteBE32(buffer2 + 20, s[5]);
+    WriteBE32(buffer2 + 24, s[6]);
+    WriteBE32(buffer2 + 28, s[7]);
+    sha256::Initialize(s);
+    tr(s, buffer2, 1);
+    WriteBE32(out + 0, s[0]);
+    WriteBE32(out + 4, s[1]);
+    WriteBE32(out + 8, s[2]);
+    WriteBE32(out + 12, s[3]);
+    WriteBE32(out + 16, s[4]);
+    WriteBE32(out + 20, s[5]);
+    WriteBE32(out + 24, s[6]);
+    WriteBE32(out + 28, s[7]);
+}
+
+TransformD64Type TransformD64 = TransformD64Wrapper<sha256::Transform>;
+TransformD64Type TransformD64_2way = nullptr;
+TransformD64Type TransformD64_8way = nullptr;
+bool Have8WayMB = false;
+
+/** Check an N-way double-SHA256 transform against the basic implementation. */
+bool SelfTestD64(TransformD64Type tr, size_t lanes)
+{
+    unsigned char in[8 * 64];
+    unsigned char out[8 * 32], expect[8 * 32];
+    for (size_t i = 0; i < sizeof(in); ++i)
+        in[i] = (unsigned char)(i * 0x2d + 1);
+    for (size_t i = 0; i < lanes; ++i)
+        TransformD64Wrapper<sha256::Transform>(expect + 32 * i, in + 64 * i);
+    tr(out, in);
+    return memcmp(out, expect, 32 * lanes) == 0;
+}
+
+#if (defined(__x86_64__) || defined(__amd64__)) && defined(ENABLE_AVX2)
+/** Check whether the OS has enabled AVX registers (XCR0 bits 1 and 2). */
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+
+/** Check the generic 8-way transform against the basic implementation. */
+bool SelfTest8WayMB()
+{
+    unsigned char in[8 * 64];
+    uint32_t s8[64], expect[8];
+    for (size_t i = 0; i < sizeof(in); ++i)
+        in[i] = (unsigned char)(i * 0x3b + 5);
+    sha256_avx2_mb::Initialize_8way(s8);
+    sha256_avx2_mb::Transform_8way(s8, in);
+    for (int lane = 0; lane < 8; ++lane) {
+        sha256::Initialize(expect);
+        sha256::Transform(expect, in + 64 * lane, 1);
+        for (int i = 0; i < 8; ++i)
+            if (s8[8 * i + lane] != expect[i]) return false;
+    }
+    return true;
+}
+#endif
+
 } // namespace
 
 std::string SHA256AutoDetect()
 {
-#if defined(EXPERIMENTAL_ASM) && (defined(__x86_64__) || defined(__amd64__))
+    std::string ret = "standard";
+#if (defined(__x86_64__) || defined(__amd64__)) && (defined(EXPERIMENTAL_ASM) || defined(ENABLE_SHANI) || defined(ENABLE_AVX2))
     uint32_t eax, ebx, ecx, edx;
-    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx >> 19) & 1) {
-        Transform = sha256_sse4::Transform;
-        assert(SelfTest(Transform));
-        return "sse4";
+    uint32_t eax7 = 0, ebx7 = 0, ecx7 = 0, edx7 = 0;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        __cpuid_count(7, 0, eax7, ebx7, ecx7, edx7);
+#if defined(EXPERIMENTAL_ASM)
+        if ((ecx >> 19) & 1) {
+            Transform = sha256_sse4::Transform;
+            TransformD64 = TransformD64Wrapper<sha256_sse4::Transform>;
+            ret = "sse4";
+        }
+#endif
+#if defined(ENABLE_SHANI)
+        if ((ebx7 >> 29) & 1) {
+            Transform = sha256_shani::Transform;
+            TransformD64 = TransformD64Wrapper<sha256_shani::Transform>;
+            TransformD64_2way = sha256d64_shani::Transform_2way;
+            assert(SelfTestD64(TransformD64_2way, 2));
+            ret = "shani(1way,2way)";
+        }
+#endif
+#if defined(ENABLE_AVX2)
+        // AVX2 in the CPU is not enough: the OS must save the ymm registers too.
+        if (((ebx7 >> 5) & 1) && ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && AVXEnabled()) {
+            TransformD64_8way = sha256d64_avx2::Transform_8way;
+            assert(SelfTestD64(TransformD64_8way, 8));
+            Have8WayMB = true;
+            assert(SelfTest8WayMB());
+            ret += ",avx2(8way)";
+        }
+#endif
     }
 #endif
 
     assert(SelfTest(Transform));
-    return "standard";
+    assert(SelfTestD64(TransformD64, 1));
+    return ret;
+}
+
+bool SHA256Has8WayAVX2()
+{
+    return Have8WayMB;
 }
 
 ////// SHA-256
@@ -248,3 +391,29 @@ CSHA256& CSHA256::Reset()
     sha256::Initialize(s);
     return *this;
 }
+
+void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    if (TransformD64_8way) {
+        while (blocks >= 8) {
+            TransformD64_8way(out, in);
+            out += 8 * 32;
+            in += 8 * 64;
+            blocks -= 8;
+        }
+    }
+    if (TransformD64_2way) {
+        while (blocks >= 2) {
+            TransformD64_2way(out, in);
+            out += 2 * 32;
+            in += 2 * 64;
+            blocks -= 2;
+        }
+    }
+    while (blocks) {
+        TransformD64(out, in);
+        out += 32;
+        in += 64;
+        --blocks;
+    }
+}
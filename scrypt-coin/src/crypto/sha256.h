@@ -32,4 +32,22 @@ public:
  */
 std::string SHA256AutoDetect();
 
+/** Compute multiple double-SHA256's of 64-byte blobs.
+ *  output:  pointer to a blocks*32 byte output buffer
+ *  input:   pointer to a blocks*64 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ *
+ *  This is the multi-buffer entry point used for merkle tree levels, where
+ *  every node is the double hash of a 64-byte concatenation of two children;
+ *  independent inputs let SHA256AutoDetect() route to the 2-way SHA-NI or
+ *  8-way AVX2 transforms.
+ */
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
+
+/** Whether SHA256AutoDetect() enabled the generic 8-way AVX2 transform
+ *  (used by the multi-buffer PBKDF2 in pbkdf2.cpp). Only meaningful after
+ *  SHA256AutoDetect() has run.
+ */
+bool SHA256Has8WayAVX2();
+
 #endif // YACOIN_CRYPTO_SHA256_H
@@ -5,6 +5,15 @@
 #include <crypto/siphash.h>
 #include <assert.h>
 
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__))
+#include <crypto/sha256.h>
+
+namespace siphash_avx2
+{
+void Hash256_4way(uint64_t k0, uint64_t k1, const unsigned char* in, uint64_t out[4]);
+}
+#endif
+
 #define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
 
 #define SIPROUND do { \
@@ -132,6 +141,22 @@ uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val)
     return v0 ^ v1 ^ v2 ^ v3;
 }
 
+void SipHashUint256Batch(uint64_t k0, uint64_t k1, const uint256* vals, size_t n, uint64_t* out)
+{
+    size_t i = 0;
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__))
+    // SHA256AutoDetect() is the central CPU feature probe; its AVX2 flag
+    // covers the ymm integer ops used by the 4-way SipHash too.
+    if (SHA256Has8WayAVX2()) {
+        static_assert(sizeof(uint256) == 32, "4-way SipHash assumes packed uint256 lanes");
+        for (; i + 4 <= n; i += 4)
+            siphash_avx2::Hash256_4way(k0, k1, (const unsigned char*)&vals[i], out + i);
+    }
+#endif
+    for (; i < n; ++i)
+        out[i] = SipHashUint256(k0, k1, vals[i]);
+}
+
 uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra)
 {
     /* Specialized implementation for efficiency */
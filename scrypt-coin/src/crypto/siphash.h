@@ -44,4 +44,12 @@ public:
 uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val);
 uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra);
 
+/** SipHashUint256 over a contiguous batch of hashes under one key,
+ *  writing one 64-bit digest per input to out. Routes groups of four
+ *  through the AVX2 implementation when the CPU supports it (compact
+ *  block short IDs hash the whole mempool per block, so the batch form
+ *  is worth the dispatch).
+ */
+void SipHashUint256Batch(uint64_t k0, uint64_t k1, const uint256* vals, size_t n, uint64_t* out);
+
 #endif // BITCOIN_CRYPTO_SIPHASH_H
@@ -0,0 +1,86 @@
+// Copyright (c) 2025 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// 4-way SipHash-2-4 of uint256 inputs using AVX2: four independent hashes
+// are computed in parallel, one per 64-bit lane of the ymm registers.
+// Compiled in its own object with -mavx2; only called after the runtime
+// CPU probe has verified AVX2 support.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "crypto/common.h"
+
+namespace {
+
+__m256i inline K(uint64_t x) { return _mm256_set1_epi64x((int64_t)x); }
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi64(x, y); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline Rotl(__m256i x, int b)
+{
+    return _mm256_or_si256(_mm256_slli_epi64(x, b), _mm256_srli_epi64(x, 64 - b));
+}
+// Rotation by exactly 32 is a lane-local dword swap
+__m256i inline Rotl32(__m256i x) { return _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)); }
+
+#define SIPROUND4 do { \
+    v0 = Add(v0, v1); v1 = Rotl(v1, 13); v1 = Xor(v1, v0); \
+    v0 = Rotl32(v0); \
+    v2 = Add(v2, v3); v3 = Rotl(v3, 16); v3 = Xor(v3, v2); \
+    v0 = Add(v0, v3); v3 = Rotl(v3, 21); v3 = Xor(v3, v0); \
+    v2 = Add(v2, v1); v1 = Rotl(v1, 17); v1 = Xor(v1, v2); \
+    v2 = Rotl32(v2); \
+} while (0)
+
+/** Gather 64-bit word w from each of the four 32-byte inputs. */
+__m256i inline Read4(const unsigned char* in, int w)
+{
+    return _mm256_set_epi64x(
+        (int64_t)ReadLE64(in + 96 + 8 * w), (int64_t)ReadLE64(in + 64 + 8 * w),
+        (int64_t)ReadLE64(in + 32 + 8 * w), (int64_t)ReadLE64(in + 8 * w));
+}
+
+} // namespace
+
+namespace siphash_avx2
+{
+/** SipHash-2-4 of four 32-byte inputs (lane l at in + 32 * l) under one
+ *  (k0, k1) key; same construction as SipHashUint256(). */
+void Hash256_4way(uint64_t k0, uint64_t k1, const unsigned char* in, uint64_t out[4])
+{
+    __m256i d = Read4(in, 0);
+    __m256i v0 = K(0x736f6d6570736575ULL ^ k0);
+    __m256i v1 = K(0x646f72616e646f6dULL ^ k1);
+    __m256i v2 = K(0x6c7967656e657261ULL ^ k0);
+    __m256i v3 = Xor(K(0x7465646279746573ULL ^ k1), d);
+
+    SIPROUND4;
+    SIPROUND4;
+    v0 = Xor(v0, d);
+    for (int w = 1; w < 4; ++w) {
+        d = Read4(in, w);
+        v3 = Xor(v3, d);
+        SIPROUND4;
+        SIPROUND4;
+        v0 = Xor(v0, d);
+    }
+    d = K(((uint64_t)4) << 59);
+    v3 = Xor(v3, d);
+    SIPROUND4;
+    SIPROUND4;
+    v0 = Xor(v0, d);
+    v2 = Xor(v2, K(0xFF));
+    SIPROUND4;
+    SIPROUND4;
+    SIPROUND4;
+    SIPROUND4;
+
+    _mm256_storeu_si256((__m256i*)out, Xor(Xor(v0, v1), Xor(v2, v3)));
+}
+} // namespace siphash_avx2
+
+#endif // ENABLE_AVX2
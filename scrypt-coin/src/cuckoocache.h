@@ -369,6 +369,19 @@ public:
         return setup(bytes/sizeof(Element));
     }
 
+    /** clear discards every element and starts a fresh epoch. Not
+     * threadsafe with concurrent inserts or lookups.
+     */
+    void clear()
+    {
+        for (uint32_t i = 0; i < size; ++i) {
+            table[i] = Element();
+            epoch_flags[i] = false;
+            allow_erase(i);
+        }
+        epoch_heuristic_counter = epoch_size;
+    }
+
     /** insert loops at most depth_limit times trying to insert a hash
      * at various locations in the table via a variant of the Cuckoo Algorithm
      * with eight hash locations.
@@ -6,6 +6,7 @@
 #include "dbwrapper.h"
 
 #include "fs.h"
+#include "hash.h"
 #include "util.h"
 #include "random.h"
 
@@ -15,6 +16,8 @@
 #include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
+#include <atomic>
+#include <memory>
 
 class CBitcoinLevelDBLogger : public leveldb::Logger {
 public:
@@ -74,14 +77,165 @@ public:
     }
 };
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+//! Upper bound on how long a compaction kick may be held back. This is the
+//! safety valve for the one case where the foreground needs the background:
+//! if a write stalls on the level-0 file limit, LevelDB waits for exactly the
+//! compaction we are holding, so the holdoff must expire on its own.
+static const int64_t MAX_COMPACTION_HOLDOFF_MS = 2000;
+
+/** Env shared by every on-disk CDBWrapper. The only work DBImpl hands to
+ * Env::Schedule is the background compaction kick, so routing it through a
+ * trampoline that waits while CDBThrottleBackgroundWork guards are alive
+ * keeps compaction I/O out of the latency-sensitive spans of the write path
+ * without touching the vendored LevelDB.
+ */
+class CDBThrottledEnv : public leveldb::EnvWrapper
+{
+public:
+    CDBThrottledEnv() : leveldb::EnvWrapper(leveldb::Env::Default()), nThrottleDepth(0) {}
+
+    virtual void Schedule(void (*function)(void*), void* arg)
+    {
+        leveldb::EnvWrapper::Schedule(&CDBThrottledEnv::RunJob, new ScheduledJob{this, function, arg});
+    }
+
+    void Throttle()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++nThrottleDepth;
+    }
+
+    void Release()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --nThrottleDepth;
+        }
+        condvar.notify_all();
+    }
+
+private:
+    struct ScheduledJob
+    {
+        CDBThrottledEnv* penv;
+        void (*function)(void*);
+        void* arg;
+    };
+
+    static void RunJob(void* arg)
+    {
+        ScheduledJob* job = static_cast<ScheduledJob*>(arg);
+        CDBThrottledEnv* penv = job->penv;
+        {
+            std::unique_lock<std::mutex> lock(penv->mutex);
+            penv->condvar.wait_for(lock, std::chrono::milliseconds(MAX_COMPACTION_HOLDOFF_MS),
+                                   [penv] { return penv->nThrottleDepth == 0; });
+        }
+        void (*function)(void*) = job->function;
+        void* farg = job->arg;
+        delete job;
+        function(farg);
+    }
+
+    std::mutex mutex;
+    std::condition_variable condvar;
+    int nThrottleDepth;
+};
+
+static CDBThrottledEnv& ThrottledEnv()
+{
+    // Leaked on purpose: the background thread may still run jobs during
+    // static destruction, after the CDBWrapper globals are gone.
+    static CDBThrottledEnv* env = new CDBThrottledEnv();
+    return *env;
+}
+
+CDBThrottleBackgroundWork::CDBThrottleBackgroundWork()
+{
+    ThrottledEnv().Throttle();
+}
+
+CDBThrottleBackgroundWork::~CDBThrottleBackgroundWork()
+{
+    ThrottledEnv().Release();
+}
+
+/** A per-database facade over the process-wide block cache created by
+ * InitSharedDBBlockCache. Every call forwards to the shared LRU cache, so the
+ * combined capacity flows to whichever database is hot, while each facade
+ * keeps its own live-charge counter so TotalCharge() still reports a
+ * per-database figure. The counter is owned jointly with the cache entries
+ * because evictions can outlive the facade: a database may be closed while
+ * its blocks are still resident.
+ */
+class CDBSharedCacheShare : public leveldb::Cache
+{
+public:
+    explicit CDBSharedCacheShare(leveldb::Cache* pcacheIn)
+        : pcache(pcacheIn), pnCharge(std::make_shared<std::atomic<size_t>>(0)) {}
+
+    virtual Handle* Insert(const leveldb::Slice& key, void* value, size_t charge,
+                           void (*deleter)(const leveldb::Slice&, void*))
+    {
+        *pnCharge += charge;
+        Entry* entry = new Entry{value, deleter, pnCharge, charge};
+        return pcache->Insert(key, entry, charge, &CDBSharedCacheShare::DeleteEntry);
+    }
+
+    virtual Handle* Lookup(const leveldb::Slice& key) { return pcache->Lookup(key); }
+    virtual void Release(Handle* handle) { pcache->Release(handle); }
+    virtual void* Value(Handle* handle) { return static_cast<Entry*>(pcache->Value(handle))->value; }
+    virtual void Erase(const leveldb::Slice& key) { pcache->Erase(key); }
+    virtual uint64_t NewId() { return pcache->NewId(); }
+    virtual void Prune() { pcache->Prune(); }
+    virtual size_t TotalCharge() const { return pnCharge->load(); }
+
+private:
+    struct Entry
+    {
+        void* value;
+        void (*deleter)(const leveldb::Slice&, void*);
+        std::shared_ptr<std::atomic<size_t>> pnCharge;
+        size_t charge;
+    };
+
+    static void DeleteEntry(const leveldb::Slice& key, void* value)
+    {
+        Entry* entry = static_cast<Entry*>(value);
+        *entry->pnCharge -= entry->charge;
+        entry->deleter(key, entry->value);
+        delete entry;
+    }
+
+    leveldb::Cache* pcache;
+    std::shared_ptr<std::atomic<size_t>> pnCharge;
+};
+
+//! Process-wide block cache behind -dbsharedcache; remains nullptr (and each
+//! database keeps a private cache) unless InitSharedDBBlockCache runs. Leaked
+//! on purpose, for the same reason as ThrottledEnv().
+static leveldb::Cache* psharedBlockCache = nullptr;
+
+void InitSharedDBBlockCache(size_t nCapacity)
+{
+    assert(psharedBlockCache == nullptr);
+    psharedBlockCache = leveldb::NewLRUCache(nCapacity);
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const CDBOptions& dbOptions)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    if (psharedBlockCache != nullptr)
+        options.block_cache = new CDBSharedCacheShare(psharedBlockCache);
+    else
+        options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
+    size_t nWriteBufferSize = dbOptions.nWriteBufferSize ? dbOptions.nWriteBufferSize
+                                                         : nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
+    options.write_buffer_size = (size_t)gArgs.GetArg("-dbwritebuffer", nWriteBufferSize);
+    if (dbOptions.nBloomBitsPerKey > 0)
+        options.filter_policy = leveldb::NewBloomFilterPolicy(dbOptions.nBloomBitsPerKey);
     options.compression = leveldb::kNoCompression;
-    options.max_open_files = 64;
+    options.max_open_files = gArgs.GetArg("-dbmaxopenfiles", dbOptions.nMaxOpenFiles);
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
@@ -91,14 +245,20 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate, const CDBOptions& dbOptions)
 {
     penv = nullptr;
+    nBatchSeq = 0;
+    fBatchSeqReady = false;
+    fileJournal = nullptr;
+    nJournalFirstSeq = 0;
+    nJournalLastSeq = 0;
+    nJournalBytes = 0;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(nCacheSize, dbOptions);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -111,6 +271,7 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
         }
         TryCreateDirectories(path);
         LogPrintf("Opening LevelDB in %s\n", path.string());
+        options.env = &ThrottledEnv();
     }
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
@@ -140,10 +301,16 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     }
 
     LogPrintf("Using obfuscation key for %s: %s\n", path.string(), HexStr(obfuscate_key));
+
+    // Only now that the obfuscation key is in place; the bootstrap writes
+    // above must not carry (or read) an obfuscated sequence entry
+    Read(BATCH_SEQ_KEY, nBatchSeq);
+    fBatchSeqReady = true;
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    StopBackupJournal();
     delete pdb;
     pdb = nullptr;
     delete options.filter_policy;
@@ -158,11 +325,149 @@ CDBWrapper::~CDBWrapper()
 
 bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
+    // cs_journal is held across the sequence assignment, journal append and
+    // the leveldb write, so the journal sees batches in apply order. LevelDB
+    // serializes concurrent writers internally anyway, so the lock does not
+    // reduce parallelism.
+    LOCK(cs_journal);
+    uint64_t nSeq = 0;
+    if (fBatchSeqReady) {
+        nSeq = nBatchSeq + 1;
+        batch.Write(BATCH_SEQ_KEY, nSeq);
+        if (fileJournal)
+            AppendJournal(batch, nSeq);
+    }
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
     dbwrapper_private::HandleError(status);
+    if (nSeq)
+        nBatchSeq = nSeq;
     return true;
 }
 
+namespace {
+
+//! Serializes the operations of a leveldb write batch into a CDataStream,
+//! for the backup journal. Keys and values are journalled verbatim (values
+//! therefore obfuscated, like the database itself).
+class CDBJournalHandler : public leveldb::WriteBatch::Handler
+{
+public:
+    CDataStream* pss;
+
+    void Put(const leveldb::Slice& key, const leveldb::Slice& value) override
+    {
+        *pss << (unsigned char)'P';
+        *pss << std::string(key.data(), key.size());
+        *pss << std::string(value.data(), value.size());
+    }
+
+    void Delete(const leveldb::Slice& key) override
+    {
+        *pss << (unsigned char)'D';
+        *pss << std::string(key.data(), key.size());
+    }
+};
+
+//! One manifest line per completed segment: "<file> <firstseq> <lastseq>"
+void AppendJournalManifest(const fs::path& pathDir, const std::string& strName, uint64_t nFirstSeq, uint64_t nLastSeq)
+{
+    FILE* file = fsbridge::fopen(pathDir / "journal.manifest", "a");
+    if (!file) {
+        LogPrintf("CDBWrapper: cannot append to %s\n", (pathDir / "journal.manifest").string());
+        return;
+    }
+    fprintf(file, "%s %llu %llu\n", strName.c_str(), (unsigned long long)nFirstSeq, (unsigned long long)nLastSeq);
+    fclose(file);
+}
+
+std::string JournalSegmentName(uint64_t nFirstSeq)
+{
+    return strprintf("journal-%016x.dat", nFirstSeq);
+}
+
+} // namespace
+
+bool CDBWrapper::OpenJournalSegment(uint64_t nFirstSeq)
+{
+    fs::path pathSegment = pathJournalDir / JournalSegmentName(nFirstSeq);
+    fileJournal = fsbridge::fopen(pathSegment, "ab");
+    if (!fileJournal) {
+        LogPrintf("CDBWrapper: cannot open backup journal segment %s\n", pathSegment.string());
+        return false;
+    }
+    nJournalFirstSeq = nFirstSeq;
+    nJournalLastSeq = nFirstSeq - 1;
+    nJournalBytes = 0;
+    return true;
+}
+
+void CDBWrapper::CloseJournalSegment()
+{
+    if (!fileJournal)
+        return;
+    fclose(fileJournal);
+    fileJournal = nullptr;
+    if (nJournalLastSeq >= nJournalFirstSeq)
+        AppendJournalManifest(pathJournalDir, JournalSegmentName(nJournalFirstSeq), nJournalFirstSeq, nJournalLastSeq);
+    else
+        // nothing was ever written to it
+        fs::remove(pathJournalDir / JournalSegmentName(nJournalFirstSeq));
+}
+
+void CDBWrapper::AppendJournal(CDBBatch& batch, uint64_t nSeq)
+{
+    CDataStream ssRecord(SER_DISK, CLIENT_VERSION);
+    ssRecord << nSeq;
+    CDBJournalHandler handler;
+    handler.pss = &ssRecord;
+    batch.batch.Iterate(&handler);
+
+    // Frame: payload size, payload, first 4 bytes of SHA256d(payload); the
+    // checksum lets a reader detect a torn tail after a crash
+    uint32_t nSize = ssRecord.size();
+    uint256 hashRecord = Hash(ssRecord.begin(), ssRecord.end());
+    if (fwrite(&nSize, sizeof(nSize), 1, fileJournal) != 1 ||
+        fwrite(ssRecord.data(), 1, nSize, fileJournal) != nSize ||
+        fwrite(hashRecord.begin(), 4, 1, fileJournal) != 1 ||
+        fflush(fileJournal) != 0)
+    {
+        // Journalling failure must not take the node down; the next backup
+        // just has to start from a fresh base copy
+        LogPrintf("CDBWrapper: backup journal write failed, disabling journal\n");
+        fclose(fileJournal);
+        fileJournal = nullptr;
+        return;
+    }
+    nJournalLastSeq = nSeq;
+    nJournalBytes += sizeof(nSize) + nSize + 4;
+
+    if (nJournalBytes >= DBWRAPPER_JOURNAL_SEGMENT_SIZE) {
+        CloseJournalSegment();
+        if (!OpenJournalSegment(nSeq + 1))
+            fileJournal = nullptr;
+    }
+}
+
+bool CDBWrapper::StartBackupJournal(const fs::path& pathDir)
+{
+    LOCK(cs_journal);
+    if (fileJournal)
+        return true;
+    TryCreateDirectories(pathDir);
+    pathJournalDir = pathDir;
+    if (!OpenJournalSegment(nBatchSeq + 1))
+        return false;
+    LogPrintf("CDBWrapper: backup journal enabled in %s from batch %llu\n",
+              pathDir.string(), (unsigned long long)(nBatchSeq + 1));
+    return true;
+}
+
+void CDBWrapper::StopBackupJournal()
+{
+    LOCK(cs_journal);
+    CloseJournalSegment();
+}
+
 // Prefixed with null character to avoid collisions with other keys
 //
 // We must use a string constructor which specifies length so that we copy
@@ -171,6 +476,9 @@ const std::string CDBWrapper::OBFUSCATE_KEY_KEY("\000obfuscate_key", 14);
 
 const unsigned int CDBWrapper::OBFUSCATE_KEY_NUM_BYTES = 8;
 
+// Same reserved prefix as the obfuscation key
+const std::string CDBWrapper::BATCH_SEQ_KEY("\000batch_seq", 10);
+
 /**
  * Returns a string (consisting of 8 random bytes) suitable for use as an
  * obfuscating XOR key.
@@ -190,11 +498,78 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
+CDBSnapshot::~CDBSnapshot() { parent.pdb->ReleaseSnapshot(psnapshot); }
+
 CDBIterator::~CDBIterator() { delete piter; }
 bool CDBIterator::Valid() { return piter->Valid(); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
 void CDBIterator::Next() { piter->Next(); }
 
+CDBPrefetchIterator::CDBPrefetchIterator(CDBIterator* piterIn, size_t nReadAheadIn) :
+    piter(piterIn), nReadAhead(nReadAheadIn), fProducerDone(false), fStopping(false), fHaveCurrent(false)
+{
+    threadPrefetch = std::thread(&CDBPrefetchIterator::ThreadFill, this);
+    // Make the first entry available so Valid() reflects the range right away
+    FetchNext();
+}
+
+CDBPrefetchIterator::~CDBPrefetchIterator()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fStopping = true;
+    }
+    condFull.notify_all();
+    threadPrefetch.join();
+}
+
+void CDBPrefetchIterator::ThreadFill()
+{
+    RenameThread("scrypt-dbprefetch");
+    while (true) {
+        // The underlying iterator is touched only from this thread after
+        // construction; reads and decompression happen here, outside the lock
+        if (!piter->Valid())
+            break;
+        Entry entry;
+        leveldb::Slice slKey = piter->piter->key();
+        leveldb::Slice slValue = piter->piter->value();
+        entry.key.assign(slKey.data(), slKey.size());
+        entry.value.assign(slValue.data(), slValue.size());
+        piter->Next();
+
+        std::unique_lock<std::mutex> lock(cs);
+        while (queue.size() >= nReadAhead && !fStopping)
+            condFull.wait(lock);
+        if (fStopping)
+            return;
+        queue.push_back(std::move(entry));
+        condEmpty.notify_one();
+    }
+    std::lock_guard<std::mutex> lock(cs);
+    fProducerDone = true;
+    condEmpty.notify_one();
+}
+
+bool CDBPrefetchIterator::FetchNext()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    while (queue.empty() && !fProducerDone)
+        condEmpty.wait(lock);
+    if (queue.empty()) {
+        fHaveCurrent = false;
+        return false;
+    }
+    current = std::move(queue.front());
+    queue.pop_front();
+    fHaveCurrent = true;
+    condFull.notify_one();
+    return true;
+}
+
+bool CDBPrefetchIterator::Valid() { return fHaveCurrent; }
+void CDBPrefetchIterator::Next() { FetchNext(); }
+
 namespace dbwrapper_private {
 
 void HandleError(const leveldb::Status& status)
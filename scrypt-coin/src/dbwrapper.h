@@ -14,11 +14,21 @@
 #include "utilstrencodings.h"
 #include "clientversion.h"
 
+#include <leveldb/cache.h>
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
+//! default number of entries a CDBPrefetchIterator decodes ahead
+static const size_t DBWRAPPER_PREFETCH_DEPTH = 256;
+//! target size of one backup journal segment file before rotation
+static const size_t DBWRAPPER_JOURNAL_SEGMENT_SIZE = 64 << 20;
 
 class dbwrapper_error : public std::runtime_error
 {
@@ -44,6 +54,13 @@ const std::vector<unsigned char>& GetObfuscateKey(const CDBWrapper &w);
 
 };
 
+/** Create the process-wide LevelDB block cache shared by every database opened
+ * afterwards (-dbsharedcache). Must be called at most once, before those
+ * databases are constructed; without it each database keeps a private cache
+ * carved from its own nCacheSize.
+ */
+void InitSharedDBBlockCache(size_t nCapacity);
+
 /** Batch of changes queued to be written to a CDBWrapper */
 class CDBBatch
 {
@@ -115,6 +132,29 @@ public:
     size_t SizeEstimate() const { return size_estimate; }
 };
 
+/** RAII handle for a LevelDB snapshot. Reads and iterators created from it
+ * all observe the database exactly as it was when the snapshot was taken,
+ * no matter what is written afterwards, so a bulk scan can run without any
+ * lock that would otherwise have to hold writers back. The snapshot must
+ * outlive every iterator created from it.
+ */
+class CDBSnapshot
+{
+    friend class CDBWrapper;
+
+private:
+    const CDBWrapper &parent;
+    const leveldb::Snapshot *psnapshot;
+
+    CDBSnapshot(const CDBWrapper &_parent, const leveldb::Snapshot *_psnapshot) :
+        parent(_parent), psnapshot(_psnapshot) { };
+
+public:
+    CDBSnapshot(const CDBSnapshot&) = delete;
+    CDBSnapshot& operator=(const CDBSnapshot&) = delete;
+    ~CDBSnapshot();
+};
+
 class CDBIterator
 {
 private:
@@ -172,11 +212,122 @@ public:
         return piter->value().size();
     }
 
+    friend class CDBPrefetchIterator;
+};
+
+/** Wraps an already positioned CDBIterator with a background thread that
+ * reads entries ahead into a bounded buffer, so sequential scans overlap
+ * leveldb block reads and checksum verification with consumption. Only
+ * forward iteration is supported; the interface otherwise mirrors
+ * CDBIterator so bulk scan loops can switch without restructuring.
+ */
+class CDBPrefetchIterator
+{
+private:
+    //! one prefetched record; raw bytes, decoded on the consumer side
+    struct Entry {
+        std::string key;
+        std::string value;
+    };
+
+    std::unique_ptr<CDBIterator> piter;
+    size_t nReadAhead;
+
+    std::mutex cs;
+    std::condition_variable condFull;  //!< producer waits here while the buffer is full
+    std::condition_variable condEmpty; //!< consumer waits here while the buffer is empty
+    std::deque<Entry> queue;
+    bool fProducerDone;
+    bool fStopping;
+
+    Entry current;
+    bool fHaveCurrent;
+
+    std::thread threadPrefetch;
+
+    void ThreadFill();
+    bool FetchNext();
+
+public:
+    /**
+     * @param[in] piterIn     Iterator to wrap, already Seek()ed to the start
+     *                        of the range; ownership is taken.
+     * @param[in] nReadAheadIn  Number of entries buffered ahead of the consumer.
+     */
+    explicit CDBPrefetchIterator(CDBIterator* piterIn, size_t nReadAheadIn = DBWRAPPER_PREFETCH_DEPTH);
+    ~CDBPrefetchIterator();
+
+    bool Valid();
+    void Next();
+
+    template<typename K> bool GetKey(K& key) {
+        try {
+            CDataStream ssKey(current.key.data(), current.key.data() + current.key.size(), SER_DISK, CLIENT_VERSION);
+            ssKey >> key;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
+    template<typename V> bool GetValue(V& value) {
+        try {
+            CDataStream ssValue(current.value.data(), current.value.data() + current.value.size(), SER_DISK, CLIENT_VERSION);
+            ssValue.Xor(dbwrapper_private::GetObfuscateKey(piter->parent));
+            ssValue >> value;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
+    unsigned int GetValueSize() {
+        return current.value.size();
+    }
+};
+
+/** Per-database leveldb tuning knobs.
+ *
+ * Each database has a different access pattern (the chainstate is point
+ * lookups dominated by missing keys, the block index is mostly sequential),
+ * so callers can override these defaults instead of all databases sharing
+ * one hard-coded configuration. -dbwritebuffer and -dbmaxopenfiles override
+ * the per-database values globally.
+ */
+struct CDBOptions
+{
+    //! bits per key for the bloom filter; 0 disables the filter
+    int nBloomBitsPerKey = 10;
+    //! memtable size in bytes; 0 derives it from the cache size as before
+    //! (a quarter of nCacheSize, up to two buffers held at once)
+    size_t nWriteBufferSize = 0;
+    //! number of files kept open by leveldb; table handles cache the loaded
+    //! bloom filter and index blocks, so lookup-heavy databases want more
+    int nMaxOpenFiles = 64;
+};
+
+/** RAII guard that holds LevelDB background compactions out of the
+ * foreground write path.
+ *
+ * Every on-disk CDBWrapper shares an Env whose compaction kicks are run
+ * through this throttle: while any guard is alive the background thread
+ * waits before starting compaction I/O, and destroying the last guard — the
+ * "quiescent" hint, e.g. right after a block is fully processed — wakes the
+ * held-back work immediately. The wait is bounded, so a foreground section
+ * that itself stalls on the memtable limit still gets its compaction.
+ * In-memory wrappers keep their own Env and are unaffected.
+ */
+class CDBThrottleBackgroundWork
+{
+public:
+    CDBThrottleBackgroundWork();
+    ~CDBThrottleBackgroundWork();
 };
 
 class CDBWrapper
 {
     friend const std::vector<unsigned char>& dbwrapper_private::GetObfuscateKey(const CDBWrapper &w);
+    friend class CDBSnapshot;
 protected:
     //! custom environment this database is using (may be nullptr in case of default environment)
     leveldb::Env* penv;
@@ -210,6 +361,34 @@ protected:
 
     std::vector<unsigned char> CreateObfuscateKey() const;
 
+    //! the key under which the last committed batch sequence is stored
+    static const std::string BATCH_SEQ_KEY;
+
+    //! Sequence number of the last committed write batch. Persisted inside
+    //! every batch under BATCH_SEQ_KEY, so it is updated atomically with the
+    //! data it describes and survives restarts.
+    uint64_t nBatchSeq;
+
+    //! set once the constructor has loaded nBatchSeq; the bootstrap writes
+    //! (obfuscation key) happen before the obfuscation key is in place and
+    //! must not carry a sequence entry
+    bool fBatchSeqReady;
+
+    //! backup journal state; all of it guarded by cs_journal
+    mutable CCriticalSection cs_journal;
+    FILE* fileJournal;           //!< open segment, or nullptr when disabled
+    fs::path pathJournalDir;
+    uint64_t nJournalFirstSeq;   //!< first sequence in the open segment
+    uint64_t nJournalLastSeq;    //!< last sequence in the open segment
+    uint64_t nJournalBytes;      //!< bytes written to the open segment
+
+    //! Append one framed record for \p batch; requires cs_journal
+    void AppendJournal(CDBBatch& batch, uint64_t nSeq);
+    //! Close the open segment and record it in the manifest; requires cs_journal
+    void CloseJournalSegment();
+    //! Open the segment starting at \p nFirstSeq; requires cs_journal
+    bool OpenJournalSegment(uint64_t nFirstSeq);
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
@@ -218,10 +397,16 @@ public:
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
      *                        with a zero'd byte array.
+     * @param[in] dbOptions   Per-database leveldb tuning; the defaults match
+     *                        the historical hard-coded values.
      */
-    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false, const CDBOptions& dbOptions = CDBOptions());
     ~CDBWrapper();
 
+    //! Bytes of block data this database currently keeps cached. With
+    //! -dbsharedcache this is its live share of the common cache.
+    size_t BlockCacheUsage() const { return options.block_cache->TotalCharge(); }
+
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
     {
@@ -285,6 +470,28 @@ public:
 
     bool WriteBatch(CDBBatch& batch, bool fSync = false);
 
+    //! Sequence number assigned to the most recently committed batch.
+    uint64_t GetBatchSeq() const
+    {
+        LOCK(cs_journal);
+        return nBatchSeq;
+    }
+
+    /** Start appending every committed write batch to rotating journal
+     * segment files under \p pathDir, for incremental backup. Each record
+     * frames the batch's operations together with its sequence number and a
+     * checksum, and is flushed before the batch is handed to leveldb, so a
+     * journal replayed on top of an older copy of the database reproduces a
+     * state the database actually passed through (at worst one batch ahead
+     * of a crash). Completed segments are listed with their sequence range
+     * in journal.manifest; a backup job copies the segments newer than its
+     * last mark and the manifest, never the live leveldb files.
+     */
+    bool StartBackupJournal(const fs::path& pathDir);
+
+    //! Close the journal, recording the final segment in the manifest.
+    void StopBackupJournal();
+
     // not available for LevelDB; provide for compatibility with BDB
     bool Flush()
     {
@@ -302,6 +509,50 @@ public:
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
     }
 
+    //! Capture the database state as of now; see CDBSnapshot.
+    CDBSnapshot *GetSnapshot() const
+    {
+        return new CDBSnapshot(*this, pdb->GetSnapshot());
+    }
+
+    //! Read \p key as of \p snapshot instead of the live state.
+    template <typename K, typename V>
+    bool Read(const K& key, V& value, const CDBSnapshot& snapshot) const
+    {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey << key;
+        leveldb::Slice slKey(ssKey.data(), ssKey.size());
+
+        leveldb::ReadOptions snapoptions = readoptions;
+        snapoptions.snapshot = snapshot.psnapshot;
+
+        std::string strValue;
+        leveldb::Status status = pdb->Get(snapoptions, slKey, &strValue);
+        if (!status.ok()) {
+            if (status.IsNotFound())
+                return false;
+            LogPrintf("LevelDB read failure: %s\n", status.ToString());
+            dbwrapper_private::HandleError(status);
+        }
+        try {
+            CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue.Xor(obfuscate_key);
+            ssValue >> value;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
+    //! Iterate the database as of \p snapshot instead of the live state.
+    CDBIterator *NewIterator(const CDBSnapshot& snapshot)
+    {
+        leveldb::ReadOptions snapoptions = iteroptions;
+        snapoptions.snapshot = snapshot.psnapshot;
+        return new CDBIterator(*this, pdb->NewIterator(snapoptions));
+    }
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
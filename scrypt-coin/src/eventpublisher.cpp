@@ -0,0 +1,187 @@
+// Copyright (c) 2024 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "eventpublisher.h"
+
+#include "clientversion.h"
+#include "primitives/block.h"
+#include "streams.h"
+#include "util.h"
+#include "version.h"
+
+#ifndef WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+CEventPublisher::CEventPublisher(const std::string& strPathIn)
+    : strPath(strPathIn), hListenSocket(-1), fInterrupt(false)
+{
+}
+
+CEventPublisher::~CEventPublisher()
+{
+    Stop();
+}
+
+#ifndef WIN32
+
+bool CEventPublisher::Start()
+{
+    struct sockaddr_un addr;
+    if (strPath.size() >= sizeof(addr.sun_path)) {
+        LogPrintf("CEventPublisher: socket path too long: %s\n", strPath);
+        return false;
+    }
+
+    hListenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (hListenSocket == -1) {
+        LogPrintf("CEventPublisher: socket() failed: %s\n", strerror(errno));
+        return false;
+    }
+
+    // a previous run may have left the filesystem entry behind
+    unlink(strPath.c_str());
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, strPath.c_str());
+    if (bind(hListenSocket, (struct sockaddr*)&addr, sizeof(addr)) == -1 ||
+        listen(hListenSocket, 8) == -1) {
+        LogPrintf("CEventPublisher: cannot listen on %s: %s\n", strPath, strerror(errno));
+        close(hListenSocket);
+        hListenSocket = -1;
+        return false;
+    }
+
+    fInterrupt = false;
+    threadAccept = std::thread(&TraceThread<std::function<void()> >, "eventpub", std::function<void()>(std::bind(&CEventPublisher::ThreadAccept, this)));
+    LogPrintf("CEventPublisher: publishing block/tx events on %s\n", strPath);
+    return true;
+}
+
+void CEventPublisher::Stop()
+{
+    if (hListenSocket == -1)
+        return;
+    fInterrupt = true;
+    if (threadAccept.joinable())
+        threadAccept.join();
+    close(hListenSocket);
+    hListenSocket = -1;
+    unlink(strPath.c_str());
+
+    LOCK(cs_clientSockets);
+    for (int hSocket : vClientSockets)
+        close(hSocket);
+    vClientSockets.clear();
+}
+
+void CEventPublisher::ThreadAccept()
+{
+    while (!fInterrupt) {
+        fd_set fdsetRecv;
+        FD_ZERO(&fdsetRecv);
+        FD_SET(hListenSocket, &fdsetRecv);
+        struct timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 250000;
+        int nSelect = select(hListenSocket + 1, &fdsetRecv, nullptr, nullptr, &timeout);
+        if (nSelect <= 0)
+            continue;
+        int hSocket = accept(hListenSocket, nullptr, nullptr);
+        if (hSocket == -1)
+            continue;
+        // nonblocking, so a stalled consumer can never stall the notification thread
+        fcntl(hSocket, F_SETFL, fcntl(hSocket, F_GETFL, 0) | O_NONBLOCK);
+        LOCK(cs_clientSockets);
+        vClientSockets.push_back(hSocket);
+        LogPrint(BCLog::NET, "CEventPublisher: consumer connected (%u total)\n", vClientSockets.size());
+    }
+}
+
+void CEventPublisher::Publish(uint8_t chEvent, const std::vector<unsigned char>& vchPayload)
+{
+    LOCK(cs_clientSockets);
+    if (vClientSockets.empty())
+        return;
+
+    // frame: event tag, 4-byte little-endian payload length, raw payload
+    std::vector<unsigned char> vchFrame;
+    vchFrame.reserve(5 + vchPayload.size());
+    vchFrame.push_back(chEvent);
+    uint32_t nSize = vchPayload.size();
+    vchFrame.push_back(nSize & 0xff);
+    vchFrame.push_back((nSize >> 8) & 0xff);
+    vchFrame.push_back((nSize >> 16) & 0xff);
+    vchFrame.push_back((nSize >> 24) & 0xff);
+    vchFrame.insert(vchFrame.end(), vchPayload.begin(), vchPayload.end());
+
+    for (std::vector<int>::iterator it = vClientSockets.begin(); it != vClientSockets.end();) {
+        ssize_t nSent = send(*it, reinterpret_cast<const char*>(vchFrame.data()), vchFrame.size(), MSG_NOSIGNAL);
+        if (nSent != (ssize_t)vchFrame.size()) {
+            // a short write would desynchronize the framing, so a consumer
+            // that cannot keep up is dropped rather than buffered for
+            LogPrint(BCLog::NET, "CEventPublisher: dropping slow consumer\n");
+            close(*it);
+            it = vClientSockets.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+#else // WIN32
+
+bool CEventPublisher::Start()
+{
+    LogPrintf("CEventPublisher: -eventsocket is not supported on this platform\n");
+    return false;
+}
+
+void CEventPublisher::Stop()
+{
+}
+
+void CEventPublisher::ThreadAccept()
+{
+}
+
+void CEventPublisher::Publish(uint8_t chEvent, const std::vector<unsigned char>& vchPayload)
+{
+}
+
+#endif // WIN32
+
+void CEventPublisher::BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted)
+{
+    if (hListenSocket == -1)
+        return;
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << *block;
+    Publish(EVENT_BLOCK_CONNECTED, std::vector<unsigned char>(ss.begin(), ss.end()));
+}
+
+void CEventPublisher::BlockDisconnected(const std::shared_ptr<const CBlock>& block)
+{
+    if (hListenSocket == -1)
+        return;
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << *block;
+    Publish(EVENT_BLOCK_DISCONNECTED, std::vector<unsigned char>(ss.begin(), ss.end()));
+}
+
+void CEventPublisher::TransactionAddedToMempool(const CTransactionRef& ptxn)
+{
+    if (hListenSocket == -1)
+        return;
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << *ptxn;
+    Publish(EVENT_TX_ADDED, std::vector<unsigned char>(ss.begin(), ss.end()));
+}
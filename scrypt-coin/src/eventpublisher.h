@@ -0,0 +1,59 @@
+// Copyright (c) 2024 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YACOIN_EVENTPUBLISHER_H
+#define YACOIN_EVENTPUBLISHER_H
+
+#include "sync.h"
+#include "validationinterface.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** Pushes raw block and transaction events to co-located consumers over a
+ * unix-domain socket stream (-eventsocket=<path>), so explorer/dex/faucet
+ * style services get sub-millisecond notification instead of polling
+ * getbestblockhash over RPC.
+ *
+ * Each frame is a one-byte event tag, a 4-byte little-endian payload length,
+ * and the raw network-serialized block or transaction. Writes never block:
+ * a consumer that cannot keep up is disconnected (a partial write would
+ * desynchronize the framing) and is expected to resync over RPC.
+ */
+class CEventPublisher : public CValidationInterface
+{
+public:
+    //! event tags; the payload is a serialized block or transaction
+    static const uint8_t EVENT_BLOCK_CONNECTED = 'B';
+    static const uint8_t EVENT_BLOCK_DISCONNECTED = 'D';
+    static const uint8_t EVENT_TX_ADDED = 'T';
+
+    explicit CEventPublisher(const std::string& strPathIn);
+    ~CEventPublisher();
+
+    //! Bind the socket and start accepting consumers; false on failure
+    bool Start();
+    //! Stop the accept thread and disconnect all consumers
+    void Stop();
+
+protected:
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted) override;
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block) override;
+    void TransactionAddedToMempool(const CTransactionRef& ptxn) override;
+
+private:
+    void ThreadAccept();
+    void Publish(uint8_t chEvent, const std::vector<unsigned char>& vchPayload);
+
+    std::string strPath;
+    int hListenSocket;
+    std::vector<int> vClientSockets;
+    CCriticalSection cs_clientSockets;
+    std::thread threadAccept;
+    std::atomic<bool> fInterrupt;
+};
+
+#endif // YACOIN_EVENTPUBLISHER_H
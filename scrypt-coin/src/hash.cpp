@@ -68,6 +68,69 @@ unsigned int MurmurHash3(unsigned int nHashSeed, const std::vector<unsigned char
     return h1;
 }
 
+void MurmurHash3Many(const uint32_t* pnSeeds, unsigned int nSeeds, const std::vector<unsigned char>& vDataToHash, uint32_t* pnHashesOut)
+{
+    const uint32_t c1 = 0xcc9e2d51;
+    const uint32_t c2 = 0x1b873593;
+
+    for (unsigned int j = 0; j < nSeeds; ++j)
+        pnHashesOut[j] = pnSeeds[j];
+
+    const int nblocks = vDataToHash.size() / 4;
+
+    //----------
+    // body
+    const uint8_t* blocks = vDataToHash.data();
+
+    for (int i = 0; i < nblocks; ++i) {
+        uint32_t k1 = ReadLE32(blocks + i*4);
+
+        k1 *= c1;
+        k1 = ROTL32(k1, 15);
+        k1 *= c2;
+
+        // The mixed block is the same for every seed; only the h1 chain differs
+        for (unsigned int j = 0; j < nSeeds; ++j) {
+            uint32_t h1 = pnHashesOut[j] ^ k1;
+            h1 = ROTL32(h1, 13);
+            pnHashesOut[j] = h1 * 5 + 0xe6546b64;
+        }
+    }
+
+    //----------
+    // tail
+    const uint8_t* tail = vDataToHash.data() + nblocks * 4;
+
+    uint32_t k1 = 0;
+
+    switch (vDataToHash.size() & 3) {
+        case 3:
+            k1 ^= tail[2] << 16;
+        case 2:
+            k1 ^= tail[1] << 8;
+        case 1:
+            k1 ^= tail[0];
+            k1 *= c1;
+            k1 = ROTL32(k1, 15);
+            k1 *= c2;
+            for (unsigned int j = 0; j < nSeeds; ++j)
+                pnHashesOut[j] ^= k1;
+    }
+
+    //----------
+    // finalization
+    for (unsigned int j = 0; j < nSeeds; ++j) {
+        uint32_t h1 = pnHashesOut[j];
+        h1 ^= vDataToHash.size();
+        h1 ^= h1 >> 16;
+        h1 *= 0x85ebca6b;
+        h1 ^= h1 >> 13;
+        h1 *= 0xc2b2ae35;
+        h1 ^= h1 >> 16;
+        pnHashesOut[j] = h1;
+    }
+}
+
 void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char header, const unsigned char data[32], unsigned char output[64])
 {
     unsigned char num[4];
@@ -77,3 +140,18 @@ void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char he
     num[3] = (nChild >>  0) & 0xFF;
     CHMAC_SHA512(chainCode.begin(), chainCode.size()).Write(&header, 1).Write(data, 32).Write(num, 4).Finalize(output);
 }
+
+void Hash160Batch(const unsigned char* const inputs[], const size_t lengths[], size_t count, unsigned char* output)
+{
+    unsigned char sha[4 * CSHA256::OUTPUT_SIZE];
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        for (int j = 0; j < 4; j++)
+            CSHA256().Write(inputs[i + j], lengths[i + j]).Finalize(sha + j * CSHA256::OUTPUT_SIZE);
+        RIPEMD160D32_4Way(sha, output + i * CRIPEMD160::OUTPUT_SIZE);
+    }
+    for (; i < count; i++) {
+        CSHA256().Write(inputs[i], lengths[i]).Finalize(sha);
+        CRIPEMD160().Write(sha, CSHA256::OUTPUT_SIZE).Finalize(output + i * CRIPEMD160::OUTPUT_SIZE);
+    }
+}
@@ -66,6 +66,19 @@ public:
     }
 };
 
+/** Compute the 160-bit hash (SHA-256 + RIPEMD-160) of many independent inputs.
+ *  inputs:  array of count pointers to the input buffers
+ *  lengths: array of count input lengths
+ *  output:  pointer to a count*20 byte output buffer
+ *
+ *  The RIPEMD-160 stage runs four digests at a time through the SSE2
+ *  multi-buffer transform and the SHA256 digests are handed over without the
+ *  intermediate uint160 copies of the one-at-a-time wrappers, so this is the
+ *  preferred entry point when several HASH160s are needed at once (multisig
+ *  key matching, the address index builder).
+ */
+void Hash160Batch(const unsigned char* const inputs[], const size_t lengths[], size_t count, unsigned char* output);
+
 /** Compute the 256-bit hash of an object. */
 template<typename T1>
 inline uint256 Hash(const T1 pbegin, const T1 pend)
@@ -207,6 +220,13 @@ uint256 SerializeHash(const T& obj, int nType=SER_GETHASH, int nVersion=PROTOCOL
 
 unsigned int MurmurHash3(unsigned int nHashSeed, const std::vector<unsigned char>& vDataToHash);
 
+/** Compute MurmurHash3 of the same data under several seeds in a single pass.
+ * The per-block mixing of the input is seed-independent, so it is done once
+ * and folded into every seed's running state; the inner loop over the states
+ * is a short xor/rotate/multiply chain the compiler can vectorize. Equivalent
+ * to calling MurmurHash3(pnSeeds[i], vDataToHash) for each i. */
+void MurmurHash3Many(const uint32_t* pnSeeds, unsigned int nSeeds, const std::vector<unsigned char>& vDataToHash, uint32_t* pnHashesOut);
+
 void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char header, const unsigned char data[32], unsigned char output[64]);
 
 #endif // YACOIN_HASH_H
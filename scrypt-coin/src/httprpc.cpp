@@ -9,6 +9,7 @@
 #include "httpserver.h"
 #include "rpc/protocol.h"
 #include "rpc/server.h"
+#include "rpc/stream.h"
 #include "random.h"
 #include "sync.h"
 #include "util.h"
@@ -142,6 +143,54 @@ static bool RPCAuthorized(const std::string& strAuth, std::string& strAuthUserna
     return multiUserAuthorized(strUserPass);
 }
 
+//! How much of the request body the lane classifier peeks at; the "method"
+//! key sits at the front of requests every common client library produces
+static const size_t MAX_RPC_METHOD_PEEK = 4096;
+
+/** Best-effort extraction of the JSON-RPC method name from a body prefix,
+ * without a full JSON parse (the body can be huge and this runs on the event
+ * loop). A crafted body can mislead this, but it only picks a worker lane;
+ * authorization and execution are unaffected. Returns "" when no method is
+ * found, e.g. for batch requests whose first element is beyond the peeked
+ * prefix.
+ */
+static std::string PeekJSONRPCMethod(const std::string& body)
+{
+    size_t pos = body.find("\"method\"");
+    if (pos == std::string::npos)
+        return "";
+    pos = body.find_first_not_of(" \t\r\n", pos + 8);
+    if (pos == std::string::npos || body[pos] != ':')
+        return "";
+    pos = body.find_first_not_of(" \t\r\n", pos + 1);
+    if (pos == std::string::npos || body[pos] != '"')
+        return "";
+    size_t end = body.find('"', pos + 1);
+    if (end == std::string::npos)
+        return "";
+    return body.substr(pos + 1, end - pos - 1);
+}
+
+/** Map a request onto a worker lane from its method's class in the dispatch
+ * table. Run on the event loop thread before queueing. */
+static HTTPWorkClass HTTPReq_JSONRPCWorkClass(HTTPRequest* req)
+{
+    std::string strMethod = PeekJSONRPCMethod(req->PeekBody(MAX_RPC_METHOD_PEEK));
+    if (strMethod.empty())
+        return HTTP_WORK_NORMAL;
+    const CRPCCommand* pcmd = tableRPC[strMethod];
+    if (!pcmd)
+        return HTTP_WORK_NORMAL;
+    switch (pcmd->cmdClass) {
+    case RPC_CLASS_FAST:
+        return HTTP_WORK_FAST;
+    case RPC_CLASS_BULK:
+        return HTTP_WORK_BULK;
+    default:
+        return HTTP_WORK_NORMAL;
+    }
+}
+
 static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 {
     // JSONRPC handles only POST
@@ -185,6 +234,11 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
+            // Methods with a streaming implementation serialize straight
+            // into the output buffer, skipping the UniValue reply tree
+            if (StreamJSONRPCResult(*req, jreq))
+                return true;
+
             UniValue result = tableRPC.execute(jreq);
 
             // Send reply
@@ -232,10 +286,10 @@ bool StartHTTPRPC()
     if (!InitRPCAuthentication())
         return false;
 
-    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC, HTTPReq_JSONRPCWorkClass);
 #ifdef ENABLE_WALLET
     // ifdef can be removed once we switch to better endpoint support and API versioning
-    RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC, HTTPReq_JSONRPCWorkClass);
 #endif
     assert(EventBase());
     httpRPCTimerInterface = new HTTPRPCTimerInterface(EventBase());
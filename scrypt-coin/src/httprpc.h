@@ -20,16 +20,16 @@ void InterruptHTTPRPC();
  */
 void StopHTTPRPC();
 
-///** Start HTTP REST subsystem.
-// * Precondition; HTTP and RPC has been started.
-// */
-//bool StartREST();
-///** Interrupt RPC REST subsystem.
-// */
-//void InterruptREST();
-///** Stop HTTP REST subsystem.
-// * Precondition; HTTP and RPC has been stopped.
-// */
-//void StopREST();
+/** Start HTTP REST subsystem.
+ * Precondition; HTTP and RPC has been started.
+ */
+bool StartREST();
+/** Interrupt RPC REST subsystem.
+ */
+void InterruptREST();
+/** Stop HTTP REST subsystem.
+ * Precondition; HTTP and RPC has been stopped.
+ */
+void StopREST();
 
 #endif
@@ -11,6 +11,7 @@
 #include "netbase.h"
 #include "rpc/protocol.h" // For HTTP status codes
 #include "sync.h"
+#include "threadpool.h"
 #include "ui_interface.h"
 
 #include <stdio.h>
@@ -45,6 +46,13 @@
 /** Maximum size of http request (request line + headers) */
 static const size_t MAX_HEADERS_SIZE = 8192;
 
+/** Maximum bytes queued towards a chunk-streaming client before the producing
+ * worker thread is paused until the connection drains */
+static const size_t MAX_CHUNKED_BACKLOG = 0x100000;
+
+/** Drain poll interval while a chunked reply sits above the backlog limit */
+static const struct timeval CHUNK_DRAIN_POLL = {0, 50000};
+
 /** HTTP request work item */
 class HTTPWorkItem : public HTTPClosure
 {
@@ -76,6 +84,8 @@ private:
     std::mutex cs;
     std::condition_variable cond;
     std::deque<std::unique_ptr<WorkItem>> queue;
+    //! Bulk (low-priority) items; drained only when queue is empty
+    std::deque<std::unique_ptr<WorkItem>> queueLow;
     bool running;
     size_t maxDepth;
     int numThreads;
@@ -111,13 +121,13 @@ public:
     {
     }
     /** Enqueue a work item */
-    bool Enqueue(WorkItem* item)
+    bool Enqueue(WorkItem* item, bool fLowPriority = false)
     {
         std::unique_lock<std::mutex> lock(cs);
-        if (queue.size() >= maxDepth) {
+        if (queue.size() + queueLow.size() >= maxDepth) {
             return false;
         }
-        queue.emplace_back(std::unique_ptr<WorkItem>(item));
+        (fLowPriority ? queueLow : queue).emplace_back(std::unique_ptr<WorkItem>(item));
         cond.notify_one();
         return true;
     }
@@ -129,12 +139,13 @@ public:
             std::unique_ptr<WorkItem> i;
             {
                 std::unique_lock<std::mutex> lock(cs);
-                while (running && queue.empty())
+                while (running && queue.empty() && queueLow.empty())
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = std::move(queue.front());
-                queue.pop_front();
+                std::deque<std::unique_ptr<WorkItem>>& q = !queue.empty() ? queue : queueLow;
+                i = std::move(q.front());
+                q.pop_front();
             }
             (*i)();
         }
@@ -158,13 +169,14 @@ public:
 struct HTTPPathHandler
 {
     HTTPPathHandler() {}
-    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler):
-        prefix(_prefix), exactMatch(_exactMatch), handler(_handler)
+    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler, HTTPWorkClassifier _classifier):
+        prefix(_prefix), exactMatch(_exactMatch), handler(_handler), classifier(_classifier)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPWorkClassifier classifier;
 };
 
 /** HTTP module state */
@@ -177,6 +189,8 @@ struct evhttp* eventHTTP = 0;
 static std::vector<CSubNet> rpc_allow_subnets;
 //! Work queue for handling longer requests off the event loop thread
 static WorkQueue<HTTPClosure>* workQueue = 0;
+//! Reserved fast lane (-rpcfastthreads); only HTTP_WORK_FAST requests land here
+static WorkQueue<HTTPClosure>* workQueueFast = 0;
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -255,6 +269,20 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
             }
         }
     }
+    {
+        // Accepted sockets don't inherit TCP_NODELAY from the listener.
+        // Without it Nagle delays the small writes of chunked replies and
+        // of back-to-back requests on a kept-alive connection.
+        evhttp_connection* conn = evhttp_request_get_connection(req);
+        if (conn) {
+            bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) {
+                evutil_socket_t fd = bufferevent_getfd(bev);
+                if (fd != -1)
+                    SetSocketNoDelay(fd);
+            }
+        }
+    }
     std::unique_ptr<HTTPRequest> hreq(new HTTPRequest(req));
 
     LogPrint(BCLog::HTTP, "Received a %s request for %s from %s\n",
@@ -291,10 +319,29 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        HTTPWorkClass workClass = HTTP_WORK_NORMAL;
+        if (i->classifier)
+            workClass = i->classifier(hreq.get());
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
-        assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
-            item.release(); /* if true, queue took ownership */
+        bool fQueued;
+        if (g_threadPool && !workQueue) {
+            // Shared pool mode: bulk requests run at background class so
+            // they never crowd out interactive RPC (or higher classes)
+            CThreadPool::SchedClass cls = (workClass == HTTP_WORK_BULK) ? CThreadPool::SCHED_BACKGROUND : CThreadPool::SCHED_RPC;
+            HTTPWorkItem* pItem = item.get();
+            fQueued = g_threadPool->Submit(cls, [pItem]() {
+                std::unique_ptr<HTTPWorkItem> work(pItem);
+                (*work)();
+            });
+        } else {
+            // Fast requests go to the reserved lane (when one is configured);
+            // bulk requests share the main workers at low dequeue priority
+            WorkQueue<HTTPClosure>* queue = (workClass == HTTP_WORK_FAST && workQueueFast) ? workQueueFast : workQueue;
+            assert(queue);
+            fQueued = queue->Enqueue(item.get(), workClass == HTTP_WORK_BULK);
+        }
+        if (fQueued)
+            item.release(); /* if true, the queue took ownership */
         else {
             LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
             item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
@@ -431,7 +478,16 @@ bool InitHTTPServer()
     int workQueueDepth = std::max((long)gArgs.GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
     LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
 
-    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    if (g_threadPool && g_threadPool->IsRunning()) {
+        // Requests are dispatched to the shared thread pool; only its
+        // per-class depth caps are needed, not dedicated worker queues
+        g_threadPool->SetMaxQueueDepth(CThreadPool::SCHED_RPC, workQueueDepth);
+        g_threadPool->SetMaxQueueDepth(CThreadPool::SCHED_BACKGROUND, workQueueDepth);
+    } else {
+        workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+        if (gArgs.GetArg("-rpcfastthreads", DEFAULT_HTTP_FAST_THREADS) > 0)
+            workQueueFast = new WorkQueue<HTTPClosure>(workQueueDepth);
+    }
     // tranfer ownership to eventBase/HTTP via .release()
     eventBase = base_ctr.release();
     eventHTTP = http_ctr.release();
@@ -458,12 +514,24 @@ std::future<bool> threadResult;
 bool StartHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Starting HTTP server\n");
-    int rpcThreads = std::max((long)gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
     std::packaged_task<bool(event_base*, evhttp*)> task(ThreadHTTP);
     threadResult = task.get_future();
     threadHTTP = std::thread(std::move(task), eventBase, eventHTTP);
 
+    if (!workQueue) {
+        // Shared thread pool mode: no dedicated workers to spawn
+        return true;
+    }
+    int rpcThreads = std::max((long)gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
+    LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
+    if (workQueueFast) {
+        int rpcFastThreads = std::max((long)gArgs.GetArg("-rpcfastthreads", DEFAULT_HTTP_FAST_THREADS), 1L);
+        LogPrintf("HTTP: starting %d fast-lane worker threads\n", rpcFastThreads);
+        for (int i = 0; i < rpcFastThreads; i++) {
+            std::thread rpc_worker(HTTPWorkQueueRun, workQueueFast);
+            rpc_worker.detach();
+        }
+    }
     for (int i = 0; i < rpcThreads; i++) {
         std::thread rpc_worker(HTTPWorkQueueRun, workQueue);
         rpc_worker.detach();
@@ -484,6 +552,8 @@ void InterruptHTTPServer()
     }
     if (workQueue)
         workQueue->Interrupt();
+    if (workQueueFast)
+        workQueueFast->Interrupt();
 }
 
 void StopHTTPServer()
@@ -495,6 +565,11 @@ void StopHTTPServer()
         delete workQueue;
         workQueue = nullptr;
     }
+    if (workQueueFast) {
+        workQueueFast->WaitExit();
+        delete workQueueFast;
+        workQueueFast = nullptr;
+    }
     if (eventBase) {
         LogPrint(BCLog::HTTP, "Waiting for HTTP event thread to exit\n");
         // Give event loop a few seconds to exit (to send back last RPC responses), then break it
@@ -551,8 +626,75 @@ void HTTPEvent::trigger(struct timeval* tv)
     else
         evtimer_add(ev, tv); // trigger after timeval passed
 }
+/** State shared between the worker thread producing a chunked reply and the
+ * event loop draining it towards the client. The worker blocks on cond while
+ * the connection's output buffer is above MAX_CHUNKED_BACKLOG; that wait is
+ * the backpressure keeping slow consumers from buffering the whole reply. */
+struct ChunkedReplyState
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+    //! bytes sitting in the connection's output buffer, sampled on the event loop
+    size_t nBacklog;
+    //! the client closed the connection mid-reply
+    bool fClientGone;
+    //! a drain poll timer is already scheduled
+    bool fPollScheduled;
+    //! keeps the close callback argument alive; owned by the event loop
+    std::shared_ptr<ChunkedReplyState>* pCloseHolder;
+
+    ChunkedReplyState() : nBacklog(0), fClientGone(false), fPollScheduled(false), pCloseHolder(nullptr) {}
+};
+
+/** Connection close callback while a chunked reply is in flight: wake the
+ * producer so it stops generating chunks for a client that went away. */
+static void chunked_close_cb(struct evhttp_connection* conn, void* data)
+{
+    std::shared_ptr<ChunkedReplyState>& state = *(std::shared_ptr<ChunkedReplyState>*)data;
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->fClientGone = true;
+    state->cond.notify_all();
+}
+
+/** Sample the connection's output buffer length and wake the producer once it
+ * has drained below the backlog limit; reschedules itself while above. Runs
+ * on the event loop only, like the close callback, so the request pointer is
+ * valid as long as fClientGone is unset. */
+static void ChunkedPollDrain(struct evhttp_request* req, std::shared_ptr<ChunkedReplyState> state)
+{
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->fClientGone) {
+            state->fPollScheduled = false;
+            state->cond.notify_all();
+            return;
+        }
+    }
+    size_t nQueued = 0;
+    evhttp_connection* conn = evhttp_request_get_connection(req);
+    if (conn) {
+        bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+        if (bev)
+            nQueued = evbuffer_get_length(bufferevent_get_output(bev));
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->nBacklog = nQueued;
+    if (nQueued >= MAX_CHUNKED_BACKLOG) {
+        if (!state->fPollScheduled) {
+            state->fPollScheduled = true;
+            HTTPEvent* ev = new HTTPEvent(eventBase, true, std::bind(ChunkedPollDrain, req, state));
+            struct timeval tv = CHUNK_DRAIN_POLL;
+            ev->trigger(&tv);
+        }
+    } else {
+        state->fPollScheduled = false;
+        state->cond.notify_all();
+    }
+}
+
 HTTPRequest::HTTPRequest(struct evhttp_request* _req) : req(_req),
-                                                       replySent(false)
+                                                       replySent(false),
+                                                       startedChunkTransfer(false)
 {
 }
 HTTPRequest::~HTTPRequest()
@@ -560,7 +702,10 @@ HTTPRequest::~HTTPRequest()
     if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
-        WriteReply(HTTP_INTERNAL, "Unhandled request");
+        if (startedChunkTransfer)
+            EndChunkedReply(); // terminate the stream, albeit truncated
+        else
+            WriteReply(HTTP_INTERNAL, "Unhandled request");
     }
     // evhttpd cleans up the request, as long as a reply was sent.
 }
@@ -596,6 +741,19 @@ std::string HTTPRequest::ReadBody()
     return rv;
 }
 
+std::string HTTPRequest::PeekBody(size_t nMaxLen)
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return "";
+    size_t size = std::min(evbuffer_get_length(buf), nMaxLen);
+    // Linearizing only the peeked prefix leaves the rest of the buffer alone
+    const char* data = (const char*)evbuffer_pullup(buf, size);
+    if (!data) // returns nullptr in case of empty buffer
+        return "";
+    return std::string(data, size);
+}
+
 void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
 {
     struct evkeyvalq* headers = evhttp_request_get_output_headers(req);
@@ -603,6 +761,14 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
     evhttp_add_header(headers, hdr.c_str(), value.c_str());
 }
 
+void HTTPRequest::WriteBodyChunk(const std::string& chunk)
+{
+    assert(!replySent && req);
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    evbuffer_add(evb, chunk.data(), chunk.size());
+}
+
 /** Closure sent to main thread to request a reply to be sent to
  * a HTTP request.
  * Replies must be sent in the main loop in the main http thread,
@@ -635,6 +801,97 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = nullptr; // transferred back to main thread
 }
 
+void HTTPRequest::StartChunkedReply(int nStatus)
+{
+    assert(!replySent && !startedChunkTransfer && req);
+    chunkState = std::make_shared<ChunkedReplyState>();
+    auto req_copy = req;
+    auto state = chunkState;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus, state] {
+        evhttp_connection* conn = evhttp_request_get_connection(req_copy);
+        if (conn) {
+            // Find out when the client goes away, so the producer is not
+            // left generating chunks (or waiting on a drain) forever
+            state->pCloseHolder = new std::shared_ptr<ChunkedReplyState>(state);
+            evhttp_connection_set_closecb(conn, chunked_close_cb, state->pCloseHolder);
+        }
+        evhttp_send_reply_start(req_copy, nStatus, nullptr);
+    });
+    ev->trigger(nullptr);
+    startedChunkTransfer = true;
+}
+
+bool HTTPRequest::SendChunk(const std::string& data)
+{
+    assert(startedChunkTransfer && !replySent && req);
+    std::shared_ptr<ChunkedReplyState> state = chunkState;
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        while (!state->fClientGone && state->nBacklog >= MAX_CHUNKED_BACKLOG)
+            state->cond.wait(lock);
+        if (state->fClientGone)
+            return false;
+        // Count the chunk against the backlog up front, so a burst of chunks
+        // cannot overshoot the limit before the event loop samples the real
+        // buffer length
+        state->nBacklog += data.size();
+    }
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, state, data] {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->fClientGone)
+                return;
+        }
+        struct evbuffer* evb = evbuffer_new();
+        assert(evb);
+        evbuffer_add(evb, data.data(), data.size());
+        evhttp_send_reply_chunk(req_copy, evb);
+        evbuffer_free(evb);
+        ChunkedPollDrain(req_copy, state);
+    });
+    ev->trigger(nullptr);
+    return true;
+}
+
+void HTTPRequest::EndChunkedReply()
+{
+    assert(startedChunkTransfer && !replySent && req);
+    std::shared_ptr<ChunkedReplyState> state = chunkState;
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, state] {
+        bool fClientGone;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            fClientGone = state->fClientGone;
+        }
+        if (!fClientGone) {
+            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
+            if (conn) {
+                // The close callback must not outlive this reply: with
+                // keep-alive the connection sticks around for the next request
+                evhttp_connection_set_closecb(conn, nullptr, nullptr);
+                evhttp_send_reply_end(req_copy);
+                // Re-enable reading from the socket. This is the second part of the libevent
+                // workaround above.
+                if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+                    bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+                    if (bev) {
+                        bufferevent_enable(bev, EV_READ | EV_WRITE);
+                    }
+                }
+            } else {
+                evhttp_send_reply_end(req_copy);
+            }
+        }
+        delete state->pCloseHolder;
+        state->pCloseHolder = nullptr;
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    req = nullptr; // transferred back to main thread
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
@@ -676,9 +933,14 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod()
 }
 
 void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+{
+    RegisterHTTPHandler(prefix, exactMatch, handler, HTTPWorkClassifier());
+}
+
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPWorkClassifier &classifier)
 {
     LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, classifier));
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
@@ -8,15 +8,19 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <memory>
 
 static const int DEFAULT_HTTP_THREADS=4;
+static const int DEFAULT_HTTP_FAST_THREADS=1;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
+static const bool DEFAULT_REST_ENABLE=false;
 
 struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct ChunkedReplyState;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -38,11 +42,26 @@ bool UpdateHTTPServerLogging(bool enable);
 
 /** Handler for requests to a certain HTTP path */
 typedef std::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+
+/** Worker lane a queued request is assigned to */
+enum HTTPWorkClass
+{
+    HTTP_WORK_NORMAL = 0, //!< default lane
+    HTTP_WORK_FAST,       //!< reserved workers (-rpcfastthreads); never queues behind bulk requests
+    HTTP_WORK_BULK,       //!< large replies; dequeued only when no normal work is waiting
+};
+/** Classifier run on the event loop before a request is queued; must be cheap
+ * and must not consume the request body. */
+typedef std::function<HTTPWorkClass(HTTPRequest* req)> HTTPWorkClassifier;
+
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
  * be invoked.
  */
 void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+/** Register handler for prefix, with a classifier assigning each request to a
+ * worker lane. */
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPWorkClassifier &classifier);
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
@@ -59,6 +78,8 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    bool startedChunkTransfer;
+    std::shared_ptr<ChunkedReplyState> chunkState;
 
 public:
     HTTPRequest(struct evhttp_request* req);
@@ -98,6 +119,13 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * Peek at up to nMaxLen bytes of the request body without consuming it.
+     * Used by work classifiers on the event loop; ReadBody still returns the
+     * whole body afterwards.
+     */
+    std::string PeekBody(size_t nMaxLen);
+
     /**
      * Write output header.
      *
@@ -105,6 +133,14 @@ public:
      */
     void WriteHeader(const std::string& hdr, const std::string& value);
 
+    /**
+     * Append a chunk of the reply body to the output buffer without
+     * sending it. Allows large replies to be produced incrementally instead
+     * of being assembled in one string first; the data is not transmitted
+     * until WriteReply is called.
+     */
+    void WriteBodyChunk(const std::string& chunk);
+
     /**
      * Write HTTP reply.
      * nStatus is the HTTP status code to send.
@@ -114,6 +150,33 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Commit the status line and headers and switch the reply to chunked
+     * transfer encoding. The body is then produced incrementally with
+     * SendChunk and terminated with EndChunkedReply; the status code cannot
+     * be changed afterwards. Mutually exclusive with WriteReply and
+     * WriteBodyChunk.
+     */
+    void StartChunkedReply(int nStatus);
+
+    /**
+     * Queue one chunk of the reply body for transmission. Blocks the calling
+     * worker while more than MAX_CHUNKED_BACKLOG bytes are waiting in the
+     * connection's output buffer, so producing a large reply needs memory
+     * for only the in-flight window. Returns false once the client has
+     * disconnected; the caller should stop producing and call
+     * EndChunkedReply for cleanup.
+     */
+    bool SendChunk(const std::string& data);
+
+    /**
+     * Terminate a chunked reply.
+     *
+     * @note As with WriteReply, this gives the request back to the main
+     * thread; do not call any other HTTPRequest methods afterwards.
+     */
+    void EndChunkedReply();
 };
 
 /** Event handler closure.
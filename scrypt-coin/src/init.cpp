@@ -10,15 +10,19 @@
 
 #include "init.h"
 
+#include "adaptivepow.h"
 #include "addrman.h"
 #include "amount.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "checkpoints.h"
 //#include "compat/sanity.h"
 #include "consensus/validation.h"
+#include "eventpublisher.h"
 #include "fs.h"
 #include "httpserver.h"
 #include "httprpc.h"
+#include "metrics.h"
 #include "key.h"
 #include "validation.h"
 #include "miner.h"
@@ -33,10 +37,13 @@
 #include "rpc/server.h"
 #include "rpc/register.h"
 #include "rpc/blockchain.h"
+#include "memmonitor.h"
 #include "rpc/mining.h"
 #include "script/standard.h"
 #include "script/sigcache.h"
 #include "scheduler.h"
+#include "stratum.h"
+#include "threadpool.h"
 #include "timedata.h"
 #include "txdb.h"
 #include "txmempool.h"
@@ -85,6 +92,7 @@ bool fUseMemoryLog;
 
 std::unique_ptr<CConnman> g_connman;
 std::unique_ptr<PeerLogicValidation> peerLogic;
+static std::unique_ptr<CEventPublisher> pEventPublisher;
 
 #ifdef WIN32
 // Win32 LevelDB doesn't use filedescriptors, and the ones used for
@@ -174,14 +182,20 @@ static std::unique_ptr<ECCVerifyHandle> globalVerifyHandle;
 
 void Interrupt(boost::thread_group& threadGroup)
 {
+    // The stratum server lives on the HTTP event base; drop its connections
+    // while the event loop is still running
+    StopStratumServer();
     InterruptHTTPServer();
     InterruptHTTPRPC();
     InterruptRPC();
-//    InterruptREST();
+    InterruptREST();
     InterruptTorControl();
+    if (g_threadPool)
+        g_threadPool->Interrupt();
     if (g_connman)
         g_connman->Interrupt();
     ThreadScriptCheckQuit();
+    ThreadCoinsPrefetchQuit();
     ThreadHashCalculationQuit();
     threadGroup.interrupt_all();
 }
@@ -202,9 +216,18 @@ void Shutdown()
     RenameThread("yacoin-shutoff");
     mempool.AddTransactionsUpdated(1);
 
+    // Drain the shared pool before tearing down the subsystems (RPC tables,
+    // the HTTP event base) its queued tasks still use
+    if (g_threadPool) {
+        g_threadPool->Stop();
+        g_threadPool.reset();
+    }
+
     StopHTTPRPC();
-//    StopREST();
+    StopREST();
+    StopMetrics();
     StopRPC();
+    StopStratumServer(); // no-op if Interrupt already ran
     StopHTTPServer();
 
 #ifdef ENABLE_WALLET
@@ -215,6 +238,8 @@ void Shutdown()
     // Stop miner threads
     GenerateYacoins(false, 0, 0);
 
+    UnregisterValidationInterface(&TemplateAssembler());
+
     MapPort(false);
 
     // Because these depend on each-other, we make sure that neither can be
@@ -224,10 +249,17 @@ void Shutdown()
     peerLogic.reset();
     g_connman.reset();
 
+    if (pEventPublisher) {
+        UnregisterValidationInterface(pEventPublisher.get());
+        pEventPublisher->Stop();
+        pEventPublisher.reset();
+    }
+
     StopTorControl();
     if (fDumpMempoolLater && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool();
     }
+    feeEstimator.Write();
 
     // FlushStateToDisk generates a SetBestChain callback, which we should avoid missing
     if (pcoinsTip != nullptr) {
@@ -283,6 +315,7 @@ void Shutdown()
     LogPrintf("wallet unregistered\n");
     globalVerifyHandle.reset();
     ECC_Stop();
+    StopAsyncLogging();
     LogPrintf("Scrypt exited\n\n");
 }
 
@@ -349,15 +382,35 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-daemon", _("Run in the background as a daemon and accept commands"));
     }
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
+    strUsage += HelpMessageOpt("-backupjournal=<dir>", _("Append every block index and chainstate write batch to rotating journal files in <dir>, so incremental backups can copy only the segments newer than their last mark (default: disabled)"));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
     strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to operate in a blocks only mode (default: %u)"), DEFAULT_BLOCKSONLY));
+#ifndef WIN32
+    strUsage += HelpMessageOpt("-blocksmmap", strprintf(_("Memory-map completed block files when reading blocks from disk, speeds up rescans and serving historical blocks (default: %u)"), 0));
+#endif
     strUsage += HelpMessageOpt("-dbcache=<n>", _("Set database cache size in megabytes (default: 25)"));
+    strUsage += HelpMessageOpt("-dbsharedcache", strprintf(_("Share one LevelDB block cache between all databases instead of a fixed per-database split, so -dbcache memory flows to whichever database is busiest (default: %u)"), 0));
+#ifndef WIN32
+    strUsage += HelpMessageOpt("-eventsocket=<path>", _("Publish raw block and transaction events to local consumers over a unix-domain socket at <path>, replacing RPC polling"));
+#endif
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file on startup"));
+    strUsage += HelpMessageOpt("-utxosnapshot=<file>", _("Bootstrap a fresh chainstate from a UTXO snapshot written by the dumputxosnapshot RPC; the snapshot chain is trusted like checkpointed history"));
+    strUsage += HelpMessageOpt("-assumevalid=<hex>", _("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: last compiled-in checkpoint)"));
+    strUsage += HelpMessageOpt("-maxmemory=<n>", strprintf(_("Trim the mempool and flush the coins cache when the tracked dynamic memory of the node exceeds <n> megabytes (0 = no limit, default: %d)"), DEFAULT_MAX_MEMORY_MB));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
+    strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
+    strUsage += HelpMessageOpt("-blockfilechunksize=<n>", strprintf(_("Preallocate blk*.dat files in chunks of <n> bytes; larger chunks mean fewer allocations during initial block download (default: %u)"), BLOCKFILE_CHUNK_SIZE));
+    strUsage += HelpMessageOpt("-undofilechunksize=<n>", strprintf(_("Preallocate rev*.dat files in chunks of <n> bytes (default: %u)"), UNDOFILE_CHUNK_SIZE));
+    strUsage += HelpMessageOpt("-numanode=<n>", _("On multi-socket machines, prefer NUMA node <n> for memory allocations and pin the script verification threads to its CPUs, keeping validation's working set local (Linux only, default: no placement)"));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
             -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-threadpool=<n>", _("Run RPC and other task-shaped work on a shared pool of <n> worker threads with class priorities instead of dedicated per-subsystem threads; reduces oversubscription on small machines (0 = disable, default: number of cores)"));
+    strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
+            "Warning: Reverting this setting requires re-downloading the entire blockchain. "
+            "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >%u = automatically prune block files to stay under the specified target size in MiB)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
     strUsage += HelpMessageOpt("-reindex-fast", _("Rebuild chain state and block index from the blk*.dat files on disk without recalculating block hash"));
     strUsage += HelpMessageOpt("-reindex", _("Rebuild chain state and block index from the blk*.dat files on disk"));
+    strUsage += HelpMessageOpt("-reindextokens", _("Wipe and rebuild the token database from the active chain using a parallel two-pass scan; block and chain state data are not touched"));
     strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), DEFAULT_TXINDEX));
     strUsage += HelpMessageOpt("-blockhashindex", strprintf(_("Maintain a block hash index, used to avoid recalculating block hash when reading block data from disk (default: %u)"), DEFAULT_BLOCKHASHINDEX));
 
@@ -366,24 +419,32 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-banscore=<n>", strprintf(_("Threshold for disconnecting misbehaving peers (default: %u)"), DEFAULT_BANSCORE_THRESHOLD));
     strUsage += HelpMessageOpt("-bantime=<n>", strprintf(_("Number of seconds to keep misbehaving peers from reconnecting (default: %u)"), DEFAULT_MISBEHAVING_BANTIME));
     strUsage += HelpMessageOpt("-bind=<addr>", _("Bind to given address and always listen on it. Use [host]:port notation for IPv6"));
+    strUsage += HelpMessageOpt("-blocksonlyconnect=<ip>", _("Keep a block-relay-only connection to the specified node open: no transactions or addresses are exchanged on it, only blocks and headers. Can be used multiple times"));
     strUsage += HelpMessageOpt("-connect=<ip>", _("Connect only to the specified node(s); -connect=0 disables automatic connections"));
     strUsage += HelpMessageOpt("-discover", _("Discover own IP addresses (default: 1 when listening and no -externalip or -proxy)"));
     strUsage += HelpMessageOpt("-dns", _("Allow DNS lookups for -addnode, -seednode and -connect") + " " + strprintf(_("(default: %u)"), DEFAULT_NAME_LOOKUP));
     strUsage += HelpMessageOpt("-dnsseed", _("Query for peer addresses via DNS lookup, if low on addresses (default: 1 unless -connect used)"));
     strUsage += HelpMessageOpt("-externalip=<ip>", _("Specify your own public address"));
     strUsage += HelpMessageOpt("-forcednsseed", strprintf(_("Always query for peer addresses via DNS lookup (default: %u)"), DEFAULT_FORCEDNSSEED));
+    strUsage += HelpMessageOpt("-inboundsendrate=<n>", _("Cap bytes sent to each non-whitelisted inbound peer at <n>*1000 bytes per second, 0 = unlimited (default: 0)"));
+    strUsage += HelpMessageOpt("-linkencrypt=<ip[:port]>", _("Encrypt the p2p link to the given peer with ChaCha20-Poly1305; both nodes must be configured with the same -linkencryptkey. Can be specified multiple times"));
+    strUsage += HelpMessageOpt("-linkencryptkey=<hex>", _("Pre-shared 32-byte key (64 hex characters) for -linkencrypt links. When set, encrypted links from peers holding the same key are also accepted inbound"));
     strUsage += HelpMessageOpt("-listen", _("Accept connections from outside (default: 1 if no -proxy or -connect)"));
     strUsage += HelpMessageOpt("-listenonion", strprintf(_("Automatically create Tor hidden service (default: %d)"), DEFAULT_LISTEN_ONION));
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
     strUsage += HelpMessageOpt("-maxtimeadjustment", strprintf(_("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)"), DEFAULT_MAX_TIME_ADJUSTMENT));
+    strUsage += HelpMessageOpt("-msghandlerthreads=<n>", strprintf(_("Number of threads processing peer messages; each peer is serviced by one thread (default: %d)"), DEFAULT_MSGHANDLER_THREADS));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
+    strUsage += HelpMessageOpt("-outboundsendrate=<n>", _("Cap bytes sent to each outbound peer at <n>*1000 bytes per second, 0 = unlimited (default: 0)"));
     strUsage += HelpMessageOpt("-port=<port>", _("Listen for connections on <port> (default: 9333 or testnet: 19333)"));
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), DEFAULT_PROXYRANDOMIZE));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
+    strUsage += HelpMessageOpt("-standby", strprintf(_("Run as a hot standby: keep the mempool and coins cache primed from whitelisted peers so a failover serves work at full speed (default: %u)"), DEFAULT_STANDBY));
+    strUsage += HelpMessageOpt("-tcpcork", _("Cork sockets while flushing a multi-message send backlog so the kernel emits full segments (Linux only, default: 0)"));
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
@@ -410,8 +471,10 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-logips", strprintf(_("Include IP addresses in debug output (default: %u)"), DEFAULT_LOGIPS));
     strUsage += HelpMessageOpt("-logtimestamps", strprintf(_("Prepend debug output with timestamp (default: %u)"), DEFAULT_LOGTIMESTAMPS));
     strUsage += HelpMessageOpt("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS));
+    strUsage += HelpMessageOpt("-logasync", strprintf("Write debug.log from a background thread, dropping records rather than blocking when the log falls behind (default: %u)", DEFAULT_LOGASYNC));
     strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit sum of signature cache and script execution cache sizes to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
     strUsage += HelpMessageOpt("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE));
+    strUsage += HelpMessageOpt("-sigcachegenerations=<n>", strprintf("Number of connected-block generations to keep block-consumed signature cache entries for reorg revalidation (default: %u)", DEFAULT_SIG_CACHE_GENERATIONS));
     strUsage += HelpMessageOpt("-printtoconsole", _("Send trace/debug info to console instead of debug.log file"));
     strUsage += HelpMessageOpt("-printtodebugger", _("Send trace/debug info to debug.log file"));
     strUsage += HelpMessageOpt("-printpriority", _("Log transaction fee per kB when mining blocks (default: false)"));
@@ -419,6 +482,8 @@ std::string HelpMessage(HelpMessageMode mode)
 
     strUsage += HelpMessageGroup(_("RPC server options:"));
     strUsage += HelpMessageOpt("-server", _("Accept command line and JSON-RPC commands"));
+    strUsage += HelpMessageOpt("-rest", strprintf(_("Accept public REST requests for raw serialized blocks, transactions and headers (default: %u)"), DEFAULT_REST_ENABLE));
+    strUsage += HelpMessageOpt("-metrics", _("Serve node metrics in Prometheus text format on /metrics of the RPC port (default: 0)"));
     strUsage += HelpMessageOpt("-rpcuser=<user>", _("Username for JSON-RPC connections"));
     strUsage += HelpMessageOpt("-rpcpassword=<pw>", _("Password for JSON-RPC connections"));
     strUsage += HelpMessageOpt("-rpcport=<port>", _("Listen for JSON-RPC connections on <port> (default: 9332 or testnet: 19332)"));
@@ -429,13 +494,24 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcsslprivatekeyfile=<file.pem>", _("Server private key (default: server.pem)"));
     strUsage += HelpMessageOpt("-rpcsslciphers=<ciphers>", _("Acceptable ciphers (default: TLSv1+HIGH:!SSLv2:!aNULL:!eNULL:!AH:!3DES:@STRENGTH)"));
 
+    strUsage += HelpMessageGroup(_("Stratum server options:"));
+    strUsage += HelpMessageOpt("-stratumport=<port>", strprintf(_("Serve stratum mining jobs on <port>, 0 = disabled (default: %d)"), DEFAULT_STRATUM_PORT));
+    strUsage += HelpMessageOpt("-stratumaddress=<addr>", _("Coinbase payout address for stratum jobs (required when -stratumport is set)"));
+    strUsage += HelpMessageOpt("-stratumbind=<addr>", _("Bind the stratum server to the given address (default: 127.0.0.1)"));
+    strUsage += HelpMessageOpt("-stratumdiff=<n>", strprintf(_("Share difficulty, 1 = the chain's proof-of-work limit (default: %d)"), DEFAULT_STRATUM_DIFF));
+
     strUsage += HelpMessageGroup(_("Other options:"));
     strUsage += HelpMessageOpt("-tokenindex", _("Keep an index of tokens. Requires a -reindex-fast or -reindex."));
     strUsage += HelpMessageOpt("-addressindex", _("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses. Require a -reindex-fast or -reindex"));
+    strUsage += HelpMessageOpt("-spentindex", _("Maintain a full spent index, used to query the spending txid and input index for an outpoint. Require a -reindex-fast or -reindex"));
+    strUsage += HelpMessageOpt("-blockfilterindex", _("Maintain a BIP158 compact filter per block, served to light clients over p2p and RPC. Require a -reindex-fast or -reindex"));
     strUsage += HelpMessageOpt("-initSyncDownloadTimeout=<n>", _("Headers/block download timeout in seconds (default: 600)"));
     strUsage += HelpMessageOpt("-initSyncMaximumBlocksInDownloadPerPeer=<n>", _("Maximum number of blocks being downloaded at a time from one peer (default: 500)"));
     strUsage += HelpMessageOpt("-initSyncBlockDownloadWindow=<n>", _("Block download windows (default: initSyncMaximumBlocksInDownloadPerPeer * 64)"));
     strUsage += HelpMessageOpt("-initSyncTriggerGetBlocks=<n>", _("When number of synced headers - number of synced blocks, send getblocks message to all peers to download block (default: 10000)"));
+    strUsage += HelpMessageOpt("-blockmaxvalidationtime=<n>", strprintf(_("Cap the summed measured validation cost of transactions selected into a block template, in milliseconds, 0 = unlimited (default: %d)"), DEFAULT_BLOCK_MAX_VALIDATION_TIME));
+    strUsage += HelpMessageOpt("-blocktemplatebudget=<n>", strprintf(_("Wall-clock budget for block template package selection, in milliseconds, 0 = unlimited (default: %d)"), DEFAULT_BLOCK_TEMPLATE_BUDGET));
+    strUsage += HelpMessageOpt("-minerinstance=<n>", _("Instance id of this built-in miner when several cooperating instances mine the same template; each id mines a disjoint slice of the nonce space (default: 0)"));
     strUsage += HelpMessageOpt("-detachdb", _("Detach block and address databases. Increases shutdown time (default: 0)"));
     strUsage += HelpMessageOpt("-memorylog", _("Use in-memory logging for block index database (default: 1)"));
     strUsage += HelpMessageOpt("-testnet", _("Use the test network"));
@@ -505,6 +581,55 @@ bool InitSanityCheck(void)
     return true;
 }
 
+/**
+ * Runs one independent piece of initialisation on a background thread so it
+ * can overlap the (much longer) block index load. The pieces that qualify
+ * touch only their own database: wallet.dat verification and the token
+ * LevelDB load. GetResult() joins the thread and reports whether the work
+ * succeeded; the destructor joins too, so every early-error path out of
+ * AppInitMain waits for the worker before tearing anything down.
+ */
+class CInitWorker
+{
+public:
+    CInitWorker() : fLaunched(false), fResult(false) {}
+    ~CInitWorker()
+    {
+        if (fLaunched && thread.joinable())
+            thread.join();
+    }
+
+    void Launch(const char* pszName, std::function<bool()> func)
+    {
+        assert(!fLaunched);
+        fLaunched = true;
+        std::string strName = pszName;
+        thread = boost::thread([this, strName, func]() {
+            RenameThread(("yacoin-init-" + strName).c_str());
+            try {
+                fResult.store(func(), std::memory_order_release);
+            } catch (const std::exception& e) {
+                LogPrintf("init worker %s: %s\n", strName, e.what());
+                fResult.store(false, std::memory_order_release);
+            }
+        });
+    }
+
+    bool GetResult()
+    {
+        if (!fLaunched)
+            return false;
+        if (thread.joinable())
+            thread.join();
+        return fResult.load(std::memory_order_acquire);
+    }
+
+private:
+    boost::thread thread;
+    bool fLaunched;
+    std::atomic<bool> fResult;
+};
+
 bool AppInitServers(boost::thread_group& threadGroup)
 {
     RPCServer::OnStarted(&OnRPCStarted);
@@ -516,8 +641,12 @@ bool AppInitServers(boost::thread_group& threadGroup)
         return false;
     if (!StartHTTPRPC())
         return false;
-//    if (gArgs.GetBoolArg("-rest", DEFAULT_REST_ENABLE) && !StartREST())
-//        return false;
+    if (gArgs.GetBoolArg("-rest", DEFAULT_REST_ENABLE) && !StartREST())
+        return false;
+    if (gArgs.GetBoolArg("-metrics", false) && !StartMetrics())
+        return false;
+    if (!InitStratumServer())
+        return false;
     if (!StartHTTPServer())
         return false;
     return true;
@@ -587,6 +716,7 @@ void InitLogging()
     fLogTimestamps = gArgs.GetBoolArg("-logtimestamps", DEFAULT_LOGTIMESTAMPS);
     fLogTimeMicros = gArgs.GetBoolArg("-logtimemicros", DEFAULT_LOGTIMEMICROS);
     fLogIPs = gArgs.GetBoolArg("-logips", DEFAULT_LOGIPS);
+    fLogAsync = gArgs.GetBoolArg("-logasync", DEFAULT_LOGASYNC);
 
     LogPrintf("\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n");
     LogPrintf("Scrypt version %s (%s)\n", FormatFullVersion(), CLIENT_DATE);
@@ -598,7 +728,7 @@ ServiceFlags nRelevantServices = NODE_NETWORK;
 int nMaxConnections;
 int nUserMaxConnections;
 int nFD;
-ServiceFlags nLocalServices = NODE_NETWORK;
+ServiceFlags nLocalServices = ServiceFlags(NODE_NETWORK | NODE_COMPACT_HEADERS | NODE_FAST_CHECKSUM | NODE_BULK_HEADERS);
 
 } // namespace
 
@@ -671,11 +801,10 @@ bool AppInitParameterInteraction()
     // also see: InitParameterInteraction()
 
     // if using block pruning, then disallow txindex
-    // TODO: Implement prune later
-//    if (gArgs.GetArg("-prune", 0)) {
-//        if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
-//            return InitError(_("Prune mode is incompatible with -txindex."));
-//    }
+    if (gArgs.GetArg("-prune", 0)) {
+        if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
+            return InitError(_("Prune mode is incompatible with -txindex."));
+    }
 
     // -bind and -whitebind can't be set when not listening
     size_t nUserBind = gArgs.GetArgs("-bind").size() + gArgs.GetArgs("-whitebind").size();
@@ -751,12 +880,11 @@ bool AppInitParameterInteraction()
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
 
-    // TODO: Improve checkpoints logic
-//    hashAssumeValid = uint256S(gArgs.GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
-//    if (!hashAssumeValid.IsNull())
-//        LogPrintf("Assuming ancestors of block %s have valid signatures.\n", hashAssumeValid.GetHex());
-//    else
-//        LogPrintf("Validating signatures for all blocks.\n");
+    hashAssumeValid = uint256(gArgs.GetArg("-assumevalid", Checkpoints::GetLastCheckpointHash().GetHex()));
+    if (!hashAssumeValid.IsNull())
+        LogPrintf("Assuming ancestors of block %s have valid signatures.\n", hashAssumeValid.GetHex());
+    else
+        LogPrintf("Validating signatures for all blocks.\n");
 
     // TODO: Support nMinimumChainWork later
 //    if (gArgs.IsArgSet("-minimumchainwork")) {
@@ -789,6 +917,17 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    int64_t nNumaNode = gArgs.GetArg("-numanode", -1);
+    if (nNumaNode >= 0) {
+        // Apply the memory policy before the dbcache and coins caches are
+        // allocated so their pages land on the chosen node; the script check
+        // threads bind their own CPU affinity when they start.
+        if (SetPreferredNumaNode(nNumaNode))
+            LogPrintf("Preferring NUMA node %d for memory allocations\n", nNumaNode);
+        else
+            InitWarning(strprintf(_("Could not set NUMA memory policy for node %d; continuing without placement"), nNumaNode));
+    }
+
     // Parallel calculate scrypt hash for block header
     int maximumHashCalcThread = GetNumCores();
     nHashCalcThreads = (int)(gArgs.GetArg("-hashcalcthreads", maximumHashCalcThread - 1));
@@ -798,23 +937,26 @@ bool AppInitParameterInteraction()
         nHashCalcThreads = maximumHashCalcThread;
 
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
-    // TODO: Implement prune later
-//    int64_t nPruneArg = gArgs.GetArg("-prune", 0);
-//    if (nPruneArg < 0) {
-//        return InitError(_("Prune cannot be configured with a negative value."));
-//    }
-//    nPruneTarget = (uint64_t) nPruneArg * 1024 * 1024;
-//    if (nPruneArg == 1) {  // manual pruning: -prune=1
-//        LogPrintf("Block pruning enabled.  Use RPC call pruneblockchain(height) to manually prune block and undo files.\n");
-//        nPruneTarget = std::numeric_limits<uint64_t>::max();
-//        fPruneMode = true;
-//    } else if (nPruneTarget) {
-//        if (nPruneTarget < MIN_DISK_SPACE_FOR_BLOCK_FILES) {
-//            return InitError(strprintf(_("Prune configured below the minimum of %d MiB.  Please use a higher number."), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
-//        }
-//        LogPrintf("Prune configured to target %uMiB on disk for block and undo files.\n", nPruneTarget / 1024 / 1024);
-//        fPruneMode = true;
-//    }
+    int64_t nPruneArg = gArgs.GetArg("-prune", 0);
+    if (nPruneArg < 0) {
+        return InitError(_("Prune cannot be configured with a negative value."));
+    }
+    nPruneTarget = (uint64_t) nPruneArg * 1024 * 1024;
+    if (nPruneArg == 1) {  // manual pruning: -prune=1
+        LogPrintf("Block pruning enabled.  Use RPC call pruneblockchain(height) to manually prune block and undo files.\n");
+        nPruneTarget = std::numeric_limits<uint64_t>::max();
+        fPruneMode = true;
+    } else if (nPruneTarget) {
+        if (nPruneTarget < MIN_DISK_SPACE_FOR_BLOCK_FILES) {
+            return InitError(strprintf(_("Prune configured below the minimum of %d MiB.  Please use a higher number."), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
+        }
+        LogPrintf("Prune configured to target %uMiB on disk for block and undo files.\n", nPruneTarget / 1024 / 1024);
+        fPruneMode = true;
+    }
+    if (fPruneMode) {
+        // a pruned node cannot serve historical blocks
+        nLocalServices = ServiceFlags(nLocalServices & ~NODE_NETWORK);
+    }
 
     RegisterAllCoreRPCCommands(tableRPC);
 #ifdef ENABLE_WALLET
@@ -906,6 +1048,10 @@ bool AppInitSanityChecks()
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    std::string adaptivepow_algo = AdaptivePowAutoDetect();
+    LogPrintf("Using the '%s' AdaptivePow implementation\n", adaptivepow_algo);
+    std::string hex_algo = HexAutoDetect();
+    LogPrintf("Using the '%s' hex conversion implementation\n", hex_algo);
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -934,6 +1080,47 @@ bool AppInitLockDataDirectory()
 
 //_____________________________________________________________________________
 
+// If we're using -prune with -reindex, then delete block files that will be ignored by the
+// reindex.  Since reindexing works by starting at block file 0 and looping until a blockfile
+// is missing, do the same here to delete any later block files after a gap.  Also delete all
+// rev files since they'll be rewritten by the reindex anyway.  This ensures that vinfoBlockFile
+// is in sync with what's actually on disk by the time we start downloading, so that pruning
+// works correctly.
+static void CleanupBlockRevFiles()
+{
+    std::map<std::string, fs::path> mapBlockFiles;
+
+    // Glob all blk?????.dat and rev?????.dat files from the blocks directory.
+    // Remove the rev files immediately and insert the blk file paths into an
+    // ordered map keyed by block file index.
+    LogPrintf("Removing unusable blk?????.dat and rev?????.dat files for -reindex with -prune\n");
+    fs::path blocksdir = GetDataDir() / "blocks";
+    for (fs::directory_iterator it(blocksdir); it != fs::directory_iterator(); it++) {
+        if (fs::is_regular_file(*it) &&
+            it->path().filename().string().length() == 12 &&
+            it->path().filename().string().substr(8,4) == ".dat")
+        {
+            if (it->path().filename().string().substr(0,3) == "blk")
+                mapBlockFiles[it->path().filename().string().substr(3,5)] = it->path();
+            else if (it->path().filename().string().substr(0,3) == "rev")
+                fs::remove(it->path());
+        }
+    }
+
+    // Remove all block files that aren't part of a contiguous set starting at
+    // zero by walking the ordered map (keys are block file indices) and
+    // keeping a separate counter.  Once we hit a gap (or if 0 doesn't exist)
+    // start removing block files.
+    int nContigCounter = 0;
+    for (const std::pair<std::string, fs::path>& item : mapBlockFiles) {
+        if (atoi(item.first) == nContigCounter) {
+            nContigCounter++;
+            continue;
+        }
+        fs::remove(item.second);
+    }
+}
+
 /** Initialize yacoin.
  *  @pre Parameters should be parsed and config file should be read.
  */
@@ -953,8 +1140,11 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         ShrinkDebugFile();
     }
 
-    if (fPrintToDebugLog)
+    if (fPrintToDebugLog) {
         OpenDebugLog();
+        if (fLogAsync)
+            StartAsyncLogging();
+    }
 
     if (!fLogTimestamps)
         LogPrintf("Startup time: %s\n", DateTimeStrFormat("%Y-%m-%d %H:%M:%S", GetTime()));
@@ -990,6 +1180,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
             threadGroup.create_thread(&ThreadHashCalculation);
     }
 
+    // Warms the coins DB for blocks announced via compact blocks
+    threadGroup.create_thread(&ThreadCoinsPrefetch);
+
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
@@ -1001,6 +1194,13 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
      * that the server is there and will be ready later).  Warmup mode will
      * be disabled when initialisation is finished.
      */
+    // Start the shared worker thread pool before the servers that submit to it
+    int nPoolThreads = gArgs.GetArg("-threadpool", GetNumCores());
+    if (nPoolThreads > 0) {
+        g_threadPool.reset(new CThreadPool());
+        g_threadPool->Start(nPoolThreads);
+    }
+
     if (gArgs.GetBoolArg("-server", false))
     {
         uiInterface.InitMessage.connect(SetRPCWarmupStatus);
@@ -1020,8 +1220,11 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     // ********************************************************* Step 5: verify wallet database integrity
 #ifdef ENABLE_WALLET
-    if (!CWallet::Verify())
-        return false;
+    // Wallet database verification only touches wallet.dat, so it overlaps
+    // the network initialisation and block index load below; the result is
+    // collected right before the wallet itself is loaded in step 8.
+    CInitWorker walletVerifyWorker;
+    walletVerifyWorker.Launch("walletverify", []() { return CWallet::Verify(); });
 #endif
 
     // ********************************************************* Step 6: network initialization
@@ -1037,6 +1240,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     peerLogic.reset(new PeerLogicValidation(&connman, scheduler));
     RegisterValidationInterface(peerLogic.get());
 
+    // Keep the shared block template assembler in sync with the mempool
+    // and chain tip
+    RegisterValidationInterface(&TemplateAssembler());
+
     // sanitize comments per BIP-0014, format user agent and check total size
     std::vector<std::string> uacomments;
     for (const std::string& cmt : gArgs.GetArgs("-uacomment")) {
@@ -1130,6 +1337,16 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         RegisterValidationInterface(pzmqNotificationInterface);
     }
 #endif
+
+    if (gArgs.IsArgSet("-eventsocket")) {
+        pEventPublisher.reset(new CEventPublisher(gArgs.GetArg("-eventsocket", "")));
+        if (pEventPublisher->Start()) {
+            RegisterValidationInterface(pEventPublisher.get());
+        } else {
+            pEventPublisher.reset();
+            return InitError(_("Unable to open -eventsocket for listening. See debug log for details."));
+        }
+    }
     uint64_t nMaxOutboundLimit = 0; //unlimited unless -maxuploadtarget is set
     uint64_t nMaxOutboundTimeframe = MAX_UPLOAD_TIMEFRAME;
 
@@ -1159,7 +1376,16 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
 //    int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
+    if (gArgs.GetBoolArg("-dbsharedcache", false)) {
+        // Pool the bytes the block index, token and chain state databases
+        // would otherwise partition statically (each turns half its share
+        // into a block cache; the token database opens with the block index
+        // share). Must happen before the databases are opened below.
+        InitSharedDBBlockCache((size_t)(2 * nBlockTreeDBCache + nCoinDBCache) / 2);
+    }
     LogPrintf("Cache configuration:\n");
+    if (gArgs.GetBoolArg("-dbsharedcache", false))
+        LogPrintf("* Using %.1fMiB shared between the database block caches\n", ((2 * nBlockTreeDBCache + nCoinDBCache) / 2) * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
@@ -1199,6 +1425,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     std::string additionalInfo = fReindexFast ? "(reindex block index and chainstate in fast mode)" : fReindex ? "(reindex block index and chainstate in slow mode)" : "";
     LogPrintf("Loading block index %s ...\n", additionalInfo);
     bool fLoaded = false;
+    bool fTxIndexBuildPending = false;
     while (!fLoaded && !fRequestShutdown) {
         bool fReset = fReindex;
         std::string strLoadError;
@@ -1228,6 +1455,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 }
 
                 /** YAC_TOKEN START */
+                CInitWorker tokenLoadWorker;
                 {
                     // Basic tokens
                     delete ptokens;
@@ -1235,33 +1463,38 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     delete ptokensCache;
 
                     // Basic tokens
-                    ptokensdb = new CTokensDB(nBlockTreeDBCache, false, fReset);
+                    // -reindextokens wipes the database here; it is rebuilt
+                    // from the active chain right before Step 10
+                    ptokensdb = new CTokensDB(nBlockTreeDBCache, false, fReset || gArgs.GetBoolArg("-reindextokens", false));
                     ptokens = new CTokensCache();
                     ptokensCache = new CLRUCache<std::string, CDatabasedTokenData>(MAX_CACHE_TOKENS_SIZE);
 
                     // Read for fTokenIndex to make sure that we only load token address balances if it if true
                     pblocktree->ReadFlag("tokenindex", fTokenIndex);
 
-                    // Need to load tokens before we verify the database
-                    if (!ptokensdb->LoadTokens()) {
-                        strLoadError = _("Failed to load Tokens Database");
-                        break;
-                    }
-
-                    if (!ptokensdb->ReadReissuedMempoolState())
-                        LogPrintf("Database failed to load last Reissued Mempool State. Will have to start from empty state\n");
-
-                    LogPrintf("Successfully loaded tokens from database.\nCache of tokens size: %d\n",
-                              ptokensCache->Size());
+                    // The token database is separate from the block tree, so
+                    // its load overlaps LoadBlockIndex below. Tokens must be
+                    // loaded before we verify the database; the result is
+                    // collected right after the block index is in.
+                    tokenLoadWorker.Launch("tokenload", []() {
+                        if (!ptokensdb->LoadTokens())
+                            return false;
+
+                        if (!ptokensdb->ReadReissuedMempoolState())
+                            LogPrintf("Database failed to load last Reissued Mempool State. Will have to start from empty state\n");
+
+                        LogPrintf("Successfully loaded tokens from database.\nCache of tokens size: %d\n",
+                                  ptokensCache->Size());
+                        return true;
+                    });
                 }
                 /** YAC_TOKEN END */
 
                 if (fReset) {
                     pblocktree->WriteReindexing(true);
                     //If we're reindexing in prune mode, wipe away unusable block files and all undo data files
-                    // TODO: Implement prune later
-//                    if (fPruneMode)
-//                        CleanupBlockRevFiles();
+                    if (fPruneMode)
+                        CleanupBlockRevFiles();
                 }
 
                 if (fRequestShutdown) break;
@@ -1276,14 +1509,42 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
+                /** YAC_TOKEN START */
+                // Tokens are needed from here on (database verification and
+                // chainstate work below); collect the background load.
+                if (!tokenLoadWorker.GetResult()) {
+                    strLoadError = _("Failed to load Tokens Database");
+                    break;
+                }
+                /** YAC_TOKEN END */
+
                 // If the loaded chain has a wrong genesis, bail out immediately
                 // (we're likely using a testnet datadir, or the other way around).
                 if (!mapBlockIndex.empty() && mapBlockIndex.count(chainparams.GetConsensus().hashGenesisBlock) == 0)
                     return InitError(_("Incorrect or no genesis block found. Wrong datadir for network?"));
 
-                // Check for changed -txindex state
+                // Check for changed -txindex state. The index can be added
+                // while the node runs (ThreadTxIndexBuild is started in step
+                // 10 and flips fTxIndex when it reaches the tip); removing it
+                // still needs a reindex.
                 if (fTxIndex != gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex-fast or -reindex to change -txindex");
+                    if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
+                        fTxIndexBuildPending = true;
+                    } else {
+                        strLoadError = _("You need to rebuild the database using -reindex-fast or -reindex to change -txindex");
+                        break;
+                    }
+                }
+
+                // Check for changed -blockfilterindex state
+                if (fBlockFilterIndex != gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+                    strLoadError = _("You need to rebuild the database using -reindex-fast or -reindex to change -blockfilterindex");
+                    break;
+                }
+
+                // Check for changed -spentindex state
+                if (fSpentIndex != gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+                    strLoadError = _("You need to rebuild the database using -reindex-fast or -reindex to change -spentindex");
                     break;
                 }
 
@@ -1295,11 +1556,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
-                // TODO: Implement prune later
-//                if (fHavePruned && !fPruneMode) {
-//                    strLoadError = _("You need to rebuild the database using -reindex to go back to unpruned mode.  This will redownload the entire blockchain");
-//                    break;
-//                }
+                if (fHavePruned && !fPruneMode) {
+                    strLoadError = _("You need to rebuild the database using -reindex to go back to unpruned mode.  This will redownload the entire blockchain");
+                    break;
+                }
 
                 // At this point blocktree args are consistent with what's on disk.
                 // If we're not mid-reindex (based on disk + args), add a genesis block on disk
@@ -1315,6 +1575,13 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReset);
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
 
+                // If necessary, upgrade any legacy per-transaction UTXO
+                // records to the per-txout schema; no-op otherwise
+                if (!pcoinsdbview->Upgrade()) {
+                    strLoadError = _("Error upgrading chainstate database");
+                    break;
+                }
+
                 // ReplayBlocks is a no-op if we cleared the coinsviewdb with -reindex-fast or -reindex
                 if (!ReplayBlocks(chainparams, pcoinsdbview)) {
                     strLoadError = _("Unable to replay blocks. You will need to rebuild the database using -reindex-fast or -reindex.");
@@ -1324,6 +1591,16 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 // The on-disk coinsdb is now in a good state, create the cache
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
 
+                // Bootstrap a fresh chainstate from a UTXO snapshot before
+                // LoadChainTip, so the snapshot base becomes the tip below.
+                if (gArgs.IsArgSet("-utxosnapshot") && !fReset && pcoinsTip->GetBestBlock().IsNull()) {
+                    std::string strSnapshotError;
+                    if (!LoadUTXOSnapshot(fs::path(gArgs.GetArg("-utxosnapshot", "")), strSnapshotError)) {
+                        strLoadError = _("Failed to load UTXO snapshot: ") + strSnapshotError;
+                        break;
+                    }
+                }
+
                 bool is_coinsview_empty = fReset || pcoinsTip->GetBestBlock().IsNull();
                 if (!is_coinsview_empty) {
                     // LoadChainTip sets chainActive based on pcoinsTip's best block
@@ -1351,11 +1628,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
                 if (!is_coinsview_empty) {
                     uiInterface.InitMessage(_("Verifying blocks..."));
-                    // TODO: Implement prune later
-//                    if (fHavePruned && gArgs.GetArg("-checkblocks", DEFAULT_CHECKBLOCKS) > MIN_BLOCKS_TO_KEEP) {
-//                        LogPrintf("Prune: pruned datadir may not have more than %d blocks; only checking available blocks",
-//                            MIN_BLOCKS_TO_KEEP);
-//                    }
+                    if (fHavePruned && gArgs.GetArg("-checkblocks", DEFAULT_CHECKBLOCKS) > MIN_BLOCKS_TO_KEEP) {
+                        LogPrintf("Prune: pruned datadir may not have more than %d blocks; only checking available blocks",
+                            MIN_BLOCKS_TO_KEEP);
+                    }
 
                     {
                         LOCK(cs_main);
@@ -1419,6 +1695,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     // ********************************************************* Step 8: load wallet
 #ifdef ENABLE_WALLET
+    // Collect the wallet database verification launched in step 5.
+    if (!walletVerifyWorker.GetResult())
+        return false;
+
     if (!CWallet::InitLoadWallet())
         return false;
 #else
@@ -1428,6 +1708,28 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     // ********************************************************* Step 9: data directory maintenance
     // Do nothing at the moment
 
+    // Start the incremental backup journals once the databases are settled;
+    // everything written from here on lands in journal segments the nightly
+    // backup can copy
+    if (gArgs.IsArgSet("-backupjournal")) {
+        fs::path pathJournal = fs::path(gArgs.GetArg("-backupjournal", ""));
+        if (!pblocktree->StartBackupJournal(pathJournal / "blocks") ||
+            !pcoinsdbview->StartBackupJournal(pathJournal / "chainstate"))
+            return InitError(strprintf(_("Unable to open backup journal in %s"), pathJournal.string()));
+    }
+
+    // Rebuild the token database from the active chain if requested; the
+    // database itself was already wiped when it was opened above
+    if (gArgs.GetBoolArg("-reindextokens", false)) {
+        uiInterface.InitMessage(_("Rebuilding token database..."));
+        LOCK(cs_main);
+        std::string strTokenError;
+        if (!ReindexTokenDatabase(strTokenError))
+            return InitError(strprintf(_("Failed to rebuild token database: %s"), strTokenError));
+        if (!ptokensdb->LoadTokens())
+            return InitError(_("Failed to load the rebuilt token database"));
+    }
+
     // ********************************************************* Step 10: import blocks
 
     if (!CheckDiskSpace())
@@ -1476,6 +1778,11 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         }
     }
 
+    // Index the existing chain for a newly requested -txindex in the
+    // background instead of demanding a reindex shutdown window.
+    if (fTxIndexBuildPending)
+        threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "txindex", &ThreadTxIndexBuild));
+
     // -loadblock=
     for (const fs::path& path : vImportFiles) {
         FILE *file = fsbridge::fopen(path, "rb");
@@ -1504,6 +1811,8 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         fDumpMempoolLater = !fRequestShutdown;
     }
 
+    feeEstimator.Read();
+
     // ********************************************************* Step 11: start node
 
     // debug print
@@ -1515,8 +1824,8 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     Discover(threadGroup);
 
-    // Map ports with UPnP
-    MapPort(gArgs.GetBoolArg("-upnp", DEFAULT_UPNP));
+    // Map ports with UPnP; the lease refresh runs as a scheduler task
+    MapPort(gArgs.GetBoolArg("-upnp", DEFAULT_UPNP), &scheduler);
 
     CConnman::Options connOptions;
     connOptions.nLocalServices = nLocalServices;
@@ -1530,6 +1839,8 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     connOptions.m_msgproc = peerLogic.get();
     connOptions.nSendBufferMaxSize = 1000*gArgs.GetArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
     connOptions.nReceiveFloodSize = 1000*gArgs.GetArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
+    connOptions.nInboundSendRate = 1000*gArgs.GetArg("-inboundsendrate", 0);
+    connOptions.nOutboundSendRate = 1000*gArgs.GetArg("-outboundsendrate", 0);
 
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
@@ -1573,6 +1884,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     // Generate coins in the background
     GenerateYacoins(gArgs.GetBoolArg("-gen", DEFAULT_GENERATE), gArgs.GetArg("-genproclimit", DEFAULT_GENERATE_THREADS));
+
+    if (gArgs.GetArg("-maxmemory", DEFAULT_MAX_MEMORY_MB) > 0)
+        scheduler.scheduleEvery(&CheckMemoryPressure, MEMORY_PRESSURE_CHECK_INTERVAL * 1000);
     // ********************************************************* Step 12: finished
 
     SetRPCWarmupFinished();
@@ -17,8 +17,12 @@
 #include "streams.h"
 #include "policy/policy.h"
 #include "script/interpreter.h"
+#include "net_processing.h"
+#include "crypto/common.h"
 
 #include <boost/assign/list_of.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
 
 using std::min;
 using std::vector;
@@ -111,7 +115,7 @@ static bool SelectBlockFromCandidates(
             continue;
         // compute the selection hash by hashing its proof-hash and the
         // previous proof-of-stake modifier
-        uint256 hashProof = pindex->IsProofOfStake()? pindex->hashProofOfStake : pindex->GetBlockHash();
+        uint256 hashProof = pindex->IsProofOfStake()? pindex->GetHashProofOfStake() : pindex->GetBlockHash();
         CDataStream ss(SER_GETHASH, 0);
         ss << hashProof << nStakeModifierPrev;
         uint256 hashSelection = Hash(ss.begin(), ss.end());
@@ -296,6 +300,23 @@ bool ComputeNextStakeModifier(const CBlockIndex* pindexCurrent, uint64_t& nStake
     return true;
 }
 
+// Memo of GetKernelStakeModifier results for coins whose source block is on
+// the active chain, indexed by that block's height. An entry also records the
+// block that terminated the selection-interval walk; a hit is honoured only
+// while both blocks are still at their heights on the active chain, so a
+// reorg invalidates stale entries without any explicit bookkeeping.
+// Protected by cs_main, which every caller already holds.
+struct CStakeModifierCacheEntry {
+    bool fValid;
+    ::uint64_t nStakeModifier;
+    int nStakeModifierHeight;
+    ::int64_t nStakeModifierTime;
+    int nTerminatorHeight;      // block whose modifier was returned
+    uint256 hashTerminator;
+    CStakeModifierCacheEntry() : fValid(false), nStakeModifier(0), nStakeModifierHeight(0), nStakeModifierTime(0), nTerminatorHeight(0) {}
+};
+static std::vector<CStakeModifierCacheEntry> vStakeModifierCache;
+
 // The stake modifier used to hash for a stake kernel is chosen as the stake
 // modifier about a selection interval later than the coin generating the kernel
 static bool GetKernelStakeModifier(CBlockIndex* pindexPrev, uint256 hashBlockFrom, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime, bool fPrintProofOfStake)
@@ -305,6 +326,24 @@ static bool GetKernelStakeModifier(CBlockIndex* pindexPrev, uint256 hashBlockFro
     if (!mapBlockIndex.count(hashBlockFrom))
         return error("GetKernelStakeModifier() : block not indexed");
     const CBlockIndex* pindexFrom = mapBlockIndex[hashBlockFrom];
+
+    // O(1) path: reuse an earlier walk if both the source block and the block
+    // that terminated it are still in place on the active chain
+    if (pindexFrom->nHeight < (int)vStakeModifierCache.size())
+    {
+        const CStakeModifierCacheEntry& entry = vStakeModifierCache[pindexFrom->nHeight];
+        if (entry.fValid &&
+            chainActive[pindexFrom->nHeight] == pindexFrom &&
+            entry.nTerminatorHeight <= chainActive.Height() &&
+            chainActive[entry.nTerminatorHeight]->GetBlockHash() == entry.hashTerminator)
+        {
+            nStakeModifier = entry.nStakeModifier;
+            nStakeModifierHeight = entry.nStakeModifierHeight;
+            nStakeModifierTime = entry.nStakeModifierTime;
+            return true;
+        }
+    }
+
     nStakeModifierHeight = pindexFrom->nHeight;
     nStakeModifierTime = pindexFrom->GetBlockTime();
     int64_t nStakeModifierSelectionInterval = GetStakeModifierSelectionInterval();
@@ -346,6 +385,21 @@ static bool GetKernelStakeModifier(CBlockIndex* pindexPrev, uint256 hashBlockFro
         }
     }
     nStakeModifier = pindex->nStakeModifier;
+
+    // Remember the result when the whole walk ran along the active chain
+    // (tmpChain is only populated for branch blocks)
+    if (tmpChain.empty() && chainActive.Contains(pindex))
+    {
+        if ((int)vStakeModifierCache.size() <= pindexFrom->nHeight)
+            vStakeModifierCache.resize(pindexFrom->nHeight + 1);
+        CStakeModifierCacheEntry& entry = vStakeModifierCache[pindexFrom->nHeight];
+        entry.fValid = true;
+        entry.nStakeModifier = nStakeModifier;
+        entry.nStakeModifierHeight = nStakeModifierHeight;
+        entry.nStakeModifierTime = nStakeModifierTime;
+        entry.nTerminatorHeight = pindex->nHeight;
+        entry.hashTerminator = pindex->GetBlockHash();
+    }
     return true;
 }
 
@@ -535,6 +589,168 @@ bool CheckStakeKernelHash(uint32_t nBits, CBlockIndex* pindexPrev,
     return true;
 }
 
+// Size of the GetProofOfStakeHash preimage: nStakeModifier (8) followed by
+// five 32-bit fields, nTimeTx last
+static const size_t KERNEL_PREIMAGE_SIZE = 8 + 5 * 4;
+
+// Per-candidate state after the serial setup phase of ScanStakeKernelHashes:
+// everything the hash loop needs, with the block-index walk and the stream
+// serialization already done
+struct CStakeKernelScanState {
+    size_t nCandidate;                              // index into vCandidates
+    unsigned char preimage[KERNEL_PREIMAGE_SIZE];   // nTimeTx patched in per try
+    ::uint32_t nTimeTxFirst;                        // first timestamp passing the age checks
+    ::uint32_t nTxPrevTime;
+    ::int64_t nValueIn;
+};
+
+static void ScanStakeKernelWorker(
+                                  const std::vector<CStakeKernelScanState>* pvStates,
+                                  ::uint32_t nTimeTxEnd,
+                                  const CBigNum* pbnTargetPerCoinDay,
+                                  size_t nWorker,
+                                  size_t nThreads,
+                                  std::vector<CStakeKernelHit>* pvHits
+                                 )
+{
+    // OpenSSL bignums are not meant to be shared across threads; work on copies
+    const CBigNum bnTargetPerCoinDay(*pbnTargetPerCoinDay);
+    for (size_t i = nWorker; i < pvStates->size(); i += nThreads)
+    {
+        const CStakeKernelScanState& state = (*pvStates)[i];
+        unsigned char preimage[KERNEL_PREIMAGE_SIZE];
+        memcpy(preimage, state.preimage, sizeof(preimage));
+        for (::uint32_t nTimeTx = state.nTimeTxFirst; nTimeTx < nTimeTxEnd; ++nTimeTx)
+        {
+            CBigNum
+                bnCoinDayWeight = CBigNum(state.nValueIn) * GetWeight(
+                                                                      (::int64_t)state.nTxPrevTime,
+                                                                      (::int64_t)nTimeTx
+                                                                     ) / COIN / (24 * 60 * 60);
+            WriteLE32(preimage + sizeof(preimage) - 4, nTimeTx);
+            uint256 hashProofOfStake = Hash(preimage, preimage + sizeof(preimage));
+            if (CBigNum(hashProofOfStake) > (bnCoinDayWeight * bnTargetPerCoinDay))
+                continue;
+            CStakeKernelHit hit;
+            hit.nCandidate = state.nCandidate;
+            hit.nTimeTx = nTimeTx;
+            hit.hashProofOfStake = hashProofOfStake;
+            pvHits->push_back(hit);
+        }
+    }
+}
+
+// Evaluate many (candidate, timestamp) pairs against the stake target in one
+// call. The serial phase below resolves the stake modifier once per source
+// block (GetKernelStakeModifier walks the block index, which is both the
+// expensive part of CheckStakeKernelHash and the reason the caller must hold
+// cs_main) and serializes each candidate's hash preimage once; the hash loop
+// then only patches the trailing nTimeTx field and is fanned out over the
+// -hashcalcthreads workers, same as scrypt_hash_batch().
+bool ScanStakeKernelHashes(unsigned int nBits, CBlockIndex* pindexPrev,
+                           const std::vector<CStakeKernelCandidate>& vCandidates,
+                           ::uint32_t nTimeTxBegin, ::uint32_t nTimeTxEnd,
+                           std::vector<CStakeKernelHit>& vHits)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    if (vCandidates.empty() || nTimeTxBegin >= nTimeTxEnd)
+        return false;
+
+    CBigNum bnTargetPerCoinDay;
+    bnTargetPerCoinDay.SetCompact(nBits);
+
+    std::map<uint256, uint64_t> mapModifiers;   // per source block, not per candidate
+    std::vector<CStakeKernelScanState> vStates;
+    vStates.reserve(vCandidates.size());
+    for (size_t i = 0; i < vCandidates.size(); ++i)
+    {
+        const CStakeKernelCandidate& cand = vCandidates[i];
+        ::uint32_t nTimeBlockFrom = (::uint32_t)cand.pblockFrom->GetBlockTime();
+        // Clamp the range start so the min age and timestamp checks of
+        // CheckStakeKernelHash hold everywhere we hash; candidates that
+        // cannot satisfy them anywhere in the range are dropped here
+        ::uint32_t nTimeTxFirst = std::max(nTimeTxBegin, nTimeBlockFrom + (::uint32_t)params.nStakeMinAge);
+        if ((::int64_t)nTimeTxFirst < cand.ptxPrev->nTime)
+            nTimeTxFirst = (::uint32_t)cand.ptxPrev->nTime;
+        if (nTimeTxFirst >= nTimeTxEnd)
+            continue;
+
+        uint256 hashBlockFrom = cand.pblockFrom->GetHash();
+        ::uint64_t nStakeModifier = 0;
+        std::map<uint256, uint64_t>::const_iterator mi = mapModifiers.find(hashBlockFrom);
+        if (mi != mapModifiers.end())
+            nStakeModifier = mi->second;
+        else
+        {
+            int nStakeModifierHeight = 0;
+            ::int64_t nStakeModifierTime = 0;
+            if (!GetKernelStakeModifier(pindexPrev, hashBlockFrom, nStakeModifier, nStakeModifierHeight, nStakeModifierTime, false))
+                continue;   // same soft failure as CheckStakeKernelHash; may happen if behind on sync
+            mapModifiers[hashBlockFrom] = nStakeModifier;
+        }
+
+        CStakeKernelScanState state;
+        state.nCandidate = i;
+        state.nTimeTxFirst = nTimeTxFirst;
+        state.nTxPrevTime = (::uint32_t)cand.ptxPrev->nTime;
+        state.nValueIn = cand.ptxPrev->vout[cand.prevout.COutPointGet_n()].nValue;
+
+        // Same serialization as GetProofOfStakeHash(); only the trailing
+        // nTimeTx field differs between tries
+        CDataStream ss(SER_GETHASH, 0);
+        ss << nStakeModifier;
+        ss << nTimeBlockFrom << cand.nTxPrevOffset << state.nTxPrevTime << cand.prevout.COutPointGet_n() << nTimeTxFirst;
+        assert(ss.size() == KERNEL_PREIMAGE_SIZE);
+        memcpy(state.preimage, &ss[0], KERNEL_PREIMAGE_SIZE);
+        vStates.push_back(state);
+    }
+    if (vStates.empty())
+        return false;
+
+    size_t
+        nThreads = std::min(vStates.size(), (size_t)std::max(1, nHashCalcThreads));
+    if (nThreads <= 1)
+    {
+        ScanStakeKernelWorker(&vStates, nTimeTxEnd, &bnTargetPerCoinDay, 0, 1, &vHits);
+    }
+    else
+    {
+        std::vector<std::vector<CStakeKernelHit> > vWorkerHits(nThreads);
+        boost::thread_group
+            workers;
+        for (size_t i = 1; i < nThreads; ++i)
+            workers.create_thread(
+                boost::bind(&ScanStakeKernelWorker, &vStates, nTimeTxEnd, &bnTargetPerCoinDay, i, nThreads, &vWorkerHits[i]));
+        ScanStakeKernelWorker(&vStates, nTimeTxEnd, &bnTargetPerCoinDay, 0, nThreads, &vWorkerHits[0]);
+        workers.join_all();
+        for (size_t i = 0; i < nThreads; ++i)
+            vHits.insert(vHits.end(), vWorkerHits[i].begin(), vWorkerHits[i].end());
+    }
+    return !vHits.empty();
+}
+
+::uint32_t GetNextStakeEligibleTime(const std::vector<CStakeKernelCandidate>& vCandidates,
+                                    ::uint32_t nTimeNow)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    ::int64_t nEarliest = 0;
+    for (size_t i = 0; i < vCandidates.size(); ++i)
+    {
+        const CStakeKernelCandidate& cand = vCandidates[i];
+        // Mirror the min age checks of CheckStakeKernelHash: the kernel
+        // timestamp must be at least nStakeMinAge past the source block time,
+        // and the coin-day weight is only positive once it is also
+        // nStakeMinAge past the staked transaction time
+        ::int64_t nEligible = std::max(cand.pblockFrom->GetBlockTime() + params.nStakeMinAge,
+                                       (::int64_t)cand.ptxPrev->nTime + params.nStakeMinAge);
+        if (nEligible < (::int64_t)nTimeNow)
+            nEligible = nTimeNow;
+        if (nEarliest == 0 || nEligible < nEarliest)
+            nEarliest = nEligible;
+    }
+    return (::uint32_t)nEarliest;
+}
+
 // Check kernel hash target and coinstake signature
 bool CheckProofOfStake(CValidationState &state, CBlockIndex* pindexPrev, const CTransaction& tx, unsigned int nBits, uint256& hashProofOfStake, uint256& targetProofOfStake)
 {
@@ -605,7 +821,8 @@ uint32_t GetStakeModifierChecksum(const CBlockIndex* pindex)
     CDataStream ss(SER_GETHASH, 0);
     if (pindex->pprev)
         ss << pindex->pprev->nStakeModifierChecksum;
-    ss << pindex->nFlags << pindex->hashProofOfStake << pindex->nStakeModifier;
+    // only PoS blocks carry a proof hash; skip the cold-field load for PoW
+    ss << pindex->nFlags << (pindex->IsProofOfStake()? pindex->GetHashProofOfStake() : uint256()) << pindex->nStakeModifier;
     uint256 hashChecksum = Hash(ss.begin(), ss.end());
     hashChecksum >>= (256 - 32);
     return hashChecksum.Get64();
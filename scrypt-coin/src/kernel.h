@@ -39,6 +39,44 @@ bool CheckStakeKernelHash(unsigned int nBits, CBlockIndex* pindexPrev,
                           uint256& targetProofOfStake,
                           bool fPrintProofOfStake = false);
 
+// One stakeable output submitted to ScanStakeKernelHashes; pointers must
+// outlive the scan
+struct CStakeKernelCandidate {
+    const CBlockHeader* pblockFrom; // block containing txPrev
+    ::uint32_t nTxPrevOffset;       // offset of txPrev inside that block
+    const CTransaction* ptxPrev;    // coin being staked
+    COutPoint prevout;              // output of txPrev being staked
+};
+
+// A (candidate, timestamp) pair that met the proof-of-stake target
+struct CStakeKernelHit {
+    size_t nCandidate;              // index into the scanned candidate vector
+    ::uint32_t nTimeTx;
+    uint256 hashProofOfStake;
+};
+
+// Evaluate every (candidate, timestamp) pair in [nTimeTxBegin, nTimeTxEnd)
+// against the stake target in a single call, instead of going through
+// CheckStakeKernelHash once per pair. The stake modifier is resolved once per
+// source block (so the caller must hold cs_main) and the hashing is spread
+// over the -hashcalcthreads workers. Appends hits to vHits and returns
+// whether any were found; a hit still has to be confirmed by
+// CheckStakeKernelHash once the coinstake is assembled.
+bool ScanStakeKernelHashes(unsigned int nBits, CBlockIndex* pindexPrev,
+                           const std::vector<CStakeKernelCandidate>& vCandidates,
+                           ::uint32_t nTimeTxBegin, ::uint32_t nTimeTxEnd,
+                           std::vector<CStakeKernelHit>& vHits);
+
+// Earliest timestamp at or after nTimeNow at which any candidate could
+// produce a kernel at all. Eligibility is deterministic: the minimum stake
+// age must have passed against both the source block time and the staked
+// transaction time before the hash has any weight, so a staking driver with
+// few outputs can sleep until exactly this time instead of rescanning on a
+// fixed interval (kernel slots then advance at one-second granularity).
+// Returns 0 when the candidate set is empty.
+::uint32_t GetNextStakeEligibleTime(const std::vector<CStakeKernelCandidate>& vCandidates,
+                                    ::uint32_t nTimeNow);
+
 // Check kernel hash target and coinstake signature
 // Sets hashProofOfStake on success return
 bool CheckProofOfStake(CValidationState &state, CBlockIndex* pindexPrev, const CTransaction& tx, unsigned int nBits, uint256& hashProofOfStake, uint256& targetProofOfStake);
@@ -80,17 +80,26 @@ bool CKeyStore::AddKey(const CKey &key) {
     return AddKeyPubKey(key, key.GetPubKey());
 }
 
+void CBasicKeyStore::IndexScriptsForKey(const CPubKey &pubkey)
+{
+    setIndexedScripts.insert(GetScriptForDestination(pubkey.GetID()));
+    setIndexedScripts.insert(GetScriptForRawPubKey(pubkey));
+}
+
 bool CBasicKeyStore::AddKeyPubKey(const CKey& key, const CPubKey &pubkey)
 {
     LOCK(cs_KeyStore);
     mapKeys[pubkey.GetID()] = key;
+    IndexScriptsForKey(pubkey);
     return true;
 }
 
 bool CBasicKeyStore::AddCScript(const CScript& redeemScript)
 {
     LOCK(cs_KeyStore);
-    mapScripts[CScriptID(redeemScript)] = redeemScript;
+    CScriptID scriptID(redeemScript);
+    mapScripts[scriptID] = redeemScript;
+    setIndexedScripts.insert(GetScriptForDestination(scriptID));
     return true;
 }
 
@@ -126,6 +135,7 @@ bool CBasicKeyStore::AddWatchOnly(const CScript &dest)
     }
 
     setWatchOnly.insert(dest);
+    setIndexedScripts.insert(dest);
     return true;
 }
 
@@ -133,6 +143,9 @@ bool CBasicKeyStore::AddWatchOnly(const CScript &dest)
 bool CBasicKeyStore::RemoveWatchOnly(const CScript &dest)
 {
     LOCK(cs_KeyStore);
+    // The script index is deliberately left alone: the entry may still be
+    // reachable through a key or redeem script, and a stale entry merely
+    // falls through to the full IsMine resolver.
     setWatchOnly.erase(dest);
     return true;
 }
@@ -148,3 +161,9 @@ bool CBasicKeyStore::HaveWatchOnly() const
     LOCK(cs_KeyStore);
     return (!setWatchOnly.empty());
 }
+
+bool CBasicKeyStore::HaveIndexedScript(const CScript& script) const
+{
+    LOCK(cs_KeyStore);
+    return setIndexedScripts.count(script) > 0;
+}
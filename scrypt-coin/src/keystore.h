@@ -50,11 +50,16 @@ public:
     virtual bool HaveWatchOnly() const =0;
 
     virtual bool GetSecret(const CScript& scriptPubKey, CKeyingMaterial& vchSecret, bool &fCompressed, txnouttype& whichTypeRet, CScript& subscript) const = 0;
+
+    // Fast-path membership test against the precomputed scriptPubKey index.
+    // May conservatively return true for key stores that do not maintain one.
+    virtual bool HaveIndexedScript(const CScript& script) const { return true; }
 };
 
 typedef std::map<CKeyID, CKey> KeyMap;
 typedef std::map<CScriptID, CScript > ScriptMap;
 typedef std::set<CScript> WatchOnlySet;
+typedef std::set<CScript> ScriptPubKeyIndex;
 
 /** Basic key store, that keeps keys in an address->secret map */
 class CBasicKeyStore : public CKeyStore
@@ -63,6 +68,15 @@ protected:
     KeyMap mapKeys;
     ScriptMap mapScripts;
     WatchOnlySet setWatchOnly;
+    //! Every scriptPubKey the maps above can match through a single lookup
+    //! (P2PK/P2PKH per key, P2SH per stored redeem script, and all
+    //! watch-only scripts). Entries are only added, never removed: a stale
+    //! entry just sends the script through the full IsMine resolver.
+    ScriptPubKeyIndex setIndexedScripts;
+
+    //! Add the single-lookup scriptPubKeys for a key to the script index.
+    //! The caller must hold cs_KeyStore.
+    void IndexScriptsForKey(const CPubKey &pubkey);
 
 public:
     bool AddKeyPubKey(const CKey& key, const CPubKey &pubkey);
@@ -110,6 +124,8 @@ public:
     virtual bool RemoveWatchOnly(const CScript &dest);
     virtual bool HaveWatchOnly(const CScript &dest) const;
     virtual bool HaveWatchOnly() const;
+
+    bool HaveIndexedScript(const CScript& script) const;
 };
 
 #endif
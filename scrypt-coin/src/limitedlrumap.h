@@ -0,0 +1,199 @@
+// Copyright (c) 2012-2016 The Bitcoin Core developers
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YACOIN_LIMITEDLRUMAP_H
+#define YACOIN_LIMITEDLRUMAP_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/** Bounded map that evicts the least recently touched entry once full.
+ *
+ * Replacement for the old limitedmap: an open-addressing hash table
+ * (linear probing with backward-shift deletion, so no tombstones) over a
+ * slab of entries preallocated in the constructor, with the recency order
+ * kept as an intrusive doubly-linked list threaded through the slab.
+ * Nothing on the insert/update/erase path allocates or rebalances, which
+ * matters for the request-tracking maps that churn on every inv.
+ *
+ * The table is kept at most half full, so probe runs stay short. Hasher
+ * must be salted when keys are remote-controlled.
+ */
+template <typename K, typename V, typename Hasher>
+class limitedlrumap
+{
+public:
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef std::pair<K, V> value_type;
+    //! Valid only until the next insert/erase; end() is the null pointer.
+    typedef const value_type* const_iterator;
+    typedef size_t size_type;
+
+private:
+    struct CEntry {
+        value_type data;
+        uint32_t nPrev; //!< towards the most recently used entry
+        uint32_t nNext; //!< towards the least recently used entry, or the next free slot
+    };
+    static const uint32_t NIL = 0xffffffff;
+
+    std::vector<CEntry> vEntries;  //!< preallocated slab, sized once in the constructor
+    std::vector<uint32_t> vTable;  //!< open-addressing table of slab indexes
+    uint32_t nTableMask;
+    uint32_t nHead;                //!< most recently used entry
+    uint32_t nTail;                //!< least recently used entry, evicted first
+    uint32_t nFree;                //!< head of the free list, linked through nNext
+    size_type nSize;
+    size_type nMaxSize;
+    Hasher hasher;
+
+    uint32_t TableSlot(const key_type& k) const { return (uint32_t)hasher(k) & nTableMask; }
+
+    //! Table index holding the entry for k, or the empty slot ending its probe run.
+    uint32_t Probe(const key_type& k) const
+    {
+        uint32_t i = TableSlot(k);
+        while (vTable[i] != NIL && !(vEntries[vTable[i]].data.first == k))
+            i = (i + 1) & nTableMask;
+        return i;
+    }
+
+    void Unlink(uint32_t n)
+    {
+        CEntry& e = vEntries[n];
+        if (e.nPrev != NIL) vEntries[e.nPrev].nNext = e.nNext; else nHead = e.nNext;
+        if (e.nNext != NIL) vEntries[e.nNext].nPrev = e.nPrev; else nTail = e.nPrev;
+    }
+
+    void LinkFront(uint32_t n)
+    {
+        CEntry& e = vEntries[n];
+        e.nPrev = NIL;
+        e.nNext = nHead;
+        if (nHead != NIL) vEntries[nHead].nPrev = n;
+        nHead = n;
+        if (nTail == NIL) nTail = n;
+    }
+
+    //! Clear table slot i, backward-shifting the rest of its probe run so
+    //! lookups never have to step over tombstones.
+    void TableErase(uint32_t i)
+    {
+        uint32_t j = i;
+        for (;;) {
+            j = (j + 1) & nTableMask;
+            if (vTable[j] == NIL)
+                break;
+            uint32_t nIdeal = TableSlot(vEntries[vTable[j]].data.first);
+            // Only move j into the hole if that doesn't lift it above its ideal slot
+            if (((j - nIdeal) & nTableMask) >= ((j - i) & nTableMask)) {
+                vTable[i] = vTable[j];
+                i = j;
+            }
+        }
+        vTable[i] = NIL;
+    }
+
+    //! Remove entry n, known to live at table slot i.
+    void EraseIndex(uint32_t n, uint32_t i)
+    {
+        TableErase(i);
+        Unlink(n);
+        vEntries[n].nNext = nFree;
+        nFree = n;
+        --nSize;
+    }
+
+public:
+    limitedlrumap(size_type nMaxSizeIn)
+    {
+        assert(nMaxSizeIn > 0 && nMaxSizeIn < NIL);
+        nMaxSize = nMaxSizeIn;
+        nSize = 0;
+        nHead = nTail = NIL;
+        vEntries.resize(nMaxSizeIn);
+        for (size_type n = 0; n < nMaxSizeIn; n++)
+            vEntries[n].nNext = (n + 1 < nMaxSizeIn) ? (uint32_t)(n + 1) : NIL;
+        nFree = 0;
+        size_type nTableSize = 2;
+        while (nTableSize < 2 * nMaxSizeIn)
+            nTableSize <<= 1;
+        vTable.assign(nTableSize, NIL);
+        nTableMask = (uint32_t)(nTableSize - 1);
+    }
+
+    size_type size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+    const_iterator end() const { return nullptr; }
+
+    const_iterator find(const key_type& k) const
+    {
+        uint32_t i = Probe(k);
+        return (vTable[i] == NIL) ? nullptr : &vEntries[vTable[i]].data;
+    }
+    size_type count(const key_type& k) const { return (find(k) == nullptr) ? 0 : 1; }
+
+    void insert(const value_type& x)
+    {
+        uint32_t i = Probe(x.first);
+        if (vTable[i] != NIL)
+            return; // like std::map::insert, an existing key keeps its value
+        if (nSize == nMaxSize) {
+            EraseIndex(nTail, Probe(vEntries[nTail].data.first));
+            // The eviction's backward shift may have moved our empty slot
+            i = Probe(x.first);
+        }
+        uint32_t n = nFree;
+        nFree = vEntries[n].nNext;
+        vEntries[n].data = x;
+        LinkFront(n);
+        vTable[i] = n;
+        ++nSize;
+    }
+
+    void erase(const key_type& k)
+    {
+        uint32_t i = Probe(k);
+        if (vTable[i] == NIL)
+            return;
+        EraseIndex(vTable[i], i);
+    }
+
+    //! Assign a new value and mark the entry most recently used.
+    void update(const_iterator itIn, const mapped_type& v)
+    {
+        if (itIn == nullptr)
+            return;
+        uint32_t i = Probe(itIn->first);
+        if (vTable[i] == NIL)
+            return;
+        uint32_t n = vTable[i];
+        vEntries[n].data.second = v;
+        if (n != nHead) {
+            Unlink(n);
+            LinkFront(n);
+        }
+    }
+
+    size_type max_size() const { return nMaxSize; }
+    //! Lower (or restore) the cap; cannot grow past the preallocated slab.
+    size_type max_size(size_type s)
+    {
+        assert(s > 0 && s <= vEntries.size());
+        while (nSize > s)
+            EraseIndex(nTail, Probe(vEntries[nTail].data.first));
+        nMaxSize = s;
+        return nMaxSize;
+    }
+};
+
+template <typename K, typename V, typename Hasher>
+const uint32_t limitedlrumap<K, V, Hasher>::NIL;
+
+#endif // YACOIN_LIMITEDLRUMAP_H
@@ -0,0 +1,56 @@
+// Copyright (c) 2024 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "memmonitor.h"
+
+#include "coins.h"
+#include "net.h"
+#include "tokens/tokens.h"
+#include "txmempool.h"
+#include "util.h"
+#include "validation.h"
+
+MemoryComponentUsage GetMemoryComponentUsage()
+{
+    MemoryComponentUsage usage;
+    usage.nMempool = mempool.DynamicMemoryUsage();
+    usage.nCoinsCache = pcoinsTip ? pcoinsTip->DynamicMemoryUsage() : 0;
+    usage.nPeerBuffers = g_connman ? g_connman->GetTotalBufferedBytes() : 0;
+    usage.nTokenCache = ptokens ? ptokens->DynamicMemoryUsage() : 0;
+    usage.nTotal = usage.nMempool + usage.nCoinsCache + usage.nPeerBuffers + usage.nTokenCache;
+    return usage;
+}
+
+void CheckMemoryPressure()
+{
+    int64_t nLimit = gArgs.GetArg("-maxmemory", DEFAULT_MAX_MEMORY_MB) * 1000000;
+    if (nLimit <= 0)
+        return;
+    MemoryComponentUsage usage = GetMemoryComponentUsage();
+    if ((int64_t)usage.nTotal <= nLimit)
+        return;
+
+    size_t nExcess = usage.nTotal - (size_t)nLimit;
+    LogPrintf("%s: tracked memory %.1f MB over the %.1f MB limit "
+              "(mempool %.1f MB, coins cache %.1f MB, peer buffers %.1f MB, token cache %.1f MB)\n",
+              __func__, usage.nTotal / 1000000.0, nLimit / 1000000.0,
+              usage.nMempool / 1000000.0, usage.nCoinsCache / 1000000.0,
+              usage.nPeerBuffers / 1000000.0, usage.nTokenCache / 1000000.0);
+
+    // The mempool is the cheapest component to shed: evicted transactions
+    // can be re-relayed, nothing has to hit the disk
+    if (usage.nMempool > 0) {
+        size_t nMempoolTarget = usage.nMempool > nExcess ? usage.nMempool - nExcess : 0;
+        mempool.TrimToSize(nMempoolTarget);
+    }
+
+    // If trimming the mempool was not enough, write the coins cache out;
+    // Flush() empties the cache map so the memory is actually returned
+    usage = GetMemoryComponentUsage();
+    if ((int64_t)usage.nTotal > nLimit && usage.nCoinsCache > 0) {
+        LogPrintf("%s: still %.1f MB over the limit after mempool trim, flushing coins cache\n",
+                  __func__, (usage.nTotal - nLimit) / 1000000.0);
+        FlushStateToDisk();
+    }
+}
@@ -0,0 +1,43 @@
+// Copyright (c) 2024 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YACOIN_MEMMONITOR_H
+#define YACOIN_MEMMONITOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Central memory accountant.
+ *
+ * memusage.h provides per-structure estimators but nothing aggregates them;
+ * this pulls the big dynamic consumers — mempool, coins cache, peer buffers,
+ * token cache — into one snapshot so "getmemoryinfo" can attribute usage,
+ * and optionally sheds load before the kernel OOM killer picks the process.
+ */
+
+//! -maxmemory default (MB); 0 disables pressure checking
+static const int64_t DEFAULT_MAX_MEMORY_MB = 0;
+//! How often the pressure check samples the components (seconds)
+static const int64_t MEMORY_PRESSURE_CHECK_INTERVAL = 10;
+
+/** One snapshot of the tracked components, in bytes. */
+struct MemoryComponentUsage
+{
+    size_t nMempool;     //!< CTxMemPool::DynamicMemoryUsage
+    size_t nCoinsCache;  //!< pcoinsTip->DynamicMemoryUsage
+    size_t nPeerBuffers; //!< summed per-CNode send and process queue bytes
+    size_t nTokenCache;  //!< ptokens->DynamicMemoryUsage
+    size_t nTotal;       //!< sum of the above
+};
+
+/** Sample all tracked components. Cheap: every component keeps a running
+ *  counter, no structure is walked. */
+MemoryComponentUsage GetMemoryComponentUsage();
+
+/** Scheduled every MEMORY_PRESSURE_CHECK_INTERVAL seconds when -maxmemory is
+ *  set. While the tracked total exceeds the limit this trims the mempool by
+ *  the excess and, if that is not enough, flushes the coins cache to disk. */
+void CheckMemoryPressure();
+
+#endif // YACOIN_MEMMONITOR_H
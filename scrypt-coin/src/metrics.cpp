@@ -0,0 +1,125 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "metrics.h"
+
+#include "httpserver.h"
+#include "rpc/protocol.h"
+#include "tinyformat.h"
+
+CNodeMetrics g_metrics;
+
+// Finite bucket upper bounds, in microseconds (1ms .. 5s). Chosen so a
+// healthy node lands mid-range for block connects and flushes, with room
+// on both sides to see regressions.
+static const ::int64_t vUpperMicros[CMetricHistogram::NUM_BUCKETS] = {
+    1000, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 5000000
+};
+
+CMetricHistogram::CMetricHistogram()
+{
+    for (int i = 0; i < NUM_BUCKETS; i++)
+        vBuckets[i].store(0, std::memory_order_relaxed);
+    nCount.store(0, std::memory_order_relaxed);
+    nSumMicros.store(0, std::memory_order_relaxed);
+}
+
+void CMetricHistogram::Observe(::int64_t nMicros)
+{
+    int i = 0;
+    while (i < NUM_BUCKETS && nMicros > vUpperMicros[i])
+        i++;
+    if (i < NUM_BUCKETS)
+        vBuckets[i].fetch_add(1, std::memory_order_relaxed);
+    nCount.fetch_add(1, std::memory_order_relaxed);
+    nSumMicros.fetch_add(nMicros, std::memory_order_relaxed);
+}
+
+void CMetricHistogram::Format(const std::string& strName, std::string& strOut) const
+{
+    strOut += strprintf("# TYPE %s histogram\n", strName);
+    ::uint64_t nCumulative = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        nCumulative += vBuckets[i].load(std::memory_order_relaxed);
+        strOut += strprintf("%s_bucket{le=\"%g\"} %d\n", strName, vUpperMicros[i] * 0.000001, nCumulative);
+    }
+    strOut += strprintf("%s_bucket{le=\"+Inf\"} %d\n", strName, nCount.load(std::memory_order_relaxed));
+    strOut += strprintf("%s_sum %g\n", strName, nSumMicros.load(std::memory_order_relaxed) * 0.000001);
+    strOut += strprintf("%s_count %d\n", strName, nCount.load(std::memory_order_relaxed));
+}
+
+CNodeMetrics::CNodeMetrics()
+{
+    nBlocksConnected.store(0, std::memory_order_relaxed);
+    nChainFlushes.store(0, std::memory_order_relaxed);
+    nMempoolTxCount.store(0, std::memory_order_relaxed);
+    nMempoolBytes.store(0, std::memory_order_relaxed);
+    nPeerCount.store(0, std::memory_order_relaxed);
+    nSigCacheHits.store(0, std::memory_order_relaxed);
+    nSigCacheMisses.store(0, std::memory_order_relaxed);
+    nCoinsCacheHits.store(0, std::memory_order_relaxed);
+    nCoinsCacheMisses.store(0, std::memory_order_relaxed);
+}
+
+static void FormatCounter(const std::string& strName, ::int64_t nValue, std::string& strOut)
+{
+    strOut += strprintf("# TYPE %s counter\n%s %d\n", strName, strName, nValue);
+}
+
+static void FormatGauge(const std::string& strName, ::int64_t nValue, std::string& strOut)
+{
+    strOut += strprintf("# TYPE %s gauge\n%s %d\n", strName, strName, nValue);
+}
+
+std::string FormatNodeMetrics()
+{
+    std::string strOut;
+    strOut.reserve(4096);
+
+    FormatCounter("yacoin_blocks_connected_total", g_metrics.nBlocksConnected.load(std::memory_order_relaxed), strOut);
+    g_metrics.histBlockConnect.Format("yacoin_block_connect_seconds", strOut);
+    FormatCounter("yacoin_chain_flushes_total", g_metrics.nChainFlushes.load(std::memory_order_relaxed), strOut);
+    g_metrics.histChainFlush.Format("yacoin_chain_flush_seconds", strOut);
+
+    FormatGauge("yacoin_mempool_tx_count", g_metrics.nMempoolTxCount.load(std::memory_order_relaxed), strOut);
+    FormatGauge("yacoin_mempool_bytes", g_metrics.nMempoolBytes.load(std::memory_order_relaxed), strOut);
+
+    FormatGauge("yacoin_peers", g_metrics.nPeerCount.load(std::memory_order_relaxed), strOut);
+
+    FormatCounter("yacoin_sigcache_hits_total", g_metrics.nSigCacheHits.load(std::memory_order_relaxed), strOut);
+    FormatCounter("yacoin_sigcache_misses_total", g_metrics.nSigCacheMisses.load(std::memory_order_relaxed), strOut);
+    FormatCounter("yacoin_coins_cache_hits_total", g_metrics.nCoinsCacheHits.load(std::memory_order_relaxed), strOut);
+    FormatCounter("yacoin_coins_cache_misses_total", g_metrics.nCoinsCacheMisses.load(std::memory_order_relaxed), strOut);
+
+    return strOut;
+}
+
+static bool HTTPReq_Metrics(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "only GET requests are supported");
+        return false;
+    }
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, FormatNodeMetrics());
+    return true;
+}
+
+/** Scrapes are read-only loads; keep them off the normal JSON-RPC lane so
+ *  a slow scraper can never queue ahead of real requests. */
+static HTTPWorkClass MetricsWorkClass(HTTPRequest* req)
+{
+    return HTTP_WORK_BULK;
+}
+
+bool StartMetrics()
+{
+    RegisterHTTPHandler("/metrics", true, HTTPReq_Metrics, MetricsWorkClass);
+    return true;
+}
+
+void StopMetrics()
+{
+    UnregisterHTTPHandler("/metrics", true);
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YACOIN_METRICS_H
+#define YACOIN_METRICS_H
+
+#include <atomic>
+#include <string>
+
+/** In-process metric registry, scraped over HTTP in Prometheus text format.
+ *
+ * The RPC surface (getnetworkinfo, getmempoolinfo, ...) answers the same
+ * questions but takes the subsystem locks to do it, so a monitoring poll
+ * competes with validation and peers for them. Everything here is a plain
+ * relaxed atomic updated in place by the hot path that already owns the
+ * value; the /metrics handler only loads, so scraping never perturbs the
+ * node. The metric set is fixed at compile time -- adding one means adding
+ * a member here and a line to FormatNodeMetrics().
+ */
+
+/** Fixed-bucket latency histogram (lock-free).
+ *
+ * Buckets are cumulative-formatted at scrape time, not at observe time, so
+ * Observe() is two relaxed fetch_adds. Observations are in microseconds;
+ * the exposition converts to seconds per Prometheus convention.
+ */
+class CMetricHistogram
+{
+public:
+    //! Number of finite buckets; the +Inf bucket is implied by the count.
+    static const int NUM_BUCKETS = 10;
+
+    CMetricHistogram();
+
+    //! Record one observation, in microseconds.
+    void Observe(::int64_t nMicros);
+
+    //! Append the exposition lines for a histogram named strName to strOut.
+    void Format(const std::string& strName, std::string& strOut) const;
+
+private:
+    std::atomic< ::uint64_t> vBuckets[NUM_BUCKETS];
+    std::atomic< ::uint64_t> nCount;
+    std::atomic< ::int64_t> nSumMicros;
+};
+
+/** Every metric the node exports. Counters only ever increase; gauges are
+ *  overwritten by whichever path last changed the underlying value. */
+struct CNodeMetrics
+{
+    CNodeMetrics();
+
+    // Validation
+    std::atomic< ::int64_t> nBlocksConnected;   //!< blocks connected to the active chain
+    CMetricHistogram histBlockConnect;          //!< ConnectBlock wall time per block
+    std::atomic< ::int64_t> nChainFlushes;      //!< full chainstate flushes to disk
+    CMetricHistogram histChainFlush;            //!< FlushStateToDisk full-flush wall time
+
+    // Mempool (gauges; stored under the mempool lock, loaded without it)
+    std::atomic< ::int64_t> nMempoolTxCount;
+    std::atomic< ::int64_t> nMempoolBytes;
+
+    // Net
+    std::atomic< ::int64_t> nPeerCount;
+
+    // Caches
+    std::atomic< ::int64_t> nSigCacheHits;
+    std::atomic< ::int64_t> nSigCacheMisses;
+    std::atomic< ::int64_t> nCoinsCacheHits;
+    std::atomic< ::int64_t> nCoinsCacheMisses;
+};
+
+extern CNodeMetrics g_metrics;
+
+//! Render every metric in Prometheus text exposition format.
+std::string FormatNodeMetrics();
+
+/** Register the /metrics handler on the HTTP server. The counters are
+ *  always maintained; this only controls whether they are exposed. */
+bool StartMetrics();
+void StopMetrics();
+
+#endif // YACOIN_METRICS_H
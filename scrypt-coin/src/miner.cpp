@@ -185,13 +185,22 @@ int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParam
     return nNewTime - nOldTime;
 }
 
-BlockAssembler::BlockAssembler()
+BlockAssembler::BlockAssembler(int64_t nMaxValidationTimeMs, int64_t nTemplateBudgetMs)
 {
     // Largest block you're willing to create
     nBlockMaxSize = GetMaxSize(MAX_BLOCK_SIZE);
 
     // Maximum number of sig operations in a block you're willing to create
     nBlockMaxSigOps = GetMaxSize(MAX_BLOCK_SIGOPS);
+
+    // Validation cost and assembly latency budgets, per-call override first
+    if (nMaxValidationTimeMs < 0)
+        nMaxValidationTimeMs = gArgs.GetArg("-blockmaxvalidationtime", DEFAULT_BLOCK_MAX_VALIDATION_TIME);
+    if (nTemplateBudgetMs < 0)
+        nTemplateBudgetMs = gArgs.GetArg("-blocktemplatebudget", DEFAULT_BLOCK_TEMPLATE_BUDGET);
+    nBlockMaxValidationTimeUs = nMaxValidationTimeMs * 1000;
+    nAssemblyBudgetUs = nTemplateBudgetMs * 1000;
+    nAssemblyDeadlineUs = 0;
 }
 
 void BlockAssembler::resetBlock()
@@ -201,6 +210,7 @@ void BlockAssembler::resetBlock()
     // Reserve space for coinbase tx
     nBlockSigOpsCost = 100;
     nBlockSize = 1000;
+    nBlockValidationTimeUs = 0;
 
     // These counters do not include coinbase tx
     nBlockTx = 0;
@@ -230,6 +240,7 @@ void BlockAssembler::AddToBlock(CTxMemPool::txiter iter)
     nBlockSize += iter->GetTxSize();
     ++nBlockTx;
     nBlockSigOpsCost += iter->GetSigOpCost();
+    nBlockValidationTimeUs += iter->GetValidationTime();
     nFees += iter->GetFee();
     inBlock.insert(iter);
 
@@ -310,6 +321,13 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
 
     while (mi != mempool.mapTx.get<ancestor_score>().end() || !mapModifiedTx.empty())
     {
+        // Ship whatever has been selected once the assembly budget runs out;
+        // the loop walks best-feerate-first so the remainder is the tail
+        if (nAssemblyDeadlineUs && GetTimeMicros() > nAssemblyDeadlineUs) {
+            LogPrintf("%s(): assembly budget exhausted after %d packages\n", __func__, nPackagesSelected);
+            break;
+        }
+
         // First try to find a new transaction in mapTx to evaluate.
         if (mi != mempool.mapTx.get<ancestor_score>().end() &&
                 SkipMapTxEntry(mempool.mapTx.project<0>(mi), mapModifiedTx, failedTx)) {
@@ -417,6 +435,100 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
     }
 }
 
+// Orders txiters by the ancestor feerate of the entries they point to,
+// best first, matching the iteration order of the ancestor_score index.
+struct CompareTxIterByAncestorScore {
+    bool operator()(const CTxMemPool::txiter &a, const CTxMemPool::txiter &b) const
+    {
+        return CompareTxMemPoolEntryByAncestorFee()(*a, *b);
+    }
+};
+
+// Incremental counterpart of addPackageTxs: assumes inBlock already holds a
+// selection made for the same tip and evaluates only vCandidates as new
+// entrants. A candidate's package can still pull in unselected ancestors,
+// and its inclusion updates descendant state just as in the full walk, but
+// transactions that were neither selected before nor among the candidates
+// are never reconsidered. That is sound because the block only gets fuller
+// between runs and the fee floor does not move, so an entry passed over by
+// the previous run would be passed over again.
+void BlockAssembler::addCandidateTxs(const std::vector<CTxMemPool::txiter>& vCandidates, int &nPackagesSelected, int &nDescendantsUpdated)
+{
+    indexed_modified_transaction_set mapModifiedTx;
+    CTxMemPool::setEntries failedTx;
+
+    // Start by adding all descendants of previously added txs to mapModifiedTx
+    // and modifying them for their already included ancestors
+    UpdatePackagesForAdded(inBlock, mapModifiedTx);
+
+    std::vector<CTxMemPool::txiter> vSorted(vCandidates);
+    std::sort(vSorted.begin(), vSorted.end(), CompareTxIterByAncestorScore());
+
+    for (size_t i = 0; i < vSorted.size(); ++i) {
+        if (nAssemblyDeadlineUs && GetTimeMicros() > nAssemblyDeadlineUs) {
+            LogPrintf("%s(): assembly budget exhausted after %d packages\n", __func__, nPackagesSelected);
+            break;
+        }
+
+        CTxMemPool::txiter iter = vSorted[i];
+        if (inBlock.count(iter) || failedTx.count(iter))
+            continue;
+
+        uint64_t packageSize = iter->GetSizeWithAncestors();
+        CAmount packageFees = iter->GetModFeesWithAncestors();
+        int64_t packageSigOpsCost = iter->GetSigOpCostWithAncestors();
+
+        // Use the ancestor state adjusted for already included ancestors,
+        // if there is one
+        modtxiter modit = mapModifiedTx.find(iter);
+        if (modit != mapModifiedTx.end()) {
+            packageSize = modit->nSizeWithAncestors;
+            packageFees = modit->nModFeesWithAncestors;
+            packageSigOpsCost = modit->nSigOpCostWithAncestors;
+        }
+
+        if (packageFees < GetMinFee(packageSize)) {
+            // Unlike the full walk we can't return early here: candidates
+            // with modified ancestor state may still score higher
+            continue;
+        }
+
+        if (!TestPackage(packageSize, packageSigOpsCost)) {
+            failedTx.insert(iter);
+            continue;
+        }
+
+        CTxMemPool::setEntries ancestors;
+        uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+        std::string dummy;
+        mempool.CalculateMemPoolAncestors(*iter, ancestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+
+        onlyUnconfirmed(ancestors);
+        ancestors.insert(iter);
+
+        // Test if all tx's are Final
+        if (!TestPackageTransactions(ancestors)) {
+            failedTx.insert(iter);
+            continue;
+        }
+
+        // Package can be added. Sort the entries in a valid order.
+        std::vector<CTxMemPool::txiter> sortedEntries;
+        SortForBlock(ancestors, iter, sortedEntries);
+
+        for (size_t j = 0; j < sortedEntries.size(); ++j) {
+            AddToBlock(sortedEntries[j]);
+            // Erase from the modified set, if present
+            mapModifiedTx.erase(sortedEntries[j]);
+        }
+
+        ++nPackagesSelected;
+
+        // Update transactions that depend on each of these
+        nDescendantsUpdated += UpdatePackagesForAdded(ancestors, mapModifiedTx);
+    }
+}
+
 void BlockAssembler::onlyUnconfirmed(CTxMemPool::setEntries& testSet)
 {
     for (CTxMemPool::setEntries::iterator iit = testSet.begin(); iit != testSet.end(); ) {
@@ -441,22 +553,31 @@ bool BlockAssembler::TestPackage(uint64_t packageSize, int64_t packageSigOpsCost
 
 // Perform transaction-level checks before adding to block:
 // - transaction finality (locktime)
+// - the package's measured validation cost fits in the remaining budget
 bool BlockAssembler::TestPackageTransactions(const CTxMemPool::setEntries& package)
 {
+    int64_t nPackageValidationTimeUs = 0;
     for (const CTxMemPool::txiter it : package) {
         const CTransaction& tx = it->GetTx();
         if (!IsFinalTx(tx, nHeight, nLockTimeCutoff))
             return false;
+        nPackageValidationTimeUs += it->GetValidationTime();
     }
+    // Rejecting just this package keeps the selection walking: cheap plain
+    // payments still enter after the token-heavy budget is spent
+    if (nBlockMaxValidationTimeUs &&
+            nBlockValidationTimeUs + nPackageValidationTimeUs > nBlockMaxValidationTimeUs)
+        return false;
     return true;
 }
 
-std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn)
+CBlockIndex* BlockAssembler::prepareBlock(const CScript& scriptPubKeyIn)
 {
-    int64_t nTimeStart = GetTimeMicros();
-
     resetBlock();
 
+    if (nAssemblyBudgetUs > 0)
+        nAssemblyDeadlineUs = GetTimeMicros() + nAssemblyBudgetUs;
+
     pblocktemplate.reset(new CBlockTemplate());
 
     if(!pblocktemplate.get())
@@ -491,11 +612,12 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
                        ? nMedianTimePast
                        : pblock->GetBlockTime();
 
-    // Add transaction to block
-    int nPackagesSelected = 0;
-    int nDescendantsUpdated = 0;
-    addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+    return pindexPrev;
+}
 
+std::unique_ptr<CBlockTemplate> BlockAssembler::finalizeBlock(CBlockIndex* pindexPrev, int64_t nTimeStart,
+        int nPackagesSelected, int nDescendantsUpdated, const char* pszCaller)
+{
     int64_t nTime1 = GetTimeMicros();
 
     // Used for getmininginfo rpc
@@ -503,7 +625,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     nLastBlockSize = nBlockSize;
 
     if (fDebug && gArgs.GetBoolArg("-printpriority"))
-        LogPrintf("CreateNewBlock (): total size %" PRI64u "\n", nBlockSize);
+        LogPrintf("%s (): total size %" PRI64u "\n", pszCaller, nBlockSize);
 
     // Fill in block header and subsidy for coinbase
     pblock->hashPrevBlock = pindexPrev->GetBlockHash();
@@ -512,14 +634,154 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     pblock->nNonce = 0;
     pblock->vtx[0].vout[0].nValue = GetProofOfWorkReward(pblock->nBits, 0, chainActive.Height() + 1);
 
+    pblocktemplate->nValidationTimeUs = nBlockValidationTimeUs;
+
     LogPrintf(
-        "CreateNewBlock() packages: %.2fms (%d packages, %d updated "
-        "descendants)\n",
-        0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated);
+        "%s() packages: %.2fms (%d packages, %d updated "
+        "descendants, %.2fms validation cost)\n",
+        pszCaller, 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated,
+        0.001 * nBlockValidationTimeUs);
 
     return std::move(pblocktemplate);
 }
 
+std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn)
+{
+    int64_t nTimeStart = GetTimeMicros();
+
+    CBlockIndex* pindexPrev = prepareBlock(scriptPubKeyIn);
+    if (!pindexPrev)
+        return nullptr;
+
+    // Add transaction to block
+    int nPackagesSelected = 0;
+    int nDescendantsUpdated = 0;
+    addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+
+    return finalizeBlock(pindexPrev, nTimeStart, nPackagesSelected, nDescendantsUpdated, "CreateNewBlock");
+}
+
+std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlockIncremental(const CScript& scriptPubKeyIn,
+        const std::vector<CTxMemPool::txiter>& vSeed,
+        const std::vector<CTxMemPool::txiter>& vCandidates)
+{
+    int64_t nTimeStart = GetTimeMicros();
+
+    CBlockIndex* pindexPrev = prepareBlock(scriptPubKeyIn);
+    if (!pindexPrev)
+        return nullptr;
+
+    // Replay the previous selection; it was produced for the same tip, so
+    // its ordering, finality and fit within the block limits are unchanged
+    for (size_t i = 0; i < vSeed.size(); ++i)
+        AddToBlock(vSeed[i]);
+
+    int nPackagesSelected = 0;
+    int nDescendantsUpdated = 0;
+    addCandidateTxs(vCandidates, nPackagesSelected, nDescendantsUpdated);
+
+    return finalizeBlock(pindexPrev, nTimeStart, nPackagesSelected, nDescendantsUpdated, "CreateNewBlockIncremental");
+}
+
+// Upper bound on tracked mempool arrivals before incremental reuse stops
+// paying off and the next template is built from scratch instead
+static const size_t MAX_TRACKED_ARRIVALS = 5000;
+
+void CTemplateAssembler::Invalidate()
+{
+    hashTip.SetNull();
+    vSelected.clear();
+    vArrived.clear();
+}
+
+void CTemplateAssembler::TransactionAddedToMempool(const CTransactionRef& ptxn)
+{
+    LOCK(cs);
+    if (hashTip.IsNull())
+        return; // no cached selection to keep current
+    if (vArrived.size() >= MAX_TRACKED_ARRIVALS) {
+        Invalidate();
+        return;
+    }
+    vArrived.push_back(ptxn->GetHash());
+}
+
+void CTemplateAssembler::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+{
+    LOCK(cs);
+    Invalidate();
+}
+
+void CTemplateAssembler::BlockDisconnected(const std::shared_ptr<const CBlock>& block)
+{
+    LOCK(cs);
+    Invalidate();
+}
+
+std::unique_ptr<CBlockTemplate> CTemplateAssembler::CreateTemplate(const CScript& scriptPubKeyIn,
+        int64_t nMaxValidationTimeMs, int64_t nTemplateBudgetMs)
+{
+    std::vector<uint256> vSeedTxid;
+    std::vector<uint256> vCandidateTxid;
+    uint256 hashTipCached;
+    {
+        LOCK(cs);
+        hashTipCached = hashTip;
+        vSeedTxid = vSelected;
+        vCandidateTxid = vArrived;
+        // Arrivals during assembly below queue up again for the next template
+        vArrived.clear();
+    }
+
+    std::unique_ptr<CBlockTemplate> ptemplate;
+    CBlockIndex* pindexPrev = chainActive.Tip();
+    bool fIncremental = pindexPrev && !hashTipCached.IsNull() &&
+                        hashTipCached == pindexPrev->GetBlockHash();
+
+    if (fIncremental) {
+        // Resolve the cached txids against the current mempool. A selected
+        // transaction that has left the mempool (eviction, conflict)
+        // invalidates the whole selection, since later picks may have been
+        // scored assuming its inclusion; a vanished candidate is just
+        // skipped.
+        std::vector<CTxMemPool::txiter> vSeed;
+        std::vector<CTxMemPool::txiter> vCandidates;
+        vSeed.reserve(vSeedTxid.size());
+        for (size_t i = 0; i < vSeedTxid.size() && fIncremental; ++i) {
+            CTxMemPool::txiter it = mempool.mapTx.find(vSeedTxid[i]);
+            if (it == mempool.mapTx.end())
+                fIncremental = false;
+            else
+                vSeed.push_back(it);
+        }
+        for (size_t i = 0; i < vCandidateTxid.size() && fIncremental; ++i) {
+            CTxMemPool::txiter it = mempool.mapTx.find(vCandidateTxid[i]);
+            if (it != mempool.mapTx.end())
+                vCandidates.push_back(it);
+        }
+        if (fIncremental)
+            ptemplate = BlockAssembler(nMaxValidationTimeMs, nTemplateBudgetMs).CreateNewBlockIncremental(scriptPubKeyIn, vSeed, vCandidates);
+    }
+
+    if (!ptemplate)
+        ptemplate = BlockAssembler(nMaxValidationTimeMs, nTemplateBudgetMs).CreateNewBlock(scriptPubKeyIn);
+
+    if (ptemplate) {
+        LOCK(cs);
+        hashTip = ptemplate->block.hashPrevBlock;
+        vSelected.clear();
+        for (size_t i = 1; i < ptemplate->block.vtx.size(); ++i)
+            vSelected.push_back(ptemplate->block.vtx[i].GetHash());
+    }
+    return ptemplate;
+}
+
+CTemplateAssembler& TemplateAssembler()
+{
+    static CTemplateAssembler templateAssembler;
+    return templateAssembler;
+}
+
 /* NEW IMPLEMENTATION END */
 
 void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev,
@@ -527,7 +789,11 @@ void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev,
   // Update nExtraNonce
   static uint256 hashPrevBlock;
   if (hashPrevBlock != pblock->hashPrevBlock) {
-    nExtraNonce = 0;
+    // Restart at this instance's slice of the extra-nonce space, so
+    // cooperating instances (-minerinstance) never assemble identical
+    // coinbases for the same tip
+    nExtraNonce = Big.get_extra_nonce_base(
+        (unsigned int)gArgs.GetArg("-minerinstance", 0));
     hashPrevBlock = pblock->hashPrevBlock;
   }
   ++nExtraNonce;
@@ -539,7 +805,8 @@ void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev,
   pblock->vtx[0].vin[0].scriptSig =
       (CScript() << nHeight << CScriptNum(nExtraNonce)) + COINBASE_FLAGS;
   Yassert(pblock->vtx[0].vin[0].scriptSig.size() <= 100);
-  pblock->hashMerkleRoot = pblock->BuildMerkleTree();
+  // Only the coinbase changed, so reuse the cached tree's right siblings
+  pblock->hashMerkleRoot = pblock->UpdateCoinbaseMerkleRoot();
 }
 
 void FormatHashBuffers(CBlock* pblock, char* pmidstate, char* pdata,
@@ -719,7 +986,13 @@ static void ScryptMiner() // AdaptivePow miner for Scrypt Coin
     // Make this thread recognisable as the mining thread
     RenameThread("scrypt-miner");
 
-    unsigned int nExtraNonce = 0;
+    // Cooperating instances (regtest stress runs, several validators on
+    // one template) pass distinct -minerinstance ids and mine disjoint
+    // slices of the nonce and extra-nonce spaces instead of colliding
+    // on randomized starting points
+    const unsigned int nMinerInstance =
+        (unsigned int)gArgs.GetArg("-minerinstance", 0);
+    unsigned int nExtraNonce = Big.get_extra_nonce_base(nMinerInstance);
 
     CWallet * pWallet = NULL;
 
@@ -759,6 +1032,11 @@ static void ScryptMiner() // AdaptivePow miner for Scrypt Coin
         }
 
         LogPrintf("Starting mining loop\n");
+        // Cached across iterations; rebuilt only when the chain tip or the
+        // mempool contents move
+        std::unique_ptr<CBlockTemplate> pblocktemplate;
+        CBlockIndex * pindexPrev = nullptr;
+        unsigned int nTransactionsUpdatedLast = 0;
         while (fGenerateYacoins && nBlocksToGenerate != 0) {
             while (IsInitialBlockDownload() || (g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0 && !fTestNet)) {
                 Sleep(nMillisecondsPerSecond);
@@ -773,29 +1051,46 @@ static void ScryptMiner() // AdaptivePow miner for Scrypt Coin
                 Sleep(nMillisecondsPerSecond);
             }
             //
-            // Create new block
+            // Create new block, or reuse the cached one. Exhausting a nonce
+            // range or drifting past the coinbase timestamp does not
+            // invalidate the transaction selection, so in those cases a
+            // fresh extra nonce (and coinbase time) is all that is needed;
+            // only the tip moving or new mempool transactions force a full
+            // template rebuild. On regtest/stress setups this keeps the loop
+            // measuring hash throughput rather than template assembly.
             //
-            unsigned int nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-            CBlockIndex * pindexPrev = chainActive.Tip();
-
-            // Create new block
-            std::unique_ptr < CBlockTemplate > pblocktemplate(BlockAssembler().CreateNewBlock(coinbase_script->reserveScript));
-            if (!pblocktemplate.get())
+            if (!pblocktemplate.get() || pindexPrev != chainActive.Tip() ||
+                mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast)
             {
-                LogPrintf("YacoinMiner -- Keypool ran out, please call keypoolrefill before restarting the mining thread\n");
-                return;
+                nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
+                pindexPrev = chainActive.Tip();
+
+                pblocktemplate = TemplateAssembler().CreateTemplate(coinbase_script->reserveScript);
+                if (!pblocktemplate.get())
+                {
+                    LogPrintf("YacoinMiner -- Keypool ran out, please call keypoolrefill before restarting the mining thread\n");
+                    return;
+                }
+                LogPrintf("Running ScryptMiner with %u transactions in block (%u bytes)\n", pblocktemplate->block.vtx.size(), ::GetSerializeSize(pblocktemplate->block, SER_NETWORK, PROTOCOL_VERSION));
             }
 
             CBlock * pblock = &pblocktemplate->block;
+            // Refresh the coinbase timestamp on reuse, so a template kept
+            // beyond nMaxClockDrift does not trip the drift check again;
+            // IncrementExtraNonce rebuilds the merkle root from the cached
+            // coinbase branch either way
+            pblock->vtx[0].nTime = std::max(pblock->vtx[0].nTime, (::int64_t)GetAdjustedTime());
             IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
+            // Every extra nonce opens a fresh header, so restart the
+            // nonce at this instance's slice base rather than wherever
+            // the previous search left off
+            pblock->nNonce64 = Big.get_nonce_base(nMinerInstance);
 
             bool fYac1dot0BlockOrTx = false;
             if ((pindexPrev->nHeight + 1) >= nMainnetNewLogicBlockNumber) {
                 fYac1dot0BlockOrTx = true;
             }
 
-            LogPrintf("Running ScryptMiner with %u transactions in block (%u bytes)\n", pblock->vtx.size(), ::GetSerializeSize( * pblock, SER_NETWORK, PROTOCOL_VERSION));
-
             //
             // Initialize AdaptivePow DAG for this epoch
             //
@@ -819,10 +1114,27 @@ static void ScryptMiner() // AdaptivePow miner for Scrypt Coin
             uint256 headerHash = pblock->GetAdaptivePowHeaderHash();
 
             while (fGenerateYacoins && nBlocksToGenerate != 0) {
-                // Compute AdaptivePow hash with current nonce
-                AdaptivePowResult result = AdaptivePowHash(headerHash, pblock->nNonce64, g_adaptivePowDAG.get(), Params().GetConsensus());
+                // Compute AdaptivePow for a batch of consecutive nonces; the
+                // lanes advance in lockstep so their random DAG reads overlap
+                // instead of missing cache one at a time
+                std::vector<std::pair<uint256, uint64_t> > vWork;
+                vWork.reserve(ADAPTIVEPOW_BATCH_LANES);
+                for (uint32_t n = 0; n < ADAPTIVEPOW_BATCH_LANES; n++)
+                    vWork.push_back(std::make_pair(headerHash, pblock->nNonce64 + n));
+                std::vector<AdaptivePowResult> vResults;
+                AdaptivePowHashBatch(vWork, vResults, g_adaptivePowDAG.get(), Params().GetConsensus());
+
+                size_t nSolved = vResults.size();
+                for (size_t n = 0; n < vResults.size(); n++) {
+                    if (vResults[n].hashFinal <= hashTarget) {
+                        nSolved = n;
+                        break;
+                    }
+                }
 
-                if (result.hashFinal <= hashTarget) { // Found a solution
+                if (nSolved < vResults.size()) { // Found a solution
+                    const AdaptivePowResult& result = vResults[nSolved];
+                    pblock->nNonce64 += nSolved;
                     // Set the mix hash in the block
                     pblock->hashMix = result.hashMix;
 
@@ -847,8 +1159,8 @@ static void ScryptMiner() // AdaptivePow miner for Scrypt Coin
                     SetThreadPriority(THREAD_PRIORITY_LOWEST);
                     break;
                 }
-                pblock->nNonce64 += 1;
-                nHashesDone += 1;
+                pblock->nNonce64 += ADAPTIVEPOW_BATCH_LANES;
+                nHashesDone += ADAPTIVEPOW_BATCH_LANES;
 
                 // Meter hashes/sec
                 ::int64_t nNow = GetTimeMicros();
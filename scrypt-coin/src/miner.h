@@ -16,6 +16,7 @@
 
 #include "primitives/block.h"
 #include "txmempool.h"
+#include "validationinterface.h"
 #include "wallet/wallet.h"
 
 #include <stdint.h>
@@ -32,8 +33,17 @@ struct CBlockTemplate
     std::vector<CAmount> vTxFees;
     std::vector<int64_t> vTxSigOpsCost;
     std::vector<unsigned char> vchCoinbaseCommitment;
+    //! Summed measured validation cost of the selected transactions (microseconds)
+    int64_t nValidationTimeUs = 0;
 };
 
+//! Default cap on the summed measured validation cost of a template's
+//! transactions, in milliseconds; 0 means unlimited (-blockmaxvalidationtime)
+static const int64_t DEFAULT_BLOCK_MAX_VALIDATION_TIME = 0;
+//! Default wall-clock budget for one round of package selection, in
+//! milliseconds; 0 means unlimited (-blocktemplatebudget)
+static const int64_t DEFAULT_BLOCK_TEMPLATE_BUDGET = 0;
+
 // Container for tracking updates to ancestor feerate as we include (parent)
 // transactions in a block
 struct CTxMemPoolModifiedEntry {
@@ -144,11 +154,22 @@ private:
     unsigned int nBlockMaxSize;
     unsigned int nBlockMaxSigOps;
     CFeeRate blockMinFeeRate;
+    // Cap on the summed measured validation cost of selected transactions
+    // (microseconds, 0 = unlimited). Token operations cost far more
+    // validation time per byte than plain payments; this bounds how long the
+    // assembled block will take other nodes to validate regardless of mix.
+    int64_t nBlockMaxValidationTimeUs;
+    // Wall-clock budget for the selection loops themselves (microseconds,
+    // 0 = none); bounds template assembly latency directly. The deadline is
+    // armed in prepareBlock when assembly starts.
+    int64_t nAssemblyBudgetUs;
+    int64_t nAssemblyDeadlineUs;
 
     // Information on the current status of the block
     uint64_t nBlockSize;
     uint64_t nBlockTx;
     uint64_t nBlockSigOpsCost;
+    int64_t nBlockValidationTimeUs;
     CAmount nFees;
     CTxMemPool::setEntries inBlock;
 
@@ -157,15 +178,32 @@ private:
     int64_t nLockTimeCutoff;
 
 public:
-    BlockAssembler();
+    /** Arguments override the -blockmaxvalidationtime / -blocktemplatebudget
+      * defaults when >= 0 (both in milliseconds, 0 disables the limit) */
+    BlockAssembler(int64_t nMaxValidationTimeMs = -1, int64_t nTemplateBudgetMs = -1);
 
     /** Construct a new block template with coinbase to scriptPubKeyIn */
     std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn);
 
+    /** Construct a new block template by replaying a previous selection made
+      * for the same tip (vSeed, in block order) and evaluating only
+      * vCandidates as new entrants, instead of walking the whole mempool */
+    std::unique_ptr<CBlockTemplate> CreateNewBlockIncremental(const CScript& scriptPubKeyIn,
+            const std::vector<CTxMemPool::txiter>& vSeed,
+            const std::vector<CTxMemPool::txiter>& vCandidates);
+
 private:
     // utility functions
     /** Clear the block's state and prepare for assembling a new block */
     void resetBlock();
+    /** Setup shared between the full and incremental paths: template
+      * allocation, coinbase, header fields and chain context. Returns the
+      * tip the template builds on, or nullptr on failure. */
+    CBlockIndex* prepareBlock(const CScript& scriptPubKeyIn);
+    /** Trailer shared between the full and incremental paths: header
+      * completion, coinbase subsidy and selection statistics */
+    std::unique_ptr<CBlockTemplate> finalizeBlock(CBlockIndex* pindexPrev, int64_t nTimeStart,
+            int nPackagesSelected, int nDescendantsUpdated, const char* pszCaller);
     /** Add a tx to the block */
     void AddToBlock(CTxMemPool::txiter iter);
 
@@ -174,6 +212,10 @@ private:
       * Increments nPackagesSelected / nDescendantsUpdated with corresponding
       * statistics from the package selection (for logging statistics). */
     void addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated);
+    /** Evaluate only the given candidates as new entrants, best
+      * ancestor-feerate first. Used by the incremental path; assumes inBlock
+      * already holds a selection made for the same tip. */
+    void addCandidateTxs(const std::vector<CTxMemPool::txiter>& vCandidates, int &nPackagesSelected, int &nDescendantsUpdated);
 
     // helper functions for addPackageTxs()
     /** Remove confirmed (inBlock) entries from given set */
@@ -196,6 +238,42 @@ private:
     int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set &mapModifiedTx);
 };
 
+/** Long-lived template source.
+ *
+ *  Subscribes to mempool arrivals and chain tip changes so that repeated
+ *  template requests for an unchanged tip only re-run package selection over
+ *  the transactions that arrived in between, instead of over the whole
+ *  mempool. Any selected transaction leaving the mempool (eviction,
+ *  conflict) or a tip change falls back to a full rebuild.
+ */
+class CTemplateAssembler : public CValidationInterface
+{
+public:
+    /** Produce a block template, reusing the previous selection when the tip
+      * is unchanged. The budget overrides are forwarded to BlockAssembler
+      * (milliseconds; -1 = configured defaults, 0 = unlimited). */
+    std::unique_ptr<CBlockTemplate> CreateTemplate(const CScript& scriptPubKeyIn,
+            int64_t nMaxValidationTimeMs = -1, int64_t nTemplateBudgetMs = -1);
+
+protected:
+    void TransactionAddedToMempool(const CTransactionRef& ptxn) override;
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block) override;
+
+private:
+    /** Forget the cached selection; the next template is built from scratch */
+    void Invalidate();
+
+    CCriticalSection cs;
+    uint256 hashTip;                //!< tip the cached selection was built on (null = no cached selection)
+    std::vector<uint256> vSelected; //!< txids of the last selection, in block order
+    std::vector<uint256> vArrived;  //!< mempool arrivals since the last template
+};
+
+/** Process-wide template assembler shared by the internal miner and
+ *  getblocktemplate; registered as a validation interface in init */
+CTemplateAssembler& TemplateAssembler();
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
@@ -13,22 +13,34 @@
 #include "chainparams.h"
 #include "clientversion.h"
 #include "crypto/common.h"
+#include "crypto/hmac_sha256.h"
 #include "crypto/sha256.h"
 #include "crypto/siphash.h"
 #include "hash.h"
+#include "support/cleanse.h"
 #include "primitives/transaction.h"
 #include "netbase.h"
 #include "scheduler.h"
+#include "trace.h"
 #include "ui_interface.h"
 #include "utilstrencodings.h"
 #include "util.h"
 #include "chainparamsseeds.h"
 #include "consensus/consensus.h"
+#include "metrics.h"
 
 #ifdef WIN32
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+#ifdef USE_KQUEUE
+#include <sys/event.h>
 #endif
 
 #ifdef USE_UPNP
@@ -41,6 +53,7 @@
 #include <math.h>
 #include <condition_variable>
 #include <list>
+#include <map>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -51,6 +64,12 @@
 // We add a random period time (0 to 1 seconds) to feeler connections to prevent synchronization.
 #define FEELER_SLEEP_WINDOW 1
 
+// Stop waiting for outstanding DNS seed lookups once this many addresses have arrived
+#define ENOUGH_DNS_SEED_ADDRESSES 32
+
+// Number of outbound candidates raced in parallel while we have no outbound peer yet
+#define MAX_COLDSTART_RACE 4
+
 #if !defined(HAVE_MSG_NOSIGNAL)
 #define MSG_NOSIGNAL 0
 #endif
@@ -98,7 +117,7 @@ std::map<CNetAddr, LocalServiceInfo> mapLocalHost;
 static bool vfLimited[NET_MAX] = {};
 std::string strSubVersion;
 
-limitedmap<uint256, int64_t> mapAlreadyAskedFor(MAX_INV_SZ);
+limitedlrumap<uint256, int64_t, CAskedForHasher> mapAlreadyAskedFor(MAX_INV_SZ);
 
 void CConnman::AddOneShot(const std::string& strDest)
 {
@@ -369,6 +388,56 @@ static CAddress GetBindAddress(SOCKET sock)
     return addr_bind;
 }
 
+//! Plaintext prefix of the encrypted-link hello; cannot occur at the start of
+//! an ordinary p2p stream, whose first bytes are the network message start
+static const unsigned char LINK_CRYPT_MAGIC[12] = {'y','a','c','l','i','n','k','e','n','c','0','1'};
+static const size_t LINK_CRYPT_NONCE_SIZE = 32;
+static const size_t LINK_CRYPT_HELLO_SIZE = sizeof(LINK_CRYPT_MAGIC) + LINK_CRYPT_NONCE_SIZE;
+//! Length field plus tag added to every sealed frame
+static const size_t LINK_CRYPT_FRAME_OVERHEAD = 4 + ChaCha20Poly1305::TAGLEN;
+//! Seal the staged batch early once it reaches this size, so a long send
+//! backlog turns into a series of bounded frames rather than one huge one
+static const size_t LINK_CRYPT_BATCH_TARGET = 256 * 1024;
+//! Largest incoming frame accepted: a maximum-size message plus a batch
+//! target worth of smaller messages sealed along with it
+static const size_t MAX_LINK_CRYPT_FRAME = MAX_PROTOCOL_MESSAGE_LENGTH + CMessageHeader::HEADER_SIZE + LINK_CRYPT_BATCH_TARGET;
+
+//! The pre-shared 32-byte -linkencryptkey, or null when unset or malformed
+static const unsigned char* GetLinkCryptKey()
+{
+    static const std::vector<unsigned char> vchKey = []() {
+        std::vector<unsigned char> vch = ParseHex(gArgs.GetArg("-linkencryptkey", ""));
+        if (gArgs.IsArgSet("-linkencryptkey") && vch.size() != 32) {
+            LogPrintf("Ignoring -linkencryptkey: must be 64 hex characters\n");
+            vch.clear();
+        }
+        return vch;
+    }();
+    return vchKey.size() == 32 ? vchKey.data() : nullptr;
+}
+
+//! Whether -linkencrypt lists addrConnect as a peer we must encrypt to
+static bool IsLinkCryptPeer(const CService& addrConnect, unsigned short nDefaultPort)
+{
+    if (GetLinkCryptKey() == nullptr)
+        return false;
+    for (const std::string& strAddr : gArgs.GetArgs("-linkencrypt")) {
+        CService serv;
+        if (Lookup(strAddr.c_str(), serv, nDefaultPort, false) && serv == addrConnect)
+            return true;
+    }
+    return false;
+}
+
+//! The plaintext hello opening (or answering) an encrypted-link handshake
+static CSendBuffer MakeLinkCryptHello(const unsigned char* pchNonce)
+{
+    std::vector<unsigned char> vchHello(LINK_CRYPT_HELLO_SIZE);
+    memcpy(vchHello.data(), LINK_CRYPT_MAGIC, sizeof(LINK_CRYPT_MAGIC));
+    memcpy(vchHello.data() + sizeof(LINK_CRYPT_MAGIC), pchNonce, LINK_CRYPT_NONCE_SIZE);
+    return CSendBuffer(std::move(vchHello));
+}
+
 CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCountFailure)
 {
     if (pszDest == nullptr) {
@@ -427,6 +496,15 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
         pnode->nServicesExpected = ServiceFlags(addrConnect.nServices & nRelevantServices);
         pnode->AddRef();
 
+        if (IsLinkCryptPeer(addrConnect, GetDefaultPort())) {
+            // Open with our hello; everything the higher layers queue from
+            // here on is staged until the peer's hello completes the keys
+            pnode->StartLinkCrypt(true);
+            pnode->nSendSize += LINK_CRYPT_HELLO_SIZE;
+            pnode->vSendMsg.push_back(MakeLinkCryptHello(pnode->pLinkCrypt->vchLocalNonce));
+            LogPrint(BCLog::NET, "requiring encrypted link to %s\n", addrConnect.ToString());
+        }
+
         return pnode;
     } else if (!proxyConnectionFailed) {
         // If connecting to the node failed, and failure is not caused by a problem connecting to
@@ -612,6 +690,75 @@ void CConnman::SetBannedSetDirty(bool dirty)
     setBannedIsDirty = dirty;
 }
 
+//! Drop peer performance records untouched for this long
+static const int64_t PEER_SCORE_MAX_AGE = 30 * 24 * 60 * 60;
+
+void CConnman::RecordBlockDelivery(const CNetAddr& addr, int64_t nLatencyUsec)
+{
+    LOCK(cs_mapPeerScores);
+    CPeerScore& score = mapPeerScores[addr];
+    if (score.nBlockLatencyUsec == 0)
+        score.nBlockLatencyUsec = nLatencyUsec;
+    else // exponential moving average, 1/8 weight on the new sample
+        score.nBlockLatencyUsec = (score.nBlockLatencyUsec * 7 + nLatencyUsec) / 8;
+    score.nBlocksDelivered++;
+    score.nLastUpdate = GetTime();
+}
+
+void CConnman::RecordTxProcessed(const CNetAddr& addr, bool fUseful)
+{
+    LOCK(cs_mapPeerScores);
+    CPeerScore& score = mapPeerScores[addr];
+    score.nTxTotal++;
+    if (fUseful)
+        score.nTxUseful++;
+    score.nLastUpdate = GetTime();
+}
+
+void CConnman::RecordBlockStall(const CNetAddr& addr)
+{
+    LOCK(cs_mapPeerScores);
+    CPeerScore& score = mapPeerScores[addr];
+    score.nStallCount++;
+    score.nLastUpdate = GetTime();
+}
+
+int64_t CConnman::GetBlockLatencyScore(const CNetAddr& addr)
+{
+    LOCK(cs_mapPeerScores);
+    peerscoremap_t::const_iterator it = mapPeerScores.find(addr);
+    if (it == mapPeerScores.end())
+        return 0;
+    return it->second.nBlockLatencyUsec;
+}
+
+void CConnman::DumpPeerScores()
+{
+    int64_t nStart = GetTimeMillis();
+
+    peerscoremap_t scoreMap;
+    {
+        LOCK(cs_mapPeerScores);
+        // prune records of addresses we have not heard from in a long time
+        int64_t now = GetTime();
+        peerscoremap_t::iterator it = mapPeerScores.begin();
+        while (it != mapPeerScores.end())
+        {
+            if (now - it->second.nLastUpdate > PEER_SCORE_MAX_AGE)
+                mapPeerScores.erase(it++);
+            else
+                ++it;
+        }
+        scoreMap = mapPeerScores; //create a thread safe copy
+    }
+
+    CPeerScoreDB scoredb;
+    scoredb.Write(scoreMap);
+
+    LogPrint(BCLog::NET, "Flushed %d peer performance records to peerscores.dat  %dms\n",
+        scoreMap.size(), GetTimeMillis() - nStart);
+}
+
 
 bool CConnman::IsWhitelistedRange(const CNetAddr &addr) {
     for (const CSubNet& subnet : vWhitelistedRange) {
@@ -676,11 +823,13 @@ void CNode::copyStats(CNodeStats &stats)
         LOCK(cs_vSend);
         X(mapSendBytesPerMsgCmd);
         X(nSendBytes);
+        X(nSendMsgs);
     }
     {
         LOCK(cs_vRecv);
         X(mapRecvBytesPerMsgCmd);
         X(nRecvBytes);
+        X(nRecvMsgs);
     }
     X(fWhitelisted);
 
@@ -706,7 +855,138 @@ void CNode::copyStats(CNodeStats &stats)
 }
 #undef X
 
+void CNode::StartLinkCrypt(bool fInitiator)
+{
+    pLinkCrypt.reset(new LinkCryptState(fInitiator));
+    GetStrongRandBytes(pLinkCrypt->vchLocalNonce, LINK_CRYPT_NONCE_SIZE);
+}
+
+void CNode::DeriveLinkCryptKeys(const unsigned char* pchRemoteNonce)
+{
+    const unsigned char* pchKey = GetLinkCryptKey();
+    assert(pchKey != nullptr);
+    // Both sides hash the nonces in initiator-first order, so the directions
+    // are told apart by the trailing byte alone
+    const unsigned char* pchNonceA = pLinkCrypt->fInitiator ? pLinkCrypt->vchLocalNonce : pchRemoteNonce;
+    const unsigned char* pchNonceB = pLinkCrypt->fInitiator ? pchRemoteNonce : pLinkCrypt->vchLocalNonce;
+    const unsigned char chDirSend = pLinkCrypt->fInitiator ? 0x01 : 0x02;
+    const unsigned char chDirRecv = pLinkCrypt->fInitiator ? 0x02 : 0x01;
+
+    unsigned char vchDerived[CHMAC_SHA256::OUTPUT_SIZE];
+    CHMAC_SHA256(pchKey, 32).Write(pchNonceA, LINK_CRYPT_NONCE_SIZE)
+                            .Write(pchNonceB, LINK_CRYPT_NONCE_SIZE)
+                            .Write(&chDirSend, 1).Finalize(vchDerived);
+    pLinkCrypt->sendCipher.SetKey(vchDerived, sizeof(vchDerived));
+    CHMAC_SHA256(pchKey, 32).Write(pchNonceA, LINK_CRYPT_NONCE_SIZE)
+                            .Write(pchNonceB, LINK_CRYPT_NONCE_SIZE)
+                            .Write(&chDirRecv, 1).Finalize(vchDerived);
+    pLinkCrypt->recvCipher.SetKey(vchDerived, sizeof(vchDerived));
+    memory_cleanse(vchDerived, sizeof(vchDerived));
+}
+
+void CNode::FlushLinkCryptSend()
+{
+    if (!pLinkCrypt || pLinkCrypt->phase != LinkCryptState::ON || pLinkCrypt->vchSendPlain.empty())
+        return;
+    std::vector<unsigned char>& vchPlain = pLinkCrypt->vchSendPlain;
+    std::vector<unsigned char> vchFrame(LINK_CRYPT_FRAME_OVERHEAD + vchPlain.size());
+    WriteLE32(vchFrame.data(), vchPlain.size());
+    memcpy(vchFrame.data() + 4, vchPlain.data(), vchPlain.size());
+    pLinkCrypt->sendCipher.Seal(pLinkCrypt->nSendSeq++, vchFrame.data(), 4,
+                                vchFrame.data() + 4, vchPlain.size(),
+                                vchFrame.data() + 4 + vchPlain.size());
+    vchPlain.clear();
+    // The plaintext bytes were counted against nSendSize as they were queued
+    nSendSize += LINK_CRYPT_FRAME_OVERHEAD;
+    vSendMsg.push_back(CSendBuffer(std::move(vchFrame)));
+}
+
+bool CNode::ReceiveLinkCryptBytes(const char *pch, unsigned int nBytes, bool& complete)
+{
+    LinkCryptState& crypt = *pLinkCrypt;
+    std::vector<unsigned char>& frame = crypt.vchRecvFrame;
+    frame.insert(frame.end(), (const unsigned char*)pch, (const unsigned char*)pch + nBytes);
+
+    if (crypt.phase != LinkCryptState::ON) {
+        if (frame.size() < sizeof(LINK_CRYPT_MAGIC))
+            return true;
+        if (memcmp(frame.data(), LINK_CRYPT_MAGIC, sizeof(LINK_CRYPT_MAGIC)) != 0) {
+            if (crypt.phase == LinkCryptState::AWAIT_HELLO) {
+                // We required encryption towards this peer and it answered
+                // with something else
+                LogPrint(BCLog::NET, "peer=%d did not answer the encrypted-link hello, disconnecting\n", GetId());
+                return false;
+            }
+            // An ordinary peer speaking plaintext p2p; stand down and replay
+            // what we buffered through the normal path
+            std::vector<unsigned char> vchBuffered;
+            vchBuffered.swap(frame);
+            pLinkCrypt.reset();
+            return ReceivePlainMsgBytes((const char*)vchBuffered.data(), vchBuffered.size(), complete);
+        }
+        if (frame.size() < LINK_CRYPT_HELLO_SIZE)
+            return true;
+        DeriveLinkCryptKeys(frame.data() + sizeof(LINK_CRYPT_MAGIC));
+        {
+            LOCK(cs_vSend);
+            if (!crypt.fInitiator) {
+                // Answer with our hello ahead of any sealed frames
+                nSendSize += LINK_CRYPT_HELLO_SIZE;
+                vSendMsg.push_back(MakeLinkCryptHello(crypt.vchLocalNonce));
+            }
+            // The send path checks the phase under cs_vSend; from here on
+            // everything it queues goes through the cipher
+            crypt.phase = LinkCryptState::ON;
+            // Release whatever was staged while the handshake was in flight
+            // (the version message, for the initiator)
+            FlushLinkCryptSend();
+        }
+        frame.erase(frame.begin(), frame.begin() + LINK_CRYPT_HELLO_SIZE);
+        LogPrint(BCLog::NET, "encrypted link established peer=%d\n", GetId());
+    }
+
+    // Peel complete frames off the front; partial trailing bytes stay
+    // buffered for the next pass
+    size_t nPos = 0;
+    bool fOk = true;
+    while (fOk) {
+        if (frame.size() - nPos < 4)
+            break;
+        unsigned char* pchFrame = frame.data() + nPos;
+        uint32_t nLen = ReadLE32(pchFrame);
+        if (nLen > MAX_LINK_CRYPT_FRAME) {
+            LogPrint(BCLog::NET, "oversized encrypted frame from peer=%d, disconnecting\n", GetId());
+            fOk = false;
+            break;
+        }
+        if (frame.size() - nPos < 4 + nLen + ChaCha20Poly1305::TAGLEN)
+            break;
+        if (!crypt.recvCipher.Open(crypt.nRecvSeq, pchFrame, 4, pchFrame + 4, nLen, pchFrame + 4 + nLen)) {
+            LogPrint(BCLog::NET, "encrypted frame authentication failed peer=%d, disconnecting\n", GetId());
+            fOk = false;
+            break;
+        }
+        crypt.nRecvSeq++;
+        bool fFrameComplete = false;
+        fOk = ReceivePlainMsgBytes((const char*)pchFrame + 4, nLen, fFrameComplete);
+        complete |= fFrameComplete;
+        nPos += 4 + nLen + ChaCha20Poly1305::TAGLEN;
+    }
+    frame.erase(frame.begin(), frame.begin() + nPos);
+    return fOk;
+}
+
 bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete)
+{
+    complete = false;
+    // The encrypted-link layer only ever exists or disappears on this
+    // (socket handler) thread, so the pointer check is unsynchronized
+    if (pLinkCrypt)
+        return ReceiveLinkCryptBytes(pch, nBytes, complete);
+    return ReceivePlainMsgBytes(pch, nBytes, complete);
+}
+
+bool CNode::ReceivePlainMsgBytes(const char *pch, unsigned int nBytes, bool& complete)
 {
     complete = false;
     int64_t nTimeMicros = GetTimeMicros();
@@ -717,8 +997,15 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
 
         // get current incomplete message, or create a new one
         if (vRecvMsg.empty() ||
-            vRecvMsg.back().complete())
+            vRecvMsg.back().complete()) {
             vRecvMsg.push_back(CNetMessage(::pchMessageStart, SER_NETWORK, INIT_PROTO_VERSION));
+            // Latch the negotiated checksum mode for the whole message, so
+            // a verack arriving mid-message cannot split it across modes
+            vRecvMsg.back().fFastChecksum = fFastChecksum;
+            // Reuse the capacity of a previously processed message's buffer
+            if (vchRecvBufPool.capacity() > 0)
+                vRecvMsg.back().vRecv.AdoptBuffer(std::move(vchRecvBufPool));
+        }
 
         CNetMessage& msg = vRecvMsg.back();
 
@@ -749,6 +1036,7 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
                 i = mapRecvBytesPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
             assert(i != mapRecvBytesPerMsgCmd.end());
             i->second += msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
+            nRecvMsgs++;
 
             msg.nTime = nTimeMicros;
             complete = true;
@@ -758,6 +1046,78 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
     return true;
 }
 
+//! Smallest remaining payload worth receiving straight into vRecv; anything
+//! below this fits the bounce buffer and isn't worth the extra recv() call
+//! at the message boundary.
+static const unsigned int DIRECT_RECV_MIN_BYTES = 0x10000;
+
+bool CNode::GetDirectRecvSpace(char*& pchData, unsigned int& nSpace)
+{
+    // Encrypted links must pass through the frame layer first
+    if (pLinkCrypt)
+        return false;
+    LOCK(cs_vRecv);
+    if (vRecvMsg.empty())
+        return false;
+    CNetMessage& msg = vRecvMsg.back();
+    if (!msg.in_data || msg.complete())
+        return false;
+    unsigned int nRemaining = msg.hdr.nMessageSize - msg.nDataPos;
+    if (nRemaining < DIRECT_RECV_MIN_BYTES)
+        return false;
+    // Same allocation policy as readData: up to 256 KiB ahead, but never more
+    // than the total message size.
+    unsigned int nGrow = std::min(msg.hdr.nMessageSize, msg.nDataPos + 256 * 1024);
+    if (msg.vRecv.size() < nGrow)
+        msg.vRecv.resize(nGrow);
+    pchData = &msg.vRecv[msg.nDataPos];
+    nSpace = msg.vRecv.size() - msg.nDataPos;
+    return true;
+}
+
+bool CNode::DirectRecvBytesWritten(unsigned int nBytes, bool& complete)
+{
+    complete = false;
+    int64_t nTimeMicros = GetTimeMicros();
+    LOCK(cs_vRecv);
+    nLastRecv = nTimeMicros / 1000000;
+    nRecvBytes += nBytes;
+
+    assert(!vRecvMsg.empty());
+    CNetMessage& msg = vRecvMsg.back();
+    msg.MarkBytesWritten(nBytes);
+
+    if (msg.complete()) {
+
+        //store received bytes per message command
+        //to prevent a memory DOS, only allow valid commands
+        mapMsgCmdSize::iterator i = mapRecvBytesPerMsgCmd.find(msg.hdr.pchCommand);
+        if (i == mapRecvBytesPerMsgCmd.end())
+            i = mapRecvBytesPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
+        assert(i != mapRecvBytesPerMsgCmd.end());
+        i->second += msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
+        nRecvMsgs++;
+
+        msg.nTime = nTimeMicros;
+        complete = true;
+    }
+
+    return true;
+}
+
+void CNode::ReturnRecvBuffer(CNetMessage& msg)
+{
+    CSerializeData d;
+    msg.vRecv.ReleaseBuffer(d);
+    // zero_after_free_allocator scrubs on deallocation, so keeping the
+    // buffer also saves the memset, not just the malloc
+    if (d.capacity() == 0 || d.capacity() > MAX_RECYCLED_RECV_BUFFER)
+        return;
+    LOCK(cs_vRecv);
+    if (vchRecvBufPool.capacity() < d.capacity())
+        vchRecvBufPool = std::move(d);
+}
+
 void CNode::SetSendVersion(int nVersionIn)
 {
     // Send version may only be changed in the version message, and
@@ -826,7 +1186,8 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
         vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
     }
 
-    hasher.Write((const unsigned char*)pch, nCopy);
+    if (!fFastChecksum)
+        hasher.Write((const unsigned char*)pch, nCopy);
     memcpy(&vRecv[nDataPos], pch, nCopy);
     nDataPos += nCopy;
 
@@ -841,21 +1202,178 @@ const uint256& CNetMessage::GetMessageHash() const
     return data_hash;
 }
 
+static CCriticalSection cs_serializeBufferPool;
+static std::vector<std::vector<unsigned char>> vSerializeBufferPool;
+
+std::vector<unsigned char> CSerializeBufferPool::Acquire(size_t nSizeHint)
+{
+    if (nSizeHint >= MIN_POOLED_BUFFER_SIZE) {
+        LOCK(cs_serializeBufferPool);
+        if (!vSerializeBufferPool.empty()) {
+            std::vector<unsigned char> vchBuf = std::move(vSerializeBufferPool.back());
+            vSerializeBufferPool.pop_back();
+            vchBuf.clear(); // keeps capacity
+            return vchBuf;
+        }
+    }
+    return std::vector<unsigned char>();
+}
+
+void CSerializeBufferPool::Release(std::vector<unsigned char>&& vchBuf)
+{
+    if (vchBuf.capacity() < MIN_POOLED_BUFFER_SIZE)
+        return;
+    LOCK(cs_serializeBufferPool);
+    if (vSerializeBufferPool.size() < MAX_POOLED_BUFFERS)
+        vSerializeBufferPool.push_back(std::move(vchBuf));
+}
+
 // requires LOCK(cs_vSend)
+#ifndef WIN32
+//! Number of pending messages gathered into a single sendmsg() call.
+//! Kept well below the POSIX IOV_MAX minimum of 16.
+static const size_t SEND_IOV_MAX = 16;
+#endif
+
 size_t CConnman::SocketSendData(CNode *pnode) const
 {
+    // Seal whatever has been staged since the last pass as one frame, so the
+    // AEAD runs once per batch of messages rather than once per message
+    pnode->FlushLinkCryptSend();
+
     auto it = pnode->vSendMsg.begin();
     size_t nSentSize = 0;
 
+    // Per-class traffic shaping: refill this peer's token bucket and cap the
+    // bytes written this pass. Whitelisted peers are never shaped, and the
+    // inbound and outbound classes carry separate budgets, so one syncing
+    // inbound peer cannot starve tip propagation to mining partners. The
+    // bucket holds at most one second of budget, bounding the burst.
+    const uint64_t nRate = pnode->fWhitelisted ? 0 : (pnode->fInbound ? nInboundSendRate : nOutboundSendRate);
+    size_t nQuota = std::numeric_limits<size_t>::max();
+    if (nRate > 0) {
+        const int64_t nNow = GetTimeMicros();
+        if (pnode->nLastSendTokens == 0) {
+            pnode->dSendTokens = (double)nRate; // start with a full bucket
+        } else {
+            pnode->dSendTokens = std::min<double>((double)nRate,
+                pnode->dSendTokens + (nNow - pnode->nLastSendTokens) * 0.000001 * nRate);
+        }
+        pnode->nLastSendTokens = nNow;
+        nQuota = (size_t)std::max<double>(0.0, pnode->dSendTokens);
+        if (nQuota == 0)
+            return 0; // bucket empty; the next socket pass retries
+    }
+
+#ifndef WIN32
+#ifdef TCP_CORK
+    // Optionally cork the socket while flushing a multi-message backlog (eg a
+    // block announcement followed by its cmpctblock) so the kernel emits full
+    // segments even across multiple sendmsg() calls.
+    static const bool fTcpCork = gArgs.GetBoolArg("-tcpcork", false);
+    bool fCorked = false;
+    if (fTcpCork && pnode->vSendMsg.size() > 1) {
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket != INVALID_SOCKET) {
+            int nOne = 1;
+            fCorked = setsockopt(pnode->hSocket, IPPROTO_TCP, TCP_CORK, (const char*)&nOne, sizeof(nOne)) == 0;
+        }
+    }
+#endif
+    while (it != pnode->vSendMsg.end()) {
+        // Gather as many pending messages as fit into one scatter-gather
+        // write, so a burst of small messages costs one syscall instead of
+        // one per message.
+        struct iovec iov[SEND_IOV_MAX];
+        size_t nIov = 0;
+        size_t nGathered = 0;
+        size_t nOffset = pnode->nSendOffset;
+        const size_t nBudget = nQuota - nSentSize;
+        for (auto itGather = it; itGather != pnode->vSendMsg.end() && nIov < SEND_IOV_MAX && nGathered < nBudget; ++itGather) {
+            assert(itGather->size() > nOffset);
+            iov[nIov].iov_base = const_cast<unsigned char*>(itGather->data()) + nOffset;
+            iov[nIov].iov_len = std::min(itGather->size() - nOffset, nBudget - nGathered);
+            nGathered += iov[nIov].iov_len;
+            nOffset = 0;
+            nIov++;
+        }
+        ssize_t nBytes = 0;
+        {
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                break;
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = nIov;
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+        if (nBytes > 0) {
+            pnode->nLastSend = GetSystemTimeInSeconds();
+            pnode->nSendBytes += nBytes;
+            nSentSize += nBytes;
+            // Walk the messages consumed (fully or partially) by this write
+            size_t nRemaining = nBytes;
+            while (nRemaining > 0) {
+                const auto &data = *it;
+                size_t nMsgLeft = data.size() - pnode->nSendOffset;
+                if (nRemaining >= nMsgLeft) {
+                    nRemaining -= nMsgLeft;
+                    pnode->nSendOffset = 0;
+                    pnode->nSendSize -= data.size();
+                    pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+                    it++;
+                } else {
+                    pnode->nSendOffset += nRemaining;
+                    nRemaining = 0;
+                }
+            }
+            if ((size_t)nBytes < nGathered) {
+                // could not send everything gathered; stop sending more
+                break;
+            }
+            if (nSentSize >= nQuota) {
+                // this pass's token budget is spent
+                break;
+            }
+        } else {
+            if (nBytes < 0) {
+                // error
+                int nErr = WSAGetLastError();
+                if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+                {
+                    LogPrintf("socket send error %s\n", NetworkErrorString(nErr));
+                    pnode->CloseSocketDisconnect();
+                }
+            }
+            // couldn't send anything at all
+            break;
+        }
+    }
+#ifdef TCP_CORK
+    if (fCorked) {
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket != INVALID_SOCKET) {
+            int nZero = 0;
+            setsockopt(pnode->hSocket, IPPROTO_TCP, TCP_CORK, (const char*)&nZero, sizeof(nZero));
+        }
+    }
+#endif
+#else
     while (it != pnode->vSendMsg.end()) {
         const auto &data = *it;
         assert(data.size() > pnode->nSendOffset);
+        size_t nToSend = std::min(data.size() - pnode->nSendOffset, nQuota - nSentSize);
+        if (nToSend == 0) {
+            // this pass's token budget is spent
+            break;
+        }
         int nBytes = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, nToSend, MSG_NOSIGNAL | MSG_DONTWAIT);
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
@@ -885,11 +1403,22 @@ size_t CConnman::SocketSendData(CNode *pnode) const
             break;
         }
     }
+#endif
+
+    if (nRate > 0)
+        pnode->dSendTokens -= (double)nSentSize;
 
     if (it == pnode->vSendMsg.end()) {
         assert(pnode->nSendOffset == 0);
         assert(pnode->nSendSize == 0);
     }
+    // Hand fully-sent buffers back to the pool; the 24-byte headers fall
+    // below the pooling threshold and are freed as before. Shared buffers are
+    // only dereferenced — other peers (or the mempool) may still be reading.
+    for (auto itDone = pnode->vSendMsg.begin(); itDone != it; ++itDone) {
+        if (!itDone->IsShared())
+            CSerializeBufferPool::Release(itDone->Release());
+    }
     pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
     return nSentSize;
 }
@@ -906,6 +1435,7 @@ struct NodeEvictionCandidate
     bool fBloomFilter;
     CAddress addr;
     uint64_t nKeyedNetGroup;
+    int64_t nBlockLatency;
 };
 
 static bool ReverseCompareNodeMinPingTime(const NodeEvictionCandidate &a, const NodeEvictionCandidate &b)
@@ -930,6 +1460,15 @@ static bool CompareNodeBlockTime(const NodeEvictionCandidate &a, const NodeEvict
     return a.nTimeConnected > b.nTimeConnected;
 }
 
+static bool CompareNodeBlockLatency(const NodeEvictionCandidate &a, const NodeEvictionCandidate &b)
+{
+    // Peers without a delivery record (latency 0) sort first, then slower
+    // peers; the historically fastest block relayers end up last.
+    if ((a.nBlockLatency == 0) != (b.nBlockLatency == 0)) return b.nBlockLatency != 0;
+    if (a.nBlockLatency != b.nBlockLatency) return a.nBlockLatency > b.nBlockLatency;
+    return a.nTimeConnected > b.nTimeConnected;
+}
+
 static bool CompareNodeTXTime(const NodeEvictionCandidate &a, const NodeEvictionCandidate &b)
 {
     // There is a fall-through here because it is common for a node to have more than a few peers that have not yet relayed txn.
@@ -963,7 +1502,8 @@ bool CConnman::AttemptToEvictConnection()
             NodeEvictionCandidate candidate = {node->GetId(), node->nTimeConnected, node->nMinPingUsecTime,
                                                node->nLastBlockTime, node->nLastTXTime,
                                                (node->nServices & nRelevantServices) == nRelevantServices,
-                                               node->fRelayTxes, node->pfilter != nullptr, node->addr, node->nKeyedNetGroup};
+                                               node->fRelayTxes, node->pfilter != nullptr, node->addr, node->nKeyedNetGroup,
+                                               GetBlockLatencyScore(node->addr)};
             vEvictionCandidates.push_back(candidate);
         }
     }
@@ -1000,6 +1540,14 @@ bool CConnman::AttemptToEvictConnection()
 
     if (vEvictionCandidates.empty()) return false;
 
+    // Protect 4 nodes with the best historical block delivery latency.
+    // The record persists across restarts but cannot be inherited without
+    // actually having served us blocks quickly from that address.
+    std::sort(vEvictionCandidates.begin(), vEvictionCandidates.end(), CompareNodeBlockLatency);
+    vEvictionCandidates.erase(vEvictionCandidates.end() - std::min(4, static_cast<int>(vEvictionCandidates.size())), vEvictionCandidates.end());
+
+    if (vEvictionCandidates.empty()) return false;
+
     // Protect the half of the remaining nodes which have been connected the longest.
     // This replicates the non-eviction implicit behavior, and precludes attacks that start later.
     std::sort(vEvictionCandidates.begin(), vEvictionCandidates.end(), ReverseCompareNodeTimeConnected);
@@ -1111,6 +1659,11 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     CNode* pnode = new CNode(id, nLocalServices, GetBestHeight(), hSocket, addr, CalculateKeyedNetGroup(addr), nonce, addr_bind, "", true);
     pnode->AddRef();
     pnode->fWhitelisted = whitelisted;
+    // With a link key configured, watch the first bytes for an encrypted-link
+    // hello from one of our own nodes; ordinary peers fall through to
+    // plaintext untouched
+    if (GetLinkCryptKey() != nullptr)
+        pnode->StartLinkCrypt(false);
     m_msgproc->InitializeNode(pnode);
 
     LogPrint(BCLog::NET, "connection from %s accepted\n", addr.ToString());
@@ -1121,6 +1674,292 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     }
 }
 
+//! How long the socket handler waits for events; also the frequency at which
+//! pnode->vSend is re-checked for new data to send.
+static const int SOCKET_WAIT_TIMEOUT_MILLISECONDS = 50;
+
+bool CConnman::GenerateSelectSet(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+{
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        recv_set.insert(hListenSocket.socket);
+    }
+
+#ifndef WIN32
+    // Watch the wakeup pipe so WakeSocketHandler() interrupts the poll wait
+    if (fdSocketWakeup[0] != -1)
+        recv_set.insert((SOCKET)fdSocketWakeup[0]);
+#endif
+
+    {
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodes)
+        {
+            // Implement the following logic:
+            // * If there is data to send, select() for sending data. As this only
+            //   happens when optimistic write failed, we choose to first drain the
+            //   write buffer in this case before receiving more. This avoids
+            //   needlessly queueing received data, if the remote peer is not themselves
+            //   receiving data. This means properly utilizing TCP flow control signalling.
+            // * Otherwise, if there is space left in the receive buffer, select() for
+            //   receiving data.
+            // * Hand off all complete messages to the processor, to be handled without
+            //   blocking here.
+
+            bool select_recv = !pnode->fPauseRecv;
+            bool select_send;
+            {
+                LOCK(pnode->cs_vSend);
+                select_send = !pnode->vSendMsg.empty();
+            }
+
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+
+            error_set.insert(pnode->hSocket);
+
+            if (select_send) {
+                send_set.insert(pnode->hSocket);
+                continue;
+            }
+            if (select_recv) {
+                recv_set.insert(pnode->hSocket);
+            }
+        }
+    }
+
+    return !(recv_set.empty() && send_set.empty() && error_set.empty());
+}
+
+#ifdef USE_EPOLL
+void CConnman::SocketEvents(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+{
+    std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
+    if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set)) {
+        interruptNet.sleep_for(std::chrono::milliseconds(SOCKET_WAIT_TIMEOUT_MILLISECONDS));
+        return;
+    }
+
+    // One epoll instance for the lifetime of the process; only the socket
+    // handler thread touches it, so no locking is needed.
+    static int epollfd = -1;
+    static std::set<SOCKET> setRegistered;
+    if (epollfd == -1) {
+        epollfd = epoll_create1(0);
+        if (epollfd == -1) {
+            LogPrintf("epoll_create1 failed: %s\n", NetworkErrorString(WSAGetLastError()));
+            interruptNet.sleep_for(std::chrono::milliseconds(SOCKET_WAIT_TIMEOUT_MILLISECONDS));
+            return;
+        }
+    }
+
+    // Desired interest per socket. Error conditions are always reported, so
+    // sockets watched only for errors carry no event bits.
+    std::map<SOCKET, uint32_t> mapEvents;
+    for (SOCKET hSocket : error_select_set) {
+        mapEvents[hSocket] = 0;
+    }
+    for (SOCKET hSocket : recv_select_set) {
+        mapEvents[hSocket] |= EPOLLIN;
+    }
+    for (SOCKET hSocket : send_select_set) {
+        mapEvents[hSocket] |= EPOLLOUT;
+    }
+
+    // Drop sockets we are no longer interested in. Errors (the socket was
+    // already closed and deregistered by the kernel) are harmless here.
+    for (auto it = setRegistered.begin(); it != setRegistered.end();) {
+        if (mapEvents.count(*it) == 0) {
+            epoll_ctl(epollfd, EPOLL_CTL_DEL, *it, nullptr);
+            it = setRegistered.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // (Re-)register everything else. A registration does not survive close(),
+    // and a descriptor number may have been recycled for a new connection
+    // since the last pass, so try ADD first and downgrade to MOD for
+    // descriptors the kernel already tracks.
+    for (const std::pair<const SOCKET, uint32_t>& entry : mapEvents) {
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = entry.second;
+        ev.data.fd = entry.first;
+        if (epoll_ctl(epollfd, EPOLL_CTL_ADD, entry.first, &ev) != 0 && errno == EEXIST) {
+            epoll_ctl(epollfd, EPOLL_CTL_MOD, entry.first, &ev);
+        }
+        setRegistered.insert(entry.first);
+    }
+
+    std::vector<epoll_event> vEvents(mapEvents.size());
+    int nEvents = epoll_wait(epollfd, vEvents.data(), vEvents.size(), SOCKET_WAIT_TIMEOUT_MILLISECONDS);
+    if (interruptNet)
+        return;
+    if (nEvents == -1) {
+        if (errno != EINTR)
+            LogPrintf("epoll_wait error %s\n", NetworkErrorString(WSAGetLastError()));
+        return;
+    }
+
+    for (int i = 0; i < nEvents; i++) {
+        SOCKET hSocket = vEvents[i].data.fd;
+        if (vEvents[i].events & EPOLLIN)
+            recv_set.insert(hSocket);
+        if (vEvents[i].events & EPOLLOUT)
+            send_set.insert(hSocket);
+        if (vEvents[i].events & (EPOLLERR | EPOLLHUP))
+            error_set.insert(hSocket);
+    }
+}
+#elif defined(USE_KQUEUE)
+void CConnman::SocketEvents(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+{
+    std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
+    if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set)) {
+        interruptNet.sleep_for(std::chrono::milliseconds(SOCKET_WAIT_TIMEOUT_MILLISECONDS));
+        return;
+    }
+
+    // One kqueue for the lifetime of the process; only the socket handler
+    // thread touches it, so no locking is needed.
+    static int kqueuefd = -1;
+    static std::set<SOCKET> setReadWatched;
+    static std::set<SOCKET> setWriteWatched;
+    if (kqueuefd == -1) {
+        kqueuefd = kqueue();
+        if (kqueuefd == -1) {
+            LogPrintf("kqueue failed: %s\n", NetworkErrorString(WSAGetLastError()));
+            interruptNet.sleep_for(std::chrono::milliseconds(SOCKET_WAIT_TIMEOUT_MILLISECONDS));
+            return;
+        }
+    }
+
+    // Batch all filter changes into the kevent() call that also waits for
+    // events. EV_ADD updates an already-attached filter in place, which also
+    // covers descriptor numbers recycled since the last pass. Sockets watched
+    // only for errors (receive paused, nothing to send) are left unwatched;
+    // errors on them surface once the read filter is re-attached.
+    std::vector<struct kevent> vChanges;
+    struct kevent change;
+    for (SOCKET hSocket : setReadWatched) {
+        if (recv_select_set.count(hSocket) == 0) {
+            EV_SET(&change, hSocket, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+            vChanges.push_back(change);
+        }
+    }
+    for (SOCKET hSocket : setWriteWatched) {
+        if (send_select_set.count(hSocket) == 0) {
+            EV_SET(&change, hSocket, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+            vChanges.push_back(change);
+        }
+    }
+    for (SOCKET hSocket : recv_select_set) {
+        EV_SET(&change, hSocket, EVFILT_READ, EV_ADD, 0, 0, nullptr);
+        vChanges.push_back(change);
+    }
+    for (SOCKET hSocket : send_select_set) {
+        EV_SET(&change, hSocket, EVFILT_WRITE, EV_ADD, 0, 0, nullptr);
+        vChanges.push_back(change);
+    }
+    setReadWatched = recv_select_set;
+    setWriteWatched = send_select_set;
+
+    std::vector<struct kevent> vEvents(recv_select_set.size() + send_select_set.size() + 1);
+    struct timespec timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_nsec = SOCKET_WAIT_TIMEOUT_MILLISECONDS * 1000 * 1000;
+    int nEvents = kevent(kqueuefd, vChanges.data(), vChanges.size(), vEvents.data(), vEvents.size(), &timeout);
+    if (interruptNet)
+        return;
+    if (nEvents == -1) {
+        if (errno != EINTR)
+            LogPrintf("kevent error %s\n", NetworkErrorString(WSAGetLastError()));
+        return;
+    }
+
+    for (int i = 0; i < nEvents; i++) {
+        if (vEvents[i].flags & EV_ERROR) {
+            // Error applying one of the changes above (e.g. deleting a filter
+            // from a socket that was closed in the meantime); not a socket event.
+            continue;
+        }
+        SOCKET hSocket = vEvents[i].ident;
+        if (vEvents[i].filter == EVFILT_READ)
+            recv_set.insert(hSocket);
+        if (vEvents[i].filter == EVFILT_WRITE)
+            send_set.insert(hSocket);
+        if (vEvents[i].flags & EV_EOF)
+            error_set.insert(hSocket);
+    }
+}
+#else
+void CConnman::SocketEvents(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+{
+    std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
+    if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set)) {
+        interruptNet.sleep_for(std::chrono::milliseconds(SOCKET_WAIT_TIMEOUT_MILLISECONDS));
+        return;
+    }
+
+    //
+    // Find which sockets have data to receive
+    //
+    struct timeval timeout;
+    timeout.tv_sec  = 0;
+    timeout.tv_usec = SOCKET_WAIT_TIMEOUT_MILLISECONDS * 1000; // frequency to poll pnode->vSend
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+
+    for (SOCKET hSocket : recv_select_set) {
+        FD_SET(hSocket, &fdsetRecv);
+        hSocketMax = std::max(hSocketMax, hSocket);
+    }
+    for (SOCKET hSocket : send_select_set) {
+        FD_SET(hSocket, &fdsetSend);
+        hSocketMax = std::max(hSocketMax, hSocket);
+    }
+    for (SOCKET hSocket : error_select_set) {
+        FD_SET(hSocket, &fdsetError);
+        hSocketMax = std::max(hSocketMax, hSocket);
+    }
+
+    int nSelect = select(hSocketMax + 1, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    if (interruptNet)
+        return;
+
+    if (nSelect == SOCKET_ERROR)
+    {
+        int nErr = WSAGetLastError();
+        LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+        for (unsigned int i = 0; i <= hSocketMax; i++)
+            FD_SET(i, &fdsetRecv);
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        if (!interruptNet.sleep_for(std::chrono::milliseconds(SOCKET_WAIT_TIMEOUT_MILLISECONDS)))
+            return;
+    }
+
+    for (SOCKET hSocket : recv_select_set) {
+        if (FD_ISSET(hSocket, &fdsetRecv))
+            recv_set.insert(hSocket);
+    }
+    for (SOCKET hSocket : send_select_set) {
+        if (FD_ISSET(hSocket, &fdsetSend))
+            send_set.insert(hSocket);
+    }
+    for (SOCKET hSocket : error_select_set) {
+        if (FD_ISSET(hSocket, &fdsetError))
+            error_set.insert(hSocket);
+    }
+}
+#endif
+
 void CConnman::ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
@@ -1204,6 +2043,7 @@ void CConnman::ThreadSocketHandler()
         }
         if(vNodesSize != nPrevNodeCount) {
             nPrevNodeCount = vNodesSize;
+            g_metrics.nPeerCount.store((::int64_t)vNodesSize, std::memory_order_relaxed);
             if(clientInterface)
                 clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
         }
@@ -1211,91 +2051,30 @@ void CConnman::ThreadSocketHandler()
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-        for (const ListenSocket& hListenSocket : vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
-
-        {
-            LOCK(cs_vNodes);
-            for (CNode* pnode : vNodes)
-            {
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is space left in the receive buffer, select() for
-                //   receiving data.
-                // * Hand off all complete messages to the processor, to be handled without
-                //   blocking here.
-
-                bool select_recv = !pnode->fPauseRecv;
-                bool select_send;
-                {
-                    LOCK(pnode->cs_vSend);
-                    select_send = !pnode->vSendMsg.empty();
-                }
-
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
-                }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
-            }
-        }
-
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        std::set<SOCKET> recv_set, send_set, error_set;
+        SocketEvents(recv_set, send_set, error_set);
         if (interruptNet)
             return;
 
-        if (nSelect == SOCKET_ERROR)
+#ifndef WIN32
+        //
+        // Drain the wakeup pipe; the point of the wakeup was to recompute
+        // the send set, which the next GenerateSelectSet pass does
+        //
+        if (fdSocketWakeup[0] != -1 && recv_set.count((SOCKET)fdSocketWakeup[0]) > 0)
         {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
-                return;
+            char pchBuf[32];
+            while (read(fdSocketWakeup[0], pchBuf, sizeof(pchBuf)) > 0) {}
+            recv_set.erase((SOCKET)fdSocketWakeup[0]);
         }
+#endif
 
         //
         // Accept new connections
         //
         for (const ListenSocket& hListenSocket : vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (hListenSocket.socket != INVALID_SOCKET && recv_set.count(hListenSocket.socket) > 0)
             {
                 AcceptConnection(hListenSocket);
             }
@@ -1326,25 +2105,36 @@ void CConnman::ThreadSocketHandler()
                 LOCK(pnode->cs_hSocket);
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+                recvSet = recv_set.count(pnode->hSocket) > 0;
+                sendSet = send_set.count(pnode->hSocket) > 0;
+                errorSet = error_set.count(pnode->hSocket) > 0;
             }
             if (recvSet || errorSet)
             {
                 // typical socket buffer is 8K-64K
                 char pchBuf[0x10000];
                 int nBytes = 0;
+                bool fDirect = false;
                 {
                     LOCK(pnode->cs_hSocket);
                     if (pnode->hSocket == INVALID_SOCKET)
                         continue;
-                    nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+                    // When a large payload is part-way in, receive straight
+                    // into the message buffer and skip the bounce buffer copy.
+                    char* pchDirect = nullptr;
+                    unsigned int nDirectSpace = 0;
+                    fDirect = pnode->GetDirectRecvSpace(pchDirect, nDirectSpace);
+                    if (fDirect)
+                        nBytes = recv(pnode->hSocket, pchDirect, nDirectSpace, MSG_DONTWAIT);
+                    else
+                        nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
                 }
                 if (nBytes > 0)
                 {
                     bool notify = false;
-                    if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
+                    bool fRecvOK = fDirect ? pnode->DirectRecvBytesWritten(nBytes, notify)
+                                           : pnode->ReceiveMsgBytes(pchBuf, nBytes, notify);
+                    if (!fRecvOK)
                         pnode->CloseSocketDisconnect();
                     RecordBytesRecv(nBytes);
                     if (notify) {
@@ -1361,7 +2151,7 @@ void CConnman::ThreadSocketHandler()
                             pnode->nProcessQueueSize += nSizeAdded;
                             pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
                         }
-                        WakeMessageHandler();
+                        WakeMessageHandler(pnode->GetId());
                     }
                 }
                 else if (nBytes == 0)
@@ -1440,125 +2230,177 @@ void CConnman::ThreadSocketHandler()
 
 void CConnman::WakeMessageHandler()
 {
+    for (const std::unique_ptr<CMsgHandlerWake>& wake : vMsgProcWake) {
+        {
+            std::lock_guard<std::mutex> lock(wake->mutex);
+            wake->fWake = true;
+        }
+        wake->cond.notify_one();
+    }
+}
+
+void CConnman::WakeMessageHandler(NodeId nodeid)
+{
+    if (vMsgProcWake.empty())
+        return;
+    CMsgHandlerWake& wake = *vMsgProcWake[nodeid % vMsgProcWake.size()];
     {
-        std::lock_guard<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = true;
+        std::lock_guard<std::mutex> lock(wake.mutex);
+        wake.fWake = true;
     }
-    condMsgProc.notify_one();
+    wake.cond.notify_one();
+}
+
+void CConnman::WakeSocketHandler()
+{
+#ifndef WIN32
+    if (fdSocketWakeup[1] != -1) {
+        char ch = 0;
+        // EAGAIN means the pipe is full, so a wakeup is already pending
+        if (write(fdSocketWakeup[1], &ch, 1) < 0 && errno != EAGAIN)
+            LogPrint(BCLog::NET, "socket wakeup pipe write failed\n");
+    }
+#endif
 }
 
 #ifdef USE_UPNP
-void ThreadMapPort()
+//
+// UPnP port mapping. Discovery and the 20-minute lease refresh run as
+// tasks on the scheduler thread handed to MapPort(), so no dedicated
+// thread sleeps between refreshes. cs_mapport guards all state below;
+// nMapPortSequence is bumped on every toggle so refresh tasks queued
+// for an earlier enable retire as no-ops (CScheduler has no way to
+// cancel a queued task).
+//
+static CCriticalSection cs_mapport;
+static CScheduler* g_mapport_scheduler = nullptr;
+static bool fMapPortEnabled = false;
+static bool fPortMapped = false;
+static int64_t nMapPortSequence = 0;
+static struct UPNPDev* g_upnp_devlist = nullptr;
+static struct UPNPUrls g_upnp_urls;
+static struct IGDdatas g_upnp_data;
+static char g_upnp_lanaddr[64];
+static std::string g_upnp_port;
+
+//! Release the current port mapping. Requires cs_mapport.
+static void CloseMapPort()
+{
+    if (!fPortMapped)
+        return;
+    int r = UPNP_DeletePortMapping(g_upnp_urls.controlURL, g_upnp_data.first.servicetype, g_upnp_port.c_str(), "TCP", 0);
+    LogPrintf("UPNP_DeletePortMapping() returned: %d\n", r);
+    freeUPNPDevlist(g_upnp_devlist); g_upnp_devlist = nullptr;
+    FreeUPNPUrls(&g_upnp_urls);
+    fPortMapped = false;
+}
+
+//! Discover an IGD and remember it in the statics above. Requires
+//! cs_mapport. Blocks for up to two seconds while probing the LAN.
+static bool DiscoverMapPort()
 {
-    std::string port = strprintf("%u", GetListenPort());
     const char * multicastif = 0;
     const char * minissdpdpath = 0;
-    struct UPNPDev * devlist = 0;
-    char lanaddr[64];
 
 #ifndef UPNPDISCOVER_SUCCESS
     /* miniupnpc 1.5 */
-    devlist = upnpDiscover(2000, multicastif, minissdpdpath, 0);
+    g_upnp_devlist = upnpDiscover(2000, multicastif, minissdpdpath, 0);
 #elif MINIUPNPC_API_VERSION < 14
     /* miniupnpc 1.6 */
     int error = 0;
-    devlist = upnpDiscover(2000, multicastif, minissdpdpath, 0, 0, &error);
+    g_upnp_devlist = upnpDiscover(2000, multicastif, minissdpdpath, 0, 0, &error);
 #else
     /* miniupnpc 1.9.20150730 */
     int error = 0;
-    devlist = upnpDiscover(2000, multicastif, minissdpdpath, 0, 0, 2, &error);
+    g_upnp_devlist = upnpDiscover(2000, multicastif, minissdpdpath, 0, 0, 2, &error);
 #endif
 
-    struct UPNPUrls urls;
-    struct IGDdatas data;
-    int r;
     char wanaddr[64] = "";
-
-    r = UPNP_GetValidIGD(devlist, &urls, &data, lanaddr, sizeof(lanaddr), wanaddr, sizeof(wanaddr));
-    if (r == 1)
+    int r = UPNP_GetValidIGD(g_upnp_devlist, &g_upnp_urls, &g_upnp_data, g_upnp_lanaddr, sizeof(g_upnp_lanaddr), wanaddr, sizeof(wanaddr));
+    if (r != 1)
     {
-        if (fDiscover) {
-            char externalIPAddress[40];
-            r = UPNP_GetExternalIPAddress(urls.controlURL, data.first.servicetype, externalIPAddress);
-            if(r != UPNPCOMMAND_SUCCESS)
-                LogPrintf("UPnP: GetExternalIPAddress() returned %d\n", r);
-            else
+        LogPrintf("No valid UPnP IGDs found\n");
+        freeUPNPDevlist(g_upnp_devlist); g_upnp_devlist = nullptr;
+        if (r != 0)
+            FreeUPNPUrls(&g_upnp_urls);
+        return false;
+    }
+
+    if (fDiscover) {
+        char externalIPAddress[40];
+        r = UPNP_GetExternalIPAddress(g_upnp_urls.controlURL, g_upnp_data.first.servicetype, externalIPAddress);
+        if(r != UPNPCOMMAND_SUCCESS)
+            LogPrintf("UPnP: GetExternalIPAddress() returned %d\n", r);
+        else
+        {
+            if(externalIPAddress[0])
             {
-                if(externalIPAddress[0])
-                {
-                    CNetAddr resolved;
-                    if(LookupHost(externalIPAddress, resolved, false)) {
-                        LogPrintf("UPnP: ExternalIPAddress = %s\n", resolved.ToString().c_str());
-                        AddLocal(resolved, LOCAL_UPNP);
-                    }
+                CNetAddr resolved;
+                if(LookupHost(externalIPAddress, resolved, false)) {
+                    LogPrintf("UPnP: ExternalIPAddress = %s\n", resolved.ToString().c_str());
+                    AddLocal(resolved, LOCAL_UPNP);
                 }
-                else
-                    LogPrintf("UPnP: GetExternalIPAddress failed.\n");
             }
+            else
+                LogPrintf("UPnP: GetExternalIPAddress failed.\n");
         }
+    }
 
-        std::string strDesc = "Yacoin " + FormatFullVersion();
+    g_upnp_port = strprintf("%u", GetListenPort());
+    return true;
+}
 
-        try {
-            while (true) {
+//! Scheduler task: (re-)add the port mapping and queue the next refresh.
+static void RefreshMapPort(int64_t nSequence)
+{
+    LOCK(cs_mapport);
+    if (!fMapPortEnabled || nSequence != nMapPortSequence)
+        return; // toggled off or on again since this task was queued
+    if (!fPortMapped)
+    {
+        if (!DiscoverMapPort())
+            return; // no IGD on this LAN; give up, as the old thread did
+        fPortMapped = true;
+    }
+
+    std::string strDesc = "Yacoin " + FormatFullVersion();
 #ifndef UPNPDISCOVER_SUCCESS
-                /* miniupnpc 1.5 */
-                r = UPNP_AddPortMapping(urls.controlURL, data.first.servicetype,
-                                    port.c_str(), port.c_str(), lanaddr, strDesc.c_str(), "TCP", 0);
+    /* miniupnpc 1.5 */
+    int r = UPNP_AddPortMapping(g_upnp_urls.controlURL, g_upnp_data.first.servicetype,
+                        g_upnp_port.c_str(), g_upnp_port.c_str(), g_upnp_lanaddr, strDesc.c_str(), "TCP", 0);
 #else
-                /* miniupnpc 1.6 */
-                r = UPNP_AddPortMapping(urls.controlURL, data.first.servicetype,
-                                    port.c_str(), port.c_str(), lanaddr, strDesc.c_str(), "TCP", 0, "0");
+    /* miniupnpc 1.6 */
+    int r = UPNP_AddPortMapping(g_upnp_urls.controlURL, g_upnp_data.first.servicetype,
+                        g_upnp_port.c_str(), g_upnp_port.c_str(), g_upnp_lanaddr, strDesc.c_str(), "TCP", 0, "0");
 #endif
 
-                if(r!=UPNPCOMMAND_SUCCESS)
-                    LogPrintf("AddPortMapping(%s, %s, %s) failed with code %d (%s)\n",
-                        port, port, lanaddr, r, strupnperror(r));
-                else
-                    LogPrintf("UPnP Port Mapping successful.\n");
+    if(r!=UPNPCOMMAND_SUCCESS)
+        LogPrintf("AddPortMapping(%s, %s, %s) failed with code %d (%s)\n",
+            g_upnp_port, g_upnp_port, g_upnp_lanaddr, r, strupnperror(r));
+    else
+        LogPrintf("UPnP Port Mapping successful.\n");
 
-                MilliSleep(20*60*1000); // Refresh every 20 minutes
-            }
-        }
-        catch (const boost::thread_interrupted&)
-        {
-            r = UPNP_DeletePortMapping(urls.controlURL, data.first.servicetype, port.c_str(), "TCP", 0);
-            LogPrintf("UPNP_DeletePortMapping() returned: %d\n", r);
-            freeUPNPDevlist(devlist); devlist = 0;
-            FreeUPNPUrls(&urls);
-            throw;
-        }
-    } else {
-        LogPrintf("No valid UPnP IGDs found\n");
-        freeUPNPDevlist(devlist); devlist = 0;
-        if (r != 0)
-            FreeUPNPUrls(&urls);
-    }
+    g_mapport_scheduler->scheduleFromNow(std::bind(&RefreshMapPort, nSequence), 20*60*1000); // Refresh every 20 minutes
 }
 
-void MapPort(bool fUseUPnP)
+void MapPort(bool fUseUPnP, CScheduler* scheduler)
 {
-    static boost::thread* upnp_thread = nullptr;
-
+    LOCK(cs_mapport);
+    if (scheduler)
+        g_mapport_scheduler = scheduler; // init hands us the scheduler; GUI toggles reuse it
+    fMapPortEnabled = fUseUPnP;
+    ++nMapPortSequence;
     if (fUseUPnP)
     {
-        if (upnp_thread) {
-            upnp_thread->interrupt();
-            upnp_thread->join();
-            delete upnp_thread;
-        }
-        upnp_thread = new boost::thread(boost::bind(&TraceThread<void (*)()>, "upnp", &ThreadMapPort));
-    }
-    else if (upnp_thread) {
-        upnp_thread->interrupt();
-        upnp_thread->join();
-        delete upnp_thread;
-        upnp_thread = nullptr;
+        if (g_mapport_scheduler)
+            g_mapport_scheduler->scheduleFromNow(std::bind(&RefreshMapPort, nMapPortSequence), 0);
     }
+    else
+        CloseMapPort(); // synchronous, so shutdown releases the lease before the scheduler stops
 }
 
 #else
-void MapPort(bool)
+void MapPort(bool, CScheduler*)
 {
     // Intentionally left blank.
 }
@@ -1608,34 +2450,96 @@ void CConnman::ThreadDNSAddressSeed()
 
     LogPrintf("Loading addresses from DNS seeds (could take a while)\n");
 
+    // Resolve all seeds in parallel instead of one blocking LookupHost at a
+    // time: a slow or dead seed no longer delays the others, and we stop
+    // waiting once enough addresses have arrived. The queries themselves are
+    // still sent to every seed either way, so the privacy rationale above is
+    // unaffected. The resolver threads co-own the shared state and never
+    // touch the connection manager, so stragglers finishing after an early
+    // exit (or after shutdown) are harmless.
+    struct DNSSeedResolveState {
+        struct Result {
+            std::string host;
+            ServiceFlags requiredServiceBits;
+            std::vector<CNetAddr> vIPs;
+        };
+        std::mutex cs;
+        std::condition_variable cond;
+        int nPending{0};
+        std::vector<Result> vResults;
+    };
+    auto state = std::make_shared<DNSSeedResolveState>();
+
     for (const CDNSSeedData &seed : vSeeds) {
         if (interruptNet) {
             return;
         }
         if (HaveNameProxy()) {
             AddOneShot(seed.host);
-        } else {
-            std::vector<CNetAddr> vIPs;
-            std::vector<CAddress> vAdd;
-            ServiceFlags requiredServiceBits = nRelevantServices;
-            std::string host = GetDNSHost(seed, &requiredServiceBits);
+            continue;
+        }
+        ServiceFlags requiredServiceBits = nRelevantServices;
+        std::string host = GetDNSHost(seed, &requiredServiceBits);
+        CNetAddr resolveSource;
+        if (!resolveSource.SetInternal(host)) {
+            continue;
+        }
+        {
+            std::unique_lock<std::mutex> lock(state->cs);
+            state->nPending++;
+        }
+        std::thread([state, host, requiredServiceBits]() {
+            RenameThread("yacoin-dnsres");
+            DNSSeedResolveState::Result result;
+            result.host = host;
+            result.requiredServiceBits = requiredServiceBits;
+            LookupHost(host.c_str(), result.vIPs, 0, true);
+            std::unique_lock<std::mutex> lock(state->cs);
+            state->vResults.push_back(std::move(result));
+            state->nPending--;
+            state->cond.notify_one();
+        }).detach();
+    }
+
+    while (true) {
+        if (interruptNet) {
+            return;
+        }
+        std::vector<DNSSeedResolveState::Result> vNew;
+        bool fDone;
+        {
+            std::unique_lock<std::mutex> lock(state->cs);
+            if (state->vResults.empty() && state->nPending > 0) {
+                state->cond.wait_for(lock, std::chrono::milliseconds(100));
+            }
+            vNew.swap(state->vResults);
+            fDone = (state->nPending == 0);
+        }
+        for (const DNSSeedResolveState::Result& result : vNew) {
             CNetAddr resolveSource;
-            if (!resolveSource.SetInternal(host)) {
+            if (!resolveSource.SetInternal(result.host)) {
                 continue;
             }
-            if (LookupHost(host.c_str(), vIPs, 0, true))
+            std::vector<CAddress> vAdd;
+            for (const CNetAddr& ip : result.vIPs)
             {
-                for (const CNetAddr& ip : vIPs)
-                {
-                    int nOneDay = 24*3600;
-                    CAddress addr = CAddress(CService(ip, GetDefaultPort()), requiredServiceBits);
-                    addr.nTime = GetTime() - 3*nOneDay - GetRand(4*nOneDay); // use a random age between 3 and 7 days old
-                    vAdd.push_back(addr);
-                    found++;
-                }
+                int nOneDay = 24*3600;
+                CAddress addr = CAddress(CService(ip, GetDefaultPort()), result.requiredServiceBits);
+                addr.nTime = GetTime() - 3*nOneDay - GetRand(4*nOneDay); // use a random age between 3 and 7 days old
+                vAdd.push_back(addr);
+                found++;
+            }
+            if (!vAdd.empty()) {
                 addrman.Add(vAdd, resolveSource);
             }
         }
+        if (found >= ENOUGH_DNS_SEED_ADDRESSES) {
+            LogPrintf("%d addresses found from DNS seeds (enough, not waiting for the remaining seeds)\n", found);
+            return;
+        }
+        if (fDone) {
+            break;
+        }
     }
 
     LogPrintf("%d addresses found from DNS seeds\n", found);
@@ -1645,8 +2549,14 @@ void CConnman::DumpAddresses()
 {
     int64_t nStart = GetTimeMillis();
 
+    // Skip serializing a table that has not changed since the last flush
+    int64_t nChanges = addrman.GetChangeCount();
+    if (nChanges == nLastAddrmanChanges)
+        return;
+
     CAddrDB adb;
-    adb.Write(addrman);
+    if (adb.Write(addrman))
+        nLastAddrmanChanges = nChanges;
 
     LogPrint(BCLog::NET, "Flushed %d addresses to peers.dat  %dms\n",
            addrman.size(), GetTimeMillis() - nStart);
@@ -1656,6 +2566,7 @@ void CConnman::DumpData()
 {
     DumpAddresses();
     DumpBanlist();
+    DumpPeerScores();
 }
 
 void CConnman::ProcessOneShot()
@@ -1814,6 +2725,7 @@ void CConnman::ThreadOpenConnections()
 
         int64_t nANow = GetAdjustedTime();
         int nTries = 0;
+        CAddress addrFallback;
         while (!interruptNet)
         {
             CAddrInfo addr = addrman.Select(fFeeler);
@@ -1854,6 +2766,21 @@ void CConnman::ThreadOpenConnections()
             if (addr.GetPort() != GetDefaultPort() && nTries < 50)
                 continue;
 
+            // prefer addresses with a history of fast block delivery; for the
+            // first 20 draws keep an unscored address only as a fallback and
+            // keep looking (feelers are exempt, their job is exploration)
+            if (!fFeeler && nTries < 20 && GetBlockLatencyScore(addr) == 0) {
+                if (!addrFallback.IsValid()) {
+                    addrFallback = addr;
+                    if (nOutboundRelevant >= (nMaxOutbound >> 1)) {
+                        addrFallback.nServices = REQUIRED_SERVICES;
+                    } else {
+                        addrFallback.nServices = nRequiredServices;
+                    }
+                }
+                continue;
+            }
+
             addrConnect = addr;
 
             // regardless of the services assumed to be available, only require the minimum if half or more outbound have relevant services
@@ -1865,6 +2792,10 @@ void CConnman::ThreadOpenConnections()
             break;
         }
 
+        // no address with a delivery record turned up; take the fallback
+        if (!addrConnect.IsValid() && addrFallback.IsValid())
+            addrConnect = addrFallback;
+
         if (addrConnect.IsValid()) {
 
             if (fFeeler) {
@@ -1875,7 +2806,57 @@ void CConnman::ThreadOpenConnections()
                 LogPrint(BCLog::NET, "Making feeler connection to %s\n", addrConnect.ToString());
             }
 
-            OpenNetworkConnection(addrConnect, (int)setConnected.size() >= std::min(nMaxConnections - 1, 2), &grant, nullptr, false, fFeeler);
+            bool fCountFailure = (int)setConnected.size() >= std::min(nMaxConnections - 1, 2);
+
+            // Cold start: no outbound peer yet, and every dead candidate
+            // costs a full connect timeout when probed one at a time. Race a
+            // few candidates from distinct netgroups in parallel and keep
+            // whichever connect; each attempt holds its own semaphore grant,
+            // so the outbound cap is still respected.
+            if (nOutbound == 0 && !fFeeler) {
+                std::vector<CAddress> vRace;
+                vRace.push_back(addrConnect);
+                std::set<std::vector<unsigned char> > setRaceGroups;
+                setRaceGroups.insert(addrConnect.GetGroup());
+                for (int nDraw = 0; nDraw < 50 && (int)vRace.size() < MAX_COLDSTART_RACE; nDraw++) {
+                    CAddrInfo addr = addrman.Select();
+                    if (!addr.IsValid() || setConnected.count(addr.GetGroup()) ||
+                        setRaceGroups.count(addr.GetGroup()) || IsLocal(addr) || IsLimited(addr))
+                        continue;
+                    if ((addr.nServices & REQUIRED_SERVICES) != REQUIRED_SERVICES)
+                        continue;
+                    if (addr.GetPort() != GetDefaultPort())
+                        continue;
+                    setRaceGroups.insert(addr.GetGroup());
+                    CAddress addrExtra = addr;
+                    addrExtra.nServices = addrConnect.nServices;
+                    vRace.push_back(addrExtra);
+                }
+                // Grants live in a deque so the pointers handed to the racer
+                // threads stay stable; extras only try-acquire
+                std::deque<CSemaphoreGrant> dqGrants;
+                std::vector<std::thread> vRacers;
+                for (size_t n = 0; n < vRace.size(); n++) {
+                    CSemaphoreGrant* pGrant = &grant;
+                    if (n > 0) {
+                        dqGrants.emplace_back(*semOutbound, true);
+                        if (!dqGrants.back()) {
+                            dqGrants.pop_back();
+                            break;
+                        }
+                        pGrant = &dqGrants.back();
+                    }
+                    const CAddress& addrRace = vRace[n];
+                    vRacers.emplace_back([this, addrRace, fCountFailure, pGrant]() {
+                        OpenNetworkConnection(addrRace, fCountFailure, pGrant, nullptr, false, false);
+                    });
+                }
+                for (std::thread& racer : vRacers)
+                    racer.join();
+                continue;
+            }
+
+            OpenNetworkConnection(addrConnect, fCountFailure, &grant, nullptr, false, fFeeler);
         }
     }
 }
@@ -1939,6 +2920,9 @@ void CConnman::ThreadOpenAddedConnections()
         LOCK(cs_vAddedNodes);
         vAddedNodes = gArgs.GetArgs("-addnode");
     }
+    // Dedicated block propagation mesh: maintained like -addnode peers,
+    // but opened block-relay-only (no tx invs, no addr gossip)
+    const std::vector<std::string> vBlocksOnlyNodes = gArgs.GetArgs("-blocksonlyconnect");
 
     while (true)
     {
@@ -1961,6 +2945,17 @@ void CConnman::ThreadOpenAddedConnections()
                     return;
             }
         }
+        for (const std::string& strNode : vBlocksOnlyNodes) {
+            if (FindNode(strNode))
+                continue;
+            if (!grant.TryAcquire())
+                break;
+            tried = true;
+            CService service(LookupNumeric(strNode.c_str(), GetDefaultPort()));
+            OpenNetworkConnection(CAddress(service, NODE_NONE), false, &grant, strNode.c_str(), false, false, true, true);
+            if (!interruptNet.sleep_for(std::chrono::milliseconds(500)))
+                return;
+        }
         // Retry every 60 seconds if a connection was attempted, otherwise two seconds
         if (!interruptNet.sleep_for(std::chrono::seconds(tried ? 60 : 2)))
             return;
@@ -1968,7 +2963,7 @@ void CConnman::ThreadOpenAddedConnections()
 }
 
 // if successful, this moves the passed grant to the constructed node
-bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFailure, CSemaphoreGrant *grantOutbound, const char *pszDest, bool fOneShot, bool fFeeler, bool manual_connection)
+bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFailure, CSemaphoreGrant *grantOutbound, const char *pszDest, bool fOneShot, bool fFeeler, bool manual_connection, bool block_relay_only)
 {
     //
     // Initiate outbound network connection
@@ -1999,6 +2994,8 @@ bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         pnode->fFeeler = true;
     if (manual_connection)
         pnode->m_manual_connection = true;
+    if (block_relay_only)
+        pnode->fBlockRelayOnly = true;
 
     m_msgproc->InitializeNode(pnode);
     {
@@ -2009,16 +3006,22 @@ bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     return true;
 }
 
-void CConnman::ThreadMessageHandler()
+void CConnman::ThreadMessageHandler(int nShard)
 {
+    CMsgHandlerWake& wake = *vMsgProcWake[nShard];
     while (!flagInterruptMsgProc)
     {
         std::vector<CNode*> vNodesCopy;
         {
             LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            for (CNode* pnode : vNodesCopy) {
+            vNodesCopy.reserve(vNodes.size());
+            for (CNode* pnode : vNodes) {
+                // Each peer belongs to exactly one handler thread, so its
+                // messages are still processed strictly in order.
+                if ((int)(pnode->GetId() % nMsgProcThreads) != nShard)
+                    continue;
                 pnode->AddRef();
+                vNodesCopy.push_back(pnode);
             }
         }
 
@@ -2050,11 +3053,11 @@ void CConnman::ThreadMessageHandler()
                 pnode->Release();
         }
 
-        std::unique_lock<std::mutex> lock(mutexMsgProc);
+        std::unique_lock<std::mutex> lock(wake.mutex);
         if (!fMoreWork) {
-            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this] { return fMsgProcWake; });
+            wake.cond.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [&wake] { return wake.fWake; });
         }
-        fMsgProcWake = false;
+        wake.fWake = false;
     }
 }
 
@@ -2234,6 +3237,7 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
     fNetworkActive = true;
     setBannedIsDirty = false;
     fAddressesInitialized = false;
+    nLastAddrmanChanges = -1;
     nLastNodeId = 0;
     nSendBufferMaxSize = 0;
     nReceiveFloodSize = 0;
@@ -2241,6 +3245,9 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
     semAddnode = nullptr;
     flagInterruptMsgProc = false;
     SetTryNewOutboundPeer(false);
+#ifndef WIN32
+    fdSocketWakeup[0] = fdSocketWakeup[1] = -1;
+#endif
 
     Options connOptions;
     Init(connOptions);
@@ -2349,6 +3356,20 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         DumpBanlist();
     }
 
+    // Load peer performance records from peerscores.dat
+    nStart = GetTimeMillis();
+    CPeerScoreDB scoredb;
+    peerscoremap_t scoreMap;
+    if (scoredb.Read(scoreMap)) {
+        LOCK(cs_mapPeerScores);
+        mapPeerScores = scoreMap;
+        LogPrint(BCLog::NET, "Loaded %d peer performance records from peerscores.dat  %dms\n",
+            scoreMap.size(), GetTimeMillis() - nStart);
+    } else {
+        // Not an error on first run; start with an empty map
+        LogPrint(BCLog::NET, "Invalid or missing peerscores.dat; starting fresh\n");
+    }
+
     uiInterface.InitMessage(_("Starting network threads..."));
 
     fAddressesInitialized = true;
@@ -2370,10 +3391,22 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     interruptNet.reset();
     flagInterruptMsgProc = false;
 
-    {
-        std::unique_lock<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = false;
+    nMsgProcThreads = std::max<int>(1, gArgs.GetArg("-msghandlerthreads", DEFAULT_MSGHANDLER_THREADS));
+    vMsgProcWake.clear();
+    for (int i = 0; i < nMsgProcThreads; i++)
+        vMsgProcWake.emplace_back(new CMsgHandlerWake());
+
+#ifndef WIN32
+    // Self-pipe so block announcements and other urgent sends do not wait
+    // out the socket handler's poll timeout
+    if (pipe(fdSocketWakeup) == 0) {
+        fcntl(fdSocketWakeup[0], F_SETFL, fcntl(fdSocketWakeup[0], F_GETFL) | O_NONBLOCK);
+        fcntl(fdSocketWakeup[1], F_SETFL, fcntl(fdSocketWakeup[1], F_GETFL) | O_NONBLOCK);
+    } else {
+        fdSocketWakeup[0] = fdSocketWakeup[1] = -1;
+        LogPrintf("Warning: cannot create socket wakeup pipe, send latency is bounded by the poll timeout\n");
     }
+#endif
 
     // Send and receive from sockets, accept connections
     threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
@@ -2390,8 +3423,9 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     if (!gArgs.IsArgSet("-connect") || gArgs.GetArgs("-connect").size() != 1 || gArgs.GetArgs("-connect")[0] != "0")
         threadOpenConnections = std::thread(&TraceThread<std::function<void()> >, "opencon", std::function<void()>(std::bind(&CConnman::ThreadOpenConnections, this)));
 
-    // Process messages
-    threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    // Process messages, one thread per peer shard
+    for (int i = 0; i < nMsgProcThreads; i++)
+        vThreadsMessageHandler.emplace_back(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this, i)));
 
     // Dump network addresses
     scheduler.scheduleEvery(std::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL * 1000);
@@ -2416,13 +3450,11 @@ instance_of_cnetcleanup;
 
 void CConnman::Interrupt()
 {
-    {
-        std::lock_guard<std::mutex> lock(mutexMsgProc);
-        flagInterruptMsgProc = true;
-    }
-    condMsgProc.notify_all();
+    flagInterruptMsgProc = true;
+    WakeMessageHandler();
 
     interruptNet();
+    WakeSocketHandler();
     InterruptSocks5(true);
 
     if (semOutbound) {
@@ -2440,8 +3472,11 @@ void CConnman::Interrupt()
 
 void CConnman::Stop()
 {
-    if (threadMessageHandler.joinable())
-        threadMessageHandler.join();
+    for (std::thread& thread : vThreadsMessageHandler) {
+        if (thread.joinable())
+            thread.join();
+    }
+    vThreadsMessageHandler.clear();
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
@@ -2451,6 +3486,14 @@ void CConnman::Stop()
     if (threadSocketHandler.joinable())
         threadSocketHandler.join();
 
+#ifndef WIN32
+    if (fdSocketWakeup[0] != -1)
+        close(fdSocketWakeup[0]);
+    if (fdSocketWakeup[1] != -1)
+        close(fdSocketWakeup[1]);
+    fdSocketWakeup[0] = fdSocketWakeup[1] = -1;
+#endif
+
     if (fAddressesInitialized)
     {
         DumpData();
@@ -2575,6 +3618,7 @@ void CConnman::GetNodeStats(std::vector<CNodeStats>& vstats)
         CNode* pnode = *it;
         vstats.emplace_back();
         pnode->copyStats(vstats.back());
+        vstats.back().nSendRate = pnode->fWhitelisted ? 0 : (pnode->fInbound ? nInboundSendRate : nOutboundSendRate);
     }
 }
 
@@ -2709,6 +3753,23 @@ uint64_t CConnman::GetTotalBytesSent()
     return nTotalBytesSent;
 }
 
+size_t CConnman::GetTotalBufferedBytes()
+{
+    size_t nTotal = 0;
+    LOCK(cs_vNodes);
+    for (CNode* pnode : vNodes) {
+        {
+            LOCK(pnode->cs_vSend);
+            nTotal += pnode->nSendSize;
+        }
+        {
+            LOCK(pnode->cs_vProcessMsg);
+            nTotal += pnode->nProcessQueueSize;
+        }
+    }
+    return nTotal;
+}
+
 ServiceFlags CConnman::GetLocalServices() const
 {
     return nLocalServices;
@@ -2747,17 +3808,23 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nLastSend = 0;
     nLastRecv = 0;
     nSendBytes = 0;
+    nSendMsgs = 0;
+    dSendTokens = 0.0;
+    nLastSendTokens = 0;
     nRecvBytes = 0;
+    nRecvMsgs = 0;
     nTimeOffset = 0;
     addrName = addrNameIn == "" ? addr.ToStringIPPort() : addrNameIn;
     nVersion = 0;
     strSubVer = "";
     fWhitelisted = false;
     fOneShot = false;
+    fBlockRelayOnly = false;
     m_manual_connection = false;
     fClient = false; // set by version message
     fFeeler = false;
     fSuccessfullyConnected = false;
+    fFastChecksum = false;
     fDisconnect = false;
     nRefCount = 0;
     nSendSize = 0;
@@ -2770,6 +3837,7 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nNextLocalAddrSend = 0;
     nNextAddrSend = 0;
     nNextInvSend = 0;
+    nNextTxAnnouncementSeq = 0;
     fRelayTxes = false;
     fSentAddr = false;
     pfilter = new CBloomFilter();
@@ -2818,7 +3886,7 @@ void CNode::AskFor(const CInv& inv)
     // We're using mapAskFor as a priority queue,
     // the key is the earliest time the request can be sent
     int64_t nRequestTime;
-    limitedmap<uint256, int64_t>::const_iterator it = mapAlreadyAskedFor.find(inv.hash);
+    limitedlrumap<uint256, int64_t, CAskedForHasher>::const_iterator it = mapAlreadyAskedFor.find(inv.hash);
     if (it != mapAlreadyAskedFor.end())
         nRequestTime = it->second;
     else
@@ -2854,33 +3922,119 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
     std::vector<unsigned char> serializedHeader;
     serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
-    uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
     CMessageHeader hdr(msg.command.c_str(), nMessageSize);
-    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    if (pnode->fFastChecksum) {
+        uint32_t nChecksum = FastMessageChecksum(msg.data.data(), nMessageSize);
+        memcpy(hdr.pchChecksum, &nChecksum, CMessageHeader::CHECKSUM_SIZE);
+    } else {
+        uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
+        memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    }
 
     CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
 
     size_t nBytesSent = 0;
+    bool fWakeSocket = false;
     {
         LOCK(pnode->cs_vSend);
         bool optimisticSend(pnode->vSendMsg.empty());
 
         //log total amount of bytes per command
         pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
+        pnode->nSendMsgs++;
+        pnode->nSendSize += nTotalSize;
+
+        if (pnode->nSendSize > nSendBufferMaxSize)
+            pnode->fPauseSend = true;
+        TRACE5(net, push_message, pnode->GetId(), msg.command.c_str(), nTotalSize, pnode->nSendSize, pnode->vSendMsg.size());
+        if (pnode->pLinkCrypt) {
+            // Stage for the next sealed batch instead of queuing directly
+            std::vector<unsigned char>& vchPlain = pnode->pLinkCrypt->vchSendPlain;
+            vchPlain.insert(vchPlain.end(), serializedHeader.begin(), serializedHeader.end());
+            vchPlain.insert(vchPlain.end(), msg.data.begin(), msg.data.end());
+            if (vchPlain.size() >= LINK_CRYPT_BATCH_TARGET)
+                pnode->FlushLinkCryptSend();
+        } else {
+            pnode->vSendMsg.push_back(CSendBuffer(std::move(serializedHeader)));
+            if (nMessageSize)
+                pnode->vSendMsg.push_back(CSendBuffer(std::move(msg.data)));
+        }
+
+        // If write queue empty, attempt "optimistic write"
+        if (optimisticSend == true)
+            nBytesSent = SocketSendData(pnode);
+        fWakeSocket = !pnode->vSendMsg.empty();
+    }
+    if (nBytesSent)
+        RecordBytesSent(nBytesSent);
+    // Data was left queued because the optimistic write could not run or
+    // could not complete; interrupt the socket handler's poll wait so the
+    // socket is picked up for sending now instead of on the next timeout
+    if (fWakeSocket)
+        WakeSocketHandler();
+}
+
+void CConnman::PushSharedMessage(CNode* pnode, const std::string& command, const std::shared_ptr<const std::vector<unsigned char>>& payload)
+{
+    size_t nMessageSize = payload->size();
+    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
+    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n", SanitizeString(command), nMessageSize, pnode->GetId());
+
+    // Only the header is peer-specific (the checksum algorithm is negotiated
+    // per connection); the payload itself is queued by reference.
+    std::vector<unsigned char> serializedHeader;
+    serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
+    CMessageHeader hdr(command.c_str(), nMessageSize);
+    if (pnode->fFastChecksum) {
+        uint32_t nChecksum = FastMessageChecksum(payload->data(), nMessageSize);
+        memcpy(hdr.pchChecksum, &nChecksum, CMessageHeader::CHECKSUM_SIZE);
+    } else {
+        uint256 hash = Hash(payload->data(), payload->data() + nMessageSize);
+        memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    }
+
+    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
+
+    size_t nBytesSent = 0;
+    bool fWakeSocket = false;
+    {
+        LOCK(pnode->cs_vSend);
+        bool optimisticSend(pnode->vSendMsg.empty());
+
+        //log total amount of bytes per command
+        pnode->mapSendBytesPerMsgCmd[command] += nTotalSize;
+        pnode->nSendMsgs++;
         pnode->nSendSize += nTotalSize;
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+        TRACE5(net, push_message, pnode->GetId(), command.c_str(), nTotalSize, pnode->nSendSize, pnode->vSendMsg.size());
+        if (pnode->pLinkCrypt) {
+            // Encrypted links stage a copy; the per-peer ciphertext cannot
+            // share bytes with other peers' queues
+            std::vector<unsigned char>& vchPlain = pnode->pLinkCrypt->vchSendPlain;
+            vchPlain.insert(vchPlain.end(), serializedHeader.begin(), serializedHeader.end());
+            vchPlain.insert(vchPlain.end(), payload->begin(), payload->end());
+            if (vchPlain.size() >= LINK_CRYPT_BATCH_TARGET)
+                pnode->FlushLinkCryptSend();
+        } else {
+            pnode->vSendMsg.push_back(CSendBuffer(std::move(serializedHeader)));
+            if (nMessageSize)
+                pnode->vSendMsg.push_back(CSendBuffer(payload));
+        }
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
             nBytesSent = SocketSendData(pnode);
+        fWakeSocket = !pnode->vSendMsg.empty();
     }
     if (nBytesSent)
         RecordBytesSent(nBytesSent);
+    // Data was left queued because the optimistic write could not run or
+    // could not complete; interrupt the socket handler's poll wait so the
+    // socket is picked up for sending now instead of on the next timeout
+    if (fWakeSocket)
+        WakeSocketHandler();
 }
 
 bool CConnman::ForNode(NodeId id, std::function<bool(CNode* pnode)> func)
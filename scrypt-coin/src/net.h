@@ -13,7 +13,7 @@
 #include "bloom.h"
 #include "compat.h"
 #include "hash.h"
-#include "limitedmap.h"
+#include "limitedlrumap.h"
 #include "netaddress.h"
 #include "policy/feerate.h"
 #include "protocol.h"
@@ -22,11 +22,13 @@
 #include "sync.h"
 #include "uint256.h"
 #include "threadinterrupt.h"
+#include "crypto/chacha20poly1305.h"
 #include "crypto/siphash.h"
 
 #include <atomic>
 #include <list>
 #include <deque>
+#include <set>
 #include <stdint.h>
 #include <thread>
 #include <memory>
@@ -86,6 +88,9 @@ static const bool DEFAULT_BLOCKSONLY = false;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** -msghandlerthreads default. Each thread services a disjoint shard of peers,
+ *  so one peer feeding us a large block no longer stalls relay for everyone. */
+static const int DEFAULT_MSGHANDLER_THREADS = 2;
 
 static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 
@@ -120,6 +125,56 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+/** One entry in a peer's send queue: either a buffer the queue owns outright
+ *  (headers and per-peer serializations, the common case) or a reference to an
+ *  immutable buffer shared across peers, such as the wire form cached in a
+ *  mempool entry. Shared buffers must never be handed back to
+ *  CSerializeBufferPool, since the pool reuses and overwrites its buffers. */
+class CSendBuffer
+{
+private:
+    std::vector<unsigned char> vchOwned;
+    std::shared_ptr<const std::vector<unsigned char>> pShared;
+
+public:
+    explicit CSendBuffer(std::vector<unsigned char>&& vchIn) : vchOwned(std::move(vchIn)) {}
+    explicit CSendBuffer(std::shared_ptr<const std::vector<unsigned char>> pSharedIn) : pShared(std::move(pSharedIn)) {}
+
+    const unsigned char* data() const { return pShared ? pShared->data() : vchOwned.data(); }
+    size_t size() const { return pShared ? pShared->size() : vchOwned.size(); }
+    bool IsShared() const { return pShared != nullptr; }
+    //! Surrender the owned buffer for pool recycling; only valid when !IsShared().
+    std::vector<unsigned char> Release() { return std::move(vchOwned); }
+};
+
+/** Minimum capacity a buffer must be expected to reach (or already have) to be
+ *  worth pooling. Small messages allocate and free cheaply; the pool only pays
+ *  off for block-sized payloads. */
+static const size_t MIN_POOLED_BUFFER_SIZE = 128 * 1024;
+/** Maximum number of idle buffers kept in the serialization buffer pool */
+static const size_t MAX_POOLED_BUFFERS = 8;
+/** Largest receive buffer recycled per peer; bigger ones (rare block-sized
+ *  payloads) are freed so idle peers do not pin megabytes of capacity */
+static const size_t MAX_RECYCLED_RECV_BUFFER = 256 * 1024;
+
+/** Pool of reusable serialization buffers for large network messages.
+ *
+ *  CNetMsgMaker acquires a buffer sized from GetSerializeSizeMany before
+ *  serializing, so a 2 MB block message performs at most one allocation — or
+ *  none when a previously released buffer is reused. Buffers are produced on
+ *  the message handler thread and released from the socket thread after the
+ *  bytes hit the wire, so the pool is shared and lock-protected rather than
+ *  per-thread. */
+class CSerializeBufferPool
+{
+public:
+    //! Get a buffer with at least nSizeHint bytes of reserved capacity.
+    //! Hints below MIN_POOLED_BUFFER_SIZE bypass the pool entirely.
+    static std::vector<unsigned char> Acquire(size_t nSizeHint);
+    //! Return a buffer to the pool; small or excess buffers are simply freed.
+    static void Release(std::vector<unsigned char>&& vchBuf);
+};
+
 class NetEventsInterface;
 class CConnman
 {
@@ -147,6 +202,10 @@ public:
         unsigned int nReceiveFloodSize = 0;
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
+        //! Token-bucket send rates in bytes/sec per peer, by connection
+        //! class; 0 = unshaped. Whitelisted peers are never shaped.
+        uint64_t nInboundSendRate = 0;
+        uint64_t nOutboundSendRate = 0;
         std::vector<std::string> vSeedNodes;
         std::vector<CSubNet> vWhitelistedRange;
         std::vector<CService> vBinds, vWhiteBinds;
@@ -166,6 +225,8 @@ public:
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
         nMaxOutboundLimit = connOptions.nMaxOutboundLimit;
+        nInboundSendRate = connOptions.nInboundSendRate;
+        nOutboundSendRate = connOptions.nOutboundSendRate;
         vWhitelistedRange = connOptions.vWhitelistedRange;
     }
 
@@ -176,12 +237,15 @@ public:
     void Interrupt();
     bool GetNetworkActive() const { return fNetworkActive; };
     void SetNetworkActive(bool active);
-    bool OpenNetworkConnection(const CAddress& addrConnect, bool fCountFailure, CSemaphoreGrant *grantOutbound = nullptr, const char *strDest = nullptr, bool fOneShot = false, bool fFeeler = false, bool manual_connection = false);
+    bool OpenNetworkConnection(const CAddress& addrConnect, bool fCountFailure, CSemaphoreGrant *grantOutbound = nullptr, const char *strDest = nullptr, bool fOneShot = false, bool fFeeler = false, bool manual_connection = false, bool block_relay_only = false);
     bool CheckIncomingNonce(uint64_t nonce);
 
     bool ForNode(NodeId id, std::function<bool(CNode* pnode)> func);
 
     void PushMessage(CNode* pnode, CSerializedNetMsg&& msg);
+    //! Queue a message whose payload is an immutable buffer shared with other
+    //! peers (and with the mempool); only the 24-byte header is built per peer.
+    void PushSharedMessage(CNode* pnode, const std::string& command, const std::shared_ptr<const std::vector<unsigned char>>& payload);
 
     template<typename Callable>
     void ForEachNode(Callable&& func)
@@ -257,6 +321,18 @@ public:
     void GetBanned(banmap_t &banmap);
     void SetBanned(const banmap_t &banmap);
 
+    // Persistent peer performance records (peerscores.dat). Updated by
+    // net_processing as blocks and transactions arrive; consulted when
+    // evicting inbound peers and when selecting outbound addresses.
+    //! Record a getdata-to-block delivery, latency in microseconds
+    void RecordBlockDelivery(const CNetAddr& addr, int64_t nLatencyUsec);
+    //! Record a processed transaction; fUseful if it entered the mempool
+    void RecordTxProcessed(const CNetAddr& addr, bool fUseful);
+    //! Record a block download that hit the stall timeout
+    void RecordBlockStall(const CNetAddr& addr);
+    //! Average block delivery latency in microseconds, 0 if no history
+    int64_t GetBlockLatencyScore(const CNetAddr& addr);
+
     // This allows temporarily exceeding nMaxOutbound, with the goal of finding
     // a peer that is better than all our current peers.
     void SetTryNewOutboundPeer(bool flag);
@@ -305,6 +381,10 @@ public:
     uint64_t GetTotalBytesRecv();
     uint64_t GetTotalBytesSent();
 
+    //! Bytes currently buffered for all peers (queued send messages plus
+    //! received messages waiting for the processing thread)
+    size_t GetTotalBufferedBytes();
+
     void SetBestHeight(int height);
     int GetBestHeight() const;
 
@@ -314,6 +394,12 @@ public:
     unsigned int GetReceiveFloodSize() const;
 
     void WakeMessageHandler();
+    /** Wake only the handler thread servicing the given peer. */
+    void WakeMessageHandler(NodeId nodeid);
+    /** Interrupt the socket handler's poll wait so freshly queued send data
+     *  is flushed immediately instead of after the poll timeout. No-op on
+     *  platforms without a wakeup pipe. */
+    void WakeSocketHandler();
 private:
     struct ListenSocket {
         SOCKET socket;
@@ -329,8 +415,10 @@ private:
     void AddOneShot(const std::string& strDest);
     void ProcessOneShot();
     void ThreadOpenConnections();
-    void ThreadMessageHandler();
+    void ThreadMessageHandler(int nShard);
     void AcceptConnection(const ListenSocket& hListenSocket);
+    bool GenerateSelectSet(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+    void SocketEvents(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
 
@@ -359,6 +447,7 @@ private:
     void DumpAddresses();
     void DumpData();
     void DumpBanlist();
+    void DumpPeerScores();
 
     // Network stats
     void RecordBytesRecv(uint64_t bytes);
@@ -386,13 +475,21 @@ private:
     unsigned int nSendBufferMaxSize;
     unsigned int nReceiveFloodSize;
 
+    /** Per-peer send rates in bytes/sec by connection class; 0 = unshaped */
+    uint64_t nInboundSendRate;
+    uint64_t nOutboundSendRate;
+
     std::vector<ListenSocket> vhListenSocket;
     std::atomic<bool> fNetworkActive;
     banmap_t setBanned;
     CCriticalSection cs_setBanned;
     bool setBannedIsDirty;
+    peerscoremap_t mapPeerScores;
+    CCriticalSection cs_mapPeerScores;
     bool fAddressesInitialized;
     CAddrMan addrman;
+    //! addrman change count at the last successful peers.dat flush
+    int64_t nLastAddrmanChanges;
     std::deque<std::string> vOneShots;
     CCriticalSection cs_vOneShots;
     std::vector<std::string> vAddedNodes;
@@ -421,20 +518,35 @@ private:
     /** SipHasher seeds for deterministic randomness */
     const uint64_t nSeed0, nSeed1;
 
-    /** flag for waking the message processor. */
-    bool fMsgProcWake;
+    /** Wake state for one message handler thread. Each peer is serviced by
+     *  exactly one thread (chosen by node id), so its messages keep being
+     *  processed in order. */
+    struct CMsgHandlerWake
+    {
+        bool fWake;
+        std::condition_variable cond;
+        std::mutex mutex;
+        CMsgHandlerWake() : fWake(false) {}
+    };
+    std::vector<std::unique_ptr<CMsgHandlerWake> > vMsgProcWake;
+    int nMsgProcThreads;
 
-    std::condition_variable condMsgProc;
-    std::mutex mutexMsgProc;
     std::atomic<bool> flagInterruptMsgProc;
 
     CThreadInterrupt interruptNet;
 
+#ifndef WIN32
+    /** Self-pipe watched by the socket handler alongside the peer sockets;
+     *  WakeSocketHandler() writes one byte to interrupt the poll wait.
+     *  [0] = read end, [1] = write end, -1 when unavailable. */
+    int fdSocketWakeup[2];
+#endif
+
     std::thread threadDNSAddressSeed;
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
-    std::thread threadMessageHandler;
+    std::vector<std::thread> vThreadsMessageHandler;
 
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of nMaxOutbound
@@ -445,7 +557,7 @@ private:
 };
 extern std::unique_ptr<CConnman> g_connman;
 void Discover(boost::thread_group& threadGroup);
-void MapPort(bool fUseUPnP);
+void MapPort(bool fUseUPnP, CScheduler* scheduler = nullptr);
 unsigned short GetListenPort();
 bool BindListenPort(const CService &bindAddr, std::string& strError, bool fWhitelisted = false);
 
@@ -506,7 +618,25 @@ extern bool fDiscover;
 extern bool fListen;
 extern bool fRelayTxes;
 
-extern limitedmap<uint256, int64_t> mapAlreadyAskedFor;
+/** Salted hasher for mapAlreadyAskedFor; inv hashes are chosen by remote
+ *  peers, so probe positions must not be predictable. */
+class CAskedForHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    CAskedForHasher()
+     : k0(GetRand(std::numeric_limits<uint64_t>::max())),
+       k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+    size_t operator()(const uint256& hash) const {
+        return SipHashUint256(k0, k1, hash);
+    }
+};
+
+extern limitedlrumap<uint256, int64_t, CAskedForHasher> mapAlreadyAskedFor;
 
 /** Subversion as sent to the P2P network in `version` messages */
 extern std::string strSubVersion;
@@ -537,10 +667,14 @@ public:
     bool m_manual_connection;
     int nStartingHeight;
     uint64_t nSendBytes;
+    uint64_t nSendMsgs;
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     uint64_t nRecvBytes;
+    uint64_t nRecvMsgs;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
     bool fWhitelisted;
+    //! Send rate cap applied to this peer in bytes/sec; 0 = unshaped
+    uint64_t nSendRate;
     double dPingTime;
     double dPingWait;
     double dMinPing;
@@ -559,6 +693,11 @@ private:
 public:
     bool in_data;                   // parsing header (false) or data (true)
 
+    // The peer negotiated NODE_FAST_CHECKSUM when this message started, so
+    // the incremental SHA256d is skipped; the checksum is verified with
+    // FastMessageChecksum over vRecv instead (see ProcessMessages)
+    bool fFastChecksum;
+
     CDataStream hdrbuf;             // partially received header
     CMessageHeader hdr;             // complete header
     unsigned int nHdrPos;
@@ -571,6 +710,7 @@ public:
     CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), vRecv(nTypeIn, nVersionIn) {
         hdrbuf.resize(24);
         in_data = false;
+        fFastChecksum = false;
         nHdrPos = 0;
         nDataPos = 0;
         nTime = 0;
@@ -593,6 +733,57 @@ public:
 
     int readHeader(const char *pch, unsigned int nBytes);
     int readData(const char *pch, unsigned int nBytes);
+
+    //! Account for nBytes received straight into vRecv at nDataPos by the
+    //! caller, keeping the running message hash up to date.
+    void MarkBytesWritten(unsigned int nBytes)
+    {
+        if (!fFastChecksum)
+            hasher.Write((const unsigned char*)&vRecv[nDataPos], nBytes);
+        nDataPos += nBytes;
+    }
+};
+
+/** Per-connection state of the opt-in encrypted link transport
+ * (-linkencrypt / -linkencryptkey), for node-to-node links we operate on
+ * both ends of.
+ *
+ * The connection starts with a plaintext hello exchange (a magic prefix and
+ * a 32-byte nonce from each side); per-direction ChaCha20-Poly1305 keys are
+ * derived from the pre-shared key and both nonces. From then on the byte
+ * stream is carried in frames of [4-byte LE ciphertext length | ciphertext |
+ * 16-byte tag], each numbered by a per-direction sequence. One frame holds
+ * the whole batch of messages queued between socket flushes, so the AEAD
+ * cost is paid per batch rather than per message. Everything inside the
+ * frames is the unchanged p2p protocol.
+ */
+struct LinkCryptState
+{
+    enum Phase {
+        SNIFFING,    //!< inbound: first bytes decide encrypted vs plaintext
+        AWAIT_HELLO, //!< hello sent (outbound), waiting for the peer's
+        ON,          //!< keys derived; all traffic framed
+    };
+
+    Phase phase;
+    bool fInitiator;
+    unsigned char vchLocalNonce[32];
+
+    //! Send direction; guarded by cs_vSend
+    ChaCha20Poly1305 sendCipher;
+    uint64_t nSendSeq;
+    //! Messages staged since the last flush, sealed as one frame; cs_vSend
+    std::vector<unsigned char> vchSendPlain;
+
+    //! Receive direction; socket handler thread only
+    ChaCha20Poly1305 recvCipher;
+    uint64_t nRecvSeq;
+    //! Partially received hello or frame bytes
+    std::vector<unsigned char> vchRecvFrame;
+
+    LinkCryptState(bool fInitiatorIn) :
+        phase(fInitiatorIn ? AWAIT_HELLO : SNIFFING), fInitiator(fInitiatorIn),
+        nSendSeq(0), nRecvSeq(0) {}
 };
 
 /** Information about a peer */
@@ -607,7 +798,11 @@ public:
     size_t nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<std::vector<unsigned char>> vSendMsg;
+    uint64_t nSendMsgs; // messages queued for sending; guarded by cs_vSend
+    // Token bucket for per-class traffic shaping; guarded by cs_vSend
+    double dSendTokens;
+    int64_t nLastSendTokens; // last refill time (us); 0 until first shaped send
+    std::deque<CSendBuffer> vSendMsg;
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
@@ -620,6 +815,7 @@ public:
 
     std::deque<CInv> vRecvGetData;
     uint64_t nRecvBytes;
+    uint64_t nRecvMsgs; // complete messages received; guarded by cs_vRecv
     std::atomic<int> nRecvVersion;
 
     std::atomic<int64_t> nLastSend;
@@ -640,10 +836,19 @@ public:
     bool fWhitelisted; // This peer can bypass DoS banning.
     bool fFeeler; // If true this node is being used as a short lived feeler.
     bool fOneShot;
+    // Outbound connection kept for block propagation only: we advertise
+    // relay=false in our version and exchange no tx invs or addr gossip.
+    bool fBlockRelayOnly;
     bool m_manual_connection;
     bool fClient;
     const bool fInbound;
     std::atomic_bool fSuccessfullyConnected;
+    // Both sides advertise NODE_FAST_CHECKSUM and the peer is whitelisted;
+    // set on verack, switches send and receive to the cheap checksum
+    std::atomic_bool fFastChecksum;
+    // Encrypted link transport state, or null for an ordinary plaintext
+    // connection; created at connect/accept time, see StartLinkCrypt
+    std::unique_ptr<LinkCryptState> pLinkCrypt;
     std::atomic_bool fDisconnect;
     // We use fRelayTxes for two purposes -
     // a) it allows us to not relay tx invs before receiving the peer's version message
@@ -678,9 +883,9 @@ public:
 
     // inventory based relay
     CRollingBloomFilter filterInventoryKnown;
-    // Set of transaction ids we still have to announce.
-    // They are sorted by the mempool before relay, so the order is not important.
-    std::set<uint256> setInventoryTxToSend;
+    // Sequence number of the next entry in the shared transaction announcement
+    // batch (see net_processing) to consider for this peer, protected by cs_inventory
+    uint64_t nNextTxAnnouncementSeq;
     // List of block ids we still have announce.
     // There is no final sorting before sending, as they are always sent immediately
     // and in the order requested.
@@ -735,6 +940,19 @@ private:
     int nSendVersion;
     std::list<CNetMessage> vRecvMsg;  // Used only by SocketHandler thread
 
+    //! Feed bytes of the cleartext p2p stream to the message parser; the
+    //! whole of ReceiveMsgBytes on a plaintext connection
+    bool ReceivePlainMsgBytes(const char *pch, unsigned int nBytes, bool& complete);
+    //! Handshake and frame layer of the encrypted link transport; socket
+    //! handler thread only
+    bool ReceiveLinkCryptBytes(const char *pch, unsigned int nBytes, bool& complete);
+    //! Derive both directions' keys once the peer's hello nonce is known
+    void DeriveLinkCryptKeys(const unsigned char* pchRemoteNonce);
+    // Spare receive buffer recycled between this peer's messages, so
+    // steady-state deserialization reuses one allocation instead of
+    // growing a fresh vector per message; guarded by cs_vRecv
+    CSerializeData vchRecvBufPool;
+
     mutable CCriticalSection cs_addrName;
     std::string addrName;
 
@@ -762,6 +980,25 @@ public:
     }
 
     bool ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete);
+    /** Create the encrypted-link state for this connection. Must run before
+     *  the node is handed to other threads; as the initiator the plaintext
+     *  hello must additionally be queued by the caller. */
+    void StartLinkCrypt(bool fInitiator);
+    /** Seal the staged plaintext batch into one frame on vSendMsg. Requires
+     *  cs_vSend; a no-op until the handshake has completed. */
+    void FlushLinkCryptSend();
+    /** Hand out a pointer into the current message's receive buffer so large
+     *  payloads can be recv()ed straight into it, skipping the bounce buffer.
+     *  Returns false when the next bytes are a header or a small remainder,
+     *  in which case ReceiveMsgBytes must be used instead. */
+    bool GetDirectRecvSpace(char*& pchData, unsigned int& nSpace);
+    /** Account for nBytes written by the caller into the space returned by
+     *  GetDirectRecvSpace. */
+    bool DirectRecvBytesWritten(unsigned int nBytes, bool& complete);
+    /** Hand a processed message's backing buffer back from the message
+     *  handler thread, so the socket thread can reuse its capacity for this
+     *  peer's next message. */
+    void ReturnRecvBuffer(CNetMessage& msg);
 
     void SetRecvVersion(int nVersionIn)
     {
@@ -821,12 +1058,10 @@ public:
 
     void PushInventory(const CInv& inv)
     {
+        // Transaction announcements are not queued per-peer; they flow through
+        // the shared announcement batch in net_processing (RelayTransaction)
         LOCK(cs_inventory);
-        if (inv.type == MSG_TX) {
-            if (!filterInventoryKnown.contains(inv.hash)) {
-                setInventoryTxToSend.insert(inv.hash);
-            }
-        } else if (inv.type == MSG_BLOCK) {
+        if (inv.type == MSG_BLOCK) {
             vInventoryBlockToSend.push_back(inv.hash);
         }
     }
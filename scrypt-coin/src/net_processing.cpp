@@ -9,8 +9,11 @@
 #include "arith_uint256.h"
 #include "blockencodings.h"
 #include "chainparams.h"
+#include "checkpoints.h"
 #include "checkqueue.h"
 #include "consensus/validation.h"
+#include "crypto/siphash.h"
+#include "cuckoocache.h"
 #include "hash.h"
 #include "init.h"
 #include "validation.h"
@@ -38,6 +41,7 @@
 #include "rpc/mining.h"
 
 #include <array>
+#include <deque>
 
 #if defined(NDEBUG)
 # error "Bitcoin cannot be compiled without assertions."
@@ -59,9 +63,28 @@ unsigned int HEADER_BLOCK_DIFFERENCES_TRIGGER_GETBLOCKS = 10000;
 int64_t HEADERS_DOWNLOAD_TIMEOUT_BASE = 15 * 60 * 1000000; // 15 minutes
 int64_t BLOCK_DOWNLOAD_TIMEOUT_BASE = HEADERS_DOWNLOAD_TIMEOUT_BASE; // 15 minutes
 
+/** Number of recent block delivery times kept per peer for statistical stall detection */
+static const size_t BLOCK_DELIVERY_SAMPLES = 32;
+/** Delivery samples needed before statistical stall detection applies to a peer */
+static const size_t BLOCK_DELIVERY_MIN_SAMPLES = 8;
+/** A peer is considered stalling mid-flight when its oldest in-flight block has
+ *  been outstanding longer than this multiple of the peer's own
+ *  90th-percentile delivery time */
+static const int64_t BLOCK_DELIVERY_STALL_FACTOR = 4;
+/** Floor for the statistical stall deadline (microseconds), so fast peers are
+ *  not flagged over scheduling jitter */
+static const int64_t BLOCK_DELIVERY_STALL_FLOOR = 5 * 1000000;
+
+/** Largest number of outpoints carried by one "hotset" message */
+static const size_t MAX_HOTSET_ENTRIES = 25000;
+/** Seconds between hot-set requests a standby node sends to a paired peer */
+static const int64_t HOTSET_REQUEST_INTERVAL = 60;
+
 static CCheckQueue<CHashCalculation> hashCalculationQueue(200);
 boost::mutex mapHashmutex;
-std::map<uint256, uint256> mapHash;
+// Salted hashing: the keys are SHA256 hashes of peer-supplied headers, so an
+// attacker must not be able to aim them at one bucket.
+std::unordered_map<uint256, uint256, SaltedTxidHasher> mapHash;
 int nHashCalcThreads = 0;
 const unsigned int nPoWTargetSpacing = nStakeTargetSpacing;
 
@@ -90,7 +113,7 @@ bool CHashCalculation::operator()()
 
     {
         boost::mutex::scoped_lock lock(mapHashmutex);
-        std::map<uint256, uint256>::iterator mi = mapHash.find(blockSHA256Hash);
+        auto mi = mapHash.find(blockSHA256Hash);
         if (mi != mapHash.end())
         {
             pBlock->blockHash = (*mi).second;
@@ -125,24 +148,253 @@ struct IteratorComparator
     }
 };
 
-struct COrphanTx {
-    // When modifying, adapt the copy of this definition in tests/DoS_tests.
-    CTransactionRef tx;
-    NodeId fromPeer;
-    int64_t nTimeExpire;
+void AddToCompactExtraTransactions(const CTransactionRef& tx);
+
+/**
+ * Pool of transactions whose inputs we have not yet seen. Bounded three
+ * ways: a global entry count, a global serialized-byte budget, and a
+ * per-peer quota so a single flooding peer cannot evict everyone else's
+ * orphans. The missing-parent index (outpoint -> waiting orphans) lets a
+ * parent's arrival collect every eligible child in one pass instead of
+ * rescanning the pool. Protected by cs_main.
+ */
+class COrphanTxPool
+{
+private:
+    struct COrphanTx {
+        CTransactionRef tx;
+        NodeId fromPeer;
+        int64_t nTimeExpire;
+        size_t nTxSize;
+    };
+    std::map<uint256, COrphanTx> mapOrphans;
+    std::map<COutPoint, std::set<std::map<uint256, COrphanTx>::iterator, IteratorComparator>> mapByPrev;
+    std::map<NodeId, unsigned int> mapPeerCount;
+    size_t nTotalTxSize = 0;
+    int64_t nNextSweep = 0;
+
+public:
+    bool HaveTx(const uint256& hash) const { return mapOrphans.count(hash) != 0; }
+    size_t size() const { return mapOrphans.size(); }
+    size_t TotalTxBytes() const { return nTotalTxSize; }
+
+    bool AddTx(const CTransactionRef& tx, NodeId peer, unsigned int nMaxPerPeer)
+    {
+        const uint256& hash = tx->GetHash();
+        if (mapOrphans.count(hash))
+            return false;
+
+        // Ignore big transactions, to avoid a
+        // send-big-orphans memory exhaustion attack. If a peer has a legitimate
+        // large transaction with a missing parent then we assume
+        // it will rebroadcast it later, after the parent transaction(s)
+        // have been mined or received.
+        // 100 orphans, each of which is at most 99,999 bytes big is
+        // at most 10 megabytes of orphans and somewhat more byprev index (in the worst case):
+        size_t nSize = ::GetSerializeSize(*tx, SER_NETWORK, CTransaction::CURRENT_VERSION);
+        if (nSize >= MAX_STANDARD_TX_SIZE)
+        {
+            LogPrint(BCLog::MEMPOOL, "ignoring large orphan tx (size: %u, hash: %s)\n", nSize, hash.ToString());
+            return false;
+        }
+
+        // Per-peer quota: a peer that already has its share of the pool does
+        // not get to displace anyone else's orphans.
+        if (mapPeerCount[peer] >= nMaxPerPeer)
+        {
+            LogPrint(BCLog::MEMPOOL, "ignoring orphan tx %s, peer=%d over quota\n", hash.ToString(), peer);
+            return false;
+        }
+
+        auto ret = mapOrphans.emplace(hash, COrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, nSize});
+        assert(ret.second);
+        for (const CTxIn& txin : tx->vin) {
+            mapByPrev[txin.prevout].insert(ret.first);
+        }
+        mapPeerCount[peer]++;
+        nTotalTxSize += nSize;
+
+        AddToCompactExtraTransactions(tx);
+
+        LogPrint(BCLog::MEMPOOL, "stored orphan tx %s (mapsz %u outsz %u)\n", hash.ToString(),
+                 mapOrphans.size(), mapByPrev.size());
+        return true;
+    }
+
+    int EraseTx(const uint256& hash)
+    {
+        std::map<uint256, COrphanTx>::iterator it = mapOrphans.find(hash);
+        if (it == mapOrphans.end())
+            return 0;
+        for (const CTxIn& txin : it->second.tx->vin)
+        {
+            auto itPrev = mapByPrev.find(txin.prevout);
+            if (itPrev == mapByPrev.end())
+                continue;
+            itPrev->second.erase(it);
+            if (itPrev->second.empty())
+                mapByPrev.erase(itPrev);
+        }
+        auto itPeer = mapPeerCount.find(it->second.fromPeer);
+        if (itPeer != mapPeerCount.end() && --itPeer->second == 0)
+            mapPeerCount.erase(itPeer);
+        nTotalTxSize -= it->second.nTxSize;
+        mapOrphans.erase(it);
+        return 1;
+    }
+
+    void EraseForPeer(NodeId peer)
+    {
+        int nErased = 0;
+        std::map<uint256, COrphanTx>::iterator iter = mapOrphans.begin();
+        while (iter != mapOrphans.end())
+        {
+            std::map<uint256, COrphanTx>::iterator maybeErase = iter++; // increment to avoid iterator becoming invalid
+            if (maybeErase->second.fromPeer == peer)
+            {
+                nErased += EraseTx(maybeErase->second.tx->GetHash());
+            }
+        }
+        if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx from peer=%d\n", nErased, peer);
+    }
+
+    /** Erase orphans spending outputs that a newly connected block spent or created. */
+    void EraseForBlock(const CBlock& block)
+    {
+        std::vector<uint256> vOrphanErase;
+        for (const CTransaction& tx : block.vtx) {
+            for (const auto& txin : tx.vin) {
+                auto itByPrev = mapByPrev.find(txin.prevout);
+                if (itByPrev == mapByPrev.end()) continue;
+                for (auto mi = itByPrev->second.begin(); mi != itByPrev->second.end(); ++mi) {
+                    vOrphanErase.push_back((*mi)->second.tx->GetHash());
+                }
+            }
+        }
+        if (vOrphanErase.size()) {
+            int nErased = 0;
+            for (uint256& orphanHash : vOrphanErase) {
+                nErased += EraseTx(orphanHash);
+            }
+            LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx included or conflicted by block\n", nErased);
+        }
+    }
+
+    unsigned int LimitSize(unsigned int nMaxOrphans, size_t nMaxBytes)
+    {
+        unsigned int nEvicted = 0;
+        int64_t nNow = GetTime();
+        if (nNextSweep <= nNow) {
+            // Sweep out expired orphan pool entries:
+            int nErased = 0;
+            int64_t nMinExpTime = nNow + ORPHAN_TX_EXPIRE_TIME - ORPHAN_TX_EXPIRE_INTERVAL;
+            std::map<uint256, COrphanTx>::iterator iter = mapOrphans.begin();
+            while (iter != mapOrphans.end())
+            {
+                std::map<uint256, COrphanTx>::iterator maybeErase = iter++;
+                if (maybeErase->second.nTimeExpire <= nNow) {
+                    nErased += EraseTx(maybeErase->second.tx->GetHash());
+                } else {
+                    nMinExpTime = std::min(maybeErase->second.nTimeExpire, nMinExpTime);
+                }
+            }
+            // Sweep again 5 minutes after the next entry that expires in order to batch the linear scan.
+            nNextSweep = nMinExpTime + ORPHAN_TX_EXPIRE_INTERVAL;
+            if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx due to expiration\n", nErased);
+        }
+        while (mapOrphans.size() > nMaxOrphans || nTotalTxSize > nMaxBytes)
+        {
+            // Evict a random orphan:
+            uint256 randomhash = GetRandHash();
+            std::map<uint256, COrphanTx>::iterator it = mapOrphans.lower_bound(randomhash);
+            if (it == mapOrphans.end())
+                it = mapOrphans.begin();
+            EraseTx(it->first);
+            ++nEvicted;
+        }
+        return nEvicted;
+    }
+
+    void Clear()
+    {
+        mapOrphans.clear();
+        mapByPrev.clear();
+        mapPeerCount.clear();
+        nTotalTxSize = 0;
+    }
+
+    /** Collect every orphan waiting on an output of hashParent, in one pass
+     * over the index. The entries stay in the pool; the caller erases the
+     * ones it accepts or gives up on. */
+    void GetCandidatesFor(const uint256& hashParent, size_t nOutputs, std::vector<std::pair<CTransactionRef, NodeId>>& vCandidates) const
+    {
+        std::set<uint256> setSeen;
+        for (unsigned int i = 0; i < nOutputs; i++) {
+            auto itByPrev = mapByPrev.find(COutPoint(hashParent, i));
+            if (itByPrev == mapByPrev.end())
+                continue;
+            for (const auto& mi : itByPrev->second) {
+                if (setSeen.insert(mi->second.tx->GetHash()).second)
+                    vCandidates.emplace_back(mi->second.tx, mi->second.fromPeer);
+            }
+        }
+    }
 };
-std::map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(cs_main);
-std::map<COutPoint, std::set<std::map<uint256, COrphanTx>::iterator, IteratorComparator>> mapOrphanTransactionsByPrev GUARDED_BY(cs_main);
-void EraseOrphansFor(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+COrphanTxPool orphanPool GUARDED_BY(cs_main);
 
-// TODO: Support this in the future (it relates to MSG_CMPCT_BLOCK)
-//static size_t vExtraTxnForCompactIt = 0;
-//static std::vector<std::pair<uint256, CTransactionRef>> vExtraTxnForCompact GUARDED_BY(cs_main);
+static size_t vExtraTxnForCompactIt = 0;
+static std::vector<std::pair<uint256, CTransactionRef>> vExtraTxnForCompact GUARDED_BY(cs_main);
 
 static const uint64_t RANDOMIZER_ID_ADDRESS_RELAY = 0x3cac0035b5866b90ULL; // SHA256("main address relay")[0:8]
 
 // Internal stuff
 namespace {
+    /**
+     * Cuckoo filter for recently rejected txids, built on
+     * CuckooCache::cache: instead of full txids the table stores 64-bit
+     * salted SipHash fingerprints, so 120k entries cost under 1 MB and a
+     * containment check probes at most eight cache lines. The salt keys
+     * make both fingerprints and bucket choices unpredictable to peers,
+     * and the cache's epoch logic ages out old rejects much like the
+     * rolling bloom this replaces.
+     */
+    class CRecentRejectsFilter
+    {
+    private:
+        class FingerprintHasher
+        {
+        public:
+            template <uint8_t hash_select>
+            uint32_t operator()(const uint64_t& fingerprint) const
+            {
+                static_assert(hash_select < 8, "FingerprintHasher only has 8 hashes available.");
+                // The fingerprint is already a salted SipHash; a cheap odd
+                // multiplicative remix per probe is enough to spread it
+                return (uint32_t)((fingerprint * (0x9e3779b97f4a7c15ULL + 2 * hash_select)) >> 32);
+            }
+        };
+
+        CuckooCache::cache<uint64_t, FingerprintHasher> filter;
+        uint64_t k0, k1;
+
+        uint64_t Fingerprint(const uint256& txid) const
+        {
+            return SipHashUint256(k0, k1, txid);
+        }
+
+    public:
+        explicit CRecentRejectsFilter(uint32_t nElements)
+        {
+            filter.setup(nElements);
+            k0 = GetRand(std::numeric_limits<uint64_t>::max());
+            k1 = GetRand(std::numeric_limits<uint64_t>::max());
+        }
+
+        void insert(const uint256& txid) { filter.insert(Fingerprint(txid)); }
+        bool contains(const uint256& txid) const { return filter.contains(Fingerprint(txid), false); }
+        void reset() { filter.clear(); }
+    };
+
     /** Number of nodes with fSyncStarted. */
     int nSyncStarted = 0;
 
@@ -153,7 +405,7 @@ namespace {
      * Set mapBlockSource[hash].second to false if the node should not be
      * punished if the block is invalid.
      */
-    std::map<uint256, std::pair<NodeId, bool>> mapBlockSource;
+    std::unordered_map<uint256, std::pair<NodeId, bool>, SaltedTxidHasher> mapBlockSource;
 
     /**
      * Filter for transactions that were recently rejected by
@@ -169,13 +421,13 @@ namespace {
      * 1000/sec if we have fast peers, so we pick 120,000 to give our peers a
      * two minute window to send invs to us.
      *
-     * Decreasing the false positive rate is fairly cheap, so we pick one in a
-     * million to make it highly unlikely for users to have issues with this
-     * filter.
+     * Stored as 64-bit salted fingerprints in a cuckoo filter, so false
+     * positives are vanishingly rare while lookups touch at most eight
+     * cache lines instead of walking rolling bloom generations.
      *
-     * Memory used: 1.3 MB
+     * Memory used: ~1 MB
      */
-    std::unique_ptr<CRollingBloomFilter> recentRejects;
+    std::unique_ptr<CRecentRejectsFilter> recentRejects;
     uint256 hashRecentRejectsChainTip;
 
     /** Blocks that are in flight, and that are in the queue to be downloaded. Protected by cs_main. */
@@ -183,9 +435,11 @@ namespace {
         uint256 hash;
         const CBlockIndex* pindex;                               //!< Optional.
         bool fValidatedHeaders;                                  //!< Whether this block has validated headers at the time of request.
+        int64_t nTimeRequested;                                  //!< When the getdata went out, for the peer delivery-latency record
         std::unique_ptr<PartiallyDownloadedBlock> partialBlock;  //!< Optional, used for CMPCTBLOCK downloads
     };
-    std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> > mapBlocksInFlight;
+    typedef std::unordered_map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator>, SaltedTxidHasher> MapBlocksInFlight;
+    MapBlocksInFlight mapBlocksInFlight;
 
     /** Stack of nodes which we have set to announce using compact blocks */
     std::list<NodeId> lNodesAnnouncingHeaderAndIDs;
@@ -202,11 +456,41 @@ namespace {
     /** When our tip was last updated. */
     int64_t g_last_tip_update = 0;
 
-    /** Relay map, protected by cs_main. */
-    typedef std::map<uint256, CTransactionRef> MapRelay;
+    /** Relay map, protected by cs_main. Salted hashing: the keys are txids
+     *  chosen by whoever broadcast the transaction. */
+    typedef std::unordered_map<uint256, CTransactionRef, SaltedTxidHasher> MapRelay;
     MapRelay mapRelay;
-    /** Expiration-time ordered list of (expire time, relay map entry) pairs, protected by cs_main). */
-    std::deque<std::pair<int64_t, MapRelay::iterator>> vRelayExpiration;
+    /** Expiration-time ordered list of (expire time, txid) pairs, protected by
+     *  cs_main. Keyed by txid rather than map iterator because unordered_map
+     *  iterators do not survive a rehash. */
+    std::deque<std::pair<int64_t, uint256>> vRelayExpiration;
+
+    /** A single entry of the shared transaction announcement batch. The fee
+     *  rate and transaction reference are captured once at relay time so that
+     *  per-peer fan-out in SendMessages needs no mempool lookups. */
+    struct CTxAnnouncement {
+        uint64_t nSequence;
+        int64_t nTimeExpire;
+        uint256 hash;
+        CTransactionRef tx;
+        CAmount nFeePerK;
+        /** Matchable elements for bloom-filter peers, extracted lazily by the
+         *  first such peer to drain this entry and shared by the rest, so a
+         *  transaction's scripts are parsed once however many SPV peers are
+         *  connected. Null until a peer with a loaded filter needs it. */
+        std::shared_ptr<const CTxBloomElements> elements;
+    };
+    CCriticalSection cs_txAnnouncements;
+    /** Shared announcement batch: RelayTransaction() appends each transaction
+     *  here once, tagged with a monotonic sequence number. Every peer keeps a
+     *  cursor (CNode::nNextTxAnnouncementSeq) into this queue and drains the
+     *  tail at its trickle interval, applying only its own cheap filter
+     *  checks. Ordered by nSequence, protected by cs_txAnnouncements. */
+    std::deque<CTxAnnouncement> vTxAnnouncements;
+    uint64_t nTxAnnouncementSequence = 0;
+    /** How long announcements are retained for slow peers, in microseconds;
+     *  matches the mapRelay retention. */
+    static const int64_t TX_ANNOUNCEMENT_EXPIRY = 15 * 60 * 1000000;
 } // namespace
 
 namespace {
@@ -254,6 +538,10 @@ struct CNodeState {
     int64_t nLastTimeSendingGetBlocks;
     //! Since when we're stalling block download progress (in microseconds), or 0.
     int64_t nStallingSince;
+    //! Recent block delivery latencies (microseconds, oldest first), capped at BLOCK_DELIVERY_SAMPLES.
+    std::deque<int64_t> dqBlockDeliveryTimes;
+    //! Blocks taken away from this peer mid-flight for stalling; never re-request these from it.
+    std::set<uint256> setReassignedBlocks;
     std::list<QueuedBlock> vBlocksInFlight;
     //! When the first entry in vBlocksInFlight started downloading. Don't care when vBlocksInFlight is empty.
     int64_t nDownloadingSince;
@@ -269,6 +557,8 @@ struct CNodeState {
       * but is used as a flag to "lock in" the version of compact blocks (fWantsCmpctWitness) we send.
       */
     bool fProvidesHeaderAndIDs;
+    //! Whether this peer wants new block announcements sent as cmpctblocks (BIP152 high-bandwidth mode).
+    bool fPreferHeaderAndIDs;
     //! Whether this peer wants witnesses in cmpctblocks/blocktxns
     bool fWantsCmpctWitness;
     /**
@@ -307,6 +597,11 @@ struct CNodeState {
     //! Time of last new block announcement
     int64_t m_last_block_announcement;
 
+    //! Time of our last "gethotset" to this peer (-standby mode)
+    int64_t m_last_hotset_request;
+    //! Whether we already asked this peer for its full mempool (-standby mode)
+    bool m_mempool_requested;
+
     CNodeState(CAddress addrIn, std::string addrNameIn) : address(addrIn), name(addrNameIn) {
         fCurrentlyConnected = false;
         nMisbehavior = 0;
@@ -326,9 +621,12 @@ struct CNodeState {
         fPreferredDownload = false;
         fPreferHeaders = false;
         fProvidesHeaderAndIDs = false;
+        fPreferHeaderAndIDs = false;
         fSupportsDesiredCmpctVersion = false;
         m_chain_sync = { 0, nullptr, false, false };
         m_last_block_announcement = 0;
+        m_last_hotset_request = 0;
+        m_mempool_requested = false;
     }
 };
 
@@ -365,8 +663,10 @@ void PushNodeVersion(CNode *pnode, CConnman* connman, int64_t nTime)
     CAddress addrYou = (addr.IsRoutable() && !IsProxy(addr) ? addr : CAddress(CService(), addr.nServices));
     CAddress addrMe = CAddress(CService(), nLocalNodeServices);
 
+    // On block-relay-only links we advertise relay=false so the peer
+    // never sends us tx invs
     connman->PushMessage(pnode, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::VERSION, PROTOCOL_VERSION, (uint64_t)nLocalNodeServices, nTime, addrYou, addrMe,
-            nonce, strSubVersion, nNodeStartingHeight, ::fRelayTxes));
+            nonce, strSubVersion, nNodeStartingHeight, ::fRelayTxes && !pnode->fBlockRelayOnly));
 
     if (fLogIPs) {
         LogPrint(BCLog::NET, "send version message: version %d, blocks=%d, us=%s, them=%s, peer=%d\n", PROTOCOL_VERSION, nNodeStartingHeight, addrMe.ToString(), addrYou.ToString(), nodeid);
@@ -379,7 +679,7 @@ void PushNodeVersion(CNode *pnode, CConnman* connman, int64_t nTime)
 // Returns a bool indicating whether we requested this block.
 // Also used if a block was /not/ received and timed out or started with another peer
 bool MarkBlockAsReceived(const uint256& hash) {
-    std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
+    MapBlocksInFlight::iterator itInFlight = mapBlocksInFlight.find(hash);
     if (itInFlight != mapBlocksInFlight.end()) {
         CNodeState *state = State(itInFlight->second.first);
         state->nBlocksInFlightValidHeaders -= itInFlight->second.second->fValidatedHeaders;
@@ -400,6 +700,43 @@ bool MarkBlockAsReceived(const uint256& hash) {
     return false;
 }
 
+// Requires cs_main.
+// Returns when we requested the given block from the given peer, or 0 if it
+// is not in flight from that peer.
+static int64_t GetBlockRequestTime(const uint256& hash, NodeId nodeid) {
+    MapBlocksInFlight::iterator itInFlight = mapBlocksInFlight.find(hash);
+    if (itInFlight != mapBlocksInFlight.end() && itInFlight->second.first == nodeid) {
+        return itInFlight->second.second->nTimeRequested;
+    }
+    return 0;
+}
+
+// Requires cs_main.
+// Record how long a block delivery from the given peer took, keeping a
+// rolling window the stall detector compares new requests against.
+static void RecordBlockDeliverySample(NodeId nodeid, int64_t nLatencyUsec) {
+    CNodeState *state = State(nodeid);
+    if (state == nullptr)
+        return;
+    state->dqBlockDeliveryTimes.push_back(nLatencyUsec);
+    while (state->dqBlockDeliveryTimes.size() > BLOCK_DELIVERY_SAMPLES)
+        state->dqBlockDeliveryTimes.pop_front();
+}
+
+// Requires cs_main.
+// 90th percentile of the peer's recent block delivery times, or 0 when we
+// don't have enough samples yet to judge it against its own history.
+static int64_t GetBlockDeliveryP90(const CNodeState& state) {
+    if (state.dqBlockDeliveryTimes.size() < BLOCK_DELIVERY_MIN_SAMPLES)
+        return 0;
+    std::vector<int64_t> vTimes(state.dqBlockDeliveryTimes.begin(), state.dqBlockDeliveryTimes.end());
+    size_t nIdx = (vTimes.size() * 9) / 10;
+    if (nIdx >= vTimes.size())
+        nIdx = vTimes.size() - 1;
+    std::nth_element(vTimes.begin(), vTimes.begin() + nIdx, vTimes.end());
+    return vTimes[nIdx];
+}
+
 // Requires cs_main.
 // returns false, still setting pit, if the block was already in flight from the same peer
 // pit will only be valid as long as the same cs_main lock is being held
@@ -408,7 +745,7 @@ bool MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const CBlockIndex*
     assert(state != nullptr);
 
     // Short-circuit most stuff in case its from the same node
-    std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
+    MapBlocksInFlight::iterator itInFlight = mapBlocksInFlight.find(hash);
     if (itInFlight != mapBlocksInFlight.end() && itInFlight->second.first == nodeid) {
         if (pit) {
             *pit = &itInFlight->second.second;
@@ -420,7 +757,7 @@ bool MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const CBlockIndex*
     MarkBlockAsReceived(hash);
 
     std::list<QueuedBlock>::iterator it = state->vBlocksInFlight.insert(state->vBlocksInFlight.end(),
-            {hash, pindex, pindex != nullptr, std::unique_ptr<PartiallyDownloadedBlock>(pit ? new PartiallyDownloadedBlock(&mempool) : nullptr)});
+            {hash, pindex, pindex != nullptr, GetTimeMicros(), std::unique_ptr<PartiallyDownloadedBlock>(pit ? new PartiallyDownloadedBlock(&mempool) : nullptr)});
     state->nBlocksInFlight++;
     state->nBlocksInFlightValidHeaders += it->fValidatedHeaders;
     if (state->nBlocksInFlight == 1) {
@@ -659,7 +996,7 @@ void PeerLogicValidation::FinalizeNode(NodeId nodeid, bool& fUpdateConnectionTim
     for (const QueuedBlock& entry : state->vBlocksInFlight) {
         mapBlocksInFlight.erase(entry.hash);
     }
-    EraseOrphansFor(nodeid);
+    orphanPool.EraseForPeer(nodeid);
     nPreferredDownload -= state->fPreferredDownload;
     nPeersWithValidatedDownloads -= (state->nBlocksInFlightValidHeaders != 0);
     assert(nPeersWithValidatedDownloads >= 0);
@@ -695,123 +1032,18 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
 
 //////////////////////////////////////////////////////////////////////////////
 //
-// mapOrphanTransactions
+// Orphan transactions
 //
 
-// TODO: Support this in the future (it relates to MSG_CMPCT_BLOCK)
-//void AddToCompactExtraTransactions(const CTransactionRef& tx)
-//{
-//    size_t max_extra_txn = gArgs.GetArg("-blockreconstructionextratxn", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN);
-//    if (max_extra_txn <= 0)
-//        return;
-//    if (!vExtraTxnForCompact.size())
-//        vExtraTxnForCompact.resize(max_extra_txn);
-//    vExtraTxnForCompact[vExtraTxnForCompactIt] = std::make_pair(tx->GetHash(), tx);
-//    vExtraTxnForCompactIt = (vExtraTxnForCompactIt + 1) % max_extra_txn;
-//}
-
-bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
-{
-    const uint256& hash = tx->GetHash();
-    if (mapOrphanTransactions.count(hash))
-        return false;
-
-    // Ignore big transactions, to avoid a
-    // send-big-orphans memory exhaustion attack. If a peer has a legitimate
-    // large transaction with a missing parent then we assume
-    // it will rebroadcast it later, after the parent transaction(s)
-    // have been mined or received.
-    // 100 orphans, each of which is at most 99,999 bytes big is
-    // at most 10 megabytes of orphans and somewhat more byprev index (in the worst case):
-    size_t nSize = ::GetSerializeSize(*tx, SER_NETWORK, CTransaction::CURRENT_VERSION);
-    if (nSize >= MAX_STANDARD_TX_SIZE)
-    {
-        LogPrint(BCLog::MEMPOOL, "ignoring large orphan tx (size: %u, hash: %s)\n", nSize, hash.ToString());
-        return false;
-    }
-
-    auto ret = mapOrphanTransactions.emplace(hash, COrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME});
-    assert(ret.second);
-    for (const CTxIn& txin : tx->vin) {
-        mapOrphanTransactionsByPrev[txin.prevout].insert(ret.first);
-    }
-
-    // TODO: Support this in the future (it relates to MSG_CMPCT_BLOCK)
-//    AddToCompactExtraTransactions(tx);
-
-    LogPrint(BCLog::MEMPOOL, "stored orphan tx %s (mapsz %u outsz %u)\n", hash.ToString(),
-             mapOrphanTransactions.size(), mapOrphanTransactionsByPrev.size());
-    return true;
-}
-
-int static EraseOrphanTx(uint256 hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
-{
-    std::map<uint256, COrphanTx>::iterator it = mapOrphanTransactions.find(hash);
-    if (it == mapOrphanTransactions.end())
-        return 0;
-    for (const CTxIn& txin : it->second.tx->vin)
-    {
-        auto itPrev = mapOrphanTransactionsByPrev.find(txin.prevout);
-        if (itPrev == mapOrphanTransactionsByPrev.end())
-            continue;
-        itPrev->second.erase(it);
-        if (itPrev->second.empty())
-            mapOrphanTransactionsByPrev.erase(itPrev);
-    }
-    mapOrphanTransactions.erase(it);
-    return 1;
-}
-
-void EraseOrphansFor(NodeId peer)
-{
-    int nErased = 0;
-    std::map<uint256, COrphanTx>::iterator iter = mapOrphanTransactions.begin();
-    while (iter != mapOrphanTransactions.end())
-    {
-        std::map<uint256, COrphanTx>::iterator maybeErase = iter++; // increment to avoid iterator becoming invalid
-        if (maybeErase->second.fromPeer == peer)
-        {
-            nErased += EraseOrphanTx(maybeErase->second.tx->GetHash());
-        }
-    }
-    if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx from peer=%d\n", nErased, peer);
-}
-
-
-unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+void AddToCompactExtraTransactions(const CTransactionRef& tx)
 {
-    unsigned int nEvicted = 0;
-    static int64_t nNextSweep;
-    int64_t nNow = GetTime();
-    if (nNextSweep <= nNow) {
-        // Sweep out expired orphan pool entries:
-        int nErased = 0;
-        int64_t nMinExpTime = nNow + ORPHAN_TX_EXPIRE_TIME - ORPHAN_TX_EXPIRE_INTERVAL;
-        std::map<uint256, COrphanTx>::iterator iter = mapOrphanTransactions.begin();
-        while (iter != mapOrphanTransactions.end())
-        {
-            std::map<uint256, COrphanTx>::iterator maybeErase = iter++;
-            if (maybeErase->second.nTimeExpire <= nNow) {
-                nErased += EraseOrphanTx(maybeErase->second.tx->GetHash());
-            } else {
-                nMinExpTime = std::min(maybeErase->second.nTimeExpire, nMinExpTime);
-            }
-        }
-        // Sweep again 5 minutes after the next entry that expires in order to batch the linear scan.
-        nNextSweep = nMinExpTime + ORPHAN_TX_EXPIRE_INTERVAL;
-        if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx due to expiration\n", nErased);
-    }
-    while (mapOrphanTransactions.size() > nMaxOrphans)
-    {
-        // Evict a random orphan:
-        uint256 randomhash = GetRandHash();
-        std::map<uint256, COrphanTx>::iterator it = mapOrphanTransactions.lower_bound(randomhash);
-        if (it == mapOrphanTransactions.end())
-            it = mapOrphanTransactions.begin();
-        EraseOrphanTx(it->first);
-        ++nEvicted;
-    }
-    return nEvicted;
+    size_t max_extra_txn = gArgs.GetArg("-blockreconstructionextratxn", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN);
+    if (max_extra_txn <= 0)
+        return;
+    if (!vExtraTxnForCompact.size())
+        vExtraTxnForCompact.resize(max_extra_txn);
+    vExtraTxnForCompact[vExtraTxnForCompactIt] = std::make_pair(tx->GetHash(), tx);
+    vExtraTxnForCompactIt = (vExtraTxnForCompactIt + 1) % max_extra_txn;
 }
 
 // Requires cs_main.
@@ -842,7 +1074,7 @@ void Misbehaving(NodeId pnode, int howmuch)
 
 PeerLogicValidation::PeerLogicValidation(CConnman* connmanIn, CScheduler &scheduler) : connman(connmanIn), m_stale_tip_check_time(0) {
     // Initialize global variables that cannot be constructed at startup.
-    recentRejects.reset(new CRollingBloomFilter(120000, 0.000001));
+    recentRejects.reset(new CRecentRejectsFilter(120000));
 
     // Stale tip checking and peer eviction are on two different timers, but we
     // don't want them to get out of sync due to drift in the scheduler, so we
@@ -855,29 +1087,8 @@ PeerLogicValidation::PeerLogicValidation(CConnman* connmanIn, CScheduler &schedu
 void PeerLogicValidation::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& vtxConflicted) {
     LOCK(cs_main);
 
-    std::vector<uint256> vOrphanErase;
-
-    for (const CTransaction& tx : pblock->vtx) {
-        // Which orphan pool entries must we evict?
-        for (const auto& txin : tx.vin) {
-            auto itByPrev = mapOrphanTransactionsByPrev.find(txin.prevout);
-            if (itByPrev == mapOrphanTransactionsByPrev.end()) continue;
-            for (auto mi = itByPrev->second.begin(); mi != itByPrev->second.end(); ++mi) {
-                const CTransaction& orphanTx = *(*mi)->second.tx;
-                const uint256& orphanHash = orphanTx.GetHash();
-                vOrphanErase.push_back(orphanHash);
-            }
-        }
-    }
-
-    // Erase orphan transactions include or precluded by this block
-    if (vOrphanErase.size()) {
-        int nErased = 0;
-        for (uint256 &orphanHash : vOrphanErase) {
-            nErased += EraseOrphanTx(orphanHash);
-        }
-        LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx included or conflicted by block\n", nErased);
-    }
+    // Erase orphan transactions included or precluded by this block
+    orphanPool.EraseForBlock(*pblock);
 
     g_last_tip_update = GetTime();
 }
@@ -885,7 +1096,7 @@ void PeerLogicValidation::BlockConnected(const std::shared_ptr<const CBlock>& pb
 // All of the following cache a recent block, and are protected by cs_most_recent_block
 static CCriticalSection cs_most_recent_block;
 static std::shared_ptr<const CBlock> most_recent_block;
-//static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_block;
+static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_block;
 static uint256 most_recent_block_hash;
 
 void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) {
@@ -900,14 +1111,17 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
 
     uint256 hashBlock(pblock->GetHash());
 
+    std::shared_ptr<const CBlockHeaderAndShortTxIDs> pcmpctblock =
+            std::make_shared<const CBlockHeaderAndShortTxIDs>(*pblock, &mempool);
+
     {
         LOCK(cs_most_recent_block);
         most_recent_block_hash = hashBlock;
         most_recent_block = pblock;
-//        most_recent_compact_block = pcmpctblock;
+        most_recent_compact_block = pcmpctblock;
     }
 
-    connman->ForEachNode([this, &pblock, pindex, &msgMaker, &hashBlock](CNode* pnode) {
+    connman->ForEachNode([this, &pblock, &pcmpctblock, pindex, &msgMaker, &hashBlock](CNode* pnode) {
         // TODO: Avoid the repeated-serialization here
         if (pnode->fDisconnect)
             return;
@@ -916,10 +1130,18 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
         // If the peer has, or we announced to them the previous block already,
         // but we don't think they have this one, go ahead and announce it
         if (!PeerHasHeader(&state, pindex) && PeerHasHeader(&state, pindex->pprev)) {
-
-            LogPrint(BCLog::NET, "%s sending new block %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
-                    hashBlock.ToString(), pnode->GetId());
-            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::BLOCK, *pblock));
+            if (state.fPreferHeaderAndIDs) {
+                // This peer asked for new blocks as cmpctblocks (BIP152 high
+                // bandwidth mode); the short IDs let it reconstruct the block
+                // from its mempool without another round trip.
+                LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
+                        hashBlock.ToString(), pnode->GetId());
+                connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            } else {
+                LogPrint(BCLog::NET, "%s sending new block %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
+                        hashBlock.ToString(), pnode->GetId());
+                connman->PushMessage(pnode, msgMaker.Make(NetMsgType::BLOCK, *pblock));
+            }
             state.pindexBestHeaderSent = pindex;
         }
     });
@@ -961,7 +1183,7 @@ void PeerLogicValidation::BlockChecked(const CBlock& block, const CValidationSta
     LOCK(cs_main);
 
     const uint256 hash(block.GetHash());
-    std::map<uint256, std::pair<NodeId, bool>>::iterator it = mapBlockSource.find(hash);
+    auto it = mapBlockSource.find(hash);
 
     int nDoS = 0;
     if (state.IsInvalid(nDoS)) {
@@ -1015,7 +1237,7 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 
             return recentRejects->contains(inv.hash) ||
                    mempool.exists(inv.hash) ||
-                   mapOrphanTransactions.count(inv.hash) ||
+                   orphanPool.HaveTx(inv.hash) ||
                    pblocktree->ContainsTx(inv.hash);
         }
     case MSG_BLOCK:
@@ -1025,13 +1247,27 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     return true;
 }
 
-void RelayTransaction(const CTransaction& tx, CConnman* connman)
+void RelayTransaction(const CTransactionRef& ptx, CConnman* connman)
 {
-    CInv inv(MSG_TX, tx.GetHash());
-    connman->ForEachNode([&inv](CNode* pnode)
-    {
-        pnode->PushInventory(inv);
-    });
+    CTxAnnouncement ann;
+    ann.hash = ptx->GetHash();
+    // One mempool lookup here replaces one lookup per peer at announce time
+    auto txinfo = mempool.info(ann.hash);
+    if (txinfo.tx) {
+        ann.tx = txinfo.tx;
+        ann.nFeePerK = txinfo.feeRate.GetFeePerK();
+    } else {
+        // Share the caller's deserialized object instead of deep-copying it
+        ann.tx = ptx;
+        ann.nFeePerK = 0;
+    }
+    const int64_t nNow = GetTimeMicros();
+    LOCK(cs_txAnnouncements);
+    while (!vTxAnnouncements.empty() && vTxAnnouncements.front().nTimeExpire < nNow)
+        vTxAnnouncements.pop_front();
+    ann.nSequence = ++nTxAnnouncementSequence;
+    ann.nTimeExpire = nNow + TX_ANNOUNCEMENT_EXPIRY;
+    vTxAnnouncements.push_back(std::move(ann));
 }
 
 static void RelayAddress(const CAddress& addr, bool fReachable, CConnman* connman)
@@ -1049,7 +1285,7 @@ static void RelayAddress(const CAddress& addr, bool fReachable, CConnman* connma
     assert(nRelayNodes <= best.size());
 
     auto sortfunc = [&best, &hasher, nRelayNodes](CNode* pnode) {
-        if (pnode->nVersion >= CADDR_TIME_VERSION) {
+        if (pnode->nVersion >= CADDR_TIME_VERSION && !pnode->fBlockRelayOnly) {
             uint64_t hashKey = CSipHasher(hasher).Write(pnode->GetId()).Finalize();
             for (unsigned int i = 0; i < nRelayNodes; i++) {
                  if (hashKey > best[i].first) {
@@ -1089,18 +1325,18 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
 
             it++;
 
-            // TODO: Support this in the future (it relates to MSG_CMPCT_BLOCK and MSG_FILTERED_BLOCK)
+            // TODO: Support MSG_FILTERED_BLOCK in the future
 //            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK)
-            if (inv.type == MSG_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_CMPCT_BLOCK)
             {
                 bool send = false;
                 BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
                 std::shared_ptr<const CBlock> a_recent_block;
-//                std::shared_ptr<const CBlockHeaderAndShortTxIDs> a_recent_compact_block;
+                std::shared_ptr<const CBlockHeaderAndShortTxIDs> a_recent_compact_block;
                 {
                     LOCK(cs_most_recent_block);
                     a_recent_block = most_recent_block;
-//                    a_recent_compact_block = most_recent_compact_block;
+                    a_recent_compact_block = most_recent_compact_block;
                 }
                 if (mi != mapBlockIndex.end())
                 {
@@ -1145,6 +1381,20 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 // it's available before trying to send.
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
                 {
+                    // Look ahead in the getdata queue and start background
+                    // reads for the blocks we will serve next, so their disk
+                    // latency overlaps with serializing and sending this one.
+                    int nPrefetched = 0;
+                    for (std::deque<CInv>::iterator itAhead = it; itAhead != pfrom->vRecvGetData.end() && nPrefetched < 2; ++itAhead) {
+                        if (itAhead->type != MSG_BLOCK && itAhead->type != MSG_CMPCT_BLOCK)
+                            continue;
+                        BlockMap::iterator miAhead = mapBlockIndex.find(itAhead->hash);
+                        if (miAhead != mapBlockIndex.end() && (miAhead->second->nStatus & BLOCK_HAVE_DATA)) {
+                            PrefetchBlockFromDisk(miAhead->second->GetBlockPos());
+                            nPrefetched++;
+                        }
+                    }
+
                     std::shared_ptr<const CBlock> pblock;
                     if (a_recent_block && a_recent_block->GetHash() == (*mi).second->GetBlockHash()) {
                         pblock = a_recent_block;
@@ -1184,24 +1434,23 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
 //                        // else
 //                            // no response
 //                    }
-//                    else if (inv.type == MSG_CMPCT_BLOCK)
-//                    {
-//                        // If a peer is asking for old blocks, we're almost guaranteed
-//                        // they won't have a useful mempool to match against a compact block,
-//                        // and we don't feel like constructing the object for them, so
-//                        // instead we respond with the full, non-compact block.
-//                        if (CanDirectFetch() && mi->second->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH) {
-//                            if (a_recent_compact_block && a_recent_compact_block->header.GetHash() == mi->second->GetBlockHash()) {
-//                                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
-//                            } else {
-//                                CBlockHeaderAndShortTxIDs cmpctblock(*pblock);
-//                                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, cmpctblock));
-//                            }
-//                        } else {
-//                            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
-//                        }
-//                        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
-//                    }
+                    else if (inv.type == MSG_CMPCT_BLOCK)
+                    {
+                        // If a peer is asking for old blocks, we're almost guaranteed
+                        // they won't have a useful mempool to match against a compact block,
+                        // and we don't feel like constructing the object for them, so
+                        // instead we respond with the full, non-compact block.
+                        if (CanDirectFetch() && mi->second->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH) {
+                            if (a_recent_compact_block && a_recent_compact_block->header.GetHash() == mi->second->GetBlockHash()) {
+                                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
+                            } else {
+                                CBlockHeaderAndShortTxIDs cmpctblock(*pblock, &mempool);
+                                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, cmpctblock));
+                            }
+                        } else {
+                            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
+                        }
+                    }
 
                     // Trigger the peer node to send a getblocks request for the next batch of inventory
                     if (inv.hash == pfrom->hashContinue)
@@ -1222,14 +1471,24 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 bool push = false;
                 auto mi = mapRelay.find(inv.hash);
                 if (mi != mapRelay.end()) {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::TX, *mi->second));
+                    // Prefer the wire form cached at acceptance so repeat
+                    // requests are a refcount bump; a relay entry can outlive
+                    // its mempool entry, so fall back to serializing.
+                    auto vchTx = mempool.GetSharedSerialized(inv.hash);
+                    if (vchTx)
+                        connman->PushSharedMessage(pfrom, NetMsgType::TX, vchTx);
+                    else
+                        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::TX, *mi->second));
                     push = true;
                 } else if (pfrom->timeLastMempoolReq) {
                     auto txinfo = mempool.info(inv.hash);
                     // To protect privacy, do not answer getdata using the mempool when
                     // that TX couldn't have been INVed in reply to a MEMPOOL request.
                     if (txinfo.tx && txinfo.nTime <= pfrom->timeLastMempoolReq) {
-                        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::TX, *txinfo.tx));
+                        if (txinfo.vchSerialized)
+                            connman->PushSharedMessage(pfrom, NetMsgType::TX, txinfo.vchSerialized);
+                        else
+                            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::TX, *txinfo.tx));
                         push = true;
                     }
                 }
@@ -1244,9 +1503,9 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
             // Track requests for our stuff.
             GetMainSignals().Inventory(inv.hash);
 
-            // TODO: Support this in the future (it relates to MSG_CMPCT_BLOCK and MSG_FILTERED_BLOCK)
+            // TODO: Support MSG_FILTERED_BLOCK in the future
 //            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK || inv.type == MSG_WITNESS_BLOCK)
-            if (inv.type == MSG_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_CMPCT_BLOCK)
                 break;
         }
     }
@@ -1287,6 +1546,73 @@ inline void static SendBlockTransactions(const CBlock& block, const BlockTransac
     connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCKTXN, resp));
 }
 
+/** Resolve the pow hash for a batch of peer-supplied headers, spreading the
+ * work across the hash calculation threads when more than one is configured.
+ * Returns false if a shutdown was requested while hashing; the caller should
+ * abandon the message in that case. */
+bool static CalculateHeaderHashes(std::vector<CBlockHeader>& headers, CNode *pfrom)
+{
+    // Calculate header hash
+    LogPrintf("Start calculating hash for %d block headers\n", headers.size());
+    if (nHashCalcThreads > 1)
+    {
+        CCheckQueueControl<CHashCalculation> control(&hashCalculationQueue);
+        std::vector<CHashCalculation> vHashCalc;
+        vHashCalc.reserve(headers.size());
+
+        for (CBlockHeader& header : headers) {
+            CHashCalculation hashCalc(&header, pfrom);
+            vHashCalc.push_back(CHashCalculation());
+            hashCalc.swap(vHashCalc.back());
+        }
+
+        control.Add(vHashCalc);
+        control.Wait();
+
+        // Hash calculation takes much time to finish. So checking fShutdown node regularly to quickly shut down node during hash calculation
+        if (fShutdown) {
+            return false;
+        }
+    }
+    else
+    {
+        for (CBlockHeader& header : headers) {
+            // SHA256 doesn't cost much cpu usage to calculate
+            uint256 blockSHA256Hash = header.GetSHA256Hash();
+
+            {
+                boost::mutex::scoped_lock lock(mapHashmutex);
+                auto mi = mapHash.find(blockSHA256Hash);
+                if (mi != mapHash.end())
+                {
+                    header.blockHash = (*mi).second;
+                    LogPrintf("Already have header %s (sha256: %s)\n",
+                              header.blockHash.ToString(),
+                              blockSHA256Hash.ToString());
+                }
+            }
+
+            if (header.blockHash == 0)
+            {
+                uint256 blockHash = header.GetHash();
+                LogPrintf("Received header %s (sha256: %s) from node %s\n",
+                          blockHash.ToString(),
+                          blockSHA256Hash.ToString(),
+                          pfrom->GetAddrName());
+                boost::mutex::scoped_lock lock(mapHashmutex);
+                mapHash.insert(std::make_pair(blockSHA256Hash, blockHash));
+            }
+
+            // Hash calculation takes much time to finish. So checking fShutdown node regularly to quickly shut down node during hash calculation
+            if (fShutdown) {
+                return false;
+            }
+        }
+    }
+    LogPrintf("Finish calculating hash for %d block headers\n", headers.size());
+    return true;
+}
+
 bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, std::vector<CBlockHeader>& headers, const CChainParams& chainparams, bool punish_duplicate_invalid)
 {
     const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
@@ -1342,63 +1668,8 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, std::vector<C
         }
     }
 
-    {
-        // Calculate header hash
-        LogPrintf("Start calculating hash for %d block headers\n", nCount);
-        if (nHashCalcThreads > 1)
-        {
-            CCheckQueueControl<CHashCalculation> control(&hashCalculationQueue);
-            std::vector<CHashCalculation> vHashCalc;
-            vHashCalc.reserve(nCount);
-
-            int index = 0;
-            for (CBlockHeader& header : headers) {
-                CHashCalculation hashCalc(&header, pfrom);
-                vHashCalc.push_back(CHashCalculation());
-                hashCalc.swap(vHashCalc.back());
-                index++;
-            }
-
-            control.Add(vHashCalc);
-            control.Wait();
-
-            // Hash calculation takes much time to finish. So checking fShutdown node regularly to quickly shut down node during hash calculation
-            if (fShutdown) {
-                return true;
-            }
-        }
-        else
-        {
-            for (CBlockHeader& header : headers) {
-                // SHA256 doesn't cost much cpu usage to calculate
-                uint256 blockSHA256Hash = header.GetSHA256Hash();
-
-                std::map<uint256, uint256>::iterator mi = mapHash.find(blockSHA256Hash);
-                if (mi != mapHash.end())
-                {
-                    header.blockHash = (*mi).second;
-                    LogPrintf("Already have header %s (sha256: %s)\n",
-                              header.blockHash.ToString(),
-                              blockSHA256Hash.ToString());
-                }
-
-                if (header.blockHash == 0)
-                {
-                    uint256 blockHash = header.GetHash();
-                    LogPrintf("Received header %s (sha256: %s) from node %s\n",
-                              blockHash.ToString(),
-                              blockSHA256Hash.ToString(),
-                              pfrom->GetAddrName());
-                    mapHash.insert(std::make_pair(blockSHA256Hash, blockHash));
-                }
-
-                // Hash calculation takes much time to finish. So checking fShutdown node regularly to quickly shut down node during hash calculation
-                if (fShutdown) {
-                    return true;
-                }
-            }
-        }
-        LogPrintf("Finish calculating hash for %d block headers\n", nCount);
+    if (!CalculateHeaderHashes(headers, pfrom)) {
+        return true;
     }
     {
         LOCK(cs_main);
@@ -1599,36 +1870,144 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, std::vector<C
     return true;
 }
 
-bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc)
+/** Process a bulkhdrs range response. The whole run lies inside checkpointed
+ * history, so instead of the locator walk we check that the run attaches to a
+ * header we already have at the advertised height, that it is internally
+ * continuous, and that every header landing on a checkpoint height matches
+ * the compiled-in hash. The pow hashes for the run are resolved through the
+ * batched hash calculation queue up front, so the per-header checks in
+ * AcceptBlockHeader afterwards only hit the hash cache. */
+bool static ProcessBulkHeadersMessage(CNode *pfrom, CConnman *connman, BulkHeaders& bulkHeaders, const CChainParams& chainparams)
 {
-    LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->GetId());
-    if (gArgs.IsArgSet("-dropmessagestest") && GetRand(gArgs.GetArg("-dropmessagestest", 0)) == 0)
-    {
-        LogPrintf("dropmessagestest DROPPING RECV MESSAGE\n");
+    std::vector<CBlockHeader>& headers = bulkHeaders.headers;
+    const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    size_t nCount = headers.size();
+
+    if (nCount == 0) {
+        // Peer had nothing in range; fall back to the regular headers walk.
+        LOCK(cs_main);
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexBestHeader), uint256()));
         return true;
     }
 
+    const int nStartHeight = bulkHeaders.nStartHeight;
+    const int nEndHeight = nStartHeight + (int)nCount - 1;
 
-    if (!(pfrom->GetLocalServices() & NODE_BLOOM) &&
-              (strCommand == NetMsgType::FILTERLOAD ||
-               strCommand == NetMsgType::FILTERADD))
-    {
-        if (pfrom->nVersion >= NO_BLOOM_VERSION) {
-            LOCK(cs_main);
-            Misbehaving(pfrom->GetId(), 100);
-            return false;
-        } else {
-            pfrom->fDisconnect = true;
-            return false;
-        }
+    // Bulk delivery is only valid for checkpointed history; the contested
+    // tail of the chain has to go through the regular headers path with its
+    // locator handshake.
+    if (nStartHeight < 1 || nEndHeight > Checkpoints::GetTotalBlocksEstimate()) {
+        LOCK(cs_main);
+        Misbehaving(pfrom->GetId(), 20);
+        return error("bulk headers range %d-%d outside checkpointed history", nStartHeight, nEndHeight);
     }
 
-    if (strCommand == NetMsgType::REJECT)
     {
-        if (LogAcceptCategory(BCLog::NET)) {
-            try {
-                std::string strMsg; unsigned char ccode; std::string strReason;
-                vRecv >> LIMITED_STRING(strMsg, CMessageHeader::COMMAND_SIZE) >> ccode >> LIMITED_STRING(strReason, MAX_REJECT_MESSAGE_LENGTH);
+        LOCK(cs_main);
+        CNodeState *nodestate = State(pfrom->GetId());
+        // As with the headers path, push the sync timeout out before the hash
+        // calculation so a slow batch doesn't look like a stalling peer
+        if (nodestate->nHeadersSyncTimeout < std::numeric_limits<int64_t>::max()) {
+            nodestate->nHeadersSyncTimeout = GetTimeMicros() + HEADERS_DOWNLOAD_TIMEOUT_BASE;
+        }
+
+        // The run must attach to a header we already have at the advertised
+        // height, otherwise the claimed heights can't be trusted against the
+        // checkpoint table (and we'd be hashing 10000 unsolicited headers)
+        BlockMap::iterator mi = mapBlockIndex.find(headers[0].hashPrevBlock);
+        if (mi == mapBlockIndex.end() || (*mi).second->nHeight != nStartHeight - 1) {
+            Misbehaving(pfrom->GetId(), 20);
+            return error("bulk headers starting at %d don't connect to a known header", nStartHeight);
+        }
+    }
+
+    if (!CalculateHeaderHashes(headers, pfrom)) {
+        return true;
+    }
+
+    {
+        LOCK(cs_main);
+        uint256 hashLastBlock = headers[0].hashPrevBlock;
+        for (size_t i = 0; i < nCount; i++) {
+            if (headers[i].hashPrevBlock != hashLastBlock) {
+                Misbehaving(pfrom->GetId(), 20);
+                return error("non-continuous bulk headers sequence");
+            }
+            hashLastBlock = headers[i].GetHash();
+
+            // Every header at a checkpoint height must match the compiled-in
+            // hash; together with the continuity check above this pins the
+            // whole run to the checkpointed chain
+            if (!Checkpoints::CheckHardened(nStartHeight + (int)i, hashLastBlock)) {
+                Misbehaving(pfrom->GetId(), 100);
+                return error("bulk header at height %d conflicts with checkpoint", nStartHeight + (int)i);
+            }
+        }
+    }
+
+    CValidationState state;
+    const CBlockIndex *pindexLast = nullptr;
+    CBlockHeader first_invalid_header;
+    if (!ProcessNewBlockHeaders(headers, state, chainparams, &pindexLast, &first_invalid_header)) {
+        int nDoS;
+        if (state.IsInvalid(nDoS)) {
+            LOCK(cs_main);
+            if (nDoS > 0) {
+                Misbehaving(pfrom->GetId(), nDoS);
+            }
+            return error("invalid bulk header received");
+        }
+    }
+
+    {
+        LOCK(cs_main);
+        assert(pindexLast);
+        UpdateBlockAvailability(pfrom->GetId(), pindexLast->GetBlockHash());
+
+        // Keep pulling bulk ranges while checkpointed history remains; once
+        // past the last checkpoint fall back to the locator-based walk
+        if (pindexLast->nHeight < Checkpoints::GetTotalBlocksEstimate()) {
+            LogPrint(BCLog::NET, "more getbulkhdrs (%d) to peer=%d (startheight:%d)\n", pindexLast->nHeight + 1, pfrom->GetId(), pfrom->nStartingHeight);
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETBULKHEADERS, (::int32_t)(pindexLast->nHeight + 1), (::uint32_t)BulkHeaders::MAX_BULK_HEADERS));
+        } else {
+            LogPrint(BCLog::NET, "bulk headers reached last checkpoint, getheaders (%d) to peer=%d\n", pindexLast->nHeight, pfrom->GetId());
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexLast), uint256()));
+        }
+    }
+
+    return true;
+}
+
+bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc)
+{
+    LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->GetId());
+    if (gArgs.IsArgSet("-dropmessagestest") && GetRand(gArgs.GetArg("-dropmessagestest", 0)) == 0)
+    {
+        LogPrintf("dropmessagestest DROPPING RECV MESSAGE\n");
+        return true;
+    }
+
+
+    if (!(pfrom->GetLocalServices() & NODE_BLOOM) &&
+              (strCommand == NetMsgType::FILTERLOAD ||
+               strCommand == NetMsgType::FILTERADD))
+    {
+        if (pfrom->nVersion >= NO_BLOOM_VERSION) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 100);
+            return false;
+        } else {
+            pfrom->fDisconnect = true;
+            return false;
+        }
+    }
+
+    if (strCommand == NetMsgType::REJECT)
+    {
+        if (LogAcceptCategory(BCLog::NET)) {
+            try {
+                std::string strMsg; unsigned char ccode; std::string strReason;
+                vRecv >> LIMITED_STRING(strMsg, CMessageHeader::COMMAND_SIZE) >> ccode >> LIMITED_STRING(strReason, MAX_REJECT_MESSAGE_LENGTH);
 
                 std::ostringstream ss;
                 ss << strMsg << " code " << itostr(ccode) << ": " << strReason;
@@ -1764,7 +2143,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         UpdatePreferredDownload(pfrom, State(pfrom->GetId()));
         }
 
-        if (!pfrom->fInbound)
+        if (!pfrom->fInbound && !pfrom->fBlockRelayOnly)
         {
             // Advertise our address
             if (fListen && !IsInitialBlockDownload())
@@ -1848,17 +2227,23 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             // nodes)
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDHEADERS));
         }
-        // TODO: Support this in the future (it relates to MSG_CMPCT_BLOCK)
-//        if (pfrom->nVersion >= SHORT_IDS_BLOCKS_VERSION) {
-//            // Tell our peer we are willing to provide version 1 cmpctblocks
-//            // However, we do not request new block announcements using
-//            // cmpctblock messages.
-//            // We send this to non-NODE NETWORK peers as well, because
-//            // they may wish to request compact blocks from us
-//            bool fAnnounceUsingCMPCTBLOCK = false;
-//            uint64_t nCMPCTBLOCKVersion = 1;
-//            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDCMPCT, fAnnounceUsingCMPCTBLOCK, nCMPCTBLOCKVersion));
-//        }
+        if (pfrom->nVersion >= SHORT_IDS_BLOCKS_VERSION) {
+            // Tell our peer we are willing to provide version 1 cmpctblocks
+            // However, we do not request new block announcements using
+            // cmpctblock messages.
+            // We send this to non-NODE NETWORK peers as well, because
+            // they may wish to request compact blocks from us
+            bool fAnnounceUsingCMPCTBLOCK = false;
+            uint64_t nCMPCTBLOCKVersion = 1;
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDCMPCT, fAnnounceUsingCMPCTBLOCK, nCMPCTBLOCKVersion));
+        }
+        if ((pfrom->nServices & NODE_FAST_CHECKSUM) && pfrom->fWhitelisted &&
+            (connman->GetLocalServices() & NODE_FAST_CHECKSUM)) {
+            // Both sides advertise the cheap message checksum and this is a
+            // trusted link; switch send and receive over from SHA256d
+            pfrom->fFastChecksum = true;
+            LogPrint(BCLog::NET, "using fast message checksum peer=%d\n", pfrom->GetId());
+        }
         pfrom->fSuccessfullyConnected = true;
     }
 
@@ -1934,6 +2319,9 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             if (!State(pfrom->GetId())->fProvidesHeaderAndIDs) {
                 State(pfrom->GetId())->fProvidesHeaderAndIDs = true;
             }
+            // A peer may switch high-bandwidth announcements on or off at any
+            // time with a further sendcmpct message (BIP152)
+            State(pfrom->GetId())->fPreferHeaderAndIDs = fAnnounceUsingCMPCTBLOCK;
             if (!State(pfrom->GetId())->fSupportsDesiredCmpctVersion) {
                 State(pfrom->GetId())->fSupportsDesiredCmpctVersion = (nCMPCTBLOCKVersion == 1);
             }
@@ -1957,6 +2345,10 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         if (pfrom->fWhitelisted && gArgs.GetBoolArg("-whitelistrelay", DEFAULT_WHITELISTRELAY))
             fBlocksOnly = false;
 
+        // A block-relay-only link never fetches transactions, whitelisted or not
+        if (pfrom->fBlockRelayOnly)
+            fBlocksOnly = true;
+
         LOCK(cs_main);
 
         uint32_t nFetchFlags = GetFetchFlags(pfrom);
@@ -2075,55 +2467,119 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
     }
 
 
-    // TODO: Support this in the future (it relates to MSG_CMPCT_BLOCK)
-//    else if (strCommand == NetMsgType::GETBLOCKTXN)
-//    {
-//        BlockTransactionsRequest req;
-//        vRecv >> req;
-//
-//        std::shared_ptr<const CBlock> recent_block;
-//        {
-//            LOCK(cs_most_recent_block);
-//            if (most_recent_block_hash == req.blockhash)
-//                recent_block = most_recent_block;
-//            // Unlock cs_most_recent_block to avoid cs_main lock inversion
-//        }
-//        if (recent_block) {
-//            SendBlockTransactions(*recent_block, req, pfrom, connman);
-//            return true;
-//        }
-//
-//        LOCK(cs_main);
-//
-//        BlockMap::iterator it = mapBlockIndex.find(req.blockhash);
-//        if (it == mapBlockIndex.end() || !(it->second->nStatus & BLOCK_HAVE_DATA)) {
-//            LogPrintf("Peer %d sent us a getblocktxn for a block we don't have", pfrom->GetId());
-//            return true;
-//        }
-//
-//        if (it->second->nHeight < chainActive.Height() - MAX_BLOCKTXN_DEPTH) {
-//            // If an older block is requested (should never happen in practice,
-//            // but can happen in tests) send a block response instead of a
-//            // blocktxn response. Sending a full block response instead of a
-//            // small blocktxn response is preferable in the case where a peer
-//            // might maliciously send lots of getblocktxn requests to trigger
-//            // expensive disk reads, because it will require the peer to
-//            // actually receive all the data read from disk over the network.
-//            LogPrint(BCLog::NET, "Peer %d sent us a getblocktxn for a block > %i deep", pfrom->GetId(), MAX_BLOCKTXN_DEPTH);
-//            CInv inv;
-//            inv.type = State(pfrom->GetId())->fWantsCmpctWitness ? MSG_WITNESS_BLOCK : MSG_BLOCK;
-//            inv.hash = req.blockhash;
-//            pfrom->vRecvGetData.push_back(inv);
-//            ProcessGetData(pfrom, chainparams.GetConsensus(), connman, interruptMsgProc);
-//            return true;
-//        }
-//
-//        CBlock block;
-//        bool ret = ReadBlockFromDisk(block, it->second, chainparams.GetConsensus());
-//        assert(ret);
-//
-//        SendBlockTransactions(block, req, pfrom, connman);
-//    }
+    else if (strCommand == NetMsgType::GETBLOCKTXN)
+    {
+        BlockTransactionsRequest req;
+        vRecv >> req;
+
+        std::shared_ptr<const CBlock> recent_block;
+        {
+            LOCK(cs_most_recent_block);
+            if (most_recent_block_hash == req.blockhash)
+                recent_block = most_recent_block;
+            // Unlock cs_most_recent_block to avoid cs_main lock inversion
+        }
+        if (recent_block) {
+            SendBlockTransactions(*recent_block, req, pfrom, connman);
+            return true;
+        }
+
+        LOCK(cs_main);
+
+        BlockMap::iterator it = mapBlockIndex.find(req.blockhash);
+        if (it == mapBlockIndex.end() || !(it->second->nStatus & BLOCK_HAVE_DATA)) {
+            LogPrintf("Peer %d sent us a getblocktxn for a block we don't have", pfrom->GetId());
+            return true;
+        }
+
+        if (it->second->nHeight < chainActive.Height() - MAX_BLOCKTXN_DEPTH) {
+            // If an older block is requested (should never happen in practice,
+            // but can happen in tests) send a block response instead of a
+            // blocktxn response. Sending a full block response instead of a
+            // small blocktxn response is preferable in the case where a peer
+            // might maliciously send lots of getblocktxn requests to trigger
+            // expensive disk reads, because it will require the peer to
+            // actually receive all the data read from disk over the network.
+            LogPrint(BCLog::NET, "Peer %d sent us a getblocktxn for a block > %i deep", pfrom->GetId(), MAX_BLOCKTXN_DEPTH);
+            CInv inv;
+            inv.type = MSG_BLOCK;
+            inv.hash = req.blockhash;
+            pfrom->vRecvGetData.push_back(inv);
+            ProcessGetData(pfrom, chainparams.GetConsensus(), connman, interruptMsgProc);
+            return true;
+        }
+
+        CBlock block;
+        bool ret = ReadBlockFromDisk(block, it->second, chainparams.GetConsensus());
+        assert(ret);
+
+        SendBlockTransactions(block, req, pfrom, connman);
+    }
+
+
+    else if (strCommand == NetMsgType::GETCFILTER)
+    {
+        uint256 hashBlock;
+        vRecv >> hashBlock;
+
+        if (!fBlockFilterIndex) {
+            LogPrint(BCLog::NET, "Ignoring getcfilter from peer=%d, filter index disabled\n", pfrom->GetId());
+            return true;
+        }
+
+        uint256 filterHeader;
+        std::vector<unsigned char> vchFilter;
+        if (!GetBlockFilter(hashBlock, filterHeader, vchFilter)) {
+            LogPrint(BCLog::NET, "Peer %d requested a cfilter for a block we have no filter for\n", pfrom->GetId());
+            return true;
+        }
+
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CFILTER, hashBlock, filterHeader, vchFilter));
+    }
+
+
+    else if (strCommand == NetMsgType::GETHOTSET)
+    {
+        if (!pfrom->fWhitelisted) {
+            LogPrint(BCLog::NET, "Ignoring gethotset from non-whitelisted peer=%d\n", pfrom->GetId());
+            return true;
+        }
+
+        std::vector<COutPoint> vOutpoints;
+        {
+            LOCK(cs_main);
+            pcoinsTip->GetCachedOutpoints(vOutpoints, MAX_HOTSET_ENTRIES);
+        }
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::HOTSET, vOutpoints));
+    }
+
+
+    else if (strCommand == NetMsgType::HOTSET)
+    {
+        std::vector<COutPoint> vOutpoints;
+        vRecv >> vOutpoints;
+
+        if (!pfrom->fWhitelisted || !gArgs.GetBoolArg("-standby", DEFAULT_STANDBY)) {
+            LogPrint(BCLog::NET, "Ignoring unsolicited hotset from peer=%d\n", pfrom->GetId());
+            return true;
+        }
+        if (vOutpoints.size() > MAX_HOTSET_ENTRIES) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 20);
+            return true;
+        }
+
+        // Touch the coins in the database first without any lock, so the
+        // disk reads happen out here and the cs_main hold below finds
+        // everything in leveldb's caches.
+        Coin coin;
+        for (const COutPoint& outpoint : vOutpoints)
+            pcoinsdbview->GetCoin(outpoint, coin);
+
+        LOCK(cs_main);
+        pcoinsTip->FetchCoins(vOutpoints);
+        LogPrint(BCLog::NET, "Warmed coins cache with %u hot-set outpoints from peer=%d\n", vOutpoints.size(), pfrom->GetId());
+    }
 
 
     else if (strCommand == NetMsgType::GETHEADERS)
@@ -2179,21 +2635,62 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         // will re-announce the new block via headers (or compact blocks again)
         // in the SendMessages logic.
         nodestate->pindexBestHeaderSent = pindex ? pindex : chainActive.Tip();
-        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
+        if (pfrom->nServices & NODE_COMPACT_HEADERS)
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTHEADERS, CompressedHeaders(vHeaders)));
+        else
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
+    }
+
+
+    else if (strCommand == NetMsgType::GETBULKHEADERS)
+    {
+        ::int32_t nStartHeight = 0;
+        ::uint32_t nReqCount = 0;
+        vRecv >> nStartHeight >> nReqCount;
+
+        LOCK(cs_main);
+        if (IsInitialBlockDownload() && !pfrom->fWhitelisted) {
+            LogPrint(BCLog::NET, "Ignoring getbulkhdrs from peer=%d because node is in initial block download\n", pfrom->GetId());
+            return true;
+        }
+
+        // Only serve checkpointed history in bulk; the regular getheaders
+        // walk covers everything past the last compiled-in checkpoint
+        BulkHeaders bulkHeaders;
+        bulkHeaders.nStartHeight = nStartHeight;
+        const int nLastCheckpoint = Checkpoints::GetTotalBlocksEstimate();
+        if (nStartHeight >= 1 && nStartHeight <= nLastCheckpoint && nReqCount > 0) {
+            ::uint32_t nLimit = nReqCount;
+            if (nLimit > BulkHeaders::MAX_BULK_HEADERS)
+                nLimit = BulkHeaders::MAX_BULK_HEADERS;
+            for (const CBlockIndex* pindex = chainActive[nStartHeight];
+                 pindex && pindex->nHeight <= nLastCheckpoint;
+                 pindex = chainActive.Next(pindex))
+            {
+                bulkHeaders.headers.push_back(pindex->GetBlockHeader());
+                if (--nLimit == 0)
+                    break;
+            }
+        }
+        LogPrint(BCLog::NET, "getbulkhdrs %d+%u from peer=%d: sending %u headers\n", nStartHeight, nReqCount, pfrom->GetId(), (unsigned int)bulkHeaders.headers.size());
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BULKHEADERS, bulkHeaders));
     }
 
 
     else if (strCommand == NetMsgType::TX)
     {
         // Stop processing the transaction early if
-        // We are in blocks only mode and peer is either not whitelisted or whitelistrelay is off
-        if (!fRelayTxes && (!pfrom->fWhitelisted || !gArgs.GetBoolArg("-whitelistrelay", DEFAULT_WHITELISTRELAY)))
+        // We are in blocks only mode and peer is either not whitelisted or whitelistrelay is off,
+        // or the connection itself is block-relay-only
+        if (pfrom->fBlockRelayOnly ||
+            (!fRelayTxes && (!pfrom->fWhitelisted || !gArgs.GetBoolArg("-whitelistrelay", DEFAULT_WHITELISTRELAY))))
         {
             LogPrint(BCLog::NET, "transaction sent in violation of protocol peer=%d\n", pfrom->GetId());
             return true;
         }
 
-        std::deque<COutPoint> vWorkQueue;
+        // Accepted parents whose waiting orphans still need a re-acceptance pass
+        std::deque<std::pair<uint256, unsigned int>> vWorkQueue;
         std::vector<uint256> vEraseQueue;
         CTransactionRef ptx;
         vRecv >> ptx;
@@ -2214,33 +2711,31 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
         if (!AlreadyHave(inv) && AcceptToMemoryPool(mempool, state, ptx, &fMissingInputs))
         {
-            RelayTransaction(tx, connman);
-            for (unsigned int i = 0; i < tx.vout.size(); i++) {
-                vWorkQueue.emplace_back(inv.hash, i);
-            }
+            RelayTransaction(ptx, connman);
+            vWorkQueue.emplace_back(inv.hash, (unsigned int)tx.vout.size());
 
             pfrom->nLastTXTime = GetTime();
+            connman->RecordTxProcessed(pfrom->addr, true);
 
             LogPrint(BCLog::MEMPOOL, "AcceptToMemoryPool: peer=%d: accepted %s (poolsz %u txn, %u kB)\n",
                 pfrom->GetId(),
                 tx.GetHash().ToString(),
                 mempool.size(), mempool.DynamicMemoryUsage() / 1000);
 
-            // Recursively process any orphan transactions that depended on this one
+            // Process any orphan transactions that depended on this one: each
+            // accepted parent triggers one batched collection of its waiting
+            // children from the index, rather than a lookup per output.
             std::set<NodeId> setMisbehaving;
             while (!vWorkQueue.empty()) {
-                auto itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue.front());
+                std::vector<std::pair<CTransactionRef, NodeId>> vCandidates;
+                orphanPool.GetCandidatesFor(vWorkQueue.front().first, vWorkQueue.front().second, vCandidates);
                 vWorkQueue.pop_front();
-                if (itByPrev == mapOrphanTransactionsByPrev.end())
-                    continue;
-                for (auto mi = itByPrev->second.begin();
-                     mi != itByPrev->second.end();
-                     ++mi)
+                for (const auto& candidate : vCandidates)
                 {
-                    const CTransactionRef& porphanTx = (*mi)->second.tx;
+                    const CTransactionRef& porphanTx = candidate.first;
                     const CTransaction& orphanTx = *porphanTx;
                     const uint256& orphanHash = orphanTx.GetHash();
-                    NodeId fromPeer = (*mi)->second.fromPeer;
+                    NodeId fromPeer = candidate.second;
                     bool fMissingInputs2 = false;
                     // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
                     // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
@@ -2251,10 +2746,8 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                         continue;
                     if (AcceptToMemoryPool(mempool, stateDummy, porphanTx, &fMissingInputs2)) {
                         LogPrint(BCLog::MEMPOOL, "   accepted orphan tx %s\n", orphanHash.ToString());
-                        RelayTransaction(orphanTx, connman);
-                        for (unsigned int i = 0; i < orphanTx.vout.size(); i++) {
-                            vWorkQueue.emplace_back(orphanHash, i);
-                        }
+                        RelayTransaction(porphanTx, connman);
+                        vWorkQueue.emplace_back(orphanHash, (unsigned int)orphanTx.vout.size());
                         vEraseQueue.push_back(orphanHash);
                     }
                     else if (!fMissingInputs2)
@@ -2280,7 +2773,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             }
 
             for (uint256 hash : vEraseQueue)
-                EraseOrphanTx(hash);
+                orphanPool.EraseTx(hash);
         }
         else if (fMissingInputs)
         {
@@ -2298,13 +2791,13 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                     pfrom->AddInventoryKnown(_inv);
                     if (!AlreadyHave(_inv)) pfrom->AskFor(_inv);
                 }
-                AddOrphanTx(ptx, pfrom->GetId());
-
-                // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
+                // DoS prevention: do not allow the orphan pool to grow
+                // unbounded, and cap each peer at a quarter of the entries
                 unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, gArgs.GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
-                unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx);
+                orphanPool.AddTx(ptx, pfrom->GetId(), std::max(nMaxOrphanTx / 4, (unsigned int)1));
+                unsigned int nEvicted = orphanPool.LimitSize(nMaxOrphanTx, DEFAULT_MAX_ORPHAN_TX_BYTES);
                 if (nEvicted > 0) {
-                    LogPrint(BCLog::MEMPOOL, "mapOrphan overflow, removed %u tx\n", nEvicted);
+                    LogPrint(BCLog::MEMPOOL, "orphan pool overflow, removed %u tx\n", nEvicted);
                 }
             } else {
                 LogPrint(BCLog::MEMPOOL, "not keeping orphan with rejected parents %s\n",tx.GetHash().ToString());
@@ -2313,12 +2806,15 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 recentRejects->insert(tx.GetHash());
             }
         } else {
+            // Rejected with its inputs present; count it against the peer's
+            // useful-tx ratio (orphans above are neither useful nor useless yet)
+            connman->RecordTxProcessed(pfrom->addr, false);
+
             if (!state.CorruptionPossible()) {
                 assert(recentRejects);
                 recentRejects->insert(tx.GetHash());
                 if (RecursiveDynamicUsage(*ptx) < 100000) {
-                    // TODO: Support this in the future (it relates to MSG_CMPCT_BLOCK)
-//                    AddToCompactExtraTransactions(ptx);
+                    AddToCompactExtraTransactions(ptx);
                 }
             }
 
@@ -2334,16 +2830,15 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 int nDoS = 0;
                 if (!state.IsInvalid(nDoS) || nDoS == 0) {
                     LogPrintf("Force relaying tx %s from whitelisted peer=%d\n", tx.GetHash().ToString(), pfrom->GetId());
-                    RelayTransaction(tx, connman);
+                    RelayTransaction(ptx, connman);
                 } else {
                     LogPrintf("Not relaying invalid transaction %s from whitelisted peer=%d (%s)\n", tx.GetHash().ToString(), pfrom->GetId(), FormatStateMessage(state));
                 }
             }
         }
 
-        // TODO: Support this in the future (it relates to MSG_CMPCT_BLOCK)
-//        for (const CTransactionRef& removedTx : lRemovedTxn)
-//            AddToCompactExtraTransactions(removedTx);
+        for (const CTransactionRef& removedTx : lRemovedTxn)
+            AddToCompactExtraTransactions(removedTx);
 
         int nDoS = 0;
         if (state.IsInvalid(nDoS))
@@ -2361,303 +2856,310 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
     }
 
 
-    // TODO: Support this in the future (it relates to MSG_CMPCT_BLOCK)
-//    else if (strCommand == NetMsgType::CMPCTBLOCK && !fImporting && !fReindex) // Ignore blocks received while importing
-//    {
-//        CBlockHeaderAndShortTxIDs cmpctblock;
-//        vRecv >> cmpctblock;
-//
-//        bool received_new_header = false;
-//
-//        {
-//        LOCK(cs_main);
-//
-//        if (mapBlockIndex.find(cmpctblock.header.hashPrevBlock) == mapBlockIndex.end()) {
-//            // Doesn't connect (or is genesis), instead of DoSing in AcceptBlockHeader, request deeper headers
-//            if (!IsInitialBlockDownload())
-//                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexBestHeader), uint256()));
-//            return true;
-//        }
-//
-//        if (mapBlockIndex.find(cmpctblock.header.GetHash()) == mapBlockIndex.end()) {
-//            received_new_header = true;
-//        }
-//        }
-//
-//        const CBlockIndex *pindex = nullptr;
-//        CValidationState state;
-//        if (!ProcessNewBlockHeaders({cmpctblock.header}, state, chainparams, &pindex)) {
-//            int nDoS;
-//            if (state.IsInvalid(nDoS)) {
-//                if (nDoS > 0) {
-//                    LOCK(cs_main);
-//                    Misbehaving(pfrom->GetId(), nDoS);
-//                }
-//                LogPrintf("Peer %d sent us invalid header via cmpctblock\n", pfrom->GetId());
-//                return true;
-//            }
-//        }
-//
-//        // When we succeed in decoding a block's txids from a cmpctblock
-//        // message we typically jump to the BLOCKTXN handling code, with a
-//        // dummy (empty) BLOCKTXN message, to re-use the logic there in
-//        // completing processing of the putative block (without cs_main).
-//        bool fProcessBLOCKTXN = false;
-//        CDataStream blockTxnMsg(SER_NETWORK, PROTOCOL_VERSION);
-//
-//        // If we end up treating this as a plain headers message, call that as well
-//        // without cs_main.
-//        bool fRevertToHeaderProcessing = false;
-//
-//        // Keep a CBlock for "optimistic" compactblock reconstructions (see
-//        // below)
-//        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-//        bool fBlockReconstructed = false;
-//
-//        {
-//        LOCK(cs_main);
-//        // If AcceptBlockHeader returned true, it set pindex
-//        assert(pindex);
-//        UpdateBlockAvailability(pfrom->GetId(), pindex->GetBlockHash());
-//
-//        CNodeState *nodestate = State(pfrom->GetId());
-//
-//        // If this was a new header with more work than our tip, update the
-//        // peer's last block announcement time
-//        if (received_new_header && pindex->nChainWork > chainActive.Tip()->nChainWork) {
-//            nodestate->m_last_block_announcement = GetTime();
-//        }
-//
-//        std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> >::iterator blockInFlightIt = mapBlocksInFlight.find(pindex->GetBlockHash());
-//        bool fAlreadyInFlight = blockInFlightIt != mapBlocksInFlight.end();
-//
-//        if (pindex->nStatus & BLOCK_HAVE_DATA) // Nothing to do here
-//            return true;
-//
-//        if (pindex->nChainWork <= chainActive.Tip()->nChainWork || // We know something better
-//                pindex->nTx != 0) { // We had this block at some point, but pruned it
-//            if (fAlreadyInFlight) {
-//                // We requested this block for some reason, but our mempool will probably be useless
-//                // so we just grab the block via normal getdata
-//                std::vector<CInv> vInv(1);
-//                vInv[0] = CInv(MSG_BLOCK | GetFetchFlags(pfrom), cmpctblock.header.GetHash());
-//                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, vInv));
-//            }
-//            return true;
-//        }
-//
-//        // If we're not close to tip yet, give up and let parallel block fetch work its magic
-//        if (!fAlreadyInFlight && !CanDirectFetch(chainparams.GetConsensus()))
-//            return true;
-//
-//        if (IsWitnessEnabled(pindex->pprev, chainparams.GetConsensus()) && !nodestate->fSupportsDesiredCmpctVersion) {
-//            // Don't bother trying to process compact blocks from v1 peers
-//            // after segwit activates.
-//            return true;
-//        }
-//
-//        // We want to be a bit conservative just to be extra careful about DoS
-//        // possibilities in compact block processing...
-//        if (pindex->nHeight <= chainActive.Height() + 2) {
-//            if ((!fAlreadyInFlight && nodestate->nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) ||
-//                 (fAlreadyInFlight && blockInFlightIt->second.first == pfrom->GetId())) {
-//                std::list<QueuedBlock>::iterator* queuedBlockIt = nullptr;
-//                if (!MarkBlockAsInFlight(pfrom->GetId(), pindex->GetBlockHash(), pindex, &queuedBlockIt)) {
-//                    if (!(*queuedBlockIt)->partialBlock)
-//                        (*queuedBlockIt)->partialBlock.reset(new PartiallyDownloadedBlock(&mempool));
-//                    else {
-//                        // The block was already in flight using compact blocks from the same peer
-//                        LogPrint(BCLog::NET, "Peer sent us compact block we were already syncing!\n");
-//                        return true;
-//                    }
-//                }
-//
-//                PartiallyDownloadedBlock& partialBlock = *(*queuedBlockIt)->partialBlock;
-//                ReadStatus status = partialBlock.InitData(cmpctblock, vExtraTxnForCompact);
-//                if (status == READ_STATUS_INVALID) {
-//                    MarkBlockAsReceived(pindex->GetBlockHash()); // Reset in-flight state in case of whitelist
-//                    Misbehaving(pfrom->GetId(), 100);
-//                    LogPrintf("Peer %d sent us invalid compact block\n", pfrom->GetId());
-//                    return true;
-//                } else if (status == READ_STATUS_FAILED) {
-//                    // Duplicate txindexes, the block is now in-flight, so just request it
-//                    std::vector<CInv> vInv(1);
-//                    vInv[0] = CInv(MSG_BLOCK | GetFetchFlags(pfrom), cmpctblock.header.GetHash());
-//                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, vInv));
-//                    return true;
-//                }
-//
-//                BlockTransactionsRequest req;
-//                for (size_t i = 0; i < cmpctblock.BlockTxCount(); i++) {
-//                    if (!partialBlock.IsTxAvailable(i))
-//                        req.indexes.push_back(i);
-//                }
-//                if (req.indexes.empty()) {
-//                    // Dirty hack to jump to BLOCKTXN code (TODO: move message handling into their own functions)
-//                    BlockTransactions txn;
-//                    txn.blockhash = cmpctblock.header.GetHash();
-//                    blockTxnMsg << txn;
-//                    fProcessBLOCKTXN = true;
-//                } else {
-//                    req.blockhash = pindex->GetBlockHash();
-//                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETBLOCKTXN, req));
-//                }
-//            } else {
-//                // This block is either already in flight from a different
-//                // peer, or this peer has too many blocks outstanding to
-//                // download from.
-//                // Optimistically try to reconstruct anyway since we might be
-//                // able to without any round trips.
-//                PartiallyDownloadedBlock tempBlock(&mempool);
-//                ReadStatus status = tempBlock.InitData(cmpctblock, vExtraTxnForCompact);
-//                if (status != READ_STATUS_OK) {
-//                    // TODO: don't ignore failures
-//                    return true;
-//                }
-//                std::vector<CTransactionRef> dummy;
-//                status = tempBlock.FillBlock(*pblock, dummy);
-//                if (status == READ_STATUS_OK) {
-//                    fBlockReconstructed = true;
-//                }
-//            }
-//        } else {
-//            if (fAlreadyInFlight) {
-//                // We requested this block, but its far into the future, so our
-//                // mempool will probably be useless - request the block normally
-//                std::vector<CInv> vInv(1);
-//                vInv[0] = CInv(MSG_BLOCK | GetFetchFlags(pfrom), cmpctblock.header.GetHash());
-//                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, vInv));
-//                return true;
-//            } else {
-//                // If this was an announce-cmpctblock, we want the same treatment as a header message
-//                fRevertToHeaderProcessing = true;
-//            }
-//        }
-//        } // cs_main
-//
-//        if (fProcessBLOCKTXN)
-//            return ProcessMessage(pfrom, NetMsgType::BLOCKTXN, blockTxnMsg, nTimeReceived, chainparams, connman, interruptMsgProc);
-//
-//        if (fRevertToHeaderProcessing) {
-//            // Headers received from HB compact block peers are permitted to be
-//            // relayed before full validation (see BIP 152), so we don't want to disconnect
-//            // the peer if the header turns out to be for an invalid block.
-//            // Note that if a peer tries to build on an invalid chain, that
-//            // will be detected and the peer will be banned.
-//            return ProcessHeadersMessage(pfrom, connman, {cmpctblock.header}, chainparams, /*punish_duplicate_invalid=*/false);
-//        }
-//
-//        if (fBlockReconstructed) {
-//            // If we got here, we were able to optimistically reconstruct a
-//            // block that is in flight from some other peer.
-//            {
-//                LOCK(cs_main);
-//                mapBlockSource.emplace(pblock->GetHash(), std::make_pair(pfrom->GetId(), false));
-//            }
-//            bool fNewBlock = false;
-//            // Setting fForceProcessing to true means that we bypass some of
-//            // our anti-DoS protections in AcceptBlock, which filters
-//            // unrequested blocks that might be trying to waste our resources
-//            // (eg disk space). Because we only try to reconstruct blocks when
-//            // we're close to caught up (via the CanDirectFetch() requirement
-//            // above, combined with the behavior of not requesting blocks until
-//            // we have a chain with at least nMinimumChainWork), and we ignore
-//            // compact blocks with less work than our tip, it is safe to treat
-//            // reconstructed compact blocks as having been requested.
-//            ProcessNewBlock(chainparams, pblock, /*fForceProcessing=*/true, &fNewBlock);
-//            if (fNewBlock) {
-//                pfrom->nLastBlockTime = GetTime();
-//            } else {
-//                LOCK(cs_main);
-//                mapBlockSource.erase(pblock->GetHash());
-//            }
-//            LOCK(cs_main); // hold cs_main for CBlockIndex::IsValid()
-//            if (pindex->IsValid(BLOCK_VALID_TRANSACTIONS)) {
-//                // Clear download state for this block, which is in
-//                // process from some other peer.  We do this after calling
-//                // ProcessNewBlock so that a malleated cmpctblock announcement
-//                // can't be used to interfere with block relay.
-//                MarkBlockAsReceived(pblock->GetHash());
-//            }
-//        }
-//
-//    }
+    else if (strCommand == NetMsgType::CMPCTBLOCK && !fReindex) // Ignore blocks received while reindexing
+    {
+        CBlockHeaderAndShortTxIDs cmpctblock;
+        vRecv >> cmpctblock;
 
-      // TODO: Support this in the future (it relates to MSG_CMPCT_BLOCK)
-//    else if (strCommand == NetMsgType::BLOCKTXN && !fImporting && !fReindex) // Ignore blocks received while importing
-//    {
-//        BlockTransactions resp;
-//        vRecv >> resp;
-//
-//        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-//        bool fBlockRead = false;
-//        {
-//            LOCK(cs_main);
-//
-//            std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> >::iterator it = mapBlocksInFlight.find(resp.blockhash);
-//            if (it == mapBlocksInFlight.end() || !it->second.second->partialBlock ||
-//                    it->second.first != pfrom->GetId()) {
-//                LogPrint(BCLog::NET, "Peer %d sent us block transactions for block we weren't expecting\n", pfrom->GetId());
-//                return true;
-//            }
-//
-//            PartiallyDownloadedBlock& partialBlock = *it->second.second->partialBlock;
-//            ReadStatus status = partialBlock.FillBlock(*pblock, resp.txn);
-//            if (status == READ_STATUS_INVALID) {
-//                MarkBlockAsReceived(resp.blockhash); // Reset in-flight state in case of whitelist
-//                Misbehaving(pfrom->GetId(), 100);
-//                LogPrintf("Peer %d sent us invalid compact block/non-matching block transactions\n", pfrom->GetId());
-//                return true;
-//            } else if (status == READ_STATUS_FAILED) {
-//                // Might have collided, fall back to getdata now :(
-//                std::vector<CInv> invs;
-//                invs.push_back(CInv(MSG_BLOCK | GetFetchFlags(pfrom), resp.blockhash));
-//                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, invs));
-//            } else {
-//                // Block is either okay, or possibly we received
-//                // READ_STATUS_CHECKBLOCK_FAILED.
-//                // Note that CheckBlock can only fail for one of a few reasons:
-//                // 1. bad-proof-of-work (impossible here, because we've already
-//                //    accepted the header)
-//                // 2. merkleroot doesn't match the transactions given (already
-//                //    caught in FillBlock with READ_STATUS_FAILED, so
-//                //    impossible here)
-//                // 3. the block is otherwise invalid (eg invalid coinbase,
-//                //    block is too big, too many legacy sigops, etc).
-//                // So if CheckBlock failed, #3 is the only possibility.
-//                // Under BIP 152, we don't DoS-ban unless proof of work is
-//                // invalid (we don't require all the stateless checks to have
-//                // been run).  This is handled below, so just treat this as
-//                // though the block was successfully read, and rely on the
-//                // handling in ProcessNewBlock to ensure the block index is
-//                // updated, reject messages go out, etc.
-//                MarkBlockAsReceived(resp.blockhash); // it is now an empty pointer
-//                fBlockRead = true;
-//                // mapBlockSource is only used for sending reject messages and DoS scores,
-//                // so the race between here and cs_main in ProcessNewBlock is fine.
-//                // BIP 152 permits peers to relay compact blocks after validating
-//                // the header only; we should not punish peers if the block turns
-//                // out to be invalid.
-//                mapBlockSource.emplace(resp.blockhash, std::make_pair(pfrom->GetId(), false));
-//            }
-//        } // Don't hold cs_main when we call into ProcessNewBlock
-//        if (fBlockRead) {
-//            bool fNewBlock = false;
-//            // Since we requested this block (it was in mapBlocksInFlight), force it to be processed,
-//            // even if it would not be a candidate for new tip (missing previous block, chain not long enough, etc)
-//            // This bypasses some anti-DoS logic in AcceptBlock (eg to prevent
-//            // disk-space attacks), but this should be safe due to the
-//            // protections in the compact block handler -- see related comment
-//            // in compact block optimistic reconstruction handling.
-//            ProcessNewBlock(chainparams, pblock, /*fForceProcessing=*/true, &fNewBlock);
-//            if (fNewBlock) {
-//                pfrom->nLastBlockTime = GetTime();
-//            } else {
-//                LOCK(cs_main);
-//                mapBlockSource.erase(pblock->GetHash());
-//            }
-//        }
-//    }
+        bool received_new_header = false;
+
+        {
+        LOCK(cs_main);
+
+        if (mapBlockIndex.find(cmpctblock.header.hashPrevBlock) == mapBlockIndex.end()) {
+            // Doesn't connect (or is genesis), instead of DoSing in AcceptBlockHeader, request deeper headers
+            if (!IsInitialBlockDownload())
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexBestHeader), uint256()));
+            return true;
+        }
+
+        if (mapBlockIndex.find(cmpctblock.header.GetHash()) == mapBlockIndex.end()) {
+            received_new_header = true;
+        }
+        }
+
+        const CBlockIndex *pindex = nullptr;
+        CValidationState state;
+        if (!ProcessNewBlockHeaders({cmpctblock.header}, state, chainparams, &pindex)) {
+            int nDoS;
+            if (state.IsInvalid(nDoS)) {
+                if (nDoS > 0) {
+                    LOCK(cs_main);
+                    Misbehaving(pfrom->GetId(), nDoS);
+                }
+                LogPrintf("Peer %d sent us invalid header via cmpctblock\n", pfrom->GetId());
+                return true;
+            }
+        }
+
+        // When we succeed in decoding a block's txids from a cmpctblock
+        // message we typically jump to the BLOCKTXN handling code, with a
+        // dummy (empty) BLOCKTXN message, to re-use the logic there in
+        // completing processing of the putative block (without cs_main).
+        bool fProcessBLOCKTXN = false;
+        CDataStream blockTxnMsg(SER_NETWORK, PROTOCOL_VERSION);
+
+        // If we end up treating this as a plain headers message, call that as well
+        // without cs_main.
+        bool fRevertToHeaderProcessing = false;
+
+        // Keep a CBlock for "optimistic" compactblock reconstructions (see
+        // below)
+        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+        bool fBlockReconstructed = false;
+
+        {
+        LOCK(cs_main);
+        // If AcceptBlockHeader returned true, it set pindex
+        assert(pindex);
+        UpdateBlockAvailability(pfrom->GetId(), pindex->GetBlockHash());
+
+        CNodeState *nodestate = State(pfrom->GetId());
+
+        // If this was a new header with more trust than our tip, update the
+        // peer's last block announcement time
+        if (received_new_header && pindex->bnChainTrust > chainActive.Tip()->bnChainTrust) {
+            nodestate->m_last_block_announcement = GetTime();
+        }
+
+        MapBlocksInFlight::iterator blockInFlightIt = mapBlocksInFlight.find(pindex->GetBlockHash());
+        bool fAlreadyInFlight = blockInFlightIt != mapBlocksInFlight.end();
+
+        if (pindex->nStatus & BLOCK_HAVE_DATA) // Nothing to do here
+            return true;
+
+        if (pindex->bnChainTrust <= chainActive.Tip()->bnChainTrust || // We know something better
+                pindex->nTx != 0) { // We had this block at some point, but pruned it
+            if (fAlreadyInFlight) {
+                // We requested this block for some reason, but our mempool will probably be useless
+                // so we just grab the block via normal getdata
+                std::vector<CInv> vInv(1);
+                vInv[0] = CInv(MSG_BLOCK | GetFetchFlags(pfrom), cmpctblock.header.GetHash());
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, vInv));
+            }
+            return true;
+        }
+
+        // If we're not close to tip yet, give up and let parallel block fetch work its magic
+        if (!fAlreadyInFlight && !CanDirectFetch())
+            return true;
+
+        // We want to be a bit conservative just to be extra careful about DoS
+        // possibilities in compact block processing...
+        if (pindex->nHeight <= chainActive.Height() + 2) {
+            if ((!fAlreadyInFlight && nodestate->nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) ||
+                 (fAlreadyInFlight && blockInFlightIt->second.first == pfrom->GetId())) {
+                std::list<QueuedBlock>::iterator* queuedBlockIt = nullptr;
+                if (!MarkBlockAsInFlight(pfrom->GetId(), pindex->GetBlockHash(), pindex, &queuedBlockIt)) {
+                    if (!(*queuedBlockIt)->partialBlock)
+                        (*queuedBlockIt)->partialBlock.reset(new PartiallyDownloadedBlock(&mempool));
+                    else {
+                        // The block was already in flight using compact blocks from the same peer
+                        LogPrint(BCLog::NET, "Peer sent us compact block we were already syncing!\n");
+                        return true;
+                    }
+                }
+
+                PartiallyDownloadedBlock& partialBlock = *(*queuedBlockIt)->partialBlock;
+                ReadStatus status = partialBlock.InitData(cmpctblock, vExtraTxnForCompact);
+                if (status == READ_STATUS_INVALID) {
+                    MarkBlockAsReceived(pindex->GetBlockHash()); // Reset in-flight state in case of whitelist
+                    Misbehaving(pfrom->GetId(), 100);
+                    LogPrintf("Peer %d sent us invalid compact block\n", pfrom->GetId());
+                    return true;
+                } else if (status == READ_STATUS_FAILED) {
+                    // Duplicate txindexes, the block is now in-flight, so just request it
+                    std::vector<CInv> vInv(1);
+                    vInv[0] = CInv(MSG_BLOCK | GetFetchFlags(pfrom), cmpctblock.header.GetHash());
+                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, vInv));
+                    return true;
+                }
+
+                // Use the window before the remaining transactions arrive:
+                // hand the inputs of the ones we already know to the
+                // background prefetcher, so ConnectBlock reads a warm
+                // coins DB instead of cold disk
+                std::vector<COutPoint> vPrefetch;
+                partialBlock.GetPrefetchOutpoints(vPrefetch);
+                PrefetchCoins(std::move(vPrefetch));
+
+                BlockTransactionsRequest req;
+                for (size_t i = 0; i < cmpctblock.BlockTxCount(); i++) {
+                    if (!partialBlock.IsTxAvailable(i))
+                        req.indexes.push_back(i);
+                }
+                if (req.indexes.empty()) {
+                    // Dirty hack to jump to BLOCKTXN code (TODO: move message handling into their own functions)
+                    BlockTransactions txn;
+                    txn.blockhash = cmpctblock.header.GetHash();
+                    blockTxnMsg << txn;
+                    fProcessBLOCKTXN = true;
+                } else {
+                    req.blockhash = pindex->GetBlockHash();
+                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETBLOCKTXN, req));
+                }
+            } else {
+                // This block is either already in flight from a different
+                // peer, or this peer has too many blocks outstanding to
+                // download from.
+                // Optimistically try to reconstruct anyway since we might be
+                // able to without any round trips.
+                PartiallyDownloadedBlock tempBlock(&mempool);
+                ReadStatus status = tempBlock.InitData(cmpctblock, vExtraTxnForCompact);
+                if (status != READ_STATUS_OK) {
+                    // TODO: don't ignore failures
+                    return true;
+                }
+                // Warm the coins DB while the block works through the
+                // remaining relay and validation steps
+                std::vector<COutPoint> vPrefetch;
+                tempBlock.GetPrefetchOutpoints(vPrefetch);
+                PrefetchCoins(std::move(vPrefetch));
+                std::vector<CTransactionRef> dummy;
+                status = tempBlock.FillBlock(*pblock, dummy);
+                if (status == READ_STATUS_OK) {
+                    fBlockReconstructed = true;
+                }
+            }
+        } else {
+            if (fAlreadyInFlight) {
+                // We requested this block, but its far into the future, so our
+                // mempool will probably be useless - request the block normally
+                std::vector<CInv> vInv(1);
+                vInv[0] = CInv(MSG_BLOCK | GetFetchFlags(pfrom), cmpctblock.header.GetHash());
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, vInv));
+                return true;
+            } else {
+                // If this was an announce-cmpctblock, we want the same treatment as a header message
+                fRevertToHeaderProcessing = true;
+            }
+        }
+        } // cs_main
+
+        if (fProcessBLOCKTXN)
+            return ProcessMessage(pfrom, NetMsgType::BLOCKTXN, blockTxnMsg, nTimeReceived, chainparams, connman, interruptMsgProc);
+
+        if (fRevertToHeaderProcessing) {
+            // Headers received from HB compact block peers are permitted to be
+            // relayed before full validation (see BIP 152), so we don't want to disconnect
+            // the peer if the header turns out to be for an invalid block.
+            // Note that if a peer tries to build on an invalid chain, that
+            // will be detected and the peer will be banned.
+            std::vector<CBlockHeader> headers{cmpctblock.header};
+            return ProcessHeadersMessage(pfrom, connman, headers, chainparams, /*punish_duplicate_invalid=*/false);
+        }
+
+        if (fBlockReconstructed) {
+            // If we got here, we were able to optimistically reconstruct a
+            // block that is in flight from some other peer.
+            {
+                LOCK(cs_main);
+                mapBlockSource.emplace(pblock->GetHash(), std::make_pair(pfrom->GetId(), false));
+            }
+            bool fNewBlock = false;
+            // Setting fForceProcessing to true means that we bypass some of
+            // our anti-DoS protections in AcceptBlock, which filters
+            // unrequested blocks that might be trying to waste our resources
+            // (eg disk space). Because we only try to reconstruct blocks when
+            // we're close to caught up (via the CanDirectFetch() requirement
+            // above, combined with the behavior of not requesting blocks until
+            // we have a chain with at least nMinimumChainWork), and we ignore
+            // compact blocks with less work than our tip, it is safe to treat
+            // reconstructed compact blocks as having been requested.
+            ProcessNewBlock(chainparams, pblock, /*fForceProcessing=*/true, &fNewBlock);
+            if (fNewBlock) {
+                pfrom->nLastBlockTime = GetTime();
+            } else {
+                LOCK(cs_main);
+                mapBlockSource.erase(pblock->GetHash());
+            }
+            LOCK(cs_main); // hold cs_main for CBlockIndex::IsValid()
+            if (pindex->IsValid(BLOCK_VALID_TRANSACTIONS)) {
+                // Clear download state for this block, which is in
+                // process from some other peer.  We do this after calling
+                // ProcessNewBlock so that a malleated cmpctblock announcement
+                // can't be used to interfere with block relay.
+                MarkBlockAsReceived(pblock->GetHash());
+            }
+        }
+
+    }
+
+    else if (strCommand == NetMsgType::BLOCKTXN && !fReindex) // Ignore blocks received while reindexing
+    {
+        BlockTransactions resp;
+        vRecv >> resp;
+
+        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+        bool fBlockRead = false;
+        {
+            LOCK(cs_main);
+
+            MapBlocksInFlight::iterator it = mapBlocksInFlight.find(resp.blockhash);
+            if (it == mapBlocksInFlight.end() || !it->second.second->partialBlock ||
+                    it->second.first != pfrom->GetId()) {
+                LogPrint(BCLog::NET, "Peer %d sent us block transactions for block we weren't expecting\n", pfrom->GetId());
+                return true;
+            }
+
+            PartiallyDownloadedBlock& partialBlock = *it->second.second->partialBlock;
+            ReadStatus status = partialBlock.FillBlock(*pblock, resp.txn);
+            if (status == READ_STATUS_INVALID) {
+                MarkBlockAsReceived(resp.blockhash); // Reset in-flight state in case of whitelist
+                Misbehaving(pfrom->GetId(), 100);
+                LogPrintf("Peer %d sent us invalid compact block/non-matching block transactions\n", pfrom->GetId());
+                return true;
+            } else if (status == READ_STATUS_FAILED) {
+                // Might have collided, fall back to getdata now :(
+                std::vector<CInv> invs;
+                invs.push_back(CInv(MSG_BLOCK | GetFetchFlags(pfrom), resp.blockhash));
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETDATA, invs));
+            } else {
+                // Block is either okay, or possibly we received
+                // READ_STATUS_CHECKBLOCK_FAILED.
+                // Note that CheckBlock can only fail for one of a few reasons:
+                // 1. bad-proof-of-work (impossible here, because we've already
+                //    accepted the header)
+                // 2. merkleroot doesn't match the transactions given (already
+                //    caught in FillBlock with READ_STATUS_FAILED, so
+                //    impossible here)
+                // 3. the block is otherwise invalid (eg invalid coinbase,
+                //    block is too big, too many legacy sigops, etc).
+                // So if CheckBlock failed, #3 is the only possibility.
+                // Under BIP 152, we don't DoS-ban unless proof of work is
+                // invalid (we don't require all the stateless checks to have
+                // been run).  This is handled below, so just treat this as
+                // though the block was successfully read, and rely on the
+                // handling in ProcessNewBlock to ensure the block index is
+                // updated, reject messages go out, etc.
+                RecordBlockDeliverySample(pfrom->GetId(), GetTimeMicros() - it->second.second->nTimeRequested);
+                MarkBlockAsReceived(resp.blockhash); // it is now an empty pointer
+                fBlockRead = true;
+                // mapBlockSource is only used for sending reject messages and DoS scores,
+                // so the race between here and cs_main in ProcessNewBlock is fine.
+                // BIP 152 permits peers to relay compact blocks after validating
+                // the header only; we should not punish peers if the block turns
+                // out to be invalid.
+                mapBlockSource.emplace(resp.blockhash, std::make_pair(pfrom->GetId(), false));
+            }
+        } // Don't hold cs_main when we call into ProcessNewBlock
+        if (fBlockRead) {
+            bool fNewBlock = false;
+            // Since we requested this block (it was in mapBlocksInFlight), force it to be processed,
+            // even if it would not be a candidate for new tip (missing previous block, chain not long enough, etc)
+            // This bypasses some anti-DoS logic in AcceptBlock (eg to prevent
+            // disk-space attacks), but this should be safe due to the
+            // protections in the compact block handler -- see related comment
+            // in compact block optimistic reconstruction handling.
+            ProcessNewBlock(chainparams, pblock, /*fForceProcessing=*/true, &fNewBlock);
+            if (fNewBlock) {
+                pfrom->nLastBlockTime = GetTime();
+            } else {
+                LOCK(cs_main);
+                mapBlockSource.erase(pblock->GetHash());
+            }
+        }
+    }
 
 
     else if (strCommand == NetMsgType::HEADERS)
@@ -2686,6 +3188,27 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         return ProcessHeadersMessage(pfrom, connman, headers, chainparams, should_punish);
     }
 
+    else if (strCommand == NetMsgType::CMPCTHEADERS)
+    {
+        // Delta-coded variant of the headers message; the deserializer
+        // enforces the count limit and restores the omitted fields.
+        CompressedHeaders cmpctHeaders;
+        vRecv >> cmpctHeaders;
+
+        bool should_punish = !pfrom->fInbound && !pfrom->m_manual_connection;
+        return ProcessHeadersMessage(pfrom, connman, cmpctHeaders.headers, chainparams, should_punish);
+    }
+
+    else if (strCommand == NetMsgType::BULKHEADERS)
+    {
+        // Range response covering checkpointed history; the deserializer
+        // enforces the count limit.
+        BulkHeaders bulkHeaders;
+        vRecv >> bulkHeaders;
+
+        return ProcessBulkHeadersMessage(pfrom, connman, bulkHeaders, chainparams);
+    }
+
     else if (strCommand == NetMsgType::BLOCK)
     {
         std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
@@ -2694,15 +3217,21 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         // SHA256 doesn't cost much cpu usage to calculate
         uint256 hashBlock;
         uint256 sha256HashBlock = pblock->GetSHA256Hash();
-        std::map<uint256, uint256>::iterator mi = mapHash.find(sha256HashBlock);
-        if (mi != mapHash.end())
+        bool fKnownHash = false;
         {
-            hashBlock = (*mi).second;
-            pblock->blockHash = hashBlock;
+            boost::mutex::scoped_lock lock(mapHashmutex);
+            auto mi = mapHash.find(sha256HashBlock);
+            if (mi != mapHash.end())
+            {
+                hashBlock = (*mi).second;
+                pblock->blockHash = hashBlock;
+                fKnownHash = true;
+            }
         }
-        else
+        if (!fKnownHash)
         {
             hashBlock = pblock->GetHash();
+            boost::mutex::scoped_lock lock(mapHashmutex);
             mapHash.insert(std::make_pair(sha256HashBlock, hashBlock));
         }
 
@@ -2718,6 +3247,24 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         const uint256 hash(pblock->GetHash());
         {
             LOCK(cs_main);
+            CNodeState *nodestate = State(pfrom->GetId());
+            if (nodestate && nodestate->setReassignedBlocks.erase(hash)) {
+                // We gave up on this peer's copy and re-requested elsewhere;
+                // if the replacement already arrived, drop this late duplicate.
+                BlockMap::iterator mi = mapBlockIndex.find(hash);
+                if (mi != mapBlockIndex.end() && (mi->second->nStatus & BLOCK_HAVE_DATA)) {
+                    LogPrint(BCLog::NET, "ignoring late duplicate block %s from reassigned peer=%d\n",
+                             hash.ToString(), pfrom->GetId());
+                    return true;
+                }
+            }
+            // Credit the delivery against this peer's persistent latency record
+            int64_t nTimeRequested = GetBlockRequestTime(hash, pfrom->GetId());
+            if (nTimeRequested) {
+                int64_t nLatency = GetTimeMicros() - nTimeRequested;
+                connman->RecordBlockDelivery(pfrom->addr, nLatency);
+                RecordBlockDeliverySample(pfrom->GetId(), nLatency);
+            }
             // Also always process if we requested the block explicitly, as we may
             // need it even though it is not a candidate for a new best tip.
             forceProcessing |= MarkBlockAsReceived(hash);
@@ -3045,12 +3592,36 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
 
     // Checksum
     CDataStream& vRecv = msg.vRecv;
-    const uint256& hash = msg.GetMessageHash();
-    if (memcmp(hash.begin(), hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) != 0)
+    bool fChecksumOk;
+    if (msg.fFastChecksum)
+    {
+        // The incremental SHA256d was skipped while this message was read.
+        // Check the cheap checksum, falling back to a one-shot SHA256d for
+        // messages the peer sent before it had processed our verack.
+        uint32_t nChecksum = FastMessageChecksum(nMessageSize ? (const unsigned char*)&vRecv[0] : nullptr, nMessageSize);
+        fChecksumOk = memcmp(&nChecksum, hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) == 0;
+        if (!fChecksumOk)
+        {
+            uint256 hash = Hash(vRecv.begin(), vRecv.begin() + nMessageSize);
+            fChecksumOk = memcmp(hash.begin(), hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) == 0;
+        }
+    }
+    else
+    {
+        const uint256& hash = msg.GetMessageHash();
+        fChecksumOk = memcmp(hash.begin(), hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) == 0;
+        if (!fChecksumOk && pfrom->fFastChecksum)
+        {
+            // The socket thread latched this message before the verack that
+            // enabled the cheap checksum was processed
+            uint32_t nChecksum = FastMessageChecksum(nMessageSize ? (const unsigned char*)&vRecv[0] : nullptr, nMessageSize);
+            fChecksumOk = memcmp(&nChecksum, hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) == 0;
+        }
+    }
+    if (!fChecksumOk)
     {
-        LogPrintf("%s(%s, %u bytes): CHECKSUM ERROR expected %s was %s\n", __func__,
+        LogPrintf("%s(%s, %u bytes): CHECKSUM ERROR was %s\n", __func__,
            SanitizeString(strCommand), nMessageSize,
-           HexStr(hash.begin(), hash.begin()+CMessageHeader::CHECKSUM_SIZE),
            HexStr(hdr.pchChecksum, hdr.pchChecksum+CMessageHeader::CHECKSUM_SIZE));
         return fMoreWork;
     }
@@ -3098,6 +3669,9 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         LogPrintf("%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
     }
 
+    // Recycle the drained buffer for this peer's next message
+    pfrom->ReturnRecvBuffer(msg);
+
     LOCK(cs_main);
     SendRejectsAndCheckIfBanned(pfrom, connman);
 
@@ -3233,23 +3807,6 @@ void PeerLogicValidation::CheckForStaleTipAndEvictPeers()
     }
 }
 
-class CompareInvMempoolOrder
-{
-    CTxMemPool *mp;
-public:
-    CompareInvMempoolOrder(CTxMemPool *_mempool)
-    {
-        mp = _mempool;
-    }
-
-    bool operator()(std::set<uint256>::iterator a, std::set<uint256>::iterator b)
-    {
-        /* As std::make_heap produces a max-heap, we want the entries with the
-         * fewest ancestors/highest fee to sort later. */
-        return mp->CompareDepthAndScore(*b, *a);
-    }
-};
-
 bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptMsgProc)
 {
     {
@@ -3299,7 +3856,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
 
         // Address refresh broadcast
         int64_t nNow = GetTimeMicros();
-        if (!IsInitialBlockDownload() && pto->nNextLocalAddrSend < nNow) {
+        if (!pto->fBlockRelayOnly && !IsInitialBlockDownload() && pto->nNextLocalAddrSend < nNow) {
             AdvertiseLocal(pto);
             pto->nNextLocalAddrSend = PoissonNextSend(nNow, AVG_LOCAL_ADDRESS_BROADCAST_INTERVAL);
         }
@@ -3307,7 +3864,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
         //
         // Message: addr
         //
-        if (pto->nNextAddrSend < nNow) {
+        if (!pto->fBlockRelayOnly && pto->nNextAddrSend < nNow) {
             pto->nNextAddrSend = PoissonNextSend(nNow, AVG_ADDRESS_BROADCAST_INTERVAL);
             std::vector<CAddress> vAddr;
             vAddr.reserve(pto->vAddrToSend.size());
@@ -3333,6 +3890,25 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                 pto->vAddrToSend.shrink_to_fit();
         }
 
+        //
+        // Message: gethotset / mempool (-standby)
+        //
+        // A standby node keeps its mempool and coins cache primed from its
+        // paired (whitelisted) peer, so a failover serves getblocktemplate
+        // at full speed right away. Blocks already arrive through normal
+        // relay; the mempool is requested once per connection and the coins
+        // hot set periodically. Peers without the message ignore it.
+        if (gArgs.GetBoolArg("-standby", DEFAULT_STANDBY) && pto->fWhitelisted) {
+            if (!state.m_mempool_requested) {
+                connman->PushMessage(pto, msgMaker.Make(NetMsgType::MEMPOOL));
+                state.m_mempool_requested = true;
+            }
+            if (nNow > state.m_last_hotset_request + HOTSET_REQUEST_INTERVAL * 1000000) {
+                connman->PushMessage(pto, msgMaker.Make(NetMsgType::GETHOTSET));
+                state.m_last_hotset_request = nNow;
+            }
+        }
+
         // Start block sync
         if (pindexBestHeader == nullptr)
             pindexBestHeader = chainActive.Tip();
@@ -3347,18 +3923,27 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
 //                state.nHeadersSyncTimeout = GetTimeMicros() + HEADERS_DOWNLOAD_TIMEOUT_BASE + HEADERS_DOWNLOAD_TIMEOUT_PER_HEADER * (GetAdjustedTime() - pindexBestHeader->GetBlockTime())/(consensusParams.nPowTargetSpacing);
                 state.nHeadersSyncTimeout = GetTimeMicros() + HEADERS_DOWNLOAD_TIMEOUT_BASE;
                 nSyncStarted++;
-                const CBlockIndex *pindexStart = pindexBestHeader;
-                /* If possible, start at the block preceding the currently
-                   best known header.  This ensures that we always get a
-                   non-empty list of headers back as long as the peer
-                   is up-to-date.  With a non-empty response, we can initialise
-                   the peer's known best block.  This wouldn't be possible
-                   if we requested starting at pindexBestHeader and
-                   got back an empty response.  */
-                if (pindexStart->pprev)
-                    pindexStart = pindexStart->pprev;
-                LogPrint(BCLog::NET, "initial getheaders (%d) to peer=%d (startheight:%d)\n", pindexStart->nHeight, pto->GetId(), pto->nStartingHeight);
-                connman->PushMessage(pto, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexStart), uint256()));
+                if ((pto->nServices & NODE_BULK_HEADERS) && pindexBestHeader->nHeight < Checkpoints::GetTotalBlocksEstimate()) {
+                    // Deep inside checkpointed history: pull headers in bulk
+                    // ranges instead of 2000-header locator round trips. The
+                    // bulkhdrs handler falls back to getheaders once the last
+                    // checkpoint is reached.
+                    LogPrint(BCLog::NET, "initial getbulkhdrs (%d) to peer=%d (startheight:%d)\n", pindexBestHeader->nHeight + 1, pto->GetId(), pto->nStartingHeight);
+                    connman->PushMessage(pto, msgMaker.Make(NetMsgType::GETBULKHEADERS, (::int32_t)(pindexBestHeader->nHeight + 1), (::uint32_t)BulkHeaders::MAX_BULK_HEADERS));
+                } else {
+                    const CBlockIndex *pindexStart = pindexBestHeader;
+                    /* If possible, start at the block preceding the currently
+                       best known header.  This ensures that we always get a
+                       non-empty list of headers back as long as the peer
+                       is up-to-date.  With a non-empty response, we can initialise
+                       the peer's known best block.  This wouldn't be possible
+                       if we requested starting at pindexBestHeader and
+                       got back an empty response.  */
+                    if (pindexStart->pprev)
+                        pindexStart = pindexStart->pprev;
+                    LogPrint(BCLog::NET, "initial getheaders (%d) to peer=%d (startheight:%d)\n", pindexStart->nHeight, pto->GetId(), pto->nStartingHeight);
+                    connman->PushMessage(pto, msgMaker.Make(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexStart), uint256()));
+                }
             }
         }
 
@@ -3437,7 +4022,29 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                 }
             }
             if (!fRevertToInv && !vHeaders.empty()) {
-                if (state.fPreferHeaders) {
+                if (vHeaders.size() == 1 && state.fPreferHeaderAndIDs) {
+                    // We only send up to 1 block as header-and-ids, as otherwise
+                    // probably means we're doing an initial-ish-sync or they're slow
+                    LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", __func__,
+                            vHeaders.front().GetHash().ToString(), pto->GetId());
+
+                    bool fGotBlockFromCache = false;
+                    {
+                        LOCK(cs_most_recent_block);
+                        if (most_recent_block_hash == pBestIndex->GetBlockHash()) {
+                            connman->PushMessage(pto, msgMaker.Make(NetMsgType::CMPCTBLOCK, *most_recent_compact_block));
+                            fGotBlockFromCache = true;
+                        }
+                    }
+                    if (!fGotBlockFromCache) {
+                        CBlock block;
+                        bool ret = ReadBlockFromDisk(block, pBestIndex, Params().GetConsensus());
+                        assert(ret);
+                        CBlockHeaderAndShortTxIDs cmpctblock(block, &mempool);
+                        connman->PushMessage(pto, msgMaker.Make(NetMsgType::CMPCTBLOCK, cmpctblock));
+                    }
+                    state.pindexBestHeaderSent = pBestIndex;
+                } else if (state.fPreferHeaders) {
                     if (vHeaders.size() > 1) {
                         LogPrint(BCLog::NET, "%s: %u headers, range (%s, %s), to peer=%d\n", __func__,
                                 vHeaders.size(),
@@ -3447,7 +4054,10 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                         LogPrint(BCLog::NET, "%s: sending header %s to peer=%d\n", __func__,
                                 vHeaders.front().GetHash().ToString(), pto->GetId());
                     }
-                    connman->PushMessage(pto, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
+                    if (pto->nServices & NODE_COMPACT_HEADERS)
+                        connman->PushMessage(pto, msgMaker.Make(NetMsgType::CMPCTHEADERS, CompressedHeaders(vHeaders)));
+                    else
+                        connman->PushMessage(pto, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
                     state.pindexBestHeaderSent = pBestIndex;
                 } else
                     fRevertToInv = true;
@@ -3507,15 +4117,20 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                 pto->nNextInvSend = PoissonNextSend(nNow, INVENTORY_BROADCAST_INTERVAL >> !pto->fInbound);
             }
 
-            // Time to send but the peer has requested we not relay transactions.
+            // Time to send but the peer has requested we not relay transactions,
+            // or the connection is block-relay-only.
             if (fSendTrickle) {
                 LOCK(pto->cs_filter);
-                if (!pto->fRelayTxes) pto->setInventoryTxToSend.clear();
+                if (!pto->fRelayTxes || pto->fBlockRelayOnly) {
+                    // Skip everything queued up so far
+                    LOCK(cs_txAnnouncements);
+                    pto->nNextTxAnnouncementSeq = nTxAnnouncementSequence + 1;
+                }
             }
 
             // Respond to BIP35 mempool requests
             if (fSendTrickle && pto->fSendMempool) {
-                auto vtxinfo = mempool.infoAll();
+                auto vtxinfo = mempool.GetSnapshot();
                 pto->fSendMempool = false;
                 CAmount filterrate = 0;
                 {
@@ -3525,10 +4140,9 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
 
                 LOCK(pto->cs_filter);
 
-                for (const auto& txinfo : vtxinfo) {
+                for (const auto& txinfo : *vtxinfo) {
                     const uint256& hash = txinfo.tx->GetHash();
                     CInv inv(MSG_TX, hash);
-                    pto->setInventoryTxToSend.erase(hash);
                     if (filterrate) {
                         if (txinfo.feeRate.GetFeePerK() < filterrate)
                             continue;
@@ -3548,48 +4162,60 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
 
             // Determine transactions to relay
             if (fSendTrickle) {
-                // Produce a vector with all candidates for sending
-                std::vector<std::set<uint256>::iterator> vInvTx;
-                vInvTx.reserve(pto->setInventoryTxToSend.size());
-                for (std::set<uint256>::iterator it = pto->setInventoryTxToSend.begin(); it != pto->setInventoryTxToSend.end(); it++) {
-                    vInvTx.push_back(it);
-                }
                 CAmount filterrate = 0;
                 {
                     LOCK(pto->cs_feeFilter);
                     filterrate = pto->minFeeFilter;
                 }
-                // Topologically and fee-rate sort the inventory we send for privacy and priority reasons.
-                // A heap is used so that not all items need sorting if only a few are being sent.
-                CompareInvMempoolOrder compareInvMempoolOrder(&mempool);
-                std::make_heap(vInvTx.begin(), vInvTx.end(), compareInvMempoolOrder);
-                // No reason to drain out at many times the network's capacity,
-                // especially since we have many peers and some will draw much shorter delays.
+                // Does this peer have a filter that actually needs element matching?
+                bool fWantElements = false;
+                {
+                    LOCK(pto->cs_filter);
+                    fWantElements = pto->pfilter && !pto->pfilter->IsTrivial();
+                }
+                // Grab this peer's unseen tail of the shared announcement batch
+                std::vector<CTxAnnouncement> vAnn;
+                {
+                    LOCK(cs_txAnnouncements);
+                    if (pto->nNextTxAnnouncementSeq == 0) {
+                        // Fresh peer: only announce transactions relayed from now on
+                        pto->nNextTxAnnouncementSeq = nTxAnnouncementSequence + 1;
+                    }
+                    std::deque<CTxAnnouncement>::iterator itAnn = std::lower_bound(
+                            vTxAnnouncements.begin(), vTxAnnouncements.end(), pto->nNextTxAnnouncementSeq,
+                            [](const CTxAnnouncement& ann, uint64_t seq) { return ann.nSequence < seq; });
+                    if (fWantElements) {
+                        // Extract matchable elements into the shared batch so later
+                        // bloom-filter peers reuse them; each tx is parsed at most once
+                        for (std::deque<CTxAnnouncement>::iterator it = itAnn; it != vTxAnnouncements.end(); ++it) {
+                            if (!it->elements)
+                                it->elements = std::make_shared<const CTxBloomElements>(*it->tx);
+                        }
+                    }
+                    vAnn.assign(itAnn, vTxAnnouncements.end());
+                }
                 unsigned int nRelayedTransactions = 0;
                 LOCK(pto->cs_filter);
-                while (!vInvTx.empty() && nRelayedTransactions < INVENTORY_BROADCAST_MAX) {
-                    // Fetch the top element from the heap
-                    std::pop_heap(vInvTx.begin(), vInvTx.end(), compareInvMempoolOrder);
-                    std::set<uint256>::iterator it = vInvTx.back();
-                    vInvTx.pop_back();
-                    uint256 hash = *it;
-                    // Remove it from the to-be-sent set
-                    pto->setInventoryTxToSend.erase(it);
+                for (const CTxAnnouncement& ann : vAnn) {
+                    // No reason to drain out at many times the network's capacity,
+                    // especially since we have many peers and some will draw much shorter delays.
+                    if (nRelayedTransactions >= INVENTORY_BROADCAST_MAX)
+                        break;
+                    pto->nNextTxAnnouncementSeq = ann.nSequence + 1;
                     // Check if not in the filter already
-                    if (pto->filterInventoryKnown.contains(hash)) {
+                    if (pto->filterInventoryKnown.contains(ann.hash)) {
                         continue;
                     }
-                    // Not in the mempool anymore? don't bother sending it.
-                    auto txinfo = mempool.info(hash);
-                    if (!txinfo.tx) {
+                    if (filterrate && ann.nFeePerK < filterrate) {
                         continue;
                     }
-                    if (filterrate && txinfo.feeRate.GetFeePerK() < filterrate) {
-                        continue;
+                    if (pto->pfilter) {
+                        bool fRelevant = ann.elements ? pto->pfilter->IsRelevantAndUpdate(*ann.tx, *ann.elements)
+                                                      : pto->pfilter->IsRelevantAndUpdate(*ann.tx);
+                        if (!fRelevant) continue;
                     }
-                    if (pto->pfilter && !pto->pfilter->IsRelevantAndUpdate(*txinfo.tx)) continue;
                     // Send
-                    vInv.push_back(CInv(MSG_TX, hash));
+                    vInv.push_back(CInv(MSG_TX, ann.hash));
                     nRelayedTransactions++;
                     {
                         // Expire old relay messages
@@ -3599,16 +4225,16 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                             vRelayExpiration.pop_front();
                         }
 
-                        auto ret = mapRelay.insert(std::make_pair(hash, std::move(txinfo.tx)));
+                        auto ret = mapRelay.insert(std::make_pair(ann.hash, ann.tx));
                         if (ret.second) {
-                            vRelayExpiration.push_back(std::make_pair(nNow + 15 * 60 * 1000000, ret.first));
+                            vRelayExpiration.push_back(std::make_pair(nNow + 15 * 60 * 1000000, ann.hash));
                         }
                     }
                     if (vInv.size() == MAX_INV_SZ) {
                         connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
                         vInv.clear();
                     }
-                    pto->filterInventoryKnown.insert(hash);
+                    pto->filterInventoryKnown.insert(ann.hash);
                 }
             }
         }
@@ -3622,6 +4248,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
             // the download window should be much larger than the to-be-downloaded set of blocks, so disconnection
             // should only happen during initial block download.
             LogPrintf("Peer=%d is stalling block download, disconnecting\n", pto->GetId());
+            connman->RecordBlockStall(pto->addr);
             pto->fDisconnect = true;
             return true;
         }
@@ -3642,6 +4269,42 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                 return true;
             }
         }
+
+        // Detect statistically whether this peer has gone slow mid-flight, long
+        // before the hard timeout above: once we have enough delivery samples,
+        // a request outstanding much longer than the peer's own 90th-percentile
+        // delivery time is treated as stalled. The in-flight blocks are released
+        // back to the download scheduler so other peers pick them up on their
+        // next SendMessages pass; the peer itself stays connected, it just
+        // doesn't get those blocks re-assigned. Only done when we actually have
+        // another peer to download from.
+        if (state.vBlocksInFlight.size() > 0 && pto->vProcessMsg.empty() &&
+                (nPreferredDownload - state.fPreferredDownload >= 1)) {
+            int64_t nP90 = GetBlockDeliveryP90(state);
+            if (nP90 > 0) {
+                int64_t nDeadline = nP90 * BLOCK_DELIVERY_STALL_FACTOR;
+                if (nDeadline < BLOCK_DELIVERY_STALL_FLOOR)
+                    nDeadline = BLOCK_DELIVERY_STALL_FLOOR;
+                if (nNow > state.vBlocksInFlight.front().nTimeRequested + nDeadline) {
+                    LogPrint(BCLog::NET, "Peer=%d fell behind its own delivery history (%d blocks outstanding %.1fs, p90 %.1fs), rescheduling\n",
+                             pto->GetId(), state.nBlocksInFlight,
+                             (nNow - state.vBlocksInFlight.front().nTimeRequested) / 1e6, nP90 / 1e6);
+                    connman->RecordBlockStall(pto->addr);
+                    // MarkBlockAsReceived mutates vBlocksInFlight, so collect the hashes first
+                    std::vector<uint256> vReassign;
+                    for (const QueuedBlock& queuedBlock : state.vBlocksInFlight)
+                        vReassign.push_back(queuedBlock.hash);
+                    // Bound the memory of a peer that keeps getting rescheduled
+                    if (state.setReassignedBlocks.size() > 256)
+                        state.setReassignedBlocks.clear();
+                    for (const uint256& hash : vReassign) {
+                        state.setReassignedBlocks.insert(hash);
+                        MarkBlockAsReceived(hash);
+                    }
+                }
+            }
+        }
+
         // Check for headers sync timeouts
         if (state.fSyncStarted && state.nHeadersSyncTimeout < std::numeric_limits<int64_t>::max()) {
             // Detect whether this is a stalling initial-headers-sync peer
@@ -3683,7 +4346,13 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
         // Message: getdata (blocks)
         //
         std::vector<CInv> vGetData;
-        if (!pto->fClient && (fFetch || !IsInitialBlockDownload()) && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER
+        // The header chain ahead of us is already validated (cheap PoW check),
+        // so during IBD we can safely schedule out-of-order block downloads
+        // from every capable peer - not only the preferred ones - and let the
+        // download window feed ActivateBestChain. Oneshot and light peers stay
+        // excluded.
+        bool fFetchBlocks = fFetch || !IsInitialBlockDownload() || (!pto->fOneShot && !pto->fFeeler);
+        if (!pto->fClient && fFetchBlocks && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER
                 && (!state.fSyncStarted // Not download block from initial-header-sync node
                         || (pindexBestHeader->GetBlockTime() > GetAdjustedTime() - 24 * 60 * 60) // Unless best header close to today
                         || connman->GetNodeCount(CConnman::NumConnections::CONNECTIONS_ALL) == 1)) { // or there is only 1 connected node
@@ -3691,6 +4360,9 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
             NodeId staller = -1;
             FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
             for (const CBlockIndex *pindex : vToDownload) {
+                // Don't hand a block back to the peer it was just taken away from
+                if (state.setReassignedBlocks.count(pindex->GetBlockHash()))
+                    continue;
                 uint32_t nFetchFlags = GetFetchFlags(pto);
                 vGetData.push_back(CInv(MSG_BLOCK | nFetchFlags, pindex->GetBlockHash()));
                 MarkBlockAsInFlight(pto->GetId(), pindex->GetBlockHash(), pindex);
@@ -3757,7 +4429,6 @@ public:
     CNetProcessingCleanup() {}
     ~CNetProcessingCleanup() {
         // orphan transactions
-        mapOrphanTransactions.clear();
-        mapOrphanTransactionsByPrev.clear();
+        orphanPool.Clear();
     }
 } instance_of_cnetprocessingcleanup;
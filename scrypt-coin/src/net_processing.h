@@ -7,11 +7,14 @@
 #define BITCOIN_NET_PROCESSING_H
 
 #include "net.h"
+#include "txmempool.h"
 #include "validationinterface.h"
 #include <boost/array.hpp>
 
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
+/** Upper bound on total serialized bytes of orphan transactions kept in memory */
+static const size_t DEFAULT_MAX_ORPHAN_TX_BYTES = 10 * 1000 * 1000;
 /** The maximum size for transactions we're willing to relay/mine */
 static const unsigned int MAX_STANDARD_TX_SIZE = 100000;
 /** Expiration time for orphan transactions in seconds */
@@ -21,6 +24,8 @@ static const int64_t ORPHAN_TX_EXPIRE_INTERVAL = 5 * 60;
 /** Default number of orphan+recently-replaced txn to keep around for block reconstruction */
 static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
+/** Default for -standby: prime mempool and coins cache from whitelisted peers */
+static const bool DEFAULT_STANDBY = false;
 /** Protect at least this many outbound peers from disconnection due to slow/
  * behind headers chain.
  */
@@ -36,7 +41,7 @@ static constexpr int64_t MINIMUM_CONNECT_TIME = 30;
 
 extern CCriticalSection cs_main;
 extern boost::mutex mapHashmutex;
-extern std::map<uint256, uint256> mapHash; // map of (SHA256-hash, chacha-hash)
+extern std::unordered_map<uint256, uint256, SaltedTxidHasher> mapHash; // map of (SHA256-hash, chacha-hash)
 extern int nHashCalcThreads;
 
 class PeerLogicValidation : public CValidationInterface, public NetEventsInterface {
@@ -112,7 +117,7 @@ void ThreadHashCalculation();
 void ThreadHashCalculationQuit();
 
 /* Wallet functions */
-void RelayTransaction(const CTransaction& tx, CConnman* connman);
+void RelayTransaction(const CTransactionRef& ptx, CConnman* connman);
 
 class CTransaction;
 #endif // BITCOIN_NET_PROCESSING_H
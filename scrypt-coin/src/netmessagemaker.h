@@ -20,6 +20,11 @@ public:
     {
         CSerializedNetMsg msg;
         msg.command = std::move(sCommand);
+        // Size the payload up front so serialization performs at most one
+        // allocation; block-sized buffers come back out of the shared pool.
+        size_t nExpectedSize = GetSerializeSizeMany(SER_NETWORK, nFlags | nVersion, args...);
+        msg.data = CSerializeBufferPool::Acquire(nExpectedSize);
+        msg.data.reserve(nExpectedSize);
         CVectorWriter{ SER_NETWORK, nFlags | nVersion, msg.data, 0, std::forward<Args>(args)... };
         return msg;
     }
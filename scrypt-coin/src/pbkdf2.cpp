@@ -146,3 +146,200 @@ PBKDF2_SHA256(const uint8_t * passwd, size_t passwdlen, const uint8_t * salt,
     memset(&PShctx, 0, sizeof(HMAC_SHA256_CTX));
 }
 
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__))
+
+#include "crypto/sha256.h"
+
+namespace sha256_avx2_mb
+{
+void Initialize_8way(uint32_t* s);
+void Transform_8way(uint32_t* s, const unsigned char* in);
+}
+
+/* Largest salt the lane-packed path handles; scrypt passes at most 128. */
+#define PBKDF2_8WAY_MAX_SALT 192
+
+static inline void
+be64enc(void *pp, uint64_t x)
+{
+    uint8_t * p = (uint8_t *)pp;
+    int i;
+
+    for (i = 0; i < 8; i++)
+        p[i] = (x >> (56 - 8 * i)) & 0xff;
+}
+
+/* Derive the HMAC key pads for one lane (key hashed first if > 64 bytes). */
+static void
+pbkdf2_hmac_pads(const uint8_t * K, size_t Klen, uint8_t ipad[64], uint8_t opad[64])
+{
+    uint8_t khash[32];
+    size_t i;
+
+    if (Klen > 64) {
+        SHA256_CTX ctx;
+        SHA256_Init(&ctx);
+        SHA256_Update(&ctx, K, Klen);
+        SHA256_Final(khash, &ctx);
+        K = khash;
+        Klen = 32;
+    }
+    memset(ipad, 0x36, 64);
+    memset(opad, 0x5c, 64);
+    for (i = 0; i < Klen; i++) {
+        ipad[i] ^= K[i];
+        opad[i] ^= K[i];
+    }
+    memset(khash, 0, 32);
+}
+
+/* Scatter the eight lane digests out of a word-major 8-way state. */
+static void
+pbkdf2_extract_8way(const uint32_t s[64], uint8_t digest[8][32])
+{
+    size_t l;
+    int w;
+
+    for (l = 0; l < 8; l++)
+        for (w = 0; w < 8; w++)
+            be32enc(digest[l] + 4 * w, s[8 * w + l]);
+}
+
+/*
+ * One compression of a 32-byte message per lane, starting from the given
+ * post-pad state. The padded block layout (message, 0x80, 768-bit length)
+ * is the same for the inner U_j hashing and the outer finalisation, so
+ * both go through here; msg is replaced by the resulting digests.
+ */
+static void
+pbkdf2_hash32_8way(const uint32_t state[64], uint8_t msg[8][32])
+{
+    uint32_t s[64];
+    uint8_t block[8 * 64];
+    size_t l;
+
+    memcpy(s, state, sizeof(s));
+    for (l = 0; l < 8; l++) {
+        memcpy(block + 64 * l, msg[l], 32);
+        memset(block + 64 * l + 32, 0, 32);
+        block[64 * l + 32] = 0x80;
+        be64enc(block + 64 * l + 56, (64 + 32) * 8);
+    }
+    sha256_avx2_mb::Transform_8way(s, block);
+    pbkdf2_extract_8way(s, msg);
+}
+
+/*
+ * Lane-packed PBKDF2: all eight messages have identical lengths, so the
+ * eight SHA256 streams stay in lockstep and every compression runs through
+ * the 8-way AVX2 transform, one stream per 32-bit lane.
+ */
+static void
+pbkdf2_sha256_8way_avx2(const uint8_t * const passwd[8], size_t passwdlen,
+    const uint8_t * const salt[8], size_t saltlen, uint64_t c,
+    uint8_t * const buf[8], size_t dkLen)
+{
+    uint32_t istate[64], ostate[64], s[64];
+    uint8_t ipad[8][64], opad[8][64];
+    uint8_t block[8 * 64];
+    uint8_t tail[8][PBKDF2_8WAY_MAX_SALT + 4 + 72];
+    uint8_t U[8][32], T[8][32];
+    uint8_t ivec[4];
+    size_t i, k, l, clen;
+    size_t msglen = saltlen + 4;
+    size_t tailblocks = (msglen + 9 + 63) / 64;
+    uint64_t j;
+    int w;
+
+    /* States after the key pad blocks, shared by every output block. */
+    for (l = 0; l < 8; l++)
+        pbkdf2_hmac_pads(passwd[l], passwdlen, ipad[l], opad[l]);
+
+    sha256_avx2_mb::Initialize_8way(istate);
+    for (l = 0; l < 8; l++)
+        memcpy(block + 64 * l, ipad[l], 64);
+    sha256_avx2_mb::Transform_8way(istate, block);
+
+    sha256_avx2_mb::Initialize_8way(ostate);
+    for (l = 0; l < 8; l++)
+        memcpy(block + 64 * l, opad[l], 64);
+    sha256_avx2_mb::Transform_8way(ostate, block);
+
+    /* Iterate through the blocks. */
+    for (i = 0; i * 32 < dkLen; i++) {
+        /* Generate INT(i + 1). */
+        be32enc(ivec, (uint32_t)(i + 1));
+
+        /* Compute U_1 = PRF(P, S || INT(i)). */
+        memcpy(s, istate, sizeof(s));
+        for (l = 0; l < 8; l++) {
+            memcpy(tail[l], salt[l], saltlen);
+            memcpy(tail[l] + saltlen, ivec, 4);
+            memset(tail[l] + msglen, 0, tailblocks * 64 - msglen);
+            tail[l][msglen] = 0x80;
+            be64enc(tail[l] + tailblocks * 64 - 8, (uint64_t)(64 + msglen) * 8);
+        }
+        for (k = 0; k < tailblocks; k++) {
+            for (l = 0; l < 8; l++)
+                memcpy(block + 64 * l, tail[l] + 64 * k, 64);
+            sha256_avx2_mb::Transform_8way(s, block);
+        }
+        pbkdf2_extract_8way(s, U);
+        pbkdf2_hash32_8way(ostate, U);
+
+        /* T_i = U_1 ... */
+        for (l = 0; l < 8; l++)
+            memcpy(T[l], U[l], 32);
+
+        for (j = 2; j <= c; j++) {
+            /* Compute U_j. */
+            pbkdf2_hash32_8way(istate, U);
+            pbkdf2_hash32_8way(ostate, U);
+
+            /* ... xor U_j ... */
+            for (l = 0; l < 8; l++)
+                for (w = 0; w < 32; w++)
+                    T[l][w] ^= U[l][w];
+        }
+
+        /* Copy as many bytes as necessary into each lane's buf. */
+        clen = dkLen - i * 32;
+        if (clen > 32)
+            clen = 32;
+        for (l = 0; l < 8; l++)
+            memcpy(&buf[l][i * 32], T[l], clen);
+    }
+
+    /* Clean the pad-derived states. */
+    memset(istate, 0, sizeof(istate));
+    memset(ostate, 0, sizeof(ostate));
+    memset(ipad, 0, sizeof(ipad));
+    memset(opad, 0, sizeof(opad));
+}
+
+#endif /* ENABLE_AVX2 && x86_64 */
+
+/**
+ * PBKDF2_SHA256_8way(passwd, passwdlen, salt, saltlen, c, buf, dkLen):
+ * Compute PBKDF2(passwd[l], salt[l], c, dkLen) for eight independent
+ * lanes of equal lengths. Runs all eight HMAC-SHA256 streams through the
+ * 8-way AVX2 SHA256 transform when available, scalar otherwise.
+ */
+void
+PBKDF2_SHA256_8way(const uint8_t * const passwd[8], size_t passwdlen,
+    const uint8_t * const salt[8], size_t saltlen, uint64_t c,
+    uint8_t * const buf[8], size_t dkLen)
+{
+    size_t l;
+
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__))
+    if (SHA256Has8WayAVX2() && saltlen <= PBKDF2_8WAY_MAX_SALT) {
+        pbkdf2_sha256_8way_avx2(passwd, passwdlen, salt, saltlen, c, buf, dkLen);
+        return;
+    }
+#endif
+
+    for (l = 0; l < 8; l++)
+        PBKDF2_SHA256(passwd[l], passwdlen, salt[l], saltlen, c, buf[l], dkLen);
+}
+
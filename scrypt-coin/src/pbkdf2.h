@@ -24,4 +24,17 @@ void
 PBKDF2_SHA256(const uint8_t * passwd, size_t passwdlen, const uint8_t * salt,
     size_t saltlen, uint64_t c, uint8_t * buf, size_t dkLen);
 
+/*
+ * Multi-buffer PBKDF2: derive keys for eight independent (passwd, salt)
+ * pairs of equal lengths at once. When SHA256AutoDetect() has enabled the
+ * AVX2 transform, the eight HMAC-SHA256 streams run in lockstep, one per
+ * 32-bit SIMD lane; otherwise this falls back to eight scalar
+ * PBKDF2_SHA256 calls. Intended for the scrypt prologue/epilogue when
+ * several verifications are in flight.
+ */
+void
+PBKDF2_SHA256_8way(const uint8_t * const passwd[8], size_t passwdlen,
+    const uint8_t * const salt[8], size_t saltlen, uint64_t c,
+    uint8_t * const buf[8], size_t dkLen);
+
 #endif // PBKDF2_H
@@ -6,6 +6,13 @@
 
 #include "fees.h"
 
+#include "clientversion.h"
+#include "fs.h"
+#include "streams.h"
+#include "util.h"
+
+#include <math.h>
+
 ::int64_t GetMinFee(unsigned int nBytes)
 {
     // Fee-per-kilobyte amount considered the same as "free"
@@ -14,4 +21,146 @@
     // 1-satoshi-fee transactions. It should be set above the real
     // cost to you of processing a transaction.
     return (nBytes * MIN_TX_FEE) / 1000;
-}
\ No newline at end of file
+}
+
+CBlockPolicyEstimator feeEstimator;
+
+static const uint64_t FEE_EST_FILE_VERSION = 1;
+//! Fixed-point scale used to serialize the bucket weights
+static const double FEE_EST_WEIGHT_SCALE = 1e6;
+
+/** Upper fee-rate boundary of a bucket, in satoshis per kB. Bucket 0 holds
+ *  everything at the minimum fee; boundaries then grow geometrically. The
+ *  last bucket is open-ended. */
+static CAmount BucketMaxFeePerK(unsigned int nBucket)
+{
+    return (CAmount)(MIN_TX_FEE * pow(FEE_EST_BUCKET_SPACING, (double)(nBucket + 1)));
+}
+
+static unsigned int BucketIndex(CAmount nFeePerK)
+{
+    for (unsigned int i = 0; i < FEE_EST_BUCKET_COUNT - 1; i++) {
+        if (nFeePerK < BucketMaxFeePerK(i))
+            return i;
+    }
+    return FEE_EST_BUCKET_COUNT - 1;
+}
+
+CFeeEstimateSnapshot::CFeeEstimateSnapshot() : dTotalWeight(0.0), nBlocksSeen(0)
+{
+    for (unsigned int i = 0; i < FEE_EST_BUCKET_COUNT; i++)
+        vBucketWeight[i] = 0.0;
+}
+
+CAmount CFeeEstimateSnapshot::EstimateFeePerK(double dPercentile) const
+{
+    if (dTotalWeight <= 0.0)
+        return MIN_TX_FEE;
+    double dTarget = dTotalWeight * dPercentile;
+    double dCumulative = 0.0;
+    for (unsigned int i = 0; i < FEE_EST_BUCKET_COUNT; i++) {
+        dCumulative += vBucketWeight[i];
+        if (dCumulative >= dTarget)
+            return std::max((CAmount)MIN_TX_FEE, BucketMaxFeePerK(i));
+    }
+    return BucketMaxFeePerK(FEE_EST_BUCKET_COUNT - 1);
+}
+
+CBlockPolicyEstimator::CBlockPolicyEstimator() : nBlocksSeen(0)
+{
+    for (unsigned int i = 0; i < FEE_EST_BUCKET_COUNT; i++)
+        vBucketWeight[i] = 0.0;
+}
+
+void CBlockPolicyEstimator::PublishSnapshot()
+{
+    std::shared_ptr<CFeeEstimateSnapshot> snap = std::make_shared<CFeeEstimateSnapshot>();
+    double dTotal = 0.0;
+    for (unsigned int i = 0; i < FEE_EST_BUCKET_COUNT; i++) {
+        snap->vBucketWeight[i] = vBucketWeight[i];
+        dTotal += vBucketWeight[i];
+    }
+    snap->dTotalWeight = dTotal;
+    snap->nBlocksSeen = nBlocksSeen;
+    std::atomic_store(&snapshot, std::shared_ptr<const CFeeEstimateSnapshot>(snap));
+}
+
+void CBlockPolicyEstimator::ProcessBlock(const std::vector<CAmount>& vFeeRatesPerK)
+{
+    LOCK(cs_feeEstimator);
+    for (unsigned int i = 0; i < FEE_EST_BUCKET_COUNT; i++)
+        vBucketWeight[i] *= FEE_EST_DECAY;
+    for (const CAmount& nFeePerK : vFeeRatesPerK)
+        vBucketWeight[BucketIndex(nFeePerK)] += 1.0;
+    nBlocksSeen++;
+    PublishSnapshot();
+}
+
+CAmount CBlockPolicyEstimator::EstimateFeePerK(double dPercentile) const
+{
+    std::shared_ptr<const CFeeEstimateSnapshot> snap = std::atomic_load(&snapshot);
+    if (!snap)
+        return MIN_TX_FEE;
+    return snap->EstimateFeePerK(dPercentile);
+}
+
+unsigned int CBlockPolicyEstimator::GetBlocksSeen() const
+{
+    std::shared_ptr<const CFeeEstimateSnapshot> snap = std::atomic_load(&snapshot);
+    return snap ? snap->nBlocksSeen : 0;
+}
+
+bool CBlockPolicyEstimator::Write() const
+{
+    try {
+        FILE* filestr = fsbridge::fopen(GetDataDir() / "fee_estimates.dat.new", "wb");
+        if (!filestr)
+            return false;
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        file << FEE_EST_FILE_VERSION;
+        file << (uint32_t)FEE_EST_BUCKET_COUNT;
+        {
+            LOCK(cs_feeEstimator);
+            file << (uint32_t)nBlocksSeen;
+            for (unsigned int i = 0; i < FEE_EST_BUCKET_COUNT; i++)
+                file << (uint64_t)(vBucketWeight[i] * FEE_EST_WEIGHT_SCALE);
+        }
+        FileCommit(file.Get());
+        file.fclose();
+        RenameOver(GetDataDir() / "fee_estimates.dat.new", GetDataDir() / "fee_estimates.dat");
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to write fee estimates: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    return true;
+}
+
+bool CBlockPolicyEstimator::Read()
+{
+    try {
+        FILE* filestr = fsbridge::fopen(GetDataDir() / "fee_estimates.dat", "rb");
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        if (file.IsNull())
+            return false;
+        uint64_t nVersion = 0;
+        uint32_t nBuckets = 0;
+        file >> nVersion;
+        file >> nBuckets;
+        if (nVersion != FEE_EST_FILE_VERSION || nBuckets != FEE_EST_BUCKET_COUNT)
+            return false;
+        LOCK(cs_feeEstimator);
+        uint32_t nBlocks = 0;
+        file >> nBlocks;
+        nBlocksSeen = nBlocks;
+        for (unsigned int i = 0; i < FEE_EST_BUCKET_COUNT; i++) {
+            uint64_t nWeight = 0;
+            file >> nWeight;
+            vBucketWeight[i] = nWeight / FEE_EST_WEIGHT_SCALE;
+        }
+        PublishSnapshot();
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to read fee estimates: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    return true;
+}
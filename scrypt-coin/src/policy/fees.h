@@ -7,10 +7,82 @@
 #define YACOIN_POLICYFEE_H
 
 #include "amount.h"
+#include "sync.h"
+
+#include <memory>
+#include <vector>
 
 static const ::int64_t MIN_TX_FEE = CENT;
 static const ::int64_t MIN_RELAY_TX_FEE = MIN_TX_FEE;
 
 ::int64_t GetMinFee(unsigned int nBytes);
 
+/** Number of fixed fee-rate buckets tracked by the estimator */
+static const unsigned int FEE_EST_BUCKET_COUNT = 36;
+/** Multiplicative spacing between adjacent bucket boundaries */
+static const double FEE_EST_BUCKET_SPACING = 1.3;
+/** Exponential decay applied to every bucket per connected block; at 0.995
+ *  the half life is roughly 139 blocks, so the estimate tracks congestion on
+ *  the scale of a couple of hours without whipsawing on single blocks. */
+static const double FEE_EST_DECAY = 0.995;
+
+/**
+ * Immutable view of the estimator's bucket weights, published as a whole
+ * after every processed block. Readers grab it with std::atomic_load and
+ * never touch the estimator's lock, so estimatefee cannot block on block
+ * connection no matter how busy tracking is.
+ */
+class CFeeEstimateSnapshot
+{
+public:
+    double vBucketWeight[FEE_EST_BUCKET_COUNT];
+    double dTotalWeight;
+    unsigned int nBlocksSeen;
+
+    CFeeEstimateSnapshot();
+    /** Fee rate (satoshis per kB) at or below which the given fraction of
+     *  recently confirmed transactions paid, floored at MIN_TX_FEE. */
+    CAmount EstimateFeePerK(double dPercentile) const;
+};
+
+/**
+ * Fee-rate tracker over the confirmed transactions we had in our mempool.
+ * The state is a fixed array of exponentially decayed per-bucket weights, so
+ * each block costs O(txs in block + buckets) to fold in, independent of
+ * mempool size, and the whole state fits in a few hundred bytes.
+ *
+ * The chain's minimum fee is fixed by policy (GetMinFee), so the estimator's
+ * job is only to report how far above that minimum recently confirmed
+ * traffic has been paying during congestion.
+ */
+class CBlockPolicyEstimator
+{
+public:
+    CBlockPolicyEstimator();
+
+    /** Fold one connected block's confirmed fee rates (satoshis per kB) into
+     *  the buckets, decay, and publish a fresh read snapshot. */
+    void ProcessBlock(const std::vector<CAmount>& vFeeRatesPerK);
+
+    /** Lock-free: reads the latest published snapshot. */
+    CAmount EstimateFeePerK(double dPercentile) const;
+
+    /** Lock-free: number of blocks folded into the current snapshot. */
+    unsigned int GetBlocksSeen() const;
+
+    /** Persist/restore the bucket weights (fee_estimates.dat). */
+    bool Write() const;
+    bool Read();
+
+private:
+    void PublishSnapshot();
+
+    mutable CCriticalSection cs_feeEstimator;
+    double vBucketWeight[FEE_EST_BUCKET_COUNT];
+    unsigned int nBlocksSeen;
+    std::shared_ptr<const CFeeEstimateSnapshot> snapshot;
+};
+
+extern CBlockPolicyEstimator feeEstimator;
+
 #endif // YACOIN_POLICYFEE_H
@@ -0,0 +1,79 @@
+// Copyright (c) 2017-2025 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "powcache.h"
+
+#include <vector>
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
+namespace {
+
+/** Fixed-size direct-mapped cache in the spirit of cuckoocache.h: an entry is
+ * simply overwritten on an index collision, readers take a shared lock so
+ * concurrent verification threads never serialize on lookups. 1<<16 entries
+ * of two uint256 each is a fixed 4 MiB.
+ *
+ * The key is itself a hash of the header, so the low word is as good a bucket
+ * index as anything a hasher could produce.
+ */
+class CPowHashCache
+{
+private:
+    struct CEntry
+    {
+        uint256 hashSHA256d;
+        uint256 hashScrypt;
+    };
+
+    static const size_t POW_HASH_CACHE_ENTRIES = 1 << 16;
+
+    std::vector<CEntry> vEntries;
+    boost::shared_mutex cs_powcache;
+
+    size_t BucketOf(const uint256& hashSHA256d) const
+    {
+        return (size_t)(hashSHA256d.Get64() % POW_HASH_CACHE_ENTRIES);
+    }
+
+public:
+    CPowHashCache() : vEntries(POW_HASH_CACHE_ENTRIES) {}
+
+    bool Get(const uint256& hashSHA256d, uint256& hashScrypt)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_powcache);
+        const CEntry& entry = vEntries[BucketOf(hashSHA256d)];
+        if (entry.hashSHA256d != hashSHA256d)
+            return false;
+        hashScrypt = entry.hashScrypt;
+        return true;
+    }
+
+    void Set(const uint256& hashSHA256d, const uint256& hashScrypt)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_powcache);
+        CEntry& entry = vEntries[BucketOf(hashSHA256d)];
+        entry.hashSHA256d = hashSHA256d;
+        entry.hashScrypt = hashScrypt;
+    }
+};
+
+CPowHashCache& PowHashCache()
+{
+    static CPowHashCache cache;
+    return cache;
+}
+
+} // namespace
+
+bool GetPowHashCache(const uint256& hashSHA256d, uint256& hashScrypt)
+{
+    return PowHashCache().Get(hashSHA256d, hashScrypt);
+}
+
+void SetPowHashCache(const uint256& hashSHA256d, const uint256& hashScrypt)
+{
+    PowHashCache().Set(hashSHA256d, hashScrypt);
+}
@@ -0,0 +1,24 @@
+// Copyright (c) 2017-2025 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_POWCACHE_H
+#define BITCOIN_POWCACHE_H
+
+#include "uint256.h"
+
+/** Process-wide cache of scrypt proof-of-work hashes, keyed by the cheap
+ *  SHA256d hash of the serialized header. Distinct CBlockHeader objects are
+ *  created for the same header on several paths (header acceptance, full
+ *  block check, reorg re-connect); the per-object blockHash member does not
+ *  help there, this cache makes each header pay the scrypt-jane cost exactly
+ *  once per process.
+ */
+
+/** Look up a previously computed scrypt hash. Returns false on miss. */
+bool GetPowHashCache(const uint256& hashSHA256d, uint256& hashScrypt);
+
+/** Remember the scrypt hash for a header. */
+void SetPowHashCache(const uint256& hashSHA256d, const uint256& hashScrypt);
+
+#endif // BITCOIN_POWCACHE_H
@@ -7,6 +7,7 @@
 #include "addressindex.h"
 #include "tokens/tokendb.h"
 #include "primitives/block.h"
+#include "crypto/sha256.h"
 #include "txdb.h"
 #include "checkpoints.h"
 #include "kernel.h"
@@ -15,6 +16,9 @@
 #include "net_processing.h"
 #include "keystore.h"
 
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
 using std::vector;
 using std::map;
 using std::set;
@@ -33,6 +37,34 @@ CCriticalSection cs_nBlockSequenceId;
 // Blocks loaded from disk are assigned id 0, so start the counter at 1.
 uint32_t nBlockSequenceId = 1;
 
+// Levels smaller than this hash faster serially than the workers spin up
+static const size_t nMerkleParallelMinPairs = 2048;
+
+void MerkleHashLevel(uint256* out, const uint256* in, size_t nPairs)
+{
+    size_t nThreads = std::min(nPairs / nMerkleParallelMinPairs + 1,
+                               (size_t)std::max(1, nHashCalcThreads));
+    if (nThreads <= 1)
+    {
+        SHA256D64(out->begin(), in->begin(), nPairs);
+        return;
+    }
+
+    // Pairs are independent, so split the level into one contiguous chunk
+    // per worker; same thread budget as scrypt_hash_batch()
+    size_t nPerThread = nPairs / nThreads;
+    boost::thread_group workers;
+    for (size_t i = 1; i < nThreads; ++i)
+    {
+        size_t nFirst = i * nPerThread;
+        size_t nCount = (i == nThreads - 1) ? nPairs - nFirst : nPerThread;
+        workers.create_thread(
+            boost::bind(&SHA256D64, out[nFirst].begin(), in[2 * nFirst].begin(), nCount));
+    }
+    SHA256D64(out->begin(), in->begin(), nPerThread);
+    workers.join_all();
+}
+
 void CBlockHeader::SetNull()
 {
 	// Scrypt coin uses AdaptivePow (version 8+)
@@ -9,6 +9,7 @@
 
 #include "bignum.h"
 #include "hash.h"
+#include "powcache.h"
 #include "primitives/transaction.h"
 #include "serialize.h"
 #include "uint256.h"
@@ -20,6 +21,11 @@ class CWallet;
 class CTransaction;
 class CKeyStore;
 
+/** Hash one merkle level: each output is the double-SHA256 of a 64-byte
+ *  pair of children. Splits large levels across the hash calculation
+ *  threads; defined in primitives/block.cpp. */
+void MerkleHashLevel(uint256* out, const uint256* in, size_t nPairs);
+
 #pragma pack(push, 1)
 struct block_header
 {
@@ -252,13 +258,17 @@ public:
     {
         if(blockHash == 0 || IsHeaderDifferent())
         {
-            blockHash = CalculateHash();
-            previousBlockHeader.version = nVersion;
-            previousBlockHeader.prev_block = hashPrevBlock;
-            previousBlockHeader.merkle_root = hashMerkleRoot;
-            previousBlockHeader.timestamp = nTime;
-            previousBlockHeader.bits = nBits;
-            previousBlockHeader.nonce = nNonce;
+            // Distinct CBlockHeader objects are built for the same header on
+            // several paths; share the scrypt result between them through the
+            // process-wide pow hash cache, keyed by the cheap SHA256d hash.
+            // GetSHA256Hash() also refreshes previousBlockHeader for us.
+            const uint256 hashSHA256d = GetSHA256Hash();
+            if (!GetPowHashCache(hashSHA256d, blockHash))
+            {
+                blockHash = CalculateHash();
+                if (blockHash != 0)
+                    SetPowHashCache(hashSHA256d, blockHash);
+            }
         }
         return blockHash;
     }
@@ -428,17 +438,53 @@ public:
         int j = 0;
         for (int nSize = (int)vtx.size(); nSize > 1; nSize = (nSize + 1) / 2)
         {
-            for (int i = 0; i < nSize; i += 2)
+            // Each parent is the double hash of the 64-byte concatenation of
+            // its two children; the children of one level sit back to back in
+            // vMerkleTree, so the whole level goes through the multi-buffer
+            // SHA256D64() in one call.
+            int nNew = (nSize + 1) / 2;
+            size_t nLevel = vMerkleTree.size();
+            vMerkleTree.resize(nLevel + nNew);
+            if (nSize / 2 > 0)
+                MerkleHashLevel(&vMerkleTree[nLevel], &vMerkleTree[j], nSize / 2);
+            if (nSize & 1)
             {
-                int i2 = std::min(i+1, nSize-1);
-                vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j+i]),  END(vMerkleTree[j+i]),
-                                           BEGIN(vMerkleTree[j+i2]), END(vMerkleTree[j+i2])));
+                // Odd node out: paired with itself, as always.
+                vMerkleTree[nLevel + nNew - 1] = Hash(BEGIN(vMerkleTree[j+nSize-1]), END(vMerkleTree[j+nSize-1]),
+                                                      BEGIN(vMerkleTree[j+nSize-1]), END(vMerkleTree[j+nSize-1]));
             }
             j += nSize;
         }
         return (vMerkleTree.empty() ? 0 : vMerkleTree.back());
     }
 
+    // Mining fast path: after only the coinbase changed (extranonce bump),
+    // every sibling on leaf 0's path is still valid in vMerkleTree, so the
+    // root needs one rehash per level instead of a full rebuild. Falls back
+    // to BuildMerkleTree() when the cached tree doesn't match vtx.
+    uint256 UpdateCoinbaseMerkleRoot() const
+    {
+        size_t nExpected = vtx.size();
+        for (size_t nSize = vtx.size(); nSize > 1; nSize = (nSize + 1) / 2)
+            nExpected += (nSize + 1) / 2;
+        if (vtx.empty() || vMerkleTree.size() != nExpected)
+            return BuildMerkleTree();
+
+        uint256 h = vtx[0].GetHash();
+        vMerkleTree[0] = h;
+        int j = 0;
+        for (int nSize = (int)vtx.size(); nSize > 1; nSize = (nSize + 1) / 2)
+        {
+            // Leaf 0 stays the leftmost node of every level, so it is
+            // always a left child and its sibling sits right next to it.
+            const uint256& otherside = vMerkleTree[j + 1];
+            h = Hash(BEGIN(h), END(h), BEGIN(otherside), END(otherside));
+            j += nSize;
+            vMerkleTree[j] = h;
+        }
+        return h;
+    }
+
     std::vector<uint256> GetMerkleBranch(int nIndex) const
     {
         if (vMerkleTree.empty())
@@ -526,6 +572,11 @@ public:
         vHave = vHaveIn;
     }
 
+    CBlockLocator(std::vector<uint256>&& vHaveIn)
+    {
+        vHave = std::move(vHaveIn);
+    }
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -47,7 +47,9 @@ public:
     ::uint32_t COutPointGet_n() const { return n; }
     COutPoint() { SetNull(); }
     COutPoint(uint256 hashIn, unsigned int nIn) { hash = hashIn; n = nIn; }
-    ADD_SERIALIZE_METHODS;
+    // 32-byte blob + LE uint32 in declaration order: wire format equals the
+    // in-memory layout, so (de)serialization is a single 36-byte copy
+    ADD_FLAT_SERIALIZE_METHODS(COutPoint, 36);
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
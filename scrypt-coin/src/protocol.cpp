@@ -9,6 +9,7 @@
 #endif
 
 #include "protocol.h"
+#include "crypto/siphash.h"
 #include "net.h"
 
 #ifndef WIN32
@@ -26,6 +27,9 @@ const char *GETBLOCKS="getblocks";
 const char *GETHEADERS="getheaders";
 const char *TX="tx";
 const char *HEADERS="headers";
+const char *CMPCTHEADERS="cmpcthdrs";
+const char *GETBULKHEADERS="getbulkhdrs";
+const char *BULKHEADERS="bulkhdrs";
 const char *BLOCK="block";
 const char *GETADDR="getaddr";
 const char *MEMPOOL="mempool";
@@ -42,6 +46,10 @@ const char *SENDCMPCT="sendcmpct";
 const char *CMPCTBLOCK="cmpctblock";
 const char *GETBLOCKTXN="getblocktxn";
 const char *BLOCKTXN="blocktxn";
+const char *GETCFILTER="getcfilter";
+const char *CFILTER="cfilter";
+const char *GETHOTSET="gethotset";
+const char *HOTSET="hotset";
 } // namespace NetMsgType
 
 /** All known message types. Keep this in the same order as the list of
@@ -58,6 +66,9 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::GETHEADERS,
     NetMsgType::TX,
     NetMsgType::HEADERS,
+    NetMsgType::CMPCTHEADERS,
+    NetMsgType::GETBULKHEADERS,
+    NetMsgType::BULKHEADERS,
     NetMsgType::BLOCK,
     NetMsgType::GETADDR,
     NetMsgType::MEMPOOL,
@@ -74,6 +85,10 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::CMPCTBLOCK,
     NetMsgType::GETBLOCKTXN,
     NetMsgType::BLOCKTXN,
+    NetMsgType::GETCFILTER,
+    NetMsgType::CFILTER,
+    NetMsgType::GETHOTSET,
+    NetMsgType::HOTSET,
 };
 const static std::vector<std::string> allNetMessageTypesVec(allNetMessageTypes, allNetMessageTypes+ARRAYLEN(allNetMessageTypes));
 // The message start string is designed to be unlikely to occur in normal data.
@@ -133,6 +148,14 @@ bool CMessageHeader::IsValid() const
     return true;
 }
 
+uint32_t FastMessageChecksum(const unsigned char* pch, size_t nBytes)
+{
+    uint64_t k1 = 0;
+    memcpy(&k1, ::pchMessageStart, CMessageHeader::MESSAGE_START_SIZE);
+    uint64_t nHash = CSipHasher(0x79616373756d6b30ULL, k1).Write(pch, nBytes).Finalize();
+    return (uint32_t)(nHash ^ (nHash >> 32));
+}
+
 CAddress::CAddress() : CService()
 {
     Init();
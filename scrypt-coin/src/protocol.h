@@ -68,6 +68,14 @@ public:
     uint8_t pchChecksum[CHECKSUM_SIZE];
 };
 
+/** Cheap payload checksum (SipHash-2-4 folded to 32 bits) used instead of
+ * double-SHA256 on links where both sides advertise NODE_FAST_CHECKSUM and
+ * the peer is whitelisted. Keyed with the network magic so checksums from
+ * different networks can never match. This only guards against transport
+ * corruption on trusted links; it is not a cryptographic commitment.
+ */
+uint32_t FastMessageChecksum(const unsigned char* pch, size_t nBytes);
+
 /**
  * Bitcoin protocol message types. When adding new message types, don't forget
  * to update allNetMessageTypes in protocol.cpp.
@@ -135,6 +143,26 @@ extern const char *TX;
  * @see https://bitcoin.org/en/developer-reference#headers
  */
 extern const char *HEADERS;
+/**
+ * The cmpcthdrs message is a delta-coded replacement for the headers
+ * message: hashPrevBlock is omitted for all but the first header and
+ * version/bits/time are only sent when they differ from the previous
+ * header. Only sent to peers advertising NODE_COMPACT_HEADERS.
+ */
+extern const char *CMPCTHEADERS;
+/**
+ * The getbulkhdrs message requests a run of consecutive headers by height
+ * range inside checkpointed history: an int32 start height followed by a
+ * uint32 count. Only sent to peers advertising NODE_BULK_HEADERS.
+ */
+extern const char *GETBULKHEADERS;
+/**
+ * The bulkhdrs message answers getbulkhdrs with up to
+ * BulkHeaders::MAX_BULK_HEADERS full headers starting at the requested
+ * height, collapsing the 2000-header getheaders round trips during initial
+ * header sync.
+ */
+extern const char *BULKHEADERS;
 /**
  * The block message transmits a single serialized block.
  * @see https://bitcoin.org/en/developer-reference#block
@@ -246,6 +274,28 @@ extern const char *GETBLOCKTXN;
  * @since protocol version 70014 as described by BIP 152
  */
 extern const char *BLOCKTXN;
+/**
+ * Contains a block hash.
+ * Requests the BIP158 compact filter for that block; peer should respond
+ * with a "cfilter" message if it maintains the filter index.
+ */
+extern const char *GETCFILTER;
+/**
+ * Contains a block hash, a filter header and an encoded compact filter.
+ * Sent in response to a "getcfilter" message.
+ */
+extern const char *CFILTER;
+/**
+ * Asks a paired node for the outpoints its coins cache currently holds.
+ * Only honoured for whitelisted peers; answered with a "hotset" message.
+ */
+extern const char *GETHOTSET;
+/**
+ * Contains a vector of outpoints from the sender's coins cache. Sent in
+ * response to a "gethotset" message; a standby node (-standby) pre-faults
+ * them from its own database so its cache is warm before a failover.
+ */
+extern const char *HOTSET;
 };
 
 /* Get a vector of all valid message types (see above) */
@@ -267,6 +317,18 @@ enum ServiceFlags : uint64_t {
     // Bitcoin Core nodes used to support this by default, without advertising this bit,
     // but no longer do as of protocol version 70011 (= NO_BLOOM_VERSION)
     NODE_BLOOM = (1 << 2),
+    // NODE_COMPACT_HEADERS means the node understands the delta-coded
+    // cmpcthdrs replacement for the headers message. This is a yacoin-local
+    // bit, not assigned by any BIP.
+    NODE_COMPACT_HEADERS = (1 << 6),
+    // NODE_FAST_CHECKSUM means the node accepts the cheap SipHash message
+    // checksum instead of double-SHA256 on whitelisted links. This is a
+    // yacoin-local bit, not assigned by any BIP.
+    NODE_FAST_CHECKSUM = (1 << 7),
+    // NODE_BULK_HEADERS means the node serves the getbulkhdrs height-range
+    // header fetch for checkpointed history. This is a yacoin-local bit, not
+    // assigned by any BIP.
+    NODE_BULK_HEADERS = (1 << 8),
 };
 
 /** A CService with information about it as peer */
@@ -803,7 +803,7 @@ void ExplorerPage::setNumBlocks(int count, const QDateTime& blockDate, double nV
 
                 //_____________________________________________________________
                 strTemporary =
-                    strprintf("%.3f %s", pblockindex->nMint / 1000000.0, sCOIN_SYMBOL.c_str());
+                    strprintf("%.3f %s", pblockindex->GetMint() / 1000000.0, sCOIN_SYMBOL.c_str());
                 vStringBlockDataRow[TOTAL_SENT] = strTemporary.c_str();
 
                 //_____________________________________________________________
@@ -1400,7 +1400,7 @@ std::string BuildBlockinfoDetailsFrom(CBlock &block, CBlockIndex *pblockindex,
     sTemp += "<b >" + sStandardItemModelElement + "</b >";
     pQSIMblockinfo->setData(pQSIMblockinfo->index(nRowCount, BLOCK_INFO_ITEM, QModelIndex()),
                             sStandardItemModelElement.c_str());
-    sStandardItemModelElement = strprintf(" %s, ", FormatMoney(pblockindex->nMint).c_str());
+    sStandardItemModelElement = strprintf(" %s, ", FormatMoney(pblockindex->GetMint()).c_str());
     sTemp += sStandardItemModelElement + "<br />\n";
     pQSIMblockinfo->setData(pQSIMblockinfo->index(nRowCount, BLOCK_INFO_VALUE, QModelIndex()),
                             sStandardItemModelElement.c_str());
@@ -1411,7 +1411,7 @@ std::string BuildBlockinfoDetailsFrom(CBlock &block, CBlockIndex *pblockindex,
     sTemp += "<b >" + sStandardItemModelElement + "</b >";
     pQSIMblockinfo->setData(pQSIMblockinfo->index(nRowCount, BLOCK_INFO_ITEM, QModelIndex()),
                             sStandardItemModelElement.c_str());
-    sStandardItemModelElement = strprintf(" %s ", FormatMoney(pblockindex->nMoneySupply).c_str());
+    sStandardItemModelElement = strprintf(" %s ", FormatMoney(pblockindex->GetMoneySupply()).c_str());
     sTemp += sStandardItemModelElement + "<br />";
     pQSIMblockinfo->setData(pQSIMblockinfo->index(nRowCount, BLOCK_INFO_VALUE, QModelIndex()),
                             sStandardItemModelElement.c_str());
@@ -1477,17 +1477,17 @@ std::string BuildBlockinfoDetailsFrom(CBlock &block, CBlockIndex *pblockindex,
     ++nRowCount;
     //_________________________________________________________________________
 
-    if (0 != pblockindex->hashProofOfStake) {
+    if (0 != pblockindex->GetHashProofOfStake()) {
         std::string sHPOS1 = "hashProofOfStake = ", sHPOS2 = "", sHPOS3 = "\n", sHPOS = "";
 
-        sHPOS2 = pblockindex->hashProofOfStake.ToString();
+        sHPOS2 = pblockindex->GetHashProofOfStake().ToString();
         sHPOS = sHPOS1 + sHPOS2 + sHPOS3;
 
         sStandardItemModelElement = "hashProofOfStake";
         sTemp += sStandardItemModelElement + " = ";
         pQSIMblockinfo->setData(pQSIMblockinfo->index(nRowCount, BLOCK_INFO_ITEM, QModelIndex()),
                                 sStandardItemModelElement.c_str());
-        sStandardItemModelElement = pblockindex->hashProofOfStake.ToString();
+        sStandardItemModelElement = pblockindex->GetHashProofOfStake().ToString();
         sTemp += sStandardItemModelElement + "<br />\n";
         pQSIMblockinfo->setData(pQSIMblockinfo->index(nRowCount, BLOCK_INFO_VALUE, QModelIndex()),
                                 sStandardItemModelElement.c_str());
@@ -1499,7 +1499,7 @@ std::string BuildBlockinfoDetailsFrom(CBlock &block, CBlockIndex *pblockindex,
     sTemp += "<b >" + sStandardItemModelElement + "</b >";
     pQSIMblockinfo->setData(pQSIMblockinfo->index(nRowCount, BLOCK_INFO_ITEM, QModelIndex()),
                             sStandardItemModelElement.c_str());
-    sStandardItemModelElement = strprintf(" (%s) ", pblockindex->prevoutStake.ToString().c_str());
+    sStandardItemModelElement = strprintf(" (%s) ", pblockindex->GetPrevoutStake().ToString().c_str());
     sTemp += sStandardItemModelElement + "<br />\n";
     pQSIMblockinfo->setData(pQSIMblockinfo->index(nRowCount, BLOCK_INFO_VALUE, QModelIndex()),
                             sStandardItemModelElement.c_str());
@@ -1510,7 +1510,7 @@ std::string BuildBlockinfoDetailsFrom(CBlock &block, CBlockIndex *pblockindex,
     sTemp += "<b >" + sStandardItemModelElement + "</b >";
     pQSIMblockinfo->setData(pQSIMblockinfo->index(nRowCount, BLOCK_INFO_ITEM, QModelIndex()),
                             sStandardItemModelElement.c_str());
-    sStandardItemModelElement = strprintf(" %d ", pblockindex->nStakeTime);
+    sStandardItemModelElement = strprintf(" %d ", pblockindex->GetStakeTime());
     sTemp += sStandardItemModelElement + "<br />\n";
     pQSIMblockinfo->setData(pQSIMblockinfo->index(nRowCount, BLOCK_INFO_VALUE, QModelIndex()),
                             sStandardItemModelElement.c_str());
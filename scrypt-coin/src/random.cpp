@@ -20,6 +20,8 @@
 #include <chrono>
 #include <thread>
 
+#include <boost/thread/tss.hpp>
+
 #ifndef WIN32
 #include <sys/time.h>
 #endif
@@ -271,13 +273,35 @@ void GetOSRand(unsigned char *ent32)
 #endif
 }
 
-void GetRandBytes(unsigned char* buf, int num)
+/** OpenSSL's RNG, used only as one of the sources mixed by
+ *  GetStrongRandBytes; application code goes through the per-thread fast
+ *  ChaCha20 stream below. */
+static void GetOpenSSLRandBytes(unsigned char* buf, int num)
 {
     if (RAND_bytes(buf, num) != 1) {
         RandFailure();
     }
 }
 
+/** Per-thread ChaCha20 context behind GetRandBytes/GetRand/GetRandHash.
+ *  Seeded once per thread from GetStrongRandBytes and deterministic after
+ *  that, so ordinary randomness (addrman salts, nonces, eviction choices)
+ *  never takes the OpenSSL lock or a syscall. Thread-specific storage uses
+ *  the same boost idiom as the lock stack in sync.cpp. */
+static boost::thread_specific_ptr<FastRandomContext> threadFastRng;
+
+static FastRandomContext& GetThreadFastRandomContext()
+{
+    if (!threadFastRng.get())
+        threadFastRng.reset(new FastRandomContext());
+    return *threadFastRng.get();
+}
+
+void GetRandBytes(unsigned char* buf, int num)
+{
+    GetThreadFastRandomContext().fillbytes(buf, num);
+}
+
 static void AddDataToRng(void* data, size_t len);
 
 void RandAddSeedSleep()
@@ -323,7 +347,7 @@ void GetStrongRandBytes(unsigned char* out, int num)
 
     // First source: OpenSSL's RNG
     RandAddSeedPerfmon();
-    GetRandBytes(buf, 32);
+    GetOpenSSLRandBytes(buf, 32);
     hasher.Write(buf, 32);
 
     // Second source: OS RNG
@@ -354,15 +378,7 @@ uint64_t GetRand(uint64_t nMax)
 {
     if (nMax == 0)
         return 0;
-
-    // The range of the random source must be a multiple of the modulus
-    // to give every possible output value an equal possibility
-    uint64_t nRange = (std::numeric_limits<uint64_t>::max() / nMax) * nMax;
-    uint64_t nRand = 0;
-    do {
-        GetRandBytes((unsigned char*)&nRand, sizeof(nRand));
-    } while (nRand >= nRange);
-    return (nRand % nMax);
+    return GetThreadFastRandomContext().randrange(nMax);
 }
 
 int GetRandInt(int nMax)
@@ -372,14 +388,16 @@ int GetRandInt(int nMax)
 
 uint256 GetRandHash()
 {
-    uint256 hash;
-    GetRandBytes((unsigned char*)&hash, sizeof(hash));
-    return hash;
+    return GetThreadFastRandomContext().rand256();
 }
 
 void FastRandomContext::RandomSeed()
 {
-    uint256 seed = GetRandHash();
+    // Seed from the strong multi-source path, not the fast one: the
+    // per-thread contexts behind GetRandBytes would otherwise seed
+    // themselves recursively.
+    uint256 seed;
+    GetStrongRandBytes(seed.begin(), 32);
     rng.SetKey(seed.begin(), 32);
     requires_seed = false;
 }
@@ -395,11 +413,21 @@ uint256 FastRandomContext::rand256()
     return ret;
 }
 
+void FastRandomContext::fillbytes(unsigned char* buf, size_t len)
+{
+    if (requires_seed) {
+        RandomSeed();
+    }
+    if (len > 0) {
+        rng.Output(buf, len);
+    }
+}
+
 std::vector<unsigned char> FastRandomContext::randbytes(size_t len)
 {
     std::vector<unsigned char> ret(len);
     if (len > 0) {
-        rng.Output(&ret[0], len);
+        fillbytes(&ret[0], len);
     }
     return ret;
 }
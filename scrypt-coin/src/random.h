@@ -18,7 +18,10 @@ void RandAddSeed();
 void RandAddSeedPerfmon();
 
 /**
- * Functions to gather random data via the OpenSSL PRNG
+ * Fast randomness: served from a per-thread ChaCha20 stream seeded once from
+ * GetStrongRandBytes, so these never take a lock or enter the kernel. Use
+ * them for everything except long-term secrets; key material must come from
+ * GetStrongRandBytes.
  */
 void GetRandBytes(unsigned char* buf, int num);
 uint64_t GetRand(uint64_t nMax);
@@ -112,6 +115,9 @@ public:
         }
     }
 
+    /** Fill a caller-provided buffer with random bytes. */
+    void fillbytes(unsigned char* buf, size_t len);
+
     /** Generate random bytes. */
     std::vector<unsigned char> randbytes(size_t len);
 
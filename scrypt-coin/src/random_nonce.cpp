@@ -76,6 +76,24 @@ void
     nNonceReference = n32value;
 }
 //_____________________________________________________________________________
+::uint64_t
+    CRandomNonce::get_nonce_base( unsigned int nInstanceId )
+{
+    // each instance owns 2^48 consecutive nonces, far more than any
+    // instance exhausts before the template changes, so the slices
+    // never have to be refilled or coordinated at run time
+    return ( ( ::uint64_t )( nInstanceId & 0xffff ) ) << 48;
+}
+//_____________________________________________________________________________
+unsigned int
+    CRandomNonce::get_extra_nonce_base( unsigned int nInstanceId )
+{
+    // 2^20 extra nonces per instance; the extra nonce only moves when a
+    // nonce slice is exhausted or the coinbase drifts, so this never
+    // runs into the neighbouring instance's slice in practice
+    return nInstanceId << 20;
+}
+//_____________________________________________________________________________
 #ifdef _MSC_VER
     #include "msvc_warnings.pop.h"
 #endif
@@ -20,6 +20,13 @@ public:
     ~CRandomNonce() {}
     ::uint32_t get_a_nonce( unsigned int & nNonceReference );
     void randomize_the_nonce( unsigned int & nNonceReference );
+
+    // deterministic partitioning for cooperating miner instances
+    // (keyed by -minerinstance): each instance id maps to a disjoint
+    // slice of the 64 bit nonce space and of the extra nonce space,
+    // so several instances on the same template never repeat work
+    ::uint64_t get_nonce_base( unsigned int nInstanceId );
+    unsigned int get_extra_nonce_base( unsigned int nInstanceId );
 private:
     bool initialized;
 };
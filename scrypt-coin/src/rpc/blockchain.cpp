@@ -18,9 +18,11 @@
 #include "policy/policy.h"
 #include "primitives/transaction.h"
 #include "rpc/server.h"
+#include "rpc/stream.h"
 #include "streams.h"
 #include "sync.h"
 #include "txdb.h"
+#include "undo.h"
 #include "txmempool.h"
 #include "util.h"
 #include "utilstrencodings.h"
@@ -32,6 +34,8 @@
 
 #include <boost/thread/thread.hpp> // boost::thread::interrupt
 
+#include <algorithm>
+#include <deque>
 #include <mutex>
 #include <condition_variable>
 
@@ -116,8 +120,8 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.push_back(Pair("version", block.nVersion));
     result.push_back(Pair("versionHex", strprintf("%08x", block.nVersion)));
     result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
-    result.push_back(Pair("mint", ValueFromAmount(blockindex->nMint)));
-    result.push_back(Pair("money supply", ValueFromAmount(blockindex->nMoneySupply)));
+    result.push_back(Pair("mint", ValueFromAmount(blockindex->GetMint())));
+    result.push_back(Pair("money supply", ValueFromAmount(blockindex->GetMoneySupply())));
     result.push_back(Pair("time", block.GetBlockTime()));
     result.push_back(Pair("nonce", (uint64_t)block.nNonce));
     result.push_back(Pair("bits", strprintf("%08x", block.nBits)));
@@ -125,7 +129,7 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.push_back(Pair("blocktrust", leftTrim(blockindex->GetBlockTrust().GetHex(), '0')));
     result.push_back(Pair("chaintrust", leftTrim(blockindex->bnChainTrust.GetHex(), '0')));
     result.push_back(Pair("flags", strprintf("%s%s", blockindex->IsProofOfStake()? "proof-of-stake" : "proof-of-work", blockindex->GeneratedStakeModifier()? " stake-modifier": "")));
-    result.push_back(Pair("proofhash", blockindex->IsProofOfStake()? blockindex->hashProofOfStake.GetHex() : blockindex->GetBlockHash().GetHex()));
+    result.push_back(Pair("proofhash", blockindex->IsProofOfStake()? blockindex->GetHashProofOfStake().GetHex() : blockindex->GetBlockHash().GetHex()));
     result.push_back(Pair("entropybit", (int)blockindex->GetStakeEntropyBit()));
     result.push_back(Pair("modifier", strprintf("%016" PRIx64, blockindex->nStakeModifier)));
     result.push_back(Pair("modifierchecksum", strprintf("%08x", blockindex->nStakeModifierChecksum)));
@@ -169,8 +173,7 @@ UniValue getblockcount(const JSONRPCRequest& request)
             + HelpExampleRpc("getblockcount", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.Height();
+    return GetChainSnapshot().Height();
 }
 
 UniValue getbestblockhash(const JSONRPCRequest& request)
@@ -186,8 +189,7 @@ UniValue getbestblockhash(const JSONRPCRequest& request)
             + HelpExampleRpc("getbestblockhash", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.Tip()->blockHash.GetHex();
+    return GetChainSnapshot().Tip()->blockHash.GetHex();
 }
 
 void RPCNotifyBlockChange(bool ibd, const CBlockIndex * pindex)
@@ -335,12 +337,11 @@ UniValue getdifficulty(const JSONRPCRequest& request)
             + HelpExampleRpc("getdifficulty", "")
         );
 
-    LOCK(cs_main);
-    const CBlockIndex *pindex = chainActive.Tip();
+    const CBlockIndex *pindex = GetChainSnapshot().Tip();
     uint256 nTarget = CBigNum().SetCompact(pindex->nBits).getuint256();
 
     UniValue obj(UniValue::VOBJ);
-    obj.push_back(Pair("proof-of-work",        GetDifficulty()));
+    obj.push_back(Pair("proof-of-work",        GetDifficulty(pindex)));
     obj.push_back(Pair("target", nTarget.ToString().substr(0, 16).c_str()));
     return obj;
 }
@@ -410,12 +411,11 @@ UniValue mempoolToJSON(bool fVerbose)
     }
     else
     {
-        std::vector<uint256> vtxid;
-        mempool.queryHashes(vtxid);
+        auto snapshot = mempool.GetSnapshot();
 
         UniValue a(UniValue::VARR);
-        for (const uint256& hash : vtxid)
-            a.push_back(hash.ToString());
+        for (const TxMempoolInfo& txinfo : *snapshot)
+            a.push_back(txinfo.tx->GetHash().ToString());
 
         return a;
     }
@@ -428,6 +428,7 @@ UniValue getrawmempool(const JSONRPCRequest& request)
             "getrawmempool ( verbose )\n"
             "\nReturns all transaction ids in memory pool as a json array of string transaction ids.\n"
             "\nHint: use getmempoolentry to fetch a specific transaction from the mempool.\n"
+            "Hint: use getmempooldelta to poll for changes instead of re-fetching the whole pool.\n"
             "\nArguments:\n"
             "1. verbose (boolean, optional, default=false) True for a json object, false for array of transaction ids\n"
             "\nResult: (for verbose = false):\n"
@@ -453,6 +454,106 @@ UniValue getrawmempool(const JSONRPCRequest& request)
     return mempoolToJSON(fVerbose);
 }
 
+bool GetRawMempoolStream(const JSONRPCRequest& request, JSONStreamWriter& writer)
+{
+    bool fVerbose = false;
+    if (!request.params[0].isNull())
+        fVerbose = request.params[0].get_bool();
+    // The txid array is small; only the verbose form is worth streaming.
+    if (!fVerbose)
+        return false;
+
+    LOCK(mempool.cs);
+    writer.BeginObject();
+    for (const CTxMemPoolEntry& e : mempool.mapTx) {
+        writer.WriteKey(e.GetTx().GetHash().ToString());
+        UniValue info(UniValue::VOBJ);
+        entryToJSON(info, e);
+        writer.WriteValue(info);
+    }
+    writer.EndObject();
+    return true;
+}
+
+UniValue getmempooldelta(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "getmempooldelta since ( verbose )\n"
+            "\nReturns mempool additions and removals after the given sequence number,\n"
+            "so continuous mempool mirroring costs O(changes) per poll instead of\n"
+            "re-serializing the whole pool. Obtain the starting sequence from this\n"
+            "call (with since=0) or track the \"sequence\" field across polls.\n"
+            "\nArguments:\n"
+            "1. since   (numeric, required) Only report changes after this sequence number\n"
+            "2. verbose (boolean, optional, default=false) True for a json object per added entry, false for array of transaction ids\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"sequence\" : n,          (numeric) pass this as \"since\" on the next poll\n"
+            "  \"resync\" : true|false,  (boolean) when true, \"since\" predates the retained history;\n"
+            "                          added/removed are omitted and the caller must take a full\n"
+            "                          getrawmempool snapshot before polling again\n"
+            "  \"added\" : [...],         (array, or object if verbose) transactions that entered the pool\n"
+            "  \"removed\" : [...]        (array) txids that left the pool\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmempooldelta", "12345")
+            + HelpExampleRpc("getmempooldelta", "12345, true")
+        );
+
+    ::uint64_t nSince = request.params[0].get_int64();
+    bool fVerbose = false;
+    if (!request.params[1].isNull())
+        fVerbose = request.params[1].get_bool();
+
+    // Hold the pool lock across collection and serialization so the reported
+    // sequence matches the serialized state exactly.
+    LOCK(mempool.cs);
+    std::vector<CMempoolChange> vChanges;
+    ::uint64_t nSequence = 0;
+    UniValue result(UniValue::VOBJ);
+    if (!mempool.GetChangesSince(nSince, vChanges, nSequence)) {
+        result.push_back(Pair("sequence", nSequence));
+        result.push_back(Pair("resync", true));
+        return result;
+    }
+
+    // Net out transactions that entered and left within the window: the
+    // mirror never saw them, so neither record is interesting.
+    std::set<uint256> setAdded;
+    std::vector<uint256> vRemoved;
+    for (const CMempoolChange& change : vChanges) {
+        if (!change.fRemoved) {
+            setAdded.insert(change.txid);
+        } else if (setAdded.erase(change.txid) == 0) {
+            vRemoved.push_back(change.txid);
+        }
+    }
+
+    UniValue added(fVerbose ? UniValue::VOBJ : UniValue::VARR);
+    for (const uint256& txid : setAdded) {
+        if (fVerbose) {
+            CTxMemPool::txiter it = mempool.mapTx.find(txid);
+            if (it == mempool.mapTx.end())
+                continue; // cannot happen while cs is held; be defensive
+            UniValue info(UniValue::VOBJ);
+            entryToJSON(info, *it);
+            added.push_back(Pair(txid.ToString(), info));
+        } else {
+            added.push_back(txid.ToString());
+        }
+    }
+    UniValue removed(UniValue::VARR);
+    for (const uint256& txid : vRemoved)
+        removed.push_back(txid.ToString());
+
+    result.push_back(Pair("sequence", nSequence));
+    result.push_back(Pair("resync", false));
+    result.push_back(Pair("added", added));
+    result.push_back(Pair("removed", removed));
+    return result;
+}
+
 UniValue getmempoolancestors(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 1 || request.params.size() > 2) {
@@ -629,16 +730,58 @@ UniValue getblockhash(const JSONRPCRequest& request)
             + HelpExampleRpc("getblockhash", "1000")
         );
 
-    LOCK(cs_main);
+    CChainSnapshot snapshot = GetChainSnapshot();
 
     int nHeight = request.params[0].get_int();
-    if (nHeight < 0 || nHeight > chainActive.Height())
+    if (nHeight < 0 || nHeight > snapshot.Height())
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
 
-    CBlockIndex* pblockindex = chainActive[nHeight];
+    const CBlockIndex* pblockindex = snapshot[nHeight];
     return pblockindex->GetBlockHash().GetHex();
 }
 
+UniValue getblockfilter(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getblockfilter \"blockhash\"\n"
+            "\nRetrieve the BIP158 basic compact filter for a block (requires -blockfilterindex).\n"
+            "\nArguments:\n"
+            "1. \"blockhash\"     (string, required) The block hash\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\" : \"hex\",  (string) the hex-encoded filter data\n"
+            "  \"header\" : \"hex\",  (string) the hex-encoded filter header\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+        );
+
+    if (!fBlockFilterIndex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Compact filter index not enabled. Enable -blockfilterindex in scrypt.conf and rebuild the database with -reindex-fast or -reindex");
+    }
+
+    uint256 hash = ParseHashV(request.params[0], "blockhash");
+
+    {
+        LOCK(cs_main);
+        if (mapBlockIndex.count(hash) == 0)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    }
+
+    uint256 filterHeader;
+    std::vector<unsigned char> vchFilter;
+    if (!GetBlockFilter(hash, filterHeader, vchFilter)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Filter not found for block");
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("filter", HexStr(vchFilter.begin(), vchFilter.end())));
+    result.push_back(Pair("header", filterHeader.GetHex()));
+    return result;
+}
+
 UniValue getblockheader(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
@@ -785,6 +928,170 @@ UniValue getblock(const JSONRPCRequest& request)
     return blockToJSON(block, pblockindex, verbosity >= 2);
 }
 
+/**
+ * Streaming twin of getblock for verbosity = 2, where the UniValue tree of a
+ * big block (every transaction fully decoded) dwarfs the serialized reply.
+ * Field order and formatting must stay identical to blockToJSON above; the
+ * per-transaction objects still go through TxToUniv so their layout is
+ * single-sourced, but each one is serialized and released before the next is
+ * built.
+ */
+bool GetBlockStream(const JSONRPCRequest& request, JSONStreamWriter& writer)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        return false;
+
+    int verbosity = 1;
+    if (!request.params[1].isNull()) {
+        if (request.params[1].isNum())
+            verbosity = request.params[1].get_int();
+        else
+            verbosity = request.params[1].get_bool() ? 1 : 0;
+    }
+    if (verbosity < 2)
+        return false;
+
+    LOCK(cs_main);
+
+    std::string strHash = request.params[0].get_str();
+    uint256 hash(uint256S(strHash));
+
+    if (mapBlockIndex.count(hash) == 0)
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+
+    CBlock block;
+    CBlockIndex* pblockindex = mapBlockIndex[hash];
+
+    if (!(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not available");
+
+    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+
+    // Everything is loaded and validated; from here on failure is no longer
+    // possible and the reply can be streamed
+    writer.BeginObject();
+    writer.WriteKey("hash");
+    writer.WriteValue(pblockindex->GetBlockHash().GetHex());
+    int confirmations = -1;
+    // Only report confirmations if the block is on the main chain
+    if (chainActive.Contains(pblockindex))
+        confirmations = chainActive.Height() - pblockindex->nHeight + 1;
+    writer.WriteKey("confirmations");
+    writer.WriteValue(confirmations);
+    writer.WriteKey("size");
+    writer.WriteValue((int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+    writer.WriteKey("height");
+    writer.WriteValue(pblockindex->nHeight);
+    writer.WriteKey("version");
+    writer.WriteValue(block.nVersion);
+    writer.WriteKey("versionHex");
+    writer.WriteValue(strprintf("%08x", block.nVersion));
+    writer.WriteKey("merkleroot");
+    writer.WriteValue(block.hashMerkleRoot.GetHex());
+    writer.WriteKey("mint");
+    writer.WriteValue(ValueFromAmount(pblockindex->GetMint()));
+    writer.WriteKey("money supply");
+    writer.WriteValue(ValueFromAmount(pblockindex->GetMoneySupply()));
+    writer.WriteKey("time");
+    writer.WriteValue(block.GetBlockTime());
+    writer.WriteKey("nonce");
+    writer.WriteValue((uint64_t)block.nNonce);
+    writer.WriteKey("bits");
+    writer.WriteValue(strprintf("%08x", block.nBits));
+    writer.WriteKey("difficulty");
+    writer.WriteValue(GetDifficulty(pblockindex));
+    writer.WriteKey("blocktrust");
+    writer.WriteValue(leftTrim(pblockindex->GetBlockTrust().GetHex(), '0'));
+    writer.WriteKey("chaintrust");
+    writer.WriteValue(leftTrim(pblockindex->bnChainTrust.GetHex(), '0'));
+    writer.WriteKey("flags");
+    writer.WriteValue(strprintf("%s%s", pblockindex->IsProofOfStake()? "proof-of-stake" : "proof-of-work", pblockindex->GeneratedStakeModifier()? " stake-modifier": ""));
+    writer.WriteKey("proofhash");
+    writer.WriteValue(pblockindex->IsProofOfStake()? pblockindex->GetHashProofOfStake().GetHex() : pblockindex->GetBlockHash().GetHex());
+    writer.WriteKey("entropybit");
+    writer.WriteValue((int)pblockindex->GetStakeEntropyBit());
+    writer.WriteKey("modifier");
+    writer.WriteValue(strprintf("%016" PRIx64, pblockindex->nStakeModifier));
+    writer.WriteKey("modifierchecksum");
+    writer.WriteValue(strprintf("%08x", pblockindex->nStakeModifierChecksum));
+    if (block.IsProofOfStake()) {
+        writer.WriteKey("signature");
+        writer.WriteValue(HexStr(block.vchBlockSig.begin(), block.vchBlockSig.end()));
+    }
+
+    writer.WriteKey("tx");
+    writer.BeginArray();
+    for (const auto& tx : block.vtx)
+    {
+        UniValue objTx(UniValue::VOBJ);
+        TxToUniv(tx, uint256(), objTx, true, RPCSerializationFlags());
+        writer.WriteValue(objTx);
+    }
+    writer.EndArray();
+
+    if (pblockindex->pprev) {
+        writer.WriteKey("previousblockhash");
+        writer.WriteValue(pblockindex->pprev->GetBlockHash().GetHex());
+    }
+    CBlockIndex *pnext = chainActive.Next(pblockindex);
+    if (pnext) {
+        writer.WriteKey("nextblockhash");
+        writer.WriteValue(pnext->GetBlockHash().GetHex());
+    }
+    writer.EndObject();
+    return true;
+}
+
+UniValue pruneblockchain(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "pruneblockchain\n"
+            "\nArguments:\n"
+            "1. \"height\"       (numeric, required) The block height to prune up to. May be set to a discrete height, or a unix timestamp\n"
+            "                  to prune blocks whose block time is at least 2 hours older than the provided timestamp.\n"
+            "\nResult:\n"
+            "n    (numeric) Height of the last block pruned.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("pruneblockchain", "1000")
+            + HelpExampleRpc("pruneblockchain", "1000"));
+
+    if (!fPruneMode)
+        throw JSONRPCError(RPC_MISC_ERROR, "Cannot prune blocks because node is not in prune mode.");
+
+    LOCK(cs_main);
+
+    int heightParam = request.params[0].get_int();
+    if (heightParam < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative block height.");
+
+    // Height value more than a billion is too high to be a block height, and
+    // too low to be a block time (corresponds to timestamp from Sep 2001).
+    if (heightParam > 1000000000) {
+        // Add a 2 hour buffer to include blocks which might have had old timestamps
+        CBlockIndex* pindex = chainActive.FindEarliestAtLeast(heightParam - TIMESTAMP_WINDOW);
+        if (!pindex) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Could not find block with at least the specified timestamp.");
+        }
+        heightParam = pindex->nHeight;
+    }
+
+    unsigned int height = (unsigned int) heightParam;
+    unsigned int chainHeight = (unsigned int) chainActive.Height();
+    if (chainHeight < Params().PruneAfterHeight())
+        throw JSONRPCError(RPC_MISC_ERROR, "Blockchain is too short for pruning.");
+    else if (height > chainHeight)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Blockchain is shorter than the attempted prune height.");
+    else if (height > chainHeight - MIN_BLOCKS_TO_KEEP) {
+        LogPrint(BCLog::RPC, "Attempt to prune blocks close to the tip.  Retaining the minimum number of blocks.\n");
+        height = chainHeight - MIN_BLOCKS_TO_KEEP;
+    }
+
+    PruneBlockFilesManual(height);
+    return uint64_t(height);
+}
+
 UniValue gettxout(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
@@ -865,6 +1172,130 @@ UniValue gettxout(const JSONRPCRequest& request)
     return ret;
 }
 
+UniValue dumputxosnapshot(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "dumputxosnapshot \"path\"\n"
+            "\nWrites the full UTXO set at the current tip to a snapshot file.\n"
+            "A fresh node can bootstrap from it with -utxosnapshot=<path> instead of\n"
+            "replaying the whole chain.\n"
+            "\nArguments:\n"
+            "1. path         (string, required) Absolute path of the file to write\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"path\" : \"xxxx\",        (string) the file written\n"
+            "  \"base_hash\" : \"xxxx\",   (string) hash of the block the snapshot is based on\n"
+            "  \"base_height\" : n,      (numeric) height of the base block\n"
+            "  \"coins\" : n,            (numeric) number of coins written\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("dumputxosnapshot", "\"/tmp/utxo.dat\"")
+            + HelpExampleRpc("dumputxosnapshot", "\"/tmp/utxo.dat\"")
+        );
+
+    fs::path path(request.params[0].get_str());
+    uint256 hashBase;
+    int nHeightBase = 0;
+    ::uint64_t nCoins = 0;
+    std::string strError;
+    if (!DumpUTXOSnapshot(path, hashBase, nHeightBase, nCoins, strError))
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("path", path.string()));
+    result.push_back(Pair("base_hash", hashBase.GetHex()));
+    result.push_back(Pair("base_height", nHeightBase));
+    result.push_back(Pair("coins", nCoins));
+    return result;
+}
+
+UniValue getutxosethash(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getutxosethash\n"
+            "\nReturns a rolling hash of the entire UTXO set, maintained incrementally\n"
+            "as blocks connect and disconnect. The first call after startup seeds the\n"
+            "hash with a full database scan and may take several minutes; every later\n"
+            "call is O(1), so the hash can be polled each block to compare chainstate\n"
+            "across nodes.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"height\" : n,           (numeric) height of the block the hash is valid for\n"
+            "  \"bestblock\" : \"xxxx\",   (string) hash of that block\n"
+            "  \"hash\" : \"xxxx\",        (string) rolling hash of the UTXO set\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getutxosethash", "")
+            + HelpExampleRpc("getutxosethash", "")
+        );
+
+    static bool fSeedScanRunning = false; // protected by cs_main
+
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    {
+        LOCK(cs_main);
+        uint256 hashDummy;
+        if (!GetUtxoSetRollingHash(hashDummy)) {
+            if (fSeedScanRunning)
+                throw JSONRPCError(RPC_MISC_ERROR, "a seed scan is already running, retry later");
+            // Seed from a full scan. Push the cache down so the database
+            // holds the tip state and the cache's pending delta is empty,
+            // then pin that state with a snapshot cursor. Seeding the
+            // accumulator empty right here makes the deltas of blocks that
+            // connect during the scan collect in it instead of being
+            // dropped, so the scan itself can run without cs_main and
+            // validation never waits on it.
+            FlushStateToDisk();
+            pcursor.reset(pcoinsdbview->Cursor());
+            SeedUtxoSetRollingHash(uint256());
+            fSeedScanRunning = true;
+        }
+    }
+
+    if (pcursor) {
+        uint256 hashSeed;
+        try {
+            while (pcursor->Valid()) {
+                boost::this_thread::interruption_point();
+                COutPoint key;
+                Coin coin;
+                if (!pcursor->GetKey(key) || !pcursor->GetValue(coin))
+                    throw JSONRPCError(RPC_DATABASE_ERROR, "error reading the coin database");
+                hashSeed ^= UtxoSetHashTerm(key, coin);
+                pcursor->Next();
+            }
+        } catch (...) {
+            LOCK(cs_main);
+            ResetUtxoSetRollingHash();
+            fSeedScanRunning = false;
+            throw;
+        }
+        // Fold the scanned set into the accumulator through the bottom of
+        // the view stack, like any other delta reaching the database layer.
+        LOCK(cs_main);
+        pcoinsdbview->AddUtxoHashDelta(hashSeed);
+        fSeedScanRunning = false;
+    }
+
+    LOCK(cs_main);
+
+    uint256 hashRolling;
+    GetUtxoSetRollingHash(hashRolling);
+
+    // Fold in whatever the tip cache has not flushed yet.
+    uint256 hash = hashRolling ^ pcoinsTip->GetUtxoHashDelta();
+    uint256 hashBest = pcoinsTip->GetBestBlock();
+    BlockMap::iterator mi = mapBlockIndex.find(hashBest);
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("height", mi != mapBlockIndex.end() ? mi->second->nHeight : -1));
+    result.push_back(Pair("bestblock", hashBest.GetHex()));
+    result.push_back(Pair("hash", hash.GetHex()));
+    return result;
+}
+
 UniValue verifychain(const JSONRPCRequest& request)
 {
     int nCheckLevel = gArgs.GetArg("-checklevel", DEFAULT_CHECKLEVEL);
@@ -908,6 +1339,8 @@ UniValue gettimechaininfo(const JSONRPCRequest& request)
             "  \"difficulty\": xxxxxx,     (numeric) the current difficulty\n"
             "  \"verificationprogress\": xxxx, (numeric) estimate of verification progress [0..1]\n"
             "  \"bnChainTrust\": \"xxxx\"     (string) total amount of work in active chain, in hexadecimal\n"
+            "  \"pruned\": xx,             (boolean) if the blocks are subject to pruning\n"
+            "  \"pruneheight\": xxxxxx,    (numeric) lowest-height complete block stored (only present if pruning is enabled)\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("gettimechaininfo", "")
@@ -927,6 +1360,14 @@ UniValue gettimechaininfo(const JSONRPCRequest& request)
     obj.push_back(Pair("bnChainTrust",            pindexTip->bnChainTrust.getuint64()));
     obj.push_back(Pair("Latest block time", (int64_t)pindexTip->nTime));
     obj.push_back(Pair("txcount", (int64_t)pindexTip->nChainTx));
+    obj.push_back(Pair("pruned",                fPruneMode));
+    if (fPruneMode) {
+        CBlockIndex *block = chainActive.Tip();
+        while (block && block->pprev && (block->pprev->nStatus & BLOCK_HAVE_DATA))
+            block = block->pprev;
+
+        obj.push_back(Pair("pruneheight",       block ? block->nHeight : -1));
+    }
 
     return obj;
 }
@@ -1176,6 +1617,227 @@ UniValue getblockbynumber(const JSONRPCRequest& request)
     return blockToJSON(block, pblockindex, request.params.size() > 1 ? request.params[1].get_bool() : false);
 }
 
+static int64_t CalculateTruncatedMedian(std::vector<int64_t>& scores)
+{
+    size_t size = scores.size();
+    if (size == 0) {
+        return 0;
+    }
+
+    std::sort(scores.begin(), scores.end());
+    if (size % 2 == 0) {
+        return (scores[size / 2 - 1] + scores[size / 2]) / 2;
+    } else {
+        return scores[size / 2];
+    }
+}
+
+/**
+ * Rollup cache for getblockstats, so dashboards polling a height range only
+ * pay for the block read and the aggregation pass once per block. Keyed by
+ * block hash rather than height so a reorg can never serve stale numbers.
+ * Guarded by cs_main (getblockstats runs under it); evicted FIFO.
+ */
+static const size_t MAX_BLOCK_STATS_CACHE = 5000;
+static std::map<uint256, UniValue> mapBlockStatsCache;
+static std::deque<uint256> dequeBlockStatsCacheOrder;
+
+/** Aggregate fee/size/token statistics over one block in a single pass. */
+static UniValue ComputeBlockStats(const CBlock& block, const CBlockIndex* pindex)
+{
+    // The coinbase pays no fee and the coinstake of a proof-of-stake block
+    // collects the reward on top of its inputs, so neither contributes to
+    // the fee statistics; everything else needs its prevout values, which
+    // come from the block's undo data.
+    CBlockUndo blockUndo;
+    bool fHaveUndo = false;
+    if (block.vtx.size() > 1) {
+        CDiskBlockPos pos = pindex->GetUndoPos();
+        if (pos.IsNull() || !UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash()))
+            throw JSONRPCError(RPC_MISC_ERROR, "Undo data not available for block");
+        fHaveUndo = true;
+    }
+
+    CAmount totalfee = 0;
+    CAmount total_out = 0;
+    int64_t total_size = 0;
+    int64_t inputs = 0;
+    int64_t outputs = 0;
+    int64_t nTokenNew = 0;
+    int64_t nTokenReissue = 0;
+    int64_t nTokenTransfer = 0;
+    int64_t nTokenOwner = 0;
+    std::vector<int64_t> fee_array;
+    std::vector<int64_t> feerate_array;
+    std::vector<int64_t> txsize_array;
+
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = block.vtx[i];
+        int64_t tx_size = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+
+        outputs += tx.vout.size();
+        for (const CTxOut& out : tx.vout) {
+            const CScript& script = out.scriptPubKey;
+            if (script.IsNewToken())
+                nTokenNew++;
+            else if (script.IsReissueToken())
+                nTokenReissue++;
+            else if (script.IsTransferToken())
+                nTokenTransfer++;
+            else if (script.IsOwnerToken())
+                nTokenOwner++;
+        }
+
+        if (tx.IsCoinBase())
+            continue;
+        inputs += tx.vin.size();
+
+        if (tx.IsCoinStake())
+            continue;
+        total_out += tx.GetValueOut();
+        total_size += tx_size;
+        txsize_array.push_back(tx_size);
+
+        // vtxundo covers every transaction but the coinbase
+        if (!fHaveUndo || i - 1 >= blockUndo.vtxundo.size())
+            throw JSONRPCError(RPC_MISC_ERROR, "Undo data is inconsistent with block");
+        const CTxUndo& txundo = blockUndo.vtxundo[i - 1];
+        if (txundo.vprevout.size() != tx.vin.size())
+            throw JSONRPCError(RPC_MISC_ERROR, "Undo data is inconsistent with block");
+
+        CAmount tx_in = 0;
+        for (const Coin& coin : txundo.vprevout)
+            tx_in += coin.out.nValue;
+        CAmount txfee = tx_in - tx.GetValueOut();
+        totalfee += txfee;
+        fee_array.push_back(txfee);
+        feerate_array.push_back(CFeeRate(txfee, tx_size).GetFeePerK());
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("blockhash", pindex->GetBlockHash().GetHex()));
+    ret.push_back(Pair("height", pindex->nHeight));
+    ret.push_back(Pair("time", (int64_t)pindex->nTime));
+    ret.push_back(Pair("mediantime", (int64_t)pindex->GetMedianTimePast()));
+    ret.push_back(Pair("txs", (int64_t)block.vtx.size()));
+    ret.push_back(Pair("ins", inputs));
+    ret.push_back(Pair("outs", outputs));
+    ret.push_back(Pair("block_size", (int64_t)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
+    ret.push_back(Pair("total_size", total_size));
+    ret.push_back(Pair("mintxsize", txsize_array.empty() ? 0 : *std::min_element(txsize_array.begin(), txsize_array.end())));
+    ret.push_back(Pair("maxtxsize", txsize_array.empty() ? 0 : *std::max_element(txsize_array.begin(), txsize_array.end())));
+    ret.push_back(Pair("mediantxsize", CalculateTruncatedMedian(txsize_array)));
+    ret.push_back(Pair("avgtxsize", txsize_array.empty() ? 0 : total_size / (int64_t)txsize_array.size()));
+    ret.push_back(Pair("total_out", ValueFromAmount(total_out)));
+    ret.push_back(Pair("totalfee", ValueFromAmount(totalfee)));
+    ret.push_back(Pair("minfee", ValueFromAmount(fee_array.empty() ? 0 : *std::min_element(fee_array.begin(), fee_array.end()))));
+    ret.push_back(Pair("maxfee", ValueFromAmount(fee_array.empty() ? 0 : *std::max_element(fee_array.begin(), fee_array.end()))));
+    ret.push_back(Pair("medianfee", ValueFromAmount(CalculateTruncatedMedian(fee_array))));
+    ret.push_back(Pair("avgfee", ValueFromAmount(fee_array.empty() ? 0 : totalfee / (CAmount)fee_array.size())));
+    ret.push_back(Pair("minfeerate", ValueFromAmount(feerate_array.empty() ? 0 : *std::min_element(feerate_array.begin(), feerate_array.end()))));
+    ret.push_back(Pair("maxfeerate", ValueFromAmount(feerate_array.empty() ? 0 : *std::max_element(feerate_array.begin(), feerate_array.end()))));
+    ret.push_back(Pair("medianfeerate", ValueFromAmount(CalculateTruncatedMedian(feerate_array))));
+    ret.push_back(Pair("token_new_ops", nTokenNew));
+    ret.push_back(Pair("token_reissue_ops", nTokenReissue));
+    ret.push_back(Pair("token_transfer_ops", nTokenTransfer));
+    ret.push_back(Pair("token_owner_ops", nTokenOwner));
+    ret.push_back(Pair("token_total_ops", nTokenNew + nTokenReissue + nTokenTransfer + nTokenOwner));
+    return ret;
+}
+
+UniValue getblockstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "getblockstats hash_or_height ( nocache )\n"
+            "\nComputes per-block statistics (fees, fee rates, sizes, token operations) in one pass over the block.\n"
+            "Results are kept in a per-block rollup cache so repeated queries over a height range do not re-read blocks.\n"
+            "\nArguments:\n"
+            "1. \"hash_or_height\"  (string or numeric, required) The block hash or height of the target block\n"
+            "2. nocache             (boolean, optional, default=false) Recompute instead of using the rollup cache\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"blockhash\" : \"hash\",    (string) The block hash\n"
+            "  \"height\" : n,            (numeric) The block height\n"
+            "  \"time\" : ttt,            (numeric) The block time\n"
+            "  \"mediantime\" : ttt,      (numeric) The block median time past\n"
+            "  \"txs\" : n,               (numeric) The number of transactions (including coinbase/coinstake)\n"
+            "  \"ins\" : n,               (numeric) The number of inputs (excluding coinbase)\n"
+            "  \"outs\" : n,              (numeric) The number of outputs\n"
+            "  \"block_size\" : n,        (numeric) The serialized block size\n"
+            "  \"total_size\" : n,        (numeric) Total size of all fee-paying transactions\n"
+            "  \"mintxsize\" : n,         (numeric) Minimum transaction size\n"
+            "  \"maxtxsize\" : n,         (numeric) Maximum transaction size\n"
+            "  \"mediantxsize\" : n,      (numeric) Truncated median transaction size\n"
+            "  \"avgtxsize\" : n,         (numeric) Average transaction size\n"
+            "  \"total_out\" : x.xxx,     (numeric) Total output value (excluding coinbase and coinstake)\n"
+            "  \"totalfee\" : x.xxx,      (numeric) The fee total\n"
+            "  \"minfee\" : x.xxx,        (numeric) Minimum fee in the block\n"
+            "  \"maxfee\" : x.xxx,        (numeric) Maximum fee in the block\n"
+            "  \"medianfee\" : x.xxx,     (numeric) Truncated median fee in the block\n"
+            "  \"avgfee\" : x.xxx,        (numeric) Average fee in the block\n"
+            "  \"minfeerate\" : x.xxx,    (numeric) Minimum feerate (coins per 1000 bytes)\n"
+            "  \"maxfeerate\" : x.xxx,    (numeric) Maximum feerate (coins per 1000 bytes)\n"
+            "  \"medianfeerate\" : x.xxx, (numeric) Truncated median feerate (coins per 1000 bytes)\n"
+            "  \"token_new_ops\" : n,     (numeric) Outputs issuing a new token\n"
+            "  \"token_reissue_ops\" : n, (numeric) Outputs reissuing a token\n"
+            "  \"token_transfer_ops\" : n,(numeric) Outputs transferring a token\n"
+            "  \"token_owner_ops\" : n,   (numeric) Outputs carrying a token owner marker\n"
+            "  \"token_total_ops\" : n    (numeric) All token outputs in the block\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockstats", "1000")
+            + HelpExampleRpc("getblockstats", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+        );
+
+    LOCK(cs_main);
+
+    CBlockIndex* pblockindex = nullptr;
+    if (request.params[0].isNum()) {
+        int nHeight = request.params[0].get_int();
+        if (nHeight < 0 || nHeight > chainActive.Height())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        pblockindex = chainActive[nHeight];
+    } else {
+        uint256 hash(uint256S(request.params[0].get_str()));
+        if (mapBlockIndex.count(hash) == 0)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        pblockindex = mapBlockIndex[hash];
+    }
+
+    bool fNoCache = false;
+    if (!request.params[1].isNull())
+        fNoCache = request.params[1].get_bool();
+
+    const uint256 hash = pblockindex->GetBlockHash();
+    if (!fNoCache) {
+        std::map<uint256, UniValue>::const_iterator it = mapBlockStatsCache.find(hash);
+        if (it != mapBlockStatsCache.end())
+            return it->second;
+    }
+
+    if (!(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not available");
+
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+
+    UniValue stats = ComputeBlockStats(block, pblockindex);
+
+    if (!fNoCache) {
+        if (mapBlockStatsCache.insert(std::make_pair(hash, stats)).second) {
+            dequeBlockStatsCacheOrder.push_back(hash);
+            while (dequeBlockStatsCacheOrder.size() > MAX_BLOCK_STATS_CACHE) {
+                mapBlockStatsCache.erase(dequeBlockStatsCacheOrder.front());
+                dequeBlockStatsCacheOrder.pop_front();
+            }
+        }
+    }
+
+    return stats;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafe argNames
   //  --------------------- ------------------------  -----------------------  ------ ----------
@@ -1183,8 +1845,10 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getchaintxstats",        &getchaintxstats,        true,  {"nblocks", "blockhash"} },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       true,  {} },
     { "blockchain",         "getblockcount",          &getblockcount,          true,  {} },
-    { "blockchain",         "getblock",               &getblock,               true,  {"blockhash","verbosity|verbose"} },
+    { "blockchain",         "getblock",               &getblock,               true,  {"blockhash","verbosity|verbose"}, RPC_CLASS_BULK },
     { "blockchain",         "getblockhash",           &getblockhash,           true,  {"height"} },
+    { "blockchain",         "getblockstats",          &getblockstats,          true,  {"hash_or_height","nocache"} },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         true,  {"blockhash"} },
     { "blockchain",         "getblockheader",         &getblockheader,         true,  {"blockhash","verbose"} },
     { "blockchain",         "getchaintips",           &getchaintips,           true,  {} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true,  {} },
@@ -1192,9 +1856,13 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  true,  {"txid","verbose"} },
     { "blockchain",         "getmempoolentry",        &getmempoolentry,        true,  {"txid"} },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,  {} },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          true,  {"verbose"} },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          true,  {"verbose"}, RPC_CLASS_BULK },
+    { "blockchain",         "getmempooldelta",        &getmempooldelta,        true,  {"since","verbose"} },
     { "blockchain",         "gettxout",               &gettxout,               true,  {"txid","n","include_mempool"} },
+    { "blockchain",         "pruneblockchain",        &pruneblockchain,        true,  {"height"} },
     { "blockchain",         "verifychain",            &verifychain,            true,  {"checklevel","nblocks"} },
+    { "blockchain",         "dumputxosnapshot",       &dumputxosnapshot,       true,  {"path"} },
+    { "blockchain",         "getutxosethash",         &getutxosethash,         true,  {} },
     { "blockchain",         "getblockbynumber",       &getblockbynumber,       true,  {"number","verbose"} },
     /* Not shown in help */
     { "hidden",             "waitfornewblock",        &waitfornewblock,        true,  {"timeout"} },
@@ -24,6 +24,7 @@
 
 #include <univalue.h>
 #include <set>
+#include <sstream>
 #include <stdint.h>
 
 static const char DEFAULT_RPCCONNECT[] = "127.0.0.1";
@@ -89,6 +90,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getaddressutxos", 0, "addresses"},
     { "getaddresstxids", 0, "addresses"},
     { "getaddresstxids", 1, "includeTokens"},
+    { "getspentinfo", 0, "inputs"},
     { "logging", 0, "include" },
     { "logging", 1, "exclude" },
     // Echo with conversion (For testing only)
@@ -106,6 +108,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
 
     // blockchain
     { "getblockhash", 0, "height" },
+    { "pruneblockchain", 0, "height" },
     { "waitforblockheight", 0, "height" },
     { "waitforblockheight", 1, "timeout" },
     { "waitforblock", 1, "timeout" },
@@ -298,6 +301,7 @@ std::string HelpMessageCli()
     std::string strUsage;
     strUsage += HelpMessageGroup(_("Options:"));
     strUsage += HelpMessageOpt("-?", _("This help message"));
+    strUsage += HelpMessageOpt("-batch", _("Read one complete command per line from standard input (method followed by whitespace-separated arguments; a line starting with '[' is sent verbatim as a JSON-RPC batch array) and run them all over a single keep-alive connection, printing one reply line per command as each arrives"));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), YACOIN_CONF_FILENAME));
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     AppendParamsHelpMessages(strUsage);
@@ -546,6 +550,167 @@ UniValue CallRPC(const std::string& strMethod, const UniValue& params)
     return reply;
 }
 
+//
+// Batch mode: one complete command per stdin line, multiplexed over a single
+// keep-alive connection. evhttp pipelines the queued requests and replies
+// come back in request order, so each one is printed the moment it arrives —
+// no process start, TCP handshake or authentication round per command.
+//
+
+struct BatchState
+{
+    struct event_base* base;
+    int nRemaining;
+    int nRet;
+};
+
+static void batch_request_done(struct evhttp_request *req, void *ctx)
+{
+    BatchState* state = static_cast<BatchState*>(ctx);
+    std::string strPrint;
+    if (req == nullptr || evhttp_request_get_response_code(req) == 0) {
+        strPrint = "error: no response from server";
+        state->nRet = EXIT_FAILURE;
+    } else if (evhttp_request_get_response_code(req) == HTTP_UNAUTHORIZED) {
+        strPrint = "error: incorrect rpcuser or rpcpassword (authorization failed)";
+        state->nRet = EXIT_FAILURE;
+    } else {
+        std::string body;
+        struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+        if (buf) {
+            size_t size = evbuffer_get_length(buf);
+            const char* data = (const char*)evbuffer_pullup(buf, size);
+            if (data)
+                body = std::string(data, size);
+            evbuffer_drain(buf, size);
+        }
+        UniValue valReply(UniValue::VSTR);
+        if (!valReply.read(body)) {
+            strPrint = "error: couldn't parse reply from server";
+            state->nRet = EXIT_FAILURE;
+        } else if (valReply.isArray()) {
+            // Reply to a raw JSON-RPC batch array line: one array, one line
+            strPrint = valReply.write();
+        } else {
+            const UniValue& error = find_value(valReply, "error");
+            if (!error.isNull()) {
+                // Keep the reply on stdout so the output lines stay aligned
+                // 1:1 with the input lines
+                strPrint = "error: " + error.write();
+                state->nRet = abs(error["code"].get_int());
+            } else {
+                const UniValue& result = find_value(valReply, "result");
+                if (result.isNull())
+                    strPrint = "";
+                else if (result.isStr())
+                    strPrint = result.get_str();
+                else
+                    strPrint = result.write();
+            }
+        }
+    }
+    fprintf(stdout, "%s\n", strPrint.c_str());
+    fflush(stdout);
+    if (--state->nRemaining == 0)
+        event_base_loopexit(state->base, nullptr);
+}
+
+static int BatchLineRPC()
+{
+    std::string host;
+    int port = BaseParams().RPCPort();
+    SplitHostPort(gArgs.GetArg("-rpcconnect", DEFAULT_RPCCONNECT), port, host);
+    port = gArgs.GetArg("-rpcport", port);
+
+    raii_event_base base = obtain_event_base();
+    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
+    evhttp_connection_set_timeout(evcon.get(), gArgs.GetArg("-rpcclienttimeout", DEFAULT_HTTP_CLIENT_TIMEOUT));
+
+    // Get credentials
+    std::string strRPCUserColonPass;
+    if (gArgs.GetArg("-rpcpassword", "") == "") {
+        if (!GetAuthCookie(&strRPCUserColonPass)) {
+            throw std::runtime_error(strprintf(
+                _("Could not locate RPC credentials. No authentication cookie could be found, and no rpcpassword is set in the configuration file (%s)"),
+                    GetConfigFile(gArgs.GetArg("-conf", YACOIN_CONF_FILENAME)).string().c_str()));
+        }
+    } else {
+        strRPCUserColonPass = gArgs.GetArg("-rpcuser", "") + ":" + gArgs.GetArg("-rpcpassword", "");
+    }
+
+    // check if we should use a special wallet endpoint
+    std::string endpoint = "/";
+    std::string walletName = gArgs.GetArg("-rpcwallet", "");
+    if (!walletName.empty()) {
+        char *encodedURI = evhttp_uriencode(walletName.c_str(), walletName.size(), false);
+        if (encodedURI) {
+            endpoint = "/wallet/"+ std::string(encodedURI);
+            free(encodedURI);
+        }
+        else {
+            throw CConnectionFailed("uri-encode failed");
+        }
+    }
+
+    BatchState state;
+    state.base = base.get();
+    state.nRemaining = 0;
+    state.nRet = 0;
+
+    int nId = 1;
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::string strRequest;
+        if (!line.empty() && line[0] == '[') {
+            // Pre-built JSON-RPC batch array, forwarded untouched
+            strRequest = line + "\n";
+        } else {
+            std::istringstream stream(line);
+            std::vector<std::string> args;
+            std::string word;
+            while (stream >> word)
+                args.push_back(word);
+            if (args.empty())
+                continue;
+            std::string strMethod = args[0];
+            args.erase(args.begin());
+            UniValue params;
+            if (gArgs.GetBoolArg("-named", DEFAULT_NAMED)) {
+                params = RPCConvertNamedValues(strMethod, args);
+            } else {
+                params = RPCConvertValues(strMethod, args);
+            }
+            strRequest = JSONRPCRequestObj(strMethod, params, nId++).write() + "\n";
+        }
+
+        raii_evhttp_request req = obtain_evhttp_request(batch_request_done, (void*)&state);
+        if (req == nullptr)
+            throw std::runtime_error("create http request failed");
+
+        struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
+        assert(output_headers);
+        evhttp_add_header(output_headers, "Host", host.c_str());
+        evhttp_add_header(output_headers, "Connection", "keep-alive");
+        evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(strRPCUserColonPass)).c_str());
+
+        struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
+        assert(output_buffer);
+        evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
+
+        int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, endpoint.c_str());
+        req.release(); // ownership moved to evcon in above call
+        if (r != 0) {
+            throw CConnectionFailed("send http request failed");
+        }
+        ++state.nRemaining;
+    }
+    if (state.nRemaining == 0)
+        throw std::runtime_error("no commands on standard input (batch mode reads one command per line)");
+
+    event_base_dispatch(base.get());
+    return state.nRet;
+}
+
 int CommandLineRPC(int argc, char *argv[])
 {
     std::string strPrint;
@@ -556,6 +721,9 @@ int CommandLineRPC(int argc, char *argv[])
             argc--;
             argv++;
         }
+        if (gArgs.GetBoolArg("-batch", false)) {
+            return BatchLineRPC();
+        }
         std::vector<std::string> args = std::vector<std::string>(&argv[1], &argv[argc]);
         if (gArgs.GetBoolArg("-stdin", false)) {
             // Read one arg per line from stdin and append
@@ -16,11 +16,13 @@
 #include "validation.h"
 #include "miner.h"
 #include "net.h"
+#include "policy/feerate.h"
 #include "policy/fees.h"
 #include "pow.h"
 #include "rpc/blockchain.h"
 #include "rpc/mining.h"
 #include "rpc/server.h"
+#include "scrypt.h"
 #include "txmempool.h"
 #include "util.h"
 #include "utilstrencodings.h"
@@ -31,6 +33,8 @@
 #include <memory>
 #include <stdint.h>
 
+#include <boost/thread.hpp>
+
 #include <univalue.h>
 
 extern uint64_t nHashesPerSec;
@@ -168,7 +172,7 @@ UniValue generateBlocks(std::shared_ptr<CReserveScript> coinbaseScript, int nGen
     UniValue blockHashes(UniValue::VARR);
     while (nHeight < nHeightEnd)
     {
-        std::unique_ptr<CBlockTemplate> pblocktemplate(BlockAssembler().CreateNewBlock(coinbaseScript->reserveScript));
+        std::unique_ptr<CBlockTemplate> pblocktemplate(TemplateAssembler().CreateTemplate(coinbaseScript->reserveScript));
         if (!pblocktemplate.get())
             throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't create new block");
         CBlock *pblock = &pblocktemplate->block;
@@ -372,7 +376,7 @@ UniValue getwork(const JSONRPCRequest& request)
             nStart = GetTime();
 
             // Create new block
-            pblocktemplate = BlockAssembler().CreateNewBlock(coinbase_script->reserveScript);
+            pblocktemplate = TemplateAssembler().CreateTemplate(coinbase_script->reserveScript);
             if (!pblocktemplate.get())
                 throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't create new block");
 
@@ -475,7 +479,8 @@ UniValue getwork(const JSONRPCRequest& request)
         }
         pblock->vtx[0].vin[0].scriptSig = mapNewBlock[pdata->merkle_root].second;
 
-        pblock->hashMerkleRoot = pblock->BuildMerkleTree();
+        // Only the coinbase scriptSig changed since the template was built
+        pblock->hashMerkleRoot = pblock->UpdateCoinbaseMerkleRoot();
 
         if (!pblock->SignBlock(*pwallet))
         {
@@ -510,11 +515,26 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
             "  \"noncerange\" : range of valid nonces\n"
             "  \"sigoplimit\" : limit of sigops in blocks\n"
             "  \"sizelimit\" : limit of block size\n"
+            "  \"validationtime\" : summed measured validation cost of the selected transactions, in milliseconds\n"
             "  \"bits\" : compressed target of next block\n"
             "  \"height\" : height of the next block\n"
+            "  \"longpollid\" : pass in the next request to wait for a changed template\n"
+            "The template_request may set \"maxvalidationtime\" (cap on the summed measured\n"
+            "validation cost of the selected transactions) and \"templatebudget\" (wall-clock\n"
+            "limit on package selection itself), both in milliseconds with 0 meaning\n"
+            "unlimited; they override -blockmaxvalidationtime and -blocktemplatebudget.\n"
+            "When a \"longpollid\" is passed the call blocks until the tip changes or new\n"
+            "transactions arrive; while the tip is unchanged the reply carries only the\n"
+            "fields that may have changed (transactions, coinbasevalue, curtime,\n"
+            "longpollid) and the client keeps the rest from its previous template.\n"
             "See https://en.bitcoin.it/wiki/BIP_0022 for full specification.");
 
     std::string strMode = "template";
+    UniValue lpval = NullUniValue;
+    // Template budgets (milliseconds); -1 keeps the node's configured
+    // -blockmaxvalidationtime / -blocktemplatebudget defaults
+    int64_t nMaxValidationTimeMs = -1;
+    int64_t nTemplateBudgetMs = -1;
     if (request.params.size() > 0)
     {
         const UniValue& oparam = request.params[0].get_obj();
@@ -527,6 +547,20 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
         }
         else
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid mode");
+        lpval = find_value(oparam, "longpollid");
+
+        const UniValue& validval = find_value(oparam, "maxvalidationtime");
+        if (validval.isNum()) {
+            nMaxValidationTimeMs = validval.get_int64();
+            if (nMaxValidationTimeMs < 0)
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid maxvalidationtime");
+        }
+        const UniValue& budgetval = find_value(oparam, "templatebudget");
+        if (budgetval.isNum()) {
+            nTemplateBudgetMs = budgetval.get_int64();
+            if (nTemplateBudgetMs < 0)
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid templatebudget");
+        }
     }
 
     if (strMode != "template")
@@ -547,6 +581,64 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     static CBlockIndex* pindexPrev;
     static int64_t nStart;
     static std::unique_ptr<CBlockTemplate> pblocktemplate;
+    // Serialized "transactions" array of the cached template; hex-encoding
+    // every transaction again on each poll was the expensive part, so it is
+    // only redone when the template itself is rebuilt
+    static UniValue transactionsCached(UniValue::VARR);
+
+    // Whether the client already holds a template for the current tip, and
+    // which template generation it was (the counter part of its longpollid)
+    bool fClientHasTemplate = false;
+    unsigned int nClientTemplateId = 0;
+
+    if (!lpval.isNull())
+    {
+        // Wait to respond until either the best block changes, OR a minute has
+        // passed and there are more transactions
+        uint256 hashWatchedChain;
+        boost::system_time checktxtime;
+        unsigned int nTransactionsUpdatedLastLP;
+
+        if (lpval.isStr())
+        {
+            // Format: <hashBestChain><nTransactionsUpdatedLast>
+            std::string lpstr = lpval.get_str();
+            hashWatchedChain.SetHex(lpstr.substr(0, 64));
+            nTransactionsUpdatedLastLP = atoi64(lpstr.substr(64));
+        }
+        else
+        {
+            // NOTE: Spec does not specify behaviour for non-string longpollid, but this makes testing easier
+            hashWatchedChain = chainActive.Tip()->GetBlockHash();
+            nTransactionsUpdatedLastLP = nTransactionsUpdatedLast;
+        }
+
+        {
+            checktxtime = boost::get_system_time() + boost::posix_time::minutes(1);
+
+            boost::unique_lock<boost::mutex> lock(csBestBlock);
+            while (chainActive.Tip()->GetBlockHash() == hashWatchedChain && IsRPCRunning())
+            {
+                if (!cvBlockChange.timed_wait(lock, checktxtime))
+                {
+                    // Timeout: Check transactions for update
+                    if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLastLP)
+                        break;
+                    checktxtime += boost::posix_time::seconds(10);
+                }
+            }
+        }
+
+        if (!IsRPCRunning())
+            throw JSONRPCError(RPC_CLIENT_NOT_CONNECTED, "Shutting down");
+
+        if (lpval.isStr() && chainActive.Tip()->GetBlockHash() == hashWatchedChain)
+        {
+            fClientHasTemplate = true;
+            nClientTemplateId = nTransactionsUpdatedLastLP;
+        }
+    }
+
     unsigned int nTransactionsUpdated = mempool.GetTransactionsUpdated();
 
     if (pindexPrev != chainActive.Tip() ||
@@ -560,49 +652,68 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
         CBlockIndex* pindexPrevNew = chainActive.Tip();
         nStart = GetTime();
 
-        pblocktemplate = BlockAssembler().CreateNewBlock(coinbase_script->reserveScript);
+        pblocktemplate = TemplateAssembler().CreateTemplate(coinbase_script->reserveScript,
+                                                            nMaxValidationTimeMs, nTemplateBudgetMs);
         if (!pblocktemplate.get())
             throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't create new block");
 
         // Need to update only after we know CreateNewBlock succeeded
         pindexPrev = pindexPrevNew;
+
+        // Re-serialize the transaction list for the new template
+        transactionsCached = UniValue(UniValue::VARR);
+        std::map<uint256, int64_t> setTxIndex;
+        int i = 0;
+        for(CTransaction& tx : pblocktemplate->block.vtx)
+        {
+            uint256 txHash = tx.GetHash();
+            setTxIndex[txHash] = i++;
+
+            if (tx.IsCoinBase() || tx.IsCoinStake())
+                continue;
+
+            UniValue entry(UniValue::VOBJ);
+
+            CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION);
+            ssTx << tx;
+            entry.push_back(Pair("data", HexStr(ssTx.begin(), ssTx.end())));
+            entry.push_back(Pair("hash", txHash.GetHex()));
+
+            UniValue deps(UniValue::VARR);
+            for (const CTxIn &in : tx.vin)
+            {
+                if (setTxIndex.count(in.prevout.hash))
+                    deps.push_back(setTxIndex[in.prevout.hash]);
+            }
+            entry.push_back(Pair("depends", deps));
+
+            int index_in_template = i - 1;
+            entry.push_back(Pair("fee", pblocktemplate->vTxFees[index_in_template]));
+            int64_t nTxSigOps = pblocktemplate->vTxSigOpsCost[index_in_template];
+            entry.push_back(Pair("sigops", nTxSigOps));
+            transactionsCached.push_back(entry);
+        }
     }
     CBlock* pblock = &pblocktemplate->block; // pointer for convenience
     // Update nTime
     pblock->UpdateTime(pindexPrev);
     pblock->nNonce = 0;
 
-    UniValue transactions(UniValue::VARR);
-    std::map<uint256, int64_t> setTxIndex;
-    int i = 0;
-    for(CTransaction& tx : pblock->vtx)
-    {
-        uint256 txHash = tx.GetHash();
-        setTxIndex[txHash] = i++;
-
-        if (tx.IsCoinBase() || tx.IsCoinStake())
-            continue;
-
-        UniValue entry(UniValue::VOBJ);
-
-        CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION);
-        ssTx << tx;
-        entry.push_back(Pair("data", HexStr(ssTx.begin(), ssTx.end())));
-        entry.push_back(Pair("hash", txHash.GetHex()));
+    std::string strLongPollId = pindexPrev->GetBlockHash().GetHex() + i64tostr(nTransactionsUpdatedLast);
 
-        UniValue deps(UniValue::VARR);
-        for (const CTxIn &in : tx.vin)
-        {
-            if (setTxIndex.count(in.prevout.hash))
-                deps.push_back(setTxIndex[in.prevout.hash]);
+    if (fClientHasTemplate)
+    {
+        // The tip has not changed since the client's template, so every field
+        // derived from pindexPrev is unchanged on its side; send only what
+        // may have moved
+        UniValue result(UniValue::VOBJ);
+        if (nClientTemplateId != nTransactionsUpdatedLast) {
+            result.push_back(Pair("transactions", transactionsCached));
+            result.push_back(Pair("coinbasevalue", (int64_t)pblock->vtx[0].vout[0].nValue));
         }
-        entry.push_back(Pair("depends", deps));
-
-        int index_in_template = i - 1;
-        entry.push_back(Pair("fee", pblocktemplate->vTxFees[index_in_template]));
-        int64_t nTxSigOps = pblocktemplate->vTxSigOpsCost[index_in_template];
-        entry.push_back(Pair("sigops", nTxSigOps));
-        transactions.push_back(entry);
+        result.push_back(Pair("curtime", (int64_t)pblock->nTime));
+        result.push_back(Pair("longpollid", strLongPollId));
+        return result;
     }
 
     UniValue aux(UniValue::VOBJ);
@@ -618,7 +729,8 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("version", pblock->nVersion));
     result.push_back(Pair("previousblockhash", pblock->hashPrevBlock.GetHex()));
-    result.push_back(Pair("transactions", transactions));
+    result.push_back(Pair("transactions", transactionsCached));
+    result.push_back(Pair("longpollid", strLongPollId));
     result.push_back(Pair("coinbaseaux", aux));
     result.push_back(Pair("coinbasevalue", (int64_t)pblock->vtx[0].vout[0].nValue));
     result.push_back(Pair("target", hashTarget.GetHex()));
@@ -627,6 +739,7 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     result.push_back(Pair("noncerange", "00000000ffffffff"));
     result.push_back(Pair("sigoplimit", (uint64_t)GetMaxSize(MAX_BLOCK_SIGOPS)));
     result.push_back(Pair("sizelimit", (uint64_t)GetMaxSize(MAX_BLOCK_SIZE)));
+    result.push_back(Pair("validationtime", pblocktemplate->nValidationTimeUs / 1000));
     result.push_back(Pair("curtime", (int64_t)pblock->nTime));
     result.push_back(Pair("bits", strprintf("%08x", pblock->nBits)));
     result.push_back(Pair("height", (int64_t)(pindexPrev->nHeight+1)));
@@ -673,15 +786,153 @@ UniValue submitblock(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+UniValue estimatefee(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "estimatefee ( percentile )\n"
+            "\nEstimates the fee rate per kilobyte recently confirmed transactions have been paying,\n"
+            "from exponentially decayed fee-rate buckets updated as blocks connect. The answer is\n"
+            "never below the protocol minimum fee rate and is read from a snapshot, so this call\n"
+            "never blocks on block connection.\n"
+            "\nArguments:\n"
+            "1. percentile   (numeric, optional, default=50) Report the fee rate at or below which\n"
+            "                this percentage of recently confirmed transactions paid (1 - 99)\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"feerate\" : x.x,     (numeric) estimated fee rate in " + CURRENCY_UNIT + "/kB\n"
+            "  \"minfeerate\" : x.x,  (numeric) protocol minimum fee rate in " + CURRENCY_UNIT + "/kB\n"
+            "  \"blocks\" : n         (numeric) number of blocks folded into the estimate\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("estimatefee", "90")
+            + HelpExampleRpc("estimatefee", "90")
+        );
+
+    double dPercentile = 50;
+    if (!request.params[0].isNull()) {
+        dPercentile = request.params[0].get_real();
+        if (dPercentile < 1 || dPercentile > 99)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "percentile must be between 1 and 99");
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("feerate", ValueFromAmount(feeEstimator.EstimateFeePerK(dPercentile / 100.0))));
+    result.push_back(Pair("minfeerate", ValueFromAmount(MIN_TX_FEE)));
+    result.push_back(Pair("blocks", (int64_t)feeEstimator.GetBlocksSeen()));
+    return result;
+}
+
+//! Earliest unix time after nTimeStart at which GetNfactor exceeds nFactorNow,
+//! or 0 if the schedule never increases again (it tops out at maxNfactor).
+static int64_t NextNfactorFlip(int64_t nTimeStart, unsigned char nFactorNow)
+{
+    int64_t lo = nTimeStart;
+    int64_t hi = nTimeStart + (int64_t)100 * 365 * 24 * 60 * 60;
+    if (GetNfactor(hi) <= nFactorNow)
+        return 0;
+    // GetNfactor is non-decreasing in the timestamp, so binary search the boundary
+    while (lo + 1 < hi) {
+        int64_t mid = lo + (hi - lo) / 2;
+        if (GetNfactor(mid) > nFactorNow)
+            hi = mid;
+        else
+            lo = mid;
+    }
+    return hi;
+}
+
+//! Time nHashes runs of the production scrypt_hash path; hashes per second
+static double BenchHashAtNfactor(unsigned char nFactor, int nHashes)
+{
+    unsigned char header[80];
+    memset(header, 0x42, sizeof(header));
+    ::uint32_t res[8];
+    int64_t nStart = GetTimeMicros();
+    for (int i = 0; i < nHashes; i++) {
+        // vary the input so no layer underneath can reuse a prior result
+        memcpy(header, &i, sizeof(i));
+        scrypt_hash(header, sizeof(header), res, nFactor);
+    }
+    int64_t nElapsed = GetTimeMicros() - nStart;
+    if (nElapsed <= 0)
+        nElapsed = 1;
+    return (double)nHashes * 1000000.0 / nElapsed;
+}
+
+UniValue benchhash(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 2)
+        throw std::runtime_error(
+            "benchhash ( hashes lookahead )\n"
+            "\nMeasures local scrypt throughput through the production hash path at the\n"
+            "current Nfactor and at the next scheduled Nfactor increases, projecting the\n"
+            "header hash cost of verifying a block at each, so hardware that will fall\n"
+            "behind can be spotted before the epoch actually flips.\n"
+            "\nArguments:\n"
+            "1. hashes       (numeric, optional, default=50) number of hashes timed per Nfactor\n"
+            "2. lookahead    (numeric, optional, default=2) future Nfactor steps to benchmark\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"nfactor\": n,                   (numeric) scrypt N factor benchmarked\n"
+            "    \"activation_time\": nnn,         (numeric) unix time it takes effect (0 = active now)\n"
+            "    \"scratchpad_kb\": nnn,           (numeric) approximate scrypt memory per hash\n"
+            "    \"hashes_per_second\": n.nnn,     (numeric) measured single-thread throughput\n"
+            "    \"block_verification_ms\": n.nnn  (numeric) projected header hash cost per block\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("benchhash", "100 3")
+            + HelpExampleRpc("benchhash", "100, 3")
+        );
+
+    int nHashes = 50;
+    if (request.params.size() > 0)
+        nHashes = request.params[0].get_int();
+    if (nHashes < 1 || nHashes > 10000)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "hashes must be between 1 and 10000");
+
+    int nLookahead = 2;
+    if (request.params.size() > 1)
+        nLookahead = request.params[1].get_int();
+    if (nLookahead < 0 || nLookahead > 8)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "lookahead must be between 0 and 8");
+
+    UniValue result(UniValue::VARR);
+    int64_t nActivationTime = 0;
+    int64_t nTime = GetTime();
+    unsigned char nFactor = GetNfactor(nTime);
+    for (int nStep = 0; nStep <= nLookahead; nStep++) {
+        double dHashesPerSec = BenchHashAtNfactor(nFactor, nHashes);
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("nfactor", (int)nFactor));
+        entry.push_back(Pair("activation_time", nActivationTime));
+        entry.push_back(Pair("scratchpad_kb", (int64_t)(((uint64_t)128 << (nFactor + 1)) / 1024)));
+        entry.push_back(Pair("hashes_per_second", dHashesPerSec));
+        entry.push_back(Pair("block_verification_ms", dHashesPerSec > 0 ? 1000.0 / dHashesPerSec : 0.0));
+        result.push_back(entry);
+
+        nActivationTime = NextNfactorFlip(nTime, nFactor);
+        if (nActivationTime == 0)
+            break; // schedule has topped out
+        nTime = nActivationTime;
+        nFactor = GetNfactor(nTime);
+    }
+    return result;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
+    { "mining",             "benchhash",              &benchhash,              true,  {"hashes","lookahead"} },
     { "mining",             "gethashespersec",        &gethashespersec,        true,   {} },
     { "mining",             "getmininginfo",          &getmininginfo,          true,  {} },
     { "mining",             "getsubsidy",             &getsubsidy,             true,  {"ntarget"} },
     { "mining",             "getwork",                &getwork,                true,  {"data"} },
-    { "mining",             "getblocktemplate",       &getblocktemplate,       true,  {"template_request"} },
-    { "mining",             "submitblock",            &submitblock,            true,  {"hexdata","dummy"} },
+    { "mining",             "getblocktemplate",       &getblocktemplate,       true,  {"template_request"}, RPC_CLASS_FAST },
+    { "mining",             "submitblock",            &submitblock,            true,  {"hexdata","dummy"}, RPC_CLASS_FAST },
+    { "mining",             "estimatefee",            &estimatefee,            true,  {"percentile"} },
 
     /* Coin generation */
     { "generating",         "getgenerate",            &getgenerate,            true, {}  },
@@ -14,6 +14,7 @@
 #include "init.h"
 #include "validation.h"
 #include "httpserver.h"
+#include "memmonitor.h"
 #include "net.h"
 #include "netbase.h"
 #include "rpc/blockchain.h"
@@ -178,6 +179,34 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         if (!AreTokensDeployed())
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Tokens aren't active.  includeTokens can't be true.");
 
+        // Databases built since the balance rollups exist answer this with
+        // one point read per (address, token) instead of walking every
+        // historical delta of the address
+        if (fAddressRollup) {
+            std::map<std::string, std::pair<CAmount, CAmount>> balances;
+            for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+                std::vector<std::pair<std::string, CAddressBalanceValue> > rollups;
+                if (!GetAddressBalances((*it).first, (*it).second, rollups)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
+                for (const std::pair<std::string, CAddressBalanceValue>& rollup : rollups) {
+                    balances[rollup.first].first += rollup.second.received;
+                    balances[rollup.first].second += rollup.second.balance;
+                }
+            }
+
+            UniValue result(UniValue::VARR);
+            for (std::map<std::string, std::pair<CAmount, CAmount>>::const_iterator it = balances.begin();
+                    it != balances.end(); it++) {
+                UniValue balance(UniValue::VOBJ);
+                balance.push_back(Pair("tokenName", it->first));
+                balance.push_back(Pair("balance", it->second.second));
+                balance.push_back(Pair("received", it->second.first));
+                result.push_back(balance);
+            }
+            return result;
+        }
+
         std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
         for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
@@ -215,6 +244,24 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         return result;
 
     } else {
+        if (fAddressRollup) {
+            CAmount balance = 0;
+            CAmount received = 0;
+            for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+                CAddressBalanceValue value;
+                if (!GetAddressBalance((*it).first, (*it).second, YAC, value)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
+                balance += value.balance;
+                received += value.received;
+            }
+
+            UniValue result(UniValue::VOBJ);
+            result.push_back(Pair("balance", balance));
+            result.push_back(Pair("received", received));
+            return result;
+        }
+
         std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
         for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
@@ -268,6 +315,8 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "  \"end\" (number) The end block height\n"
             "  \"chainInfo\" (boolean) Include chain info in results, only applies if start and end specified\n"
             "  \"tokenName\"   (string, optional) Get deltas for a particular token instead of YAC.\n"
+            "  \"count\" (number, optional) Return at most this many deltas\n"
+            "  \"offset\" (number, optional) Skip this many deltas before returning results, only applies if count specified\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -320,21 +369,43 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         }
     }
 
+    int nCount = -1;
+    int nOffset = 0;
+    UniValue countValue = find_value(request.params[0].get_obj(), "count");
+    UniValue offsetValue = find_value(request.params[0].get_obj(), "offset");
+    if (countValue.isNum()) {
+        nCount = countValue.get_int();
+        if (nCount <= 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Count is expected to be greater than zero");
+        }
+        if (offsetValue.isNum()) {
+            nOffset = offsetValue.get_int();
+            if (nOffset < 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Offset is expected to be zero or greater");
+            }
+        }
+    }
+
     std::vector<std::pair<uint160, int> > addresses;
 
     if (!getAddressesFromParams(request.params, addresses)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    // Only the first offset+count entries can make it into the page, so cap
+    // the index scans there; response time then tracks the page size rather
+    // than the full address history
+    int nMaxEntries = nCount < 0 ? -1 : nOffset + nCount;
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
         if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, tokenName, addressIndex, start, end)) {
+            if (!GetAddressIndex((*it).first, (*it).second, tokenName, addressIndex, start, end, nMaxEntries)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         } else {
-            if (!GetAddressIndex((*it).first, (*it).second, tokenName, addressIndex)) {
+            if (!GetAddressIndex((*it).first, (*it).second, tokenName, addressIndex, 0, 0, nMaxEntries)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         }
@@ -342,7 +413,15 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
 
     UniValue deltas(UniValue::VARR);
 
+    int nSkipped = 0;
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+        if (nSkipped < nOffset) {
+            nSkipped++;
+            continue;
+        }
+        if (nCount >= 0 && (int)deltas.size() >= nCount) {
+            break;
+        }
         std::string address;
         if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
@@ -535,6 +614,8 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number, optional) The start block height\n"
             "  \"end\" (number, optional) The end block height\n"
+            "  \"count\" (number, optional) Return at most this many txids\n"
+            "  \"offset\" (number, optional) Skip this many txids before returning results, only applies if count specified\n"
             "},\n"
             "\"includeTokens\" (boolean, optional, default false)  If true this will return an expanded result which includes token transactions\n"
             "\nResult:\n"
@@ -557,6 +638,8 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
 
     int start = 0;
     int end = 0;
+    int nCount = -1;
+    int nOffset = 0;
     if (request.params[0].isObject()) {
         UniValue startValue = find_value(request.params[0].get_obj(), "start");
         UniValue endValue = find_value(request.params[0].get_obj(), "end");
@@ -564,6 +647,20 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             start = startValue.get_int();
             end = endValue.get_int();
         }
+        UniValue countValue = find_value(request.params[0].get_obj(), "count");
+        UniValue offsetValue = find_value(request.params[0].get_obj(), "offset");
+        if (countValue.isNum()) {
+            nCount = countValue.get_int();
+            if (nCount <= 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Count is expected to be greater than zero");
+            }
+            if (offsetValue.isNum()) {
+                nOffset = offsetValue.get_int();
+                if (nOffset < 0) {
+                    throw JSONRPCError(RPC_INVALID_PARAMETER, "Offset is expected to be zero or greater");
+                }
+            }
+        }
     }
 
     bool includeTokens = false;
@@ -601,8 +698,12 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         }
     }
 
+    // Several index entries (one per affected input/output) collapse into one
+    // txid here, so count/offset are applied after deduplication rather than
+    // being pushed down into the index scan
     std::set<std::pair<int, std::string> > txids;
     UniValue result(UniValue::VARR);
+    int nSkipped = 0;
 
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
         int height = it->first.blockHeight;
@@ -612,6 +713,13 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             txids.insert(std::make_pair(height, txid));
         } else {
             if (txids.insert(std::make_pair(height, txid)).second) {
+                if (nSkipped < nOffset) {
+                    nSkipped++;
+                    continue;
+                }
+                if (nCount >= 0 && (int)result.size() >= nCount) {
+                    break;
+                }
                 result.push_back(txid);
             }
         }
@@ -619,6 +727,13 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
 
     if (addresses.size() > 1) {
         for (std::set<std::pair<int, std::string> >::const_iterator it=txids.begin(); it!=txids.end(); it++) {
+            if (nSkipped < nOffset) {
+                nSkipped++;
+                continue;
+            }
+            if (nCount >= 0 && (int)result.size() >= nCount) {
+                break;
+            }
             result.push_back(it->second);
         }
     }
@@ -687,7 +802,7 @@ UniValue getinfo(const JSONRPCRequest& request)
     ConvertUpTimeToNiceString( nUpTimeSeconds, sUpTime );
 
     obj.push_back(Pair("up-time",       sUpTime));
-    obj.push_back(Pair("moneysupply",   ValueFromAmount(chainActive.Tip()->nMoneySupply)));
+    obj.push_back(Pair("moneysupply",   ValueFromAmount(chainActive.Tip()->GetMoneySupply())));
     if(g_connman)
         obj.push_back(Pair("connections",   (int)g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL)));
     obj.push_back(Pair("proxy",         (proxy.IsValid() ? proxy.proxy.ToStringIPPort() : std::string())));
@@ -761,6 +876,13 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "  },\n"
+            "  \"components\": {          (json object) Tracked dynamic memory per component, in bytes\n"
+            "    \"mempool\": xxxxx,       (numeric) Transaction memory pool\n"
+            "    \"coinscache\": xxxxx,    (numeric) In-memory coins cache\n"
+            "    \"peerbuffers\": xxxxx,   (numeric) Per-peer send and receive-processing queues\n"
+            "    \"tokencache\": xxxxx,    (numeric) Token cache\n"
+            "    \"total\": xxxxxx,        (numeric) Sum of the tracked components\n"
             "  }\n"
             "}\n"
             "\nResult (mode \"mallocinfo\"):\n"
@@ -774,6 +896,14 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.push_back(Pair("locked", RPCLockedMemoryInfo()));
+        MemoryComponentUsage usage = GetMemoryComponentUsage();
+        UniValue components(UniValue::VOBJ);
+        components.push_back(Pair("mempool", (uint64_t)usage.nMempool));
+        components.push_back(Pair("coinscache", (uint64_t)usage.nCoinsCache));
+        components.push_back(Pair("peerbuffers", (uint64_t)usage.nPeerBuffers));
+        components.push_back(Pair("tokencache", (uint64_t)usage.nTokenCache));
+        components.push_back(Pair("total", (uint64_t)usage.nTotal));
+        obj.push_back(Pair("components", components));
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
@@ -1235,6 +1365,49 @@ UniValue logging(const JSONRPCRequest& request)
     return result;
 }
 
+UniValue getlockstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getlockstats ( reset )\n"
+            "Returns per-critical-section acquisition counters, aggregated by lock name\n"
+            "since startup (or the last reset). Only available in builds compiled with\n"
+            "-DDEBUG_LOCKSTATS; try-locks are not counted.\n"
+            "\nArguments:\n"
+            "1. reset            (boolean, optional, default=false) Clear the counters after reading them.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"cs_main\": {               (json object) One entry per lock name\n"
+            "    \"acquisitions\": xxxxx,   (numeric) Blocking acquisitions\n"
+            "    \"contended\": xxxxx,      (numeric) Acquisitions that had to wait for another thread\n"
+            "    \"wait_usec\": xxxxx,      (numeric) Total time spent waiting, in microseconds\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getlockstats", "")
+            + HelpExampleRpc("getlockstats", "true")
+        );
+
+#ifdef DEBUG_LOCKSTATS
+    bool fReset = false;
+    if (request.params.size() > 0 && !request.params[0].isNull())
+        fReset = request.params[0].get_bool();
+
+    UniValue ret(UniValue::VOBJ);
+    for (const auto& entry : LockStatsSnapshot(fReset)) {
+        UniValue stats(UniValue::VOBJ);
+        stats.push_back(Pair("acquisitions", entry.second.nAcquisitions));
+        stats.push_back(Pair("contended", entry.second.nContended));
+        stats.push_back(Pair("wait_usec", entry.second.nWaitTimeMicros));
+        ret.push_back(Pair(entry.first, stats));
+    }
+    return ret;
+#else
+    throw JSONRPCError(RPC_MISC_ERROR, "getlockstats requires a build compiled with -DDEBUG_LOCKSTATS");
+#endif
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
@@ -1256,6 +1429,7 @@ static const CRPCCommand commands[] =
     { "hidden",             "echo",                   &echo,                   true,  {"arg0","arg1","arg2","arg3","arg4","arg5","arg6","arg7","arg8","arg9"}},
     { "hidden",             "echojson",               &echo,                   true,  {"arg0","arg1","arg2","arg3","arg4","arg5","arg6","arg7","arg8","arg9"}},
     { "hidden",             "logging",                &logging,                true,  {"include", "exclude"}},
+    { "hidden",             "getlockstats",           &getlockstats,           true,  {"reset"}},
 };
 
 void RegisterMiscRPCCommands(CRPCTable &t)
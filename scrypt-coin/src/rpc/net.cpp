@@ -155,6 +155,9 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
             "    \"lastrecv\": ttt,           (numeric) The time in seconds since epoch (Jan 1 1970 GMT) of the last receive\n"
             "    \"bytessent\": n,            (numeric) The total bytes sent\n"
             "    \"bytesrecv\": n,            (numeric) The total bytes received\n"
+            "    \"msgssent\": n,             (numeric) The total messages sent\n"
+            "    \"msgsrecv\": n,             (numeric) The total messages received\n"
+            "    \"sendrate\": n,             (numeric) Send rate cap applied to this peer in bytes per second, 0 = unshaped\n"
             "    \"conntime\": ttt,           (numeric) The connection time in seconds since epoch (Jan 1 1970 GMT)\n"
             "    \"timeoffset\": ttt,         (numeric) The time offset in seconds\n"
             "    \"pingtime\": n,             (numeric) ping time (if available)\n"
@@ -213,6 +216,9 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
         obj.push_back(Pair("lastrecv", DateTimeStrFormat("%Y-%m-%d %H:%M:%S", stats.nLastRecv) ) );
         obj.push_back(Pair("bytessent", stats.nSendBytes));
         obj.push_back(Pair("bytesrecv", stats.nRecvBytes));
+        obj.push_back(Pair("msgssent", stats.nSendMsgs));
+        obj.push_back(Pair("msgsrecv", stats.nRecvMsgs));
+        obj.push_back(Pair("sendrate", stats.nSendRate));
         obj.push_back(Pair("conntime", DateTimeStrFormat("%Y-%m-%d %H:%M:%S", stats.nTimeConnected) ) );
         obj.push_back(Pair("timeoffset", stats.nTimeOffset));
         if (stats.dPingTime > 0.0)
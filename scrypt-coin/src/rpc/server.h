@@ -128,6 +128,19 @@ void RPCRunLater(const std::string& name, std::function<void(void)> func, int64_
 
 typedef UniValue(*rpcfn_type)(const JSONRPCRequest& jsonRequest);
 
+/**
+ * Worker-lane class of an RPC command. The HTTP server keeps reserved worker
+ * threads for RPC_CLASS_FAST methods and drains RPC_CLASS_BULK methods only
+ * when no normal work is waiting, so a time-critical submitblock never queues
+ * behind an explorer pulling whole blocks.
+ */
+enum RPCCommandClass
+{
+    RPC_CLASS_NORMAL = 0, //!< regular lane (default for table entries that leave the field out)
+    RPC_CLASS_FAST,       //!< time-critical; served by the reserved fast lane
+    RPC_CLASS_BULK,       //!< potentially huge replies; lowest dequeue priority
+};
+
 class CRPCCommand
 {
 public:
@@ -136,6 +149,7 @@ public:
     rpcfn_type actor;
     bool okSafeMode;
     std::vector<std::string> argNames;
+    RPCCommandClass cmdClass;
 };
 
 /**
@@ -0,0 +1,147 @@
+// Copyright (c) 2017-2025 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/stream.h"
+
+#include "httpserver.h"
+#include "rpc/protocol.h"
+#include "rpc/server.h"
+#include "util.h"
+
+#include <univalue.h>
+
+//! Bytes staged before handing a chunk to the libevent output buffer
+static const size_t JSON_STREAM_CHUNK_SIZE = 0x10000;
+
+void JSONStreamWriter::Put(const std::string& s)
+{
+    buf += s;
+    if (buf.size() >= JSON_STREAM_CHUNK_SIZE)
+        Flush();
+}
+
+void JSONStreamWriter::Flush()
+{
+    if (!fStreaming) {
+        // The first flush commits the reply: status and headers go out now
+        // and the rest of the document follows chunk-encoded behind them.
+        // Until this point nothing has been sent and the caller can still
+        // fall back to the regular path or send an error reply.
+        req.WriteHeader("Content-Type", "application/json");
+        req.StartChunkedReply(HTTP_OK);
+        fStreaming = true;
+    }
+    if (!buf.empty()) {
+        if (!fClientGone && !req.SendChunk(buf))
+            fClientGone = true; // keep producing cheaply into the void
+        buf.clear();
+    }
+}
+
+void JSONStreamWriter::MaybeComma()
+{
+    if (!vHasElement.empty()) {
+        if (vHasElement.back())
+            Put(",");
+        vHasElement.back() = true;
+    }
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    MaybeComma();
+    Put("{");
+    vHasElement.push_back(false);
+}
+
+void JSONStreamWriter::EndObject()
+{
+    vHasElement.pop_back();
+    Put("}");
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    MaybeComma();
+    Put("[");
+    vHasElement.push_back(false);
+}
+
+void JSONStreamWriter::EndArray()
+{
+    vHasElement.pop_back();
+    Put("]");
+}
+
+void JSONStreamWriter::WriteKey(const std::string& key)
+{
+    MaybeComma();
+    Put(UniValue(key).write());
+    Put(":");
+    // The value following the key must not emit another comma
+    if (!vHasElement.empty())
+        vHasElement.back() = false;
+}
+
+void JSONStreamWriter::WriteValue(const UniValue& val)
+{
+    MaybeComma();
+    Put(val.write());
+}
+
+void JSONStreamWriter::WriteRaw(const std::string& json)
+{
+    Put(json);
+}
+
+void JSONStreamWriter::Finish(int nStatus)
+{
+    if (fStreaming) {
+        // The status was already committed as HTTP_OK by the first flush
+        Flush();
+        req.EndChunkedReply();
+    } else {
+        // Small reply that never crossed the chunk threshold: send it in one
+        // piece, which keeps latency minimal on kept-alive connections
+        if (!buf.empty()) {
+            req.WriteBodyChunk(buf);
+            buf.clear();
+        }
+        req.WriteReply(nStatus);
+    }
+}
+
+bool StreamJSONRPCResult(HTTPRequest& req, const JSONRPCRequest& jreq)
+{
+    bool (*handler)(const JSONRPCRequest&, JSONStreamWriter&) = nullptr;
+    if (jreq.strMethod == "getblock")
+        handler = GetBlockStream;
+    else if (jreq.strMethod == "getrawtransaction")
+        handler = GetRawTransactionStream;
+    else if (jreq.strMethod == "getrawmempool")
+        handler = GetRawMempoolStream;
+    if (!handler)
+        return false;
+    // The regular path produces the proper error reply during warmup
+    if (RPCIsInWarmup(nullptr))
+        return false;
+
+    JSONStreamWriter writer(req);
+    // The JSON-RPC envelope only reaches the output buffer once the handler
+    // commits to streaming; until the first chunk flush nothing has been
+    // sent and the caller can still fall back or send an error reply
+    writer.WriteRaw("{\"result\":");
+    if (!(*handler)(jreq, writer)) {
+        if (!writer.Committed())
+            return false;
+        // Too late to fall back: part of the reply is already on the wire.
+        // Terminate the chunked stream; the client sees a truncated document.
+        LogPrintf("%s: %s handler failed mid-stream\n", __func__, jreq.strMethod);
+        writer.Finish(HTTP_OK);
+        return true;
+    }
+    writer.WriteRaw(",\"error\":null,\"id\":" + jreq.id.write() + "}\n");
+    writer.Finish(HTTP_OK);
+    return true;
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2017-2025 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_STREAM_H
+#define BITCOIN_RPC_STREAM_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+class HTTPRequest;
+class JSONRPCRequest;
+class UniValue;
+
+/**
+ * Incremental JSON writer that serializes straight onto the wire instead of
+ * building the full document as a UniValue tree first. Bytes are staged in a
+ * small string; once the staging buffer crosses the chunk threshold the
+ * reply is committed as a chunked transfer and every further chunk is handed
+ * to HTTPRequest::SendChunk, which blocks while the connection's output
+ * backlog is full. Peak memory therefore stays at one chunk plus the
+ * in-flight window no matter how large the reply grows, and the first byte
+ * reaches the client while the rest is still being produced. Replies that
+ * never cross the threshold are sent in one piece as before.
+ *
+ * The writer tracks container nesting and inserts commas itself; values are
+ * passed as (small) UniValues so quoting, escaping and number formatting stay
+ * byte-identical to the univalue serializer used everywhere else.
+ */
+class JSONStreamWriter
+{
+public:
+    explicit JSONStreamWriter(HTTPRequest& reqIn) : req(reqIn), fStreaming(false), fClientGone(false) {}
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    //! Write the key of the next value inside an object
+    void WriteKey(const std::string& key);
+    //! Write a value (or array element); serialized with UniValue::write()
+    void WriteValue(const UniValue& val);
+    //! Write pre-serialized JSON verbatim, with no comma handling
+    void WriteRaw(const std::string& json);
+    //! Flush remaining bytes and terminate the reply; no writes may follow.
+    //! nStatus only applies when the reply was never committed as a chunked
+    //! transfer; afterwards the status sent with the first chunk stands.
+    void Finish(int nStatus);
+    //! Whether the first chunk (status line included) is already on the wire
+    bool Committed() const { return fStreaming; }
+
+private:
+    void MaybeComma();
+    void Put(const std::string& s);
+    void Flush();
+
+    HTTPRequest& req;
+    std::string buf;
+    //! chunked transfer started; the reply can no longer change status
+    bool fStreaming;
+    //! SendChunk reported a disconnected client; further output is dropped
+    bool fClientGone;
+    //! One entry per open container: whether an element was already written
+    std::vector<bool> vHasElement;
+};
+
+/**
+ * Serve a single (non-batch) JSON-RPC request by streaming the reply, if the
+ * method has a streaming implementation and the parameters select it.
+ * Returns false (having sent nothing) when the request should take the
+ * regular UniValue path instead. Parameter errors are thrown as JSONRPCError
+ * like any other handler; streaming implementations validate and load
+ * everything before writing the first byte, so an error reply is still
+ * possible.
+ */
+bool StreamJSONRPCResult(HTTPRequest& req, const JSONRPCRequest& jreq);
+
+/** Streaming getblock (verbosity = 2 only); in rpc/blockchain.cpp */
+bool GetBlockStream(const JSONRPCRequest& request, JSONStreamWriter& writer);
+/** Streaming getrawtransaction; in rpc/rawtransaction.cpp */
+bool GetRawTransactionStream(const JSONRPCRequest& request, JSONStreamWriter& writer);
+/** Streaming getrawmempool (verbose = true only); in rpc/blockchain.cpp */
+bool GetRawMempoolStream(const JSONRPCRequest& request, JSONStreamWriter& writer);
+
+#endif // BITCOIN_RPC_STREAM_H
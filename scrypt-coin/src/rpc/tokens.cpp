@@ -957,6 +957,101 @@ UniValue listaddressesbytoken(const JSONRPCRequest &request)
     return result;
 }
 
+UniValue listtokenholders(const JSONRPCRequest &request)
+{
+    if (!fTokenIndex) {
+      return "_This rpc call is not functional unless -tokenindex is enabled "
+             "in scrypt.conf. If you haven't enabled it before, in the first "
+             "time you enable it, you need to enable -reindex-fast option as "
+             "well because scryptd need to build token index from the blk*.dat "
+             "files on disk";
+    }
+
+    if (request.fHelp || !AreTokensDeployed() || request.params.size() > 3 || request.params.size() < 1)
+        throw std::runtime_error(
+                "listtokenholders <token_name> [count] [cursor]\n"
+                + TokenActivationWarning() +
+                "\nReturns the addresses holding the given token, ordered from the largest balance downwards."
+                "\nPagination is cursor based: pass the next_cursor value of the previous page to continue."
+                "\nOnly one page is ever held in memory, however many holders the token has.\n"
+
+                "\nArguments:\n"
+                "1. \"token_name\"               (string, required) name of token\n"
+                "2. \"count\"                    (integer, optional, default=100, MAX=50000) page size\n"
+                "3. \"cursor\"                   (string, optional) next_cursor value from the previous page\n"
+
+                "\nResult:\n"
+                "{\n"
+                "  \"holders\": [\n"
+                "    {\n"
+                "      \"address\": (string) holder address,\n"
+                "      \"amount\": (numeric) balance held\n"
+                "    }, ...\n"
+                "  ],\n"
+                "  \"next_cursor\": (string) pass to the next call; omitted on the last page\n"
+                "}\n"
+
+                "\nExamples:\n"
+                + HelpExampleCli("listtokenholders", "\"TOKEN_NAME\"")
+                + HelpExampleCli("listtokenholders", "\"TOKEN_NAME\" 100")
+                + HelpExampleCli("listtokenholders", "\"TOKEN_NAME\" 100 \"12345:YAddress\"")
+        );
+
+    std::string token_name = capitalizeTokenName(request.params[0].get_str());
+
+    size_t count = 100;
+    if (request.params.size() > 1) {
+        if (request.params[1].get_int() < 1)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "count must be greater than 1.");
+        count = request.params[1].get_int();
+    }
+
+    bool fHaveCursor = false;
+    CAmount cursorAmount = 0;
+    std::string cursorAddress;
+    if (request.params.size() > 2 && !request.params[2].get_str().empty()) {
+        const std::string strCursor = request.params[2].get_str();
+        size_t sep = strCursor.find(':');
+        bool fValid = (sep != std::string::npos);
+        if (fValid) {
+            try {
+                cursorAmount = std::stoll(strCursor.substr(0, sep));
+            } catch (const std::exception&) {
+                fValid = false;
+            }
+        }
+        if (!fValid)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "cursor must be the next_cursor value of a previous page");
+        cursorAddress = strCursor.substr(sep + 1);
+        fHaveCursor = true;
+    }
+
+    if (!IsTokenNameValid(token_name))
+        return "_Not a valid token name";
+
+    std::vector<std::pair<std::string, CAmount> > vecAddressAmounts;
+    if (!ptokensdb->TokenHoldersByBalance(vecAddressAmounts, token_name, count, fHaveCursor, cursorAmount, cursorAddress))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "couldn't retrieve token holders.");
+
+    UniValue holders(UniValue::VARR);
+    for (auto& pair : vecAddressAmounts) {
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("address", pair.first));
+        entry.push_back(Pair("amount", TokenValueFromAmount(pair.second, token_name)));
+        holders.push_back(entry);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("holders", holders));
+    // A full page may have more behind it; hand back a resume point
+    if (vecAddressAmounts.size() == count) {
+        const std::pair<std::string, CAmount>& last = vecAddressAmounts.back();
+        result.push_back(Pair("next_cursor", strprintf("%d:%s", last.second, last.first)));
+    }
+
+    return result;
+}
+
 UniValue listtokenbalancesbyaddress(const JSONRPCRequest& request)
 {
     if (!fTokenIndex) {
@@ -1105,6 +1200,7 @@ static const CRPCCommand commands[] =
     { "tokens",   "listtokenbalancesbyaddress", &listtokenbalancesbyaddress, false,         {"address", "onlytotal", "count", "start"} },
     { "tokens",   "gettokendata",               &gettokendata,               true,          {"token_name"}},
     { "tokens",   "listaddressesbytoken",       &listaddressesbytoken,       false,         {"token_name", "onlytotal", "count", "start"}},
+    { "tokens",   "listtokenholders",           &listtokenholders,           false,         {"token_name", "count", "cursor"}},
 #ifdef ENABLE_WALLET
     { "tokens",   "transferfromaddress",        &transferfromaddress,        false,         {"token_name", "from_address", "qty", "to_address","yac_change_address", "token_change_address"}},
     { "tokens",   "transfer",                   &transfer,                   false,         {"token_name", "qty", "to_address", "change_address", "token_change_address"}},
@@ -15,6 +15,7 @@
 #include "uint256.h"
 #include "streams.h"
 #include "random.h"
+#include "crypto/common.h"
 
 typedef std::vector<unsigned char> valtype;
 
@@ -70,6 +71,192 @@ static inline void popstack(std::vector<valtype>& stack)
     stack.pop_back();
 }
 
+/**
+ * Execution stack with element-buffer pooling. Popped or erased elements
+ * are rotated past the logical end instead of destroyed, so a later push
+ * assigns into their existing heap buffers rather than allocating fresh
+ * ones. Combined with the per-thread instances in VerifyScript this
+ * removes the interpreter's per-element allocations from the block
+ * connect profile once each script-check thread has warmed up. The
+ * interface mirrors the std::vector operations EvalScript performs.
+ */
+class CScriptStack
+{
+private:
+    std::vector<valtype> vElems; //!< logical elements, then pooled spares
+    size_t nSize;                //!< logical stack depth
+
+public:
+    typedef std::vector<valtype>::iterator iterator;
+
+    CScriptStack() : nSize(0) {}
+
+    size_t size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+    iterator end() { return vElems.begin() + nSize; }
+
+    valtype& at(size_t n)
+    {
+        if (n >= nSize) // spares past the logical end must stay invisible
+            throw std::out_of_range("CScriptStack::at");
+        return vElems[n];
+    }
+
+    valtype& back() { return at(nSize - 1); }
+    const valtype& back() const { return const_cast<CScriptStack*>(this)->back(); }
+
+    void push_back(const valtype& vch)
+    {
+        if (nSize < vElems.size())
+            vElems[nSize].assign(vch.begin(), vch.end()); // reuse the spare's buffer
+        else
+            vElems.push_back(vch);
+        ++nSize;
+    }
+
+    void pop_back()
+    {
+        --nSize; // the element stays behind as a spare
+    }
+
+    void insert(iterator pos, const valtype& vch)
+    {
+        if (nSize < vElems.size()) {
+            // rotate a spare's storage into position instead of allocating
+            std::rotate(pos, vElems.begin() + nSize, vElems.begin() + nSize + 1);
+            pos->assign(vch.begin(), vch.end());
+        } else {
+            vElems.insert(pos, vch);
+        }
+        ++nSize;
+    }
+
+    void erase(iterator pos) { erase(pos, pos + 1); }
+
+    void erase(iterator first, iterator last)
+    {
+        // park the erased elements (and their buffers) in the spare region
+        std::rotate(first, last, vElems.begin() + nSize);
+        nSize -= (last - first);
+    }
+
+    void clear() { nSize = 0; }
+
+    //! Copy the logical contents of another stack, reusing our buffers
+    void assign(const CScriptStack& other)
+    {
+        if (other.nSize > vElems.size())
+            vElems.resize(other.nSize);
+        for (size_t i = 0; i < other.nSize; i++)
+            vElems[i].assign(other.vElems[i].begin(), other.vElems[i].end());
+        nSize = other.nSize;
+    }
+
+    void swap(CScriptStack& other)
+    {
+        vElems.swap(other.vElems);
+        std::swap(nSize, other.nSize);
+    }
+
+    //! Adopt/release a plain element vector for the std::vector-based
+    //! public EvalScript overload
+    void SetElements(std::vector<valtype>&& v)
+    {
+        vElems = std::move(v);
+        nSize = vElems.size();
+    }
+
+    std::vector<valtype> MoveElements()
+    {
+        vElems.resize(nSize); // drop the spares
+        nSize = 0;
+        return std::move(vElems);
+    }
+};
+
+static inline void popstack(CScriptStack& stack)
+{
+    if (stack.empty())
+        throw std::runtime_error("popstack(): stack empty");
+    stack.pop_back();
+}
+
+/**
+ * Nested OP_IF execution state without per-opcode scanning. The dispatch
+ * loop only ever asks "is every enclosing branch executing?", which is
+ * fully described by the nesting depth plus the position of the first
+ * false branch; toggles and pops below that position cannot change the
+ * answer. Replaces counting a vector<bool> once per opcode.
+ */
+class CConditionStack
+{
+private:
+    static const ::uint32_t NO_FALSE = (::uint32_t)-1;
+    ::uint32_t nStackSize;
+    ::uint32_t nFirstFalsePos;
+
+public:
+    CConditionStack() : nStackSize(0), nFirstFalsePos(NO_FALSE) {}
+
+    bool empty() const { return nStackSize == 0; }
+    bool all_true() const { return nFirstFalsePos == NO_FALSE; }
+
+    void push_back(bool f)
+    {
+        if (nFirstFalsePos == NO_FALSE && !f)
+            nFirstFalsePos = nStackSize;
+        ++nStackSize;
+    }
+
+    void pop_back()
+    {
+        if (nFirstFalsePos == nStackSize - 1)
+            nFirstFalsePos = NO_FALSE;
+        --nStackSize;
+    }
+
+    void toggle_top()
+    {
+        if (nFirstFalsePos == NO_FALSE)
+            nFirstFalsePos = nStackSize - 1;     // top was true, now false
+        else if (nFirstFalsePos == nStackSize - 1)
+            nFirstFalsePos = NO_FALSE;           // top was the only false
+        // otherwise some deeper branch is false; the top does not matter
+    }
+
+    void clear()
+    {
+        nStackSize = 0;
+        nFirstFalsePos = NO_FALSE;
+    }
+};
+
+//! Dense switch so the compiler emits a table lookup instead of the
+//! fifteen-way comparison chain this replaced in the dispatch loop
+static inline bool IsDisabledOpcode(opcodetype opcode)
+{
+    switch (opcode) {
+        case OP_CAT:
+        case OP_SUBSTR:
+        case OP_LEFT:
+        case OP_RIGHT:
+        case OP_INVERT:
+        case OP_AND:
+        case OP_OR:
+        case OP_XOR:
+        case OP_2MUL:
+        case OP_2DIV:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_MOD:
+        case OP_LSHIFT:
+        case OP_RSHIFT:
+            return true;
+        default:
+            return false;
+    }
+}
+
 bool static IsCompressedOrUncompressedPubKey(const valtype &vchPubKey) {
     if (vchPubKey.size() < 33) {
         //  Non-canonical public key: too short
@@ -236,7 +423,7 @@ bool static CheckMinimalPush(const valtype& data, opcodetype opcode) {
     return true;
 }
 
-bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+static bool EvalScript(CScriptStack& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
 {
     static const CScriptNum bnZero(0);
     static const CScriptNum bnOne(1);
@@ -250,9 +437,13 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
     CScript::const_iterator pend = script.end();
     CScript::const_iterator pbegincodehash = script.begin();
     opcodetype opcode;
-    valtype vchPushValue;
-    std::vector<bool> vfExec;
-    std::vector<valtype> altstack;
+    // Reused across executions on this thread (EvalScript never
+    // recurses), so their buffers stay warm instead of being
+    // reallocated per script
+    static thread_local valtype vchPushValue;
+    static thread_local CScriptStack altstack;
+    CConditionStack vfExec;
+    altstack.clear();
     set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
     if (script.size() > MAX_SCRIPT_SIZE)
         return set_error(serror, SCRIPT_ERR_SCRIPT_SIZE);
@@ -263,7 +454,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
     {
         while (pc < pend)
         {
-            bool fExec = !count(vfExec.begin(), vfExec.end(), false);
+            bool fExec = vfExec.all_true();
 
             //
             // Read instruction
@@ -277,21 +468,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
             if (opcode > OP_16 && ++nOpCount > MAX_OPS_PER_SCRIPT)
                 return set_error(serror, SCRIPT_ERR_OP_COUNT);
 
-            if (opcode == OP_CAT ||
-                opcode == OP_SUBSTR ||
-                opcode == OP_LEFT ||
-                opcode == OP_RIGHT ||
-                opcode == OP_INVERT ||
-                opcode == OP_AND ||
-                opcode == OP_OR ||
-                opcode == OP_XOR ||
-                opcode == OP_2MUL ||
-                opcode == OP_2DIV ||
-                opcode == OP_MUL ||
-                opcode == OP_DIV ||
-                opcode == OP_MOD ||
-                opcode == OP_LSHIFT ||
-                opcode == OP_RSHIFT)
+            if (IsDisabledOpcode(opcode))
                 return set_error(serror, SCRIPT_ERR_DISABLED_OPCODE); // Disabled opcodes.
 
             if (fExec && 0 <= opcode && opcode <= OP_PUSHDATA4) {
@@ -445,7 +622,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 {
                     if (vfExec.empty())
                         return set_error(serror, SCRIPT_ERR_UNBALANCED_CONDITIONAL);
-                    vfExec.back() = !vfExec.back();
+                    vfExec.toggle_top();
                 }
                 break;
 
@@ -1023,8 +1200,43 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
     return set_success(serror);
 }
 
+bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    // Plain-vector entry point for callers outside the hot verify path
+    // (signing, policy checks): run on a pooled stack and hand the
+    // elements back
+    CScriptStack stackInner;
+    stackInner.SetElements(std::move(stack));
+    bool fRet = EvalScript(stackInner, script, flags, checker, serror);
+    stack = stackInner.MoveElements();
+    return fRet;
+}
+
 namespace {
 
+/** Serialize the passed scriptCode, skipping OP_CODESEPARATORs */
+template<typename S>
+void SerializeScriptCode(S &s, const CScript& scriptCode) {
+    CScript::const_iterator it = scriptCode.begin();
+    CScript::const_iterator itBegin = it;
+    opcodetype opcode;
+    unsigned int nCodeSeparators = 0;
+    while (scriptCode.GetOp(it, opcode)) {
+        if (opcode == OP_CODESEPARATOR)
+            nCodeSeparators++;
+    }
+    ::WriteCompactSize(s, scriptCode.size() - nCodeSeparators);
+    it = itBegin;
+    while (scriptCode.GetOp(it, opcode)) {
+        if (opcode == OP_CODESEPARATOR) {
+            s.write((char*)&itBegin[0], it-itBegin-1);
+            itBegin = it;
+        }
+    }
+    if (itBegin != scriptCode.end())
+        s.write((char*)&itBegin[0], it-itBegin);
+}
+
 /**
  * Wrapper that serializes like CTransaction, but with the modifications
  *  required for the signature hash done in-place
@@ -1048,24 +1260,7 @@ public:
     /** Serialize the passed scriptCode, skipping OP_CODESEPARATORs */
     template<typename S>
     void SerializeScriptCode(S &s) const {
-        CScript::const_iterator it = scriptCode.begin();
-        CScript::const_iterator itBegin = it;
-        opcodetype opcode;
-        unsigned int nCodeSeparators = 0;
-        while (scriptCode.GetOp(it, opcode)) {
-            if (opcode == OP_CODESEPARATOR)
-                nCodeSeparators++;
-        }
-        ::WriteCompactSize(s, scriptCode.size() - nCodeSeparators);
-        it = itBegin;
-        while (scriptCode.GetOp(it, opcode)) {
-            if (opcode == OP_CODESEPARATOR) {
-                s.write((char*)&itBegin[0], it-itBegin-1);
-                itBegin = it;
-            }
-        }
-        if (itBegin != scriptCode.end())
-            s.write((char*)&itBegin[0], it-itBegin);
+        ::SerializeScriptCode(s, scriptCode);
     }
 
     /** Serialize an input of txTo */
@@ -1156,7 +1351,49 @@ uint256 GetOutputsHash(const CTransaction& txTo) {
 
 } // namespace
 
-uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType)
+PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
+{
+    // Serialize the transaction once the way the SIGHASH_ALL serializer does,
+    // with every scriptSig blanked, recording where each input's blanked
+    // script byte sits and a SHA256 midstate over everything before it
+    CDataStream ss(SER_GETHASH, 0);
+    vScriptOffset.reserve(txTo.vin.size());
+    ::Serialize(ss, txTo.nVersion);
+    // nTime is extended to 64-bit since yacoin 1.0.0
+    if (txTo.nVersion >= CTransaction::CURRENT_VERSION_of_Tx_for_yac_new) // 64-bit nTime
+    {
+        ::Serialize(ss, txTo.nTime);
+    }
+    else // 32-bit nTime
+    {
+        ::uint32_t time = (::uint32_t)txTo.nTime;
+        ::Serialize(ss, time);
+    }
+    ::WriteCompactSize(ss, txTo.vin.size());
+    for (unsigned int nInput = 0; nInput < txTo.vin.size(); nInput++) {
+        ::Serialize(ss, txTo.vin[nInput].prevout);
+        vScriptOffset.push_back(ss.size());
+        ::Serialize(ss, CScript());
+        ::Serialize(ss, txTo.vin[nInput].nSequence);
+    }
+    ::WriteCompactSize(ss, txTo.vout.size());
+    for (unsigned int nOutput = 0; nOutput < txTo.vout.size(); nOutput++)
+        ::Serialize(ss, txTo.vout[nOutput]);
+    ::Serialize(ss, txTo.nLockTime);
+    vchBlankedTx.assign(ss.begin(), ss.end());
+
+    // One running hash walked input by input; each snapshot is a plain copy
+    CSHA256 hasher;
+    size_t nDone = 0;
+    vPrefixMidstate.reserve(txTo.vin.size());
+    for (size_t nOffset : vScriptOffset) {
+        hasher.Write(&vchBlankedTx[nDone], nOffset - nDone);
+        nDone = nOffset;
+        vPrefixMidstate.push_back(hasher);
+    }
+}
+
+uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const PrecomputedTransactionData* cache)
 {
     static const uint256 one(uint256S("0000000000000000000000000000000000000000000000000000000000000001"));
     if (nIn >= txTo.vin.size()) {
@@ -1172,6 +1409,29 @@ uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsig
         }
     }
 
+    // The precomputed midstates only describe the SIGHASH_ALL shape; any base
+    // type other than SINGLE/NONE serializes identically to ALL
+    if (cache && !(nHashType & SIGHASH_ANYONECANPAY) &&
+        (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE &&
+        nIn < cache->vScriptOffset.size()) {
+        // Splice this input's scriptCode into the blanked skeleton: resume
+        // from the midstate before its script byte, then hash the scriptCode,
+        // the unchanged remainder of the skeleton and the hash type
+        CDataStream ssScript(SER_GETHASH, 0);
+        SerializeScriptCode(ssScript, scriptCode);
+        size_t nOffset = cache->vScriptOffset[nIn];
+        unsigned char type[4];
+        WriteLE32(type, nHashType);
+        uint256 sighash;
+        CSHA256 hasher = cache->vPrefixMidstate[nIn];
+        hasher.Write((const unsigned char*)&ssScript[0], ssScript.size())
+              .Write(&cache->vchBlankedTx[nOffset + 1], cache->vchBlankedTx.size() - nOffset - 1)
+              .Write(type, 4)
+              .Finalize(sighash.begin());
+        CSHA256().Write(sighash.begin(), CSHA256::OUTPUT_SIZE).Finalize(sighash.begin());
+        return sighash;
+    }
+
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer txTmp(txTo, scriptCode, nIn, nHashType);
 
@@ -1199,7 +1459,7 @@ bool TransactionSignatureChecker::CheckSig(const std::vector<unsigned char>& vch
     int nHashType = vchSig.back();
     vchSig.pop_back();
 
-    uint256 sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType);
+    uint256 sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType, txdata);
 
     if (!VerifySignature(vchSig, pubkey, sighash))
         return false;
@@ -1299,12 +1559,15 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, unsigne
         return set_error(serror, SCRIPT_ERR_SIG_PUSHONLY);
     }
 
-    std::vector<std::vector<unsigned char> > stack, stackCopy;
+    // Per-thread pooled stacks, reused across CScriptCheck executions;
+    // after warmup the whole verification runs without heap allocation
+    static thread_local CScriptStack stack, stackCopy;
+    stack.clear();
     if (!EvalScript(stack, scriptSig, flags, checker, serror))
         // serror is set
         return false;
     if (flags & SCRIPT_VERIFY_P2SH)
-        stackCopy = stack;
+        stackCopy.assign(stack);
     if (!EvalScript(stack, scriptPubKey, flags, checker, serror))
         // serror is set
         return false;
@@ -1321,7 +1584,7 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, unsigne
             return set_error(serror, SCRIPT_ERR_SIG_PUSHONLY);
 
         // Restore stack.
-        swap(stack, stackCopy);
+        stack.swap(stackCopy);
 
         // stack cannot be empty here, because if it was the
         // P2SH  HASH <> EQUAL  scriptPubKey would be evaluated with
@@ -9,6 +9,7 @@
 
 #include "script_error.h"
 #include "primitives/transaction.h"
+#include "crypto/sha256.h"
 
 #include <vector>
 #include <stdint.h>
@@ -95,7 +96,26 @@ enum
 
 bool CheckSignatureEncoding(const std::vector<unsigned char> &vchSig, unsigned int flags, ScriptError* serror);
 
-uint256 SignatureHash(const CScript &scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType);
+/**
+ * Per-transaction cache of signature hash data, shared by all of a
+ * transaction's script checks. The transaction is serialized once with every
+ * scriptSig blanked (the way the sighash algorithm serializes the inputs not
+ * being signed) and each input records the offset of its blanked script plus
+ * a SHA256 midstate over everything before it, so hashing input N splices in
+ * its scriptCode instead of reserializing the whole transaction. Only covers
+ * the common SIGHASH_ALL shape; SIGHASH_SINGLE/NONE/ANYONECANPAY take the
+ * full serializer path.
+ */
+struct PrecomputedTransactionData
+{
+    std::vector<unsigned char> vchBlankedTx; //!< tx serialized with all scriptSigs empty
+    std::vector<size_t> vScriptOffset;       //!< offset of each input's blanked script byte
+    std::vector<CSHA256> vPrefixMidstate;    //!< hash state over vchBlankedTx[0, vScriptOffset[n])
+
+    explicit PrecomputedTransactionData(const CTransaction& txTo);
+};
+
+uint256 SignatureHash(const CScript &scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const PrecomputedTransactionData* cache = nullptr);
 
 class BaseSignatureChecker
 {
@@ -123,12 +143,14 @@ class TransactionSignatureChecker : public BaseSignatureChecker
 private:
     const CTransaction* txTo;
     unsigned int nIn;
+    const PrecomputedTransactionData* txdata;
 
 protected:
     virtual bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
 
 public:
-    TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn) : txTo(txToIn), nIn(nInIn) {}
+    TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn) : txTo(txToIn), nIn(nInIn), txdata(nullptr) {}
+    TransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const PrecomputedTransactionData* txdataIn) : txTo(txToIn), nIn(nInIn), txdata(txdataIn) {}
     bool CheckSig(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode) const override;
     bool CheckLockTime(const CScriptNum& nLockTime) const override;
     bool CheckSequence(const CScriptNum& nSequence) const override;
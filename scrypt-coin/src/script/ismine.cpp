@@ -6,6 +6,7 @@
 
 #include "ismine.h"
 
+#include "hash.h"
 #include "key.h"
 #include "keystore.h"
 #include "script/script.h"
@@ -18,6 +19,28 @@ typedef std::vector<unsigned char> valtype;
 unsigned int HaveKeys(const std::vector<valtype>& pubkeys, const CKeyStore& keystore)
 {
     unsigned int nResult = 0;
+    if (pubkeys.size() >= 4) {
+        // Multisig scripts carry several keys; derive their IDs with the
+        // multi-buffer HASH160 instead of one digest at a time
+        std::vector<const unsigned char*> vpData;
+        std::vector<size_t> vnLens;
+        vpData.reserve(pubkeys.size());
+        vnLens.reserve(pubkeys.size());
+        for (const valtype& pubkey : pubkeys) {
+            vpData.push_back(pubkey.data());
+            vnLens.push_back(pubkey.size());
+        }
+        std::vector<unsigned char> vchHashes(pubkeys.size() * CRIPEMD160::OUTPUT_SIZE);
+        Hash160Batch(vpData.data(), vnLens.data(), pubkeys.size(), vchHashes.data());
+        for (size_t i = 0; i < pubkeys.size(); i++)
+        {
+            CKeyID keyID(uint160(std::vector<unsigned char>(vchHashes.begin() + i * CRIPEMD160::OUTPUT_SIZE,
+                                                            vchHashes.begin() + (i + 1) * CRIPEMD160::OUTPUT_SIZE)));
+            if (keystore.HaveKey(keyID))
+                ++nResult;
+        }
+        return nResult;
+    }
     for(const valtype& pubkey : pubkeys)
     {
         CKeyID keyID = CPubKey(pubkey).GetID();
@@ -27,6 +50,26 @@ unsigned int HaveKeys(const std::vector<valtype>& pubkeys, const CKeyStore& keys
     return nResult;
 }
 
+/** Script shapes whose IsMine answer is fully captured by the key store's
+ * precomputed scriptPubKey index: raw P2PK, P2PKH and P2SH. Everything else
+ * (bare multisig, CLTV/CSV wrappers, token scripts, nonstandard scripts)
+ * still has to go through the solver below. */
+static bool IsIndexableShape(const CScript& scriptPubKey)
+{
+    if (scriptPubKey.size() == 25) // P2PKH
+        return scriptPubKey[0] == OP_DUP && scriptPubKey[1] == OP_HASH160 &&
+               scriptPubKey[2] == 0x14 && scriptPubKey[23] == OP_EQUALVERIFY &&
+               scriptPubKey[24] == OP_CHECKSIG;
+    if (scriptPubKey.size() == 23) // P2SH
+        return scriptPubKey[0] == OP_HASH160 && scriptPubKey[1] == 0x14 &&
+               scriptPubKey[22] == OP_EQUAL;
+    if (scriptPubKey.size() == 35) // P2PK, compressed pubkey
+        return scriptPubKey[0] == 33 && scriptPubKey[34] == OP_CHECKSIG;
+    if (scriptPubKey.size() == 67) // P2PK, uncompressed pubkey
+        return scriptPubKey[0] == 65 && scriptPubKey[66] == OP_CHECKSIG;
+    return false;
+}
+
 isminetype IsMine(const CKeyStore &keystore, const CTxDestination& dest)
 {
     // build standard output script via GetScriptForDestination()
@@ -36,6 +79,12 @@ isminetype IsMine(const CKeyStore &keystore, const CTxDestination& dest)
 
 isminetype IsMine(const CKeyStore &keystore, const CScript& scriptPubKey)
 {
+    // With many keys the solver and the per-key map walks below dominate
+    // block connection; a script of a shape the index fully covers can be
+    // rejected with a single hash lookup instead.
+    if (IsIndexableShape(scriptPubKey) && !keystore.HaveIndexedScript(scriptPubKey))
+        return ISMINE_NO;
+
     std::vector<valtype> vSolutions;
     txnouttype whichType;
     if (!Solver(scriptPubKey, whichType, vSolutions)) {
@@ -6,15 +6,23 @@
 #include "sigcache.h"
 
 #include "memusage.h"
+#include "metrics.h"
 #include "pubkey.h"
 #include "random.h"
+#include "sync.h"
 #include "uint256.h"
 #include "util.h"
 
 #include "cuckoocache.h"
 #include <boost/thread.hpp>
 
+#include <deque>
+
 namespace {
+
+//! How many generations block-consumed entries are kept (set from
+//! -sigcachegenerations in InitSignatureCache)
+static unsigned int nSigCacheGenerations = DEFAULT_SIG_CACHE_GENERATIONS;
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
@@ -42,10 +50,50 @@ public:
     }
 
     bool
-    Get(const uint256& entry, const bool erase)
+    Get(const uint256& entry)
+    {
+        bool fHit;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+            fHit = setValid.contains(entry, false);
+        }
+        if (fHit)
+            g_metrics.nSigCacheHits.fetch_add(1, std::memory_order_relaxed);
+        else
+            g_metrics.nSigCacheMisses.fetch_add(1, std::memory_order_relaxed);
+        return fHit;
+    }
+
+    void DeferErase(const uint256& entry)
+    {
+        // Block validation used to erase its hits immediately; instead the
+        // entry is tagged with the current generation and stays available
+        // until BumpGeneration() expires it, so a reorg that reconnects
+        // recent blocks still hits the cache
+        LOCK(cs_deferred);
+        if (vDeferredErase.empty())
+            vDeferredErase.push_back(std::vector<uint256>());
+        vDeferredErase.back().push_back(entry);
+    }
+
+    void BumpGeneration(size_t nKeepGenerations)
     {
+        std::vector<uint256> vExpired;
+        {
+            LOCK(cs_deferred);
+            vDeferredErase.push_back(std::vector<uint256>());
+            while (vDeferredErase.size() > nKeepGenerations) {
+                vExpired.insert(vExpired.end(), vDeferredErase.front().begin(), vDeferredErase.front().end());
+                vDeferredErase.pop_front();
+            }
+        }
+        if (vExpired.empty())
+            return;
+        // allow_erase inside contains() is an atomic flag set, so a shared
+        // lock suffices and concurrent verification threads never stall here
         boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
-        return setValid.contains(entry, erase);
+        for (const uint256& entry : vExpired)
+            setValid.contains(entry, true);
     }
 
     void Set(uint256& entry)
@@ -57,6 +105,12 @@ public:
     {
         return setValid.setup_bytes(n);
     }
+
+private:
+    //! Entries consumed by block validation, one vector per generation
+    //! (front = oldest); protected by cs_deferred, never by cs_sigcache
+    CCriticalSection cs_deferred;
+    std::deque<std::vector<uint256> > vDeferredErase;
 };
 
 /* In previous versions of this code, signatureCache was a local static variable
@@ -78,14 +132,24 @@ void InitSignatureCache()
     size_t nElems = signatureCache.setup_bytes(nMaxCacheSize);
     LogPrintf("Using %zu MiB out of %zu/2 requested for signature cache, able to store %zu elements\n",
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
+    nSigCacheGenerations = (unsigned int)std::max((int64_t)1,
+            gArgs.GetArg("-sigcachegenerations", DEFAULT_SIG_CACHE_GENERATIONS));
+}
+
+void SignatureCacheBumpGeneration()
+{
+    signatureCache.BumpGeneration(nSigCacheGenerations);
 }
 
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
     signatureCache.ComputeEntry(entry, sighash, vchSig, pubkey);
-    if (signatureCache.Get(entry, !store))
+    if (signatureCache.Get(entry)) {
+        if (!store)
+            signatureCache.DeferErase(entry);
         return true;
+    }
     if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash))
         return false;
     if (store)
@@ -17,6 +17,10 @@
 static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 // Maximum sig cache size allowed
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+// How many connected-block generations a signature consumed by block
+// validation stays cached before it is batch-erased; keeping more than one
+// lets a reorg revalidate recent blocks without redoing ECDSA
+static const unsigned int DEFAULT_SIG_CACHE_GENERATIONS = 2;
 
 class CPubKey;
 
@@ -48,10 +52,16 @@ private:
 
 public:
     CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, bool storeIn) : TransactionSignatureChecker(txToIn, nInIn), store(storeIn) {}
+    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, bool storeIn, const PrecomputedTransactionData* txdataIn) : TransactionSignatureChecker(txToIn, nInIn, txdataIn), store(storeIn) {}
 
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
 };
 
 void InitSignatureCache();
 
+// Advance the signature cache generation (called when a block connects).
+// Entries consumed by block validation more than -sigcachegenerations
+// generations ago are batch-erased here, off the verification hot path.
+void SignatureCacheBumpGeneration();
+
 #endif // YACOIN_SCRIPT_SIGCACHE_H
@@ -5,7 +5,9 @@
 
 #include "script/standard.h"
 
+#include "crypto/siphash.h"
 #include "pubkey.h"
+#include "random.h"
 #include "script/script.h"
 #include "script/sign.h"
 #include "util.h"
@@ -13,7 +15,10 @@
 #include "tokens/tokens.h"
 #include "keystore.h"
 
+#include <boost/thread.hpp>
+
 #include <map>
+#include <unordered_map>
 
 CScriptID::CScriptID(const CScript& in) : uint160(Hash160(in.begin(), in.end())) {}
 
@@ -40,10 +45,87 @@ const char* GetTxnOutputType(txnouttype t)
     return NULL;
 }
 
+namespace {
+
 /**
- * Return public keys or hashes from scriptPubKey, for 'standard' transaction types.
+ * Memoized Solver results. The same scriptPubKey is classified over and over
+ * — validation, wallet matching, token detection — and each classification is
+ * a byte-by-byte template scan, so the outcome (template type plus extracted
+ * solutions) is cached keyed by the script bytes. Keys are hashed with a
+ * random salt so attacker-chosen scripts cannot degrade the table, and
+ * equality compares the full script, so a hash collision can never return the
+ * wrong classification.
  */
-bool Solver(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::vector<unsigned char> >& vSolutionsRet)
+class CScriptSolverCache
+{
+private:
+    struct CSolverResult {
+        bool fSolved;
+        txnouttype type;
+        std::vector<std::vector<unsigned char> > vSolutions;
+    };
+
+    class CScriptHasher
+    {
+    private:
+        //! Salt
+        const uint64_t k0, k1;
+
+    public:
+        CScriptHasher()
+         : k0(GetRand(std::numeric_limits<uint64_t>::max())),
+           k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+        size_t operator()(const CScript& script) const {
+            return CSipHasher(k0, k1).Write(script.data(), script.size()).Finalize();
+        }
+    };
+
+    std::unordered_map<CScript, CSolverResult, CScriptHasher> map;
+    boost::shared_mutex cs_solverCache;
+
+    //! Entry cap; standard scriptPubKeys are ~25-200 bytes, so this bounds
+    //! the cache to a few megabytes
+    static const size_t MAX_ENTRIES = 50000;
+
+public:
+    CScriptSolverCache()
+    {
+        map.reserve(MAX_ENTRIES);
+    }
+
+    bool Get(const CScript& script, bool& fSolvedRet, txnouttype& typeRet, std::vector<std::vector<unsigned char> >& vSolutionsRet)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_solverCache);
+        auto it = map.find(script);
+        if (it == map.end())
+            return false;
+        fSolvedRet = it->second.fSolved;
+        typeRet = it->second.type;
+        vSolutionsRet = it->second.vSolutions;
+        return true;
+    }
+
+    void Set(const CScript& script, bool fSolved, txnouttype type, const std::vector<std::vector<unsigned char> >& vSolutions)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_solverCache);
+        if (map.size() >= MAX_ENTRIES) {
+            // Wholesale dump is rare at this size and far simpler than an
+            // eviction order; the hot working set repopulates immediately
+            map.clear();
+        }
+        map.emplace(script, CSolverResult{fSolved, type, vSolutions});
+    }
+};
+
+//! Scripts longer than this are not worth caching: they are nonstandard or
+//! data carriers and would dominate the cache's memory for no hit rate
+static const size_t MAX_SOLVER_CACHE_SCRIPT_SIZE = 512;
+
+/**
+ * The uncached template scan behind Solver().
+ */
+bool SolverUncached(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::vector<unsigned char> >& vSolutionsRet)
 {
     // Templates
     static std::map<txnouttype, CScript> mTemplates;
@@ -193,6 +275,27 @@ bool Solver(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::v
     return false;
 }
 
+} // namespace
+
+/**
+ * Return public keys or hashes from scriptPubKey, for 'standard' transaction types.
+ */
+bool Solver(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::vector<unsigned char> >& vSolutionsRet)
+{
+    // Function-local so the salt is drawn after the randomizer is initialized
+    static CScriptSolverCache solverCache;
+
+    bool fSolved;
+    if (scriptPubKey.size() <= MAX_SOLVER_CACHE_SCRIPT_SIZE) {
+        if (solverCache.Get(scriptPubKey, fSolved, typeRet, vSolutionsRet))
+            return fSolved;
+        fSolved = SolverUncached(scriptPubKey, typeRet, vSolutionsRet);
+        solverCache.Set(scriptPubKey, fSolved, typeRet, vSolutionsRet);
+        return fSolved;
+    }
+    return SolverUncached(scriptPubKey, typeRet, vSolutionsRet);
+}
+
 bool ExtractDestination(const CScript& scriptPubKey, CTxDestination& addressRet)
 {
     std::vector<valtype> vSolutions;
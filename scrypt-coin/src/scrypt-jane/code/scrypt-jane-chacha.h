@@ -15,8 +15,17 @@ typedef uint32_t scrypt_mix_word_t;
 #include "scrypt-jane-mix_chacha-avx.h"
 #include "scrypt-jane-mix_chacha-ssse3.h"
 #include "scrypt-jane-mix_chacha-sse2.h"
+#include "scrypt-jane-mix_chacha-neon.h"
 #include "scrypt-jane-mix_chacha.h"
 
+#if defined(SCRYPT_CHACHA_NEON)
+	#define SCRYPT_CHUNKMIX_FN scrypt_ChunkMix_neon
+	#define SCRYPT_ROMIX_FN scrypt_ROMix_neon
+	#define SCRYPT_ROMIX_TANGLE_FN scrypt_romix_nop
+	#define SCRYPT_ROMIX_UNTANGLE_FN scrypt_romix_nop
+	#include "scrypt-jane-romix-template.h"
+#endif
+
 #if defined(SCRYPT_CHACHA_XOP)
 	#define SCRYPT_CHUNKMIX_FN scrypt_ChunkMix_xop
 	#define SCRYPT_ROMIX_FN scrypt_ROMix_xop
@@ -63,6 +72,10 @@ typedef uint32_t scrypt_mix_word_t;
 #if !defined(SCRYPT_CHOOSE_COMPILETIME)
 static scrypt_ROMixfn
 scrypt_getROMix(void) {
+#if defined(SCRYPT_CHACHA_NEON)
+	/* Advanced SIMD is baseline on every AArch64 core, nothing to probe */
+	return scrypt_ROMix_neon;
+#else
 	size_t cpuflags = detect_cpu();
 
 #if defined(SCRYPT_CHACHA_XOP)
@@ -90,6 +103,7 @@ scrypt_getROMix(void) {
 #endif
 
 	return scrypt_ROMix_basic;
+#endif
 }
 #endif
 
@@ -132,10 +146,14 @@ scrypt_test_mix(void) {
 
 	int ret = 1;
 	// Commented out here because scrypt-jane-portable-x86.h isn't included when using Clang with osxcross, as they don't properly support inline assembly
-#if !defined(__clang__)
+#if !defined(__clang__) && (defined(CPU_X86) || defined(CPU_X86_64))
 	size_t cpuflags = detect_cpu();
 #endif
 
+#if defined(SCRYPT_CHACHA_NEON)
+	ret &= scrypt_test_mix_instance(scrypt_ChunkMix_neon, scrypt_romix_nop, scrypt_romix_nop, expected);
+#endif
+
 #if defined(SCRYPT_CHACHA_XOP)
 	if (cpuflags & cpu_xop)
 		ret &= scrypt_test_mix_instance(scrypt_ChunkMix_xop, scrypt_romix_nop, scrypt_romix_nop, expected);
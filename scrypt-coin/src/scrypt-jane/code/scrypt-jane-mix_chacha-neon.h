@@ -0,0 +1,113 @@
+/* arm neon */
+#if defined(ARM_NEON) && (!defined(SCRYPT_CHOOSE_COMPILETIME) || !defined(SCRYPT_CHACHA_INCLUDED))
+
+#define SCRYPT_CHACHA_NEON
+
+#include <arm_neon.h>
+
+/* compilers fuse the shift pair into a single rotate where the ISA has one */
+#define chacha_neon_rotl32(x, n) vorrq_u32(vshlq_n_u32(x, n), vshrq_n_u32(x, 32 - (n)))
+/* rotate by 16 = swap the 16 bit halves of every word */
+#define chacha_neon_rotl16(x) vreinterpretq_u32_u16(vrev32q_u16(vreinterpretq_u16_u32(x)))
+
+static void NOINLINE asm_calling_convention
+scrypt_ChunkMix_neon(uint32_t *Bout/*[chunkBytes]*/, uint32_t *Bin/*[chunkBytes]*/, uint32_t *Bxor/*[chunkBytes]*/, uint32_t r) {
+	uint32_t i, blocksPerChunk = r * 2, half = 0;
+	uint32_t *p;
+	uint32x4_t x0,x1,x2,x3,t0,t1,t2,t3;
+	size_t rounds;
+
+	/* 1: X = B_{2r - 1} */
+	p = scrypt_block(Bin, blocksPerChunk - 1);
+	x0 = vld1q_u32(p +  0);
+	x1 = vld1q_u32(p +  4);
+	x2 = vld1q_u32(p +  8);
+	x3 = vld1q_u32(p + 12);
+
+	if (Bxor) {
+		p = scrypt_block(Bxor, blocksPerChunk - 1);
+		x0 = veorq_u32(x0, vld1q_u32(p +  0));
+		x1 = veorq_u32(x1, vld1q_u32(p +  4));
+		x2 = veorq_u32(x2, vld1q_u32(p +  8));
+		x3 = veorq_u32(x3, vld1q_u32(p + 12));
+	}
+
+	/* 2: for i = 0 to 2r - 1 do */
+	for (i = 0; i < blocksPerChunk; i++, half ^= r) {
+		/* 3: X = H(X ^ B_i) */
+		p = scrypt_block(Bin, i);
+		x0 = veorq_u32(x0, vld1q_u32(p +  0));
+		x1 = veorq_u32(x1, vld1q_u32(p +  4));
+		x2 = veorq_u32(x2, vld1q_u32(p +  8));
+		x3 = veorq_u32(x3, vld1q_u32(p + 12));
+
+		if (Bxor) {
+			p = scrypt_block(Bxor, i);
+			x0 = veorq_u32(x0, vld1q_u32(p +  0));
+			x1 = veorq_u32(x1, vld1q_u32(p +  4));
+			x2 = veorq_u32(x2, vld1q_u32(p +  8));
+			x3 = veorq_u32(x3, vld1q_u32(p + 12));
+		}
+
+		t0 = x0;
+		t1 = x1;
+		t2 = x2;
+		t3 = x3;
+
+		for (rounds = 8; rounds; rounds -= 2) {
+			x0 = vaddq_u32(x0, x1);
+			x3 = veorq_u32(x3, x0);
+			x3 = chacha_neon_rotl16(x3);
+			x2 = vaddq_u32(x2, x3);
+			x1 = veorq_u32(x1, x2);
+			x1 = chacha_neon_rotl32(x1, 12);
+			x0 = vaddq_u32(x0, x1);
+			x3 = veorq_u32(x3, x0);
+			x3 = chacha_neon_rotl32(x3, 8);
+			x0 = vextq_u32(x0, x0, 3);
+			x2 = vaddq_u32(x2, x3);
+			x3 = vextq_u32(x3, x3, 2);
+			x1 = veorq_u32(x1, x2);
+			x2 = vextq_u32(x2, x2, 1);
+			x1 = chacha_neon_rotl32(x1, 7);
+			x0 = vaddq_u32(x0, x1);
+			x3 = veorq_u32(x3, x0);
+			x3 = chacha_neon_rotl16(x3);
+			x2 = vaddq_u32(x2, x3);
+			x1 = veorq_u32(x1, x2);
+			x1 = chacha_neon_rotl32(x1, 12);
+			x0 = vaddq_u32(x0, x1);
+			x3 = veorq_u32(x3, x0);
+			x3 = chacha_neon_rotl32(x3, 8);
+			x0 = vextq_u32(x0, x0, 1);
+			x2 = vaddq_u32(x2, x3);
+			x3 = vextq_u32(x3, x3, 2);
+			x1 = veorq_u32(x1, x2);
+			x2 = vextq_u32(x2, x2, 3);
+			x1 = chacha_neon_rotl32(x1, 7);
+		}
+
+		x0 = vaddq_u32(x0, t0);
+		x1 = vaddq_u32(x1, t1);
+		x2 = vaddq_u32(x2, t2);
+		x3 = vaddq_u32(x3, t3);
+
+		/* 4: Y_i = X */
+		/* 6: B'[0..r-1] = Y_even */
+		/* 6: B'[r..2r-1] = Y_odd */
+		p = scrypt_block(Bout, (i / 2) + half);
+		vst1q_u32(p +  0, x0);
+		vst1q_u32(p +  4, x1);
+		vst1q_u32(p +  8, x2);
+		vst1q_u32(p + 12, x3);
+	}
+}
+
+#endif
+
+#if defined(SCRYPT_CHACHA_NEON)
+	#undef SCRYPT_MIX
+	#define SCRYPT_MIX "ChaCha/8-NEON"
+	#undef SCRYPT_CHACHA_INCLUDED
+	#define SCRYPT_CHACHA_INCLUDED
+#endif
@@ -0,0 +1,118 @@
+/* arm neon */
+#if defined(ARM_NEON) && (!defined(SCRYPT_CHOOSE_COMPILETIME) || !defined(SCRYPT_SALSA_INCLUDED))
+
+#define SCRYPT_SALSA_NEON
+
+#include <arm_neon.h>
+
+/* compilers fuse the shift pair into a single rotate where the ISA has one */
+#define salsa_neon_rotl32(x, n) vorrq_u32(vshlq_n_u32(x, n), vshrq_n_u32(x, 32 - (n)))
+
+static void NOINLINE asm_calling_convention
+scrypt_ChunkMix_neon(uint32_t *Bout/*[chunkBytes]*/, uint32_t *Bin/*[chunkBytes]*/, uint32_t *Bxor/*[chunkBytes]*/, uint32_t r) {
+	uint32_t i, blocksPerChunk = r * 2, half = 0;
+	uint32_t *p;
+	uint32x4_t x0,x1,x2,x3,x4,t0,t1,t2,t3;
+	size_t rounds;
+
+	/* 1: X = B_{2r - 1} */
+	p = scrypt_block(Bin, blocksPerChunk - 1);
+	x0 = vld1q_u32(p +  0);
+	x1 = vld1q_u32(p +  4);
+	x2 = vld1q_u32(p +  8);
+	x3 = vld1q_u32(p + 12);
+
+	if (Bxor) {
+		p = scrypt_block(Bxor, blocksPerChunk - 1);
+		x0 = veorq_u32(x0, vld1q_u32(p +  0));
+		x1 = veorq_u32(x1, vld1q_u32(p +  4));
+		x2 = veorq_u32(x2, vld1q_u32(p +  8));
+		x3 = veorq_u32(x3, vld1q_u32(p + 12));
+	}
+
+	/* 2: for i = 0 to 2r - 1 do */
+	for (i = 0; i < blocksPerChunk; i++, half ^= r) {
+		/* 3: X = H(X ^ B_i) */
+		p = scrypt_block(Bin, i);
+		x0 = veorq_u32(x0, vld1q_u32(p +  0));
+		x1 = veorq_u32(x1, vld1q_u32(p +  4));
+		x2 = veorq_u32(x2, vld1q_u32(p +  8));
+		x3 = veorq_u32(x3, vld1q_u32(p + 12));
+
+		if (Bxor) {
+			p = scrypt_block(Bxor, i);
+			x0 = veorq_u32(x0, vld1q_u32(p +  0));
+			x1 = veorq_u32(x1, vld1q_u32(p +  4));
+			x2 = veorq_u32(x2, vld1q_u32(p +  8));
+			x3 = veorq_u32(x3, vld1q_u32(p + 12));
+		}
+
+		t0 = x0;
+		t1 = x1;
+		t2 = x2;
+		t3 = x3;
+
+		for (rounds = 8; rounds; rounds -= 2) {
+			x4 = vaddq_u32(x1, x0);
+			x3 = veorq_u32(x3, salsa_neon_rotl32(x4, 7));
+			x4 = vaddq_u32(x0, x3);
+			x2 = veorq_u32(x2, salsa_neon_rotl32(x4, 9));
+			x4 = vaddq_u32(x3, x2);
+			x3 = vextq_u32(x3, x3, 3);
+			x1 = veorq_u32(x1, salsa_neon_rotl32(x4, 13));
+			x4 = vaddq_u32(x2, x1);
+			x2 = vextq_u32(x2, x2, 2);
+			x0 = veorq_u32(x0, salsa_neon_rotl32(x4, 18));
+			x1 = vextq_u32(x1, x1, 1);
+			x4 = vaddq_u32(x3, x0);
+			x1 = veorq_u32(x1, salsa_neon_rotl32(x4, 7));
+			x4 = vaddq_u32(x0, x1);
+			x2 = veorq_u32(x2, salsa_neon_rotl32(x4, 9));
+			x4 = vaddq_u32(x1, x2);
+			x1 = vextq_u32(x1, x1, 3);
+			x3 = veorq_u32(x3, salsa_neon_rotl32(x4, 13));
+			x4 = vaddq_u32(x2, x3);
+			x2 = vextq_u32(x2, x2, 2);
+			x0 = veorq_u32(x0, salsa_neon_rotl32(x4, 18));
+			x3 = vextq_u32(x3, x3, 1);
+		}
+
+		x0 = vaddq_u32(x0, t0);
+		x1 = vaddq_u32(x1, t1);
+		x2 = vaddq_u32(x2, t2);
+		x3 = vaddq_u32(x3, t3);
+
+		/* 4: Y_i = X */
+		/* 6: B'[0..r-1] = Y_even */
+		/* 6: B'[r..2r-1] = Y_odd */
+		p = scrypt_block(Bout, (i / 2) + half);
+		vst1q_u32(p +  0, x0);
+		vst1q_u32(p +  4, x1);
+		vst1q_u32(p +  8, x2);
+		vst1q_u32(p + 12, x3);
+	}
+}
+
+#endif
+
+#if defined(SCRYPT_SALSA_NEON)
+	#undef SCRYPT_MIX
+	#define SCRYPT_MIX "Salsa/8-NEON"
+	#undef SCRYPT_SALSA_INCLUDED
+	#define SCRYPT_SALSA_INCLUDED
+
+	/* same diagonal layout the SSE2 path uses, see scrypt-jane-mix_salsa-sse2.h */
+	static void asm_calling_convention
+	salsa_core_tangle_neon(uint32_t *blocks, size_t count) {
+		uint32_t t;
+		while (count--) {
+			t = blocks[1]; blocks[1] = blocks[5]; blocks[5] = t;
+			t = blocks[2]; blocks[2] = blocks[10]; blocks[10] = t;
+			t = blocks[3]; blocks[3] = blocks[15]; blocks[15] = t;
+			t = blocks[4]; blocks[4] = blocks[12]; blocks[12] = t;
+			t = blocks[7]; blocks[7] = blocks[11]; blocks[11] = t;
+			t = blocks[9]; blocks[9] = blocks[13]; blocks[13] = t;
+			blocks += 16;
+		}
+	}
+#endif
@@ -169,6 +169,20 @@
 	#define CPU_IA64
 #endif
 
+#if defined(__aarch64__) || defined(_M_ARM64)
+	#define CPU_AARCH64
+#elif defined(__arm__) || defined(_M_ARM)
+	#define CPU_ARM
+#endif
+
+/* Advanced SIMD is mandatory on AArch64; on 32-bit ARM trust the compiler's
+   NEON flag. The vector paths load words straight from memory, so they are
+   little-endian only. */
+#if (defined(CPU_AARCH64) && (defined(__AARCH64EL__) || defined(_M_ARM64))) || \
+	(defined(CPU_ARM) && (defined(__ARM_NEON__) || defined(__ARM_NEON)) && defined(__ARMEL__))
+	#define ARM_NEON
+#endif
+
 #if defined(__sparc__) || defined(__sparc) || defined(__sparcv9)
 	#define CPU_SPARC
 	#if defined(__sparcv9)
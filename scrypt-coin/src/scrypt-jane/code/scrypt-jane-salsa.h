@@ -14,8 +14,17 @@ typedef uint32_t scrypt_mix_word_t;
 #include "scrypt-jane-mix_salsa-xop.h"
 #include "scrypt-jane-mix_salsa-avx.h"
 #include "scrypt-jane-mix_salsa-sse2.h"
+#include "scrypt-jane-mix_salsa-neon.h"
 #include "scrypt-jane-mix_salsa.h"
 
+#if defined(SCRYPT_SALSA_NEON)
+	#define SCRYPT_CHUNKMIX_FN scrypt_ChunkMix_neon
+	#define SCRYPT_ROMIX_FN scrypt_ROMix_neon
+	#define SCRYPT_ROMIX_TANGLE_FN salsa_core_tangle_neon
+	#define SCRYPT_ROMIX_UNTANGLE_FN salsa_core_tangle_neon
+	#include "scrypt-jane-romix-template.h"
+#endif
+
 #if defined(SCRYPT_SALSA_XOP)
 	#define SCRYPT_CHUNKMIX_FN scrypt_ChunkMix_xop
 	#define SCRYPT_ROMIX_FN scrypt_ROMix_xop
@@ -51,6 +60,10 @@ typedef uint32_t scrypt_mix_word_t;
 #if !defined(SCRYPT_CHOOSE_COMPILETIME)
 static scrypt_ROMixfn
 scrypt_getROMix(void) {
+#if defined(SCRYPT_SALSA_NEON)
+	/* Advanced SIMD is baseline on every AArch64 core, nothing to probe */
+	return scrypt_ROMix_neon;
+#else
 	size_t cpuflags = detect_cpu();
 
 #if defined(SCRYPT_SALSA_XOP)
@@ -72,6 +85,7 @@ scrypt_getROMix(void) {
 #endif
 
 	return scrypt_ROMix_basic;
+#endif
 }
 #endif
 
@@ -109,7 +123,13 @@ scrypt_test_mix(void) {
 	};
 
 	int ret = 1;
+#if defined(CPU_X86) || defined(CPU_X86_64)
 	size_t cpuflags = detect_cpu();
+#endif
+
+#if defined(SCRYPT_SALSA_NEON)
+	ret &= scrypt_test_mix_instance(scrypt_ChunkMix_neon, salsa_core_tangle_neon, salsa_core_tangle_neon, expected);
+#endif
 
 #if defined(SCRYPT_SALSA_XOP)
 	if (cpuflags & cpu_xop)
@@ -0,0 +1,17 @@
+/*
+	BLAKE-512/ChaCha configuration of scrypt-jane.
+
+	The build pins SCRYPT_KECCAK512/SCRYPT_CHACHA on the command line for
+	the production configuration; this translation unit swaps the hash,
+	renames the public entry points and re-includes the reference
+	implementation, so the variant is still fully compile-time
+	specialized (SCRYPT_CHOOSE_COMPILETIME) down to the SIMD mix.
+*/
+#undef SCRYPT_KECCAK512
+#undef SCRYPT_KECCAK256
+#define SCRYPT_BLAKE512
+
+#define scrypt scrypt_blake512_chacha
+#define scrypt_set_fatal_error scrypt_set_fatal_error_blake512_chacha
+
+#include "scrypt-jane.c"
@@ -0,0 +1,64 @@
+/*
+	Dispatch table over the per-configuration scrypt-jane translation
+	units. See scrypt-jane-variants.h for the layout.
+*/
+#include "scrypt-jane-variants.h"
+
+/* entry points of the variant translation units; the production
+   keccak512/chacha configuration keeps the unprefixed scrypt() name */
+extern int
+    scrypt_skein512_chacha(
+           const unsigned char *password, size_t password_len,
+           const unsigned char *salt, size_t salt_len,
+           unsigned char Nfactor, unsigned char rfactor, unsigned char pfactor,
+           unsigned char *out, size_t bytes
+          );
+extern int
+    scrypt_blake512_chacha(
+           const unsigned char *password, size_t password_len,
+           const unsigned char *salt, size_t salt_len,
+           unsigned char Nfactor, unsigned char rfactor, unsigned char pfactor,
+           unsigned char *out, size_t bytes
+          );
+
+typedef int (*scrypt_jane_fn)(
+           const unsigned char *password, size_t password_len,
+           const unsigned char *salt, size_t salt_len,
+           unsigned char Nfactor, unsigned char rfactor, unsigned char pfactor,
+           unsigned char *out, size_t bytes
+          );
+
+static const struct {
+	scrypt_jane_fn fn;
+	const char *name;
+} variant_table[SCRYPT_JANE_VARIANT_COUNT] = {
+	{ scrypt,                 "keccak512/chacha" },
+	{ scrypt_skein512_chacha, "skein512/chacha"  },
+	{ scrypt_blake512_chacha, "blake512/chacha"  },
+};
+
+const char *scrypt_variant_name(scrypt_jane_variant variant)
+{
+	if ((unsigned int)variant >= SCRYPT_JANE_VARIANT_COUNT)
+		return NULL;
+	return variant_table[variant].name;
+}
+
+int scrypt_variant(
+           scrypt_jane_variant variant,
+           const unsigned char *password,
+           size_t password_len,
+           const unsigned char *salt,
+           size_t salt_len,
+           unsigned char Nfactor,
+           unsigned char rfactor,
+           unsigned char pfactor,
+           unsigned char *out,
+           size_t bytes
+          )
+{
+	if ((unsigned int)variant >= SCRYPT_JANE_VARIANT_COUNT)
+		return 0;
+	return variant_table[variant].fn(password, password_len, salt, salt_len,
+	                                 Nfactor, rfactor, pfactor, out, bytes);
+}
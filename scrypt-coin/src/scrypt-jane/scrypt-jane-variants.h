@@ -0,0 +1,44 @@
+#ifndef SCRYPT_JANE_VARIANTS_H
+#define SCRYPT_JANE_VARIANTS_H
+
+/*
+	Runtime-selectable scrypt-jane configurations.
+
+	The reference code pins one hash/mix pair per binary through
+	preprocessor defines. For research testnets that trial alternative
+	parameter sets, the full scrypt-jane translation unit is compiled
+	once per configuration (each variant source renames the entry point
+	and re-includes scrypt-jane.c, so every variant keeps its own
+	compile-time specialized SIMD mix) and selected through the
+	dispatch table in scrypt-jane-variants.c.
+*/
+
+#include "scrypt-jane.h"
+
+typedef enum scrypt_jane_variant_t {
+	SCRYPT_JANE_KECCAK512_CHACHA = 0, /* production configuration */
+	SCRYPT_JANE_SKEIN512_CHACHA  = 1,
+	SCRYPT_JANE_BLAKE512_CHACHA  = 2,
+	SCRYPT_JANE_VARIANT_COUNT    = 3
+} scrypt_jane_variant;
+
+/* "hash/mix" label for logs and RPC output, or NULL if out of range */
+const char *scrypt_variant_name(scrypt_jane_variant variant);
+
+/* Same contract as scrypt(), routed to the requested configuration.
+   Returns 0 (failure) for an out-of-range variant. */
+extern int
+    scrypt_variant(
+           scrypt_jane_variant variant,
+           const unsigned char *password,
+           size_t password_len,
+           const unsigned char *salt,
+           size_t salt_len,
+           unsigned char Nfactor,
+           unsigned char rfactor,
+           unsigned char pfactor,
+           unsigned char *out,
+           size_t bytes
+          );
+
+#endif /* SCRYPT_JANE_VARIANTS_H */
@@ -43,8 +43,13 @@ extern "C" {
 #include "random_nonce.h"
 #include "validation.h"
 #include "main.h"
+#include "net_processing.h"
 #include "primitives/block.h"
 
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
 #define SCRYPT_BUFFER_SIZE (131072 + 63)
 //                          (1<<17) + ((1<<6) -1) representing what, exactly??????
 
@@ -138,6 +143,78 @@ bool scrypt_hash(
     return false;
 }
 
+static void scrypt_hash_batch_worker(
+                                     const void* const *inputs,
+                                     size_t inputlen,
+                                     ::uint32_t *res,
+                                     size_t n,
+                                     size_t nStart,
+                                     size_t nStride,
+                                     unsigned char Nfactor,
+                                     boost::atomic<bool> *pfAllOk
+                                    )
+{
+    for (size_t i = nStart; i < n; i += nStride)
+    {
+        if(
+           0 != scrypt(
+                       (const unsigned char *)inputs[i],
+                       inputlen,
+                       (const unsigned char *)inputs[i],
+                       inputlen,
+                       Nfactor,
+                       0,
+                       0,
+                       (unsigned char*)(res + 8 * i),
+                       32
+                      )
+          )
+            continue;
+        pfAllOk->store(false);
+    }
+}
+
+//YACOIN
+// Each scrypt() call walks its own ROMix scratchpad (the mix code is already
+// SIMD per instance), so the win here comes from keeping every hash
+// calculation thread busy on one memory walk apiece instead of hashing the
+// batch serially.
+bool scrypt_hash_batch(
+                       const void* const inputs[],
+                       size_t inputlen,
+                       ::uint32_t *res,
+                       size_t n,
+                       unsigned char Nfactor
+                      )
+{
+    if (n == 0)
+        return true;
+
+    MeasureTime scryptHash;
+    boost::atomic<bool>
+        fAllOk(true);
+    size_t
+        nThreads = std::min(n, (size_t)std::max(1, nHashCalcThreads));
+    if (nThreads <= 1)
+    {
+        scrypt_hash_batch_worker(inputs, inputlen, res, n, 0, 1, Nfactor, &fAllOk);
+    }
+    else
+    {
+        boost::thread_group
+            workers;
+        for (size_t i = 1; i < nThreads; ++i)
+            workers.create_thread(
+                boost::bind(&scrypt_hash_batch_worker, inputs, inputlen, res, n, i, nThreads, Nfactor, &fAllOk));
+        scrypt_hash_batch_worker(inputs, inputlen, res, n, 0, nThreads, Nfactor, &fAllOk);
+        workers.join_all();
+    }
+    scryptHash.mEnd.stamp();
+    LogPrintf("scrypt_hash_batch(): %u hashes, total time = %lu (us), Nfactor = %d\n",
+            n, scryptHash.getExecutionTime(), Nfactor);
+    return fAllOk;
+}
+
 uint256 scrypt_salted_hash(const void* input, size_t inputlen, const void* salt, size_t saltlen)
 {
     unsigned char scratchpad[SCRYPT_BUFFER_SIZE];
@@ -29,6 +29,10 @@ unsigned int scanhash_scrypt(
                             , uint256 *phashTarget
                             );
 bool scrypt_hash(const void* input, size_t inputlen, ::uint32_t *res, unsigned char Nfactor);
+// Hash n independent inputs (80-byte headers during headers sync) in one go,
+// spreading the scrypt instances over the hash calculation threads. res must
+// point to n * 8 words; inputs that fail leave their slot untouched.
+bool scrypt_hash_batch(const void* const inputs[], size_t inputlen, ::uint32_t *res, size_t n, unsigned char Nfactor);
 
 #endif // SCRYPT_H
 
@@ -241,6 +241,37 @@ enum
         SerializationOp(s, CSerActionUnserialize());                  \
     }
 
+/**
+ * Flat fast path for fixed-layout types whose wire format equals their
+ * in-memory layout on little-endian targets: every field is a blob or a
+ * little-endian-serialized integer, declared in wire order with no padding
+ * (enforced at compile time through the expected size). Both directions then
+ * lower to the stream's single bounds-checked read/write of sizeof(cls)
+ * bytes instead of the field-by-field SerializationOp walk, which matters
+ * for records processed by the million (transaction inputs, index keys).
+ * Big-endian targets keep the field-wise path, which does the byteswaps.
+ * The class must still provide SerializationOp as the layout's source of
+ * truth (and for the big-endian build).
+ */
+#if defined(WORDS_BIGENDIAN)
+#define ADD_FLAT_SERIALIZE_METHODS(cls, nExpectedSize) ADD_SERIALIZE_METHODS
+#else
+#define ADD_FLAT_SERIALIZE_METHODS(cls, nExpectedSize)                \
+    template<typename Stream>                                         \
+    void Serialize(Stream& s) const {                                 \
+        /* the class is complete once this is instantiated */         \
+        static_assert(sizeof(cls) == (nExpectedSize),                 \
+                      "padding or layout change breaks flat serialization of " #cls); \
+        s.write((const char*)this, sizeof(cls));                      \
+    }                                                                 \
+    template<typename Stream>                                         \
+    void Unserialize(Stream& s) {                                     \
+        static_assert(sizeof(cls) == (nExpectedSize),                 \
+                      "padding or layout change breaks flat serialization of " #cls); \
+        s.read((char*)this, sizeof(cls));                             \
+    }
+#endif
+
 template<typename Stream> inline void Serialize(Stream& s, char a    ) { ser_writedata8(s, a); } // TODO Get rid of bare char
 template<typename Stream> inline void Serialize(Stream& s, int8_t a  ) { ser_writedata8(s, a); }
 template<typename Stream> inline void Serialize(Stream& s, uint8_t a ) { ser_writedata8(s, a); }
@@ -1002,6 +1033,14 @@ size_t GetSerializeSize(const S& s, const T& t)
     return (CSizeComputer(s.GetType(), s.GetVersion()) << t).size();
 }
 
+template <typename... T>
+size_t GetSerializeSizeMany(int nType, int nVersion, const T&... t)
+{
+    CSizeComputer sc(nType, nVersion);
+    SerializeMany(sc, t...);
+    return sc.size();
+}
+
 class CScript;
 
 #endif
@@ -0,0 +1,77 @@
+// Copyright (c) 2009-2010 Satoshi Nakamoto
+// Copyright (c) 2009-2015 The Bitcoin Core developers
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YACOIN_SPENTINDEX_H
+#define YACOIN_SPENTINDEX_H
+
+#include "uint256.h"
+#include "serialize.h"
+
+struct CSpentIndexKey {
+    uint256 txid;
+    unsigned int outputIndex;
+
+    // Blob + LE uint32 in wire order with no padding: one 36-byte copy
+    ADD_FLAT_SERIALIZE_METHODS(CSpentIndexKey, 36);
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(outputIndex);
+    }
+
+    CSpentIndexKey(uint256 t, unsigned int i) {
+        txid = t;
+        outputIndex = i;
+    }
+
+    CSpentIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        txid.SetNull();
+        outputIndex = 0;
+    }
+};
+
+struct CSpentIndexValue {
+    uint256 txid;
+    unsigned int inputIndex;
+    int blockHeight;
+
+    // Blob + two LE 32-bit fields in wire order with no padding
+    ADD_FLAT_SERIALIZE_METHODS(CSpentIndexValue, 40);
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(inputIndex);
+        READWRITE(blockHeight);
+    }
+
+    CSpentIndexValue(uint256 t, unsigned int i, int h) {
+        txid = t;
+        inputIndex = i;
+        blockHeight = h;
+    }
+
+    CSpentIndexValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        txid.SetNull();
+        inputIndex = 0;
+        blockHeight = 0;
+    }
+
+    bool IsNull() const {
+        return txid.IsNull();
+    }
+};
+
+#endif // YACOIN_SPENTINDEX_H
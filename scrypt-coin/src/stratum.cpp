@@ -0,0 +1,515 @@
+// Copyright (c) 2024 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "stratum.h"
+
+#include "adaptivepow.h"
+#include "base58.h"
+#include "bignum.h"
+#include "chainparams.h"
+#include "hash.h"
+#include "httpserver.h"
+#include "miner.h"
+#include "netbase.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "streams.h"
+#include "sync.h"
+#include "timedata.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "validation.h"
+#include "wallet/wallet.h"
+
+#include <univalue.h>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <set>
+
+namespace {
+
+//! Per-connection extranonce1 width plus the miner-rolled extranonce2 width;
+//! together they form the 8-byte region the coinbase is split around
+static const size_t STRATUM_EXTRANONCE1_SIZE = 4;
+static const size_t STRATUM_EXTRANONCE2_SIZE = 4;
+
+//! Jobs retained for late submits; a clean job (new tip) drops them all
+static const size_t MAX_STRATUM_JOBS = 8;
+//! A fresh job picks up new mempool arrivals this often (seconds)
+static const int64_t STRATUM_JOB_REFRESH_SECONDS = 30;
+//! Disconnect a client that sends this much data without a newline
+static const size_t MAX_STRATUM_LINE_SIZE = 8192;
+
+struct CStratumClient {
+    bool fSubscribed;
+    bool fAuthorized;
+    uint32_t nExtraNonce1;
+};
+
+struct CStratumJob {
+    std::string strJobId;
+    //! Template block; vtx[0] still carries the placeholder coinbase
+    CBlock block;
+    //! Coinbase serialization up to / after the 8-byte extranonce region
+    std::vector<unsigned char> vchCoinb1;
+    std::vector<unsigned char> vchCoinb2;
+    //! Merkle branch of leaf 0, valid for any coinbase the miner rebuilds
+    std::vector<uint256> vMerkleBranch;
+    uint256 hashTarget;
+    //! Preformatted mining.notify line, identical for every client
+    std::string strNotify;
+    //! Shares already accepted for this job, for duplicate rejection
+    std::set<uint256> setShares;
+};
+
+CCriticalSection cs_stratum;
+std::map<bufferevent*, CStratumClient> mapStratumClients;
+std::map<std::string, CStratumJob> mapStratumJobs;
+std::deque<std::string> vJobIds;       //!< insertion order of mapStratumJobs
+uint64_t nJobCounter = 0;
+uint32_t nExtraNonce1Counter = 0;
+uint256 hashJobTip;                    //!< tip the newest job was built on
+int64_t nLastJobTime = 0;
+CScript scriptStratumPayout;
+uint256 hashShareTarget;
+int64_t nStratumDiff = DEFAULT_STRATUM_DIFF;
+
+struct event* stratumTimer = nullptr;
+struct evconnlistener* stratumListener = nullptr;
+
+void StratumSend(bufferevent* bev, const std::string& strLine)
+{
+    bufferevent_write(bev, strLine.data(), strLine.size());
+}
+
+void StratumReply(bufferevent* bev, const UniValue& id, const UniValue& result, const UniValue& error)
+{
+    UniValue resp(UniValue::VOBJ);
+    resp.push_back(Pair("id", id));
+    resp.push_back(Pair("result", result));
+    resp.push_back(Pair("error", error));
+    StratumSend(bev, resp.write() + "\n");
+}
+
+UniValue StratumError(int nCode, const std::string& strMessage)
+{
+    UniValue err(UniValue::VARR);
+    err.push_back(nCode);
+    err.push_back(strMessage);
+    err.push_back(NullUniValue);
+    return err;
+}
+
+std::string SetDifficultyLine()
+{
+    UniValue params(UniValue::VARR);
+    params.push_back(nStratumDiff);
+    UniValue req(UniValue::VOBJ);
+    req.push_back(Pair("id", NullUniValue));
+    req.push_back(Pair("method", "mining.set_difficulty"));
+    req.push_back(Pair("params", params));
+    return req.write() + "\n";
+}
+
+/** Build a job from the shared template assembler and register it. Returns
+ *  null on failure (e.g. a reorg raced the template); the caller just waits
+ *  for the next timer tick. Requires cs_stratum. */
+CStratumJob* BuildStratumJob(bool fClean)
+{
+    std::unique_ptr<CBlockTemplate> ptemplate = TemplateAssembler().CreateTemplate(scriptStratumPayout);
+    if (!ptemplate)
+        return nullptr;
+
+    CStratumJob job;
+    job.block = ptemplate->block;
+    CBlock& block = job.block;
+
+    int nHeight;
+    {
+        LOCK(cs_main);
+        if (block.hashPrevBlock != chainActive.Tip()->GetBlockHash())
+            return nullptr;
+        nHeight = chainActive.Tip()->nHeight + 1;
+    }
+
+    // Rebuild the coinbase scriptSig around an extranonce placeholder. The
+    // marker bytes are random per job so locating them in the serialization
+    // cannot be confused with anything the script happens to contain.
+    std::vector<unsigned char> vchMarker(STRATUM_EXTRANONCE1_SIZE + STRATUM_EXTRANONCE2_SIZE);
+    GetRandBytes(vchMarker.data(), vchMarker.size());
+    block.vtx[0].vin[0].scriptSig = (CScript() << nHeight << vchMarker) + COINBASE_FLAGS;
+    if (block.vtx[0].vin[0].scriptSig.size() > 100)
+        return nullptr;
+
+    CDataStream ssCoinbase(SER_NETWORK, PROTOCOL_VERSION);
+    ssCoinbase << block.vtx[0];
+    std::vector<unsigned char> vchCoinbase(ssCoinbase.begin(), ssCoinbase.end());
+    std::vector<unsigned char>::iterator itMarker =
+        std::search(vchCoinbase.begin(), vchCoinbase.end(), vchMarker.begin(), vchMarker.end());
+    if (itMarker == vchCoinbase.end()) {
+        error("%s: extranonce marker not found in coinbase", __func__);
+        return nullptr;
+    }
+    job.vchCoinb1.assign(vchCoinbase.begin(), itMarker);
+    job.vchCoinb2.assign(itMarker + vchMarker.size(), vchCoinbase.end());
+
+    // Branch of leaf 0: every sibling stays valid whatever coinbase the
+    // miner rebuilds, so the root is recomputed from just the branch
+    job.vMerkleBranch = block.GetMerkleBranch(0);
+    job.hashTarget = CBigNum().SetCompact(block.nBits).getuint256();
+    job.strJobId = strprintf("%x", ++nJobCounter);
+
+    UniValue params(UniValue::VARR);
+    params.push_back(job.strJobId);
+    params.push_back(block.hashPrevBlock.GetHex());
+    params.push_back(HexStr(job.vchCoinb1));
+    params.push_back(HexStr(job.vchCoinb2));
+    UniValue branch(UniValue::VARR);
+    for (const uint256& hash : job.vMerkleBranch)
+        branch.push_back(hash.GetHex());
+    params.push_back(branch);
+    params.push_back(strprintf("%08x", block.nVersion));
+    params.push_back(strprintf("%08x", block.nBits));
+    params.push_back(strprintf("%016x", (uint64_t)block.nTime));
+    params.push_back(fClean);
+    UniValue req(UniValue::VOBJ);
+    req.push_back(Pair("id", NullUniValue));
+    req.push_back(Pair("method", "mining.notify"));
+    req.push_back(Pair("params", params));
+    job.strNotify = req.write() + "\n";
+
+    if (fClean) {
+        mapStratumJobs.clear();
+        vJobIds.clear();
+    }
+    while (vJobIds.size() >= MAX_STRATUM_JOBS) {
+        mapStratumJobs.erase(vJobIds.front());
+        vJobIds.pop_front();
+    }
+    vJobIds.push_back(job.strJobId);
+    hashJobTip = job.block.hashPrevBlock;
+    nLastJobTime = GetTime();
+    return &(mapStratumJobs[job.strJobId] = job);
+}
+
+/** Push a notify line to every subscribed client. Requires cs_stratum. */
+void BroadcastNotify(const std::string& strNotify)
+{
+    for (std::map<bufferevent*, CStratumClient>::iterator it = mapStratumClients.begin();
+         it != mapStratumClients.end(); ++it) {
+        if (it->second.fSubscribed)
+            StratumSend(it->first, strNotify);
+    }
+}
+
+UniValue HandleSubscribe(bufferevent* bev, CStratumClient& client)
+{
+    client.fSubscribed = true;
+    client.nExtraNonce1 = ++nExtraNonce1Counter;
+
+    UniValue subscriptions(UniValue::VARR);
+    UniValue subDiff(UniValue::VARR);
+    subDiff.push_back("mining.set_difficulty");
+    subDiff.push_back("1");
+    UniValue subNotify(UniValue::VARR);
+    subNotify.push_back("mining.notify");
+    subNotify.push_back("1");
+    subscriptions.push_back(subDiff);
+    subscriptions.push_back(subNotify);
+
+    UniValue result(UniValue::VARR);
+    result.push_back(subscriptions);
+    result.push_back(strprintf("%08x", client.nExtraNonce1));
+    result.push_back((int)STRATUM_EXTRANONCE2_SIZE);
+    return result;
+}
+
+UniValue HandleSubmit(CStratumClient& client, const UniValue& params, UniValue& errRet)
+{
+    if (params.size() < 5 || !params[1].isStr() || !params[2].isStr() ||
+            !params[3].isStr() || !params[4].isStr()) {
+        errRet = StratumError(20, "Malformed submit");
+        return false;
+    }
+
+    std::map<std::string, CStratumJob>::iterator itJob = mapStratumJobs.find(params[1].get_str());
+    if (itJob == mapStratumJobs.end()) {
+        errRet = StratumError(21, "Job not found");
+        return false;
+    }
+    CStratumJob& job = itJob->second;
+
+    std::vector<unsigned char> vchExtraNonce2 = ParseHex(params[2].get_str());
+    if (vchExtraNonce2.size() != STRATUM_EXTRANONCE2_SIZE) {
+        errRet = StratumError(20, "Bad extranonce2 size");
+        return false;
+    }
+    int64_t nTimeSubmitted;
+    uint64_t nNonce64;
+    try {
+        nTimeSubmitted = (int64_t)std::stoull(params[3].get_str(), nullptr, 16);
+        nNonce64 = std::stoull(params[4].get_str(), nullptr, 16);
+    } catch (const std::exception&) {
+        errRet = StratumError(20, "Malformed ntime/nonce");
+        return false;
+    }
+    if (nTimeSubmitted < job.block.nTime || nTimeSubmitted > GetAdjustedTime() + 2 * 60 * 60) {
+        errRet = StratumError(20, "Time out of range");
+        return false;
+    }
+
+    // Duplicate rejection: a share is its extranonce/ntime/nonce tuple
+    CHashWriter ssShare(SER_GETHASH, 0);
+    ssShare << client.nExtraNonce1 << vchExtraNonce2 << nTimeSubmitted << nNonce64;
+    if (!job.setShares.insert(ssShare.GetHash()).second) {
+        errRet = StratumError(22, "Duplicate share");
+        return false;
+    }
+
+    // Rebuild the coinbase the miner hashed and recompute the merkle root
+    // from the precomputed branch
+    CDataStream ssCoinbase(SER_NETWORK, PROTOCOL_VERSION);
+    ssCoinbase.write((const char*)job.vchCoinb1.data(), job.vchCoinb1.size());
+    std::vector<unsigned char> vchExtraNonce1 = ParseHex(strprintf("%08x", client.nExtraNonce1));
+    ssCoinbase.write((const char*)vchExtraNonce1.data(), vchExtraNonce1.size());
+    ssCoinbase.write((const char*)vchExtraNonce2.data(), vchExtraNonce2.size());
+    ssCoinbase.write((const char*)job.vchCoinb2.data(), job.vchCoinb2.size());
+    CTransaction txCoinbase;
+    try {
+        ssCoinbase >> txCoinbase;
+    } catch (const std::exception&) {
+        errRet = StratumError(20, "Coinbase decode failed");
+        return false;
+    }
+
+    CBlock block(job.block);
+    block.vtx[0] = txCoinbase;
+    block.hashMerkleRoot = CBlock::CheckMerkleBranch(txCoinbase.GetHash(), job.vMerkleBranch, 0);
+    block.nTime = nTimeSubmitted;
+    block.nNonce64 = nNonce64;
+    block.vMerkleTree.clear();
+
+    uint256 headerHash = block.GetAdaptivePowHeaderHash();
+    AdaptivePowResult pow = AdaptivePowHash(headerHash, nNonce64, g_adaptivePowDAG.get(), Params().GetConsensus());
+
+    if (pow.hashFinal > hashShareTarget && pow.hashFinal > job.hashTarget) {
+        errRet = StratumError(23, "Low difficulty share");
+        return false;
+    }
+
+    if (pow.hashFinal <= job.hashTarget) {
+        // Block solve: finish the block and submit it like the internal miner
+        block.hashMix = pow.hashMix;
+        CWallet* pwallet = GetFirstWallet();
+        if (!pwallet || !block.SignBlock(*pwallet)) {
+            LogPrintf("Stratum: block %s found but could not be signed (wallet locked?)\n",
+                      pow.hashFinal.GetHex());
+        } else {
+            std::shared_ptr<const CBlock> pblock = std::make_shared<const CBlock>(block);
+            if (ProcessNewBlock(Params(), pblock, true, nullptr))
+                LogPrintf("Stratum: accepted block %s from job %s\n", pblock->GetHash().GetHex(), job.strJobId);
+            else
+                LogPrintf("Stratum: solved block %s was rejected\n", pow.hashFinal.GetHex());
+        }
+    }
+
+    return true;
+}
+
+void ProcessStratumLine(bufferevent* bev, CStratumClient& client, const std::string& strLine)
+{
+    UniValue req;
+    if (!req.read(strLine) || !req.isObject()) {
+        StratumReply(bev, NullUniValue, NullUniValue, StratumError(20, "Parse error"));
+        return;
+    }
+    const UniValue& id = find_value(req, "id");
+    const UniValue& methodval = find_value(req, "method");
+    UniValue params = find_value(req, "params");
+    if (!methodval.isStr()) {
+        StratumReply(bev, id, NullUniValue, StratumError(20, "Missing method"));
+        return;
+    }
+    if (!params.isArray())
+        params = UniValue(UniValue::VARR);
+    const std::string strMethod = methodval.get_str();
+
+    if (strMethod == "mining.subscribe") {
+        UniValue result;
+        std::string strNotify;
+        {
+            LOCK(cs_stratum);
+            result = HandleSubscribe(bev, client);
+            // Hand the newest job to the fresh connection right away
+            if (vJobIds.empty())
+                BuildStratumJob(true);
+            if (!vJobIds.empty())
+                strNotify = mapStratumJobs[vJobIds.back()].strNotify;
+        }
+        StratumReply(bev, id, result, NullUniValue);
+        StratumSend(bev, SetDifficultyLine());
+        if (!strNotify.empty())
+            StratumSend(bev, strNotify);
+    } else if (strMethod == "mining.authorize") {
+        // Local pool mode: the payout script is the node's, so every worker
+        // name is accepted and only used for logging
+        client.fAuthorized = true;
+        StratumReply(bev, id, true, NullUniValue);
+    } else if (strMethod == "mining.submit") {
+        UniValue err = NullUniValue;
+        UniValue result;
+        {
+            LOCK(cs_stratum);
+            result = HandleSubmit(client, params, err);
+        }
+        StratumReply(bev, id, result, err);
+    } else if (strMethod == "mining.extranonce.subscribe") {
+        // Extranonce1 is fixed per connection
+        StratumReply(bev, id, false, NullUniValue);
+    } else {
+        StratumReply(bev, id, NullUniValue, StratumError(20, "Unknown method"));
+    }
+}
+
+void stratum_read_cb(bufferevent* bev, void* ctx)
+{
+    CStratumClient* pclient;
+    {
+        LOCK(cs_stratum);
+        std::map<bufferevent*, CStratumClient>::iterator it = mapStratumClients.find(bev);
+        if (it == mapStratumClients.end())
+            return;
+        pclient = &it->second;
+    }
+    struct evbuffer* input = bufferevent_get_input(bev);
+    char* pszLine;
+    size_t nLen;
+    while ((pszLine = evbuffer_readln(input, &nLen, EVBUFFER_EOL_CRLF)) != nullptr) {
+        std::string strLine(pszLine, nLen);
+        free(pszLine);
+        ProcessStratumLine(bev, *pclient, strLine);
+    }
+    if (evbuffer_get_length(input) > MAX_STRATUM_LINE_SIZE) {
+        LOCK(cs_stratum);
+        mapStratumClients.erase(bev);
+        bufferevent_free(bev);
+    }
+}
+
+void stratum_event_cb(bufferevent* bev, short events, void* ctx)
+{
+    if (events & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
+        LOCK(cs_stratum);
+        mapStratumClients.erase(bev);
+        bufferevent_free(bev);
+    }
+}
+
+void stratum_accept_cb(evconnlistener* listener, evutil_socket_t fd,
+                       struct sockaddr* address, int socklen, void* ctx)
+{
+    bufferevent* bev = bufferevent_socket_new(evconnlistener_get_base(listener), fd,
+                                              BEV_OPT_CLOSE_ON_FREE | BEV_OPT_THREADSAFE);
+    if (!bev) {
+        evutil_closesocket(fd);
+        return;
+    }
+    {
+        LOCK(cs_stratum);
+        CStratumClient client;
+        client.fSubscribed = false;
+        client.fAuthorized = false;
+        client.nExtraNonce1 = 0;
+        mapStratumClients[bev] = client;
+    }
+    bufferevent_setcb(bev, stratum_read_cb, nullptr, stratum_event_cb, nullptr);
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+}
+
+void stratum_timer_cb(evutil_socket_t fd, short events, void* ctx)
+{
+    uint256 hashTip;
+    {
+        LOCK(cs_main);
+        hashTip = chainActive.Tip()->GetBlockHash();
+    }
+    LOCK(cs_stratum);
+    if (mapStratumClients.empty())
+        return;
+    bool fClean = (hashTip != hashJobTip);
+    if (!fClean && GetTime() - nLastJobTime < STRATUM_JOB_REFRESH_SECONDS)
+        return;
+    CStratumJob* pjob = BuildStratumJob(fClean);
+    if (pjob)
+        BroadcastNotify(pjob->strNotify);
+}
+
+} // namespace
+
+bool InitStratumServer()
+{
+    int64_t nPort = gArgs.GetArg("-stratumport", DEFAULT_STRATUM_PORT);
+    if (nPort <= 0)
+        return true;
+    if (nPort > 65535)
+        return error("%s: invalid -stratumport %d", __func__, nPort);
+
+    CTxDestination dest = DecodeDestination(gArgs.GetArg("-stratumaddress", ""));
+    if (!IsValidDestination(dest))
+        return error("%s: -stratumport requires a valid -stratumaddress for the coinbase payout", __func__);
+    scriptStratumPayout = GetScriptForDestination(dest);
+
+    // Share difficulty 1 is the chain's proof-of-work limit
+    nStratumDiff = std::max<int64_t>(1, gArgs.GetArg("-stratumdiff", DEFAULT_STRATUM_DIFF));
+    hashShareTarget = (bnProofOfWorkLimit / CBigNum(nStratumDiff)).getuint256();
+
+    std::string strBind = gArgs.GetArg("-stratumbind", "127.0.0.1");
+    CService addrBind;
+    if (!Lookup(strBind.c_str(), addrBind, (int)nPort, false))
+        return error("%s: invalid -stratumbind address '%s'", __func__, strBind);
+    struct sockaddr_storage storage;
+    socklen_t len = sizeof(storage);
+    if (!addrBind.GetSockAddr((struct sockaddr*)&storage, &len))
+        return error("%s: could not resolve -stratumbind address '%s'", __func__, strBind);
+
+    stratumListener = evconnlistener_new_bind(EventBase(), stratum_accept_cb, nullptr,
+                                              LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1,
+                                              (struct sockaddr*)&storage, len);
+    if (!stratumListener)
+        return error("%s: could not bind stratum server to %s:%d", __func__, strBind, nPort);
+
+    stratumTimer = event_new(EventBase(), -1, EV_PERSIST, stratum_timer_cb, nullptr);
+    struct timeval tv = {1, 0};
+    event_add(stratumTimer, &tv);
+
+    LogPrintf("Stratum server listening on %s:%d (share difficulty %d)\n", strBind, nPort, nStratumDiff);
+    return true;
+}
+
+void StopStratumServer()
+{
+    if (stratumTimer) {
+        event_del(stratumTimer);
+        event_free(stratumTimer);
+        stratumTimer = nullptr;
+    }
+    if (stratumListener) {
+        evconnlistener_free(stratumListener);
+        stratumListener = nullptr;
+    }
+    LOCK(cs_stratum);
+    for (std::map<bufferevent*, CStratumClient>::iterator it = mapStratumClients.begin();
+         it != mapStratumClients.end(); ++it)
+        bufferevent_free(it->first);
+    mapStratumClients.clear();
+    mapStratumJobs.clear();
+    vJobIds.clear();
+}
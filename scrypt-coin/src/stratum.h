@@ -0,0 +1,40 @@
+// Copyright (c) 2024 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YACOIN_STRATUM_H
+#define YACOIN_STRATUM_H
+
+/** Native stratum v1 job server.
+ *
+ * Serves mining jobs straight from the shared CTemplateAssembler over
+ * persistent TCP connections on the HTTP server's libevent base, replacing
+ * the external getblocktemplate-to-stratum bridge and its JSON round-trip.
+ * The coinbase is split around an 8-byte extranonce region (4 bytes assigned
+ * per connection, 4 bytes rolled by the miner) and the coinbase merkle
+ * branch is precomputed per job, so a notify is a preformatted string push.
+ *
+ * The dialect follows stratum v1 message shapes (mining.subscribe/authorize/
+ * notify/submit) with two deviations forced by the AdaptivePow header:
+ * ntime and nonce are 64-bit (16 hex digits) and all hashes travel as plain
+ * big-endian hex with no word swapping. The in-tree GPU miner speaks the
+ * same dialect.
+ *
+ * Enabled with -stratumport; -stratumaddress sets the coinbase payout.
+ */
+
+//! -stratumport default: 0 disables the server
+static const int DEFAULT_STRATUM_PORT = 0;
+//! -stratumdiff default share difficulty
+static const int DEFAULT_STRATUM_DIFF = 1;
+
+/** Bind the listening socket and hook the job timer onto the HTTP event
+ *  base. Call between InitHTTPServer and StartHTTPServer. Returns false
+ *  only on misconfiguration; a disabled server (port 0) returns true. */
+bool InitStratumServer();
+
+/** Drop all miner connections and unhook from the event base. Call before
+ *  the HTTP server is interrupted, while its event loop still runs. */
+void StopStratumServer();
+
+#endif // YACOIN_STRATUM_H
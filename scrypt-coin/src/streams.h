@@ -70,6 +70,45 @@ OverrideStream<S> WithOrVersion(S* s, int nVersionFlag)
     return OverrideStream<S>(s, s->GetType(), s->GetVersion() | nVersionFlag);
 }
 
+/** Minimal read-only stream over a caller-owned memory range (e.g. a span of
+ *  an mmap'ed block file). Does not copy or take ownership; the range must
+ *  outlive the stream. Reading past the end throws, like CDataStream.
+ */
+class CMemoryReadStream
+{
+private:
+    const char* pchData;
+    size_t nSize;
+    size_t nPos;
+
+    const int nType;
+    const int nVersion;
+
+public:
+    CMemoryReadStream(const char* pchDataIn, size_t nSizeIn, int nTypeIn, int nVersionIn)
+        : pchData(pchDataIn), nSize(nSizeIn), nPos(0), nType(nTypeIn), nVersion(nVersionIn) {}
+
+    template<typename T>
+    CMemoryReadStream& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+
+    void read(char* pch, size_t nReadSize)
+    {
+        if (nReadSize > nSize - nPos || nPos > nSize)
+            throw std::ios_base::failure("CMemoryReadStream::read(): end of data");
+        memcpy(pch, pchData + nPos, nReadSize);
+        nPos += nReadSize;
+    }
+
+    int GetVersion() const { return nVersion; }
+    int GetType() const { return nType; }
+    size_t size() const { return nSize - nPos; }
+};
+
 /* Minimal stream for overwriting and/or appending to an existing byte vector
  *
  * The referenced vector will grow as necessary
@@ -414,6 +453,24 @@ public:
         clear();
     }
 
+    /** Adopt d's storage as this stream's backing buffer. Any contents of
+     *  both are discarded; only d's capacity is kept. Used to recycle
+     *  receive buffers between network messages. */
+    void AdoptBuffer(CSerializeData&& d) {
+        d.clear();
+        vch = std::move(d);
+        nReadPos = 0;
+    }
+
+    /** Move the backing buffer (capacity included) out into d, leaving the
+     *  stream empty. */
+    void ReleaseBuffer(CSerializeData& d) {
+        d = std::move(vch);
+        d.clear();
+        vch.clear();
+        nReadPos = 0;
+    }
+
     /**
      * XOR the contents of this stream with a certain key.
      *
@@ -447,6 +504,106 @@ public:
 
 
 
+template <typename IStream>
+class BitStreamReader
+{
+private:
+    IStream& m_istream;
+
+    /// Buffered byte read in from the input stream. A new byte is read into the
+    /// buffer when m_offset reaches 8.
+    uint8_t m_buffer;
+
+    /// Number of high order bits in m_buffer already returned by previous
+    /// Read() calls. The next bit to be returned is at this offset from the
+    /// most significant bit position.
+    int m_offset;
+
+public:
+    explicit BitStreamReader(IStream& istream) : m_istream(istream), m_buffer(0), m_offset(8) {}
+
+    /** Read the specified number of bits from the stream. The data is returned
+     * in the nbits least significant bits of a 64-bit uint.
+     */
+    uint64_t Read(int nbits) {
+        if (nbits < 0 || nbits > 64) {
+            throw std::out_of_range("nbits must be between 0 and 64");
+        }
+
+        uint64_t data = 0;
+        while (nbits > 0) {
+            if (m_offset == 8) {
+                m_istream >> m_buffer;
+                m_offset = 0;
+            }
+
+            int bits = std::min(8 - m_offset, nbits);
+            data <<= bits;
+            data |= static_cast<uint8_t>(m_buffer << m_offset) >> (8 - bits);
+            m_offset += bits;
+            nbits -= bits;
+        }
+        return data;
+    }
+};
+
+template <typename OStream>
+class BitStreamWriter
+{
+private:
+    OStream& m_ostream;
+
+    /// Buffered byte waiting to be written to the output stream. The byte is
+    /// written buffer when m_offset reaches 8 or Flush() is called.
+    uint8_t m_buffer;
+
+    /// Number of high order bits in m_buffer already written by previous
+    /// Write() calls and not yet flushed to the stream. The next bit to be
+    /// written to is at this offset from the most significant bit position.
+    int m_offset;
+
+public:
+    explicit BitStreamWriter(OStream& ostream) : m_ostream(ostream), m_buffer(0), m_offset(0) {}
+
+    ~BitStreamWriter()
+    {
+        Flush();
+    }
+
+    /** Write the nbits least significant bits of a 64-bit int to the output
+     * stream. Data is buffered until it completes an octet.
+     */
+    void Write(uint64_t data, int nbits) {
+        if (nbits < 0 || nbits > 64) {
+            throw std::out_of_range("nbits must be between 0 and 64");
+        }
+
+        while (nbits > 0) {
+            int bits = std::min(8 - m_offset, nbits);
+            m_buffer |= (data << (64 - nbits)) >> (64 - 8 + m_offset);
+            m_offset += bits;
+            nbits -= bits;
+
+            if (m_offset == 8) {
+                Flush();
+            }
+        }
+    }
+
+    /** Flush any unwritten bits to the output stream, padding with 0's to the
+     * next byte boundary.
+     */
+    void Flush() {
+        if (m_offset == 0) {
+            return;
+        }
+
+        m_ostream << m_buffer;
+        m_buffer = 0;
+        m_offset = 0;
+    }
+};
+
 /** Non-refcounted RAII wrapper for FILE*
  *
  * Will automatically close the file when it goes out of scope if not null.
@@ -0,0 +1,173 @@
+// Copyright (c) 2025 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YACOIN_SUPPORT_ALLOCATORS_POOL_H
+#define YACOIN_SUPPORT_ALLOCATORS_POOL_H
+
+#include <assert.h>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+/**
+ * Arena-backed memory resource for node-based containers. Small fixed-size
+ * allocations (the map nodes) are carved out of large chunks and recycled
+ * through per-size freelists, so millions of entries cost two heap
+ * allocations per chunk instead of one each, stay contiguous, and the bytes
+ * actually held can be read off the chunk list. Anything larger than
+ * MAX_POOLED_BYTES (e.g. the container's bucket array) falls through to the
+ * global heap.
+ *
+ * Not thread safe; each cache owns its own resource, protected by whatever
+ * protects the cache itself.
+ */
+class CPoolResource
+{
+private:
+    //! Every pooled allocation is rounded up to a multiple of this, which
+    //! also keeps each block sufficiently aligned for any node type.
+    static const size_t ALIGNMENT = 16;
+    //! Largest allocation served from the pool.
+    static const size_t MAX_POOLED_BYTES = 512;
+    //! Size of one arena chunk.
+    static const size_t CHUNK_BYTES = 262144;
+
+    struct CFreeNode
+    {
+        CFreeNode* pNext;
+    };
+
+    //! All chunks ever carved from; freed in Clear() / the destructor.
+    std::vector<void*> vChunks;
+    //! Bump region of the most recent chunk.
+    char* pBump;
+    size_t nBumpLeft;
+    //! Freelist heads, one per size class.
+    CFreeNode* apFreeList[MAX_POOLED_BYTES / ALIGNMENT + 1];
+
+    CPoolResource(const CPoolResource&);
+    CPoolResource& operator=(const CPoolResource&);
+
+    static size_t ClassOf(size_t nBytes)
+    {
+        return (nBytes + ALIGNMENT - 1) / ALIGNMENT;
+    }
+
+public:
+    CPoolResource() : pBump(nullptr), nBumpLeft(0)
+    {
+        for (size_t i = 0; i < sizeof(apFreeList) / sizeof(apFreeList[0]); ++i)
+            apFreeList[i] = nullptr;
+    }
+
+    ~CPoolResource()
+    {
+        Clear();
+    }
+
+    void* Allocate(size_t nBytes)
+    {
+        if (nBytes > MAX_POOLED_BYTES)
+            return ::operator new(nBytes);
+        const size_t nClass = ClassOf(nBytes);
+        if (apFreeList[nClass] != nullptr) {
+            CFreeNode* pNode = apFreeList[nClass];
+            apFreeList[nClass] = pNode->pNext;
+            return pNode;
+        }
+        const size_t nAlloc = nClass * ALIGNMENT;
+        if (nBumpLeft < nAlloc) {
+            // The tail of the old chunk (less than one node) is abandoned.
+            pBump = static_cast<char*>(::operator new(CHUNK_BYTES));
+            vChunks.push_back(pBump);
+            nBumpLeft = CHUNK_BYTES;
+        }
+        void* p = pBump;
+        pBump += nAlloc;
+        nBumpLeft -= nAlloc;
+        return p;
+    }
+
+    void Deallocate(void* p, size_t nBytes)
+    {
+        if (nBytes > MAX_POOLED_BYTES) {
+            ::operator delete(p);
+            return;
+        }
+        CFreeNode* pNode = static_cast<CFreeNode*>(p);
+        pNode->pNext = apFreeList[ClassOf(nBytes)];
+        apFreeList[ClassOf(nBytes)] = pNode;
+    }
+
+    //! Return every chunk to the heap in one go. Only valid once all pooled
+    //! allocations have been handed back, i.e. right after the owning
+    //! container was cleared.
+    void Clear()
+    {
+        for (size_t i = 0; i < sizeof(apFreeList) / sizeof(apFreeList[0]); ++i)
+            apFreeList[i] = nullptr;
+        for (size_t i = 0; i < vChunks.size(); ++i)
+            ::operator delete(vChunks[i]);
+        vChunks.clear();
+        pBump = nullptr;
+        nBumpLeft = 0;
+    }
+
+    //! Bytes held in arena chunks - what the pooled part of the container
+    //! actually costs, with no per-node malloc overhead to estimate.
+    size_t DynamicMemoryUsage() const
+    {
+        return vChunks.size() * CHUNK_BYTES;
+    }
+};
+
+/** Allocator handing single-element (node) allocations to a CPoolResource.
+ * A default-constructed instance has no resource and falls back to the global
+ * heap, so containers of this allocator type can still be created ad hoc.
+ */
+template <typename T>
+class pool_allocator
+{
+private:
+    CPoolResource* pResource;
+
+    template <typename U>
+    friend class pool_allocator;
+
+public:
+    typedef T value_type;
+
+    pool_allocator() throw() : pResource(nullptr) {}
+    explicit pool_allocator(CPoolResource* pResourceIn) throw() : pResource(pResourceIn) {}
+    pool_allocator(const pool_allocator& a) throw() : pResource(a.pResource) {}
+    template <typename U>
+    pool_allocator(const pool_allocator<U>& a) throw() : pResource(a.pResource)
+    {
+    }
+
+    template <typename U>
+    struct rebind {
+        typedef pool_allocator<U> other;
+    };
+
+    T* allocate(size_t n)
+    {
+        if (pResource != nullptr && n == 1)
+            return static_cast<T*>(pResource->Allocate(sizeof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        if (pResource != nullptr && n == 1)
+            pResource->Deallocate(p, sizeof(T));
+        else
+            ::operator delete(p);
+    }
+
+    bool operator==(const pool_allocator& b) const { return pResource == b.pResource; }
+    bool operator!=(const pool_allocator& b) const { return pResource != b.pResource; }
+};
+
+#endif // YACOIN_SUPPORT_ALLOCATORS_POOL_H
@@ -0,0 +1,219 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "support/ebr.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+namespace ebr {
+
+//! One retired object awaiting destruction
+struct RetiredPtr {
+    void* ptr;
+    void (*deleter)(void*);
+};
+
+//! Retirements a thread batches up before it tries to advance the epoch
+static const size_t RETIRE_BATCH = 128;
+
+/** Per-thread reclamation record. Records are allocated on first use, linked
+ * into a global registry and never freed; a record whose thread has exited
+ * is marked free and adopted by the next thread that registers, so the
+ * registry stays as small as the peak number of participating threads. */
+struct ThreadRecord
+{
+    //! epoch announced on guard entry; read by other threads during advance
+    std::atomic<uint32_t> nEpoch;
+    //! guard nesting depth; nonzero means inside a critical section
+    std::atomic<uint32_t> nDepth;
+    //! whether a live thread owns this record
+    std::atomic<bool> fInUse;
+    //! next record in the registry; immutable once linked
+    ThreadRecord* pNext;
+
+    //! limbo lists, one per epoch slot, and the epoch their entries were
+    //! retired in. Touched only by the owning thread.
+    std::vector<RetiredPtr> vLimbo[3];
+    uint32_t nLimboEpoch[3];
+    //! retirements since the last epoch-advance attempt
+    size_t nSinceAdvance;
+
+    ThreadRecord() : nEpoch(0), nDepth(0), fInUse(true), pNext(nullptr), nSinceAdvance(0)
+    {
+        nLimboEpoch[0] = nLimboEpoch[1] = nLimboEpoch[2] = 0;
+    }
+};
+
+//! Global epoch; only ever incremented
+static std::atomic<uint32_t> g_nGlobalEpoch(1);
+//! Head of the registry of all records ever created
+static std::atomic<ThreadRecord*> g_pRecords(nullptr);
+//! Approximate count of retired but undestroyed objects
+static std::atomic<size_t> g_nPending(0);
+
+//! Limbo entries inherited from exited threads, and the newest epoch any of
+//! them was retired in; both guarded by g_orphanMutex
+static std::mutex g_orphanMutex;
+static std::vector<RetiredPtr> g_vOrphans;
+static uint32_t g_nOrphanEpoch = 0;
+
+static void DestroyList(std::vector<RetiredPtr>& v)
+{
+    for (size_t i = 0; i < v.size(); i++)
+        v[i].deleter(v[i].ptr);
+    g_nPending.fetch_sub(v.size(), std::memory_order_relaxed);
+    v.clear();
+}
+
+/** Destroy the record's limbo entries that are at least two epochs behind
+ * nCurrent; no guard section entered under nCurrent or nCurrent-1 can still
+ * hold a reference to them. Owning thread only. */
+static void ReclaimSafe(ThreadRecord* rec, uint32_t nCurrent)
+{
+    for (int i = 0; i < 3; i++) {
+        if (!rec->vLimbo[i].empty() && nCurrent - rec->nLimboEpoch[i] >= 2)
+            DestroyList(rec->vLimbo[i]);
+    }
+}
+
+/** Try to advance the global epoch. Succeeds exactly when every thread
+ * currently inside a guard has announced the current epoch, which is the
+ * quiescence condition: no reader can still be in the previous epoch. */
+static void TryAdvance(ThreadRecord* self)
+{
+    uint32_t nCurrent = g_nGlobalEpoch.load(std::memory_order_seq_cst);
+    for (ThreadRecord* rec = g_pRecords.load(std::memory_order_acquire); rec; rec = rec->pNext) {
+        if (!rec->fInUse.load(std::memory_order_acquire))
+            continue;
+        if (rec->nDepth.load(std::memory_order_seq_cst) != 0 &&
+            rec->nEpoch.load(std::memory_order_seq_cst) != nCurrent) {
+            // Someone is still reading under the previous epoch
+            return;
+        }
+    }
+    // Several threads can race to here; the compare-exchange makes the epoch
+    // advance exactly once per quiescent period
+    g_nGlobalEpoch.compare_exchange_strong(nCurrent, nCurrent + 1, std::memory_order_seq_cst);
+    uint32_t nNow = g_nGlobalEpoch.load(std::memory_order_seq_cst);
+    ReclaimSafe(self, nNow);
+
+    // Entries inherited from exited threads become safe the same way; don't
+    // fight over the lock, another advance will get them
+    if (g_orphanMutex.try_lock()) {
+        if (!g_vOrphans.empty() && nNow - g_nOrphanEpoch >= 2)
+            DestroyList(g_vOrphans);
+        g_orphanMutex.unlock();
+    }
+}
+
+static ThreadRecord* AcquireRecord()
+{
+    // Prefer adopting a record left behind by an exited thread
+    for (ThreadRecord* rec = g_pRecords.load(std::memory_order_acquire); rec; rec = rec->pNext) {
+        bool fExpected = false;
+        if (!rec->fInUse.load(std::memory_order_relaxed) &&
+            rec->fInUse.compare_exchange_strong(fExpected, true, std::memory_order_acq_rel))
+            return rec;
+    }
+    ThreadRecord* rec = new ThreadRecord();
+    ThreadRecord* pHead = g_pRecords.load(std::memory_order_relaxed);
+    do {
+        rec->pNext = pHead;
+    } while (!g_pRecords.compare_exchange_weak(pHead, rec, std::memory_order_acq_rel));
+    return rec;
+}
+
+/** Thread-local registration handle: lazily acquires a record on first use
+ * and releases it when the thread exits. */
+struct Registration
+{
+    ThreadRecord* rec;
+
+    Registration() : rec(AcquireRecord()) {}
+
+    ~Registration()
+    {
+        // Whatever this thread could not destroy in time moves to the orphan
+        // list; the record itself is handed back for adoption
+        std::lock_guard<std::mutex> lock(g_orphanMutex);
+        for (int i = 0; i < 3; i++) {
+            if (!rec->vLimbo[i].empty()) {
+                g_vOrphans.insert(g_vOrphans.end(), rec->vLimbo[i].begin(), rec->vLimbo[i].end());
+                if (rec->nLimboEpoch[i] > g_nOrphanEpoch)
+                    g_nOrphanEpoch = rec->nLimboEpoch[i];
+                rec->vLimbo[i].clear();
+            }
+        }
+        rec->nSinceAdvance = 0;
+        rec->fInUse.store(false, std::memory_order_release);
+    }
+};
+
+static ThreadRecord* LocalRecord()
+{
+    static thread_local Registration reg;
+    return reg.rec;
+}
+
+Guard::Guard()
+{
+    ThreadRecord* rec = LocalRecord();
+    if (rec->nDepth.fetch_add(1, std::memory_order_seq_cst) == 0) {
+        // Announce the epoch this section runs under. The seq_cst ordering
+        // makes the announcement visible before any read of the protected
+        // structure; a concurrent advance either sees the announcement or
+        // this thread sees the new epoch, and either way no object this
+        // section can reach is destroyed while it runs.
+        rec->nEpoch.store(g_nGlobalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+}
+
+Guard::~Guard()
+{
+    LocalRecord()->nDepth.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+void RetirePtr(void* ptr, void (*deleter)(void*))
+{
+    ThreadRecord* rec = LocalRecord();
+    uint32_t nCurrent = g_nGlobalEpoch.load(std::memory_order_acquire);
+    int nSlot = nCurrent % 3;
+    // With three slots, leftover entries in this epoch's slot are from at
+    // least three epochs back and long safe
+    if (!rec->vLimbo[nSlot].empty() && rec->nLimboEpoch[nSlot] != nCurrent)
+        DestroyList(rec->vLimbo[nSlot]);
+    rec->nLimboEpoch[nSlot] = nCurrent;
+    RetiredPtr r = {ptr, deleter};
+    rec->vLimbo[nSlot].push_back(r);
+    g_nPending.fetch_add(1, std::memory_order_relaxed);
+
+    ReclaimSafe(rec, nCurrent);
+    if (++rec->nSinceAdvance >= RETIRE_BATCH) {
+        rec->nSinceAdvance = 0;
+        TryAdvance(rec);
+    }
+}
+
+void Flush()
+{
+    // Caller guarantees quiescence, so limbo lists of foreign records can be
+    // touched directly
+    for (ThreadRecord* rec = g_pRecords.load(std::memory_order_acquire); rec; rec = rec->pNext) {
+        for (int i = 0; i < 3; i++)
+            DestroyList(rec->vLimbo[i]);
+        rec->nSinceAdvance = 0;
+    }
+    std::lock_guard<std::mutex> lock(g_orphanMutex);
+    DestroyList(g_vOrphans);
+}
+
+size_t PendingCount()
+{
+    return g_nPending.load(std::memory_order_relaxed);
+}
+
+} // namespace ebr
@@ -0,0 +1,70 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YACOIN_SUPPORT_EBR_H
+#define YACOIN_SUPPORT_EBR_H
+
+#include <stddef.h>
+
+/** Epoch-based reclamation (EBR) for lock-free data structures.
+ *
+ * Readers of a lock-free structure wrap each traversal in an ebr::Guard.
+ * Writers unlink a node and hand it to ebr::Retire instead of deleting it;
+ * the node is destroyed only once every thread that was inside a guard at
+ * unlink time has left it, so a reader can never chase a pointer into freed
+ * memory.
+ *
+ * The scheme is the classic three-epoch one: a global epoch counter, a
+ * per-thread announcement of the epoch a guard was entered under, and
+ * per-thread limbo lists of retired objects. Retirements are batched per
+ * thread; after a batch the retiring thread tries to advance the global
+ * epoch, which succeeds once every thread currently inside a guard has
+ * announced the current epoch (quiescence). Objects retired two or more
+ * epochs ago are then destroyed by the thread that retired them, so there is
+ * no cross-thread deletion and no per-object reference counting.
+ *
+ * Guard sections must be short and must never block: a thread sleeping
+ * inside a guard stalls reclamation process-wide (memory grows, nothing
+ * crashes). Threads register themselves on first use and unregister on
+ * exit, handing any not-yet-destroyed limbo entries to a shared orphan
+ * list.
+ */
+namespace ebr {
+
+/** RAII guard marking a read-side critical section. Cheap (a few atomic
+ * operations on a thread-owned cache line) and reentrant. */
+class Guard
+{
+public:
+    Guard();
+    ~Guard();
+
+private:
+    Guard(const Guard&);
+    Guard& operator=(const Guard&);
+};
+
+//! Type-erased deferred deletion; prefer the typed Retire below.
+void RetirePtr(void* ptr, void (*deleter)(void*));
+
+/** Defer deletion of ptr until every guard section that could have seen it
+ * has ended. Call only after ptr has been unlinked, i.e. is unreachable for
+ * readers entering a guard from now on. */
+template <typename T>
+void Retire(T* ptr)
+{
+    RetirePtr(ptr, [](void* p) { delete static_cast<T*>(p); });
+}
+
+/** Destroy everything retired so far regardless of epochs. Only safe when no
+ * thread can be inside a guard section (shutdown, tests). */
+void Flush();
+
+/** Number of retired but not yet destroyed objects. Approximate under
+ * concurrency; exact when quiescent. */
+size_t PendingCount();
+
+} // namespace ebr
+
+#endif // YACOIN_SUPPORT_EBR_H
@@ -9,6 +9,9 @@
 
 #include <stdio.h>
 
+#include <map>
+#include <mutex>
+
 #include <boost/thread.hpp>
 
 #ifdef DEBUG_LOCKCONTENTION
@@ -19,6 +22,39 @@ void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 }
 #endif /* DEBUG_LOCKCONTENTION */
 
+#ifdef DEBUG_LOCKSTATS
+//
+// Lock contention profiling.
+// Aggregation is keyed by the lock's source name (the #cs stringization from
+// LOCK), so every site locking e.g. cs_main lands in one bucket. The table is
+// guarded by a plain std::mutex: the instrumentation must not itself go
+// through an instrumented lock, and the critical section here is a map lookup
+// plus three additions.
+//
+static std::mutex lockstats_mutex;
+static std::map<std::string, CLockStats> lockstats_map;
+
+void LockStatsRecord(const char* pszName, bool fContended, int64_t nWaitTimeMicros)
+{
+    std::lock_guard<std::mutex> guard(lockstats_mutex);
+    CLockStats& stats = lockstats_map[pszName];
+    stats.nAcquisitions++;
+    if (fContended) {
+        stats.nContended++;
+        stats.nWaitTimeMicros += nWaitTimeMicros;
+    }
+}
+
+std::map<std::string, CLockStats> LockStatsSnapshot(bool fReset)
+{
+    std::lock_guard<std::mutex> guard(lockstats_mutex);
+    std::map<std::string, CLockStats> ret = lockstats_map;
+    if (fReset)
+        lockstats_map.clear();
+    return ret;
+}
+#endif /* DEBUG_LOCKSTATS */
+
 #ifdef DEBUG_LOCKORDER
 //
 // Early deadlock detection.
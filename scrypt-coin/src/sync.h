@@ -8,6 +8,8 @@
 
 #include "threadsafety.h"
 
+#include <stdint.h>
+
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
@@ -106,6 +108,25 @@ typedef boost::condition_variable CConditionVariable;
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+#ifdef DEBUG_LOCKSTATS
+#include "utiltime.h"
+
+#include <map>
+#include <string>
+
+/** Aggregated acquisition counters for one named critical section. */
+struct CLockStats {
+    int64_t nAcquisitions;   //!< blocking acquisitions
+    int64_t nContended;      //!< acquisitions that had to wait
+    int64_t nWaitTimeMicros; //!< total time spent waiting, in microseconds
+    CLockStats() : nAcquisitions(0), nContended(0), nWaitTimeMicros(0) {}
+};
+void LockStatsRecord(const char* pszName, bool fContended, int64_t nWaitTimeMicros);
+std::map<std::string, CLockStats> LockStatsSnapshot(bool fReset);
+#else
+void static inline LockStatsRecord(const char* pszName, bool fContended, int64_t nWaitTimeMicros) {}
+#endif
+
 /** Wrapper around boost::unique_lock<Mutex> */
 template <typename Mutex>
 class SCOPED_LOCKABLE CMutexLock
@@ -116,13 +137,24 @@ private:
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()));
-#ifdef DEBUG_LOCKCONTENTION
+#if defined(DEBUG_LOCKCONTENTION) || defined(DEBUG_LOCKSTATS)
         if (!lock.try_lock()) {
+#ifdef DEBUG_LOCKCONTENTION
             PrintLockContention(pszName, pszFile, nLine);
 #endif
+#ifdef DEBUG_LOCKSTATS
+            const int64_t nStartMicros = GetTimeMicros();
             lock.lock();
-#ifdef DEBUG_LOCKCONTENTION
+            LockStatsRecord(pszName, true, GetTimeMicros() - nStartMicros);
+        } else {
+            LockStatsRecord(pszName, false, 0);
         }
+#else
+            lock.lock();
+        }
+#endif
+#else
+        lock.lock();
 #endif
     }
 
@@ -0,0 +1,96 @@
+#include <boost/test/unit_test.hpp>
+
+#include "crypto/chacha20poly1305.h"
+#include "crypto/poly1305.h"
+#include "utilstrencodings.h"
+
+#include <string.h>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(chacha20poly1305_tests)
+
+// RFC 7539 section 2.5.2 Poly1305 test vector
+BOOST_AUTO_TEST_CASE(poly1305_rfc7539)
+{
+    std::vector<unsigned char> key = ParseHex("85d6be7857556d337f4452fe42d506a80103808afb0db2fd4abff6af4149f51b");
+    std::vector<unsigned char> want = ParseHex("a8061dc1305136c6c22b8baf0c0127a9");
+    const std::string msg = "Cryptographic Forum Research Group";
+
+    unsigned char tag[Poly1305::TAGLEN];
+    Poly1305().SetKey(key.data()).Write((const unsigned char*)msg.data(), msg.size()).Finalize(tag);
+    BOOST_CHECK(memcmp(tag, want.data(), Poly1305::TAGLEN) == 0);
+
+    // the streaming interface must match regardless of write granularity
+    Poly1305 poly;
+    poly.SetKey(key.data());
+    for (size_t i = 0; i < msg.size(); i++)
+        poly.Write((const unsigned char*)msg.data() + i, 1);
+    poly.Finalize(tag);
+    BOOST_CHECK(memcmp(tag, want.data(), Poly1305::TAGLEN) == 0);
+}
+
+// Seal/Open round trip, across sizes spanning the vectorized keystream path
+BOOST_AUTO_TEST_CASE(aead_roundtrip)
+{
+    unsigned char key[32];
+    for (int i = 0; i < 32; i++)
+        key[i] = i * 7 + 1;
+    unsigned char aad[4] = {0xe8, 0x03, 0x00, 0x00};
+
+    const size_t sizes[] = {0, 1, 63, 64, 65, 1000, 4096, 100000};
+    uint64_t nSeq = 0;
+    for (size_t nSize : sizes) {
+        std::vector<unsigned char> msg(nSize);
+        for (size_t i = 0; i < nSize; i++)
+            msg[i] = (unsigned char)(i * 13);
+        std::vector<unsigned char> orig = msg;
+
+        ChaCha20Poly1305 enc, dec;
+        enc.SetKey(key, 32);
+        dec.SetKey(key, 32);
+        unsigned char tag[ChaCha20Poly1305::TAGLEN];
+        enc.Seal(nSeq, aad, sizeof(aad), msg.data(), msg.size(), tag);
+        if (nSize > 0)
+            BOOST_CHECK(msg != orig);
+        BOOST_CHECK(dec.Open(nSeq, aad, sizeof(aad), msg.data(), msg.size(), tag));
+        BOOST_CHECK(msg == orig);
+        nSeq++;
+    }
+}
+
+// A wrong sequence number, tampered ciphertext, tampered associated data or
+// tampered tag must all be rejected, leaving the buffer untouched
+BOOST_AUTO_TEST_CASE(aead_reject)
+{
+    unsigned char key[32];
+    for (int i = 0; i < 32; i++)
+        key[i] = i * 11 + 3;
+    unsigned char aad[4] = {1, 2, 3, 4};
+
+    std::vector<unsigned char> msg(500, 0x42);
+    ChaCha20Poly1305 enc, dec;
+    enc.SetKey(key, 32);
+    dec.SetKey(key, 32);
+    unsigned char tag[ChaCha20Poly1305::TAGLEN];
+    enc.Seal(7, aad, sizeof(aad), msg.data(), msg.size(), tag);
+    std::vector<unsigned char> ct = msg;
+
+    BOOST_CHECK(!dec.Open(8, aad, sizeof(aad), msg.data(), msg.size(), tag));
+    BOOST_CHECK(msg == ct);
+
+    msg[100] ^= 1;
+    BOOST_CHECK(!dec.Open(7, aad, sizeof(aad), msg.data(), msg.size(), tag));
+    msg = ct;
+
+    unsigned char aadBad[4] = {1, 2, 3, 5};
+    BOOST_CHECK(!dec.Open(7, aadBad, sizeof(aadBad), msg.data(), msg.size(), tag));
+
+    tag[0] ^= 1;
+    BOOST_CHECK(!dec.Open(7, aad, sizeof(aad), msg.data(), msg.size(), tag));
+    tag[0] ^= 1;
+
+    // and the untampered frame still opens
+    BOOST_CHECK(dec.Open(7, aad, sizeof(aad), msg.data(), msg.size(), tag));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,92 @@
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+#include "limitedlrumap.h"
+#include "random.h"
+#include "util.h"
+
+#include <map>
+
+#define NUM_TESTS 16
+#define MAX_SIZE 100
+
+// Unsalted on purpose: tests want reproducible probe collisions
+struct identity_hasher
+{
+    size_t operator()(const int& n) const { return (size_t)n; }
+};
+
+BOOST_AUTO_TEST_SUITE(limitedlrumap_tests)
+
+// Test that a limitedlrumap behaves like a map, as long as no more than max_size elements are in it
+BOOST_AUTO_TEST_CASE(limitedlrumap_like_map)
+{
+    for (int nTest = 0; nTest < NUM_TESTS; nTest++)
+    {
+        limitedlrumap<int, int, identity_hasher> lru(MAX_SIZE);
+        std::map<int, int> model;
+        while (model.size() < MAX_SIZE)
+        {
+            int n = GetRandInt(2 * MAX_SIZE);
+            lru.insert(std::make_pair(n, nTest));
+            model.insert(std::make_pair(n, nTest));
+            if (n % 3 == 0)
+            {
+                lru.erase(n);
+                model.erase(n);
+            }
+            BOOST_CHECK(lru.size() == model.size());
+            for (std::map<int, int>::iterator it = model.begin(); it != model.end(); ++it)
+            {
+                BOOST_CHECK(lru.count(it->first) == 1);
+                BOOST_CHECK(lru.find(it->first)->second == it->second);
+            }
+        }
+    }
+}
+
+// Test that a limitedlrumap's size never exceeds its max_size
+BOOST_AUTO_TEST_CASE(limitedlrumap_limited_size)
+{
+    for (int nTest = 0; nTest < NUM_TESTS; nTest++)
+    {
+        limitedlrumap<int, int, identity_hasher> lru(MAX_SIZE);
+        for (int nAction = 0; nAction < 3 * MAX_SIZE; nAction++)
+        {
+            lru.insert(std::make_pair(GetRandInt(2 * MAX_SIZE), nAction));
+            BOOST_CHECK(lru.size() <= MAX_SIZE);
+        }
+        lru.max_size(MAX_SIZE / 2);
+        BOOST_CHECK(lru.size() <= MAX_SIZE / 2);
+    }
+}
+
+// Test that eviction removes the least recently inserted/updated entry
+BOOST_AUTO_TEST_CASE(limitedlrumap_evicts_lru)
+{
+    limitedlrumap<int, int, identity_hasher> lru(4);
+    for (int n = 1; n <= 4; n++)
+        lru.insert(std::make_pair(n, n * 10));
+
+    // Touch 1 so 2 becomes the eviction candidate
+    lru.update(lru.find(1), 11);
+    lru.insert(std::make_pair(5, 50));
+    BOOST_CHECK(lru.find(2) == lru.end());
+    BOOST_CHECK(lru.find(1) != lru.end() && lru.find(1)->second == 11);
+
+    // Inserting an existing key keeps its value, like std::map::insert
+    lru.insert(std::make_pair(1, 99));
+    BOOST_CHECK(lru.find(1)->second == 11);
+
+    // Continued churn always evicts the oldest untouched key
+    for (int n = 6; n < 1000; n++)
+    {
+        lru.insert(std::make_pair(n, n));
+        BOOST_CHECK(lru.size() == 4);
+        BOOST_CHECK(lru.count(n) == 1);
+        BOOST_CHECK(lru.count(n - 4) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
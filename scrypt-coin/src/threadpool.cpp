@@ -0,0 +1,155 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "threadpool.h"
+
+#include "util.h"
+
+std::unique_ptr<CThreadPool> g_threadPool;
+
+CThreadPool::CThreadPool() : nTasksQueued(0), fRunning(false), fInterrupted(false)
+{
+    for (int cls = 0; cls < NUM_SCHED_CLASSES; cls++)
+        nMaxDepth[cls] = 0;
+}
+
+CThreadPool::~CThreadPool()
+{
+    Stop();
+}
+
+void CThreadPool::Start(int nThreads)
+{
+    assert(nThreads > 0);
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        assert(vThreads.empty());
+        vLocalQueues.resize(nThreads);
+        fRunning = true;
+    }
+    LogPrintf("Starting %d thread pool workers\n", nThreads);
+    for (int i = 0; i < nThreads; i++)
+        vThreads.emplace_back(&CThreadPool::WorkerLoop, this, (size_t)i);
+}
+
+void CThreadPool::Interrupt()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    fInterrupted = true;
+    cond.notify_all();
+}
+
+void CThreadPool::Stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        if (!fRunning)
+            return;
+        fInterrupted = true;
+        // Let already queued tasks finish; callers that queued work expect
+        // it to run (or to have been rejected at Submit time).
+        while (nTasksQueued > 0)
+            condEmpty.wait(lock);
+        fRunning = false;
+        cond.notify_all();
+    }
+    for (std::thread& thread : vThreads)
+        thread.join();
+    vThreads.clear();
+    vLocalQueues.clear();
+}
+
+bool CThreadPool::IsRunning() const
+{
+    std::unique_lock<std::mutex> lock(cs);
+    return fRunning && !fInterrupted;
+}
+
+void CThreadPool::SetMaxQueueDepth(SchedClass cls, size_t nDepth)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    nMaxDepth[cls] = nDepth;
+}
+
+//! Index of the calling worker within its pool, or -1 off-pool. Used to
+//! route nested submissions to the submitter's local deque.
+static thread_local int t_nWorkerIndex = -1;
+
+bool CThreadPool::Submit(SchedClass cls, std::function<void(void)> task)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    if (!fRunning || fInterrupted)
+        return false;
+    if (nMaxDepth[cls] != 0 && vClassQueues[cls].size() >= nMaxDepth[cls])
+        return false;
+    if (t_nWorkerIndex >= 0 && (size_t)t_nWorkerIndex < vLocalQueues.size())
+        vLocalQueues[t_nWorkerIndex].push_back(std::move(task));
+    else
+        vClassQueues[cls].push_back(std::move(task));
+    nTasksQueued++;
+    cond.notify_one();
+    return true;
+}
+
+size_t CThreadPool::GetQueueDepth(SchedClass cls) const
+{
+    std::unique_lock<std::mutex> lock(cs);
+    return vClassQueues[cls].size();
+}
+
+int CThreadPool::GetThreadCount() const
+{
+    return vThreads.size();
+}
+
+bool CThreadPool::PopTask(size_t nWorker, std::function<void(void)>& task)
+{
+    // Shared queues first, strictly by class: validation work must never
+    // wait behind lower classes.
+    for (int cls = 0; cls < NUM_SCHED_CLASSES; cls++) {
+        if (!vClassQueues[cls].empty()) {
+            task = std::move(vClassQueues[cls].front());
+            vClassQueues[cls].pop_front();
+            return true;
+        }
+    }
+    // Our own local deque, newest first (cache-warm).
+    if (!vLocalQueues[nWorker].empty()) {
+        task = std::move(vLocalQueues[nWorker].back());
+        vLocalQueues[nWorker].pop_back();
+        return true;
+    }
+    // Steal the oldest task from another worker's deque.
+    for (size_t i = 1; i < vLocalQueues.size(); i++) {
+        size_t nVictim = (nWorker + i) % vLocalQueues.size();
+        if (!vLocalQueues[nVictim].empty()) {
+            task = std::move(vLocalQueues[nVictim].front());
+            vLocalQueues[nVictim].pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void CThreadPool::WorkerLoop(size_t nWorker)
+{
+    RenameThread(strprintf("yacoin-pool.%u", (unsigned int)nWorker).c_str());
+    t_nWorkerIndex = (int)nWorker;
+    std::unique_lock<std::mutex> lock(cs);
+    while (true) {
+        std::function<void(void)> task;
+        if (PopTask(nWorker, task)) {
+            lock.unlock();
+            task();
+            lock.lock();
+            if (--nTasksQueued == 0)
+                condEmpty.notify_all();
+            continue;
+        }
+        if (fInterrupted && !fRunning)
+            break;
+        cond.wait(lock);
+    }
+    t_nWorkerIndex = -1;
+}
@@ -0,0 +1,89 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YACOIN_THREADPOOL_H
+#define YACOIN_THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Shared worker thread pool with strict class priorities.
+ *
+ * Small deployments (4 cores are typical for container hosts) suffer when
+ * every subsystem spawns its own dedicated workers and they all contend for
+ * the same cores. CThreadPool lets task-shaped subsystems share one set of
+ * workers instead: callers submit finite closures tagged with a scheduling
+ * class, and idle workers always drain the most important class first, so
+ * validation work is never stuck behind a queue of bulk RPC requests.
+ *
+ * Workers also keep a local deque for tasks submitted from inside the pool;
+ * other workers steal from the far end of those deques when the shared class
+ * queues are empty, which keeps nested submissions cache-warm on their
+ * producer while still letting idle threads help out.
+ *
+ * Continuous loops (the message handler, script check workers, the stake
+ * miner) are not a fit for this model and keep their dedicated threads.
+ */
+class CThreadPool
+{
+public:
+    //! Scheduling classes, drained strictly in this order.
+    enum SchedClass {
+        SCHED_VALIDATION = 0,
+        SCHED_NET,
+        SCHED_RPC,
+        SCHED_BACKGROUND,
+        NUM_SCHED_CLASSES
+    };
+
+    CThreadPool();
+    ~CThreadPool();
+
+    //! Spawn nThreads workers. May only be called once per pool.
+    void Start(int nThreads);
+    //! Stop accepting new tasks; queued tasks are still drained.
+    void Interrupt();
+    //! Wait for the queues to empty and join all workers.
+    void Stop();
+    bool IsRunning() const;
+
+    //! Cap the number of queued tasks of a class; Submit() fails once the
+    //! cap is reached (0 = unbounded, the default).
+    void SetMaxQueueDepth(SchedClass cls, size_t nDepth);
+
+    //! Queue a task. Returns false if the pool is not running, has been
+    //! interrupted, or the class queue is at its depth cap.
+    bool Submit(SchedClass cls, std::function<void(void)> task);
+
+    size_t GetQueueDepth(SchedClass cls) const;
+    int GetThreadCount() const;
+
+private:
+    void WorkerLoop(size_t nWorker);
+    //! Pick the next task: shared class queues in class order, then the
+    //! worker's own local deque, then steal from another worker.
+    bool PopTask(size_t nWorker, std::function<void(void)>& task);
+
+    mutable std::mutex cs;
+    std::condition_variable cond;
+    std::condition_variable condEmpty;
+    std::deque<std::function<void(void)> > vClassQueues[NUM_SCHED_CLASSES];
+    size_t nMaxDepth[NUM_SCHED_CLASSES];
+    //! One deque per worker for tasks submitted by that worker.
+    std::vector<std::deque<std::function<void(void)> > > vLocalQueues;
+    std::vector<std::thread> vThreads;
+    size_t nTasksQueued;
+    bool fRunning;
+    bool fInterrupted;
+};
+
+//! The node-wide pool, created by init when -threadpool is enabled.
+extern std::unique_ptr<CThreadPool> g_threadPool;
+
+#endif // YACOIN_THREADPOOL_H
@@ -5,6 +5,8 @@
 
 #include "util.h"
 #include "consensus/params.h"
+#include "hash.h"
+#include "random.h"
 //#include <script/ismine.h>
 #include "tinyformat.h"
 #include "tokendb.h"
@@ -12,6 +14,7 @@
 #include "validation.h"
 
 #include <boost/thread.hpp>
+#include <cmath>
 #include <memory>
 
 // Keys of token database
@@ -19,32 +22,225 @@ static const char TOKEN_FLAG = 'A';
 static const char TOKEN_ADDRESS_QUANTITY_FLAG = 'B';
 static const char ADDRESS_TOKEN_QUANTITY_FLAG = 'C';
 static const char MY_TOKEN_FLAG = 'M';
+static const char TOKEN_BALANCE_ORDER_FLAG = 'O';
+static const char TOKEN_BALANCE_ORDER_BUILT = 'P';
 static const char BLOCK_TOKEN_UNDO_DATA = 'U';
 static const char MEMPOOL_REISSUED_TX = 'Z';
 
 static size_t MAX_DATABASE_RESULTS = 50000;
 
-CTokensDB::CTokensDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "tokens", nCacheSize, fMemory, fWipe) {
+//! Target false-positive rate of the token name filter; at 0.1% one miss in
+//! a thousand still pays for a leveldb point read, everything else is free.
+static const double TOKEN_NAME_FILTER_FPRATE = 0.001;
+//! Smallest filter we bother building (elements, not bytes).
+static const size_t TOKEN_NAME_FILTER_MIN_ELEMENTS = 4096;
+
+#define LN2SQUARED 0.4804530139182014246671025263266649717305529515945455
+#define LN2 0.6931471805599453094172321214581765680755001343602552
+
+/** Bloom filter over token names, same double-hashing scheme as
+ *  CBloomFilter. A separate class because CBloomFilter clamps itself to the
+ *  p2p protocol limit of 36,000 bytes, which is far too small to cover a
+ *  whole token namespace at a useful false-positive rate. Sized once for an
+ *  expected element count; inserting beyond that degrades the rate, so
+ *  CTokensDB drops the filter when it overfills rather than serve slow
+ *  maybes. Guarded by cs_main like the rest of the token state. */
+class CTokenNameFilter
+{
+private:
+    std::vector<unsigned char> vData;
+    unsigned int nHashFuncs;
+    unsigned int nTweak;
+    size_t nElementCap;
+
+    unsigned int Hash(unsigned int nHashNum, const std::vector<unsigned char>& vDataToHash) const
+    {
+        // 0xFBA4C795 chosen as in CBloomFilter
+        return MurmurHash3(nHashNum * 0xFBA4C795 + nTweak, vDataToHash) % (vData.size() * 8);
+    }
+
+public:
+    CTokenNameFilter(size_t nElements, double nFPRate) :
+        vData(std::max<size_t>(1, (size_t)(-1 / LN2SQUARED * nElements * log(nFPRate)) / 8)),
+        nHashFuncs((unsigned int)std::max(1.0, vData.size() * 8 / (double)nElements * LN2)),
+        nTweak(GetRand(std::numeric_limits<unsigned int>::max())),
+        nElementCap(nElements)
+    {
+    }
+
+    //! The element count the filter was sized for; past this the
+    //! false-positive rate is no longer honoured.
+    size_t GetElementCap() const { return nElementCap; }
+
+    void insert(const std::string& strName)
+    {
+        std::vector<unsigned char> vKey(strName.begin(), strName.end());
+        for (unsigned int i = 0; i < nHashFuncs; i++)
+            vData[Hash(i, vKey) >> 3] |= (1 << (7 & Hash(i, vKey)));
+    }
+
+    bool contains(const std::string& strName) const
+    {
+        std::vector<unsigned char> vKey(strName.begin(), strName.end());
+        for (unsigned int i = 0; i < nHashFuncs; i++)
+            if (!(vData[Hash(i, vKey) >> 3] & (1 << (7 & Hash(i, vKey)))))
+                return false;
+        return true;
+    }
+
+    size_t GetSerializeSize() const { return vData.size(); }
+};
+
+//! Token lookups are point reads by token name/address and mostly misses for
+//! unknown names, so favour resident bloom filters over file descriptors.
+static CDBOptions TokensDBOptions()
+{
+    CDBOptions dbOptions;
+    dbOptions.nMaxOpenFiles = 256;
+    return dbOptions;
+}
+
+CTokensDB::CTokensDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "tokens", nCacheSize, fMemory, fWipe, false, TokensDBOptions()),
+    nNameFilterEntries(0) {
+}
+
+CTokensDB::~CTokensDB() = default;
+
+void CTokensDB::NameFilterAdd(const std::string& strName)
+{
+    if (!pNameFilter)
+        return;
+    if (++nNameFilterEntries > pNameFilter->GetElementCap()) {
+        // Overfull filters lie; better no fast path than a wrong one
+        LogPrintf("%s: token name filter overfull (%u entries), disabling until restart\n", __func__, nNameFilterEntries);
+        pNameFilter.reset();
+        return;
+    }
+    pNameFilter->insert(strName);
+}
+
+bool CTokensDB::NameFilterMayContain(const std::string& strName) const
+{
+    return !pNameFilter || pNameFilter->contains(strName);
+}
+
+/** Amount wrapper serialized as the bitwise complement in big-endian, so that
+ *  leveldb's lexicographic key order walks balances from largest to smallest.
+ *  Fixed width, unlike the varint CAmount encoding, so the following address
+ *  never influences the ordering. */
+struct CInvertedAmount {
+    CAmount amount;
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        uint64_t v = ~(uint64_t)amount;
+        for (int i = 7; i >= 0; i--)
+            ser_writedata8(s, (v >> (8 * i)) & 0xff);
+    }
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; i++)
+            v = (v << 8) | ser_readdata8(s);
+        amount = (CAmount)~v;
+    }
+};
+
+static std::pair<char, std::pair<std::string, std::pair<CInvertedAmount, std::string> > > BalanceOrderKey(const std::string& tokenName, const CAmount& quantity, const std::string& address)
+{
+    CInvertedAmount inv;
+    inv.amount = quantity;
+    return std::make_pair(TOKEN_BALANCE_ORDER_FLAG, std::make_pair(tokenName, std::make_pair(inv, address)));
+}
+
+void CTokensDB::StartBatch()
+{
+    // A leftover batch here means an earlier flush bailed out without
+    // AbortBatch; its writes were never committed, so just drop them
+    pActiveBatch.reset(new CDBBatch(*this));
+}
+
+bool CTokensDB::CommitBatch()
+{
+    if (!pActiveBatch)
+        return error("%s: no batch in progress", __func__);
+    bool ret = WriteBatch(*pActiveBatch);
+    pActiveBatch.reset();
+    return ret;
+}
+
+void CTokensDB::AbortBatch()
+{
+    pActiveBatch.reset();
 }
 
 bool CTokensDB::WriteTokenData(const CNewToken &token, const int nHeight, const uint256& blockHash)
 {
     CDatabasedTokenData data(token, nHeight, blockHash);
+    // Even if the batch is later aborted the filter only over-approximates,
+    // which costs one extra database read, never a wrong negative
+    NameFilterAdd(token.strName);
+    if (pActiveBatch) {
+        pActiveBatch->Write(std::make_pair(TOKEN_FLAG, token.strName), data);
+        return true;
+    }
     return Write(std::make_pair(TOKEN_FLAG, token.strName), data);
 }
 
+// Keep the (token, balance-ordered) secondary index in step with a holder
+// write or erase. The previous balance comes from a point read of the
+// database, which does not see writes queued in an open batch; that is safe
+// because the cache flush only ever rewrites a holder with its coalesced
+// final amount, so a repeated update within one batch is idempotent.
+void CTokensDB::UpdateBalanceOrderIndex(const std::string& tokenName, const std::string& address, const CAmount& quantity, bool fWrite)
+{
+    CAmount quantityOld;
+    if (ReadTokenAddressQuantity(tokenName, address, quantityOld) && (!fWrite || quantityOld != quantity)) {
+        auto keyOld = BalanceOrderKey(tokenName, quantityOld, address);
+        if (pActiveBatch)
+            pActiveBatch->Erase(keyOld);
+        else
+            Erase(keyOld);
+    }
+    if (fWrite) {
+        auto keyNew = BalanceOrderKey(tokenName, quantity, address);
+        if (pActiveBatch)
+            pActiveBatch->Write(keyNew, quantity);
+        else
+            Write(keyNew, quantity);
+    }
+}
+
 bool CTokensDB::WriteTokenAddressQuantity(const std::string &tokenName, const std::string &address, const CAmount &quantity)
 {
+    // Must run before the primary key below is overwritten; it reads the
+    // previous balance to locate the old index entry
+    UpdateBalanceOrderIndex(tokenName, address, quantity, true);
+    if (pActiveBatch) {
+        pActiveBatch->Write(std::make_pair(TOKEN_ADDRESS_QUANTITY_FLAG, std::make_pair(tokenName, address)), quantity);
+        return true;
+    }
     return Write(std::make_pair(TOKEN_ADDRESS_QUANTITY_FLAG, std::make_pair(tokenName, address)), quantity);
 }
 
 bool CTokensDB::WriteAddressTokenQuantity(const std::string &address, const std::string &tokenName, const CAmount& quantity) {
+    if (pActiveBatch) {
+        pActiveBatch->Write(std::make_pair(ADDRESS_TOKEN_QUANTITY_FLAG, std::make_pair(address, tokenName)), quantity);
+        return true;
+    }
     return Write(std::make_pair(ADDRESS_TOKEN_QUANTITY_FLAG, std::make_pair(address, tokenName)), quantity);
 }
 
 bool CTokensDB::ReadTokenData(const std::string& strName, CNewToken& token, int& nHeight, uint256& blockHash)
 {
 
+    // The common case during script validation is a name that has never
+    // been a token; answer those from the filter without touching leveldb
+    if (!NameFilterMayContain(strName))
+        return false;
+
     CDatabasedTokenData data;
     bool ret =  Read(std::make_pair(TOKEN_FLAG, strName), data);
 
@@ -68,19 +264,41 @@ bool CTokensDB::ReadAddressTokenQuantity(const std::string &address, const std::
 
 bool CTokensDB::EraseTokenData(const std::string& tokenName)
 {
+    // Deliberately no filter update: names are never removed from the
+    // filter, so after a reorg erases a token the filter keeps answering
+    // "maybe" and the lookup falls through to the database, which is
+    // correct just not fast. The stale bits are reclaimed on restart when
+    // LoadTokens rebuilds the filter from the surviving keys.
+    if (pActiveBatch) {
+        pActiveBatch->Erase(std::make_pair(TOKEN_FLAG, tokenName));
+        return true;
+    }
     return Erase(std::make_pair(TOKEN_FLAG, tokenName));
 }
 
 bool CTokensDB::EraseTokenAddressQuantity(const std::string &tokenName, const std::string &address) {
+    UpdateBalanceOrderIndex(tokenName, address, 0, false);
+    if (pActiveBatch) {
+        pActiveBatch->Erase(std::make_pair(TOKEN_ADDRESS_QUANTITY_FLAG, std::make_pair(tokenName, address)));
+        return true;
+    }
     return Erase(std::make_pair(TOKEN_ADDRESS_QUANTITY_FLAG, std::make_pair(tokenName, address)));
 }
 
 bool CTokensDB::EraseAddressTokenQuantity(const std::string &address, const std::string &tokenName) {
+    if (pActiveBatch) {
+        pActiveBatch->Erase(std::make_pair(ADDRESS_TOKEN_QUANTITY_FLAG, std::make_pair(address, tokenName)));
+        return true;
+    }
     return Erase(std::make_pair(ADDRESS_TOKEN_QUANTITY_FLAG, std::make_pair(address, tokenName)));
 }
 
 bool CTokensDB::WriteBlockUndoTokenData(const uint256& blockhash, const std::vector<std::pair<std::string, CBlockTokenUndo> >& tokenUndoData)
 {
+    if (pActiveBatch) {
+        pActiveBatch->Write(std::make_pair(BLOCK_TOKEN_UNDO_DATA, blockhash), tokenUndoData);
+        return true;
+    }
     return Write(std::make_pair(BLOCK_TOKEN_UNDO_DATA, blockhash), tokenUndoData);
 }
 
@@ -114,9 +332,35 @@ bool CTokensDB::ReadReissuedMempoolState()
 
 bool CTokensDB::LoadTokens()
 {
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    // First pass: keys only (no value decode), to build the name filter
+    // over the full namespace. The value pass below stops at half the LRU
+    // cache, but the filter must cover everything to give safe negatives.
+    {
+        std::vector<std::string> vNames;
+        std::unique_ptr<CDBIterator> pkeyiter(NewIterator());
+        pkeyiter->Seek(std::make_pair(TOKEN_FLAG, std::string()));
+        while (pkeyiter->Valid()) {
+            boost::this_thread::interruption_point();
+            std::pair<char, std::string> key;
+            if (!pkeyiter->GetKey(key) || key.first != TOKEN_FLAG)
+                break;
+            vNames.push_back(key.second);
+            pkeyiter->Next();
+        }
 
-    pcursor->Seek(std::make_pair(TOKEN_FLAG, std::string()));
+        size_t nElements = std::max(TOKEN_NAME_FILTER_MIN_ELEMENTS, vNames.size() * 2);
+        pNameFilter.reset(new CTokenNameFilter(nElements, TOKEN_NAME_FILTER_FPRATE));
+        nNameFilterEntries = vNames.size();
+        for (const std::string& strName : vNames)
+            pNameFilter->insert(strName);
+        LogPrintf("%s: token name filter covers %u names (%u bytes)\n", __func__,
+                  vNames.size(), pNameFilter->GetSerializeSize());
+    }
+
+    std::unique_ptr<CDBIterator> piter(NewIterator());
+    piter->Seek(std::make_pair(TOKEN_FLAG, std::string()));
+    // Bulk scan: decode entries ahead on a background thread
+    std::unique_ptr<CDBPrefetchIterator> pcursor(new CDBPrefetchIterator(piter.release()));
 
     // Load tokens
     while (pcursor->Valid()) {
@@ -142,8 +386,9 @@ bool CTokensDB::LoadTokens()
 
 
     if (fTokenIndex) {
-        std::unique_ptr<CDBIterator> pcursor3(NewIterator());
-        pcursor3->Seek(std::make_pair(TOKEN_ADDRESS_QUANTITY_FLAG, std::make_pair(std::string(), std::string())));
+        std::unique_ptr<CDBIterator> piter3(NewIterator());
+        piter3->Seek(std::make_pair(TOKEN_ADDRESS_QUANTITY_FLAG, std::make_pair(std::string(), std::string())));
+        std::unique_ptr<CDBPrefetchIterator> pcursor3(new CDBPrefetchIterator(piter3.release()));
 
         // Load mapTokenAddressAmount
         while (pcursor3->Valid()) {
@@ -166,6 +411,80 @@ bool CTokensDB::LoadTokens()
         }
     }
 
+    if (fTokenIndex && !EnsureBalanceOrderIndex())
+        return error("%s: failed to build token balance-order index", __func__);
+
+    return true;
+}
+
+// One-time migration for databases created before the balance-ordered index
+// existed: replay every (token, address) -> quantity entry into the index,
+// then set a marker so subsequent loads skip the scan.
+bool CTokensDB::EnsureBalanceOrderIndex()
+{
+    bool fBuilt = false;
+    if (Read(TOKEN_BALANCE_ORDER_BUILT, fBuilt) && fBuilt)
+        return true;
+
+    LogPrintf("%s: building token balance-order index...\n", __func__);
+    size_t nEntries = 0;
+    CDBBatch batch(*this);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(TOKEN_ADDRESS_QUANTITY_FLAG, std::make_pair(std::string(), std::string())));
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, std::pair<std::string, std::string> > key;
+        if (!pcursor->GetKey(key) || key.first != TOKEN_ADDRESS_QUANTITY_FLAG)
+            break;
+        CAmount quantity;
+        if (!pcursor->GetValue(quantity))
+            return error("%s: failed to read holder quantity from database", __func__);
+        batch.Write(BalanceOrderKey(key.second.first, quantity, key.second.second), quantity);
+        nEntries++;
+        if (batch.SizeEstimate() > (4 << 20)) {
+            if (!WriteBatch(batch))
+                return error("%s: failed to write index batch", __func__);
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+    batch.Write(TOKEN_BALANCE_ORDER_BUILT, true);
+    if (!WriteBatch(batch))
+        return error("%s: failed to write index batch", __func__);
+    LogPrintf("%s: token balance-order index built (%u holders)\n", __func__, nEntries);
+    return true;
+}
+
+// Walk holders of tokenName from the largest balance downwards. The cursor
+// names the last entry of the previous page ((amount, address) pair); pass
+// fHaveCursor=false for the first page. Returns at most count entries, never
+// materializing more than one page in memory.
+bool CTokensDB::TokenHoldersByBalance(std::vector<std::pair<std::string, CAmount> >& vecAddressAmount, const std::string& tokenName, const size_t count, const bool fHaveCursor, const CAmount& cursorAmount, const std::string& cursorAddress)
+{
+    FlushStateToDisk();
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    if (fHaveCursor)
+        pcursor->Seek(BalanceOrderKey(tokenName, cursorAmount, cursorAddress));
+    else
+        pcursor->Seek(std::make_pair(TOKEN_BALANCE_ORDER_FLAG, tokenName));
+
+    std::pair<char, std::pair<std::string, std::pair<CInvertedAmount, std::string> > > key;
+
+    // The cursor entry itself was already served on the previous page
+    if (fHaveCursor && pcursor->Valid() && pcursor->GetKey(key) &&
+        key.first == TOKEN_BALANCE_ORDER_FLAG && key.second.first == tokenName &&
+        key.second.second.first.amount == cursorAmount && key.second.second.second == cursorAddress)
+        pcursor->Next();
+
+    while (pcursor->Valid() && vecAddressAmount.size() < count && vecAddressAmount.size() < MAX_DATABASE_RESULTS) {
+        boost::this_thread::interruption_point();
+        if (!pcursor->GetKey(key) || key.first != TOKEN_BALANCE_ORDER_FLAG || key.second.first != tokenName)
+            break;
+        vecAddressAmount.emplace_back(std::make_pair(key.second.second.second, key.second.second.first.amount));
+        pcursor->Next();
+    }
+
     return true;
 }
 
@@ -13,11 +13,13 @@
 
 #include <string>
 #include <map>
+#include <memory>
 
 class CNewToken;
 class uint256;
 class COutPoint;
 class CDatabasedTokenData;
+class CTokenNameFilter;
 
 struct CBlockTokenUndo
 {
@@ -42,10 +44,19 @@ class CTokensDB : public CDBWrapper
 {
 public:
     explicit CTokensDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CTokensDB();
 
     CTokensDB(const CTokensDB&) = delete;
     CTokensDB& operator=(const CTokensDB&) = delete;
 
+    // Batched write mode: between StartBatch and CommitBatch all Write*/
+    // Erase* calls below collect into one CDBBatch that hits leveldb as a
+    // single atomic write. Used by the per-block cache flush so a block's
+    // token mutations land together instead of as many small writes.
+    void StartBatch();
+    bool CommitBatch();
+    void AbortBatch();
+
     // Write to database functions
     bool WriteTokenData(const CNewToken& token, const int nHeight, const uint256& blockHash);
     bool WriteTokenAddressQuantity(const std::string& tokenName, const std::string& address, const CAmount& quantity);
@@ -72,6 +83,30 @@ public:
 
     bool AddressDir(std::vector<std::pair<std::string, CAmount> >& vecTokenAmount, int& totalEntries, const bool& fGetTotal, const std::string& address, const size_t count, const long start);
     bool TokenAddressDir(std::vector<std::pair<std::string, CAmount> >& vecAddressAmount, int& totalEntries, const bool& fGetTotal, const std::string& tokenName, const size_t count, const long start);
+    //! Page through a token's holders from the largest balance downwards,
+    //! using the balance-ordered secondary index. The cursor is the
+    //! (amount, address) of the last entry returned by the previous page.
+    bool TokenHoldersByBalance(std::vector<std::pair<std::string, CAmount> >& vecAddressAmount, const std::string& tokenName, const size_t count, const bool fHaveCursor, const CAmount& cursorAmount, const std::string& cursorAddress);
+
+private:
+    //! collects Write*/Erase* calls while a batch is open; null otherwise
+    std::unique_ptr<CDBBatch> pActiveBatch;
+
+    //! Bloom filter over every token name in the database, built by
+    //! LoadTokens and grown on WriteTokenData. Names are never removed, so
+    //! the filter stays a superset of the database and a negative probe
+    //! proves the token does not exist without touching leveldb; null when
+    //! inactive (not yet loaded, or overfull). See tokendb.cpp.
+    std::unique_ptr<CTokenNameFilter> pNameFilter;
+    size_t nNameFilterEntries;
+
+    void NameFilterAdd(const std::string& strName);
+    bool NameFilterMayContain(const std::string& strName) const;
+
+    //! keep the balance-ordered index in step with a holder write/erase
+    void UpdateBalanceOrderIndex(const std::string& tokenName, const std::string& address, const CAmount& quantity, bool fWrite);
+    //! build the balance-ordered index once for pre-existing databases
+    bool EnsureBalanceOrderIndex();
 };
 
 
@@ -3,7 +3,6 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
-#include "regex"
 #include "clientversion.h"
 #include "streams.h"
 #include "serialize.h"
@@ -26,7 +25,10 @@
 #include "wallet/wallet.h"
 #include "rpc/protocol.h"
 
+#include <atomic>
 #include <iostream>
+#include <thread>
+#include <unordered_map>
 #include <boost/algorithm/string.hpp>
 #include <boost/variant.hpp>
 
@@ -63,51 +65,141 @@ static const CAmount feeLockAmount = 10 * COIN; // 10 YAC
 static const auto MAX_NAME_LENGTH = 31;
 static const auto MAX_CHANNEL_NAME_LENGTH = 12;
 
-// min lengths are expressed by quantifiers
-static const std::regex YATOKEN_NAME_CHARACTERS("^[A-Z0-9._]{3,}$");
-static const std::regex SUB_NAME_CHARACTERS("^[A-Z0-9._]+$");
-static const std::regex UNIQUE_TAG_CHARACTERS("^[-A-Za-z0-9@$%&*()[\\]{}_.?:]+$");
-static const std::regex VOTE_TAG_CHARACTERS("^[A-Z0-9._]+$");
-
-static const std::regex DOUBLE_PUNCTUATION("^.*[._]{2,}.*$");
-static const std::regex LEADING_PUNCTUATION("^[._].*$");
-static const std::regex TRAILING_PUNCTUATION("^.*[._]$");
-
 static const std::string SUB_NAME_DELIMITER = "/";
 static const std::string UNIQUE_TAG_DELIMITER = "#";
 static const std::string VOTE_TAG_DELIMITER = "^";
 
-static const std::regex UNIQUE_INDICATOR(R"(^[^^~#!]+#[^~#!\/]+$)");
-static const std::regex OWNER_INDICATOR(R"(^[^^~#!]+!$)");
-static const std::regex VOTE_INDICATOR(R"(^[^^~#!]+\^[^~#!\/]+$)");
+// The naming rules used to be a pile of regexes ([A-Z0-9._]{3,}, the
+// leading/trailing/doubled punctuation exclusions, the #/!/^ indicator
+// patterns), each run separately per name. They are compiled here by hand
+// into one 256-entry character-class table so every rule is decided in a
+// single left-to-right pass with no regex engine involved.
+enum
+{
+    TOKEN_CHAR_CORE      = 1 << 0, //!< [A-Z0-9._] - yatoken/sub names and vote tags
+    TOKEN_CHAR_UNIQUE    = 1 << 1, //!< [-A-Za-z0-9@$%&*()[]{}_.?:] - unique tags
+    TOKEN_CHAR_PUNCT     = 1 << 2, //!< [._] - may not lead, trail or double up
+    TOKEN_CHAR_INDICATOR = 1 << 3, //!< [^~#!] - delimiters excluded from name bodies
+};
+
+static const struct TokenCharTable
+{
+    uint8_t t[256];
+    TokenCharTable()
+    {
+        memset(t, 0, sizeof(t));
+        for (int c = 'A'; c <= 'Z'; c++) t[c] |= TOKEN_CHAR_CORE | TOKEN_CHAR_UNIQUE;
+        for (int c = 'a'; c <= 'z'; c++) t[c] |= TOKEN_CHAR_UNIQUE;
+        for (int c = '0'; c <= '9'; c++) t[c] |= TOKEN_CHAR_CORE | TOKEN_CHAR_UNIQUE;
+        t[(unsigned char)'.'] |= TOKEN_CHAR_CORE | TOKEN_CHAR_UNIQUE | TOKEN_CHAR_PUNCT;
+        t[(unsigned char)'_'] |= TOKEN_CHAR_CORE | TOKEN_CHAR_UNIQUE | TOKEN_CHAR_PUNCT;
+        for (const char* p = "-@$%&*()[]{}?:"; *p; p++) t[(unsigned char)*p] |= TOKEN_CHAR_UNIQUE;
+        t[(unsigned char)'^'] |= TOKEN_CHAR_INDICATOR;
+        t[(unsigned char)'~'] |= TOKEN_CHAR_INDICATOR;
+        t[(unsigned char)'#'] |= TOKEN_CHAR_INDICATOR;
+        t[(unsigned char)'!'] |= TOKEN_CHAR_INDICATOR;
+    }
+} tokenCharTable;
 
-static const std::regex YACOIN_NAMES("^YAC$|^YACOIN$|^#YAC$|^#YACOIN$");
+static inline uint8_t TokenCharClass(char c)
+{
+    return tokenCharTable.t[(unsigned char)c];
+}
+
+//! [A-Z0-9._] names with the punctuation placement rules, in one pass
+static bool IsCoreNameValid(const std::string& name, size_t nMinLength)
+{
+    if (name.size() < nMinLength)
+        return false;
+    bool fPrevPunct = false;
+    for (size_t i = 0; i < name.size(); i++) {
+        uint8_t cls = TokenCharClass(name[i]);
+        if (!(cls & TOKEN_CHAR_CORE))
+            return false;
+        bool fPunct = (cls & TOKEN_CHAR_PUNCT) != 0;
+        if (fPunct && (i == 0 || fPrevPunct || i == name.size() - 1))
+            return false;
+        fPrevPunct = fPunct;
+    }
+    return true;
+}
+
+//! matches ^[^^~#!]+#[^~#!/]+$ - a name body, '#', then a unique tag
+static bool IsUniqueIndicator(const std::string& name)
+{
+    size_t pos = name.find('#');
+    if (pos == 0 || pos == std::string::npos || pos == name.size() - 1)
+        return false;
+    for (size_t i = 0; i < pos; i++)
+        if (TokenCharClass(name[i]) & TOKEN_CHAR_INDICATOR)
+            return false;
+    for (size_t i = pos + 1; i < name.size(); i++) {
+        char c = name[i];
+        if (c == '~' || c == '#' || c == '!' || c == '/')
+            return false;
+    }
+    return true;
+}
+
+//! matches ^[^^~#!]+!$ - a name body ending in the owner tag
+static bool IsOwnerIndicator(const std::string& name)
+{
+    if (name.size() < 2 || name[name.size() - 1] != '!')
+        return false;
+    for (size_t i = 0; i < name.size() - 1; i++)
+        if (TokenCharClass(name[i]) & TOKEN_CHAR_INDICATOR)
+            return false;
+    return true;
+}
+
+//! matches ^[^^~#!]+\^[^~#!/]+$ - a name body, '^', then a vote tag
+static bool IsVoteIndicator(const std::string& name)
+{
+    size_t pos = name.find('^');
+    if (pos == 0 || pos == std::string::npos || pos == name.size() - 1)
+        return false;
+    for (size_t i = 0; i < pos; i++)
+        if (TokenCharClass(name[i]) & TOKEN_CHAR_INDICATOR)
+            return false;
+    for (size_t i = pos + 1; i < name.size(); i++) {
+        char c = name[i];
+        if (c == '~' || c == '#' || c == '!' || c == '/')
+            return false;
+    }
+    return true;
+}
 
 bool IsYatokenNameValid(const std::string& name)
 {
-    return std::regex_match(name, YATOKEN_NAME_CHARACTERS)
-        && !std::regex_match(name, DOUBLE_PUNCTUATION)
-        && !std::regex_match(name, LEADING_PUNCTUATION)
-        && !std::regex_match(name, TRAILING_PUNCTUATION)
-        && !std::regex_match(name, YACOIN_NAMES);
+    // the reserved #YAC/#YACOIN spellings contain '#' and already fail the
+    // character class, so only the plain names need an explicit exclusion
+    return IsCoreNameValid(name, 3) && name != "YAC" && name != "YACOIN";
 }
 
 bool IsSubNameValid(const std::string& name)
 {
-    return std::regex_match(name, SUB_NAME_CHARACTERS)
-        && !std::regex_match(name, DOUBLE_PUNCTUATION)
-        && !std::regex_match(name, LEADING_PUNCTUATION)
-        && !std::regex_match(name, TRAILING_PUNCTUATION);
+    return IsCoreNameValid(name, 1);
 }
 
 bool IsUniqueTagValid(const std::string& tag)
 {
-    return std::regex_match(tag, UNIQUE_TAG_CHARACTERS);
+    if (tag.empty())
+        return false;
+    for (size_t i = 0; i < tag.size(); i++)
+        if (!(TokenCharClass(tag[i]) & TOKEN_CHAR_UNIQUE))
+            return false;
+    return true;
 }
 
 bool IsVoteTagValid(const std::string& tag)
 {
-    return std::regex_match(tag, VOTE_TAG_CHARACTERS);
+    // character class only; vote tags have no punctuation placement rules
+    if (tag.empty())
+        return false;
+    for (size_t i = 0; i < tag.size(); i++)
+        if (!(TokenCharClass(tag[i]) & TOKEN_CHAR_CORE))
+            return false;
+    return true;
 }
 
 bool IsNameValidBeforeTag(const std::string& name)
@@ -138,6 +230,16 @@ bool IsTokenNameASubtoken(const std::string& name)
     return parts.size() > 1;
 }
 
+/** Verdicts for names already validated this session. Names usually reach
+ *  ConnectBlock after passing through the mempool, so caching the verdict
+ *  means block connect re-validates nothing. Only valid names are cached;
+ *  invalid ones carry per-call error text and never make it into a block. */
+static CCriticalSection cs_tokenNameCache;
+static std::map<std::string, ETokenType> mapTokenNameCache;
+static const size_t MAX_TOKEN_NAME_CACHE = 10000;
+
+static bool IsTokenNameValidUncached(const std::string& name, ETokenType& tokenType, std::string& error);
+
 bool IsTokenNameValid(const std::string& name, ETokenType& tokenType, std::string& error)
 {
     // Do a max length check first to stop the possibility of a stack exhaustion.
@@ -145,8 +247,29 @@ bool IsTokenNameValid(const std::string& name, ETokenType& tokenType, std::strin
     if (name.length() > 40)
         return false;
 
+    {
+        LOCK(cs_tokenNameCache);
+        std::map<std::string, ETokenType>::const_iterator it = mapTokenNameCache.find(name);
+        if (it != mapTokenNameCache.end()) {
+            tokenType = it->second;
+            return true;
+        }
+    }
+
+    bool ret = IsTokenNameValidUncached(name, tokenType, error);
+    if (ret) {
+        LOCK(cs_tokenNameCache);
+        if (mapTokenNameCache.size() >= MAX_TOKEN_NAME_CACHE)
+            mapTokenNameCache.clear();
+        mapTokenNameCache[name] = tokenType;
+    }
+    return ret;
+}
+
+static bool IsTokenNameValidUncached(const std::string& name, ETokenType& tokenType, std::string& error)
+{
     tokenType = ETokenType::INVALID;
-    if (std::regex_match(name, UNIQUE_INDICATOR))
+    if (IsUniqueIndicator(name))
     {
         bool ret = IsTypeCheckNameValid(ETokenType::UNIQUE, name, error);
         if (ret)
@@ -154,7 +277,7 @@ bool IsTokenNameValid(const std::string& name, ETokenType& tokenType, std::strin
 
         return ret;
     }
-    else if (std::regex_match(name, OWNER_INDICATOR))
+    else if (IsOwnerIndicator(name))
     {
         bool ret = IsTypeCheckNameValid(ETokenType::OWNER, name, error);
         if (ret)
@@ -162,7 +285,7 @@ bool IsTokenNameValid(const std::string& name, ETokenType& tokenType, std::strin
 
         return ret;
     }
-    else if (std::regex_match(name, VOTE_INDICATOR))
+    else if (IsVoteIndicator(name))
     {
         bool ret = IsTypeCheckNameValid(ETokenType::VOTE, name, error);
         if (ret)
@@ -202,7 +325,7 @@ bool IsTokenNameAYatoken(const std::string& name)
 
 bool IsTokenNameAnOwner(const std::string& name)
 {
-    return IsTokenNameValid(name) && std::regex_match(name, OWNER_INDICATOR);
+    return IsTokenNameValid(name) && IsOwnerIndicator(name);
 }
 
 // TODO get the string translated below
@@ -240,7 +363,7 @@ bool IsTypeCheckNameValid(const ETokenType type, const std::string& name, std::s
 std::string capitalizeTokenName(const std::string& rawTokenName)
 {
     std::string capitalizeTokenName = rawTokenName;
-    if (std::regex_match(rawTokenName, UNIQUE_INDICATOR))
+    if (IsUniqueIndicator(rawTokenName))
     {
         std::vector<std::string> parts;
         boost::split(parts, rawTokenName, boost::is_any_of(UNIQUE_TAG_DELIMITER));
@@ -1396,12 +1519,37 @@ bool CTokensCache::RemoveTransfer(const CTokenTransfer &transfer, const std::str
     return true;
 }
 
+namespace {
+
+//! Opens a token database batch and aborts it again unless Commit() is
+//! reached, so the many early error returns in DumpCacheToDatabase can't
+//! leave half a block's mutations pending in the database object.
+struct CTokenDBBatchGuard
+{
+    bool fCommitted;
+
+    CTokenDBBatchGuard() : fCommitted(false) { ptokensdb->StartBatch(); }
+    ~CTokenDBBatchGuard() { if (!fCommitted) ptokensdb->AbortBatch(); }
+
+    bool Commit()
+    {
+        fCommitted = true;
+        return ptokensdb->CommitBatch();
+    }
+};
+
+}
+
 bool CTokensCache::DumpCacheToDatabase()
 {
     try {
         bool dirty = false;
         std::string message;
 
+        // Collect every mutation below into one batch; nothing reaches
+        // leveldb until the atomic commit at the end
+        CTokenDBBatchGuard batch;
+
         // Remove new tokens from the database
         for (auto newToken : setNewTokensToRemove) {
             ptokensCache->Erase(newToken.token.strName);
@@ -1725,6 +1873,10 @@ bool CTokensCache::DumpCacheToDatabase()
             }
         }
 
+        if (!batch.Commit()) {
+            return error("%s : %s", __func__, "_Failed Committing token batch to database");
+        }
+
         ClearDirtyCache();
 
         return true;
@@ -3279,3 +3431,315 @@ std::string GetUserErrorString(const ErrorReport& report)
             return _("Error not set");
     }
 }
+
+/**
+ * Parallel token database rebuild (-reindextokens).
+ *
+ * Replaying every block through the regular connect path rebuilds token state
+ * serially, although the state of each token name is independent of every
+ * other apart from the coins they spend. The rebuild therefore runs in two
+ * passes: a scan pass that reads block ranges on all cores and extracts each
+ * block's token operations, and a fold pass that replays the per-name
+ * operation streams concurrently. A single-threaded merge between the two
+ * joins spends against the outputs they consume, and the folded end state
+ * lands in the database as one batched atomic write.
+ */
+
+namespace {
+
+//! One token-bearing output discovered by the scan pass
+struct CTokenScanOutput
+{
+    txnouttype type;
+    bool fOwner;
+    std::string strName;
+    std::string strAddress;
+    CAmount nAmount;
+    CNewToken token;        //!< filled for issue outputs
+    CReissueToken reissue;  //!< filled for reissue outputs
+};
+
+//! A spend or a token output, in the order the connect path would see them
+struct CTokenScanEvent
+{
+    bool fSpend;
+    COutPoint out;           //!< the prevout spent, or the outpoint created
+    CTokenScanOutput output; //!< valid when !fSpend
+};
+
+struct CTokenScanBlock
+{
+    std::vector<CTokenScanEvent> vEvents;
+};
+
+//! One step of a per-name fold stream: a credit pointing at the scanned
+//! output (which also carries issue/reissue metadata), or a debit produced
+//! by joining a spend against the output it consumed.
+struct CTokenFoldStep
+{
+    const CTokenScanOutput* pCredit; //!< null for debits
+    int nHeight;
+    std::string strAddress;          //!< debit only
+    CAmount nDebit;                  //!< debit only
+};
+
+//! Folded end state of one token name
+struct CTokenFoldState
+{
+    bool fHaveMeta;
+    CNewToken meta;
+    int nMetaHeight;
+    std::map<std::string, CAmount> mapBalances;
+    //! (height, undo) produced by reissues that changed units or IPFS
+    std::vector<std::pair<int, CBlockTokenUndo> > vUndo;
+
+    CTokenFoldState() : fHaveMeta(false), nMetaHeight(0) {}
+};
+
+//! Scan worker: extract the token events of blocks [nFrom, nTo)
+void TokenScanRange(int nFrom, int nTo, std::vector<CTokenScanBlock>* pBlocks, std::atomic<bool>* pfFailed)
+{
+    for (int nHeight = nFrom; nHeight < nTo && !pfFailed->load(); nHeight++) {
+        CBlockIndex* pindex = chainActive[nHeight];
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            pfFailed->store(true);
+            return;
+        }
+        std::vector<CTokenScanEvent>& vEvents = (*pBlocks)[nHeight].vEvents;
+        for (const CTransaction& tx : block.vtx) {
+            const uint256 txid = tx.GetHash();
+            // Inputs first, as the connect path spends them before it
+            // creates the transaction's own outputs
+            if (!tx.IsCoinBase()) {
+                for (const CTxIn& txin : tx.vin) {
+                    CTokenScanEvent ev;
+                    ev.fSpend = true;
+                    ev.out = txin.prevout;
+                    vEvents.push_back(std::move(ev));
+                }
+            }
+            for (unsigned int i = 0; i < tx.vout.size(); i++) {
+                const CScript& script = tx.vout[i].scriptPubKey;
+                int nType = 0;
+                bool fIsOwner = false;
+                if (!script.IsTokenScript(nType, fIsOwner))
+                    continue;
+                CTokenScanEvent ev;
+                ev.fSpend = false;
+                ev.out = COutPoint(txid, i);
+                CTokenScanOutput& out = ev.output;
+                out.type = txnouttype(nType);
+                out.fOwner = fIsOwner;
+                if (out.type == TX_NEW_TOKEN && !fIsOwner) {
+                    if (!TokenFromScript(script, out.token, out.strAddress))
+                        continue;
+                    out.strName = out.token.strName;
+                    out.nAmount = out.token.nAmount;
+                } else if (out.type == TX_NEW_TOKEN && fIsOwner) {
+                    if (!OwnerTokenFromScript(script, out.strName, out.strAddress))
+                        continue;
+                    out.nAmount = OWNER_TOKEN_AMOUNT;
+                } else if (out.type == TX_REISSUE_TOKEN) {
+                    if (!ReissueTokenFromScript(script, out.reissue, out.strAddress))
+                        continue;
+                    out.strName = out.reissue.strName;
+                    out.nAmount = out.reissue.nAmount;
+                } else if (out.type == TX_TRANSFER_TOKEN) {
+                    CTokenTransfer transfer;
+                    if (!TransferTokenFromScript(script, transfer, out.strAddress))
+                        continue;
+                    out.strName = transfer.strName;
+                    out.nAmount = transfer.nAmount;
+                } else {
+                    continue;
+                }
+                vEvents.push_back(std::move(ev));
+            }
+        }
+    }
+}
+
+//! Fold worker: pull name streams off the shared counter and replay each one
+void TokenFoldWorker(const std::vector<std::pair<std::string, std::vector<CTokenFoldStep> > >* pStreams,
+                     std::vector<CTokenFoldState>* pStates, std::atomic<size_t>* pnNext)
+{
+    while (true) {
+        const size_t n = pnNext->fetch_add(1);
+        if (n >= pStreams->size())
+            return;
+        CTokenFoldState& state = (*pStates)[n];
+        for (const CTokenFoldStep& step : (*pStreams)[n].second) {
+            if (!step.pCredit) {
+                state.mapBalances[step.strAddress] -= step.nDebit;
+                continue;
+            }
+            const CTokenScanOutput& credit = *step.pCredit;
+            if (credit.type == TX_NEW_TOKEN && !credit.fOwner) {
+                state.meta = credit.token;
+                state.fHaveMeta = true;
+                state.nMetaHeight = step.nHeight;
+            } else if (credit.type == TX_REISSUE_TOKEN && state.fHaveMeta) {
+                // Mirror CTokensCache::AddReissueToken, recording what the
+                // disconnect path would need to restore
+                CBlockTokenUndo undo;
+                undo.fChangedIPFS = false;
+                undo.fChangedUnits = false;
+                undo.strIPFS = state.meta.strIPFSHash;
+                undo.nUnits = state.meta.units;
+                state.meta.nAmount += credit.reissue.nAmount;
+                state.meta.nReissuable = credit.reissue.nReissuable;
+                if (credit.reissue.nUnits != -1 && credit.reissue.nUnits != undo.nUnits) {
+                    state.meta.units = credit.reissue.nUnits;
+                    undo.fChangedUnits = true;
+                }
+                if (credit.reissue.strIPFSHash != "" && credit.reissue.strIPFSHash != undo.strIPFS) {
+                    state.meta.nHasIPFS = 1;
+                    state.meta.strIPFSHash = credit.reissue.strIPFSHash;
+                    undo.fChangedIPFS = true;
+                }
+                if (undo.fChangedUnits || undo.fChangedIPFS)
+                    state.vUndo.push_back(std::make_pair(step.nHeight, undo));
+            }
+            state.mapBalances[credit.strAddress] += credit.nAmount;
+        }
+    }
+}
+
+} // anonymous namespace
+
+bool ReindexTokenDatabase(std::string& strError)
+{
+    AssertLockHeld(cs_main);
+
+    const int64_t nStart = GetTimeMillis();
+    const int nChainHeight = chainActive.Height();
+    if (nChainHeight < 0)
+        return true;
+
+    int nThreads = GetNumCores();
+    if (nThreads < 1)
+        nThreads = 1;
+
+    // Pass 1: scan contiguous block ranges in parallel. Contiguous ranges
+    // keep each worker inside a run of block files.
+    std::vector<CTokenScanBlock> vScanned(nChainHeight + 1);
+    {
+        std::atomic<bool> fFailed(false);
+        std::vector<std::thread> vWorkers;
+        const int nPerThread = (nChainHeight / nThreads) + 1;
+        for (int t = 0; t < nThreads; t++) {
+            const int nFrom = t * nPerThread;
+            const int nTo = std::min(nFrom + nPerThread, nChainHeight + 1);
+            if (nFrom >= nTo)
+                break;
+            vWorkers.push_back(std::thread(TokenScanRange, nFrom, nTo, &vScanned, &fFailed));
+        }
+        for (std::thread& worker : vWorkers)
+            worker.join();
+        if (fFailed) {
+            strError = "failed to read a block from disk";
+            return false;
+        }
+    }
+
+    // Merge: join every spend against the token output it consumes and split
+    // the joined operations into per-name streams, in chain order. Spends of
+    // non-token outputs miss the live-output map and drop out here.
+    std::unordered_map<COutPoint, const CTokenScanOutput*, SaltedOutpointHasher> mapLiveOutputs;
+    std::unordered_map<std::string, size_t> mapStreamIndex;
+    std::vector<std::pair<std::string, std::vector<CTokenFoldStep> > > vStreams;
+    size_t nOperations = 0;
+    for (int nHeight = 0; nHeight <= nChainHeight; nHeight++) {
+        for (const CTokenScanEvent& ev : vScanned[nHeight].vEvents) {
+            if (ev.fSpend) {
+                std::unordered_map<COutPoint, const CTokenScanOutput*, SaltedOutpointHasher>::iterator it = mapLiveOutputs.find(ev.out);
+                if (it == mapLiveOutputs.end())
+                    continue;
+                const CTokenScanOutput* pSpent = it->second;
+                std::pair<std::unordered_map<std::string, size_t>::iterator, bool> ins =
+                    mapStreamIndex.insert(std::make_pair(pSpent->strName, vStreams.size()));
+                if (ins.second)
+                    vStreams.push_back(std::make_pair(pSpent->strName, std::vector<CTokenFoldStep>()));
+                CTokenFoldStep step;
+                step.pCredit = nullptr;
+                step.nHeight = nHeight;
+                step.strAddress = pSpent->strAddress;
+                step.nDebit = pSpent->nAmount;
+                vStreams[ins.first->second].second.push_back(std::move(step));
+                mapLiveOutputs.erase(it);
+                nOperations++;
+            } else {
+                std::pair<std::unordered_map<std::string, size_t>::iterator, bool> ins =
+                    mapStreamIndex.insert(std::make_pair(ev.output.strName, vStreams.size()));
+                if (ins.second)
+                    vStreams.push_back(std::make_pair(ev.output.strName, std::vector<CTokenFoldStep>()));
+                CTokenFoldStep step;
+                step.pCredit = &ev.output;
+                step.nHeight = nHeight;
+                step.nDebit = 0;
+                vStreams[ins.first->second].second.push_back(std::move(step));
+                mapLiveOutputs[ev.out] = &ev.output;
+                nOperations++;
+            }
+        }
+    }
+
+    // Pass 2: fold the per-name streams in parallel. Streams vary wildly in
+    // length, so the workers share a counter instead of fixed ranges.
+    std::vector<CTokenFoldState> vStates(vStreams.size());
+    {
+        std::atomic<size_t> nNext(0);
+        std::vector<std::thread> vWorkers;
+        for (int t = 0; t < nThreads; t++)
+            vWorkers.push_back(std::thread(TokenFoldWorker, &vStreams, &vStates, &nNext));
+        for (std::thread& worker : vWorkers)
+            worker.join();
+    }
+
+    // Land the folded state as one atomic batch: metadata, balances (only
+    // with -tokenindex, like the regular flush) and per-block reissue undo.
+    ptokensdb->StartBatch();
+    std::map<int, std::vector<std::pair<std::string, CBlockTokenUndo> > > mapUndoByHeight;
+    for (size_t n = 0; n < vStreams.size(); n++) {
+        const std::string& strName = vStreams[n].first;
+        const CTokenFoldState& state = vStates[n];
+        if (state.fHaveMeta) {
+            if (!ptokensdb->WriteTokenData(state.meta, state.nMetaHeight, chainActive[state.nMetaHeight]->GetBlockHash())) {
+                ptokensdb->AbortBatch();
+                strError = "failed to write token data for " + strName;
+                return false;
+            }
+        }
+        for (const std::pair<int, CBlockTokenUndo>& undo : state.vUndo)
+            mapUndoByHeight[undo.first].push_back(std::make_pair(strName, undo.second));
+        if (fTokenIndex) {
+            for (const std::pair<const std::string, CAmount>& balance : state.mapBalances) {
+                if (balance.second <= 0)
+                    continue;
+                if (!ptokensdb->WriteTokenAddressQuantity(strName, balance.first, balance.second) ||
+                    !ptokensdb->WriteAddressTokenQuantity(balance.first, strName, balance.second)) {
+                    ptokensdb->AbortBatch();
+                    strError = "failed to write address balance for " + strName;
+                    return false;
+                }
+            }
+        }
+    }
+    for (const auto& undoHeight : mapUndoByHeight) {
+        if (!ptokensdb->WriteBlockUndoTokenData(chainActive[undoHeight.first]->GetBlockHash(), undoHeight.second)) {
+            ptokensdb->AbortBatch();
+            strError = "failed to write block token undo data";
+            return false;
+        }
+    }
+    if (!ptokensdb->CommitBatch()) {
+        strError = "failed to commit the rebuilt token state";
+        return false;
+    }
+
+    LogPrintf("%s: rebuilt %u tokens from %u operations over %d blocks with %d threads in %dms\n",
+              __func__, vStreams.size(), nOperations, nChainHeight + 1, nThreads,
+              GetTimeMillis() - nStart);
+    return true;
+}
@@ -395,6 +395,13 @@ bool ParseTokenScript(CScript scriptPubKey, uint160 &hashBytes, std::string &tok
 bool CheckNewToken(const CNewToken& token, std::string& strError);
 bool CheckReissueToken(const CReissueToken& token, std::string& strError);
 
+/** Rebuild the entire token database from the active chain (-reindextokens).
+ *  Runs a parallel scan pass extracting each block's token operations, then
+ *  folds the per-name operation streams in parallel and lands the result as
+ *  one batched database write. Requires cs_main; the database should have
+ *  been wiped beforehand. */
+bool ReindexTokenDatabase(std::string& strError);
+
 //// Contextual Check functions
 bool ContextualCheckNewToken(CTokensCache* tokenCache, const CNewToken& token, std::string& strError, bool fCheckMempool = false);
 bool ContextualCheckTransferToken(CTokensCache* tokenCache, const CTokenTransfer& transfer, const std::string& address, std::string& strError);
@@ -0,0 +1,47 @@
+// Copyright (c) 2026 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YACOIN_TRACE_H
+#define YACOIN_TRACE_H
+
+#if defined(HAVE_CONFIG_H)
+#include "config/scrypt-config.h"
+#endif
+
+/** User-space statically defined tracepoints (USDT).
+ *
+ * Each TRACEn() expands to a single nop until a tracer (bpftrace,
+ * systemtap, perf) attaches a probe to it, so hot paths can carry them in
+ * production builds without the formatting cost of BCLog categories.
+ * Enabled with --enable-usdt (requires sys/sdt.h); otherwise the macros
+ * compile to nothing.
+ *
+ * Example:
+ *   bpftrace -e 'usdt:./scryptd:validation:connect_block_end { ... }'
+ */
+#if ENABLE_TRACING
+
+#include <sys/sdt.h>
+
+#define TRACE(context, event) DTRACE_PROBE(context, event)
+#define TRACE1(context, event, a) DTRACE_PROBE1(context, event, a)
+#define TRACE2(context, event, a, b) DTRACE_PROBE2(context, event, a, b)
+#define TRACE3(context, event, a, b, c) DTRACE_PROBE3(context, event, a, b, c)
+#define TRACE4(context, event, a, b, c, d) DTRACE_PROBE4(context, event, a, b, c, d)
+#define TRACE5(context, event, a, b, c, d, e) DTRACE_PROBE5(context, event, a, b, c, d, e)
+#define TRACE6(context, event, a, b, c, d, e, f) DTRACE_PROBE6(context, event, a, b, c, d, e, f)
+
+#else
+
+#define TRACE(context, event)
+#define TRACE1(context, event, a)
+#define TRACE2(context, event, a, b)
+#define TRACE3(context, event, a, b, c)
+#define TRACE4(context, event, a, b, c, d)
+#define TRACE5(context, event, a, b, c, d, e)
+#define TRACE6(context, event, a, b, c, d, e, f)
+
+#endif
+
+#endif // YACOIN_TRACE_H
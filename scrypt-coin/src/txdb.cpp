@@ -48,14 +48,21 @@ using std::vector;
 static const char DB_BLOCK_FILES = 'f'; // File information record. Keeps track of the files storing the raw block data (blk????.dat), their sizes, and other related metadata
 static const char DB_BLOCK_INDEX = 'b'; // Block index record. Stores metadata about blocks, such as block headers, height, and status
 static const char DB_TXINDEX = 't';     // Transaction index record. Stores transaction information to enable fast lookups of transactions by their IDs
+static const char DB_TXINDEX_BEST = 'T';    // Resume marker of a background -txindex build: last block indexed so far
 static const char DB_FLAG = 'F';        // Currently defined flags include: 'txindex': Whether the transaction index is enabled.
 static const char DB_REINDEX_FLAG = 'R';    // whether we're in the process of reindexing.
+static const char DB_VERIFY_CHECKPOINT = 'V';   // Watermark left by a clean -checkblocks verification run
 static const char DB_LAST_BLOCK = 'l';      // The last block file number used
 static const char DB_ADDRESSINDEX = 'a';
+static const char DB_ADDRESSBALANCE = 'A';  // Materialized per-(address, token) balance rollup
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_SPENTINDEX = 'p';  // (txid, vout) -> (spending txid, input index, height)
+static const char DB_CFILTER = 'g';     // Encoded BIP158 basic filter per block hash
+static const char DB_CFHEADER = 'G';    // BIP157 filter header chain per block hash
 
 // Keys of UTXO set database (chainstate/*)
 static const char DB_COIN = 'C';        // UTXO record
+static const char DB_COINS = 'c';       // Legacy per-transaction UTXO record, upgraded on startup
 static const char DB_BEST_BLOCK = 'B';  // Primarily used to ensures the UTXO set is consistently persisted with the blockchain state
                                         // Tracks the latest block to which the UTXO set is flushed
                                         // Ensures the UTXO set's state corresponds to a specific block in the chain.
@@ -90,7 +97,18 @@ struct CoinEntry {
 
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true)
+//! Chainstate access is point lookups keyed by outpoint, and the common case
+//! for a new output is a miss, so keep many table handles open: each cached
+//! handle keeps its bloom filter resident and answers the miss without
+//! touching the SSTable.
+static CDBOptions CoinsViewDBOptions()
+{
+    CDBOptions dbOptions;
+    dbOptions.nMaxOpenFiles = 1000;
+    return dbOptions;
+}
+
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true, CoinsViewDBOptions())
 {
 }
 
@@ -98,6 +116,28 @@ bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
     return db.Read(CoinEntry(&outpoint), coin);
 }
 
+void CCoinsViewDB::GetCoins(std::vector<COutPoint> &vOutpoints, std::vector<std::pair<COutPoint, Coin> > &vCoins) const {
+    // Serialized CoinEntry keys order as (hash bytes, VARINT(n)), and both
+    // uint256's comparison and the MSB-base-128 VARINT encoding preserve
+    // that order, so sorting the outpoints themselves visits the keys in
+    // database order: one iterator sweeps forward through the SSTables
+    // instead of issuing a random point read per outpoint.
+    std::sort(vOutpoints.begin(), vOutpoints.end());
+    std::unique_ptr<CDBIterator> pcursor(const_cast<CDBWrapper&>(db).NewIterator());
+    for (const COutPoint& outpoint : vOutpoints) {
+        pcursor->Seek(CoinEntry(&outpoint));
+        if (!pcursor->Valid())
+            break; // past the last coin; the remaining outpoints sort later still
+        COutPoint key;
+        CoinEntry entry(&key);
+        if (!pcursor->GetKey(entry) || entry.key != DB_COIN || !(key == outpoint))
+            continue;
+        Coin coin;
+        if (pcursor->GetValue(coin))
+            vCoins.push_back(std::make_pair(outpoint, std::move(coin)));
+    }
+}
+
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
     return db.Exists(CoinEntry(&outpoint));
 }
@@ -117,7 +157,7 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
     return vhashHeadBlocks;
 }
 
-bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fFinalWrite) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
@@ -127,10 +167,12 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
 
     uint256 old_tip = GetBestBlock();
     if (old_tip.IsNull()) {
-        // We may be in the middle of replaying.
+        // We may be in the middle of replaying, or an incremental flush
+        // sequence left the database mid-transition. The tip may have
+        // advanced since the transition marker was written; extending the
+        // replay range upwards is fine, it stays bounded below by old_tip.
         std::vector<uint256> old_heads = GetHeadBlocks();
         if (old_heads.size() == 2) {
-            assert(old_heads[0] == hashBlock);
             old_tip = old_heads[1];
         }
     }
@@ -168,11 +210,13 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
         }
     }
 
-    // In the last batch, mark the database as consistent with hashBlock again.
-    batch.Erase(DB_HEAD_BLOCKS);
-    batch.Write(DB_BEST_BLOCK, hashBlock);
+    if (fFinalWrite) {
+        // In the last batch, mark the database as consistent with hashBlock again.
+        batch.Erase(DB_HEAD_BLOCKS);
+        batch.Write(DB_BEST_BLOCK, hashBlock);
+    }
 
-    LogPrint(BCLog::COINDB, "Writing final batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
+    LogPrint(BCLog::COINDB, "Writing %s batch of %.2f MiB\n", fFinalWrite ? "final" : "partial", batch.SizeEstimate() * (1.0 / 1048576.0));
     bool ret = db.WriteBatch(batch);
     LogPrint(BCLog::COINDB, "Committed %u changed transaction outputs (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
     return ret;
@@ -186,7 +230,16 @@ size_t CCoinsViewDB::EstimateSize() const
 
 CCoinsViewCursor *CCoinsViewDB::Cursor() const
 {
-    CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(db).NewIterator(), GetBestBlock());
+    // Pin a snapshot and read the best block from it, so the reported best
+    // block and the iterated coins always describe the same database state
+    // even if the cache flushes while the cursor is walked. This is what
+    // lets the full-set consumers (dumputxosnapshot, the getutxosethash
+    // seed scan) iterate without holding cs_main.
+    std::unique_ptr<CDBSnapshot> snapshot(db.GetSnapshot());
+    uint256 hashBestBlock;
+    db.Read(DB_BEST_BLOCK, hashBestBlock, *snapshot);
+    CDBIterator *piter = const_cast<CDBWrapper&>(db).NewIterator(*snapshot);
+    CCoinsViewDBCursor *i = new CCoinsViewDBCursor(std::move(snapshot), piter, hashBestBlock);
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
@@ -250,7 +303,14 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
         batch.Write(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
     }
-    return WriteBatch(batch, true);
+    if (!WriteBatch(batch, true))
+        return false;
+    // The records are durable now, so their cold fields may be dropped
+    // from the side store and reloaded from here on demand
+    for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
+        (*it)->ColdDataWritten();
+    }
+    return true;
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -284,6 +344,22 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
     return WriteBatch(batch);
 }
 
+bool CBlockTreeDB::WriteTxIndexBuildProgress(const std::vector<std::pair<uint256, CDiskTxPos> >&vect, const uint256 &hashBestBlock) {
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<uint256,CDiskTxPos> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+        batch.Write(std::make_pair(DB_TXINDEX, it->first), it->second);
+    batch.Write(DB_TXINDEX_BEST, hashBestBlock);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadTxIndexBestBlock(uint256 &hashBlock) {
+    return Read(DB_TXINDEX_BEST, hashBlock);
+}
+
+bool CBlockTreeDB::EraseTxIndexBestBlock() {
+    return Erase(DB_TXINDEX_BEST);
+}
+
 bool CBlockTreeDB::ContainsTx(uint256 hash) // old API
 {
     return Exists(std::make_pair(DB_TXINDEX, hash));
@@ -362,6 +438,49 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
 }
 
 
+bool CBlockTreeDB::WriteBlockFilter(const uint256 &hashBlock, const uint256 &header, const std::vector<unsigned char> &filter) {
+    CDBBatch batch(*this);
+    batch.Write(std::make_pair(DB_CFILTER, hashBlock), filter);
+    batch.Write(std::make_pair(DB_CFHEADER, hashBlock), header);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadBlockFilter(const uint256 &hashBlock, std::vector<unsigned char> &filter) {
+    return Read(std::make_pair(DB_CFILTER, hashBlock), filter);
+}
+
+bool CBlockTreeDB::ReadBlockFilterHeader(const uint256 &hashBlock, uint256 &header) {
+    return Read(std::make_pair(DB_CFHEADER, hashBlock), header);
+}
+
+bool CBlockTreeDB::EraseBlockFilter(const uint256 &hashBlock) {
+    CDBBatch batch(*this);
+    batch.Erase(std::make_pair(DB_CFILTER, hashBlock));
+    batch.Erase(std::make_pair(DB_CFHEADER, hashBlock));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value) {
+    return Read(std::make_pair(DB_SPENTINDEX, key), value);
+}
+
+bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
+    bool result = true;
+    for (std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        if (it->second.IsNull()) {
+            result = Erase(std::make_pair(DB_SPENTINDEX, it->first));
+        } else {
+            result = Write(std::make_pair(DB_SPENTINDEX, it->first), it->second);
+        }
+
+        if (!result)
+        {
+            break;
+        }
+    }
+    return result;
+}
+
 bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     bool result = true;
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
@@ -389,9 +508,73 @@ bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKe
     return result;
 }
 
+bool CBlockTreeDB::UpdateAddressBalanceIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, bool fUndo) {
+    // Aggregate the deltas per (type, address, token) first; blocks routinely
+    // touch the same address several times and the read-modify-write below is
+    // the expensive part. pair = (balance delta, received delta)
+    std::map<CAddressBalanceKey, std::pair<CAmount, CAmount> > mapDeltas;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+    {
+        CAddressBalanceKey key(it->first.type, it->first.hashBytes, it->first.token);
+        std::pair<CAmount, CAmount>& delta = mapDeltas[key];
+        CAmount nValue = fUndo ? -it->second : it->second;
+        delta.first += nValue;
+        if (it->second > 0)
+            delta.second += nValue;
+    }
+
+    CDBBatch batch(*this);
+    for (std::map<CAddressBalanceKey, std::pair<CAmount, CAmount> >::const_iterator it=mapDeltas.begin(); it!=mapDeltas.end(); it++)
+    {
+        CAddressBalanceValue value;
+        Read(std::make_pair(DB_ADDRESSBALANCE, it->first), value);
+        value.balance += it->second.first;
+        value.received += it->second.second;
+        if (value.balance == 0 && value.received == 0)
+            batch.Erase(std::make_pair(DB_ADDRESSBALANCE, it->first));
+        else
+            batch.Write(std::make_pair(DB_ADDRESSBALANCE, it->first), value);
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressBalance(uint160 addressHash, int type, const std::string &tokenName, CAddressBalanceValue &value) {
+    // An absent record is a zero balance, not an error
+    if (!Read(std::make_pair(DB_ADDRESSBALANCE, CAddressBalanceKey(type, addressHash, tokenName)), value))
+        value.SetNull();
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressBalances(uint160 addressHash, int type,
+                                       std::vector<std::pair<std::string, CAddressBalanceValue> > &balances) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressBalanceKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSBALANCE && key.second.hashBytes == addressHash
+                && key.second.type == (unsigned int)type) {
+            CAddressBalanceValue value;
+            if (pcursor->GetValue(value)) {
+                balances.push_back(std::make_pair(key.second.token, value));
+                pcursor->Next();
+            } else {
+                return error("failed to get address balance value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
 bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type, std::string tokenName,
                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
+                                    int start, int end, int nMaxEntries) {
 
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
 
@@ -412,6 +595,11 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type, std::string t
             if (end > 0 && key.second.blockHeight > end) {
                 break;
             }
+            // Paginated callers only need the first page; stop scanning once
+            // it is full instead of materializing the whole history
+            if (nMaxEntries >= 0 && (int)addressIndex.size() >= nMaxEntries) {
+                break;
+            }
             CAmount nValue;
             if (pcursor->GetValue(nValue)) {
                 addressIndex.push_back(std::make_pair(key.second, nValue));
@@ -429,11 +617,25 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type, std::string t
 
 bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
+                                    int start, int end, int nMaxEntries) {
+
+    return CBlockTreeDB::ReadAddressIndex(addressHash, type, "", addressIndex, start, end, nMaxEntries);
+}
 
-    return CBlockTreeDB::ReadAddressIndex(addressHash, type, "", addressIndex, start, end);
+
+bool CBlockTreeDB::WriteVerifyCheckpoint(const uint256 &hashTip, int nLowHeight, int nLevel) {
+    return Write(DB_VERIFY_CHECKPOINT, std::make_pair(hashTip, std::make_pair(nLowHeight, nLevel)));
 }
 
+bool CBlockTreeDB::ReadVerifyCheckpoint(uint256 &hashTip, int &nLowHeight, int &nLevel) {
+    std::pair<uint256, std::pair<int, int> > value;
+    if (!Read(DB_VERIFY_CHECKPOINT, value))
+        return false;
+    hashTip = value.first;
+    nLowHeight = value.second.first;
+    nLevel = value.second.second;
+    return true;
+}
 
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
@@ -447,68 +649,136 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
-{
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+namespace {
 
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+//! Per-worker result of the parallel block index scan: the disk records of
+//! one key range together with their (expensive to compute) block hashes.
+struct CBlockIndexLoadRange {
+    std::vector<std::pair<uint256, CDiskBlockIndex> > vEntries;
+    bool fFailed;
 
-    int newStoredBlock = 0;
-    int alreadyStoredBlock = 0;
+    CBlockIndexLoadRange() : fFailed(false) {}
+};
+
+//! Scan the block index records whose key's first serialized byte falls in
+//! [nBegin, nEnd) into pRange. leveldb orders keys by memcmp, so splitting on
+//! that byte partitions the keyspace; each worker walks its own iterator and
+//! does the block hash computation and PoW check here, off the main thread.
+void LoadBlockIndexRange(CBlockTreeDB* pdb, const Consensus::Params* pConsensusParams,
+                         unsigned int nBegin, unsigned int nEnd, CBlockIndexLoadRange* pRange)
+{
+    std::unique_ptr<CDBIterator> pcursor(pdb->NewIterator());
+
+    uint256 hashBegin;
+    *hashBegin.begin() = (unsigned char)nBegin;
+    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, hashBegin));
 
-    // Load mapBlockIndex
     while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
         std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                uint256 blockHash = diskindex.GetBlockHash(); // the slow poke!
-                CBlockIndex* pindexNew = insertBlockIndex(blockHash);
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-
-                // Specific for YAC
-                pindexNew->nMint = diskindex.nMint;
-                pindexNew->nMoneySupply = diskindex.nMoneySupply;
-                pindexNew->nFlags = diskindex.nFlags;
-                pindexNew->nStakeModifier = diskindex.nStakeModifier;
-                pindexNew->prevoutStake = diskindex.prevoutStake;
-                pindexNew->nStakeTime = diskindex.nStakeTime;
-                pindexNew->hashProofOfStake = diskindex.hashProofOfStake;
-                pindexNew->blockHash = blockHash;
-
-                if (pindexNew->IsProofOfWork() && !CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, consensusParams))
-                    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
-
-                uint256 tmpBlockhash;
-                if (fBlockHashIndex && (diskindex.nStatus & BLOCK_HAVE_DATA) && !ReadBlockHash(diskindex.nFile, diskindex.nDataPos, tmpBlockhash))
-                {
-                    newStoredBlock++;
-                    WriteBlockHash(diskindex);
-                }
-                else
-                {
-                    alreadyStoredBlock++;
-                }
+        if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX)
+            break;
+        if (nEnd < 0x100 && *key.second.begin() >= (unsigned char)nEnd)
+            break;
+        CDiskBlockIndex diskindex;
+        if (!pcursor->GetValue(diskindex)) {
+            error("%s: failed to read value", __func__);
+            pRange->fFailed = true;
+            return;
+        }
 
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
+        uint256 blockHash = diskindex.GetBlockHash(); // the slow poke!
+
+        if (diskindex.IsProofOfWork() && !CheckProofOfWork(blockHash, diskindex.nBits, *pConsensusParams)) {
+            error("%s: CheckProofOfWork failed: %s", __func__, blockHash.ToString());
+            pRange->fFailed = true;
+            return;
+        }
+
+        pRange->vEntries.push_back(std::make_pair(blockHash, diskindex));
+        pcursor->Next();
+    }
+}
+
+}
+
+// Cold-field loader for the side store in chain.cpp: rereads this
+// block's index record and hands back just the lazily-loaded fields.
+static bool LoadColdIndexData(const uint256& hashBlock, CBlockIndexColdData& cold)
+{
+    if (!pblocktree)
+        return false;
+    CDiskBlockIndex diskindex;
+    if (!pblocktree->Read(std::make_pair(DB_BLOCK_INDEX, hashBlock), diskindex))
+        return false;
+    cold = diskindex.cold;
+    return true;
+}
+
+bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+{
+    RegisterColdIndexLoader(LoadColdIndexData);
+    // First pass: scan the index in parallel ranges. The block hash
+    // recomputation and PoW check dominate the load time, and both only
+    // need the disk record, so they run in the workers; same thread budget
+    // as the other hash calculation fan-outs.
+    size_t nThreads = (size_t)std::max(1, nHashCalcThreads);
+    std::vector<CBlockIndexLoadRange> vRanges(nThreads);
+    boost::thread_group workers;
+    for (size_t i = 1; i < nThreads; i++) {
+        unsigned int nBegin = (unsigned int)((i * 0x100) / nThreads);
+        unsigned int nEnd = (unsigned int)(((i + 1) * 0x100) / nThreads);
+        workers.create_thread(boost::bind(&LoadBlockIndexRange, this, &consensusParams, nBegin, nEnd, &vRanges[i]));
+    }
+    LoadBlockIndexRange(this, &consensusParams, 0, (unsigned int)(0x100 / nThreads), &vRanges[0]);
+    workers.join_all();
+
+    int newStoredBlock = 0;
+    int alreadyStoredBlock = 0;
+
+    // Second pass: merge into mapBlockIndex and wire up pprev. This has to
+    // stay serial (BlockMap insertion is not thread safe), but it is cheap
+    // next to the hashing above.
+    for (size_t i = 0; i < vRanges.size(); i++) {
+        if (vRanges[i].fFailed)
+            return error("%s: failed to load block index range %u", __func__, (unsigned int)i);
+        for (const std::pair<uint256, CDiskBlockIndex>& entry : vRanges[i].vEntries) {
+            boost::this_thread::interruption_point();
+            const uint256& blockHash = entry.first;
+            const CDiskBlockIndex& diskindex = entry.second;
+
+            // Construct block index object
+            CBlockIndex* pindexNew = insertBlockIndex(blockHash);
+            pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nTx            = diskindex.nTx;
+
+            // Specific for YAC
+            pindexNew->nFlags = diskindex.nFlags;
+            pindexNew->nStakeModifier = diskindex.nStakeModifier;
+            // The cold fields (nMint, nMoneySupply, stake proof data) are
+            // deliberately NOT copied into the in-memory entry: they stay
+            // on disk and load lazily through the cold-field store
+            pindexNew->blockHash = blockHash;
+
+            uint256 tmpBlockhash;
+            if (fBlockHashIndex && (diskindex.nStatus & BLOCK_HAVE_DATA) && !ReadBlockHash(diskindex.nFile, diskindex.nDataPos, tmpBlockhash))
+            {
+                newStoredBlock++;
+                WriteBlockHash(diskindex);
+            }
+            else
+            {
+                alreadyStoredBlock++;
             }
-        } else {
-            break;
         }
     }
 
@@ -537,8 +807,14 @@ public:
     //! at which height this transaction was included in the active block chain
     int nHeight;
 
+    // ppcoin: transaction timestamp
+    int64_t nTime;
+
+    // ppcoin: whether transaction is a coinstake
+    bool fCoinStake;
+
     //! empty constructor
-    CCoins() : fCoinBase(false), vout(0), nHeight(0) { }
+    CCoins() : fCoinBase(false), vout(0), nHeight(0), nTime(0), fCoinStake(false) { }
 
     template<typename Stream>
     void Unserialize(Stream &s) {
@@ -572,11 +848,88 @@ public:
         }
         // coinbase height
         ::Unserialize(s, VARINT(nHeight));
+        // ppcoin transaction timestamp; same tail as the per-txout Coin format
+        ::Unserialize(s, VARINT(nTime));
+        // Not support PoS block since Heliospolis hardfork
+        if (nHeight < Params().GetConsensus().HeliopolisHardforkHeight) {
+            // ppcoin flags
+            unsigned int nFlag = 0;
+            ::Unserialize(s, VARINT(nFlag));
+            fCoinStake = nFlag & 1;
+        } else {
+            fCoinStake = false;
+        }
     }
 };
 
 }
 
+bool CCoinsViewDB::Upgrade() {
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(std::make_pair(DB_COINS, uint256()));
+    if (!pcursor->Valid()) {
+        return true;
+    }
+
+    int64_t count = 0;
+    LogPrintf("Upgrading utxo-set database...\n");
+    LogPrintf("[0%%]...");
+    uiInterface.ShowProgress(_("Upgrading UTXO database"), 0);
+    size_t batch_size = 1 << 24;
+    CDBBatch batch(db);
+    int reportDone = 0;
+    std::pair<unsigned char, uint256> key;
+    std::pair<unsigned char, uint256> prev_key = std::make_pair((unsigned char)DB_COINS, uint256());
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        if (ShutdownRequested()) {
+            break;
+        }
+        if (pcursor->GetKey(key) && key.first == DB_COINS) {
+            if (count++ % 256 == 0) {
+                uint32_t high = 0x100 * *key.second.begin() + *(key.second.begin() + 1);
+                int percentageDone = (int)(high * 100.0 / 65536.0 + 0.5);
+                uiInterface.ShowProgress(_("Upgrading UTXO database"), percentageDone);
+                if (reportDone < percentageDone/10) {
+                    // report max. every 10% step
+                    LogPrintf("[%d%%]...", percentageDone);
+                    reportDone = percentageDone/10;
+                }
+            }
+            CCoins old_coins;
+            if (!pcursor->GetValue(old_coins)) {
+                return error("%s: cannot parse CCoins record", __func__);
+            }
+            COutPoint outpoint(key.second, 0);
+            for (size_t i = 0; i < old_coins.vout.size(); ++i) {
+                if (!old_coins.vout[i].IsNull() && !old_coins.vout[i].scriptPubKey.IsUnspendable()) {
+                    Coin newcoin(std::move(old_coins.vout[i]), old_coins.nHeight, old_coins.fCoinBase, old_coins.fCoinStake, old_coins.nTime);
+                    outpoint.n = i;
+                    CoinEntry entry(&outpoint);
+                    batch.Write(entry, newcoin);
+                }
+            }
+            batch.Erase(key);
+            if (batch.SizeEstimate() > batch_size) {
+                db.WriteBatch(batch);
+                batch.Clear();
+                // Compact the written range as we go, so the erased legacy
+                // records don't pile up in the levels until the next
+                // background compaction
+                db.CompactRange(prev_key, key);
+                prev_key = key;
+            }
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+    db.WriteBatch(batch);
+    db.CompactRange(prev_key, key);
+    LogPrintf("[%s].\n", ShutdownRequested() ? "CANCELLED" : "DONE");
+    return !ShutdownRequested();
+}
+
 bool CBlockTreeDB::WriteBlockHash(const CDiskBlockIndex &blockindex)
 {
     return Write(make_pair(string("blockhash"), make_pair(blockindex.nFile, blockindex.nDataPos)), blockindex.GetBlockHash());
@@ -11,6 +11,7 @@
 #include "dbwrapper.h"
 #include "chain.h"
 #include "addressindex.h"
+#include "spentindex.h"
 
 #include <map>
 #include <string>
@@ -76,12 +77,21 @@ public:
     CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    void GetCoins(std::vector<COutPoint> &vOutpoints, std::vector<std::pair<COutPoint, Coin> > &vCoins) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
-    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fFinalWrite = true) override;
     CCoinsViewCursor *Cursor() const override;
 
+    //! Rewrite any legacy per-transaction UTXO records (one record per txid)
+    //! into the per-txout schema. A no-op on an already upgraded database;
+    //! interruptible, and resumes where it left off on the next startup.
+    bool Upgrade();
+
+    //! See CDBWrapper::StartBackupJournal
+    bool StartBackupJournal(const fs::path& pathDir) { return db.StartBackupJournal(pathDir); }
+
     size_t EstimateSize() const override;
 };
 
@@ -99,8 +109,10 @@ public:
     void Next() override;
 
 private:
-    CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256 &hashBlockIn):
-        CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn) {}
+    CCoinsViewDBCursor(std::unique_ptr<CDBSnapshot> psnapshotIn, CDBIterator* pcursorIn, const uint256 &hashBlockIn):
+        CCoinsViewCursor(hashBlockIn), psnapshot(std::move(psnapshotIn)), pcursor(pcursorIn) {}
+    //! the pinned state pcursor iterates; declared first so it outlives it
+    std::unique_ptr<CDBSnapshot> psnapshot;
     std::unique_ptr<CDBIterator> pcursor;
     std::pair<char, COutPoint> keyTmp;
 
@@ -123,19 +135,42 @@ public:
     bool ReadReindexing(bool &fReindex);
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
+    //! Progress of a background -txindex build: the entries and the resume
+    //! marker land in the database as one atomic batch.
+    bool WriteTxIndexBuildProgress(const std::vector<std::pair<uint256, CDiskTxPos> > &list, const uint256 &hashBestBlock);
+    bool ReadTxIndexBestBlock(uint256 &hashBlock);
+    bool EraseTxIndexBestBlock();
     bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
     bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
     bool ReadAddressUnspentIndex(uint160 addressHash, int type,
                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    bool WriteBlockFilter(const uint256 &hashBlock, const uint256 &header, const std::vector<unsigned char> &filter);
+    bool ReadBlockFilter(const uint256 &hashBlock, std::vector<unsigned char> &filter);
+    bool ReadBlockFilterHeader(const uint256 &hashBlock, uint256 &header);
+    bool EraseBlockFilter(const uint256 &hashBlock);
+    bool ReadSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value);
+    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > &vect);
     bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                          int start = 0, int end = 0);
+                          int start = 0, int end = 0, int nMaxEntries = -1);
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                          int start = 0, int end = 0);
+                          int start = 0, int end = 0, int nMaxEntries = -1);
+    //! Apply (or with fUndo, revert) a block's address index deltas to the
+    //! per-(address, token) balance rollups. All of the block's rollup
+    //! updates land in one atomic batch, so a concurrent reader sees either
+    //! the pre-block or post-block balances, never a partial application.
+    bool UpdateAddressBalanceIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, bool fUndo);
+    bool ReadAddressBalance(uint160 addressHash, int type, const std::string &tokenName, CAddressBalanceValue &value);
+    bool ReadAddressBalances(uint160 addressHash, int type,
+                             std::vector<std::pair<std::string, CAddressBalanceValue> > &balances);
+    // Watermark of the last clean -checkblocks run: tip hash, the lowest
+    // verified height and the level the range was checked at.
+    bool WriteVerifyCheckpoint(const uint256 &hashTip, int nLowHeight, int nLevel);
+    bool ReadVerifyCheckpoint(uint256 &hashTip, int &nLowHeight, int &nLevel);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
@@ -9,6 +9,7 @@
 #include "consensus/consensus.h"
 #include "consensus/tx_verify.h"
 #include "consensus/validation.h"
+#include "metrics.h"
 #include "validation.h"
 #include "policy/policy.h"
 #include "policy/fees.h"
@@ -26,7 +27,17 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFe
     spendsCoinbase(_spendsCoinbase), sigOpCost(_sigOpsCost), lockPoints(lp)
 {
     nTxSize = tx->GetTotalSize();
-    nUsageSize = RecursiveDynamicUsage(tx);
+    // Serialize the wire form once at acceptance; getdata serving hands this
+    // same buffer to every requesting peer instead of re-serializing each
+    // time. The encoding depends only on the transaction's own nVersion, so
+    // one buffer is valid for all peers.
+    {
+        CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION);
+        ssTx << *tx;
+        vchTxSerialized = std::make_shared<const std::vector<unsigned char>>(ssTx.begin(), ssTx.end());
+    }
+    nUsageSize = RecursiveDynamicUsage(tx) + memusage::MallocUsage(vchTxSerialized->capacity());
+    nValidationTimeUs = 0;
 
     nCountWithDescendants = 1;
     nSizeWithDescendants = GetTxSize();
@@ -38,6 +49,8 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFe
     nSizeWithAncestors = GetTxSize();
     nModFeesWithAncestors = nFee;
     nSigOpCostWithAncestors = sigOpCost;
+
+    nEpochMarker = 0;
 }
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry& other)
@@ -168,7 +181,11 @@ std::vector<CTxMemPool::indexed_transaction_set::const_iterator> CTxMemPool::Get
     return iters;
 }
 
-CTxMemPool::CTxMemPool() : nTransactionsUpdated(0)
+//! Upper bound on remembered add/remove events; pollers further behind than
+//! this must resynchronize from a full snapshot (~2 MB when full)
+static const size_t MAX_MEMPOOL_CHANGE_LOG = 50000;
+
+CTxMemPool::CTxMemPool() : nTransactionsUpdated(0), nEpoch(0), nSequence(0), nLogBaseSequence(0), nSnapshotSequence(0)
 {
     _clear(); //lock free clear
 
@@ -321,7 +338,7 @@ size_t CTxMemPool::DynamicMemoryUsage() const {
 }
 
 static TxMempoolInfo GetInfo(CTxMemPool::indexed_transaction_set::const_iterator it) {
-    return TxMempoolInfo{it->GetSharedTx(), it->GetTime(), CFeeRate(it->GetFee(), it->GetTxSize()), it->GetModifiedFee() - it->GetFee()};
+    return TxMempoolInfo{it->GetSharedTx(), it->GetTime(), CFeeRate(it->GetFee(), it->GetTxSize()), it->GetModifiedFee() - it->GetFee(), it->GetSharedSerialized()};
 }
 
 std::vector<TxMempoolInfo> CTxMemPool::infoAll() const
@@ -338,11 +355,56 @@ std::vector<TxMempoolInfo> CTxMemPool::infoAll() const
     return ret;
 }
 
-CTransaction CTxMemPool::get(const uint256& hash) const
+std::shared_ptr<const std::vector<TxMempoolInfo> > CTxMemPool::GetSnapshot() const
 {
+    LOCK(cs_snapshot);
     LOCK(cs);
-    indexed_transaction_set::const_iterator i = mapTx.find(hash);
-    return i->GetTx();
+    if (snapshotCache && nSnapshotSequence == nSequence)
+        return snapshotCache;
+
+    // Rebuild under cs so the copy is consistent with the sequence stamp;
+    // readers of the previous snapshot keep their reference undisturbed.
+    auto fresh = std::make_shared<std::vector<TxMempoolInfo> >();
+    auto iters = GetSortedDepthAndScore();
+    fresh->reserve(iters.size());
+    for (auto it : iters) {
+        fresh->push_back(GetInfo(it));
+    }
+    snapshotCache = fresh;
+    nSnapshotSequence = nSequence;
+    return snapshotCache;
+}
+
+CTransaction CTxMemPool::get(const uint256& hash) const
+{
+    CTxLookupShard& shard = LookupShardOf(hash);
+    LOCK(shard.cs);
+    std::unordered_map<uint256, CTransactionRef, SaltedTxidHasher>::const_iterator i = shard.map.find(hash);
+    if (i == shard.map.end())
+        return CTransaction();
+    return *i->second;
+}
+
+void CTxMemPool::AddLookup(const uint256& hash, const CTransactionRef& tx)
+{
+    CTxLookupShard& shard = LookupShardOf(hash);
+    LOCK(shard.cs);
+    shard.map[hash] = tx;
+}
+
+void CTxMemPool::RemoveLookup(const uint256& hash)
+{
+    CTxLookupShard& shard = LookupShardOf(hash);
+    LOCK(shard.cs);
+    shard.map.erase(hash);
+}
+
+void CTxMemPool::ClearLookup()
+{
+    for (size_t i = 0; i < MEMPOOL_LOOKUP_SHARDS; ++i) {
+        LOCK(vLookupShards[i].cs);
+        vLookupShards[i].map.clear();
+    }
 }
 
 TxMempoolInfo CTxMemPool::info(const uint256& hash) const
@@ -354,6 +416,15 @@ TxMempoolInfo CTxMemPool::info(const uint256& hash) const
     return GetInfo(i);
 }
 
+std::shared_ptr<const std::vector<unsigned char>> CTxMemPool::GetSharedSerialized(const uint256& hash) const
+{
+    LOCK(cs);
+    indexed_transaction_set::const_iterator i = mapTx.find(hash);
+    if (i == mapTx.end())
+        return nullptr;
+    return i->GetSharedSerialized();
+}
+
 void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeDelta)
 {
     {
@@ -430,6 +501,17 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
 
     size_t totalSizeWithAncestors = entry.GetTxSize();
 
+    // Mark everything already known (the starting work set and any ancestors
+    // the caller passed in) as visited, so the walk below only touches each
+    // entry once without set lookups.
+    GetFreshEpoch();
+    for (txiter ancestorIt : setAncestors) {
+        visited(ancestorIt);
+    }
+    for (txiter parentIt : parentHashes) {
+        visited(parentIt);
+    }
+
     while (!parentHashes.empty()) {
         txiter stageit = *parentHashes.begin();
 
@@ -451,7 +533,7 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         const setEntries & setMemPoolParents = GetMemPoolParents(stageit);
         for (const txiter &phash : setMemPoolParents) {
             // If this is a new ancestor, add it.
-            if (setAncestors.count(phash) == 0) {
+            if (!visited(phash)) {
                 parentHashes.insert(phash);
             }
             if (parentHashes.size() + setAncestors.size() + 1 > limitAncestorCount) {
@@ -473,12 +555,16 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
 void CTxMemPool::CalculateDescendants(txiter entryit, setEntries &setDescendants)
 {
     setEntries stage;
-    if (setDescendants.count(entryit) == 0) {
+    GetFreshEpoch();
+    for (txiter it : setDescendants) {
+        visited(it);
+    }
+    if (!visited(entryit)) {
         stage.insert(entryit);
     }
-    // Traverse down the children of entry, only adding children that are not
-    // accounted for in setDescendants already (because those children have either
-    // already been walked, or will be walked in this iteration).
+    // Traverse down the children of entry, only adding children that have not
+    // been visited already (because those children have either already been
+    // walked, or will be walked in this iteration).
     while (!stage.empty()) {
         txiter it = *stage.begin();
         setDescendants.insert(it);
@@ -486,7 +572,7 @@ void CTxMemPool::CalculateDescendants(txiter entryit, setEntries &setDescendants
 
         const setEntries &setChildren = GetMemPoolChildren(it);
         for (const txiter &childiter : setChildren) {
-            if (!setDescendants.count(childiter)) {
+            if (!visited(childiter)) {
                 stage.insert(childiter);
             }
         }
@@ -567,13 +653,36 @@ void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPool
     }
 }
 
+void CTxMemPool::TrimToSize(size_t sizelimit) {
+    LOCK(cs);
+
+    unsigned nTxnRemoved = 0;
+    while (!mapTx.empty() && DynamicMemoryUsage() > sizelimit) {
+        // The descendant_score index puts the package with the lowest
+        // fee rate first; evict it with all its descendants
+        indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
+
+        setEntries stage;
+        CalculateDescendants(mapTx.project<0>(it), stage);
+        nTxnRemoved += stage.size();
+        RemoveStaged(stage, false, MemPoolRemovalReason::SIZELIMIT);
+    }
+
+    if (nTxnRemoved > 0)
+        LogPrintf("TrimToSize: removed %u transactions to get back under the size limit\n", nTxnRemoved);
+}
+
 // Update the given tx for any in-mempool descendants.
 // Assumes that setMemPoolChildren is correct for the given tx and all
 // descendants.
 void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendants, const std::set<uint256> &setExclude)
 {
     setEntries stageEntries, setAllDescendants;
+    GetFreshEpoch();
     stageEntries = GetMemPoolChildren(updateIt);
+    for (txiter cit : stageEntries) {
+        visited(cit);
+    }
 
     while (!stageEntries.empty()) {
         const txiter cit = *stageEntries.begin();
@@ -586,9 +695,10 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendan
                 // We've already calculated this one, just add the entries for this set
                 // but don't traverse again.
                 for (const txiter cacheEntry : cacheIt->second) {
+                    visited(cacheEntry);
                     setAllDescendants.insert(cacheEntry);
                 }
-            } else if (!setAllDescendants.count(childEntry)) {
+            } else if (!visited(childEntry)) {
                 // Schedule for later processing
                 stageEntries.insert(childEntry);
             }
@@ -753,10 +863,45 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
 
     nTransactionsUpdated++;
     totalTxSize += entry.GetTxSize();
+    g_metrics.nMempoolTxCount.store((::int64_t)mapTx.size(), std::memory_order_relaxed);
+    g_metrics.nMempoolBytes.store((::int64_t)totalTxSize, std::memory_order_relaxed);
 
     vTxHashes.emplace_back(tx.GetHash(), newit);
     newit->vTxHashesIdx = vTxHashes.size() - 1;
 
+    AddLookup(hash, newit->GetSharedTx());
+    LogChange(hash, false);
+
+    return true;
+}
+
+void CTxMemPool::LogChange(const uint256& txid, bool fRemoved)
+{
+    ++nSequence;
+    changeLog.push_back(CMempoolChange{nSequence, txid, fRemoved});
+    if (changeLog.size() > MAX_MEMPOOL_CHANGE_LOG) {
+        changeLog.pop_front();
+        nLogBaseSequence = changeLog.front().nSequence - 1;
+    }
+}
+
+::uint64_t CTxMemPool::GetSequence() const
+{
+    LOCK(cs);
+    return nSequence;
+}
+
+bool CTxMemPool::GetChangesSince(::uint64_t nSince, std::vector<CMempoolChange>& vChanges, ::uint64_t& nSequenceOut) const
+{
+    LOCK(cs);
+    nSequenceOut = nSequence;
+    if (nSince < nLogBaseSequence)
+        return false;
+    // The log is ordered by sequence; skip straight to the first new event.
+    std::deque<CMempoolChange>::const_iterator it = std::lower_bound(
+        changeLog.begin(), changeLog.end(), nSince + 1,
+        [](const CMempoolChange& change, ::uint64_t nSeq) { return change.nSequence < nSeq; });
+    vChanges.assign(it, changeLog.end());
     return true;
 }
 
@@ -852,6 +997,10 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     mapLinks.erase(it);
     mapTx.erase(it);
     nTransactionsUpdated++;
+    g_metrics.nMempoolTxCount.store((::int64_t)mapTx.size(), std::memory_order_relaxed);
+    g_metrics.nMempoolBytes.store((::int64_t)totalTxSize, std::memory_order_relaxed);
+    RemoveLookup(hash);
+    LogChange(hash, true);
 
     /** YAC_TOKEN START */
     if (AreTokensDeployed()) {
@@ -896,10 +1045,17 @@ void CTxMemPool::removeForBlock(const std::vector<CTransaction>& vtx, ConnectedB
 {
     LOCK(cs);
 
+    // Fee rates of the confirmed transactions we tracked, fed to the fee
+    // estimator below; this is the one place their fees are still known.
+    std::vector<CAmount> vConfirmedFeeRates;
+    vConfirmedFeeRates.reserve(vtx.size());
+
     for (const auto& tx : vtx)
     {
         txiter it = mapTx.find(tx.GetHash());
         if (it != mapTx.end()) {
+            if (it->GetTxSize() > 0)
+                vConfirmedFeeRates.push_back(it->GetFee() * 1000 / it->GetTxSize());
             setEntries stage;
             stage.insert(it);
             RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
@@ -908,6 +1064,8 @@ void CTxMemPool::removeForBlock(const std::vector<CTransaction>& vtx, ConnectedB
         ClearPrioritisation(tx.GetHash());
     }
 
+    feeEstimator.ProcessBlock(vConfirmedFeeRates);
+
     /** YAC_TOKEN START */
     if (AreTokensDeployed()) {
         // Get the newly added assets, and make sure they are in the entries
@@ -939,12 +1097,20 @@ void CTxMemPool::removeForBlock(const std::vector<CTransaction>& vtx, ConnectedB
 
 void CTxMemPool::_clear()
 {
+    ClearLookup();
     mapLinks.clear();
     mapTx.clear();
     mapNextTx.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
+    g_metrics.nMempoolTxCount.store(0, std::memory_order_relaxed);
+    g_metrics.nMempoolBytes.store(0, std::memory_order_relaxed);
     ++nTransactionsUpdated;
+    // A wholesale clear is not representable as individual events; bump the
+    // sequence and truncate the log so pollers fall back to a full resync.
+    ++nSequence;
+    changeLog.clear();
+    nLogBaseSequence = nSequence;
 }
 
 void CTxMemPool::clear()
@@ -968,13 +1134,11 @@ void CTxMemPool::queryHashes(std::vector<uint256>& vtxid)
 
 unsigned int CTxMemPool::GetTransactionsUpdated() const
 {
-    LOCK(cs);
     return nTransactionsUpdated;
 }
 
 void CTxMemPool::AddTransactionsUpdated(unsigned int n)
 {
-    LOCK(cs);
     nTransactionsUpdated += n;
 }
 
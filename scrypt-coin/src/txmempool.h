@@ -7,9 +7,11 @@
 #ifndef YACOIN_TXMEMPOOL_H
 #define YACOIN_TXMEMPOOL_H
 
+#include <deque>
 #include <map>
 #include <vector>
 #include <atomic>
+#include <unordered_map>
 #include <crypto/siphash.h>
 
 //#include "primitives/transaction.h"
@@ -78,6 +80,8 @@ class CTxMemPoolEntry
 {
 private:
     CTransactionRef tx;
+    //!< Wire form, serialized once at acceptance and shared with the net layer
+    std::shared_ptr<const std::vector<unsigned char>> vchTxSerialized;
     CAmount nFee;              //!< Cached to avoid expensive parent-transaction lookups
     size_t nTxSize;            //!< ... and avoid recomputing tx size
     size_t nUsageSize;         //!< ... and total memory usage
@@ -85,6 +89,7 @@ private:
     unsigned int entryHeight;  //!< Chain height when entering the mempool
     bool spendsCoinbase;       //!< keep track of transactions that spend a coinbase
     int64_t sigOpCost;         //!< Total sigop cost
+    int64_t nValidationTimeUs; //!< Measured input/token validation time at acceptance (microseconds)
     int64_t feeDelta;          //!< Used for determining the priority of the transaction for mining in a block
     LockPoints lockPoints;     //!< Track the height and time at which tx was final
 
@@ -110,11 +115,13 @@ public:
 
     const CTransaction& GetTx() const { return *this->tx; }
     CTransactionRef GetSharedTx() const { return this->tx; }
+    const std::shared_ptr<const std::vector<unsigned char>>& GetSharedSerialized() const { return vchTxSerialized; }
     const CAmount& GetFee() const { return nFee; }
     size_t GetTxSize() const;
     int64_t GetTime() const { return nTime; }
     unsigned int GetHeight() const { return entryHeight; }
     int64_t GetSigOpCost() const { return sigOpCost; }
+    int64_t GetValidationTime() const { return nValidationTimeUs; }
     int64_t GetModifiedFee() const { return nFee + feeDelta; }
     size_t DynamicMemoryUsage() const { return nUsageSize; }
     const LockPoints& GetLockPoints() const { return lockPoints; }
@@ -126,6 +133,10 @@ public:
     // Updates the fee delta used for mining priority score, and the
     // modified fees with descendants.
     void UpdateFeeDelta(int64_t feeDelta);
+    // Records the measured validation cost; set by AcceptToMemoryPoolWorker
+    // once the input and token checks have run, before the entry is copied
+    // into the pool.
+    void UpdateValidationTime(int64_t nTimeUs) { nValidationTimeUs = nTimeUs; }
     // Update the LockPoints after a reorg
     void UpdateLockPoints(const LockPoints& lp);
 
@@ -141,6 +152,7 @@ public:
     int64_t GetSigOpCostWithAncestors() const { return nSigOpCostWithAncestors; }
 
     mutable size_t vTxHashesIdx; //!< Index in mempool's vTxHashes
+    mutable uint64_t nEpochMarker; //!< epoch when last touched by a mempool traversal, see CTxMemPool::visited
 };
 
 // Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
@@ -321,6 +333,9 @@ struct TxMempoolInfo
 
     /** The fee delta. */
     int64_t nFeeDelta;
+
+    /** Wire-form serialization cached in the mempool entry. */
+    std::shared_ptr<const std::vector<unsigned char>> vchSerialized;
 };
 
 /** Reason why a transaction was removed from the mempool,
@@ -424,14 +439,36 @@ public:
  * prevent these calculations from being too CPU intensive.
  *
  */
+/** One add/remove event in the bounded mempool change log. */
+struct CMempoolChange
+{
+    ::uint64_t nSequence;
+    uint256 txid;
+    bool fRemoved;
+};
+
 class CTxMemPool
 {
 private:
     uint32_t nCheckFrequency; //!< Value n means that n times in 2^32 we check.
-    unsigned int nTransactionsUpdated; //!< Used by getblocktemplate to trigger CreateNewBlock() invocation
+    std::atomic<unsigned int> nTransactionsUpdated; //!< Used by getblocktemplate to trigger CreateNewBlock() invocation
 //    CBlockPolicyEstimator* minerPolicyEstimator; // TODO: 'fee estimation' feature isn't implemented at the moment
     uint64_t totalTxSize;      //!< sum of all mempool tx's sizes
     uint64_t cachedInnerUsage; //!< sum of dynamic memory usage of all the map elements (NOT the maps themselves)
+    mutable uint64_t nEpoch;   //!< current traversal epoch, bumped by GetFreshEpoch()
+
+    ::uint64_t nSequence;        //!< bumped on every add/remove; lets pollers ask "what changed since?"
+    ::uint64_t nLogBaseSequence; //!< sequence the change log starts after; older queries must resync
+    std::deque<CMempoolChange> changeLog; //!< bounded history of add/remove events, guarded by cs
+
+    //! Record an add/remove event in the change log; caller must hold cs.
+    void LogChange(const uint256& txid, bool fRemoved);
+
+    mutable CCriticalSection cs_snapshot;
+    //! Frozen depth-and-score-ordered view shared by all readers; guarded by cs_snapshot
+    mutable std::shared_ptr<const std::vector<TxMempoolInfo> > snapshotCache;
+    //! Add/remove sequence the cached snapshot reflects; guarded by cs_snapshot
+    mutable ::uint64_t nSnapshotSequence;
 
     // TODO: 'Dynamic minimum fee' feature isn't implemented at the moment
 //    mutable int64_t lastRollingFeeUpdate;
@@ -549,6 +586,23 @@ public:
     bool isSpent(const COutPoint& outpoint);
     unsigned int GetTransactionsUpdated() const;
     void AddTransactionsUpdated(unsigned int n);
+    //! Sequence number of the most recent add/remove (0 before any change).
+    ::uint64_t GetSequence() const;
+    /**
+     * Collect every add/remove event with sequence greater than nSince, in
+     * order, and report the current sequence in nSequenceOut. Returns false
+     * when nSince predates the bounded log (or the pool was cleared since),
+     * in which case the caller must resynchronize from a full snapshot.
+     */
+    bool GetChangesSince(::uint64_t nSince, std::vector<CMempoolChange>& vChanges, ::uint64_t& nSequenceOut) const;
+    /**
+     * Shared immutable snapshot of the pool in depth-and-score order. The
+     * view is stamped with the add/remove sequence and reused by every
+     * caller until the pool next changes, so concurrent readers (BIP35
+     * mempool replies, getrawmempool) iterate one frozen copy instead of
+     * each re-sorting the multi-index under cs.
+     */
+    std::shared_ptr<const std::vector<TxMempoolInfo> > GetSnapshot() const;
     /**
      * Check that none of this transactions inputs are in the mempool, and thus
      * the tx is not dependent on other mempool transactions to be included in a block.
@@ -607,11 +661,10 @@ public:
       */
 //    CFeeRate GetMinFee(size_t sizelimit) const;
 
-    /** Remove transactions from the mempool until its dynamic size is <= sizelimit.
-      *  pvNoSpendsRemaining, if set, will be populated with the list of outpoints
-      *  which are not in mempool which no longer have any spends in this mempool.
+    /** Remove transactions from the mempool until its dynamic size is <= sizelimit,
+      *  evicting the packages with the worst descendant fee rate first.
       */
-//    void TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpendsRemaining=nullptr);
+    void TrimToSize(size_t sizelimit);
 
     /** Expire all transaction (and their dependencies) in the mempool older than time. Return the number of removed transactions. */
 //    int Expire(int64_t time);
@@ -634,12 +687,15 @@ public:
 
     bool exists(uint256 hash) const
     {
-        LOCK(cs);
-        return (mapTx.count(hash) != 0);
+        CTxLookupShard& shard = LookupShardOf(hash);
+        LOCK(shard.cs);
+        return (shard.map.count(hash) != 0);
     }
 
     CTransaction get(const uint256& hash) const;
     TxMempoolInfo info(const uint256& hash) const;
+    /** Wire-form buffer cached in the entry, or null if not in the pool. */
+    std::shared_ptr<const std::vector<unsigned char>> GetSharedSerialized(const uint256& hash) const;
     std::vector<TxMempoolInfo> infoAll() const;
 
     size_t DynamicMemoryUsage() const;
@@ -648,6 +704,46 @@ public:
     boost::signals2::signal<void (CTransactionRef, MemPoolRemovalReason)> NotifyEntryRemoved;
 
 private:
+    //! Number of shards in the read-mostly txid lookup table.
+    static const size_t MEMPOOL_LOOKUP_SHARDS = 16;
+
+    /** One shard of a txid lookup table kept in sync with mapTx. Readers only
+     * take the shard lock, so exists()/get() don't block behind writers
+     * holding cs; writers update the affected shard while holding cs, always
+     * locking cs before the shard lock. */
+    struct CTxLookupShard
+    {
+        mutable CCriticalSection cs;
+        std::unordered_map<uint256, CTransactionRef, SaltedTxidHasher> map;
+    };
+    mutable CTxLookupShard vLookupShards[MEMPOOL_LOOKUP_SHARDS];
+
+    CTxLookupShard& LookupShardOf(const uint256& hash) const
+    {
+        return vLookupShards[hash.Get64() % MEMPOOL_LOOKUP_SHARDS];
+    }
+    void AddLookup(const uint256& hash, const CTransactionRef& tx);
+    void RemoveLookup(const uint256& hash);
+    void ClearLookup();
+
+    /** Start a new traversal of the mempool graph: after this call no entry
+     *  has been visited() yet. Must be called (while holding cs) before a
+     *  sequence of visited() checks. */
+    uint64_t GetFreshEpoch() const { return ++nEpoch; }
+
+    /** Mark an entry as visited for the current epoch and return whether it
+     *  had already been visited since the last GetFreshEpoch(). Replaces
+     *  O(log n) std::set membership tests in ancestor/descendant walks with
+     *  an O(1) check against a marker cached in the entry itself. */
+    bool visited(txiter it) const
+    {
+        bool fSeen = (it->nEpochMarker >= nEpoch);
+        if (!fSeen) {
+            it->nEpochMarker = nEpoch;
+        }
+        return fSeen;
+    }
+
     /** UpdateForDescendants is used by UpdateTransactionsFromBlock to update
      *  the descendants for a single transaction that has been added to the
      *  mempool but may have child transactions in the mempool, eg during a
@@ -114,8 +114,6 @@ enum jtokentype getJsonToken(string& tokenVal, unsigned int& consumed,
     case '8':
     case '9': {
         // part 1: int
-        string numStr;
-
         const char *first = raw;
 
         const char *firstDigit = first;
@@ -124,49 +122,39 @@ enum jtokentype getJsonToken(string& tokenVal, unsigned int& consumed,
         if ((*firstDigit == '0') && json_isdigit(firstDigit[1]))
             return JTOK_ERR;
 
-        numStr += *raw;                       // copy first char
-        raw++;
+        raw++;                                // consume first char
 
         if ((*first == '-') && (!json_isdigit(*raw)))
             return JTOK_ERR;
 
-        while ((*raw) && json_isdigit(*raw)) {     // copy digits
-            numStr += *raw;
+        while ((*raw) && json_isdigit(*raw))       // consume digits
             raw++;
-        }
 
         // part 2: frac
         if (*raw == '.') {
-            numStr += *raw;                   // copy .
-            raw++;
+            raw++;                            // consume .
 
             if (!json_isdigit(*raw))
                 return JTOK_ERR;
-            while ((*raw) && json_isdigit(*raw)) { // copy digits
-                numStr += *raw;
+            while ((*raw) && json_isdigit(*raw))   // consume digits
                 raw++;
-            }
         }
 
         // part 3: exp
         if (*raw == 'e' || *raw == 'E') {
-            numStr += *raw;                   // copy E
-            raw++;
+            raw++;                            // consume E
 
-            if (*raw == '-' || *raw == '+') { // copy +/-
-                numStr += *raw;
+            if (*raw == '-' || *raw == '+')   // consume +/-
                 raw++;
-            }
 
             if (!json_isdigit(*raw))
                 return JTOK_ERR;
-            while ((*raw) && json_isdigit(*raw)) { // copy digits
-                numStr += *raw;
+            while ((*raw) && json_isdigit(*raw))   // consume digits
                 raw++;
-            }
         }
 
-        tokenVal = numStr;
+        // one bulk copy out of the buffer instead of per-character appends
+        tokenVal.assign(first, raw - first);
         consumed = (raw - rawStart);
         return JTOK_NUMBER;
         }
@@ -174,6 +162,21 @@ enum jtokentype getJsonToken(string& tokenVal, unsigned int& consumed,
     case '"': {
         raw++;                                // skip "
 
+        // Fast path: a plain ASCII string with no escapes (the common case -
+        // hex payloads, txids, method names) is copied straight out of the
+        // buffer in one go, skipping the UTF-8 filter's per-character
+        // processing. Fall back at the first escape or non-ASCII byte.
+        const char *fast = raw;
+        while ((unsigned char)*fast >= 0x20 && (unsigned char)*fast < 0x80 &&
+               *fast != '\\' && *fast != '"')
+            fast++;
+        if (*fast == '"') {
+            tokenVal.assign(raw, fast - raw);
+            raw = fast + 1;                   // skip closing "
+            consumed = (raw - rawStart);
+            return JTOK_STRING;
+        }
+
         string valStr;
         JSONUTF8StringFilter writer(valStr);
 
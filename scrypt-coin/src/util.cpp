@@ -73,6 +73,14 @@
 #include <sys/prctl.h>
 #endif
 
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#endif
+
 #ifdef HAVE_MALLOPT_ARENA_MAX
 #include <malloc.h>
 #endif
@@ -196,6 +204,142 @@ static int FileWriteStr(const std::string &str, FILE *fp)
     return fwrite(str.data(), 1, str.size(), fp);
 }
 
+/**
+ * Asynchronous debug.log backend (-logasync).
+ *
+ * Producers enqueue preformatted records into a bounded lock-free ring
+ * (a Vyukov-style MPMC queue: each cell carries a sequence number that
+ * tells producers and the consumer whose turn it is) and never block:
+ * when the ring is full the record is dropped and counted instead of
+ * stalling a validation or network thread behind disk I/O. A dedicated
+ * writer thread drains the ring and writes records to disk in batches.
+ */
+static const size_t LOG_RING_SIZE = 8192; // must be a power of two
+struct LogRingCell {
+    std::atomic<size_t> seq;
+    std::string str;
+};
+static LogRingCell* logRing = nullptr;
+static std::atomic<size_t> logRingHead(0);
+static size_t logRingTail = 0; // only touched by the writer thread
+static std::atomic<bool> fAsyncLogActive(false);
+static std::atomic<bool> fLogWriterRun(false);
+static std::atomic<uint64_t> nLogMessagesDropped(0);
+static boost::thread* logWriterThread = nullptr;
+bool fLogAsync = DEFAULT_LOGASYNC;
+
+uint64_t GetLogMessagesDropped()
+{
+    return nLogMessagesDropped.load(std::memory_order_relaxed);
+}
+
+static bool AsyncLogEnqueue(const std::string& str)
+{
+    size_t pos = logRingHead.load(std::memory_order_relaxed);
+    for (;;) {
+        LogRingCell& cell = logRing[pos & (LOG_RING_SIZE - 1)];
+        size_t seq = cell.seq.load(std::memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (logRingHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell.str = str;
+                cell.seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (dif < 0) {
+            // The ring is full: drop the record rather than block the
+            // calling thread; the writer reports the counter.
+            nLogMessagesDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = logRingHead.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+static void AsyncLogDrain(std::string& batch)
+{
+    for (;;) {
+        LogRingCell& cell = logRing[logRingTail & (LOG_RING_SIZE - 1)];
+        size_t seq = cell.seq.load(std::memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(logRingTail + 1) < 0)
+            break;
+        batch += cell.str;
+        cell.str.clear();
+        cell.seq.store(logRingTail + LOG_RING_SIZE, std::memory_order_release);
+        ++logRingTail;
+    }
+}
+
+static void ThreadLogWriter()
+{
+    RenameThread("yacoin-logwriter");
+    uint64_t nLastDropReport = 0;
+    std::string batch;
+    for (;;) {
+        batch.clear();
+        AsyncLogDrain(batch);
+        uint64_t nDropped = nLogMessagesDropped.load(std::memory_order_relaxed);
+        if (nDropped != nLastDropReport) {
+            batch += strprintf("Async log ring overflowed, %d records dropped so far\n", nDropped);
+            nLastDropReport = nDropped;
+        }
+        if (!batch.empty()) {
+            boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+            if (fileout) {
+                // reopen the log file, if requested
+                if (fReopenDebugLog) {
+                    fReopenDebugLog = false;
+                    fs::path pathDebug = GetDataDir() / "debug.log";
+                    if (fsbridge::freopen(pathDebug, "a", fileout) != nullptr)
+                        setbuf(fileout, nullptr); // unbuffered
+                }
+                FileWriteStr(batch, fileout);
+            }
+        } else if (!fLogWriterRun.load(std::memory_order_acquire)) {
+            break;
+        } else {
+            MilliSleep(25);
+        }
+    }
+}
+
+void StartAsyncLogging()
+{
+    if (fAsyncLogActive.load(std::memory_order_acquire))
+        return;
+    // Must run after OpenDebugLog(); the writer only ever appends to an
+    // already-opened fileout.
+    assert(fileout != nullptr);
+    if (logRing == nullptr) {
+        logRing = new LogRingCell[LOG_RING_SIZE];
+        for (size_t i = 0; i < LOG_RING_SIZE; i++)
+            logRing[i].seq.store(i, std::memory_order_relaxed);
+    }
+    fLogWriterRun.store(true, std::memory_order_release);
+    logWriterThread = new boost::thread(&ThreadLogWriter);
+    LogPrintf("Asynchronous debug.log writer started (ring of %u records)\n", LOG_RING_SIZE);
+    fAsyncLogActive.store(true, std::memory_order_release);
+}
+
+void StopAsyncLogging()
+{
+    if (!fAsyncLogActive.load(std::memory_order_acquire))
+        return;
+    // New records go back to the synchronous path before the writer drains
+    // what is already queued, so nothing logged during shutdown is lost.
+    fAsyncLogActive.store(false, std::memory_order_release);
+    fLogWriterRun.store(false, std::memory_order_release);
+    if (logWriterThread) {
+        logWriterThread->join();
+        delete logWriterThread;
+        logWriterThread = nullptr;
+    }
+    uint64_t nDropped = nLogMessagesDropped.load(std::memory_order_relaxed);
+    if (nDropped > 0)
+        LogPrintf("Asynchronous log writer stopped, %d records were dropped\n", nDropped);
+}
+
 static void DebugPrintInit()
 {
     assert(mutexDebugLog == nullptr);
@@ -354,6 +498,10 @@ int LogPrintStr(const std::string &str)
     }
     else if (fPrintToDebugLog)
     {
+        // hand the record to the background writer, if it is running
+        if (fAsyncLogActive.load(std::memory_order_acquire))
+            return AsyncLogEnqueue(strTimestamped) ? (int)strTimestamped.size() : 0;
+
         boost::call_once(&DebugPrintInit, debugPrintInitFlag);
         boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
 
@@ -956,9 +1104,12 @@ void AllocateFileRange(FILE *file, unsigned int offset, unsigned int length) {
     }
     ftruncate(fileno(file), fst.fst_length);
 #elif defined(__linux__)
-    // Version using posix_fallocate
+    // Ask for real extents via fallocate(2); unlike glibc's posix_fallocate
+    // it never degrades to writing zeroes when the filesystem lacks the
+    // primitive, so keep posix_fallocate as the fallback for that case.
     off_t nEndPos = (off_t)offset + length;
-    posix_fallocate(fileno(file), 0, nEndPos);
+    if (fallocate(fileno(file), 0, 0, nEndPos) != 0)
+        posix_fallocate(fileno(file), 0, nEndPos);
 #else
     // Fallback version
     // TODO: just write one byte per block
@@ -1050,6 +1201,59 @@ void RenameThread(const char* name)
 #endif
 }
 
+bool BindThreadToNumaNode(int nNode)
+{
+#ifdef __linux__
+    // Parse the kernel's cpulist for the node ("0-7,16-23" style ranges)
+    std::ifstream file(strprintf("/sys/devices/system/node/node%d/cpulist", nNode).c_str());
+    if (!file.is_open())
+        return false;
+    std::string strCpuList;
+    std::getline(file, strCpuList);
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    int nCpus = 0;
+    std::istringstream iss(strCpuList);
+    std::string strRange;
+    while (std::getline(iss, strRange, ',')) {
+        int nFirst = -1, nLast = -1;
+        size_t nDash = strRange.find('-');
+        if (nDash == std::string::npos) {
+            nFirst = nLast = atoi(strRange.c_str());
+        } else {
+            nFirst = atoi(strRange.substr(0, nDash).c_str());
+            nLast = atoi(strRange.substr(nDash + 1).c_str());
+        }
+        for (int nCpu = nFirst; nCpu >= 0 && nCpu <= nLast && nCpu < CPU_SETSIZE; nCpu++) {
+            CPU_SET(nCpu, &cpuset);
+            nCpus++;
+        }
+    }
+    if (nCpus == 0)
+        return false;
+    return sched_setaffinity(0, sizeof(cpuset), &cpuset) == 0;
+#else
+    (void)nNode;
+    return false;
+#endif
+}
+
+bool SetPreferredNumaNode(int nNode)
+{
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    if (nNode < 0 || nNode >= (int)(8 * sizeof(unsigned long)))
+        return false;
+    // MPOL_PREFERRED as defined in <numaif.h>; invoked through syscall() so
+    // we need neither the libnuma headers nor a link dependency.
+    static const int MPOL_PREFERRED_POLICY = 1;
+    unsigned long nNodeMask = 1UL << nNode;
+    return syscall(SYS_set_mempolicy, MPOL_PREFERRED_POLICY, &nNodeMask, 8 * sizeof(nNodeMask)) == 0;
+#else
+    (void)nNode;
+    return false;
+#endif
+}
+
 void SetupEnvironment()
 {
 #ifdef HAVE_MALLOPT_ARENA_MAX
@@ -63,6 +63,7 @@ int64_t GetStartupTime();
 static const bool DEFAULT_LOGTIMEMICROS = false;
 static const bool DEFAULT_LOGIPS        = true;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
+static const bool DEFAULT_LOGASYNC      = false;
 
 /** Signals for translation. */
 class CTranslationInterface
@@ -78,6 +79,7 @@ extern bool fPrintToDebugLog;
 extern bool fLogTimestamps;
 extern bool fLogTimeMicros;
 extern bool fLogIPs;
+extern bool fLogAsync;
 extern std::atomic<bool> fReopenDebugLog;
 extern CTranslationInterface translationInterface;
 
@@ -150,6 +152,14 @@ bool GetLogCategory(uint32_t *f, const std::string *str);
 /** Send a string to the log output */
 int LogPrintStr(const std::string &str);
 
+/** Start the background debug.log writer thread (-logasync). Must be
+ *  called after OpenDebugLog(). */
+void StartAsyncLogging();
+/** Drain the log ring and join the background writer thread. */
+void StopAsyncLogging();
+/** Number of log records dropped because the log ring was full. */
+uint64_t GetLogMessagesDropped();
+
 /** Get format string from VA_ARGS for error reporting */
 template<typename... Args> std::string FormatStringFromLogArgs(const char *fmt, const Args&... args) { return fmt; }
 
@@ -317,6 +327,20 @@ int GetNumCores();
 
 void RenameThread(const char* name);
 
+/**
+ * Pin the calling thread to the CPUs of one NUMA node, read from
+ * /sys/devices/system/node. Linux only; returns false (doing nothing) on
+ * other platforms or if the node does not exist.
+ */
+bool BindThreadToNumaNode(int nNode);
+
+/**
+ * Prefer one NUMA node for all future memory allocations of this process
+ * (MPOL_PREFERRED). Called before the big caches are allocated so their
+ * pages land on the node the validation threads run on. Linux only.
+ */
+bool SetPreferredNumaNode(int nNode);
+
 /**
  * .. and a wrapper that just calls func once
  */
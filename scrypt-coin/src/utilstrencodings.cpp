@@ -4,15 +4,25 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include "config/scrypt-config.h"
+#endif
+
 #include "utilstrencodings.h"
 
 #include "tinyformat.h"
 
+#include <cassert>
+#include <cctype>
 #include <cstdlib>
 #include <cstring>
 #include <errno.h>
 #include <limits>
 
+#if defined(__x86_64__) || defined(__amd64__)
+#include <cpuid.h>
+#endif
+
 static const std::string CHARS_ALPHA_NUM = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
 
 static const std::string SAFE_CHARS[] =
@@ -56,6 +66,123 @@ signed char HexDigit(char c)
     return p_util_hexdigit[(unsigned char)c];
 }
 
+#if defined(ENABLE_AVX2)
+namespace hex_avx2 {
+void HexEncode(const unsigned char* p, size_t len, char* pout);
+size_t HexDecodeBulk(const char* pin, size_t len, unsigned char* pout);
+}
+#endif
+
+// Scalar hex conversion; HexAutoDetect() may replace the dispatch pointers
+// below with the AVX2 versions
+static void HexEncodeGeneric(const unsigned char* p, size_t len, char* pout)
+{
+    static const char hexmap[16] = { '0', '1', '2', '3', '4', '5', '6', '7',
+                                     '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+    for (size_t i = 0; i < len; i++) {
+        pout[2 * i] = hexmap[p[i] >> 4];
+        pout[2 * i + 1] = hexmap[p[i] & 15];
+    }
+}
+
+/** Decode consecutive pairs of hex digits, stopping at the first character
+ *  that is not a hex digit (including whitespace). Returns the number of
+ *  input characters consumed; consumed/2 bytes are written to pout. */
+static size_t HexDecodeBulkGeneric(const char* pin, size_t len, unsigned char* pout)
+{
+    size_t i = 0;
+    while (i + 2 <= len) {
+        signed char c1 = HexDigit(pin[i]);
+        signed char c2 = HexDigit(pin[i + 1]);
+        if ((c1 | c2) < 0)
+            break;
+        *pout++ = (c1 << 4) | c2;
+        i += 2;
+    }
+    return i;
+}
+
+typedef void (*HexEncodeType)(const unsigned char* p, size_t len, char* pout);
+typedef size_t (*HexDecodeBulkType)(const char* pin, size_t len, unsigned char* pout);
+static HexEncodeType HexEncodeImpl = HexEncodeGeneric;
+static HexDecodeBulkType HexDecodeBulkImpl = HexDecodeBulkGeneric;
+
+void HexEncode(const unsigned char* p, size_t len, char* pout)
+{
+    HexEncodeImpl(p, len, pout);
+}
+
+#if (defined(__x86_64__) || defined(__amd64__)) && defined(ENABLE_AVX2)
+/** Check whether the OS has enabled AVX registers (XCR0 bits 1 and 2). */
+static bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+
+// Verify the candidate implementations against the scalar ones before
+// dispatching to them
+static bool SelfTestHex(HexEncodeType enc, HexDecodeBulkType dec)
+{
+    unsigned char in[67];
+    for (size_t i = 0; i < sizeof(in); i++)
+        in[i] = (unsigned char)(i * 0x41 + 0x67);
+    for (size_t len = 0; len <= sizeof(in); len++) {
+        char expect[2 * sizeof(in)], got[2 * sizeof(in)];
+        HexEncodeGeneric(in, len, expect);
+        enc(in, len, got);
+        if (memcmp(expect, got, 2 * len) != 0)
+            return false;
+        // Round-trip through the decoder, upper-cased on odd lengths. A
+        // bulk decoder may stop short of the terminator, but whatever it
+        // consumed must be whole pairs decoding to the original bytes.
+        char hex[2 * sizeof(in) + 2];
+        memcpy(hex, expect, 2 * len);
+        if (len % 2)
+            for (size_t i = 0; i < 2 * len; i++)
+                hex[i] = toupper(hex[i]);
+        hex[2 * len] = ' '; // decoder must stop here at the latest
+        hex[2 * len + 1] = '0';
+        unsigned char back[sizeof(in)];
+        size_t consumed = dec(hex, 2 * len + 2, back);
+        if (consumed % 2 || consumed > 2 * len)
+            return false;
+        if (memcmp(back, in, consumed / 2) != 0)
+            return false;
+    }
+    // A non-hex character anywhere must stop the bulk decoder no later
+    // than the pair containing it
+    char bad[64];
+    memset(bad, 'a', sizeof(bad));
+    bad[37] = 'g';
+    unsigned char out[32];
+    if (dec(bad, sizeof(bad), out) > 36)
+        return false;
+    return true;
+}
+#endif
+
+std::string HexAutoDetect()
+{
+    std::string ret = "standard";
+#if (defined(__x86_64__) || defined(__amd64__)) && defined(ENABLE_AVX2)
+    uint32_t eax, ebx, ecx, edx;
+    uint32_t eax7 = 0, ebx7 = 0, ecx7 = 0, edx7 = 0;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        __cpuid_count(7, 0, eax7, ebx7, ecx7, edx7);
+        // AVX2 in the CPU is not enough: the OS must save the ymm registers too.
+        if (((ebx7 >> 5) & 1) && ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && AVXEnabled()) {
+            assert(SelfTestHex(hex_avx2::HexEncode, hex_avx2::HexDecodeBulk));
+            HexEncodeImpl = hex_avx2::HexEncode;
+            HexDecodeBulkImpl = hex_avx2::HexDecodeBulk;
+            ret = "avx2";
+        }
+    }
+#endif
+    return ret;
+}
+
 bool IsHex(const std::string& str)
 {
     for(std::string::const_iterator it(str.begin()); it != str.end(); ++it)
@@ -82,21 +209,31 @@ bool IsHexNumber(const std::string& str)
 std::vector<unsigned char> ParseHex(const char* psz)
 {
     // convert hex dump to vector
-    std::vector<unsigned char> vch;
+    size_t len = strlen(psz);
+    std::vector<unsigned char> vch(len / 2);
+    unsigned char* pout = vch.empty() ? nullptr : &vch[0];
+    const char* pin = psz;
     while (true)
     {
-        while (isspace(*psz))
-            psz++;
-        signed char c = HexDigit(*psz++);
+        // bulk-convert runs of clean hex pairs
+        size_t consumed = HexDecodeBulkImpl(pin, len - (pin - psz), pout);
+        pin += consumed;
+        pout += consumed / 2;
+        // the bulk path stopped: either whitespace (skip it and go again)
+        // or the end of the hex dump
+        while (isspace(*pin))
+            pin++;
+        signed char c = HexDigit(*pin);
         if (c == (signed char)-1)
             break;
-        unsigned char n = (c << 4);
-        c = HexDigit(*psz++);
-        if (c == (signed char)-1)
+        pin++;
+        signed char c2 = HexDigit(*pin);
+        if (c2 == (signed char)-1)
             break;
-        n |= c;
-        vch.push_back(n);
+        pin++;
+        *pout++ = (c << 4) | c2;
     }
+    vch.resize(vch.empty() ? 0 : pout - &vch[0]);
     return vch;
 }
 
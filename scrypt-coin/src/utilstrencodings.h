@@ -97,13 +97,30 @@ bool ParseUInt64(const std::string& str, uint64_t *out);
  */
 bool ParseDouble(const std::string& str, double *out);
 
+/** Hex-encode len bytes from p into 2*len characters at pout (no terminator).
+ *  Dispatched at startup by HexAutoDetect() to a vectorized implementation
+ *  when the CPU supports one. */
+void HexEncode(const unsigned char* p, size_t len, char* pout);
+
+/** Pick the best hex conversion routines for this CPU; returns the name of
+ *  the implementation chosen. */
+std::string HexAutoDetect();
+
 template<typename T>
 std::string HexStr(const T itbegin, const T itend, bool fSpaces=false)
 {
     std::string rv;
     static const char hexmap[16] = { '0', '1', '2', '3', '4', '5', '6', '7',
                                      '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
-    rv.reserve((itend-itbegin)*3);
+    size_t len = itend - itbegin;
+    if (!fSpaces && sizeof(*itbegin) == 1 && len > 0) {
+        // Contiguous byte range (every caller iterates one): hand the whole
+        // run to the dispatched bulk encoder
+        rv.resize(len * 2);
+        HexEncode(reinterpret_cast<const unsigned char*>(&itbegin[0]), len, &rv[0]);
+        return rv;
+    }
+    rv.reserve(len*3);
     for(T it = itbegin; it < itend; ++it)
     {
         unsigned char val = (unsigned char)(*it);
@@ -0,0 +1,83 @@
+// Copyright (c) 2017-2025 The Yacoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// AVX2 hex conversion: 16 bytes per iteration when encoding, 32 characters
+// per iteration when decoding. Hex sits on the hot path of every RPC that
+// serves raw blocks or transactions and of every hash printed to debug.log.
+// Compiled in its own object with -mavx2; only called after the runtime
+// CPU probe has verified AVX2 support.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <cstddef>
+
+namespace hex_avx2 {
+
+void HexEncode(const unsigned char* p, size_t len, char* pout)
+{
+    static const char hexmap[16] = { '0', '1', '2', '3', '4', '5', '6', '7',
+                                     '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+    // One 16-entry nibble-to-character table per 128-bit lane
+    const __m256i lut = _mm256_setr_epi8(
+        '0', '1', '2', '3', '4', '5', '6', '7',
+        '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+        '0', '1', '2', '3', '4', '5', '6', '7',
+        '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i mask = _mm_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 4), mask);
+        __m128i lo = _mm_and_si128(in, mask);
+        // Interleave so each input byte becomes (high nibble, low nibble)
+        __m256i nib = _mm256_set_m128i(_mm_unpackhi_epi8(hi, lo),
+                                       _mm_unpacklo_epi8(hi, lo));
+        _mm256_storeu_si256((__m256i*)(pout + 2 * i),
+                            _mm256_shuffle_epi8(lut, nib));
+    }
+    for (; i < len; i++) {
+        pout[2 * i] = hexmap[p[i] >> 4];
+        pout[2 * i + 1] = hexmap[p[i] & 15];
+    }
+}
+
+size_t HexDecodeBulk(const char* pin, size_t len, unsigned char* pout)
+{
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(pin + i));
+        __m256i lc = _mm256_or_si256(c, _mm256_set1_epi8(0x20)); // lowercase
+
+        // Classify: '0'-'9' or 'a'-'f' (after lowercasing); everything in
+        // the table is ASCII so signed byte compares are safe
+        __m256i ge0 = _mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1));
+        __m256i le9 = _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c);
+        __m256i isdig = _mm256_and_si256(ge0, le9);
+        __m256i gea = _mm256_cmpgt_epi8(lc, _mm256_set1_epi8('a' - 1));
+        __m256i lef = _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lc);
+        __m256i isalp = _mm256_and_si256(gea, lef);
+        if (_mm256_movemask_epi8(_mm256_or_si256(isdig, isalp)) != -1)
+            break; // whitespace or non-hex somewhere in this chunk
+
+        __m256i valdig = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+        __m256i valalp = _mm256_sub_epi8(lc, _mm256_set1_epi8('a' - 10));
+        __m256i val = _mm256_blendv_epi8(valalp, valdig, isdig);
+
+        // Combine nibble pairs: high * 16 + low, then narrow back to bytes
+        __m256i bytes16 = _mm256_maddubs_epi16(val, _mm256_set1_epi16(0x0110));
+        __m256i packed = _mm256_packus_epi16(bytes16, bytes16);
+        packed = _mm256_permute4x64_epi64(packed, 0x08);
+        _mm_storeu_si128((__m128i*)(pout + i / 2),
+                         _mm256_castsi256_si128(packed));
+    }
+    return i;
+}
+
+} // namespace hex_avx2
+
+#endif // ENABLE_AVX2
@@ -6,6 +6,7 @@
 #include "validation.h"
 
 #include "arith_uint256.h"
+#include "blockfilter.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -18,6 +19,7 @@
 #include "fs.h"
 #include "hash.h"
 #include "init.h"
+#include "metrics.h"
 #include "policy/fees.h"
 #include "policy/policy.h"
 //#include "policy/rbf.h"
@@ -31,6 +33,7 @@
 #include "script/standard.h"
 #include "timedata.h"
 #include "tinyformat.h"
+#include "trace.h"
 #include "txdb.h"
 #include "txmempool.h"
 #include "ui_interface.h"
@@ -52,6 +55,13 @@
 #include <algorithm>
 #include <cmath>
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/join.hpp>
 #include <boost/bind/bind.hpp>
@@ -70,11 +80,30 @@ using namespace boost::placeholders;
 CCriticalSection cs_main;
 BlockMap mapBlockIndex;
 CChain chainActive;
+/** Tip of the last published chain snapshot; written under cs_main whenever
+ *  chainActive.SetTip runs, read lock-free through GetChainSnapshot. */
+static std::atomic<const CBlockIndex*> pindexSnapshotTip(nullptr);
+
+CChainSnapshot GetChainSnapshot()
+{
+    return CChainSnapshot(pindexSnapshotTip.load(std::memory_order_acquire));
+}
+
+/** Publish the current chainActive tip for lock-free readers. Must be called
+ *  with cs_main held, after every SetTip. */
+static void PublishChainSnapshot()
+{
+    pindexSnapshotTip.store(chainActive.Tip(), std::memory_order_release);
+}
+
 // Best header we've seen so far (used for getheaders queries' starting points).
 CBlockIndex *pindexBestHeader = nullptr;
 CWaitableCriticalSection csBestBlock;
 CConditionVariable cvBlockChange;
 size_t nCoinCacheUsage = 5000 * 300;
+/** Number of coins cache entries an incremental (non-final) flush pushes to
+ *  LevelDB per periodic pass; bounds the foreground write a trickle causes. */
+static const size_t nTrickleFlushEntries = 50000;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 CTxMemPool mempool;
 int nScriptCheckThreads = 0;
@@ -84,7 +113,11 @@ bool fTxIndex = true;
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
+uint256 hashAssumeValid;
 bool fBlockHashIndex = true;
+bool fHavePruned = false;
+bool fPruneMode = false;
+uint64_t nPruneTarget = 0;
 
 CFeeRate minRelayTxFee = CFeeRate(DEFAULT_MIN_RELAY_TX_FEE);
 CAmount maxTxFee = DEFAULT_TRANSACTION_MAXFEE;
@@ -97,6 +130,9 @@ CTokensCache *ptokens = nullptr;
 CLRUCache<std::string, CDatabasedTokenData> *ptokensCache = nullptr;
 bool fTokenIndex = false;
 bool fAddressIndex = false;
+bool fAddressRollup = false;
+bool fSpentIndex = false;
+bool fBlockFilterIndex = false;
 //
 // END OF GLOBAL VARIABLES USED FOR TOKEN MANAGEMENT SYSTEM
 //
@@ -115,7 +151,11 @@ namespace {
     struct CBlockIndexWorkComparator
     {
         bool operator()(const CBlockIndex *pa, const CBlockIndex *pb) const {
-            // First sort by most total work, ...
+            // First sort by most total work. The 64-bit projection cached
+            // alongside bnChainTrust is order-preserving, so the expensive
+            // OpenSSL compare only runs when the projections tie.
+            if (pa->nChainTrustKey != pb->nChainTrustKey)
+                return pa->nChainTrustKey < pb->nChainTrustKey;
             if (pa->bnChainTrust > pb->bnChainTrust) return false;
             if (pa->bnChainTrust < pb->bnChainTrust) return true;
 
@@ -149,6 +189,11 @@ namespace {
     CCriticalSection cs_LastBlockFile;
     std::vector<CBlockFileInfo> vinfoBlockFile;
     int nLastBlockFile = 0;
+    /** Global flag to indicate we should check to see if there are
+     *  block/undo files that should be deleted.  Set on startup
+     *  or if we allocate more file space when we're in prune mode
+     */
+    bool fCheckForPruning = false;
 
     /**
      * Every received block is assigned a unique and increasing identifier, so we
@@ -183,6 +228,11 @@ namespace {
 
     /** Dirty block file entries. */
     std::set<int> setDirtyFileInfo;
+
+    /** Block/undo files with writes not yet pushed to durable storage. Fsyncs
+     *  are coalesced: files collect here at write time and are synced in one
+     *  batch from FlushStateToDisk, right before the index referencing them. */
+    std::set<int> setDirtySyncFiles;
 }
 
 CLastTxHash::CLastTxHash() {
@@ -226,8 +276,11 @@ enum FlushStateMode {
 
 // See definition for documentation
 static bool FlushStateToDisk(const CChainParams& chainParams, CValidationState &state, FlushStateMode mode, int nManualPruneHeight=0);
-bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, std::vector<CScriptCheck> *pvChecks = nullptr);
+bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = nullptr);
+static bool CheckInputsBatched(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, unsigned int flags, bool cacheSigStore);
 static FILE* OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly = false);
+static void FindFilesToPruneManual(std::set<int>& setFilesToPrune, int nManualPruneHeight);
+static void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight);
 
 static bool isHardforkHappened()
 {
@@ -365,6 +418,9 @@ bool CheckSequenceLocks(const CTransaction &tx, int flags, LockPoints* lp, bool
 // Returns the script flags which should be checked for a given block
 static unsigned int GetBlockScriptFlags(const CBlockIndex* pindex, const Consensus::Params& chainparams);
 
+// Trusted fast path for transactions coming back from disconnected blocks
+static bool AcceptToMemoryPoolResurrected(CTxMemPool& pool, CValidationState& state, const CTransactionRef& tx);
+
 /* Make mempool consistent after a reorg, by re-adding or recursively erasing
  * disconnected block transactions from the mempool, and also removing any
  * other transactions from the mempool that are no longer valid given the new
@@ -408,7 +464,7 @@ static void UpdateMempoolForReorg(DisconnectedBlockTransactions &disconnectpool,
                         bool fOverrideMempoolLimit, const CAmount nAbsurdFee)
            !AcceptToMemoryPool(mempool, stateDummy, *it, false, nullptr, nullptr, true)
          */
-        if (!fAddToMempool || tx->IsCoinBase() || tx->IsCoinStake() || !AcceptToMemoryPool(mempool, stateDummy, tx, nullptr)) {
+        if (!fAddToMempool || tx->IsCoinBase() || tx->IsCoinStake() || !AcceptToMemoryPoolResurrected(mempool, stateDummy, tx)) {
             // If the transaction doesn't make it in to the mempool, remove any
             // transactions that depend on it (which would now be orphans).
             mempool.removeRecursive(*tx, MemPoolRemovalReason::REORG);
@@ -461,24 +517,20 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, CValidationSt
         }
     }
 
-    return CheckInputs(tx, state, view, true, flags, cacheSigStore, true);
+    PrecomputedTransactionData txdata(tx);
+    return CheckInputs(tx, state, view, true, flags, cacheSigStore, true, txdata);
 }
 
-static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool& pool, CValidationState& state, const CTransactionRef& ptx,
-                              bool* pfMissingInputs, int64_t nAcceptTime, std::vector<COutPoint>& coins_to_uncache)
+/**
+ * Stage one of mempool acceptance: every check that needs neither cs_main
+ * nor the mempool. These are purely syntactic, so they can run (and fail)
+ * before any lock is taken — a transaction rejected here is invalid no
+ * matter what the chain state looks like. state is filled in on failure.
+ */
+static bool PreCheckMemoryPoolTx(const CTransaction& tx, CValidationState& state, bool fMempoolReload)
 {
-    const CTransaction& tx = *ptx;
-    const uint256 hash = tx.GetHash();
-    AssertLockHeld(cs_main);
-    if (pfMissingInputs)
-        *pfMissingInputs = false;
-
-    /** YAC_TOKEN START */
-    std::vector<std::pair<std::string, uint256>> vReissueTokens;
-    /** YAC_TOKEN END */
-
     if (tx.nVersion == CTransaction::CURRENT_VERSION_of_Tx_for_yac_old && isHardforkHappened())
-        return error("AcceptToMemoryPoolWorker() : Not accept transaction with old version");
+        return error("PreCheckMemoryPoolTx() : Not accept transaction with old version");
 
     if (!CheckTransaction(tx, state))
         return false; // state filled in by CheckTransaction
@@ -488,16 +540,40 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
 
     // Coinbase is only valid in a block, not as a loose transaction
     if (tx.IsCoinBase())
-        return state.DoS(100, error("AcceptToMemoryPoolWorker() : coinbase as individual tx"), REJECT_INVALID, "coinbase");
+        return state.DoS(100, error("PreCheckMemoryPoolTx() : coinbase as individual tx"), REJECT_INVALID, "coinbase");
 
     // ppcoin: coinstake is also only valid in a block, not as a loose transaction
     if (tx.IsCoinStake())
-        return state.DoS(100, error("AcceptToMemoryPoolWorker() : coinstake as individual tx"), REJECT_INVALID, "coinstake");
+        return state.DoS(100, error("PreCheckMemoryPoolTx() : coinstake as individual tx"), REJECT_INVALID, "coinstake");
 
-    // Rather not work on nonstandard transactions (unless -testnet/-regtest)
+    // Rather not work on nonstandard transactions (unless -testnet/-regtest).
+    // Entries reloaded from our own mempool.dat already passed this the first
+    // time around.
     std::string reason;
-    if (fRequireStandard && !IsStandardTx(tx, reason))
-        return state.DoS(0, error("AcceptToMemoryPoolWorker() : non-standard transaction (%s)", reason), REJECT_NONSTANDARD, reason);
+    if (fRequireStandard && !fMempoolReload && !IsStandardTx(tx, reason))
+        return state.DoS(0, error("PreCheckMemoryPoolTx() : non-standard transaction (%s)", reason), REJECT_NONSTANDARD, reason);
+
+    return true;
+}
+
+static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool& pool, CValidationState& state, const CTransactionRef& ptx,
+                              bool* pfMissingInputs, int64_t nAcceptTime, bool fMempoolReload, std::vector<COutPoint>& coins_to_uncache,
+                              bool fPreChecked = false, bool fResurrected = false)
+{
+    const CTransaction& tx = *ptx;
+    const uint256 hash = tx.GetHash();
+    AssertLockHeld(cs_main);
+    if (pfMissingInputs)
+        *pfMissingInputs = false;
+
+    /** YAC_TOKEN START */
+    std::vector<std::pair<std::string, uint256>> vReissueTokens;
+    /** YAC_TOKEN END */
+
+    // Callers with a batch of candidates run the syntactic stage before
+    // taking cs_main; don't repeat it for them.
+    if (!fPreChecked && !PreCheckMemoryPoolTx(tx, state, fMempoolReload || fResurrected))
+        return false;
 
     // Only accept nLockTime-using transactions that can be mined in the next
     // block; we don't want our mempool filled up with transactions that can't
@@ -571,6 +647,9 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         } // end LOCK(pool.cs)
 
         // Check transaction inputs (start)
+        // Time the input, token and script checks below; the block assembler
+        // budgets templates by this measured cost (see BlockAssembler)
+        const int64_t nTimeValidationStart = GetTimeMicros();
         if (!Consensus::CheckTxInputs(tx, state, view, GetSpendHeight(view), chainActive.Tip())) {
             return error("%s: Consensus::CheckTxInputs: %s, %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
         }
@@ -592,7 +671,7 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         // Check transaction inputs (end)
 
         // Check for non-standard pay-to-script-hash in inputs
-        if (fRequireStandard && !AreInputsStandard(tx, view))
+        if (fRequireStandard && !fMempoolReload && !fResurrected && !AreInputsStandard(tx, view))
             return state.Invalid(error("AcceptToMemoryPoolWorker() : nonstandard transaction input"), REJECT_NONSTANDARD, "bad-txns-nonstandard-inputs");
 
         int64_t nSigOpsCost = GetTransactionSigOpCost(tx, view, STANDARD_SCRIPT_VERIFY_FLAGS);
@@ -602,7 +681,10 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         CAmount nFees = nValueIn-nValueOut;
         unsigned int nSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
         ::int64_t txMinFee = GetMinFee(nSize);
-        if (nFees < txMinFee)
+        // A transaction coming back from a disconnected block already bought
+        // its confirmation once; keep it available for re-mining even if it
+        // sits below the current floor.
+        if (!fResurrected && nFees < txMinFee)
             return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool min fee not met",
                             false, strprintf("AcceptToMemoryPoolWorker() : not enough fees %s, %lld < %lld", hash.ToString().c_str(), nFees, txMinFee));
 
@@ -650,7 +732,12 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
 
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-        if (!CheckInputs(tx, state, view, true, scriptVerifyFlags, true, false)) {
+        // Transactions resurrected from disconnected blocks had their scripts
+        // verified when that block connected, and an input's scriptPubKey is
+        // fixed by its prevout txid, so re-verification cannot reach a
+        // different answer once the inputs-exist check above has passed; skip
+        // the script passes for them.
+        if (!fResurrected && !CheckInputsBatched(tx, state, view, scriptVerifyFlags, true)) {
             // yac: we don't support SCRIPT_VERIFY_CLEANSTACK, SCRIPT_VERIFY_WITNESS because we don't support segwit but bitcoin does
             return false; // state filled in by CheckInputs
         }
@@ -670,8 +757,11 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         // There is a similar check in CreateNewBlock() to prevent creating
         // invalid blocks (using TestBlockValidity), however allowing such
         // transactions into the mempool can be exploited as a DoS attack.
+        // On a mempool.dat reload the entries were verified against the tip
+        // flags by this same node shortly before shutdown, so the second pass
+        // is skipped there.
         unsigned int currentBlockScriptVerifyFlags = GetBlockScriptFlags(chainActive.Tip(), Params().GetConsensus());
-        if (!CheckInputsFromMempoolAndCache(tx, state, view, pool, currentBlockScriptVerifyFlags, true))
+        if (!fMempoolReload && !fResurrected && !CheckInputsFromMempoolAndCache(tx, state, view, pool, currentBlockScriptVerifyFlags, true))
         {
             // If we're using promiscuousmempoolflags, we may hit this normally
             // Check if current block has some flags that scriptVerifyFlags
@@ -680,7 +770,8 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
                 return error("%s: BUG! PLEASE REPORT THIS! ConnectInputs failed against latest-block but not STANDARD flags %s, %s",
                     __func__, hash.ToString(), FormatStateMessage(state));
             } else {
-                if (!CheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true, false)) {
+                PrecomputedTransactionData txdata(tx);
+                if (!CheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true, false, txdata)) {
                     return error("%s: ConnectInputs failed against MANDATORY but not STANDARD flags due to promiscuous mempool %s, %s",
                         __func__, hash.ToString(), FormatStateMessage(state));
                 } else {
@@ -689,6 +780,8 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
             }
         }
 
+        entry.UpdateValidationTime(GetTimeMicros() - nTimeValidationStart);
+
         // Store transaction in memory
         pool.addUnchecked(hash, entry, setAncestors);
 
@@ -730,10 +823,11 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
 
 /** (try to) add transaction to memory pool with a specified acceptance time **/
 static bool AcceptToMemoryPoolWithTime(const CChainParams& chainparams, CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx,
-                        bool* pfMissingInputs, int64_t nAcceptTime)
+                        bool* pfMissingInputs, int64_t nAcceptTime, bool fMempoolReload = false, bool fPreChecked = false, bool fResurrected = false)
 {
     std::vector<COutPoint> coins_to_uncache;
-    bool res = AcceptToMemoryPoolWorker(chainparams, pool, state, tx, pfMissingInputs, nAcceptTime, coins_to_uncache);
+    bool res = AcceptToMemoryPoolWorker(chainparams, pool, state, tx, pfMissingInputs, nAcceptTime, fMempoolReload, coins_to_uncache, fPreChecked, fResurrected);
+    TRACE3(mempool, accept_to_memory_pool, tx->GetHash().begin(), res, state.GetRejectCode());
     if (!res) {
         for (const COutPoint& hashTx : coins_to_uncache)
             pcoinsTip->Uncache(hashTx);
@@ -750,6 +844,65 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
     return AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, pfMissingInputs, GetTime());
 }
 
+/* Resubmit a transaction from a disconnected block after a reorg. The block
+ * that carried it was fully validated by this node before it could be
+ * disconnected, and DisconnectBlock has just restored its input coins into
+ * the pcoinsTip cache, so the worker skips the script passes, standardness
+ * and the fee floor, leaving only the checks whose answer can genuinely
+ * change with the chain: inputs still unspent, finality, sequence locks,
+ * coinbase maturity and token state.
+ */
+static bool AcceptToMemoryPoolResurrected(CTxMemPool& pool, CValidationState& state, const CTransactionRef& tx)
+{
+    const CChainParams& chainparams = Params();
+    return AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, nullptr, GetTime(), false /* fMempoolReload */,
+                                      false /* fPreChecked */, true /* fResurrected */);
+}
+
+int AcceptToMemoryPoolBatch(CTxMemPool& pool, const std::vector<CTransactionRef>& vtx,
+                            std::vector<CValidationState>& vstate, std::vector<bool>* pvMissingInputs)
+{
+    const CChainParams& chainparams = Params();
+    const int64_t nAcceptTime = GetTime();
+    vstate.assign(vtx.size(), CValidationState());
+    if (pvMissingInputs)
+        pvMissingInputs->assign(vtx.size(), false);
+
+    // Stage one: syntactic checks, no locks taken. A candidate that fails
+    // here is dropped before it can contend with block validation.
+    std::vector<bool> vfPassed(vtx.size(), false);
+    for (size_t i = 0; i < vtx.size(); i++)
+        vfPassed[i] = PreCheckMemoryPoolTx(*vtx[i], vstate[i], false);
+
+    // Stage two: commit the survivors under a single cs_main critical
+    // section instead of re-taking the lock per transaction.
+    int nAccepted = 0;
+    {
+        LOCK(cs_main);
+        for (size_t i = 0; i < vtx.size(); i++) {
+            if (!vfPassed[i])
+                continue;
+            bool fMissingInputs = false;
+            std::vector<COutPoint> coins_to_uncache;
+            bool res = AcceptToMemoryPoolWorker(chainparams, pool, vstate[i], vtx[i], &fMissingInputs, nAcceptTime, false, coins_to_uncache, true);
+            TRACE3(mempool, accept_to_memory_pool, vtx[i]->GetHash().begin(), res, vstate[i].GetRejectCode());
+            if (res) {
+                ++nAccepted;
+            } else {
+                for (const COutPoint& hashTx : coins_to_uncache)
+                    pcoinsTip->Uncache(hashTx);
+            }
+            if (pvMissingInputs)
+                (*pvMissingInputs)[i] = fMissingInputs;
+        }
+    }
+
+    // One flush for the whole batch rather than one per transaction.
+    CValidationState stateDummy;
+    FlushStateToDisk(chainparams, stateDummy, FLUSH_STATE_PERIODIC);
+    return nAccepted;
+}
+
 /** Return transaction in tx, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetTransaction(const uint256 &hash, CTransaction &tx, uint256 &hashBlock, bool fAllowSlow)
 {
@@ -837,7 +990,12 @@ static bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMes
     if (fileOutPos < 0)
         return error("WriteBlockToDisk: ftell failed");
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
+    // Serialize into a buffer sized up front so the block goes to disk in a
+    // single allocation and a single write
+    CDataStream ssBlock(SER_DISK, CLIENT_VERSION);
+    ssBlock.reserve(nSize);
+    ssBlock << block;
+    fileout.write(ssBlock.data(), ssBlock.size());
 
     // Store blockhash to avoid recalculating block hash (very slow !!!) when reading block data from disk
     uint256 hash = block.GetHash();
@@ -849,21 +1007,96 @@ static bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMes
     return true;
 }
 
+#ifndef WIN32
+/** Read-only mappings of completed block files for -blocksmmap. Protected by
+ * cs_mapBlockFileMmap; a mapping is never unmapped once handed out, so readers
+ * can deserialize from it without holding the lock. Only files that will no
+ * longer grow (nFile < nLastBlockFile) are mapped, which keeps the mappings
+ * immutable and avoids remapping the tail file on every append.
+ */
+struct CBlockFileMmap {
+    const char* pchData;
+    size_t nSize;
+};
+static CCriticalSection cs_mapBlockFileMmap;
+static std::map<int, CBlockFileMmap> mapBlockFileMmap;
+
+static bool GetBlockFileMmap(const CDiskBlockPos& pos, CBlockFileMmap& filemap)
+{
+    {
+        LOCK(cs_LastBlockFile);
+        if (pos.nFile >= nLastBlockFile)
+            return false;
+    }
+
+    LOCK(cs_mapBlockFileMmap);
+    std::map<int, CBlockFileMmap>::iterator it = mapBlockFileMmap.find(pos.nFile);
+    if (it == mapBlockFileMmap.end()) {
+        fs::path path = GetBlockPosFilename(pos, "blk");
+        int fd = open(path.string().c_str(), O_RDONLY);
+        if (fd == -1)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            close(fd);
+            return false;
+        }
+        void* pvMap = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (pvMap == MAP_FAILED)
+            return false;
+        // Rescans and getblock-heavy peers walk block files front to back;
+        // tell the kernel to read ahead aggressively.
+        posix_madvise(pvMap, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+        CBlockFileMmap filemapNew;
+        filemapNew.pchData = (const char*)pvMap;
+        filemapNew.nSize = (size_t)st.st_size;
+        it = mapBlockFileMmap.insert(std::make_pair(pos.nFile, filemapNew)).first;
+    }
+    if (pos.nPos >= it->second.nSize)
+        return false;
+    filemap = it->second;
+    return true;
+}
+#endif
+
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
-
-    // Read block
-    try {
-        filein >> block;
+    bool fReadOk = false;
+#ifndef WIN32
+    if (gArgs.GetBoolArg("-blocksmmap", false)) {
+        CBlockFileMmap filemap;
+        if (GetBlockFileMmap(pos, filemap)) {
+            try {
+                CMemoryReadStream blockin(filemap.pchData + pos.nPos, filemap.nSize - pos.nPos, SER_DISK, CLIENT_VERSION);
+                blockin >> block;
+                fReadOk = true;
+            }
+            catch (const std::exception& e) {
+                // Fall back to the buffered path below; a short mapping or a
+                // corrupt record will be reported there.
+                LogPrintf("%s: mmap deserialize error - %s at %s, retrying buffered\n", __func__, e.what(), pos.ToString());
+                block.SetNull();
+            }
+        }
     }
-    catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+#endif
+
+    if (!fReadOk) {
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+
+        // Read block
+        try {
+            filein >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
     }
 
     // Retrieve blockhash to avoid recalculating block hash (very slow !!!)
@@ -880,6 +1113,92 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
     return true;
 }
 
+void PrefetchBlockFromDisk(const CDiskBlockPos& pos)
+{
+#ifndef WIN32
+    // The record length is not known without reading the size prefix, so hint
+    // a window large enough for any block; the kernel clamps it to the file.
+    static const size_t nPrefetchWindow = 2 << 20;
+    if (gArgs.GetBoolArg("-blocksmmap", false)) {
+        CBlockFileMmap filemap;
+        if (GetBlockFileMmap(pos, filemap)) {
+            size_t nLen = std::min(nPrefetchWindow, filemap.nSize - pos.nPos);
+            posix_madvise((void*)(filemap.pchData + pos.nPos), nLen, POSIX_MADV_WILLNEED);
+            return;
+        }
+    }
+    FILE* file = OpenBlockFile(pos, true);
+    if (file) {
+        posix_fadvise(fileno(file), pos.nPos, nPrefetchWindow, POSIX_FADV_WILLNEED);
+        fclose(file);
+    }
+#endif
+}
+
+// Background warming of the coins DB for a block we expect to connect
+// shortly: a compact block announcement names most of the block's
+// transactions several hundred milliseconds before the full block is
+// reconstructed, so their spent outpoints can be read from the coins DB
+// now, pulling the records into the LevelDB block cache and OS page
+// cache. ConnectBlock then misses pcoinsTip into a warm backing store
+// instead of cold disk. The worker deliberately reads pcoinsdbview and
+// never touches pcoinsTip, which may only be used under cs_main.
+static CWaitableCriticalSection csCoinsPrefetch;
+static CConditionVariable condCoinsPrefetch;
+static std::deque<COutPoint> queueCoinsPrefetch;
+static bool fCoinsPrefetchQuit = false;
+//! cap so a burst of announcements cannot queue unbounded work
+static const size_t MAX_COINS_PREFETCH_QUEUE = 50000;
+
+void PrefetchCoins(std::vector<COutPoint>&& vOutpoints)
+{
+    if (vOutpoints.empty())
+        return;
+    {
+        boost::unique_lock<boost::mutex> lock(csCoinsPrefetch);
+        for (COutPoint& outpoint : vOutpoints) {
+            if (queueCoinsPrefetch.size() >= MAX_COINS_PREFETCH_QUEUE)
+                break;
+            queueCoinsPrefetch.push_back(outpoint);
+        }
+    }
+    condCoinsPrefetch.notify_one();
+}
+
+void ThreadCoinsPrefetch()
+{
+    LogPrintf("ThreadCoinsPrefetch start\n");
+    RenameThread("yacoin-coinspre");
+    while (true) {
+        COutPoint outpoint;
+        {
+            boost::unique_lock<boost::mutex> lock(csCoinsPrefetch);
+            while (queueCoinsPrefetch.empty() && !fCoinsPrefetchQuit)
+                condCoinsPrefetch.wait(lock);
+            if (fCoinsPrefetchQuit)
+                break;
+            outpoint = queueCoinsPrefetch.front();
+            queueCoinsPrefetch.pop_front();
+        }
+        // The value is discarded; the read itself does the warming. A
+        // miss (outpoint spent by another in-flight tx, or created in
+        // the same block) costs one cheap negative lookup.
+        Coin coin;
+        if (pcoinsdbview)
+            pcoinsdbview->GetCoin(outpoint, coin);
+    }
+    LogPrintf("ThreadCoinsPrefetch shutdown\n");
+}
+
+void ThreadCoinsPrefetchQuit()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(csCoinsPrefetch);
+        fCoinsPrefetchQuit = true;
+    }
+    condCoinsPrefetch.notify_all();
+}
+
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
     if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), consensusParams))
@@ -932,7 +1251,7 @@ bool IsInitialBlockDownload()
             startEpochBlockHeight = nMainnetNewLogicBlockNumber;
         }
         const CBlockIndex* pindexMoneySupplyBlock = FindBlockByHeight(startEpochBlockHeight - 1);
-        blockReward = (pindexMoneySupplyBlock->nMoneySupply * nInflation / nNumberOfBlocksPerYear);
+        blockReward = (pindexMoneySupplyBlock->GetMoneySupply() * nInflation / nNumberOfBlocksPerYear);
     } else {
         // OLD LOGIC BEFORE HARDFORK
         CBigNum bnSubsidyLimit = MAX_MINT_PROOF_OF_WORK;
@@ -990,16 +1309,16 @@ void static InvalidChainFound(CBlockIndex* pindexNew)
     LogPrintf("%s: invalid block=%s  height=%d  trust=%s  moneysupply=%s  date=%s  moneysupply=%s\n", __func__,
       pindexNew->GetBlockHash().ToString(), pindexNew->nHeight,
       (pindexNew->bnChainTrust).ToString(),
-      FormatMoney(chainActive.Tip()->nMoneySupply),
+      FormatMoney(chainActive.Tip()->GetMoneySupply()),
       DateTimeStrFormat("%Y-%m-%d %H:%M:%S", pindexNew->GetBlockTime()),
-      FormatMoney(pindexNew->nMoneySupply));
+      FormatMoney(pindexNew->GetMoneySupply()));
 
     CBlockIndex *tip = chainActive.Tip();
     assert (tip);
     LogPrintf("%s:  current best=%s  height=%d  trust=%s  moneysupply=%s  date=%s  moneysupply=%s\n", __func__,
       tip->GetBlockHash().ToString(), chainActive.Height(), (tip->bnChainTrust).ToString(),
-      FormatMoney(chainActive.Tip()->nMoneySupply),
-      DateTimeStrFormat("%Y-%m-%d %H:%M:%S", tip->GetBlockTime()), FormatMoney(pindexNew->nMoneySupply));
+      FormatMoney(chainActive.Tip()->GetMoneySupply()),
+      DateTimeStrFormat("%Y-%m-%d %H:%M:%S", tip->GetBlockTime()), FormatMoney(pindexNew->GetMoneySupply()));
     // TODO: Add notification for a new best chain
 //    CheckForkWarningConditions();
 }
@@ -1032,7 +1351,7 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txund
 bool CScriptCheck::operator()()
 {
     const CScript&scriptSig = ptxTo->vin[nIn].scriptSig;
-    if (!VerifyScript(scriptSig, scriptPubKey, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, cacheStore), &error))
+    if (!VerifyScript(scriptSig, scriptPubKey, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, cacheStore, txdata), &error))
         return ::error("CScriptCheck() : %s VerifySignature failed", ptxTo->GetHash().ToString().substr(0,10).c_str());
     return true;
 }
@@ -1047,6 +1366,11 @@ int GetSpendHeight(const CCoinsViewCache& inputs)
 static CuckooCache::cache<uint256, SignatureCacheHasher> scriptExecutionCache;
 static uint256 scriptExecutionCacheNonce(GetRandHash());
 
+//! Cumulative script execution cache probes (guarded by cs_main, which
+//! CheckInputs already requires for the cache itself).
+static uint64_t nScriptCacheHits = 0;
+static uint64_t nScriptCacheMisses = 0;
+
 void InitScriptExecutionCache() {
     // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
     // setup_bytes creates the minimum possible cache (2 elements).
@@ -1066,7 +1390,7 @@ void InitScriptExecutionCache() {
  *
  * Non-static (and re-declared) in src/test/txvalidationcache_tests.cpp
  */
-bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, std::vector<CScriptCheck> *pvChecks)
+bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks)
 {
     if (!tx.IsCoinBase())
     {
@@ -1099,8 +1423,10 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
             CSHA256().Write(scriptExecutionCacheNonce.begin(), 55 - sizeof(flags) - 32).Write(tx.GetHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
             AssertLockHeld(cs_main); //TODO: Remove this requirement by making CuckooCache not require external locks
             if (scriptExecutionCache.contains(hashCacheEntry, !cacheFullScriptStore)) {
+                nScriptCacheHits++;
                 return true;
             }
+            nScriptCacheMisses++;
 
             for (unsigned int i = 0; i < tx.vin.size(); i++) {
                 const COutPoint &prevout = tx.vin[i].prevout;
@@ -1116,7 +1442,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                 const CAmount amount = coin.out.nValue;
 
                 // Verify signature
-                CScriptCheck check(scriptPubKey, tx, i, flags, cacheSigStore);
+                CScriptCheck check(scriptPubKey, tx, i, flags, cacheSigStore, &txdata);
                 if (pvChecks) {
                     pvChecks->push_back(CScriptCheck());
                     check.swap(pvChecks->back());
@@ -1128,7 +1454,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                         // arguments; if so, don't trigger DoS protection to
                         // avoid splitting the network between upgraded and
                         // non-upgraded nodes.
-                        CScriptCheck check2(scriptPubKey, tx, i, flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheSigStore);
+                        CScriptCheck check2(scriptPubKey, tx, i, flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheSigStore, &txdata);
                         if (check2())
                             return state.Invalid(false, REJECT_NONSTANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(check.GetScriptError())));
                     }
@@ -1156,6 +1482,13 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
 
 namespace {
 
+/** Undo chunks are LZ-compressed on disk. A legacy chunk starts with the
+ *  compact size of the vtxundo vector, which never uses the 0xff (64-bit)
+ *  encoding for a real block, so that byte doubles as a format sentinel:
+ *  compressed chunks start with 0xff followed by a format version. */
+static const unsigned char UNDO_CHUNK_SENTINEL = 0xff;
+static const unsigned char UNDO_CHUNK_VERSION_LZ = 1;
+
 bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
@@ -1163,8 +1496,21 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     if (fileout.IsNull())
         return error("%s: OpenUndoFile failed", __func__);
 
+    // Serialize and compress the undo data
+    CDataStream ssUndo(SER_DISK, CLIENT_VERSION);
+    ssUndo << blockundo;
+    std::vector<unsigned char> vchUncompressed(ssUndo.begin(), ssUndo.end());
+    std::vector<unsigned char> vchCompressed;
+    CompressChunk(vchUncompressed, vchCompressed);
+
+    CDataStream ssChunk(SER_DISK, CLIENT_VERSION);
+    ssChunk << UNDO_CHUNK_SENTINEL << UNDO_CHUNK_VERSION_LZ;
+    uint64_t nUncompressedSize = vchUncompressed.size();
+    ssChunk << VARINT(nUncompressedSize);
+    ssChunk << vchCompressed;
+
     // Write index header
-    unsigned int nSize = GetSerializeSize(fileout, blockundo);
+    unsigned int nSize = ssChunk.size();
     fileout << FLATDATA(messageStart) << nSize;
 
     // Write undo data
@@ -1172,9 +1518,10 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     if (fileOutPos < 0)
         return error("%s: ftell failed", __func__);
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << blockundo;
+    fileout.write(ssChunk.data(), ssChunk.size());
 
-    // calculate & write checksum
+    // calculate & write checksum; it covers the uncompressed serialization
+    // so legacy and compressed chunks checksum identically
     CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
     hasher << hashBlock;
     hasher << blockundo;
@@ -1183,6 +1530,10 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
+} // anon namespace
+
+// Not in the anonymous namespace: declared in validation.h for callers that
+// read undo data directly (e.g. getblockstats).
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
 {
     // Open history file to read
@@ -1190,25 +1541,62 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uin
     if (filein.IsNull())
         return error("%s: OpenUndoFile failed", __func__);
 
-    // Read block
     uint256 hashChecksum;
-    CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
     try {
+        // Peek at the first byte to tell compressed chunks from legacy ones
+        unsigned char chFirst;
+        filein >> chFirst;
+        if (chFirst == UNDO_CHUNK_SENTINEL) {
+            unsigned char chVersion;
+            filein >> chVersion;
+            if (chVersion != UNDO_CHUNK_VERSION_LZ)
+                return error("%s: unknown undo chunk format version %d", __func__, chVersion);
+
+            uint64_t nUncompressedSize = 0;
+            filein >> VARINT(nUncompressedSize);
+            std::vector<unsigned char> vchCompressed;
+            filein >> vchCompressed;
+
+            std::vector<unsigned char> vchUncompressed;
+            if (!DecompressChunk(vchCompressed, vchUncompressed, nUncompressedSize))
+                return error("%s: undo data decompression failed", __func__);
+
+            CDataStream ssUndo(vchUncompressed, SER_DISK, CLIENT_VERSION);
+            ssUndo >> blockundo;
+
+            CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+            hasher << hashBlock;
+            hasher.write((const char*)vchUncompressed.data(), vchUncompressed.size());
+            filein >> hashChecksum;
+            if (hashChecksum != hasher.GetHash())
+                return error("%s: Checksum mismatch", __func__);
+
+            return true;
+        }
+
+        // Legacy uncompressed chunk: rewind over the peeked byte and
+        // deserialize in place
+        if (fseek(filein.Get(), pos.nPos, SEEK_SET))
+            return error("%s: fseek failed", __func__);
+
+        CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
         verifier << hashBlock;
         verifier >> blockundo;
         filein >> hashChecksum;
+
+        // Verify checksum
+        if (hashChecksum != verifier.GetHash())
+            return error("%s: Checksum mismatch", __func__);
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s", __func__, e.what());
     }
 
-    // Verify checksum
-    if (hashChecksum != verifier.GetHash())
-        return error("%s: Checksum mismatch", __func__);
-
     return true;
 }
 
+namespace {
+
 /** Abort with a message */
 bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
 {
@@ -1324,6 +1712,7 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
 
     // undo transactions in reverse order
     CTokensCache tempCache(*tokensCache);
@@ -1531,6 +1920,11 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
 
                 const CTxIn input = tx.vin[j];
 
+                // The output is unspent again; delete its spent index record
+                if (fSpentIndex) {
+                    spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue()));
+                }
+
                 // Update address index database
                 if (fAddressIndex) {
                     const CTxOut &prevout = view.AccessCoin(tx.vin[j].prevout).out;
@@ -1607,17 +2001,35 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
             error("Failed to delete address index");
             return DISCONNECT_FAILED;
         }
+        if (fAddressRollup && !pblocktree->UpdateAddressBalanceIndex(addressIndex, true)) {
+            error("Failed to revert address balance rollups");
+            return DISCONNECT_FAILED;
+        }
         if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
             error("Failed to write address unspent index");
             return DISCONNECT_FAILED;
         }
     }
 
+    if (!ignoreAddressIndex && fSpentIndex) {
+        if (!pblocktree->UpdateSpentIndex(spentIndex)) {
+            error("Failed to write spent index");
+            return DISCONNECT_FAILED;
+        }
+    }
+
+    if (!ignoreAddressIndex && fBlockFilterIndex) {
+        if (!pblocktree->EraseBlockFilter(pindex->GetBlockHash())) {
+            error("Failed to delete compact filter index");
+            return DISCONNECT_FAILED;
+        }
+    }
+
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
 
-void static FlushBlockFile(bool fFinalize = false)
+void static FlushBlockFile(bool fFinalize = false, bool fSync = true)
 {
     LOCK(cs_LastBlockFile);
 
@@ -1627,7 +2039,8 @@ void static FlushBlockFile(bool fFinalize = false)
     if (fileOld) {
         if (fFinalize)
             TruncateFile(fileOld, vinfoBlockFile[nLastBlockFile].nSize);
-        FileCommit(fileOld);
+        if (fSync)
+            FileCommit(fileOld);
         fclose(fileOld);
     }
 
@@ -1635,9 +2048,39 @@ void static FlushBlockFile(bool fFinalize = false)
     if (fileOld) {
         if (fFinalize)
             TruncateFile(fileOld, vinfoBlockFile[nLastBlockFile].nUndoSize);
-        FileCommit(fileOld);
+        if (fSync)
+            FileCommit(fileOld);
         fclose(fileOld);
     }
+
+    if (!fSync)
+        setDirtySyncFiles.insert(nLastBlockFile);
+}
+
+/** Fsync every block/undo file written since the last call. This is the single
+ *  durability barrier for block data: FlushStateToDisk runs it right before
+ *  the block index entries that refer to these files hit the database, so
+ *  per-write and per-file-roll syncs can be skipped without losing the
+ *  index-never-points-at-unsynced-data invariant. */
+void static SyncBlockFiles()
+{
+    LOCK(cs_LastBlockFile);
+
+    setDirtySyncFiles.insert(nLastBlockFile);
+    for (const int nFile : setDirtySyncFiles) {
+        CDiskBlockPos pos(nFile, 0);
+        FILE *file = OpenBlockFile(pos);
+        if (file) {
+            FileCommit(file);
+            fclose(file);
+        }
+        file = OpenUndoFile(pos);
+        if (file) {
+            FileCommit(file);
+            fclose(file);
+        }
+    }
+    setDirtySyncFiles.clear();
 }
 
 static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigned int nAddSize);
@@ -1648,6 +2091,11 @@ void ThreadScriptCheck()
 {
     LogPrintf("ThreadScriptCheck start\n");
     RenameThread("yacoin-scriptch");
+    // Keep the script check pool on the node holding the coins cache; the
+    // memory policy itself is set once at startup (see -numanode in init).
+    int64_t nNumaNode = gArgs.GetArg("-numanode", -1);
+    if (nNumaNode >= 0 && !BindThreadToNumaNode(nNumaNode))
+        LogPrintf("ThreadScriptCheck: could not bind to NUMA node %d\n", nNumaNode);
     scriptcheckqueue.Thread();
     LogPrintf("ThreadScriptCheck shutdown\n");
 }
@@ -1657,6 +2105,126 @@ void ThreadScriptCheckQuit()
     scriptcheckqueue.Quit();
 }
 
+/**
+ * Index the existing chain for -txindex while the node runs. Entries are
+ * written in batches together with a resume marker, so an interrupted build
+ * picks up where it left off on the next start. fTxIndex stays false (and
+ * GetTransaction keeps using its fallbacks) until the build reaches the tip;
+ * the flag is then flipped under cs_main, after which ConnectBlock keeps the
+ * index current.
+ */
+void ThreadTxIndexBuild()
+{
+    const CChainParams& chainparams = Params();
+
+    const CBlockIndex* pindex = nullptr;
+    {
+        LOCK(cs_main);
+        uint256 hashBest;
+        if (pblocktree->ReadTxIndexBestBlock(hashBest)) {
+            BlockMap::iterator mi = mapBlockIndex.find(hashBest);
+            if (mi != mapBlockIndex.end())
+                pindex = chainActive.Next(chainActive.FindFork(mi->second));
+        }
+        if (pindex == nullptr)
+            pindex = chainActive.Genesis();
+    }
+
+    std::vector<std::pair<uint256, CDiskTxPos> > vPos;
+    int64_t nLastLog = GetTimeMillis();
+    while (pindex != nullptr) {
+        boost::this_thread::interruption_point();
+        if (ShutdownRequested()) {
+            // Save what we have; the marker lets the next start resume here.
+            if (!vPos.empty())
+                pblocktree->WriteTxIndexBuildProgress(vPos, pindex->GetBlockHash());
+            LogPrintf("%s: interrupted at height %d\n", __func__, pindex->nHeight);
+            return;
+        }
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus())) {
+            error("%s: failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+            return;
+        }
+        // Same position arithmetic as ConnectBlock
+        CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
+        for (const CTransaction& tx : block.vtx) {
+            vPos.push_back(std::make_pair(tx.GetHash(), pos));
+            pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
+        }
+
+        if (vPos.size() > 10000) {
+            if (!pblocktree->WriteTxIndexBuildProgress(vPos, pindex->GetBlockHash())) {
+                error("%s: failed to write transaction index", __func__);
+                return;
+            }
+            vPos.clear();
+        }
+        if (GetTimeMillis() - nLastLog > 30000) {
+            LogPrintf("Building transaction index, at height %d\n", pindex->nHeight);
+            nLastLog = GetTimeMillis();
+        }
+
+        LOCK(cs_main);
+        const CBlockIndex* pnext = chainActive.Contains(pindex) ?
+            chainActive.Next(pindex) : chainActive.Next(chainActive.FindFork(pindex));
+        if (pnext == nullptr) {
+            // Reached the tip. Write the remainder and flip the flag while
+            // cs_main is still held, so no block can connect unindexed in
+            // between.
+            if (!vPos.empty() && !pblocktree->WriteTxIndexBuildProgress(vPos, pindex->GetBlockHash())) {
+                error("%s: failed to write transaction index", __func__);
+                return;
+            }
+            fTxIndex = true;
+            pblocktree->WriteFlag("txindex", true);
+            pblocktree->EraseTxIndexBestBlock();
+            LogPrintf("Transaction index build complete at height %d\n", pindex->nHeight);
+            return;
+        }
+        pindex = pnext;
+    }
+
+    // Empty chain: there is nothing to index, the flag can go on right away.
+    LOCK(cs_main);
+    fTxIndex = true;
+    pblocktree->WriteFlag("txindex", true);
+    LogPrintf("Transaction index enabled on empty chain\n");
+}
+
+/**
+ * CheckInputs with the script checks gathered up front and executed as one
+ * batch on the script check threads, the same way ConnectBlock runs a
+ * block's checks. Attributing a failure (which input, which script error)
+ * needs the serial path, so a failed batch simply re-runs the checks
+ * inline; that only costs extra work for transactions that are rejected
+ * anyway. Used on the mempool path, where a multi-input transaction would
+ * otherwise verify every input on one thread.
+ *
+ * Callers hold cs_main, which also keeps the queue from being used by
+ * ConnectBlock at the same time.
+ */
+static bool CheckInputsBatched(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, unsigned int flags, bool cacheSigStore)
+{
+    // Local precomputed sighash data is safe to share with the queue: the
+    // checks finish inside control.Wait(), within this scope
+    PrecomputedTransactionData txdata(tx);
+    if (nScriptCheckThreads && tx.vin.size() > 1) {
+        std::vector<CScriptCheck> vChecks;
+        CValidationState stateDummy;
+        if (CheckInputs(tx, stateDummy, inputs, true, flags, cacheSigStore, false, txdata, &vChecks)) {
+            CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+            control.Add(vChecks);
+            if (control.Wait())
+                return true;
+        }
+        // Fall through to the serial path to fill in state with the
+        // offending input's error
+    }
+    return CheckInputs(tx, state, inputs, true, flags, cacheSigStore, false, txdata, nullptr);
+}
+
 static unsigned int GetBlockScriptFlags(const CBlockIndex* pindex, const Consensus::Params& consensusparams) {
     AssertLockHeld(cs_main);
 
@@ -1705,6 +2273,8 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
            (*pindex->phashBlock == block.GetHash()));
     int64_t nTimeStart = GetTimeMicros();
 
+    TRACE2(validation, connect_block_start, pindex->nHeight, block.vtx.size());
+
     // Check it again in case a previous version let a bad block in, but skip BlockSig checking
     if (!CheckBlock(block, state, chainparams.GetConsensus(), !fJustCheck, !fJustCheck, false)) // Force the check of token duplicates when connecting the block
         return error("%s: Consensus::CheckBlock: %s", __func__, FormatStateMessage(state));
@@ -1722,9 +2292,28 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         return true;
     }
 
-    // TODO: Improve checkpoints logic
-    // In Bitcoin, it uses hashAssumeValid for script check
-    bool fScriptChecks = pindex->nHeight >= Checkpoints::GetTotalBlocksEstimate();
+    bool fScriptChecks = true;
+    if (!hashAssumeValid.IsNull()) {
+        // We've been configured with the hash of a block which has been
+        // externally verified to have a valid history. A suitable default
+        // value is included with the software and updated from time to time
+        // (the last compiled-in checkpoint). Because we only accept the
+        // skip when the assumed-valid block sits on our best header chain
+        // and the block being connected is buried beneath it, the header
+        // chain vouches for the blocks whose scripts we do not execute.
+        // Script verification is skipped when connecting such blocks; all
+        // other validation (merkle root, PoW/PoS, UTXO accounting,
+        // consensus limits) still happens.
+        BlockMap::const_iterator it = mapBlockIndex.find(hashAssumeValid);
+        if (it != mapBlockIndex.end()) {
+            if (it->second->GetAncestor(pindex->nHeight) == pindex &&
+                pindexBestHeader != nullptr &&
+                pindexBestHeader->GetAncestor(pindex->nHeight) == pindex &&
+                pindexBestHeader->bnChainTrust >= it->second->bnChainTrust) {
+                fScriptChecks = false;
+            }
+        }
+    }
 
     int64_t nTime1 = GetTimeMicros(); nTimeCheck += nTime1 - nTimeStart;
     LogPrint(BCLog::BENCH, "    - Sanity checks: %.2fms [%.2fs]\n", 0.001 * (nTime1 - nTimeStart), nTimeCheck * 0.000001);
@@ -1770,6 +2359,11 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
 
+    // Snapshot the script cache counters so the bench line below can show
+    // how much of this block skipped script execution outright
+    uint64_t nScriptCacheHitsStart = nScriptCacheHits;
+    uint64_t nScriptCacheMissesStart = nScriptCacheMisses;
+
     std::vector<int> prevheights;
     CAmount nFees = 0;
     int64_t nValueIn = 0;
@@ -1780,11 +2374,62 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     std::vector<std::pair<uint256, CDiskTxPos> > vPos;
     vPos.reserve(block.vtx.size());
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
+    // Precomputed sighash data must outlive the script checks handed to the
+    // check queue, which only complete at control.Wait() below
+    std::vector<PrecomputedTransactionData> txdata;
+    txdata.reserve(block.vtx.size());
 
     /** YAC_TOKEN START */
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
     /** YAC_TOKEN END */
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+    std::vector<CScript> vFilterPrevoutScripts;
+
+    // Bulk-fetch every input coin of the block up front: CCoinsViewDB reads
+    // the missing ones in key order with a single iterator sweep, instead of
+    // a random-order point read per input when the cache is cold.
+    {
+        std::vector<COutPoint> vPrevouts;
+        for (unsigned int i = 0; i < block.vtx.size(); i++) {
+            if (block.vtx[i].IsCoinBase())
+                continue;
+            for (const CTxIn& txin : block.vtx[i].vin)
+                vPrevouts.push_back(txin.prevout);
+        }
+        if (!vPrevouts.empty())
+            view.FetchCoins(vPrevouts);
+    }
+
+    // Batch the HASH160s of the block's pay-to-pubkey outputs up front
+    // (coinstakes pay to raw pubkeys, so every block carries some): the
+    // address index branch below looks the digests up instead of running
+    // SHA256+RIPEMD160 once per output.
+    std::map<std::pair<unsigned int, unsigned int>, uint160> mapP2PKHash160;
+    if (fAddressIndex) {
+        std::vector<const unsigned char*> vpPubKeys;
+        std::vector<size_t> vnPubKeyLens;
+        std::vector<std::pair<unsigned int, unsigned int> > vPubKeySlots;
+        for (unsigned int i = 0; i < block.vtx.size(); i++) {
+            const CTransaction& tx = block.vtx[i];
+            for (unsigned int k = 0; k < tx.vout.size(); k++) {
+                const CScript& script = tx.vout[k].scriptPubKey;
+                if (script.IsPayToPublicKey()) {
+                    vpPubKeys.push_back((const unsigned char*)&*(script.begin() + 1));
+                    vnPubKeyLens.push_back(script.size() - 2);
+                    vPubKeySlots.push_back(std::make_pair(i, k));
+                }
+            }
+        }
+        if (!vpPubKeys.empty()) {
+            std::vector<unsigned char> vchHashes(vpPubKeys.size() * CRIPEMD160::OUTPUT_SIZE);
+            Hash160Batch(vpPubKeys.data(), vnPubKeyLens.data(), vpPubKeys.size(), vchHashes.data());
+            for (size_t n = 0; n < vPubKeySlots.size(); n++)
+                mapP2PKHash160[vPubKeySlots[n]] =
+                        uint160(std::vector<unsigned char>(vchHashes.begin() + n * CRIPEMD160::OUTPUT_SIZE,
+                                                           vchHashes.begin() + (n + 1) * CRIPEMD160::OUTPUT_SIZE));
+        }
+    }
 
     // Iterate through all transaction (both inputs and outputs) to do various check and update database cache
     for (unsigned int i = 0; i < block.vtx.size(); i++)
@@ -1793,6 +2438,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         const uint256 txhash = tx.GetHash();
 
         nInputs += tx.vin.size();
+        txdata.emplace_back(tx);
 
         if (tx.IsCoinBase())
             nValueOut += tx.GetValueOut();
@@ -1904,6 +2550,22 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                 }
             }
             /** YAC_TOKEN END */
+
+            // Record which transaction spent each consumed output
+            if (fSpentIndex) {
+                for (size_t j = 0; j < tx.vin.size(); j++) {
+                    spentIndex.push_back(std::make_pair(CSpentIndexKey(tx.vin[j].prevout.hash, tx.vin[j].prevout.n),
+                                                        CSpentIndexValue(txhash, j, pindex->nHeight)));
+                }
+            }
+
+            // The compact filter covers the scripts this block spends, which
+            // must be captured here while the view still has the prevouts
+            if (fBlockFilterIndex) {
+                for (size_t j = 0; j < tx.vin.size(); j++) {
+                    vFilterPrevoutScripts.push_back(view.AccessCoin(tx.vin[j].prevout).out.scriptPubKey);
+                }
+            }
         }
 
         // GetTransactionSigOpCost counts 3 types of sigops:
@@ -1918,7 +2580,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         {
             std::vector<CScriptCheck> vChecks;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
-            if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, fCacheResults, nScriptCheckThreads ? &vChecks : nullptr))
+            if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, fCacheResults, txdata[i], nScriptCheckThreads ? &vChecks : nullptr))
                 return error("ConnectBlock(): CheckInputs on %s failed with %s",
                     tx.GetHash().ToString(), FormatStateMessage(state));
             control.Add(vChecks);
@@ -1950,7 +2612,8 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                     addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
 
                 } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytesUint160(Hash160(out.scriptPubKey.begin() + 1, out.scriptPubKey.end() - 1));
+                    // Hashed in bulk before the transaction loop
+                    uint160 hashBytesUint160(mapP2PKHash160[std::make_pair(i, k)]);
 
                     // record receiving activity
                     addressIndex.push_back(
@@ -2035,14 +2698,14 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
 
     int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
-    LogPrint(BCLog::BENCH, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime4 - nTime2), nInputs <= 1 ? 0 : 0.001 * (nTime4 - nTime2) / (nInputs-1), nTimeVerify * 0.000001);
+    LogPrint(BCLog::BENCH, "    - Verify %u txins: %.2fms (%.3fms/txin, script cache %llu hit / %llu miss) [%.2fs]\n", nInputs - 1, 0.001 * (nTime4 - nTime2), nInputs <= 1 ? 0 : 0.001 * (nTime4 - nTime2) / (nInputs-1), (unsigned long long)(nScriptCacheHits - nScriptCacheHitsStart), (unsigned long long)(nScriptCacheMisses - nScriptCacheMissesStart), nTimeVerify * 0.000001);
 
     if (fJustCheck)
         return true;
 
     // ppcoin: track money supply and mint amount info
-    pindex->nMint = nValueOut - nValueIn + nFees;
-    pindex->nMoneySupply = (pindex->pprev? pindex->pprev->nMoneySupply : 0) + nValueOut - nValueIn;
+    pindex->SetMoneySupplyStats(nValueOut - nValueIn + nFees,
+        (pindex->pprev? pindex->pprev->GetMoneySupply() : 0) + nValueOut - nValueIn);
 
     // Write undo information to disk
     if (pindex->GetUndoPos().IsNull() || !pindex->IsValid(BLOCK_VALID_SCRIPTS))
@@ -2081,11 +2744,36 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             return AbortNode(state, "Failed to write address index");
         }
 
+        if (fAddressRollup && !pblocktree->UpdateAddressBalanceIndex(addressIndex, false)) {
+            return AbortNode(state, "Failed to write address balance rollups");
+        }
+
         if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
             return AbortNode(state, "Failed to write address unspent index");
         }
     }
 
+    // Update spent index
+    if (!ignoreAddressIndex && fSpentIndex) {
+        if (!pblocktree->UpdateSpentIndex(spentIndex)) {
+            return AbortNode(state, "Failed to write spent index");
+        }
+    }
+
+    // Update compact filter index
+    if (!ignoreAddressIndex && fBlockFilterIndex) {
+        // The header chains from the parent's filter header; it stays null
+        // for the first filtered block (the genesis block stores no filter)
+        uint256 prevFilterHeader;
+        if (pindex->pprev) {
+            pblocktree->ReadBlockFilterHeader(pindex->pprev->GetBlockHash(), prevFilterHeader);
+        }
+        BlockFilter filter(pindex->GetBlockHash(), block, vFilterPrevoutScripts);
+        if (!pblocktree->WriteBlockFilter(pindex->GetBlockHash(), filter.ComputeHeader(prevFilterHeader), filter.GetEncodedFilter())) {
+            return AbortNode(state, "Failed to write compact filter index");
+        }
+    }
+
     assert(pindex->phashBlock);
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
@@ -2096,6 +2784,8 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     int64_t nTime6 = GetTimeMicros(); nTimeCallbacks += nTime6 - nTime5;
     LogPrint(BCLog::BENCH, "    - Callbacks: %.2fms [%.2fs]\n", 0.001 * (nTime6 - nTime5), nTimeCallbacks * 0.000001);
 
+    TRACE3(validation, connect_block_end, pindex->nHeight, block.vtx.size(), nTime6 - nTimeStart);
+
     return true;
 }
 
@@ -2108,6 +2798,8 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &state, FlushStateMode mode, int nManualPruneHeight) {
 //    int64_t nMempoolUsage = mempool.DynamicMemoryUsage();
     LOCK(cs_main);
+    // Don't let a compaction start underneath the batch writes below
+    CDBThrottleBackgroundWork dbThrottle;
     static int64_t nLastWrite = 0;
     static int64_t nLastFlush = 0;
     static int64_t nLastSetChain = 0;
@@ -2118,22 +2810,21 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
     try {
     {
         LOCK(cs_LastBlockFile);
-        // TODO: Implement prune later
-//        if (fPruneMode && (fCheckForPruning || nManualPruneHeight > 0) && !fReindex) {
-//            if (nManualPruneHeight > 0) {
-//                FindFilesToPruneManual(setFilesToPrune, nManualPruneHeight);
-//            } else {
-//                FindFilesToPrune(setFilesToPrune, chainparams.PruneAfterHeight());
-//                fCheckForPruning = false;
-//            }
-//            if (!setFilesToPrune.empty()) {
-//                fFlushForPrune = true;
-//                if (!fHavePruned) {
-//                    pblocktree->WriteFlag("prunedblockfiles", true);
-//                    fHavePruned = true;
-//                }
-//            }
-//        }
+        if (fPruneMode && (fCheckForPruning || nManualPruneHeight > 0) && !fReindex) {
+            if (nManualPruneHeight > 0) {
+                FindFilesToPruneManual(setFilesToPrune, nManualPruneHeight);
+            } else {
+                FindFilesToPrune(setFilesToPrune, chainparams.PruneAfterHeight());
+                fCheckForPruning = false;
+            }
+            if (!setFilesToPrune.empty()) {
+                fFlushForPrune = true;
+                if (!fHavePruned) {
+                    pblocktree->WriteFlag("prunedblockfiles", true);
+                    fHavePruned = true;
+                }
+            }
+        }
         nNow = GetTimeMicros();
         // Avoid writing/flushing immediately after startup.
         if (nLastWrite == 0) {
@@ -2173,6 +2864,13 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
         bool fPeriodicFlush = mode == FLUSH_STATE_PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
         // Combine all conditions that result in a full cache flush.
         fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
+        // The cache is past half the limit but no full flush is due yet:
+        // trickle a bounded chunk of entries down to LevelDB now, so the
+        // eventual full flush only has a small residue left and tip updates
+        // never stall behind a multi-gigabyte batch. The database stays
+        // marked mid-transition until the next full flush, so a crash in
+        // between is repaired by ReplayBlocks as usual.
+        bool fTrickleFlush = !fDoFullFlush && mode == FLUSH_STATE_PERIODIC && cacheSize > nTotalSpace / 2;
 
         if (!fDoFullFlush && IsInitialBlockDownload() && nNow > nLastFlush + (int64_t) DATABASE_FLUSH_INTERVAL_INITIAL_SYNC * 1000000) {
             LogPrintf("Flushing to database sooner for inial block sync\n");
@@ -2185,7 +2883,9 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             if (!CheckDiskSpace(0))
                 return state.Error("out of disk space");
             // First make sure all block and undo data is flushed to disk.
-            FlushBlockFile();
+            // Per-write and per-file-roll syncs are deferred, so this is the
+            // one durability barrier for block data.
+            SyncBlockFiles();
             // Then update all block file information (which may refer to block and undo files).
             {
                 std::vector<std::pair<int, const CBlockFileInfo*> > vFiles;
@@ -2204,12 +2904,15 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                     return AbortNode(state, "Failed to write to block index database");
                 }
             }
-            // TODO: Implement prune later
             // Finally remove any pruned files
-//            if (fFlushForPrune)
-//                UnlinkPrunedFiles(setFilesToPrune);
+            if (fFlushForPrune)
+                UnlinkPrunedFiles(setFilesToPrune);
             nLastWrite = nNow;
         }
+        if (fTrickleFlush) {
+            if (!pcoinsTip->FlushPartial(nTrickleFlushEntries))
+                return AbortNode(state, "Failed to write to coin database");
+        }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
         if (fDoFullFlush) {
             // Typical Coin structures on disk are around 48 bytes in size.
@@ -2241,6 +2944,11 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             /** YAC_TOKEN END */
             nLastFlush = nNow;
         }
+        TRACE4(validation, flush_state_to_disk, (int64_t)mode, cacheSize, fDoFullFlush, GetTimeMicros() - nNow);
+        if (fDoFullFlush) {
+            g_metrics.nChainFlushes.fetch_add(1, std::memory_order_relaxed);
+            g_metrics.histChainFlush.Observe(GetTimeMicros() - nNow);
+        }
     }
     if (fDoFullFlush || ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000)) {
         // Update best block in wallet (so we can detect restored wallets).
@@ -2259,6 +2967,13 @@ void FlushStateToDisk() {
     FlushStateToDisk(chainparams, state, FLUSH_STATE_ALWAYS);
 }
 
+void PruneAndFlush() {
+    CValidationState state;
+    fCheckForPruning = true;
+    const CChainParams& chainparams = Params();
+    FlushStateToDisk(chainparams, state, FLUSH_STATE_NONE);
+}
+
 static void AlertNotify(const std::string& strMessage)
 {
     uiInterface.NotifyAlertChanged();
@@ -2290,12 +3005,13 @@ static void DoWarning(const std::string& strWarning)
 void static UpdateTip(CBlockIndex *pindexNew) {
     // Update tip
     chainActive.SetTip(pindexNew);
+    PublishChainSnapshot();
 
     // New best block
     mempool.AddTransactionsUpdated(1);
 
-    // TODO: Support notify new tip to miner
-//    cvBlockChange.notify_all();
+    // Wake anyone waiting on the best block (getblocktemplate long polls)
+    cvBlockChange.notify_all();
 
     bool fIsInitialDownload = IsInitialBlockDownload();
     std::vector<std::string> warningMessages;
@@ -2490,6 +3206,10 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
                        DisconnectedBlockTransactions& disconnectpool)
 {
     assert(pindexNew->pprev == chainActive.Tip());
+    // Keep LevelDB compactions out of the way while the tip advances; the
+    // guard's release when this function returns is the quiescent hint that
+    // lets any held-back compaction start.
+    CDBThrottleBackgroundWork dbThrottle;
     // Read block from disk.
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
@@ -2550,6 +3270,8 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
 
         nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
         LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs]\n", (nTime3 - nTime2) * 0.001, nTimeConnectTotal * 0.000001);
+        g_metrics.nBlocksConnected.fetch_add(1, std::memory_order_relaxed);
+        g_metrics.histBlockConnect.Observe(nTime3 - nTime2);
         // Flush latest chainstate to global blockchain cache pcoinsTip
         bool flushed = view.Flush();
         assert(flushed);
@@ -2576,6 +3298,9 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     // Update chainActive & related variables.
     UpdateTip(pindexNew);
 
+    // Expire signature cache entries consumed by old enough blocks
+    SignatureCacheBumpGeneration();
+
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
     LogPrint(BCLog::BENCH, "- Connect block: %.2fms [%.2fs]\n", (nTime6 - nTime1) * 0.001, nTimeTotal * 0.000001);
@@ -2682,6 +3407,7 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
     // Build list of new blocks to connect.
     std::vector<CBlockIndex*> vpindexToConnect;
     bool fContinue = true;
+    int nBlocksConnected = 0;
     int nHeight = pindexFork ? pindexFork->nHeight : -1;
     while (fContinue && nHeight != pindexMostWork->nHeight) {
         // Don't iterate the entire list of potential improvements toward the best tip, as we likely only need
@@ -2715,7 +3441,7 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
                     return false;
                 }
             } else {
-                PruneBlockIndexCandidates();
+                ++nBlocksConnected;
                 if (!pindexOldTip || chainActive.Tip()->bnChainTrust > pindexOldTip->bnChainTrust) {
                     // We're in a better position than we were. Return temporarily to release the lock.
                     fContinue = false;
@@ -2723,6 +3449,13 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
                 }
             }
         }
+        // Sweep candidates now made stale by this batch of connects in one
+        // pass rather than once per block. Leaving them in place between
+        // connects is harmless: selection always takes the best entry.
+        if (nBlocksConnected > 0) {
+            PruneBlockIndexCandidates();
+            nBlocksConnected = 0;
+        }
     }
 
     if (fBlocksDisconnected) {
@@ -2873,7 +3606,7 @@ static CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
     pindexNew->nTimeMax = (pindexNew->pprev ? std::max(pindexNew->pprev->nTimeMax, pindexNew->nTime) : pindexNew->nTime);
 
     // ppcoin: compute chain trust score
-    pindexNew->bnChainTrust = (pindexNew->pprev ? pindexNew->pprev->bnChainTrust : 0)  + pindexNew->GetBlockTrust();
+    pindexNew->SetChainTrust((pindexNew->pprev ? pindexNew->pprev->bnChainTrust : 0) + pindexNew->GetBlockTrust());
 
     // ppcoin: compute stake entropy bit for stake modifier
     if (!pindexNew->SetStakeEntropyBit(block.GetStakeEntropyBit(pindexNew->nHeight)))
@@ -2974,7 +3707,10 @@ static bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, unsigned i
         if (!fKnown) {
             LogPrintf("Leaving block file %i: %s\n", nLastBlockFile, vinfoBlockFile[nLastBlockFile].ToString());
         }
-        FlushBlockFile(!fKnown);
+        // Trim the file we are leaving but defer its fsync to the next
+        // durability barrier in FlushStateToDisk; during IBD files roll over
+        // often enough that syncing here serializes the download on the disk.
+        FlushBlockFile(!fKnown, false);
         nLastBlockFile = nFile;
     }
 
@@ -2985,17 +3721,21 @@ static bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, unsigned i
         vinfoBlockFile[nFile].nSize += nAddSize;
 
     if (!fKnown) {
-        unsigned int nOldChunks = (pos.nPos + BLOCKFILE_CHUNK_SIZE - 1) / BLOCKFILE_CHUNK_SIZE;
-        unsigned int nNewChunks = (vinfoBlockFile[nFile].nSize + BLOCKFILE_CHUNK_SIZE - 1) / BLOCKFILE_CHUNK_SIZE;
+        // Read once: operators on fast links can raise this to cut the number
+        // of allocate events during IBD, at the cost of more slack at the tip
+        // of the current blk*.dat until it is finalized.
+        static const unsigned int nChunkSize = (unsigned int)std::min<int64_t>(MAX_BLOCKFILE_SIZE,
+            std::max<int64_t>(0x10000, gArgs.GetArg("-blockfilechunksize", BLOCKFILE_CHUNK_SIZE)));
+        unsigned int nOldChunks = (pos.nPos + nChunkSize - 1) / nChunkSize;
+        unsigned int nNewChunks = (vinfoBlockFile[nFile].nSize + nChunkSize - 1) / nChunkSize;
         if (nNewChunks > nOldChunks) {
-            // TODO: Implement prune later
-//            if (fPruneMode)
-//                fCheckForPruning = true;
-            if (CheckDiskSpace(nNewChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos)) {
+            if (fPruneMode)
+                fCheckForPruning = true;
+            if (CheckDiskSpace(nNewChunks * nChunkSize - pos.nPos)) {
                 FILE *file = OpenBlockFile(pos);
                 if (file) {
-                    LogPrintf("Pre-allocating up to position 0x%x in blk%05u.dat\n", nNewChunks * BLOCKFILE_CHUNK_SIZE, pos.nFile);
-                    AllocateFileRange(file, pos.nPos, nNewChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos);
+                    LogPrintf("Pre-allocating up to position 0x%x in blk%05u.dat\n", nNewChunks * nChunkSize, pos.nFile);
+                    AllocateFileRange(file, pos.nPos, nNewChunks * nChunkSize - pos.nPos);
                     fclose(file);
                 }
             }
@@ -3005,6 +3745,7 @@ static bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, unsigned i
     }
 
     setDirtyFileInfo.insert(nFile);
+    setDirtySyncFiles.insert(nFile);
     return true;
 }
 
@@ -3018,18 +3759,23 @@ static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos,
     pos.nPos = vinfoBlockFile[nFile].nUndoSize;
     nNewSize = vinfoBlockFile[nFile].nUndoSize += nAddSize;
     setDirtyFileInfo.insert(nFile);
-
-    unsigned int nOldChunks = (pos.nPos + UNDOFILE_CHUNK_SIZE - 1) / UNDOFILE_CHUNK_SIZE;
-    unsigned int nNewChunks = (nNewSize + UNDOFILE_CHUNK_SIZE - 1) / UNDOFILE_CHUNK_SIZE;
+    // Undo data regularly lands in files older than nLastBlockFile (it is
+    // written at connect time, not download time), so track it for the
+    // coalesced sync in FlushStateToDisk as well.
+    setDirtySyncFiles.insert(nFile);
+
+    static const unsigned int nChunkSize = (unsigned int)std::min<int64_t>(MAX_BLOCKFILE_SIZE,
+        std::max<int64_t>(0x10000, gArgs.GetArg("-undofilechunksize", UNDOFILE_CHUNK_SIZE)));
+    unsigned int nOldChunks = (pos.nPos + nChunkSize - 1) / nChunkSize;
+    unsigned int nNewChunks = (nNewSize + nChunkSize - 1) / nChunkSize;
     if (nNewChunks > nOldChunks) {
-        // TODO: Implement prune later
-//        if (fPruneMode)
-//            fCheckForPruning = true;
-        if (CheckDiskSpace(nNewChunks * UNDOFILE_CHUNK_SIZE - pos.nPos)) {
+        if (fPruneMode)
+            fCheckForPruning = true;
+        if (CheckDiskSpace(nNewChunks * nChunkSize - pos.nPos)) {
             FILE *file = OpenUndoFile(pos);
             if (file) {
-                LogPrintf("Pre-allocating up to position 0x%x in rev%05u.dat\n", nNewChunks * UNDOFILE_CHUNK_SIZE, pos.nFile);
-                AllocateFileRange(file, pos.nPos, nNewChunks * UNDOFILE_CHUNK_SIZE - pos.nPos);
+                LogPrintf("Pre-allocating up to position 0x%x in rev%05u.dat\n", nNewChunks * nChunkSize, pos.nFile);
+                AllocateFileRange(file, pos.nPos, nNewChunks * nChunkSize - pos.nPos);
                 fclose(file);
             }
         }
@@ -3223,7 +3969,7 @@ static bool PoSContextualBlockChecks(const CBlock& block, CValidationState& stat
           return false;  // do not error here as we expect this during initial block download
         }
         // ppcoin: record proof-of-stake hash value
-        pindex->hashProofOfStake = hashProofOfStake;
+        pindex->SetHashProofOfStake(hashProofOfStake);
     }
 
     setDirtyBlockIndex.insert(pindex);  // queue a write to disk
@@ -3478,9 +4224,8 @@ static bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidation
         return AbortNode(state, std::string("System error: ") + e.what());
     }
 
-    // TODO: Implement prune later
-//    if (fCheckForPruning)
-//        FlushStateToDisk(chainparams, state, FLUSH_STATE_NONE); // we just allocated more disk space for block files
+    if (fCheckForPruning)
+        FlushStateToDisk(chainparams, state, FLUSH_STATE_NONE); // we just allocated more disk space for block files
 
     return true;
 }
@@ -3517,6 +4262,150 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
     return true;
 }
 
+uint64_t CalculateCurrentUsage()
+{
+    uint64_t retval = 0;
+    for (const CBlockFileInfo &file : vinfoBlockFile) {
+        retval += file.nSize + file.nUndoSize;
+    }
+    return retval;
+}
+
+/* Prune a block file (modify associated database entries)*/
+void PruneOneBlockFile(const int fileNumber)
+{
+    for (BlockMap::iterator it = mapBlockIndex.begin(); it != mapBlockIndex.end(); ++it) {
+        CBlockIndex* pindex = it->second;
+        if (pindex->nFile == fileNumber) {
+            pindex->nStatus &= ~BLOCK_HAVE_DATA;
+            pindex->nStatus &= ~BLOCK_HAVE_UNDO;
+            pindex->nFile = 0;
+            pindex->nDataPos = 0;
+            pindex->nUndoPos = 0;
+            setDirtyBlockIndex.insert(pindex);
+
+            // Prune from mapBlocksUnlinked -- any block we prune would have
+            // to be downloaded again in order to consider its chain, at which
+            // point it would be considered as a candidate for
+            // mapBlocksUnlinked or setBlockIndexCandidates.
+            std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> range = mapBlocksUnlinked.equal_range(pindex->pprev);
+            while (range.first != range.second) {
+                std::multimap<CBlockIndex *, CBlockIndex *>::iterator _it = range.first;
+                range.first++;
+                if (_it->second == pindex) {
+                    mapBlocksUnlinked.erase(_it);
+                }
+            }
+        }
+    }
+
+    vinfoBlockFile[fileNumber].SetNull();
+    setDirtyFileInfo.insert(fileNumber);
+}
+
+
+void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
+{
+    for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
+        CDiskBlockPos pos(*it, 0);
+        fs::remove(GetBlockPosFilename(pos, "blk"));
+        fs::remove(GetBlockPosFilename(pos, "rev"));
+        LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
+    }
+}
+
+/* Calculate the block/rev files to delete based on height specified by user with RPC command pruneblockchain */
+static void FindFilesToPruneManual(std::set<int>& setFilesToPrune, int nManualPruneHeight)
+{
+    assert(fPruneMode && nManualPruneHeight > 0);
+
+    LOCK2(cs_main, cs_LastBlockFile);
+    if (chainActive.Tip() == nullptr)
+        return;
+
+    // last block to prune is the lesser of (user-specified height, MIN_BLOCKS_TO_KEEP from the tip)
+    unsigned int nLastBlockWeCanPrune = std::min((unsigned)nManualPruneHeight, chainActive.Tip()->nHeight - MIN_BLOCKS_TO_KEEP);
+    int count=0;
+    for (int fileNumber = 0; fileNumber < nLastBlockFile; fileNumber++) {
+        if (vinfoBlockFile[fileNumber].nSize == 0 || vinfoBlockFile[fileNumber].nHeightLast > nLastBlockWeCanPrune)
+            continue;
+        PruneOneBlockFile(fileNumber);
+        setFilesToPrune.insert(fileNumber);
+        count++;
+    }
+    LogPrintf("Prune (Manual): prune_height=%d removed %d blk/rev pairs\n", nLastBlockWeCanPrune, count);
+}
+
+/* This function is called from the RPC code for pruneblockchain */
+void PruneBlockFilesManual(int nManualPruneHeight)
+{
+    CValidationState state;
+    const CChainParams& chainparams = Params();
+    FlushStateToDisk(chainparams, state, FLUSH_STATE_NONE, nManualPruneHeight);
+}
+
+/**
+ * Prune block and undo files (blk???.dat and undo???.dat) so that the disk space used is less than a user-defined target.
+ * The user sets the target (in MB) on the command line or in config file.  This will be run on startup and whenever new
+ * space is allocated in a block or undo file, staying below the target. Changing back to unpruned requires a reindex
+ * (which in this case means the blockchain must be re-downloaded.)
+ *
+ * Pruning functions are called from FlushStateToDisk when the global fCheckForPruning flag has been set.
+ * Block and undo files are deleted in lock-step (when blk00003.dat is deleted, so is rev00003.dat.)
+ * Pruning cannot take place until the longest chain is at least a certain length (100000 on mainnet).
+ * Pruning will never delete a block within a defined distance (currently 288) from the active chain's tip.
+ * The block index is updated by unsetting HAVE_DATA and HAVE_UNDO for any blocks that were stored in the deleted files.
+ * A db flag records the fact that at least some block files have been pruned.
+ *
+ * @param[out]   setFilesToPrune   The set of file indices that can be unlinked will be returned
+ */
+static void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight)
+{
+    LOCK2(cs_main, cs_LastBlockFile);
+    if (chainActive.Tip() == nullptr || nPruneTarget == 0) {
+        return;
+    }
+    if ((uint64_t)chainActive.Tip()->nHeight <= nPruneAfterHeight) {
+        return;
+    }
+
+    unsigned int nLastBlockWeCanPrune = chainActive.Tip()->nHeight - MIN_BLOCKS_TO_KEEP;
+    uint64_t nCurrentUsage = CalculateCurrentUsage();
+    // We don't check to prune until after we've allocated new space for files
+    // So we should leave a buffer under our target to account for another allocation
+    // before the next pruning.
+    uint64_t nBuffer = BLOCKFILE_CHUNK_SIZE + UNDOFILE_CHUNK_SIZE;
+    uint64_t nBytesToPrune;
+    int count=0;
+
+    if (nCurrentUsage + nBuffer >= nPruneTarget) {
+        for (int fileNumber = 0; fileNumber < nLastBlockFile; fileNumber++) {
+            nBytesToPrune = vinfoBlockFile[fileNumber].nSize + vinfoBlockFile[fileNumber].nUndoSize;
+
+            if (vinfoBlockFile[fileNumber].nSize == 0)
+                continue;
+
+            if (nCurrentUsage + nBuffer < nPruneTarget)  // are we below our target?
+                break;
+
+            // don't prune files that could have a block within MIN_BLOCKS_TO_KEEP of the main chain's tip but keep scanning
+            if (vinfoBlockFile[fileNumber].nHeightLast > nLastBlockWeCanPrune)
+                continue;
+
+            PruneOneBlockFile(fileNumber);
+            // Queue up the files for removal
+            setFilesToPrune.insert(fileNumber);
+            nCurrentUsage -= nBytesToPrune;
+            count++;
+        }
+    }
+
+    LogPrint(BCLog::PRUNE, "Prune: target=%dMiB actual=%dMiB diff=%dMiB max_prune_height=%d removed %d blk/rev pairs\n",
+           nPruneTarget/1024/1024, nCurrentUsage/1024/1024,
+           ((int64_t)nPruneTarget - (int64_t)nCurrentUsage)/1024/1024,
+           nLastBlockWeCanPrune, count);
+}
+
 bool CheckDiskSpace(uint64_t nAdditionalBytes)
 {
     uint64_t nFreeBytesAvailable = fs::space(GetDataDir()).available;
@@ -3623,7 +4512,7 @@ void LoadBlockRewardAndHighestDiff()
         {
             CBlockIndex *pBestEpochIntervalIndex = (*mi).second;
             nBlockReward =
-                (::int64_t)((pBestEpochIntervalIndex->pprev ? pBestEpochIntervalIndex->pprev->nMoneySupply : pBestEpochIntervalIndex->nMoneySupply) /
+                (::int64_t)((pBestEpochIntervalIndex->pprev ? pBestEpochIntervalIndex->pprev->GetMoneySupply() : pBestEpochIntervalIndex->GetMoneySupply()) /
                             nNumberOfBlocksPerYear) * nInflation;
         }
         else
@@ -3667,7 +4556,7 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     for (const std::pair<int, CBlockIndex*>& item : vSortedByHeight)
     {
         CBlockIndex* pindex = item.second;
-        pindex->bnChainTrust = (pindex->pprev ? pindex->pprev->bnChainTrust : CBigNum(0)) + pindex->GetBlockTrust();
+        pindex->SetChainTrust((pindex->pprev ? pindex->pprev->bnChainTrust : CBigNum(0)) + pindex->GetBlockTrust());
         // NovaCoin: calculate stake modifier checksum
         pindex->nStakeModifierChecksum = GetStakeModifierChecksum(pindex);
         if (!CheckStakeModifierCheckpoints(pindex->nHeight, pindex->nStakeModifierChecksum))
@@ -3739,10 +4628,9 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     }
 
     // Check whether we have ever pruned block & undo files
-    // TODO: Implement prune later
-//    pblocktree->ReadFlag("prunedblockfiles", fHavePruned);
-//    if (fHavePruned)
-//        LogPrintf("LoadBlockIndexDB(): Block files have previously been pruned\n");
+    pblocktree->ReadFlag("prunedblockfiles", fHavePruned);
+    if (fHavePruned)
+        LogPrintf("LoadBlockIndexDB(): Block files have previously been pruned\n");
 
     // Check whether we need to continue reindexing
     bool fReindexing = false;
@@ -3761,6 +4649,20 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadFlag("addressindex", fAddressIndex);
     LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
 
+    // Check whether the address balance rollups exist (only databases built
+    // since their introduction have them; older ones need a reindex)
+    pblocktree->ReadFlag("addressrollup", fAddressRollup);
+    if (fAddressIndex && !fAddressRollup)
+        LogPrintf("%s: address balance rollups missing, balance queries will walk the raw index until a reindex\n", __func__);
+
+    // Check whether we have a spent index
+    pblocktree->ReadFlag("spentindex", fSpentIndex);
+    LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
+
+    // Check whether we have a compact filter index
+    pblocktree->ReadFlag("blockfilterindex", fBlockFilterIndex);
+    LogPrintf("%s: compact filter index %s\n", __func__, fBlockFilterIndex ? "enabled" : "disabled");
+
     return true;
 }
 
@@ -3783,9 +4685,9 @@ bool LoadChainTip(const CChainParams& chainparams)
     if (it == mapBlockIndex.end())
         return false;
     chainActive.SetTip(it->second);
+    PublishChainSnapshot();
 
-    // TODO: Implement prune later
-//    PruneBlockIndexCandidates();
+    PruneBlockIndexCandidates();
 
     LogPrintf("Loaded best chain: hashBestChain=%s height=%d trust=%s date=%s\n",
         chainActive.Tip()->GetBlockHash().ToString(), chainActive.Height(),
@@ -3794,6 +4696,160 @@ bool LoadChainTip(const CChainParams& chainparams)
     return true;
 }
 
+/** File magic at the start of a UTXO snapshot. */
+static const char UTXO_SNAPSHOT_MAGIC[8] = {'Y', 'A', 'C', 'U', 'T', 'X', 'O', '1'};
+static const int UTXO_SNAPSHOT_VERSION = 1;
+
+bool DumpUTXOSnapshot(const fs::path& path, uint256& hashBase, int& nHeightBase, ::uint64_t& nCoins, std::string& strError)
+{
+    // Push the whole cache down so the database cursor sees the tip state.
+    FlushStateToDisk();
+
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    {
+        LOCK(cs_main);
+        pcursor.reset(pcoinsdbview->Cursor());
+        hashBase = pcursor->GetBestBlock();
+        BlockMap::iterator mi = mapBlockIndex.find(hashBase);
+        if (mi == mapBlockIndex.end()) {
+            strError = "best block of the coin database is not in the block index";
+            return false;
+        }
+        nHeightBase = mi->second->nHeight;
+    }
+
+    FILE* file = fsbridge::fopen(path, "wb");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull()) {
+        strError = strprintf("Cannot open %s for writing", path.string());
+        return false;
+    }
+
+    fileout << FLATDATA(UTXO_SNAPSHOT_MAGIC);
+    fileout << UTXO_SNAPSHOT_VERSION;
+    fileout << hashBase;
+    fileout << nHeightBase;
+    // Placeholder for the coin count; patched once the cursor is exhausted.
+    long nCountPos = ftell(file);
+    nCoins = 0;
+    fileout << nCoins;
+
+    // The LevelDB cursor iterates a stable snapshot, so cs_main can be
+    // released while the (potentially very large) set is streamed out.
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        COutPoint key;
+        Coin coin;
+        if (!pcursor->GetKey(key) || !pcursor->GetValue(coin)) {
+            strError = "error reading the coin database";
+            return false;
+        }
+        fileout << key;
+        fileout << coin;
+        ++nCoins;
+        pcursor->Next();
+    }
+
+    if (fseek(file, nCountPos, SEEK_SET) != 0) {
+        strError = "error patching coin count";
+        return false;
+    }
+    fileout << nCoins;
+    FileCommit(file);
+
+    LogPrintf("%s: wrote %u coins at height %d (%s) to %s\n", __func__,
+              nCoins, nHeightBase, hashBase.ToString(), path.string());
+    return true;
+}
+
+bool LoadUTXOSnapshot(const fs::path& path, std::string& strError)
+{
+    CAutoFile filein(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        strError = strprintf("Cannot open %s for reading", path.string());
+        return false;
+    }
+
+    LOCK(cs_main);
+    try {
+        char pchMagic[8];
+        filein >> FLATDATA(pchMagic);
+        if (memcmp(pchMagic, UTXO_SNAPSHOT_MAGIC, sizeof(pchMagic)) != 0) {
+            strError = "not a UTXO snapshot file";
+            return false;
+        }
+        int nVersion;
+        filein >> nVersion;
+        if (nVersion > UTXO_SNAPSHOT_VERSION) {
+            strError = strprintf("unsupported snapshot version %d", nVersion);
+            return false;
+        }
+        uint256 hashBase;
+        int nHeightBase;
+        ::uint64_t nCoins;
+        filein >> hashBase;
+        filein >> nHeightBase;
+        filein >> nCoins;
+
+        BlockMap::iterator mi = mapBlockIndex.find(hashBase);
+        if (mi == mapBlockIndex.end()) {
+            strError = strprintf("snapshot base block %s is not in the block index; let the headers sync first and restart", hashBase.ToString());
+            return false;
+        }
+        CBlockIndex* pindexBase = mi->second;
+
+        if (!pcoinsTip->GetBestBlock().IsNull()) {
+            strError = "chainstate is not empty; a snapshot can only be loaded into a fresh node (or after -reindex-fast)";
+            return false;
+        }
+
+        LogPrintf("%s: loading %u coins at height %d (%s) from %s\n", __func__,
+                  nCoins, nHeightBase, hashBase.ToString(), path.string());
+
+        pcoinsTip->SetBestBlock(hashBase);
+        for (::uint64_t i = 0; i < nCoins; ++i) {
+            boost::this_thread::interruption_point();
+            COutPoint key;
+            Coin coin;
+            filein >> key;
+            filein >> coin;
+            pcoinsTip->AddCoin(key, std::move(coin), false);
+            if (pcoinsTip->DynamicMemoryUsage() > (size_t)nCoinCacheUsage) {
+                if (!pcoinsTip->Flush()) {
+                    strError = "failed to write to the coin database";
+                    return false;
+                }
+            }
+            if ((i + 1) % 1000000 == 0)
+                LogPrintf("%s: %u of %u coins loaded\n", __func__, i + 1, nCoins);
+        }
+        if (!pcoinsTip->Flush()) {
+            strError = "failed to write to the coin database";
+            return false;
+        }
+
+        // The snapshot chain is trusted the same way checkpointed history is:
+        // mark every ancestor as valid so block connection continues on top of
+        // the base, and give header-only entries a nonzero nChainTx (the real
+        // count is unknown without the block data; it only gates candidacy).
+        for (CBlockIndex* pindex = pindexBase; pindex != nullptr; pindex = pindex->pprev) {
+            if (pindex->nChainTx != 0 && pindex->IsValid(BLOCK_VALID_SCRIPTS))
+                break;
+            if (pindex->nChainTx == 0)
+                pindex->nChainTx = pindex->nHeight + 1;
+            pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
+            setDirtyBlockIndex.insert(pindex);
+        }
+        setBlockIndexCandidates.insert(pindexBase);
+    } catch (const std::exception& e) {
+        strError = strprintf("error reading snapshot - %s", e.what());
+        return false;
+    }
+
+    FlushStateToDisk();
+    return true;
+}
+
 CVerifyDB::CVerifyDB()
 {
     uiInterface.ShowProgress(_("Verifying blocks..."), 0);
@@ -3804,6 +4860,83 @@ CVerifyDB::~CVerifyDB()
     uiInterface.ShowProgress("", 100);
 }
 
+namespace {
+
+/** Shared state for the parallel part (levels 0-2) of VerifyDB. */
+struct CVerifyDBState
+{
+    const std::vector<CBlockIndex*>* pvBlocks;
+    const CChainParams* pchainparams;
+    int nCheckLevel;
+    // Watermark left by a previous clean run; blocks covered by it can skip
+    // the expensive per-block checks.
+    const CBlockIndex* pindexVerified;
+    int nVerifiedLow;
+    int nVerifiedLevel;
+    std::atomic<bool> fFailed;
+    std::atomic<size_t> nDone;
+
+    CVerifyDBState() : pvBlocks(nullptr), pchainparams(nullptr), nCheckLevel(0),
+        pindexVerified(nullptr), nVerifiedLow(0), nVerifiedLevel(0), fFailed(false), nDone(0) {}
+
+    bool AlreadyVerified(const CBlockIndex* pindex) const
+    {
+        return pindexVerified != nullptr &&
+               nVerifiedLevel >= std::min(nCheckLevel, 2) &&
+               pindex->nHeight >= nVerifiedLow &&
+               pindexVerified->GetAncestor(pindex->nHeight) == pindex;
+    }
+};
+
+/** Run levels 0-2 (disk read, block validity, undo validity) over every
+ *  nStride'th block of the range. These checks are independent per block, so
+ *  they shard cleanly across a thread pool; cs_main is held by the caller and
+ *  the block index is not mutated while we run. */
+void VerifyBlocksWorker(CVerifyDBState* pstate, size_t nStart, size_t nStride)
+{
+    const std::vector<CBlockIndex*>& vBlocks = *pstate->pvBlocks;
+    for (size_t i = nStart; i < vBlocks.size() && !pstate->fFailed; i += nStride)
+    {
+        CBlockIndex* pindex = vBlocks[i];
+        if (ShutdownRequested())
+            return;
+        if (pstate->AlreadyVerified(pindex)) {
+            ++pstate->nDone;
+            continue;
+        }
+        CBlock block;
+        CValidationState state;
+        // check level 0: read from disk
+        if (!ReadBlockFromDisk(block, pindex, pstate->pchainparams->GetConsensus())) {
+            error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+            pstate->fFailed = true;
+            return;
+        }
+        // check level 1: verify block validity
+        if (pstate->nCheckLevel >= 1 && !CheckBlock(block, state, pstate->pchainparams->GetConsensus())) {
+            error("VerifyDB(): *** found bad block at %d, hash=%s (%s)\n",
+                  pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
+            pstate->fFailed = true;
+            return;
+        }
+        // check level 2: verify undo validity
+        if (pstate->nCheckLevel >= 2) {
+            CBlockUndo undo;
+            CDiskBlockPos pos = pindex->GetUndoPos();
+            if (!pos.IsNull()) {
+                if (!UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash())) {
+                    error("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
+                    pstate->fFailed = true;
+                    return;
+                }
+            }
+        }
+        ++pstate->nDone;
+    }
+}
+
+} // namespace
+
 bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview, int nCheckLevel, int nCheckDepth)
 {
     LOCK(cs_main);
@@ -3824,44 +4957,71 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
 
     auto currentActiveTokenCache = GetCurrentTokenCache();
     CTokensCache tokenCache(*currentActiveTokenCache);
+
+    // Collect the range to verify, tip first.
+    std::vector<CBlockIndex*> vBlocks;
+    for (CBlockIndex* pindex = chainActive.Tip();
+         pindex && pindex->pprev && pindex->nHeight >= chainActive.Height() - nCheckDepth;
+         pindex = pindex->pprev)
+        vBlocks.push_back(pindex);
+
+    CVerifyDBState verifystate;
+    verifystate.pvBlocks = &vBlocks;
+    verifystate.pchainparams = &chainparams;
+    verifystate.nCheckLevel = nCheckLevel;
+
+    // A clean earlier run leaves a watermark behind; whatever part of the
+    // range it already covered at this level does not need re-checking.
+    uint256 hashVerified;
+    int nVerifiedLow = 0, nVerifiedLevel = 0;
+    if (pblocktree->ReadVerifyCheckpoint(hashVerified, nVerifiedLow, nVerifiedLevel)) {
+        BlockMap::iterator mi = mapBlockIndex.find(hashVerified);
+        if (mi != mapBlockIndex.end()) {
+            verifystate.pindexVerified = mi->second;
+            verifystate.nVerifiedLow = nVerifiedLow;
+            verifystate.nVerifiedLevel = nVerifiedLevel;
+        }
+    }
+
+    // Levels 0-2 are independent per block: shard them over the script
+    // verification threads while this thread reports progress.
     LogPrintf("[0%%]...");
-    for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev)
     {
-        boost::this_thread::interruption_point();
-        int percentageDone = std::max(1, std::min(99, (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100))));
-        if (reportDone < percentageDone/10) {
-            // report every 10% step
-            LogPrintf("[%d%%]...", percentageDone);
-            reportDone = percentageDone/10;
-        }
-        uiInterface.ShowProgress(_("Verifying blocks..."), percentageDone);
-        if (pindex->nHeight < chainActive.Height()-nCheckDepth)
-            break;
-        // TODO: Implement prune later
-//        if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
-//            // If pruning, only go back as far as we have data.
-//            LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
-//            break;
-//        }
-        CBlock block;
-        // check level 0: read from disk
-        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
-            return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-        // check level 1: verify block validity
-        if (nCheckLevel >= 1 && !CheckBlock(block, state, chainparams.GetConsensus()))
-            return error("%s: *** found bad block at %d, hash=%s (%s)\n", __func__,
-                         pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
-        // check level 2: verify undo validity
-        if (nCheckLevel >= 2 && pindex) {
-            CBlockUndo undo;
-            CDiskBlockPos pos = pindex->GetUndoPos();
-            if (!pos.IsNull()) {
-                if (!UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash()))
-                    return error("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
+        size_t nThreads = std::max(1, nScriptCheckThreads);
+        nThreads = std::min(nThreads, vBlocks.empty() ? (size_t)1 : vBlocks.size());
+        boost::thread_group workers;
+        for (size_t i = 1; i < nThreads; ++i)
+            workers.create_thread(boost::bind(&VerifyBlocksWorker, &verifystate, i, nThreads));
+        VerifyBlocksWorker(&verifystate, 0, nThreads);
+        while (!verifystate.fFailed && !ShutdownRequested() && verifystate.nDone < vBlocks.size()) {
+            int percentageDone = std::max(1, std::min(99, (int)((double)verifystate.nDone / (double)vBlocks.size() * (nCheckLevel >= 4 ? 50 : 100))));
+            if (reportDone < percentageDone/10) {
+                // report every 10% step
+                LogPrintf("[%d%%]...", percentageDone);
+                reportDone = percentageDone/10;
             }
+            uiInterface.ShowProgress(_("Verifying blocks..."), percentageDone);
+            boost::this_thread::sleep(boost::posix_time::milliseconds(100));
         }
-        // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
-        if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
+        workers.join_all();
+    }
+    if (verifystate.fFailed)
+        return false;
+    if (ShutdownRequested())
+        return true;
+
+    // check level 3: check for inconsistencies during memory-only disconnect
+    // of tip blocks. Disconnecting has to replay the chain state, so this
+    // stays sequential; it stops where the coins cache would overflow.
+    if (nCheckLevel >= 3) {
+        for (CBlockIndex* pindex : vBlocks)
+        {
+            boost::this_thread::interruption_point();
+            if (pindex != pindexState || (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) > nCoinCacheUsage)
+                break;
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
+                return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
             assert(coins.GetBestBlock() == pindex->GetBlockHash());
             DisconnectResult res = DisconnectBlock(block, pindex, coins, &tokenCache, true);
             if (res == DISCONNECT_FAILED) {
@@ -3874,9 +5034,9 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
             } else {
                 nGoodTransactions += block.vtx.size();
             }
+            if (ShutdownRequested())
+                return true;
         }
-        if (ShutdownRequested())
-            return true;
     }
     if (pindexFailure)
         return error("VerifyDB(): *** coin database inconsistencies found (last %i blocks, %i good transactions before that)\n", chainActive.Height() - pindexFailure->nHeight + 1, nGoodTransactions);
@@ -3896,6 +5056,12 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
         }
     }
 
+    // Leave a watermark so the next (clean) start skips the range we just
+    // covered. Only levels up to 2 are skippable per block.
+    pblocktree->WriteVerifyCheckpoint(chainActive.Tip()->GetBlockHash(),
+                                      std::max(1, chainActive.Height() - nCheckDepth),
+                                      std::min(nCheckLevel, 2));
+
     LogPrintf("[DONE].\n");
     LogPrintf("No coin database inconsistencies in last %i blocks (%i transactions)\n", chainActive.Height() - pindexState->nHeight, nGoodTransactions);
 
@@ -4092,6 +5258,7 @@ void UnloadBlockIndex()
     LOCK(cs_main);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(nullptr);
+    PublishChainSnapshot();
     pindexBestInvalid = nullptr;
     pindexBestHeader = nullptr;
     mempool.clear();
@@ -4107,8 +5274,8 @@ void UnloadBlockIndex()
         delete entry.second;
     }
     mapBlockIndex.clear();
-    // TODO: Implement prune later
-//    fHavePruned = false;
+    UnloadColdIndexData();
+    fHavePruned = false;
 }
 
 bool LoadBlockIndex(const CChainParams& chainparams)
@@ -4146,6 +5313,21 @@ bool LoadBlockIndex(const CChainParams& chainparams)
         fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
         pblocktree->WriteFlag("addressindex", fAddressIndex);
         LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
+
+        // A database built from scratch gets the balance rollups along with
+        // the address index itself
+        fAddressRollup = fAddressIndex;
+        pblocktree->WriteFlag("addressrollup", fAddressRollup);
+
+        // Use the provided setting for -spentindex in the new database
+        fSpentIndex = gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
+        pblocktree->WriteFlag("spentindex", fSpentIndex);
+        LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
+
+        // Use the provided setting for -blockfilterindex in the new database
+        fBlockFilterIndex = gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+        pblocktree->WriteFlag("blockfilterindex", fBlockFilterIndex);
+        LogPrintf("%s: compact filter index %s\n", __func__, fBlockFilterIndex ? "enabled" : "disabled");
         /** YAC_TOKEN END */
     }
     return true;
@@ -4158,10 +5340,16 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
     // Check whether we're already initialized by checking for genesis in
     // mapBlockIndex. Note that we can't use chainActive here, since it is
     // set based on the coins db, not the block index db, which is the only
-    // thing loaded at this point.
-    if (mapBlockIndex.count(chainparams.GenesisBlock().GetHash()))
+    // thing loaded at this point. The memoized hash from chainparams avoids
+    // recomputing the genesis pow hash on every restart.
+    if (mapBlockIndex.count(chainparams.GetConsensus().hashGenesisBlock))
         return true;
 
+    // First start with this datadir: re-derive the genesis pow hash once
+    // and check the compiled-in constant before the block hits the disk
+    if (!chainparams.VerifyGenesisBlock())
+        return error("%s: genesis block hash mismatch against chainparams", __func__);
+
     try {
         CBlock &block = const_cast<CBlock&>(chainparams.GenesisBlock());
         // Start new block file
@@ -4233,7 +5421,7 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
                 // SHA256 doesn't cost much cpu usage to calculate
                 uint256 hash;
                 uint256 sha256HashBlock = block.GetSHA256Hash();
-                std::map<uint256, uint256>::iterator mi = mapHash.find(sha256HashBlock);
+                auto mi = mapHash.find(sha256HashBlock);
                 if (mi != mapHash.end())
                 {
                     hash = (*mi).second;
@@ -4373,17 +5561,14 @@ void static CheckBlockIndex(const Consensus::Params& consensusParams)
         if (pindex->nChainTx == 0) assert(pindex->nSequenceId <= 0);  // nSequenceId can't be set positive for blocks that aren't linked (negative is used for preciousblock)
         // VALID_TRANSACTIONS is equivalent to nTx > 0 for all nodes (whether or not pruning has occurred).
         // HAVE_DATA is only equivalent to nTx > 0 (or VALID_TRANSACTIONS) if no pruning has occurred.
-        // TODO: Implement prune later
-//        if (!fHavePruned) {
-//            // If we've never pruned, then HAVE_DATA should be equivalent to nTx > 0
-//            assert(!(pindex->nStatus & BLOCK_HAVE_DATA) == (pindex->nTx == 0));
-//            assert(pindexFirstMissing == pindexFirstNeverProcessed);
-//        } else {
-//            // If we have pruned, then we can only say that HAVE_DATA implies nTx > 0
-//            if (pindex->nStatus & BLOCK_HAVE_DATA) assert(pindex->nTx > 0);
-//        }
-        assert(!(pindex->nStatus & BLOCK_HAVE_DATA) == (pindex->nTx == 0));
-        assert(pindexFirstMissing == pindexFirstNeverProcessed);
+        if (!fHavePruned) {
+            // If we've never pruned, then HAVE_DATA should be equivalent to nTx > 0
+            assert(!(pindex->nStatus & BLOCK_HAVE_DATA) == (pindex->nTx == 0));
+            assert(pindexFirstMissing == pindexFirstNeverProcessed);
+        } else {
+            // If we have pruned, then we can only say that HAVE_DATA implies nTx > 0
+            if (pindex->nStatus & BLOCK_HAVE_DATA) assert(pindex->nTx > 0);
+        }
         if (pindex->nStatus & BLOCK_HAVE_UNDO) assert(pindex->nStatus & BLOCK_HAVE_DATA);
         assert(((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TRANSACTIONS) == (pindex->nTx > 0)); // This is pruning-independent.
         // All parents having had data (at some point) is equivalent to all parents being VALID_TRANSACTIONS, which is equivalent to nChainTx being set.
@@ -4433,24 +5618,23 @@ void static CheckBlockIndex(const Consensus::Params& consensusParams)
         }
         if (!(pindex->nStatus & BLOCK_HAVE_DATA)) assert(!foundInUnlinked); // Can't be in mapBlocksUnlinked if we don't HAVE_DATA
         if (pindexFirstMissing == nullptr) assert(!foundInUnlinked); // We aren't missing data for any parent -- cannot be in mapBlocksUnlinked.
-        // TODO: Implement prune later
-//        if (pindex->pprev && (pindex->nStatus & BLOCK_HAVE_DATA) && pindexFirstNeverProcessed == nullptr && pindexFirstMissing != nullptr) {
-//            // We HAVE_DATA for this block, have received data for all parents at some point, but we're currently missing data for some parent.
-//            assert(fHavePruned); // We must have pruned.
-//            // This block may have entered mapBlocksUnlinked if:
-//            //  - it has a descendant that at some point had more work than the
-//            //    tip, and
-//            //  - we tried switching to that descendant but were missing
-//            //    data for some intermediate block between chainActive and the
-//            //    tip.
-//            // So if this block is itself better than chainActive.Tip() and it wasn't in
-//            // setBlockIndexCandidates, then it must be in mapBlocksUnlinked.
-//            if (!CBlockIndexWorkComparator()(pindex, chainActive.Tip()) && setBlockIndexCandidates.count(pindex) == 0) {
-//                if (pindexFirstInvalid == nullptr) {
-//                    assert(foundInUnlinked);
-//                }
-//            }
-//        }
+        if (pindex->pprev && (pindex->nStatus & BLOCK_HAVE_DATA) && pindexFirstNeverProcessed == nullptr && pindexFirstMissing != nullptr) {
+            // We HAVE_DATA for this block, have received data for all parents at some point, but we're currently missing data for some parent.
+            assert(fHavePruned); // We must have pruned.
+            // This block may have entered mapBlocksUnlinked if:
+            //  - it has a descendant that at some point had more work than the
+            //    tip, and
+            //  - we tried switching to that descendant but were missing
+            //    data for some intermediate block between chainActive and the
+            //    tip.
+            // So if this block is itself better than chainActive.Tip() and it wasn't in
+            // setBlockIndexCandidates, then it must be in mapBlocksUnlinked.
+            if (!CBlockIndexWorkComparator()(pindex, chainActive.Tip()) && setBlockIndexCandidates.count(pindex) == 0) {
+                if (pindexFirstInvalid == nullptr) {
+                    assert(foundInUnlinked);
+                }
+            }
+        }
         // assert(pindex->GetBlockHash() == pindex->GetBlockHeader().GetHash()); // Perhaps too slow
         // End: actual consistency checks.
 
@@ -4508,16 +5692,11 @@ std::string CBlockFileInfo::ToString() const
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
 
-bool LoadMempool(void)
+template <typename Stream>
+static bool LoadMempoolFromStream(Stream& file)
 {
     const CChainParams& chainparams = Params();
     int64_t nExpiryTimeout = gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60;
-    FILE* filestr = fsbridge::fopen(GetDataDir() / "mempool.dat", "rb");
-    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
-    if (file.IsNull()) {
-        LogPrintf("Failed to open mempool file from disk. Continuing anyway.\n");
-        return false;
-    }
 
     int64_t count = 0;
     int64_t skipped = 0;
@@ -4532,30 +5711,50 @@ bool LoadMempool(void)
         }
         uint64_t num;
         file >> num;
-        while (num--) {
+        // Deserialize and syntactically pre-check every entry before taking
+        // cs_main, so the pass over the whole file never holds up validation.
+        struct MempoolImportEntry {
             CTransactionRef tx;
             int64_t nTime;
             int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
+            bool fPreChecked;
+        };
+        std::vector<MempoolImportEntry> vEntries;
+        vEntries.reserve(std::min<uint64_t>(num, 100000));
+        while (num--) {
+            MempoolImportEntry e;
+            file >> e.tx;
+            file >> e.nTime;
+            file >> e.nFeeDelta;
+            CValidationState stateDummy;
+            e.fPreChecked = e.nTime + nExpiryTimeout > nNow &&
+                            PreCheckMemoryPoolTx(*e.tx, stateDummy, true /* fMempoolReload */);
+            vEntries.push_back(std::move(e));
+            if (ShutdownRequested())
+                return false;
+        }
+        // Take cs_main once for the whole import rather than once per
+        // transaction; nothing else needs the chain state this early in init.
+        LOCK(cs_main);
+        for (const MempoolImportEntry& e : vEntries) {
+            CAmount amountdelta = e.nFeeDelta;
             if (amountdelta) {
-                mempool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+                mempool.PrioritiseTransaction(e.tx->GetHash(), amountdelta);
+            }
+            if (e.nTime + nExpiryTimeout <= nNow) {
+                ++skipped;
+                continue;
+            }
+            if (!e.fPreChecked) {
+                ++failed;
+                continue;
             }
             CValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
-                LOCK(cs_main);
-                // static bool AcceptToMemoryPoolWithTime(const CChainParams& chainparams, CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx, bool* pfMissingInputs, int64_t nAcceptTime)
-                AcceptToMemoryPoolWithTime(chainparams, mempool, state, tx, nullptr, nTime);
-                if (state.IsValid()) {
-                    ++count;
-                } else {
-                    ++failed;
-                }
+            AcceptToMemoryPoolWithTime(chainparams, mempool, state, e.tx, nullptr, e.nTime, true /* fMempoolReload */, true /* fPreChecked */);
+            if (state.IsValid()) {
+                ++count;
             } else {
-                ++skipped;
+                ++failed;
             }
             if (ShutdownRequested())
                 return false;
@@ -4575,6 +5774,40 @@ bool LoadMempool(void)
     return true;
 }
 
+bool LoadMempool(void)
+{
+#ifndef WIN32
+    // Fast path: map the whole file and deserialize straight out of the
+    // mapping, avoiding per-item stdio buffering. Falls back to the buffered
+    // reader if the file cannot be mapped.
+    {
+        int fd = open((GetDataDir() / "mempool.dat").string().c_str(), O_RDONLY);
+        if (fd != -1) {
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                void* pchMap = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+                if (pchMap != MAP_FAILED) {
+                    close(fd);
+                    posix_madvise(pchMap, st.st_size, POSIX_MADV_SEQUENTIAL);
+                    CMemoryReadStream file(static_cast<const char*>(pchMap), st.st_size, SER_DISK, CLIENT_VERSION);
+                    bool ret = LoadMempoolFromStream(file);
+                    munmap(pchMap, st.st_size);
+                    return ret;
+                }
+            }
+            close(fd);
+        }
+    }
+#endif
+    FILE* filestr = fsbridge::fopen(GetDataDir() / "mempool.dat", "rb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        LogPrintf("Failed to open mempool file from disk. Continuing anyway.\n");
+        return false;
+    }
+    return LoadMempoolFromStream(file);
+}
+
 void DumpMempool(void)
 {
     int64_t start = GetTimeMicros();
@@ -4640,28 +5873,50 @@ CTokensCache* GetCurrentTokenCache()
 }
 
 bool GetAddressIndex(uint160 addressHash, int type,
-                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end, int nMaxEntries)
 {
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end, nMaxEntries))
         return error("unable to get txids for address");
 
     return true;
 }
 
 bool GetAddressIndex(uint160 addressHash, int type, std::string tokenName,
-                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end, int nMaxEntries)
 {
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, tokenName, addressIndex, start, end))
+    if (!pblocktree->ReadAddressIndex(addressHash, type, tokenName, addressIndex, start, end, nMaxEntries))
         return error("unable to get txids for address");
 
     return true;
 }
+
+bool GetAddressBalance(uint160 addressHash, int type, const std::string &tokenName, CAddressBalanceValue &value)
+{
+    if (!fAddressIndex || !fAddressRollup)
+        return error("address balance rollups not available");
+
+    if (!pblocktree->ReadAddressBalance(addressHash, type, tokenName, value))
+        return error("unable to get balance for address");
+
+    return true;
+}
+
+bool GetAddressBalances(uint160 addressHash, int type, std::vector<std::pair<std::string, CAddressBalanceValue> > &balances)
+{
+    if (!fAddressIndex || !fAddressRollup)
+        return error("address balance rollups not available");
+
+    if (!pblocktree->ReadAddressBalances(addressHash, type, balances))
+        return error("unable to get balances for address");
+
+    return true;
+}
 bool GetAddressUnspent(uint160 addressHash, int type, std::string tokenName,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
 {
@@ -4686,6 +5941,26 @@ bool GetAddressUnspent(uint160 addressHash, int type,
     return true;
 }
 
+bool GetSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value)
+{
+    if (!fSpentIndex)
+        return error("spent index not enabled");
+
+    // An absent record is the normal answer for an unspent output
+    return pblocktree->ReadSpentIndex(key, value);
+}
+
+bool GetBlockFilter(const uint256 &hashBlock, uint256 &header, std::vector<unsigned char> &filter)
+{
+    if (!fBlockFilterIndex)
+        return error("compact filter index not enabled");
+
+    if (!pblocktree->ReadBlockFilter(hashBlock, filter))
+        return false;
+
+    return pblocktree->ReadBlockFilterHeader(hashBlock, header);
+}
+
 //! Guess how far we are in the verification process at the given block index
 double GuessVerificationProgress(const ChainTxData& data, CBlockIndex *pindex) {
     if (pindex == nullptr)
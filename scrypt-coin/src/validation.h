@@ -29,6 +29,7 @@
 #include "timestamps.h"
 
 #include "addressindex.h"
+#include "spentindex.h"
 #include "tokens/tokentypes.h"
 #include "tokens/tokendb.h"
 #include "tokens/tokens.h"
@@ -47,6 +48,7 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
 class CChainParams;
 class CCoinsViewDB;
 class CInv;
@@ -77,8 +79,10 @@ static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
  *  less than this number, we reached their tip. Changing this value is a protocol upgrade. */
 static unsigned int MAX_HEADERS_RESULTS = 2000;
 
-/** Maximum number of script-checking threads allowed */
-static const int MAX_SCRIPTCHECK_THREADS = 16;
+/** Maximum number of script-checking threads allowed. The work-stealing
+ *  check queue keeps scaling well past 8 threads, so let big validators
+ *  use their cores. */
+static const int MAX_SCRIPTCHECK_THREADS = 32;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
 /** Number of blocks that can be requested at any given time from a single peer. */
@@ -96,6 +100,9 @@ extern unsigned int HEADER_BLOCK_DIFFERENCES_TRIGGER_GETBLOCKS; //default = 1000
  *  when requested. For older blocks, a regular BLOCK response will be sent. */
 static const int MAX_CMPCTBLOCK_DEPTH = 5;
 
+/** Maximum depth of blocks we're willing to respond to GETBLOCKTXN requests for. */
+static const int MAX_BLOCKTXN_DEPTH = 10;
+
 /** Time to wait (in seconds) between writing blocks/block index to disk. */
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60; // 60 * 60 for Bitcoin
 /** Time to wait (in seconds) between flushing chainstate to disk. */
@@ -150,6 +157,8 @@ static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = true; // ppcoin: txindex is required for PoS calculations (might change in the future)
 static const bool DEFAULT_TOKENINDEX = false;
 static const bool DEFAULT_ADDRESSINDEX = false;
+static const bool DEFAULT_SPENTINDEX = false;
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
 static const bool DEFAULT_BLOCKHASHINDEX = true; // yac: blockhashindex is necessary to avoid recalculating block hash (very slow !!!) when reading block data from disk
 
 /** Default for -stopatheight */
@@ -183,6 +192,11 @@ extern uint64_t nLastBlockTx;
 extern uint64_t nLastBlockSize;
 /** The currently-connected chain of blocks (protected by cs_main). */
 extern CChain chainActive;
+/** Return a lock-free snapshot of the active chain. The tip pointer is
+ *  republished atomically on every tip change, so the returned view is
+ *  internally consistent without cs_main; it may lag the live chain by the
+ *  blocks connected since it was taken. */
+CChainSnapshot GetChainSnapshot();
 // Best header we've seen so far (used for getheaders queries' starting points).
 extern CBlockIndex *pindexBestHeader;
 extern const std::string strMessageMagic;
@@ -195,7 +209,16 @@ extern bool fTxIndex;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+/** Block hash whose ancestors we assume to have valid scripts. Defaults to
+ *  the last compiled-in checkpoint; override with -assumevalid (0 disables). */
+extern uint256 hashAssumeValid;
 extern bool fBlockHashIndex;
+/** True if any block files have ever been pruned. */
+extern bool fHavePruned;
+/** True if we're running in -prune mode. */
+extern bool fPruneMode;
+/** Number of bytes of block files that we're trying to stay under. */
+extern uint64_t nPruneTarget;
 /** A fee rate smaller than this is considered zero fee (for relaying, mining and transaction creation) */
 extern CFeeRate minRelayTxFee;
 /** Absolute maximum transaction fee (in satoshis) used by wallet and mempool (rejects high fee in sendrawtransaction) */
@@ -228,6 +251,10 @@ extern CTokensCache *ptokens;
 extern CLRUCache<std::string, CDatabasedTokenData> *ptokensCache;
 extern bool fTokenIndex;
 extern bool fAddressIndex;
+//! Whether the per-(address, token) balance rollups exist in this database
+extern bool fAddressRollup;
+extern bool fSpentIndex;
+extern bool fBlockFilterIndex;
 //
 // END OF GLOBAL VARIABLES USED FOR TOKEN MANAGEMENT SYSTEM
 //
@@ -244,6 +271,16 @@ const ::uint32_t
 /** Block files containing a block-height within MIN_BLOCKS_TO_KEEP of chainActive.Tip() will not be pruned. */
 static const unsigned int MIN_BLOCKS_TO_KEEP = 288;
 
+// Require that user allocate at least 550MB for block & undo files (blk???.dat and rev???.dat)
+// At 1MB per block, 288 blocks = 288MB.
+// Add 15% for Undo data = 331MB
+// Add 20% for Orphan block rate = 397MB
+// We want the low water mark after pruning to be at least 397 MB and since we prune in
+// full block file chunks, we need the high water mark which triggers the prune to be
+// one 128MB block file + added 15% undo data = 147MB greater for a total of 545MB
+// Plus the check threshold is one hundredth of the high water mark = 550MB
+static const uint64_t MIN_DISK_SPACE_FOR_BLOCK_FILES = 550 * 1024 * 1024;
+
 static const signed int DEFAULT_CHECKBLOCKS = 60;
 static const unsigned int DEFAULT_CHECKLEVEL = 3;
 /**
@@ -295,6 +332,13 @@ bool LoadGenesisBlock(const CChainParams& chainparams);
 bool LoadBlockIndex(const CChainParams& chainparams);
 /** Update the chain tip based on database information. */
 bool LoadChainTip(const CChainParams& chainparams);
+
+/** Write the full UTXO set as of the current tip to a snapshot file. */
+bool DumpUTXOSnapshot(const fs::path& path, uint256& hashBase, int& nHeightBase, ::uint64_t& nCoins, std::string& strError);
+/** Load a snapshot written by DumpUTXOSnapshot into a fresh chainstate, so the
+ *  node starts validating from the snapshot base instead of replaying the
+ *  whole chain. Must run before LoadChainTip. */
+bool LoadUTXOSnapshot(const fs::path& path, std::string& strError);
 /** Load block reward and highest difficulty when starting node */
 void LoadBlockRewardAndHighestDiff();
 /** Unload database information */
@@ -303,6 +347,9 @@ void UnloadBlockIndex();
 void ThreadScriptCheck();
 // Stop the script checking threads
 void ThreadScriptCheckQuit();
+/** Build the transaction index for the already-synced chain in the background,
+ *  so enabling -txindex does not require a reindex */
+void ThreadTxIndexBuild();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
@@ -313,15 +360,41 @@ bool ActivateBestChain(CValidationState& state, const CChainParams& chainparams,
 /** Guess verification progress (as a fraction between 0.0=genesis and 1.0=current tip). */
 double GuessVerificationProgress(const ChainTxData& data, CBlockIndex* pindex);
 
+/** Calculate the amount of disk space the block & undo files currently use */
+uint64_t CalculateCurrentUsage();
+
+/**
+ *  Mark one block file as pruned.
+ */
+void PruneOneBlockFile(const int fileNumber);
+
+/**
+ *  Actually unlink the specified files
+ */
+void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune);
+
 /** Create a new block index entry for a given block hash */
 CBlockIndex* InsertBlockIndex(uint256 hash);
 /** Flush all state, indexes and buffers to disk. */
 void FlushStateToDisk();
+/** Prune block files and flush state to disk. */
+void PruneAndFlush();
+/** Prune block files up to a given height */
+void PruneBlockFilesManual(int nManualPruneHeight);
 
 /** (try to) add transaction to memory pool
  * plTxnReplaced will be appended to with all transactions replaced from mempool **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx, bool* pfMissingInputs);
 
+/** (try to) add a batch of transactions to the memory pool. The syntactic
+ * checks run before cs_main is taken, so only candidates that survive them
+ * contend with block validation; the survivors are then committed under a
+ * single cs_main critical section with one state flush for the whole batch.
+ * vstate (and *pvMissingInputs, if given) are resized to match vtx.
+ * Returns the number of accepted transactions. **/
+int AcceptToMemoryPoolBatch(CTxMemPool& pool, const std::vector<CTransactionRef>& vtx,
+                            std::vector<CValidationState>& vstate, std::vector<bool>* pvMissingInputs = nullptr);
+
 /** Convert CValidationState to a human-readable message for logging */
 std::string FormatStateMessage(const CValidationState &state);
 
@@ -370,11 +443,12 @@ private:
     unsigned int nFlags;
     bool cacheStore;
     ScriptError error;
+    const PrecomputedTransactionData *txdata;
 
 public:
-    CScriptCheck(): ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR) {}
-    CScriptCheck(const CScript& scriptPubKeyIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn) :
-        scriptPubKey(scriptPubKeyIn), ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR) { }
+    CScriptCheck(): ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(nullptr) {}
+    CScriptCheck(const CScript& scriptPubKeyIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, const PrecomputedTransactionData* txdataIn) :
+        scriptPubKey(scriptPubKeyIn), ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn) { }
 
     bool operator()();
 
@@ -385,6 +459,7 @@ public:
         std::swap(nFlags, check.nFlags);
         std::swap(cacheStore, check.cacheStore);
         std::swap(error, check.error);
+        std::swap(txdata, check.txdata);
     }
 
     ScriptError GetScriptError() const { return error; }
@@ -396,6 +471,20 @@ void InitScriptExecutionCache();
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Hint the OS to start paging in the block at pos, without blocking. Lets a
+ *  block-serving loop overlap the disk latency of the next requested block
+ *  with serializing and sending the current one. No-op on Windows. */
+void PrefetchBlockFromDisk(const CDiskBlockPos& pos);
+/** Queue outpoints for the background coins-prefetch thread, which reads
+ *  them from the coins DB to warm its caches ahead of ConnectBlock. Used
+ *  when a compact block announcement reveals a tip candidate's likely
+ *  transactions before the full block arrives. */
+void PrefetchCoins(std::vector<COutPoint>&& vOutpoints);
+/** Run the coins-prefetch worker */
+void ThreadCoinsPrefetch();
+void ThreadCoinsPrefetchQuit();
+/** Functions for disk access for undo data */
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -440,14 +529,23 @@ bool AreTokensDeployed();
 CTokensCache* GetCurrentTokenCache();
 bool GetAddressIndex(uint160 addressHash, int type, std::string tokenName,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                     int start = 0, int end = 0);
+                     int start = 0, int end = 0, int nMaxEntries = -1);
 bool GetAddressIndex(uint160 addressHash, int type,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                     int start = 0, int end = 0);
+                     int start = 0, int end = 0, int nMaxEntries = -1);
+/** Point-read the materialized balance rollup of one (address, token) pair
+ *  (requires a database built with -addressindex since the rollups exist). */
+bool GetAddressBalance(uint160 addressHash, int type, const std::string &tokenName, CAddressBalanceValue &value);
+/** Read the balance rollups of every token held by an address. */
+bool GetAddressBalances(uint160 addressHash, int type, std::vector<std::pair<std::string, CAddressBalanceValue> > &balances);
 bool GetAddressUnspent(uint160 addressHash, int type, std::string tokenName,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+/** Look up which transaction spent the given output (requires -spentindex) */
+bool GetSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value);
+/** Look up the compact filter and filter header for a block (requires -blockfilterindex) */
+bool GetBlockFilter(const uint256 &hashBlock, uint256 &header, std::vector<unsigned char> &filter);
 //
 // END OF FUNCTIONS USED FOR TOKEN MANAGEMENT SYSTEM
 //
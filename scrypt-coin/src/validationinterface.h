@@ -26,11 +26,22 @@ class CScheduler;
 
 /** Register a wallet to receive updates from core */
 void RegisterValidationInterface(CValidationInterface* pwalletIn);
-/** Unregister a wallet from core */
+/** Unregister a wallet from core. Note that queued notifications may still
+ *  reference the listener: call CMainSignals::FlushBackgroundCallbacks()
+ *  before destroying it. */
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
 void UnregisterAllValidationInterfaces();
 
+/**
+ * Implement this to subscribe to events generated in validation.
+ *
+ * Apart from BlockChecked and NewPoWValidBlock, which fire synchronously on
+ * the validation thread, notifications are delivered in order on the
+ * background scheduler thread, after the generating call has released
+ * cs_main. Listeners must therefore take whatever locks they need
+ * themselves and tolerate notifications that lag the live chain slightly.
+ */
 class CValidationInterface {
 protected:
     /** Notifies listeners of updated block chain tip */
@@ -7,6 +7,7 @@
 
 #include "crypto/aes.h"
 #include "crypto/sha512.h"
+#include "net_processing.h"
 #include "script/script.h"
 #include "script/standard.h"
 #include "util.h"
@@ -14,6 +15,9 @@
 #include <string>
 #include <vector>
 
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
 int CCrypter::BytesToKeySHA512AES(const std::vector<unsigned char>& chSalt, const SecureString& strKeyData, int count, unsigned char *key,unsigned char *iv) const
 {
     // This mimics the behavior of openssl's EVP_BytesToKey with an aes256cbc
@@ -143,6 +147,33 @@ static bool DecryptKey(const CKeyingMaterial& vMasterKey, const std::vector<unsi
     return key.VerifyPubKey(vchPubKey);
 }
 
+namespace {
+//! One worker's share of the first-unlock verification of all crypted keys.
+struct CCryptedKeyCheckSlice
+{
+    std::vector<const CryptedKeyMap::value_type*> vKeys;
+    bool fKeyPass;
+    bool fKeyFail;
+    CCryptedKeyCheckSlice() : fKeyPass(false), fKeyFail(false) {}
+};
+
+void CheckCryptedKeySlice(const CKeyingMaterial* pMasterKey, CCryptedKeyCheckSlice* pSlice)
+{
+    for (size_t i = 0; i < pSlice->vKeys.size(); i++)
+    {
+        const CPubKey &vchPubKey = pSlice->vKeys[i]->second.first;
+        const std::vector<unsigned char> &vchCryptedSecret = pSlice->vKeys[i]->second.second;
+        CKey key;
+        if (!DecryptKey(*pMasterKey, vchCryptedSecret, vchPubKey, key))
+        {
+            pSlice->fKeyFail = true;
+            return;
+        }
+        pSlice->fKeyPass = true;
+    }
+}
+} // namespace
+
 bool CCryptoKeyStore::SetCrypted()
 {
     LOCK(cs_KeyStore);
@@ -177,20 +208,44 @@ bool CCryptoKeyStore::Unlock(const CKeyingMaterial& vMasterKeyIn)
 
         bool keyPass = false;
         bool keyFail = false;
-        CryptedKeyMap::const_iterator mi = mapCryptedKeys.begin();
-        for (; mi != mapCryptedKeys.end(); ++mi)
+        if (!fDecryptionThoroughlyChecked && mapCryptedKeys.size() > 1)
         {
-            const CPubKey &vchPubKey = (*mi).second.first;
-            const std::vector<unsigned char> &vchCryptedSecret = (*mi).second.second;
-            CKey key;
-            if (!DecryptKey(vMasterKeyIn, vchCryptedSecret, vchPubKey, key))
+            // The first unlock after load verifies every crypted key. Each
+            // decryption only depends on the master key, so slice the map up
+            // and check the slices in parallel.
+            size_t nThreads = (size_t)std::max(1, nHashCalcThreads);
+            std::vector<CCryptedKeyCheckSlice> vSlices(nThreads);
+            size_t nKey = 0;
+            for (CryptedKeyMap::const_iterator mi = mapCryptedKeys.begin(); mi != mapCryptedKeys.end(); ++mi)
+                vSlices[nKey++ % nThreads].vKeys.push_back(&(*mi));
+            boost::thread_group workers;
+            for (size_t i = 1; i < vSlices.size(); i++)
+                workers.create_thread(boost::bind(&CheckCryptedKeySlice, &vMasterKeyIn, &vSlices[i]));
+            CheckCryptedKeySlice(&vMasterKeyIn, &vSlices[0]);
+            workers.join_all();
+            for (size_t i = 0; i < vSlices.size(); i++)
+            {
+                keyPass |= vSlices[i].fKeyPass;
+                keyFail |= vSlices[i].fKeyFail;
+            }
+        }
+        else
+        {
+            CryptedKeyMap::const_iterator mi = mapCryptedKeys.begin();
+            for (; mi != mapCryptedKeys.end(); ++mi)
             {
-                keyFail = true;
-                break;
+                const CPubKey &vchPubKey = (*mi).second.first;
+                const std::vector<unsigned char> &vchCryptedSecret = (*mi).second.second;
+                CKey key;
+                if (!DecryptKey(vMasterKeyIn, vchCryptedSecret, vchPubKey, key))
+                {
+                    keyFail = true;
+                    break;
+                }
+                keyPass = true;
+                if (fDecryptionThoroughlyChecked)
+                    break;
             }
-            keyPass = true;
-            if (fDecryptionThoroughlyChecked)
-                break;
         }
         if (keyPass && keyFail)
         {
@@ -235,6 +290,7 @@ bool CCryptoKeyStore::AddCryptedKey(const CPubKey &vchPubKey, const std::vector<
             return false;
 
         mapCryptedKeys[vchPubKey.GetID()] = make_pair(vchPubKey, vchCryptedSecret);
+        IndexScriptsForKey(vchPubKey);
     }
     return true;
 }
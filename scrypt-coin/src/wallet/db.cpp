@@ -80,6 +80,9 @@ void CDBEnv::Reset()
     dbenv = new DbEnv(DB_CXX_NO_EXCEPTIONS);
     fDbEnvInit = false;
     fMockDb = false;
+    fGroupCommit = false;
+    nGroupFlushRequested = 0;
+    nGroupFlushCompleted = 0;
 }
 
 CDBEnv::CDBEnv() : dbenv(nullptr)
@@ -126,6 +129,10 @@ bool CDBEnv::Open(const fs::path& pathIn)
     dbenv->set_flags(DB_AUTO_COMMIT, 1);
     dbenv->set_flags(DB_TXN_WRITE_NOSYNC, 1);
     dbenv->log_set_config(DB_LOG_AUTO_REMOVE, 1);
+    // Commits already skip the per-transaction fsync (DB_TXN_WRITE_NOSYNC
+    // above); group-commit mode additionally defers the per-close checkpoint
+    // so busy wallets pay one fsync per flush interval, not per write
+    fGroupCommit = gArgs.GetBoolArg("-walletgroupcommit", DEFAULT_WALLET_GROUPCOMMIT);
     int ret = dbenv->open(strPath.c_str(),
                          DB_CREATE |
                              DB_INIT_LOCK |
@@ -460,6 +467,13 @@ void CDB::Flush()
     if (activeTxn)
         return;
 
+    // In group-commit mode the checkpoint (and its fsync) is paid once per
+    // GroupFlush() or DurabilityBarrier() instead of once per close
+    if (env->fGroupCommit && !fReadOnly) {
+        env->nGroupFlushRequested.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
     // Flush database activity from memory pool to disk log
     unsigned int nMinutes = 0;
     if (fReadOnly)
@@ -468,11 +482,46 @@ void CDB::Flush()
     env->dbenv->txn_checkpoint(nMinutes ? gArgs.GetArg("-dblogsize", DEFAULT_WALLET_DBLOGSIZE) * 1024 : 0, nMinutes, 0);
 }
 
+void CDBEnv::GroupFlush()
+{
+    if (!fDbEnvInit || fMockDb)
+        return;
+    uint64_t nRequested = nGroupFlushRequested.load();
+    if (nRequested == nGroupFlushCompleted.load())
+        return;
+    dbenv->txn_checkpoint(0, 0, 0);
+    nGroupFlushCompleted.store(nRequested);
+}
+
+void CDBEnv::DurabilityBarrier()
+{
+    if (!fDbEnvInit || fMockDb || !fGroupCommit)
+        return;
+    // Unconditional checkpoint: writes issued through handles opened with
+    // fFlushOnClose=false never bump nGroupFlushRequested but must still be
+    // on disk before the caller reports success
+    uint64_t nRequested = nGroupFlushRequested.load();
+    dbenv->txn_checkpoint(0, 0, 0);
+    nGroupFlushCompleted.store(nRequested);
+}
+
 void CWalletDBWrapper::IncrementUpdateCounter()
 {
     ++nUpdateCounter;
 }
 
+void CWalletDBWrapper::GroupFlush()
+{
+    if (env)
+        env->GroupFlush();
+}
+
+void CWalletDBWrapper::DurabilityBarrier()
+{
+    if (env)
+        env->DurabilityBarrier();
+}
+
 void CDB::Close()
 {
     if (!pdb)
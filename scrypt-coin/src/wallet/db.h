@@ -23,6 +23,7 @@
 
 static const unsigned int DEFAULT_WALLET_DBLOGSIZE = 100;
 static const bool DEFAULT_WALLET_PRIVDB = true;
+static const bool DEFAULT_WALLET_GROUPCOMMIT = false;
 
 class CDBEnv
 {
@@ -41,6 +42,22 @@ public:
     std::map<std::string, int> mapFileUseCount;
     std::map<std::string, Db*> mapDb;
 
+    //! Group-commit mode (-walletgroupcommit). Transaction commits already
+    //! stay in the log buffer via DB_TXN_WRITE_NOSYNC; in this mode the
+    //! per-close checkpoint in CDB::Flush is deferred too, so the periodic
+    //! GroupFlush() and the DurabilityBarrier() before a send reports
+    //! success batch many wallet writes into one fsync.
+    bool fGroupCommit;
+    std::atomic<uint64_t> nGroupFlushRequested;
+    std::atomic<uint64_t> nGroupFlushCompleted;
+
+    //! Checkpoint the environment if any deferred flushes are pending.
+    //! Driven on the wallet scheduler timer in group-commit mode.
+    void GroupFlush();
+    //! Make every wallet write issued so far durable on disk, so the safety
+    //! point a caller observes is the same as without group-commit mode.
+    void DurabilityBarrier();
+
     CDBEnv();
     ~CDBEnv();
     void Reset();
@@ -122,6 +139,12 @@ public:
      */
     void Flush(bool shutdown);
 
+    /** Checkpoint deferred group-commit writes, if any. */
+    void GroupFlush();
+
+    /** Block until every write issued so far is durable on disk. */
+    void DurabilityBarrier();
+
     void IncrementUpdateCounter();
 
     std::atomic<unsigned int> nUpdateCounter;
@@ -338,11 +361,11 @@ public:
         return true;
     }
 
-    bool TxnCommit()
+    bool TxnCommit(bool fSync = false)
     {
         if (!pdb || !activeTxn)
             return false;
-        int ret = activeTxn->commit(0);
+        int ret = activeTxn->commit(fSync ? DB_TXN_SYNC : 0);
         activeTxn = nullptr;
         return (ret == 0);
     }
@@ -421,14 +421,16 @@ UniValue getaddressesbyaccount(const JSONRPCRequest& request)
 
     std::string strAccount = AccountFromValue(request.params[0]);
 
-    // Find all addresses that have the given account
+    // Find all addresses that have the given account, then encode them in
+    // one batch so the checksum hashing can use the multi-buffer SHA256
     UniValue ret(UniValue::VARR);
+    std::vector<const CBase58Data*> vAddresses;
     for (const std::pair<CBitcoinAddress, CAddressBookData>& item : pwallet->mapAddressBook) {
-        const CBitcoinAddress& address = item.first;
-        const std::string& strName = item.second.name;
-        if (strName == strAccount)
-            ret.push_back(address.ToString());
+        if (item.second.name == strAccount)
+            vAddresses.push_back(&item.first);
     }
+    for (const std::string& strAddress : CBase58Data::ToStringBatch(vAddresses))
+        ret.push_back(strAddress);
     return ret;
 }
 
@@ -2421,11 +2423,14 @@ UniValue listsinceblock(const JSONRPCRequest& request)
 
     UniValue transactions(UniValue::VARR);
 
-    for (const std::pair<uint256, CWalletTx>& pairWtx : pwallet->mapWallet) {
-        CWalletTx tx = pairWtx.second;
-
-        if (depth == -1 || tx.GetDepthInMainChain() < depth) {
-            ListTransactions(pwallet, tx, "*", 0, true, transactions, filter);
+    // Cursor the wallet's height index from the fork point instead of
+    // scanning (and copying) the whole transaction map; the cost is
+    // proportional to the transactions reported, not to the wallet size.
+    std::vector<const CWalletTx*> vWtx;
+    pwallet->GetWtxAboveHeight(pindex ? pindex->nHeight : -1, vWtx);
+    for (const CWalletTx* pwtx : vWtx) {
+        if (depth == -1 || pwtx->GetDepthInMainChain() < depth) {
+            ListTransactions(pwallet, *pwtx, "*", 0, true, transactions, filter);
         }
     }
 
@@ -670,6 +670,86 @@ void CWallet::AddToSpends(const uint256& wtxid)
         AddToSpends(txin.prevout, wtxid);
 }
 
+void CWallet::UpdateSpendableIndex(const uint256& hashTx) const
+{
+    AssertLockHeld(cs_wallet);
+
+    std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hashTx);
+    if (it == mapWallet.end()) {
+        setSpendableTxs.erase(hashTx);
+        return;
+    }
+
+    const CWalletTx& wtx = it->second;
+    bool fLive = false;
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+        if (IsSpent(hashTx, i))
+            continue;
+        if (IsMine(wtx.tx->vout[i]) != ISMINE_NO) {
+            fLive = true;
+            break;
+        }
+    }
+    if (fLive)
+        setSpendableTxs.insert(hashTx);
+    else
+        setSpendableTxs.erase(hashTx);
+}
+
+void CWallet::UpdateHeightIndex(const uint256& hashTx) const
+{
+    AssertLockHeld(cs_wallet);
+
+    std::map<uint256, std::multimap<int, uint256>::iterator>::iterator posIt = mapWtxHeightPos.find(hashTx);
+    if (posIt != mapWtxHeightPos.end()) {
+        mapWtxByHeight.erase(posIt->second);
+        mapWtxHeightPos.erase(posIt);
+    }
+
+    std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(hashTx);
+    if (it == mapWallet.end())
+        return;
+
+    const CWalletTx& wtx = it->second;
+    int nIndexHeight = -1;
+    if (!wtx.hashUnset()) {
+        BlockMap::const_iterator mi = mapBlockIndex.find(wtx.hashBlock);
+        if (mi != mapBlockIndex.end() && chainActive.Contains(mi->second))
+            nIndexHeight = mi->second->nHeight;
+    }
+    mapWtxHeightPos[hashTx] = mapWtxByHeight.insert(std::make_pair(nIndexHeight, hashTx));
+}
+
+void CWallet::GetWtxAboveHeight(int nHeight, std::vector<const CWalletTx*>& vWtx) const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    if (!fHeightIndexValid) {
+        mapWtxByHeight.clear();
+        mapWtxHeightPos.clear();
+        for (const auto& entry : mapWallet)
+            UpdateHeightIndex(entry.first);
+        fHeightIndexValid = true;
+    }
+
+    // Unconfirmed, conflicted and abandoned entries are filed under -1 and
+    // always qualify; they precede the confirmed range in the multimap.
+    for (std::multimap<int, uint256>::const_iterator it = mapWtxByHeight.begin();
+         it != mapWtxByHeight.end() && it->first < 0; ++it) {
+        std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(it->second);
+        if (mi != mapWallet.end())
+            vWtx.push_back(&mi->second);
+    }
+    // Then cursor the confirmed entries from the first block above nHeight.
+    for (std::multimap<int, uint256>::const_iterator it = mapWtxByHeight.upper_bound(std::max(nHeight, -1));
+         it != mapWtxByHeight.end(); ++it) {
+        std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(it->second);
+        if (mi != mapWallet.end())
+            vWtx.push_back(&mi->second);
+    }
+}
+
 bool CWallet::EncryptWallet(const SecureString& strWalletPassphrase)
 {
     if (IsCrypted())
@@ -1030,7 +1110,12 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 {
     LOCK(cs_wallet);
 
-    CWalletDB walletdb(*dbw, "r+", fFlushOnClose);
+    // Route the writes through the per-block batch when one is open, so a
+    // connected block commits once for all of its transactions.
+    std::unique_ptr<CWalletDB> pwalletdbLocal;
+    if (!pwalletdbBlockBatch)
+        pwalletdbLocal.reset(new CWalletDB(*dbw, "r+", fFlushOnClose));
+    CWalletDB& walletdb = pwalletdbBlockBatch ? *pwalletdbBlockBatch : *pwalletdbLocal;
 
     uint256 hash = wtxIn.GetHash();
     // Inserts only if not already there, returns tx inserted or tx found
@@ -1086,6 +1171,19 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
     // Break debit/credit balance caches:
     wtx.MarkDirty();
 
+    // Keep the live-output index in step: this transaction may carry new
+    // unspent outputs of ours, and its inputs may have fully spent earlier
+    // transactions.
+    if (fSpendableIndexValid) {
+        UpdateSpendableIndex(hash);
+        for (const CTxIn& txin : wtx.tx->vin)
+            UpdateSpendableIndex(txin.prevout.hash);
+    }
+    // ... and re-file it in the height index, as confirmation (or a reorg
+    // stripping one) changes its containing block.
+    if (fHeightIndexValid)
+        UpdateHeightIndex(hash);
+
     // Notify UI of new or updated transaction
     NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
@@ -1217,6 +1315,12 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
         return false;
     }
 
+    // Spent-ness of whole chains of transactions may change; rebuild the
+    // live-output index lazily. The same goes for the height index, as the
+    // affected transactions change containing block without AddToWallet.
+    fSpendableIndexValid = false;
+    fHeightIndexValid = false;
+
     todo.insert(hashTx);
 
     while (!todo.empty()) {
@@ -1277,7 +1381,15 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
         return;
 
     // Do not flush the wallet here for performance reasons
-    CWalletDB walletdb(*dbw, "r+", false);
+    std::unique_ptr<CWalletDB> pwalletdbLocal;
+    if (!pwalletdbBlockBatch)
+        pwalletdbLocal.reset(new CWalletDB(*dbw, "r+", false));
+    CWalletDB& walletdb = pwalletdbBlockBatch ? *pwalletdbBlockBatch : *pwalletdbLocal;
+
+    // Spent-ness of whole chains of transactions may change; rebuild the
+    // live-output index lazily, and the height index with it.
+    fSpendableIndexValid = false;
+    fHeightIndexValid = false;
 
     std::set<uint256> todo;
     std::set<uint256> done;
@@ -1348,12 +1460,27 @@ void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const
     // to abandon a transaction and then have it inadvertently cleared by
     // the notification that the conflicted transaction was evicted.
 
+    // Accumulate all of this block's wallet writes in one database
+    // transaction: a block with many wallet-relevant transactions then costs
+    // a single commit (and at most one sync, see -walletblocksync) instead
+    // of one flush per transaction. If the transaction cannot be opened,
+    // fall back to the per-write commits.
+    CWalletDB walletdb(*dbw, "r+", false);
+    if (walletdb.TxnBegin())
+        pwalletdbBlockBatch = &walletdb;
+
     for (const CTransactionRef& ptx : vtxConflicted) {
         SyncTransaction(ptx);
     }
     for (size_t i = 0; i < pblock->vtx.size(); i++) {
         SyncTransaction(MakeTransactionRef(std::move(pblock->vtx[i])), pindex, i);
     }
+
+    if (pwalletdbBlockBatch) {
+        pwalletdbBlockBatch = nullptr;
+        if (!walletdb.TxnCommit(gArgs.GetBoolArg("-walletblocksync", DEFAULT_WALLETBLOCKSYNC)))
+            LogPrintf("%s: failed to commit wallet writes for block %s\n", __func__, pindex->GetBlockHash().ToString());
+    }
 }
 
 void CWallet::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) {
@@ -1810,11 +1937,54 @@ int64_t CWallet::RescanFromTime(int64_t startTime, bool update)
     return startTime;
 }
 
+namespace {
+
+/** Per-worker output of one rescan window slice: the blocks as read from
+ *  disk, plus a per-transaction flag for transactions with an output that
+ *  pays into the keystore. */
+struct CWalletScanSlice
+{
+    std::vector<CBlockIndex*> vBlocks;
+    std::vector<CBlock> vBlockData;
+    std::vector<std::vector<bool> > vIsMine;
+    std::vector<bool> vReadFailed;
+};
+
+/** Read and scan one slice of a rescan window. Runs on a worker thread:
+ *  it only reads block files and tests scripts against the keystore, which
+ *  cannot change while the rescanning thread holds cs_wallet. */
+void ScanSliceForWalletTransactions(const CWallet* pwallet, CWalletScanSlice* pSlice)
+{
+    pSlice->vBlockData.resize(pSlice->vBlocks.size());
+    pSlice->vIsMine.resize(pSlice->vBlocks.size());
+    pSlice->vReadFailed.assign(pSlice->vBlocks.size(), false);
+    for (size_t i = 0; i < pSlice->vBlocks.size(); i++) {
+        CBlock& block = pSlice->vBlockData[i];
+        if (!ReadBlockFromDisk(block, pSlice->vBlocks[i], Params().GetConsensus())) {
+            pSlice->vReadFailed[i] = true;
+            continue;
+        }
+        pSlice->vIsMine[i].assign(block.vtx.size(), false);
+        for (size_t j = 0; j < block.vtx.size(); j++) {
+            if (pwallet->IsMine(block.vtx[j]))
+                pSlice->vIsMine[i][j] = true;
+        }
+    }
+}
+
+} // namespace
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
  *
+ * The scan is sharded across worker threads in windows of consecutive
+ * blocks: the workers read the blocks and run the (expensive) output
+ * script checks against the keystore, and this thread merges the results
+ * back in height order. All wallet mutation stays on this thread, so the
+ * wallet ends up in the same state as with the old serial scan.
+ *
  * Returns null if scan was successful. Otherwise, if a complete rescan was not
  * possible (due to pruning or corruption), returns pointer to the most recent
  * block that could not be scanned.
@@ -1826,6 +1996,12 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool f
 
     CBlockIndex* pindex = pindexStart;
     CBlockIndex* ret = nullptr;
+
+    // Same thread budget as the other hash calculation fan-outs. Each worker
+    // gets a contiguous run of blocks so slices line up with block files.
+    size_t nThreads = (size_t)std::max(1, nHashCalcThreads);
+    const size_t nBlocksPerSlice = 64;
+
     {
         LOCK2(cs_main, cs_wallet);
         fAbortRescan = false;
@@ -1836,22 +2012,55 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool f
         double dProgressTip = GuessVerificationProgress(chainParams.TxData(), chainActive.Tip());
         while (pindex && !fAbortRescan)
         {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
+            if (dProgressTip - dProgressStart > 0.0)
                 ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((GuessVerificationProgress(chainParams.TxData(), pindex) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
             if (GetTime() >= nNow + 60) {
                 nNow = GetTime();
                 LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
             }
 
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
-                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    AddToWalletIfInvolvingMe(MakeTransactionRef(block.vtx[posInBlock]), pindex, posInBlock, fUpdate);
+            // Collect the next window of blocks and fan the reads out.
+            std::vector<CWalletScanSlice> vSlices(nThreads);
+            for (size_t i = 0; i < nThreads && pindex; i++) {
+                for (size_t j = 0; j < nBlocksPerSlice && pindex; j++) {
+                    vSlices[i].vBlocks.push_back(pindex);
+                    pindex = chainActive.Next(pindex);
+                }
+            }
+            boost::thread_group workers;
+            for (size_t i = 1; i < nThreads; i++) {
+                if (!vSlices[i].vBlocks.empty())
+                    workers.create_thread(boost::bind(&ScanSliceForWalletTransactions, this, &vSlices[i]));
+            }
+            ScanSliceForWalletTransactions(this, &vSlices[0]);
+            workers.join_all();
+
+            // Merge in height order. The workers could only test output
+            // scripts, so in addition to their matches we forward anything
+            // the serial scan would have acted on through wallet state: a
+            // transaction already in the wallet, one spending an output of a
+            // wallet transaction (IsFromMe), or one spending an outpoint a
+            // wallet transaction also spends (conflict marking).
+            for (size_t i = 0; i < nThreads; i++) {
+                for (size_t j = 0; j < vSlices[i].vBlocks.size(); j++) {
+                    CBlockIndex* pindexBlock = vSlices[i].vBlocks[j];
+                    if (vSlices[i].vReadFailed[j]) {
+                        ret = pindexBlock;
+                        continue;
+                    }
+                    const CBlock& block = vSlices[i].vBlockData[j];
+                    for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
+                        const CTransaction& tx = block.vtx[posInBlock];
+                        bool fInteresting = vSlices[i].vIsMine[j][posInBlock] || mapWallet.count(tx.GetHash()) != 0;
+                        for (std::vector<CTxIn>::const_iterator it = tx.vin.begin(); !fInteresting && it != tx.vin.end(); ++it) {
+                            if (mapWallet.count(it->prevout.hash) != 0 || mapTxSpends.count(it->prevout) != 0)
+                                fInteresting = true;
+                        }
+                        if (fInteresting)
+                            AddToWalletIfInvolvingMe(MakeTransactionRef(tx), pindexBlock, posInBlock, fUpdate);
+                    }
                 }
-            } else {
-                ret = pindex;
             }
-            pindex = chainActive.Next(pindex);
         }
         if (pindex && fAbortRescan) {
             LogPrintf("Rescan aborted at block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
@@ -1906,11 +2115,7 @@ bool CWalletTx::RelayWalletTransaction(CConnman* connman)
         if (InMempool() || AcceptToMemoryPool(state)) {
             LogPrintf("Relaying wtx %s\n", GetHash().ToString());
             if (connman) {
-                CInv inv(MSG_TX, GetHash());
-                connman->ForEachNode([&inv](CNode* pnode)
-                {
-                    pnode->PushInventory(inv);
-                });
+                RelayTransaction(tx, connman);
                 return true;
             }
         }
@@ -2452,9 +2657,22 @@ void CWallet::AvailableCoinsAll(
     std::map<std::string, CAmount> mapTokenTotals;
     std::set<std::string> setTokenMaxFound;
 
-    for (const auto& entry : mapWallet) {
-      const uint256& wtxid = entry.first;
-      const CWalletTx* pcoin = &entry.second;
+    // Walk only the transactions that still have an unspent output of ours,
+    // rather than the whole wallet history. The index is maintained
+    // incrementally by AddToWallet and rebuilt here after the rare paths
+    // (conflicts, abandons, zaps) invalidate it.
+    if (!fSpendableIndexValid) {
+      setSpendableTxs.clear();
+      for (const auto& entry : mapWallet)
+        UpdateSpendableIndex(entry.first);
+      fSpendableIndexValid = true;
+    }
+
+    for (const uint256& wtxid : setSpendableTxs) {
+      std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(wtxid);
+      if (mi == mapWallet.end())
+          continue;
+      const CWalletTx* pcoin = &mi->second;
 
       if (!CheckFinalTx(*pcoin))
           continue;
@@ -2525,15 +2743,15 @@ void CWallet::AvailableCoinsAll(
         // If there is coin control, only select coins from selected set
         if (coinControl && !isTokenScript && coinControl->HasSelected() &&
             !coinControl->fAllowOtherInputs &&
-            !coinControl->IsSelected(entry.first, i))
+            !coinControl->IsSelected(wtxid, i))
           continue;
 
         if (coinControl && isTokenScript && coinControl->HasTokenSelected() &&
             !coinControl->fAllowOtherInputs &&
-            !coinControl->IsTokenSelected(COutPoint(entry.first, i)))
+            !coinControl->IsTokenSelected(COutPoint(wtxid, i)))
           continue;
 
-        if (IsLockedCoin(entry.first, i))
+        if (IsLockedCoin(wtxid, i))
             continue;
 
         // Ignore spent coins
@@ -2858,6 +3076,59 @@ static void ApproximateBestTokenSubset(
     }
 }
 
+/**
+ * Deterministic depth-first branch and bound over the coins sorted by
+ * descending value, looking for a subset whose sum lands in
+ * [nTargetValue, nTargetValue + nCostOfChange). Prunes a branch when the
+ * remaining coins cannot reach the target or the running total overshoots
+ * the window, and gives up after a bounded number of steps so degenerate
+ * wallets fall back to the stochastic solver.
+ */
+static bool SelectCoinsBnB(const std::vector<CInputCoin>& vValue, const CAmount& nTargetValue,
+                           const CAmount& nCostOfChange, std::vector<char>& vfBest)
+{
+    std::vector<char> vfIncluded(vValue.size(), false);
+    CAmount nTotal = 0;
+    CAmount nRemaining = 0;
+    for (unsigned int i = 0; i < vValue.size(); i++)
+        nRemaining += vValue[i].txout.nValue;
+    if (nRemaining < nTargetValue)
+        return false;
+
+    unsigned int i = 0;
+    int nTries = 100000;
+    while (nTries-- > 0)
+    {
+        if (nTotal >= nTargetValue && nTotal < nTargetValue + nCostOfChange)
+        {
+            vfBest = vfIncluded;
+            return true;
+        }
+        if (nTotal + nRemaining >= nTargetValue && nTotal < nTargetValue + nCostOfChange && i < vValue.size())
+        {
+            // Explore with the next coin included
+            nRemaining -= vValue[i].txout.nValue;
+            nTotal += vValue[i].txout.nValue;
+            vfIncluded[i] = true;
+            i++;
+            continue;
+        }
+        // Dead end: backtrack to the most recently included coin and
+        // continue with it excluded instead.
+        while (i > 0 && !vfIncluded[i - 1]) {
+            i--;
+            nRemaining += vValue[i].txout.nValue;
+        }
+        if (i == 0)
+            return false;
+        i--;
+        vfIncluded[i] = false;
+        nTotal -= vValue[i].txout.nValue;
+        i++;
+    }
+    return false;
+}
+
 bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const int nConfMine, const int nConfTheirs, const uint64_t nMaxAncestors, std::vector<COutput> vCoins,
                                  std::set<CInputCoin>& setCoinsRet, CAmount& nValueRet) const
 {
@@ -2924,15 +3195,23 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const int nConfMin
         return true;
     }
 
-    // Solve subset sum by stochastic approximation
     std::sort(vValue.begin(), vValue.end(), CompareValueOnly());
     std::reverse(vValue.begin(), vValue.end());
     std::vector<char> vfBest;
     CAmount nBest;
 
-    ApproximateBestSubset(vValue, nTotalLower, nTargetValue, vfBest, nBest);
-    if (nBest != nTargetValue && nTotalLower >= nTargetValue + MIN_CHANGE)
-        ApproximateBestSubset(vValue, nTotalLower, nTargetValue + MIN_CHANGE, vfBest, nBest);
+    // Try an exact branch and bound search first; if no subset lands close
+    // enough to the target, solve the subset sum by stochastic approximation
+    if (SelectCoinsBnB(vValue, nTargetValue, MIN_CHANGE, vfBest)) {
+        nBest = 0;
+        for (unsigned int i = 0; i < vValue.size(); i++)
+            if (vfBest[i])
+                nBest += vValue[i].txout.nValue;
+    } else {
+        ApproximateBestSubset(vValue, nTotalLower, nTargetValue, vfBest, nBest);
+        if (nBest != nTargetValue && nTotalLower >= nTargetValue + MIN_CHANGE)
+            ApproximateBestSubset(vValue, nTotalLower, nTargetValue + MIN_CHANGE, vfBest, nBest);
+    }
 
     // If we have a bigger coin and (either the stochastic approximation didn't find a good solution,
     //                                   or the next bigger coin is closer), return the bigger coin
@@ -3885,6 +4164,11 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey, CCon
             }
         }
 
+        // In group-commit mode the AddToWallet write above is not yet synced;
+        // make it durable before the transaction leaves the node and before
+        // the send RPC reports success (no-op otherwise)
+        GetDBHandle().DurabilityBarrier();
+
         // Track how many getdata requests our transaction gets
         mapRequestCount[wtxNew.GetHash()] = 0;
 
@@ -4000,6 +4284,8 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
     DBErrors nZapSelectTxRet = CWalletDB(*dbw,"cr+").ZapSelectTx(vHashIn, vHashOut);
     for (uint256 hash : vHashOut)
         mapWallet.erase(hash);
+    fSpendableIndexValid = false;
+    fHeightIndexValid = false;
 
     if (nZapSelectTxRet == DB_NEED_REWRITE)
     {
@@ -4186,6 +4472,10 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
         }
         bool internal = false;
         CWalletDB walletdb(*dbw);
+        // A single database transaction around the whole top-up turns one
+        // flush per generated key into one flush for the whole batch, which
+        // makes refilling a keypool of thousands of keys practical.
+        bool fBatch = walletdb.TxnBegin();
         for (int64_t i = missingInternal + missingExternal; i--;)
         {
             if (i < missingInternal) {
@@ -4207,6 +4497,9 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
             }
             m_pool_key_to_index[pubkey.GetID()] = index;
         }
+        if (fBatch && !walletdb.TxnCommit()) {
+            throw std::runtime_error(std::string(__func__) + ": committing generated keys failed");
+        }
         if (missingInternal + missingExternal > 0) {
             LogPrintf("keypool added %d keys (%d internal), size=%u (%u internal)\n", missingInternal + missingExternal, missingInternal, setInternalKeyPool.size() + setExternalKeyPool.size(), setInternalKeyPool.size());
         }
@@ -4773,6 +5066,8 @@ std::string CWallet::GetWalletHelpString(bool showDebug)
     strUsage += HelpMessageOpt("-upgradewallet", _("Upgrade wallet to latest format on startup"));
     strUsage += HelpMessageOpt("-wallet=<file>", _("Specify wallet file (within data directory)") + " " + strprintf(_("(default: %s)"), DEFAULT_WALLET_DAT));
     strUsage += HelpMessageOpt("-walletbroadcast", _("Make the wallet broadcast transactions") + " " + strprintf(_("(default: %u)"), DEFAULT_WALLETBROADCAST));
+    strUsage += HelpMessageOpt("-walletblocksync", _("Sync the wallet database to disk after each connected block's batched writes instead of relying on the periodic flush") + " " + strprintf(_("(default: %u)"), DEFAULT_WALLETBLOCKSYNC));
+    strUsage += HelpMessageOpt("-walletgroupcommit", _("Batch wallet database writes and fsync them in groups; sends still wait for their data to reach disk before reporting success") + " " + strprintf(_("(default: %u)"), DEFAULT_WALLET_GROUPCOMMIT));
     strUsage += HelpMessageOpt("-walletnotify=<cmd>", _("Execute command when a wallet transaction changes (%s in cmd is replaced by TxID)"));
     strUsage += HelpMessageOpt("-zapwallettxes=<mode>", _("Delete all wallet transactions and only recover those parts of the blockchain through -rescan on startup") +
                                " " + _("(1 = keep tx meta data e.g. account owner and payment request information, 2 = drop tx meta data)"));
@@ -4916,6 +5211,21 @@ CWallet* CWallet::CreateWalletFromFile(const std::string walletFile)
     }
     if (chainActive.Tip() && chainActive.Tip() != pindexRescan)
     {
+        //We can't rescan beyond non-pruned blocks, stop and throw an error
+        //this might happen if a user uses an old wallet within a pruned node
+        // or if he ran -disablewallet for a longer time, then decided to re-enable
+        if (fPruneMode)
+        {
+            CBlockIndex *block = chainActive.Tip();
+            while (block && block->pprev && (block->pprev->nStatus & BLOCK_HAVE_DATA) && block->pprev->nTx > 0 && pindexRescan != block)
+                block = block->pprev;
+
+            if (pindexRescan != block) {
+                InitError(_("Prune: last wallet synchronisation goes beyond pruned data. You need to -reindex (download the whole blockchain again in case of pruned node)"));
+                return nullptr;
+            }
+        }
+
         uiInterface.InitMessage(_("Rescanning..."));
         LogPrintf("Rescanning last %i blocks (from block %i)...\n", chainActive.Height() - pindexRescan->nHeight, pindexRescan->nHeight);
 
@@ -5044,6 +5354,9 @@ bool CWallet::ParameterInteraction()
         }
     }
 
+    if (gArgs.GetArg("-prune", 0) && gArgs.GetBoolArg("-rescan", false))
+        return InitError(_("Rescans are not possible in pruned mode. You will need to use -reindex which will download the whole blockchain again."));
+
     if (gArgs.GetBoolArg("-sysperms", false))
         return InitError("-sysperms is not allowed in combination with enabled wallet functionality");
 
@@ -5115,11 +5428,14 @@ int CMerkleTx::GetDepthInMainChain(const CBlockIndex* &pindexRet) const
     if (mi == mapBlockIndex.end())
         return 0;
     CBlockIndex* pindex = (*mi).second;
-    if (!pindex || !chainActive.Contains(pindex))
+    // Compute the depth against one chain snapshot, so the membership test
+    // and the height read cannot straddle a tip change.
+    CChainSnapshot snapshot = GetChainSnapshot();
+    if (!pindex || !snapshot.Contains(pindex))
         return 0;
 
     pindexRet = pindex;
-    return ((nIndex == -1) ? (-1) : 1) * (chainActive.Height() - pindex->nHeight + 1);
+    return ((nIndex == -1) ? (-1) : 1) * (snapshot.Height() - pindex->nHeight + 1);
 }
 
 int CMerkleTx::GetBlocksToMaturity() const
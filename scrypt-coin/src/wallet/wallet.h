@@ -73,6 +73,8 @@ static const bool DEFAULT_WALLET_REJECT_LONG_CHAINS = false;
 //! -txconfirmtarget default
 static const unsigned int DEFAULT_TX_CONFIRM_TARGET = 6;
 static const bool DEFAULT_WALLETBROADCAST = true;
+//! -walletblocksync default: sync the database log once per committed block batch
+static const bool DEFAULT_WALLETBLOCKSYNC = false;
 static const bool DEFAULT_DISABLE_WALLET = false;
 //! if set, all keys will be derived by using BIP32
 static const bool DEFAULT_USE_HD_WALLET = true;
@@ -711,6 +713,10 @@ private:
 
     CWalletDB *pwalletdbEncryption, *pwalletdbDecryption;
 
+    //! Non-null while the wallet writes for a connected block are being
+    //! batched into a single database transaction (see BlockConnected).
+    CWalletDB *pwalletdbBlockBatch;
+
     //! the current wallet version: clients below this version are not able to load the wallet
     int nWalletVersion;
 
@@ -731,6 +737,37 @@ private:
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    /**
+     * Transactions with at least one unspent output belonging to us, so
+     * AvailableCoins only has to walk the live part of the wallet instead of
+     * its whole history. Maintained incrementally by AddToWallet and rebuilt
+     * on first use after the rare paths (conflicts, abandons, zaps) clear
+     * fSpendableIndexValid. Mutable because the index is refreshed lazily
+     * from the const coin enumeration path.
+     */
+    mutable std::set<uint256> setSpendableTxs;
+    mutable bool fSpendableIndexValid;
+    //! Insert or erase hashTx from setSpendableTxs depending on whether it
+    //! still has an unspent output of ours (caller must hold cs_wallet).
+    void UpdateSpendableIndex(const uint256& hashTx) const;
+
+    /**
+     * Wallet transactions keyed by the height of their containing block
+     * (unconfirmed, conflicted and abandoned entries filed under -1), so
+     * listsinceblock can cursor from a fork height instead of scanning the
+     * whole history. Like the index above it is maintained incrementally by
+     * AddToWallet, rebuilt on first use after the rare paths (conflicts,
+     * abandons, zaps) clear fHeightIndexValid, and mutable because it is
+     * refreshed lazily from const query paths. The companion position map
+     * lets a re-filed transaction drop its old entry without a scan.
+     */
+    mutable std::multimap<int, uint256> mapWtxByHeight;
+    mutable std::map<uint256, std::multimap<int, uint256>::iterator> mapWtxHeightPos;
+    mutable bool fHeightIndexValid;
+    //! Re-file hashTx under its current block height, or drop it if it has
+    //! left the wallet (caller must hold cs_main and cs_wallet).
+    void UpdateHeightIndex(const uint256& hashTx) const;
+
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, const uint256& hashTx);
 
@@ -826,6 +863,7 @@ public:
         nWalletMaxVersion = FEATURE_BASE;
         nMasterKeyMaxID = 0;
         pwalletdbEncryption = nullptr;
+        pwalletdbBlockBatch = nullptr;
         nOrderPosNext = 0;
         nAccountingEntryNumber = 0;
         nNextResend = 0;
@@ -836,6 +874,8 @@ public:
         nRelockTime = 0;
         fAbortRescan = false;
         fScanningWallet = false;
+        fSpendableIndexValid = false;
+        fHeightIndexValid = false;
     }
 
     std::map<uint256, CWalletTx> mapWallet;
@@ -857,6 +897,14 @@ public:
 
     const CWalletTx* GetWalletTx(const uint256& hash) const;
 
+    /**
+     * Collect the transactions contained in blocks strictly above nHeight
+     * together with all unconfirmed or conflicted ones, at a cost
+     * proportional to the result rather than the wallet size. Pass -1 to
+     * get the whole history. Requires cs_main and cs_wallet.
+     */
+    void GetWtxAboveHeight(int nHeight, std::vector<const CWalletTx*>& vWtx) const;
+
     //! check whether we are allowed to upgrade (or already support) to the named feature
     bool CanSupportFeature(enum WalletFeature wf) const { AssertLockHeld(cs_wallet); return nWalletMaxVersion >= wf; }
 
@@ -808,6 +808,10 @@ void MaybeCompactWalletDB()
     for (CWalletRef pwallet : vpwallets) {
         CWalletDBWrapper& dbh = pwallet->GetDBHandle();
 
+        // Checkpoint any group-commit writes deferred since the last pass
+        // (no-op unless -walletgroupcommit)
+        dbh.GroupFlush();
+
         unsigned int nUpdateCounter = dbh.nUpdateCounter;
 
         if (dbh.nLastSeen != nUpdateCounter) {
@@ -1132,9 +1136,9 @@ bool CWalletDB::TxnBegin()
     return batch.TxnBegin();
 }
 
-bool CWalletDB::TxnCommit()
+bool CWalletDB::TxnCommit(bool fSync)
 {
-    return batch.TxnCommit();
+    return batch.TxnCommit(fSync);
 }
 
 bool CWalletDB::TxnAbort()
@@ -243,8 +243,8 @@ public:
 
     //! Begin a new transaction
     bool TxnBegin();
-    //! Commit current transaction
-    bool TxnCommit();
+    //! Commit current transaction, optionally syncing the log to disk
+    bool TxnCommit(bool fSync = false);
     //! Abort current transaction
     bool TxnAbort();
     //! Read wallet version
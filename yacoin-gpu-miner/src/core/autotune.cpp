@@ -0,0 +1,99 @@
+/*
+ * Scrypt Coin GPU Miner - Autotune Profile Store
+ *
+ * Profiles live in a plain text file, one per line:
+ *
+ *   deviceName|nParam|blockSize|batchSize|lookupGap|hashrate
+ *
+ * '|' is the separator because GPU names contain spaces. The file is small
+ * (one line per device and N), so save simply rewrites it.
+ */
+
+#include "autotune.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TUNE_MAX_PROFILES 64
+#define TUNE_MAX_LINE     512
+
+// Parse one profile line. Returns 0 on success.
+static int tune_parse_line(const char *line, TuneProfile *p)
+{
+    memset(p, 0, sizeof(TuneProfile));
+
+    if (sscanf(line, "%255[^|]|%u|%u|%u|%u|%lf",
+               p->deviceName, &p->nParam, &p->blockSize,
+               &p->batchSize, &p->lookupGap, &p->hashrate) != 6) {
+        return -1;
+    }
+    if (p->blockSize == 0 || p->batchSize == 0 || p->lookupGap == 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static void tune_write_line(FILE *f, const TuneProfile *p)
+{
+    fprintf(f, "%s|%u|%u|%u|%u|%.0f\n",
+            p->deviceName, p->nParam, p->blockSize,
+            p->batchSize, p->lookupGap, p->hashrate);
+}
+
+int tune_profile_load(const char *path, const char *deviceName,
+                      uint32_t nParam, TuneProfile *out)
+{
+    if (!path || !deviceName || !out) return -1;
+
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;  // No profile file yet is not an error
+
+    char line[TUNE_MAX_LINE];
+    while (fgets(line, sizeof(line), f)) {
+        TuneProfile p;
+        if (tune_parse_line(line, &p) != 0) continue;
+        if (p.nParam == nParam && strcmp(p.deviceName, deviceName) == 0) {
+            memcpy(out, &p, sizeof(TuneProfile));
+            fclose(f);
+            return 1;
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+int tune_profile_save(const char *path, const TuneProfile *profile)
+{
+    if (!path || !profile) return -1;
+
+    // Read everything we are keeping
+    TuneProfile kept[TUNE_MAX_PROFILES];
+    int numKept = 0;
+
+    FILE *f = fopen(path, "r");
+    if (f) {
+        char line[TUNE_MAX_LINE];
+        while (fgets(line, sizeof(line), f) && numKept < TUNE_MAX_PROFILES) {
+            TuneProfile p;
+            if (tune_parse_line(line, &p) != 0) continue;
+            if (p.nParam == profile->nParam &&
+                strcmp(p.deviceName, profile->deviceName) == 0) {
+                continue;  // Replaced by the new entry
+            }
+            memcpy(&kept[numKept++], &p, sizeof(TuneProfile));
+        }
+        fclose(f);
+    }
+
+    f = fopen(path, "w");
+    if (!f) return -1;
+
+    for (int i = 0; i < numKept; i++) {
+        tune_write_line(f, &kept[i]);
+    }
+    tune_write_line(f, profile);
+
+    fclose(f);
+    return 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * Scrypt Coin GPU Miner - Autotune Profile Store
+ *
+ * Persists the measured-best launch configuration per (device, N) so the
+ * startup sweep only runs once per device and N-factor / epoch.
+ */
+
+#ifndef SCRYPT_AUTOTUNE_H
+#define SCRYPT_AUTOTUNE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One tuned launch configuration. nParam is whatever shifts the optimum on
+// this chain: the scrypt N-factor for scrypt-jane, the DAG epoch for
+// AdaptivePow. Fields a backend does not use stay at their defaults.
+typedef struct {
+    char     deviceName[256];
+    uint32_t nParam;
+    uint32_t blockSize;        // CUDA block / OpenCL local work size
+    uint32_t batchSize;        // Nonces per launch
+    uint32_t lookupGap;        // Scratchpad lookup gap (1 = store all)
+    double   hashrate;         // Measured rate, hashes per second
+} TuneProfile;
+
+// Look up the stored profile for (deviceName, nParam).
+// Returns 1 if found, 0 if absent, -1 on error.
+int tune_profile_load(const char *path, const char *deviceName,
+                      uint32_t nParam, TuneProfile *out);
+
+// Store a profile, replacing any existing entry for the same
+// (deviceName, nParam). Returns 0 on success.
+int tune_profile_save(const char *path, const TuneProfile *profile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCRYPT_AUTOTUNE_H
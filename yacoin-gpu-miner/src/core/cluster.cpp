@@ -0,0 +1,494 @@
+/*
+ * YaCoin GPU Miner - Multi-Rig Cluster Orchestration Implementation
+ */
+
+#include "cluster.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+    typedef int socklen_t;
+#else
+    #include <sys/socket.h>
+    #include <sys/select.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <netdb.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+    #define closesocket close
+    #define INVALID_SOCKET -1
+    #define SOCKET_ERROR -1
+#endif
+
+// Largest payload we accept; ClusterJobMsg is the biggest message
+#define CLUSTER_MAX_PAYLOAD sizeof(ClusterJobMsg)
+
+static void set_nonblocking(int sock)
+{
+#ifdef _WIN32
+    u_long mode = 1;
+    ioctlsocket(sock, FIONBIO, &mode);
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+#endif
+}
+
+static bool socket_readable(int sock)
+{
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(sock, &fds);
+    struct timeval tv = {0, 0};
+    return select(sock + 1, &fds, NULL, NULL, &tv) > 0;
+}
+
+// Blocking send of a complete frame. Frames are small (<1 KB); if the
+// peer's buffer is full long enough to block here, the link is in worse
+// trouble than a stalled send.
+static int send_frame(int sock, uint16_t type, const void *payload, uint32_t length)
+{
+    ClusterMsgHeader hdr;
+    hdr.magic = CLUSTER_MAGIC;
+    hdr.type = type;
+    hdr.reserved = 0;
+    hdr.length = length;
+
+    char buffer[sizeof(ClusterMsgHeader) + CLUSTER_MAX_PAYLOAD];
+    memcpy(buffer, &hdr, sizeof(hdr));
+    if (length > 0)
+        memcpy(buffer + sizeof(hdr), payload, length);
+
+    int total = (int)(sizeof(hdr) + length);
+    int sent = 0;
+    while (sent < total) {
+        int n = send(sock, buffer + sent, total - sent, 0);
+        if (n <= 0) {
+#ifndef _WIN32
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                continue;
+#endif
+            return -1;
+        }
+        sent += n;
+    }
+    return 0;
+}
+
+// Read one complete frame if the socket has data. Returns 1 with the
+// frame, 0 if nothing is pending, -1 on disconnect or protocol error.
+// Frames are tiny, so once the header is readable the rest arrives in
+// the same segment in practice; the short blocking window is accepted.
+static int recv_frame(int sock, ClusterMsgHeader *hdr, void *payload)
+{
+    if (!socket_readable(sock))
+        return 0;
+
+    char *p = (char*)hdr;
+    int want = (int)sizeof(ClusterMsgHeader);
+    int got = 0;
+    while (got < want) {
+        int n = recv(sock, p + got, want - got, 0);
+        if (n == 0)
+            return -1;
+        if (n < 0) {
+#ifndef _WIN32
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                continue;
+#endif
+            return -1;
+        }
+        got += n;
+    }
+
+    if (hdr->magic != CLUSTER_MAGIC || hdr->length > CLUSTER_MAX_PAYLOAD) {
+        fprintf(stderr, "Cluster: bad frame (magic %08x, length %u)\n",
+                hdr->magic, hdr->length);
+        return -1;
+    }
+
+    p = (char*)payload;
+    want = (int)hdr->length;
+    got = 0;
+    while (got < want) {
+        int n = recv(sock, p + got, want - got, 0);
+        if (n == 0)
+            return -1;
+        if (n < 0) {
+#ifndef _WIN32
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                continue;
+#endif
+            return -1;
+        }
+        got += n;
+    }
+    return 1;
+}
+
+// Nonce slice for the rig in the given slot (slot -1 = the coordinator)
+static uint64_t slot_nonce_base(int slot)
+{
+    return ((uint64_t)(slot + 1)) << CLUSTER_NONCE_SHIFT;
+}
+
+// ==================== Coordinator ====================
+
+int cluster_coordinator_start(ClusterCoordinator *coord, int port)
+{
+    memset(coord, 0, sizeof(ClusterCoordinator));
+    coord->port = port;
+    coord->listenSocket = INVALID_SOCKET;
+    for (int i = 0; i < CLUSTER_MAX_WORKERS; i++)
+        coord->workers[i].socket = INVALID_SOCKET;
+
+    int sock = (int)socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == INVALID_SOCKET) {
+        fprintf(stderr, "Cluster: socket() failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons((uint16_t)port);
+
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+        listen(sock, 8) == SOCKET_ERROR) {
+        fprintf(stderr, "Cluster: cannot listen on port %d: %s\n", port, strerror(errno));
+        closesocket(sock);
+        return -1;
+    }
+
+    set_nonblocking(sock);
+    coord->listenSocket = sock;
+    printf("Cluster: coordinating on port %d (up to %d rigs)\n", port, CLUSTER_MAX_WORKERS);
+    return 0;
+}
+
+static void coordinator_drop_worker(ClusterCoordinator *coord, int slot)
+{
+    ClusterWorkerSlot *w = &coord->workers[slot];
+    if (w->socket != INVALID_SOCKET)
+        closesocket(w->socket);
+    printf("Cluster: rig '%s' disconnected\n", w->name[0] ? w->name : "?");
+    memset(w, 0, sizeof(*w));
+    w->socket = INVALID_SOCKET;
+}
+
+static void coordinator_send_job(ClusterCoordinator *coord, int slot)
+{
+    ClusterJobMsg msg;
+    memcpy(&msg.job, &coord->currentJob, sizeof(MiningJob));
+    msg.nonceBase = slot_nonce_base(slot);
+    msg.difficulty = coord->difficulty;
+    if (send_frame(coord->workers[slot].socket, CLUSTER_MSG_JOB, &msg, sizeof(msg)) != 0)
+        coordinator_drop_worker(coord, slot);
+}
+
+int cluster_coordinator_poll(ClusterCoordinator *coord, StratumClient *stratum)
+{
+    if (coord->listenSocket == INVALID_SOCKET)
+        return -1;
+
+    // Accept new rigs
+    while (socket_readable(coord->listenSocket)) {
+        struct sockaddr_in peer;
+        socklen_t peerLen = sizeof(peer);
+        int sock = (int)accept(coord->listenSocket, (struct sockaddr*)&peer, &peerLen);
+        if (sock == INVALID_SOCKET)
+            break;
+
+        int slot = -1;
+        for (int i = 0; i < CLUSTER_MAX_WORKERS; i++) {
+            if (!coord->workers[i].connected) { slot = i; break; }
+        }
+        if (slot < 0) {
+            fprintf(stderr, "Cluster: rig limit reached, rejecting connection\n");
+            closesocket(sock);
+            continue;
+        }
+
+        int one = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+        coord->workers[slot].socket = sock;
+        coord->workers[slot].connected = true;
+        coord->workers[slot].lastSeen = (uint64_t)time(NULL);
+        snprintf(coord->workers[slot].name, CLUSTER_NAME_LEN, "%s", inet_ntoa(peer.sin_addr));
+    }
+
+    // Service queued frames from each rig
+    for (int i = 0; i < CLUSTER_MAX_WORKERS; i++) {
+        ClusterWorkerSlot *w = &coord->workers[i];
+        if (!w->connected)
+            continue;
+
+        for (;;) {
+            ClusterMsgHeader hdr;
+            char payload[CLUSTER_MAX_PAYLOAD];
+            int r = recv_frame(w->socket, &hdr, payload);
+            if (r == 0)
+                break;
+            if (r < 0) {
+                coordinator_drop_worker(coord, i);
+                break;
+            }
+            w->lastSeen = (uint64_t)time(NULL);
+
+            switch (hdr.type) {
+            case CLUSTER_MSG_HELLO: {
+                if (hdr.length != sizeof(ClusterHello))
+                    break;
+                ClusterHello *hello = (ClusterHello*)payload;
+                if (hello->version != CLUSTER_PROTO_VERSION) {
+                    fprintf(stderr, "Cluster: rig '%s' protocol v%u != v%u, dropping\n",
+                            hello->name, hello->version, (unsigned)CLUSTER_PROTO_VERSION);
+                    coordinator_drop_worker(coord, i);
+                    break;
+                }
+                hello->name[CLUSTER_NAME_LEN - 1] = '\0';
+                snprintf(w->name, CLUSTER_NAME_LEN, "%s", hello->name);
+                w->numGpus = hello->numGpus;
+                printf("Cluster: rig '%s' joined (%u GPUs, slot %d)\n", w->name, w->numGpus, i);
+                // Bring the rig onto the current job immediately
+                if (coord->hasJob)
+                    coordinator_send_job(coord, i);
+                break;
+            }
+            case CLUSTER_MSG_SHARE: {
+                if (hdr.length != sizeof(MiningResult))
+                    break;
+                MiningResult *result = (MiningResult*)payload;
+                // The rig already ran the 256-bit filter and CPU re-hash;
+                // forward straight to the pool's pipelined submitter
+                if (stratum && stratum_submit_async(stratum, result) == 0) {
+                    w->sharesForwarded++;
+                    coord->sharesForwarded++;
+                    printf("Cluster: share from '%s' forwarded (nonce %016llx)\n",
+                           w->name, (unsigned long long)result->nonce);
+                } else {
+                    fprintf(stderr, "Cluster: submit queue full, share from '%s' dropped\n", w->name);
+                }
+                break;
+            }
+            case CLUSTER_MSG_STATS:
+                if (hdr.length == sizeof(MinerStats))
+                    memcpy(&w->stats, payload, sizeof(MinerStats));
+                break;
+            default:
+                // Unknown type from a matching protocol version: ignore
+                break;
+            }
+
+            if (!w->connected)
+                break;
+        }
+    }
+
+    return 0;
+}
+
+void cluster_coordinator_update_job(ClusterCoordinator *coord, const MiningJob *job,
+                                    double difficulty)
+{
+    if (!job || job->jobId[0] == '\0')
+        return;
+    if (coord->hasJob && strncmp(coord->currentJob.jobId, job->jobId,
+                                 sizeof(coord->currentJob.jobId)) == 0 &&
+        coord->difficulty == difficulty)
+        return;
+
+    memcpy(&coord->currentJob, job, sizeof(MiningJob));
+    coord->difficulty = difficulty;
+    coord->hasJob = true;
+
+    for (int i = 0; i < CLUSTER_MAX_WORKERS; i++) {
+        if (coord->workers[i].connected)
+            coordinator_send_job(coord, i);
+    }
+}
+
+void cluster_coordinator_announce_epoch(ClusterCoordinator *coord, uint32_t epoch)
+{
+    if (coord->announcedEpoch == epoch)
+        return;
+    coord->announcedEpoch = epoch;
+
+    ClusterEpochMsg msg;
+    msg.epoch = epoch;
+    for (int i = 0; i < CLUSTER_MAX_WORKERS; i++) {
+        if (coord->workers[i].connected &&
+            send_frame(coord->workers[i].socket, CLUSTER_MSG_EPOCH, &msg, sizeof(msg)) != 0)
+            coordinator_drop_worker(coord, i);
+    }
+}
+
+int cluster_coordinator_stats(const ClusterCoordinator *coord, MinerStats *agg)
+{
+    memset(agg, 0, sizeof(MinerStats));
+    int numRigs = 0;
+    for (int i = 0; i < CLUSTER_MAX_WORKERS; i++) {
+        const ClusterWorkerSlot *w = &coord->workers[i];
+        if (!w->connected)
+            continue;
+        numRigs++;
+        agg->hashrate += w->stats.hashrate;
+        agg->totalHashes += w->stats.totalHashes;
+        agg->acceptedShares += w->stats.acceptedShares;
+        agg->rejectedShares += w->stats.rejectedShares;
+        agg->staleResults += w->stats.staleResults;
+    }
+    return numRigs;
+}
+
+void cluster_coordinator_stop(ClusterCoordinator *coord)
+{
+    for (int i = 0; i < CLUSTER_MAX_WORKERS; i++) {
+        if (coord->workers[i].socket != INVALID_SOCKET)
+            closesocket(coord->workers[i].socket);
+        coord->workers[i].socket = INVALID_SOCKET;
+        coord->workers[i].connected = false;
+    }
+    if (coord->listenSocket != INVALID_SOCKET)
+        closesocket(coord->listenSocket);
+    coord->listenSocket = INVALID_SOCKET;
+}
+
+// ==================== Worker ====================
+
+int cluster_worker_connect(ClusterWorker *worker, const char *host, int port,
+                           const char *name, int numGpus)
+{
+    memset(worker, 0, sizeof(ClusterWorker));
+    worker->socket = INVALID_SOCKET;
+    snprintf(worker->host, sizeof(worker->host), "%s", host);
+    worker->port = port;
+    snprintf(worker->name, CLUSTER_NAME_LEN, "%s", name);
+
+    struct hostent *he = gethostbyname(host);
+    if (!he) {
+        fprintf(stderr, "Cluster: cannot resolve coordinator '%s'\n", host);
+        return -1;
+    }
+
+    int sock = (int)socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == INVALID_SOCKET)
+        return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    memcpy(&addr.sin_addr, he->h_addr_list[0], he->h_length);
+
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
+        fprintf(stderr, "Cluster: cannot connect to %s:%d: %s\n", host, port, strerror(errno));
+        closesocket(sock);
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+    worker->socket = sock;
+    worker->connected = true;
+
+    ClusterHello hello;
+    memset(&hello, 0, sizeof(hello));
+    hello.version = CLUSTER_PROTO_VERSION;
+    hello.numGpus = (uint32_t)numGpus;
+    snprintf(hello.name, CLUSTER_NAME_LEN, "%s", name);
+    if (send_frame(sock, CLUSTER_MSG_HELLO, &hello, sizeof(hello)) != 0) {
+        cluster_worker_disconnect(worker);
+        return -1;
+    }
+
+    printf("Cluster: connected to coordinator %s:%d as '%s'\n", host, port, name);
+    return 0;
+}
+
+int cluster_worker_poll(ClusterWorker *worker)
+{
+    if (!worker->connected)
+        return -1;
+
+    for (;;) {
+        ClusterMsgHeader hdr;
+        char payload[CLUSTER_MAX_PAYLOAD];
+        int r = recv_frame(worker->socket, &hdr, payload);
+        if (r == 0)
+            return 0;
+        if (r < 0) {
+            cluster_worker_disconnect(worker);
+            return -1;
+        }
+
+        switch (hdr.type) {
+        case CLUSTER_MSG_JOB: {
+            if (hdr.length != sizeof(ClusterJobMsg))
+                break;
+            ClusterJobMsg *msg = (ClusterJobMsg*)payload;
+            memcpy(&worker->currentJob, &msg->job, sizeof(MiningJob));
+            worker->nonceBase = msg->nonceBase;
+            worker->difficulty = msg->difficulty;
+            worker->hasJob = true;
+            worker->jobChanged = true;
+            printf("Cluster: new job %s (nonce base %016llx)\n",
+                   worker->currentJob.jobId, (unsigned long long)worker->nonceBase);
+            break;
+        }
+        case CLUSTER_MSG_EPOCH: {
+            if (hdr.length != sizeof(ClusterEpochMsg))
+                break;
+            ClusterEpochMsg *msg = (ClusterEpochMsg*)payload;
+            worker->prepareEpoch = msg->epoch;
+            worker->hasPrepare = true;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+int cluster_worker_submit(ClusterWorker *worker, const MiningResult *result)
+{
+    if (!worker->connected)
+        return -1;
+    if (send_frame(worker->socket, CLUSTER_MSG_SHARE, result, sizeof(MiningResult)) != 0) {
+        cluster_worker_disconnect(worker);
+        return -1;
+    }
+    return 0;
+}
+
+int cluster_worker_send_stats(ClusterWorker *worker, const MinerStats *stats)
+{
+    if (!worker->connected)
+        return -1;
+    if (send_frame(worker->socket, CLUSTER_MSG_STATS, stats, sizeof(MinerStats)) != 0) {
+        cluster_worker_disconnect(worker);
+        return -1;
+    }
+    return 0;
+}
+
+void cluster_worker_disconnect(ClusterWorker *worker)
+{
+    if (worker->socket != INVALID_SOCKET)
+        closesocket(worker->socket);
+    worker->socket = INVALID_SOCKET;
+    worker->connected = false;
+    worker->hasJob = false;
+}
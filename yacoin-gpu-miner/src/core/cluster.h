@@ -0,0 +1,157 @@
+/*
+ * YaCoin GPU Miner - Multi-Rig Cluster Orchestration
+ *
+ * One coordinator process holds the pool connection and fans the work out
+ * to worker rigs over a small framed TCP protocol: jobs are broadcast with
+ * a disjoint per-rig slice of the 64-bit nonce space, verified shares and
+ * periodic stats flow back, and upcoming DAG epochs are announced ahead of
+ * the boundary so every rig builds the next DAG in the background once
+ * instead of stalling at the switch. The pool sees one connection for the
+ * whole fleet.
+ */
+
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "miner.h"
+#include "stratum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CLUSTER_MAGIC         0x32434159u  // "YAC2", little-endian on the wire
+#define CLUSTER_PROTO_VERSION 1
+#define CLUSTER_DEFAULT_PORT  3335
+#define CLUSTER_MAX_WORKERS   64
+#define CLUSTER_NAME_LEN      64
+
+// Workers mine disjoint static slices of the nonce space: slot i gets
+// [ (i+1) << CLUSTER_NONCE_SHIFT, (i+2) << CLUSTER_NONCE_SHIFT ) and the
+// coordinator's own GPUs keep base 0. 2^48 nonces per rig per job is far
+// more than any rig exhausts before the next job arrives, so no range
+// refill round-trips are needed.
+#define CLUSTER_NONCE_SHIFT   48
+
+// Message types
+typedef enum {
+    CLUSTER_MSG_HELLO = 1,    // worker -> coordinator: version, rig name
+    CLUSTER_MSG_JOB   = 2,    // coordinator -> worker: job + nonce base
+    CLUSTER_MSG_SHARE = 3,    // worker -> coordinator: verified result
+    CLUSTER_MSG_STATS = 4,    // worker -> coordinator: periodic MinerStats
+    CLUSTER_MSG_EPOCH = 5     // coordinator -> worker: prepare DAG epoch
+} ClusterMsgType;
+
+// Frame header; the typed payload follows immediately. Structs go over
+// the wire as-is: rigs in one cluster are the same architecture (x86-64,
+// little-endian) and run the same build, which HELLO's version enforces.
+typedef struct {
+    uint32_t magic;
+    uint16_t type;            // ClusterMsgType
+    uint16_t reserved;
+    uint32_t length;          // payload bytes after this header
+} ClusterMsgHeader;
+
+typedef struct {
+    uint32_t version;         // CLUSTER_PROTO_VERSION
+    uint32_t numGpus;
+    char     name[CLUSTER_NAME_LEN];
+} ClusterHello;
+
+typedef struct {
+    MiningJob job;
+    uint64_t  nonceBase;      // start of this rig's nonce slice
+    double    difficulty;     // pool share difficulty at broadcast time
+} ClusterJobMsg;
+
+typedef struct {
+    uint32_t epoch;
+} ClusterEpochMsg;
+
+// Coordinator-side view of one connected rig
+typedef struct {
+    int        socket;
+    bool       connected;
+    char       name[CLUSTER_NAME_LEN];
+    uint32_t   numGpus;
+    MinerStats stats;         // last report, zeroed until the first one
+    uint64_t   sharesForwarded;
+    uint64_t   lastSeen;      // time() of the last frame received
+} ClusterWorkerSlot;
+
+typedef struct {
+    int      listenSocket;
+    int      port;
+    ClusterWorkerSlot workers[CLUSTER_MAX_WORKERS];
+    MiningJob currentJob;
+    bool     hasJob;
+    double   difficulty;
+    uint32_t announcedEpoch;  // last epoch sent in CLUSTER_MSG_EPOCH
+    uint64_t sharesForwarded; // total across all workers
+} ClusterCoordinator;
+
+// Worker-side connection to the coordinator
+typedef struct {
+    int       socket;
+    bool      connected;
+    char      host[256];
+    int       port;
+    char      name[CLUSTER_NAME_LEN];
+    MiningJob currentJob;
+    bool      hasJob;
+    bool      jobChanged;     // set by cluster_worker_poll on a new job
+    uint64_t  nonceBase;
+    double    difficulty;
+    uint32_t  prepareEpoch;   // epoch announced for background DAG build
+    bool      hasPrepare;     // cleared by the caller once acted on
+} ClusterWorker;
+
+// ==================== Coordinator ====================
+
+// Bind and listen; call once before the mining loop
+int cluster_coordinator_start(ClusterCoordinator *coord, int port);
+
+// Accept new rigs and service queued frames (non-blocking). Shares are
+// forwarded to the pool through stratum, stats are stored per slot.
+int cluster_coordinator_poll(ClusterCoordinator *coord, StratumClient *stratum);
+
+// Broadcast the job to all rigs if its id changed since the last call;
+// also sent to each rig right after its HELLO
+void cluster_coordinator_update_job(ClusterCoordinator *coord, const MiningJob *job,
+                                    double difficulty);
+
+// Announce an upcoming epoch so every rig starts its background DAG
+// build at the same time (sent once per epoch value)
+void cluster_coordinator_announce_epoch(ClusterCoordinator *coord, uint32_t epoch);
+
+// Sum the last-reported stats of all connected rigs into *agg and return
+// the number of connected rigs
+int cluster_coordinator_stats(const ClusterCoordinator *coord, MinerStats *agg);
+
+void cluster_coordinator_stop(ClusterCoordinator *coord);
+
+// ==================== Worker ====================
+
+// Connect to the coordinator and send HELLO. Returns 0 on success.
+int cluster_worker_connect(ClusterWorker *worker, const char *host, int port,
+                           const char *name, int numGpus);
+
+// Service incoming frames (non-blocking): jobs, epoch announcements.
+// Returns -1 when the connection dropped (caller reconnects).
+int cluster_worker_poll(ClusterWorker *worker);
+
+// Send a verified result to the coordinator for pool submission
+int cluster_worker_submit(ClusterWorker *worker, const MiningResult *result);
+
+// Send this rig's current stats
+int cluster_worker_send_stats(ClusterWorker *worker, const MinerStats *stats);
+
+void cluster_worker_disconnect(ClusterWorker *worker);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CLUSTER_H
@@ -9,6 +9,16 @@
 #include <string.h>
 #include <time.h>
 
+#include <atomic>
+#include <mutex>
+
+// Work scheduling: nonces reserved per pull. Bounds keep a cold device from
+// starving the rig (too large) or hammering the counter (too small); the
+// target duration is how long one chunk should keep a device busy.
+#define SCHED_MIN_CHUNK       (1ULL << 16)
+#define SCHED_MAX_CHUNK       (1ULL << 26)
+#define SCHED_CHUNK_SECONDS   0.25
+
 #ifdef WITH_CUDA
     #include <cuda_runtime.h>
     extern "C" {
@@ -16,6 +26,10 @@
         int adaptivepow_cuda_generate_dag(void* ctx);
         int adaptivepow_cuda_search(void* ctx, const uint32_t* header, uint64_t target,
                                      uint64_t startNonce, uint64_t* foundNonce, uint32_t* hashCount);
+        int adaptivepow_cuda_autotune(void* ctx, const char* profilePath);
+        int adaptivepow_cuda_prepare_epoch(void* ctx, uint32_t epoch);
+        int adaptivepow_cuda_dag_slice(void* ctx);
+        int adaptivepow_cuda_switch_epoch(void* ctx);
         void adaptivepow_cuda_cleanup(void* ctx);
     }
 #endif
@@ -27,6 +41,7 @@
         int adaptivepow_opencl_generate_dag(void* ctx);
         int adaptivepow_opencl_search(void* ctx, const uint32_t* header, uint64_t target,
                                        uint64_t startNonce, uint64_t* foundNonce, uint32_t* hashCount);
+        int adaptivepow_opencl_autotune(void* ctx, const char* profilePath);
         void adaptivepow_opencl_cleanup(void* ctx);
     }
 #endif
@@ -44,16 +59,38 @@ struct MinerContext {
     uint64_t totalHashes;
     uint64_t acceptedShares;
     uint64_t rejectedShares;
+    uint64_t staleResults;
     time_t startTime;
 
     // Current nonce position
     uint64_t currentNonce;
 
+    // Per-GPU job versioning: bumped whenever a batch is launched for a
+    // different jobId, so results from batches that were in flight across
+    // a job switch can be recognized and discarded instead of flushing
+    // the pipeline
+    uint32_t jobVersion;
+    char     jobId[64];
+
+    // Dynamic work scheduling
+    uint64_t chunkSize;        // Nonces reserved per scheduler pull
+    double   emaHashrate;      // Smoothed measured hashrate
+    uint64_t lastStatHashes;   // totalHashes at the previous stats call
+    time_t   lastStatTime;     // Wall clock at the previous stats call
+
     // Pending result
     bool hasResult;
     MiningResult pendingResult;
 };
 
+// Shared nonce source for one job. Devices reserve chunks with a single
+// atomic fetch-add; the counter resets whenever the job id changes.
+struct WorkScheduler {
+    std::atomic<uint64_t> nextNonce;
+    char jobId[64];
+    std::mutex jobLock;
+};
+
 // ==================== AdaptivePow Functions ====================
 
 uint32_t adaptivepow_get_epoch(uint64_t timestamp, uint64_t genesisTime)
@@ -154,6 +191,8 @@ MinerContext* miner_init(int deviceId, uint32_t epoch)
     ctx->epoch = epoch;
     ctx->dagSize = adaptivepow_get_dag_size(epoch);
     ctx->startTime = time(NULL);
+    ctx->chunkSize = SCHED_MIN_CHUNK;
+    ctx->lastStatTime = ctx->startTime;
 
     // Detect GPU type and initialize
     GPUDevice devices[8];
@@ -218,9 +257,40 @@ bool miner_dag_ready(MinerContext *ctx)
     return ctx && ctx->dagReady;
 }
 
-int miner_submit_job(MinerContext *ctx, const MiningJob *job)
+int miner_autotune(MinerContext *ctx, const char *profilePath)
 {
-    if (!ctx || !ctx->dagReady || !job) return -1;
+    if (!ctx || !ctx->dagReady) return -1;
+
+    int result = -1;
+
+#ifdef WITH_CUDA
+    if (ctx->isCuda) {
+        result = adaptivepow_cuda_autotune(ctx->gpuContext, profilePath);
+    }
+#endif
+
+#ifdef WITH_OPENCL
+    if (!ctx->isCuda) {
+        result = adaptivepow_opencl_autotune(ctx->gpuContext, profilePath);
+    }
+#endif
+
+    return result;
+}
+
+// Run one GPU search pass from startNonce, updating stats and any pending
+// result. Returns the backend result code; *hashCountOut receives the number
+// of nonces the kernel actually covered.
+static int miner_run_search(MinerContext *ctx, const MiningJob *job,
+                            uint64_t startNonce, uint32_t *hashCountOut)
+{
+    // Hot-swap the job: new parameters simply apply to this launch, and
+    // bumping the version marks any still-pending result as stale
+    if (strncmp(ctx->jobId, job->jobId, sizeof(ctx->jobId)) != 0) {
+        strncpy(ctx->jobId, job->jobId, sizeof(ctx->jobId) - 1);
+        ctx->jobId[sizeof(ctx->jobId) - 1] = '\0';
+        ctx->jobVersion++;
+    }
 
     // Build header from job
     uint32_t header[20];
@@ -241,38 +311,154 @@ int miner_submit_job(MinerContext *ctx, const MiningJob *job)
 #ifdef WITH_CUDA
     if (ctx->isCuda) {
         result = adaptivepow_cuda_search(ctx->gpuContext, header, job->target,
-                                          ctx->currentNonce, &foundNonce, &hashCount);
+                                          startNonce, &foundNonce, &hashCount);
     }
 #endif
 
 #ifdef WITH_OPENCL
     if (!ctx->isCuda) {
         result = adaptivepow_opencl_search(ctx->gpuContext, header, job->target,
-                                            ctx->currentNonce, &foundNonce, &hashCount);
+                                            startNonce, &foundNonce, &hashCount);
     }
 #endif
 
     ctx->totalHashes += hashCount;
-    ctx->currentNonce += hashCount;
+    *hashCountOut = hashCount;
 
     if (result > 0) {
         // Found a valid nonce
         ctx->hasResult = true;
         ctx->pendingResult.found = true;
         ctx->pendingResult.nonce = foundNonce;
+        ctx->pendingResult.jobVersion = ctx->jobVersion;
         strncpy(ctx->pendingResult.jobId, job->jobId, sizeof(ctx->pendingResult.jobId) - 1);
     }
 
     return result;
 }
 
+// FNV-1a over the job id, used to derive deterministic per-job nonce
+// starting points: every process mining the job computes the same value
+// without any coordination.
+static uint64_t job_nonce_seed(const char *jobId)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (const char *p = jobId; *p; p++) {
+        h ^= (uint8_t)*p;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Deterministic starting nonce for a device on a job. The device index
+// occupies bits 40..47, so devices in one rig mine disjoint 2^40 slices
+// even on the unscheduled path; the cluster layer's per-rig slices live
+// above bit 48 and are unaffected. The job-id hash spreads the start
+// within the slice so a restart on the same job does not retrace ground
+// already covered.
+static uint64_t job_nonce_base(const MiningJob *job, int deviceId)
+{
+    return ((uint64_t)(deviceId & 0xFF) << 40) |
+           (job_nonce_seed(job->jobId) & 0xFFFFFFFFFFULL);
+}
+
+int miner_submit_job(MinerContext *ctx, const MiningJob *job)
+{
+    if (!ctx || !ctx->dagReady || !job) return -1;
+
+    // New job: jump to this device's deterministic slice of its nonce
+    // space instead of continuing from the old job's position
+    if (strncmp(ctx->jobId, job->jobId, sizeof(ctx->jobId)) != 0)
+        ctx->currentNonce = job_nonce_base(job, ctx->deviceId);
+
+    uint32_t hashCount = 0;
+    int result = miner_run_search(ctx, job, ctx->currentNonce, &hashCount);
+    ctx->currentNonce += hashCount;
+
+    return result;
+}
+
+WorkScheduler* scheduler_create(void)
+{
+    WorkScheduler *sched = new WorkScheduler();
+    sched->nextNonce.store(0);
+    sched->jobId[0] = '\0';
+    return sched;
+}
+
+void scheduler_destroy(WorkScheduler *sched)
+{
+    delete sched;
+}
+
+void scheduler_new_job(WorkScheduler *sched, const MiningJob *job)
+{
+    if (!sched || !job) return;
+
+    std::lock_guard<std::mutex> lock(sched->jobLock);
+    strncpy(sched->jobId, job->jobId, sizeof(sched->jobId) - 1);
+    sched->jobId[sizeof(sched->jobId) - 1] = '\0';
+    // Job-derived start (rather than 0) so a restarted rig does not
+    // retrace nonces it already covered; stays below bit 40, inside the
+    // cluster layer's slot-0 slice
+    sched->nextNonce.store(job_nonce_seed(job->jobId) & 0xFFFFFFFFFFULL);
+}
+
+void scheduler_set_base(WorkScheduler *sched, const MiningJob *job, uint64_t baseNonce)
+{
+    if (!sched || !job) return;
+
+    std::lock_guard<std::mutex> lock(sched->jobLock);
+    strncpy(sched->jobId, job->jobId, sizeof(sched->jobId) - 1);
+    sched->jobId[sizeof(sched->jobId) - 1] = '\0';
+    sched->nextNonce.store(baseNonce);
+}
+
+// Reserve the next chunk of nonces for this device, restarting the shared
+// counter first if the job changed underneath us.
+static uint64_t scheduler_next_chunk(WorkScheduler *sched, MinerContext *ctx, const MiningJob *job)
+{
+    {
+        std::lock_guard<std::mutex> lock(sched->jobLock);
+        if (strncmp(sched->jobId, job->jobId, sizeof(sched->jobId)) != 0) {
+            strncpy(sched->jobId, job->jobId, sizeof(sched->jobId) - 1);
+            sched->jobId[sizeof(sched->jobId) - 1] = '\0';
+            sched->nextNonce.store(job_nonce_seed(job->jobId) & 0xFFFFFFFFFFULL);
+        }
+    }
+    return sched->nextNonce.fetch_add(ctx->chunkSize);
+}
+
+int miner_submit_job_scheduled(MinerContext *ctx, const MiningJob *job, WorkScheduler *sched)
+{
+    if (!ctx || !ctx->dagReady || !job) return -1;
+    if (!sched) return miner_submit_job(ctx, job);
+
+    uint64_t startNonce = scheduler_next_chunk(sched, ctx, job);
+
+    uint32_t hashCount = 0;
+    int result = miner_run_search(ctx, job, startNonce, &hashCount);
+    ctx->currentNonce = startNonce + hashCount;
+
+    return result;
+}
+
 int miner_get_result(MinerContext *ctx, MiningResult *result)
 {
     if (!ctx || !result) return -1;
 
     if (ctx->hasResult) {
-        memcpy(result, &ctx->pendingResult, sizeof(MiningResult));
         ctx->hasResult = false;
+
+        // Result from a batch launched before a job switch: discard it
+        // rather than submitting against the wrong job
+        if (ctx->pendingResult.jobVersion != ctx->jobVersion) {
+            ctx->staleResults++;
+            result->found = false;
+            return 0;
+        }
+
+        memcpy(result, &ctx->pendingResult, sizeof(MiningResult));
         return 1;
     }
 
@@ -288,6 +474,7 @@ void miner_get_stats(MinerContext *ctx, MinerStats *stats)
     stats->totalHashes = ctx->totalHashes;
     stats->acceptedShares = ctx->acceptedShares;
     stats->rejectedShares = ctx->rejectedShares;
+    stats->staleResults = ctx->staleResults;
     stats->currentEpoch = ctx->epoch;
     stats->dagSize = ctx->dagSize;
     stats->uptime = difftime(time(NULL), ctx->startTime);
@@ -297,6 +484,26 @@ void miner_get_stats(MinerContext *ctx, MinerStats *stats)
         stats->hashrate = stats->totalHashes / stats->uptime;
     }
 
+    // Auto-tune the scheduler chunk size from the hashrate measured since
+    // the previous stats call, aiming for SCHED_CHUNK_SECONDS of work per
+    // pull: slow cards pull small chunks often, fast cards stay fed.
+    time_t statTime = time(NULL);
+    if (statTime > ctx->lastStatTime && ctx->totalHashes > ctx->lastStatHashes) {
+        double measured = (double)(ctx->totalHashes - ctx->lastStatHashes) /
+                          difftime(statTime, ctx->lastStatTime);
+        ctx->emaHashrate = (ctx->emaHashrate > 0)
+                               ? 0.7 * ctx->emaHashrate + 0.3 * measured
+                               : measured;
+
+        uint64_t chunk = (uint64_t)(ctx->emaHashrate * SCHED_CHUNK_SECONDS);
+        if (chunk < SCHED_MIN_CHUNK) chunk = SCHED_MIN_CHUNK;
+        if (chunk > SCHED_MAX_CHUNK) chunk = SCHED_MAX_CHUNK;
+        ctx->chunkSize = chunk;
+
+        ctx->lastStatHashes = ctx->totalHashes;
+        ctx->lastStatTime = statTime;
+    }
+
     // GPU temperature would require platform-specific API calls
     stats->gpuTemp = 0;  // Not implemented
     stats->gpuPower = 0;
@@ -314,6 +521,51 @@ int miner_update_epoch(MinerContext *ctx, uint32_t newEpoch)
     return miner_generate_dag(ctx);
 }
 
+int miner_prepare_epoch(MinerContext *ctx, uint32_t newEpoch)
+{
+    if (!ctx || !ctx->dagReady) return -1;
+
+#ifdef WITH_CUDA
+    if (ctx->isCuda) {
+        return adaptivepow_cuda_prepare_epoch(ctx->gpuContext, newEpoch);
+    }
+#endif
+
+    // The OpenCL backend has no background build yet; the caller falls
+    // back to a blocking miner_update_epoch at the boundary
+    return -1;
+}
+
+int miner_poll_epoch(MinerContext *ctx)
+{
+    if (!ctx) return -1;
+
+#ifdef WITH_CUDA
+    if (ctx->isCuda) {
+        return adaptivepow_cuda_dag_slice(ctx->gpuContext);
+    }
+#endif
+
+    return -1;
+}
+
+int miner_switch_epoch(MinerContext *ctx, uint32_t newEpoch)
+{
+    if (!ctx) return -1;
+
+#ifdef WITH_CUDA
+    if (ctx->isCuda) {
+        if (adaptivepow_cuda_switch_epoch(ctx->gpuContext) == 0) {
+            ctx->epoch = newEpoch;
+            ctx->dagSize = adaptivepow_get_dag_size(newEpoch);
+            return 0;
+        }
+    }
+#endif
+
+    return -1;
+}
+
 void miner_shutdown(MinerContext *ctx)
 {
     if (!ctx) return;
@@ -376,7 +628,17 @@ double target_to_difficulty(uint64_t target)
 
 bool verify_solution(const MiningJob *job, const MiningResult *result)
 {
-    // TODO: Implement full verification
-    // This would recompute the hash and compare against target
-    return result->found;
+    if (!job || !result || !result->found) return false;
+
+    // Stale result from an in-flight batch that straddled a job switch
+    if (strncmp(result->jobId, job->jobId, sizeof(result->jobId)) != 0) {
+        return false;
+    }
+
+    // AdaptivePow jobs carry no N-factor; full CPU verification there
+    // would need the DAG, so the GPU's own check stands
+    if (job->nFactor == 0) return true;
+
+    MiningResult copy = *result;
+    return verify_solutions(job, &copy, 1, job->nFactor) == 1;
 }
@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -39,6 +40,7 @@ typedef struct {
     uint32_t nTime;
     uint32_t nBits;
     uint32_t epoch;            // Current DAG epoch
+    uint32_t nFactor;          // Scrypt-jane N-factor (0 when not used)
     uint64_t dagSize;          // Current DAG size in bytes
     uint64_t target;           // 64-bit target for GPU comparison
     uint8_t  target256[32];    // Full 256-bit target
@@ -48,6 +50,7 @@ typedef struct {
 // Mining result
 typedef struct {
     char     jobId[64];
+    uint32_t jobVersion;       // Job generation the batch was launched under
     uint64_t nonce;            // 64-bit nonce
     uint8_t  mixHash[32];      // Mix hash for verification
     uint8_t  hash[32];         // Final hash
@@ -72,6 +75,7 @@ typedef struct {
     uint64_t totalHashes;
     uint64_t acceptedShares;
     uint64_t rejectedShares;
+    uint64_t staleResults;     // Results discarded across job switches
     uint32_t currentEpoch;
     uint64_t dagSize;
     double   uptime;
@@ -82,6 +86,11 @@ typedef struct {
 // Miner context (opaque)
 typedef struct MinerContext MinerContext;
 
+// Shared work scheduler (opaque). All devices mining the same job pull
+// small nonce chunks from it instead of being assigned static ranges, so
+// fast cards simply pull more often than slow ones and never sit idle.
+typedef struct WorkScheduler WorkScheduler;
+
 // ==================== AdaptivePow Functions ====================
 
 // Calculate epoch from timestamp
@@ -110,15 +119,54 @@ bool miner_dag_ready(MinerContext *ctx);
 // Process a mining job (non-blocking, returns immediately)
 int miner_submit_job(MinerContext *ctx, const MiningJob *job);
 
+// Create/destroy a work scheduler (one per rig, shared by all contexts)
+WorkScheduler* scheduler_create(void);
+void scheduler_destroy(WorkScheduler *sched);
+
+// Reset the scheduler's nonce counter for a new job. Also happens
+// automatically when a job with a different jobId is submitted.
+void scheduler_new_job(WorkScheduler *sched, const MiningJob *job);
+
+// Like scheduler_new_job, but start the nonce counter at baseNonce
+// instead of 0. Used in cluster mode, where the coordinator assigns each
+// rig a disjoint slice of the nonce space per job.
+void scheduler_set_base(WorkScheduler *sched, const MiningJob *job, uint64_t baseNonce);
+
+// Like miner_submit_job, but pulls the starting nonce from the shared
+// scheduler. The chunk reserved per pull is sized per device from the
+// hashrate measured in miner_get_stats.
+int miner_submit_job_scheduled(MinerContext *ctx, const MiningJob *job, WorkScheduler *sched);
+
+// Sweep launch configurations for the current epoch and apply the fastest
+// one, persisting it per device so later starts skip the sweep. Call after
+// the DAG is ready. profilePath may be NULL to skip persistence.
+int miner_autotune(MinerContext *ctx, const char *profilePath);
+
 // Check for mining results
 int miner_get_result(MinerContext *ctx, MiningResult *result);
 
 // Get mining statistics
 void miner_get_stats(MinerContext *ctx, MinerStats *stats);
 
-// Update to new epoch (regenerates DAG)
+// Update to new epoch (regenerates DAG, blocking - hash rate drops to
+// zero for the duration; prefer the prepare/poll/switch path below)
 int miner_update_epoch(MinerContext *ctx, uint32_t newEpoch);
 
+// Start building the given epoch's DAG into a second GPU buffer in the
+// background. Returns 0 if the build was started (or already running),
+// negative if the backend cannot prepare ahead (fall back to
+// miner_update_epoch at the boundary).
+int miner_prepare_epoch(MinerContext *ctx, uint32_t newEpoch);
+
+// Advance the background DAG build by one bounded slice. Call from the
+// mining loop; it never blocks. Returns 1 once the next DAG is complete,
+// 0 while in progress, negative if none is being prepared.
+int miner_poll_epoch(MinerContext *ctx);
+
+// Atomically switch to the prepared DAG. Only succeeds after
+// miner_poll_epoch has returned 1; mining continues without a pause.
+int miner_switch_epoch(MinerContext *ctx, uint32_t newEpoch);
+
 // Cleanup and free resources
 void miner_shutdown(MinerContext *ctx);
 
@@ -133,9 +181,42 @@ void bits_to_target256(uint32_t nBits, uint8_t target[32]);
 // Calculate difficulty from target
 double target_to_difficulty(uint64_t target);
 
-// Verify a solution
+// Verify a solution by re-hashing on the CPU (scrypt-jane jobs only;
+// jobs without an N-factor pass through unchecked)
 bool verify_solution(const MiningJob *job, const MiningResult *result);
 
+// Verify a batch of queued results, re-hashing with the SIMD scrypt-jane
+// path and splitting large batches across worker threads. Results that
+// fail get found cleared. Returns the number of valid shares, or -1.
+int verify_solutions(const MiningJob *job, MiningResult *results,
+                     int count, uint32_t Nfactor);
+
+// Compare a hash against a 256-bit target (both little-endian byte
+// order, as produced by bits_to_target256). SSE2 where available.
+bool hash_meets_target256(const uint8_t hash[32], const uint8_t target[32]);
+
+// Per-GPU scoreboard of candidate results. The GPU only checks the
+// coarse 64-bit target, so candidates are first batch-compared against
+// the job's precomputed 256-bit target and only the survivors are
+// escalated to the full verify_solutions re-hash. Candidates whose
+// hash the backend did not report (all zero) pass straight through to
+// the full check.
+#define SCOREBOARD_SIZE 64
+typedef struct {
+    MiningResult results[SCOREBOARD_SIZE];
+    int          count;
+} ResultScoreboard;
+
+void scoreboard_reset(ResultScoreboard *sb);
+
+// Add a candidate; returns -1 if the scoreboard is full (flush first)
+int scoreboard_push(ResultScoreboard *sb, const MiningResult *result);
+
+// Filter the collected candidates against the job's 256-bit target and
+// re-hash the survivors. Failing and stale entries get found cleared.
+// Returns the number of submittable shares, or -1.
+int scoreboard_flush(ResultScoreboard *sb, const MiningJob *job);
+
 #ifdef __cplusplus
 }
 #endif
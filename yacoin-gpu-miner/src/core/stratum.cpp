@@ -8,6 +8,10 @@
 #include <string.h>
 #include <errno.h>
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 #ifdef _WIN32
     #include <winsock2.h>
     #include <ws2tcpip.h>
@@ -35,6 +39,33 @@ static int recvBufferLen = 0;
 // JSON-RPC ID counter
 static int rpcId = 1;
 
+// Async share submission: GPU loops push found shares into a lock-free
+// bounded ring (Vyukov-style sequence numbers, multi-producer / single
+// consumer) and a dedicated thread drains it, pipelining mining.submit
+// calls without waiting for responses. Responses come back through the
+// normal stratum_poll path and are matched by request id.
+#define SUBMIT_QUEUE_SIZE 256   // Power of two
+#define SUBMIT_QUEUE_MASK (SUBMIT_QUEUE_SIZE - 1)
+#define SUBMIT_MAX_INFLIGHT 64
+
+static MiningResult g_submitSlots[SUBMIT_QUEUE_SIZE];
+static std::atomic<uint32_t> g_submitSeq[SUBMIT_QUEUE_SIZE];
+static std::atomic<uint32_t> g_submitHead(0);
+static std::atomic<uint32_t> g_submitTail(0);
+
+static std::thread g_submitThread;
+static std::atomic<bool> g_submitRunning(false);
+
+// Serializes socket writes between the submitter and the main thread
+static std::mutex g_sendLock;
+
+// Request ids of submits still awaiting a pool response
+static std::mutex g_inflightLock;
+static int g_inflightIds[SUBMIT_MAX_INFLIGHT];
+static int g_numInflight = 0;
+
+static bool inflight_take(int id);
+
 // Helper: Parse URL into host/port
 static int parse_url(const char *url, char *host, int *port, bool *useTLS)
 {
@@ -67,13 +98,18 @@ static int parse_url(const char *url, char *host, int *port, bool *useTLS)
     return 0;
 }
 
-// Helper: Send JSON-RPC request
-static int send_json(StratumClient *client, const char *method, const char *params)
+// Helper: Send JSON-RPC request, optionally reporting the id used so the
+// caller can match the response later
+static int send_json_id(StratumClient *client, const char *method, const char *params, int *idOut)
 {
     char buffer[1024];
+
+    std::lock_guard<std::mutex> lock(g_sendLock);
+
+    int id = rpcId++;
     int len = snprintf(buffer, sizeof(buffer),
         "{\"id\":%d,\"method\":\"%s\",\"params\":%s}\n",
-        rpcId++, method, params);
+        id, method, params);
 
     int sent = send(client->socket, buffer, len, 0);
     if (sent != len) {
@@ -82,9 +118,16 @@ static int send_json(StratumClient *client, const char *method, const char *para
     }
 
     printf("Stratum TX: %s", buffer);
+    if (idOut) *idOut = id;
     return 0;
 }
 
+// Helper: Send JSON-RPC request
+static int send_json(StratumClient *client, const char *method, const char *params)
+{
+    return send_json_id(client, method, params, NULL);
+}
+
 // Helper: Receive and parse JSON response
 static json_object* recv_json(StratumClient *client)
 {
@@ -118,6 +161,30 @@ static json_object* recv_json(StratumClient *client)
     return json_tokener_parse(msgBuffer);
 }
 
+// Helper: Fill the job's 64-bit and 256-bit targets. Computed once here,
+// when a notify or set_difficulty arrives -- never per candidate or
+// per submission.
+static void update_job_target(StratumClient *client)
+{
+    MiningJob *job = &client->currentJob;
+
+    if (client->difficulty > 0.0) {
+        // Pool share target: the classic diff-1 target scaled down
+        double t = (double)0x00000000FFFF0000ULL / client->difficulty;
+        uint64_t target64 = (t >= (double)UINT64_MAX) ? UINT64_MAX : (uint64_t)t;
+        job->target = target64;
+        // The top eight bytes carry the share target; everything below is
+        // permissive so borderline shares are submitted, not dropped
+        memset(job->target256, 0xFF, 24);
+        for (int i = 0; i < 8; i++) {
+            job->target256[24 + i] = (uint8_t)(target64 >> (8 * i));
+        }
+    } else {
+        job->target = bits_to_target64(job->nBits);
+        bits_to_target256(job->nBits, job->target256);
+    }
+}
+
 // Helper: Parse mining.notify parameters into MiningJob
 static int parse_notify(StratumClient *client, json_object *params)
 {
@@ -155,6 +222,8 @@ static int parse_notify(StratumClient *client, json_object *params)
     // params[8] = clean_jobs
     job->cleanJobs = json_object_get_boolean(json_object_array_get_idx(params, 8));
 
+    update_job_target(client);
+
     client->hasJob = true;
     return 0;
 }
@@ -326,6 +395,28 @@ int stratum_poll(StratumClient *client)
             if (json_object_object_get_ex(msg, "params", &params)) {
                 double diff = json_object_get_double(json_object_array_get_idx(params, 0));
                 printf("Stratum: Difficulty set to %.4f\n", diff);
+                client->difficulty = diff;
+                if (client->hasJob) {
+                    update_job_target(client);
+                }
+            }
+        }
+    } else {
+        // Response to a pipelined submit from the background submitter
+        json_object *idObj;
+        if (json_object_object_get_ex(msg, "id", &idObj) &&
+            inflight_take(json_object_get_int(idObj))) {
+            json_object *resultObj;
+            bool accepted = json_object_object_get_ex(msg, "result", &resultObj) &&
+                            json_object_get_boolean(resultObj);
+            if (accepted) {
+                client->sharesAccepted++;
+                printf("Stratum: Share accepted! (%lu/%lu)\n",
+                       client->sharesAccepted, client->sharesSent);
+            } else {
+                client->sharesRejected++;
+                printf("Stratum: Share rejected! (%lu rejected)\n",
+                       client->sharesRejected);
             }
         }
     }
@@ -375,6 +466,132 @@ int stratum_submit(StratumClient *client, const MiningResult *result)
     return 0;
 }
 
+// Record a submit id awaiting its response. Oldest entry is dropped if
+// the pool stops answering; its response would then just be ignored.
+static void inflight_add(int id)
+{
+    std::lock_guard<std::mutex> lock(g_inflightLock);
+    if (g_numInflight == SUBMIT_MAX_INFLIGHT) {
+        memmove(g_inflightIds, g_inflightIds + 1, (SUBMIT_MAX_INFLIGHT - 1) * sizeof(int));
+        g_numInflight--;
+    }
+    g_inflightIds[g_numInflight++] = id;
+}
+
+// Claim a response id if it belongs to a pending submit
+static bool inflight_take(int id)
+{
+    std::lock_guard<std::mutex> lock(g_inflightLock);
+    for (int i = 0; i < g_numInflight; i++) {
+        if (g_inflightIds[i] == id) {
+            memmove(g_inflightIds + i, g_inflightIds + i + 1,
+                    (g_numInflight - i - 1) * sizeof(int));
+            g_numInflight--;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Queue a share for the background submitter and return immediately
+int stratum_submit_async(StratumClient *client, const MiningResult *result)
+{
+    (void)client;
+
+    uint32_t pos = g_submitHead.load(std::memory_order_relaxed);
+    for (;;) {
+        uint32_t seq = g_submitSeq[pos & SUBMIT_QUEUE_MASK].load(std::memory_order_acquire);
+        int32_t dif = (int32_t)(seq - pos);
+        if (dif == 0) {
+            if (g_submitHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (dif < 0) {
+            return -1;  // Queue full - drop the share rather than stall the GPU
+        } else {
+            pos = g_submitHead.load(std::memory_order_relaxed);
+        }
+    }
+
+    g_submitSlots[pos & SUBMIT_QUEUE_MASK] = *result;
+    g_submitSeq[pos & SUBMIT_QUEUE_MASK].store(pos + 1, std::memory_order_release);
+    return 0;
+}
+
+// Pop one queued share. Single consumer (the submitter thread).
+static bool submit_queue_pop(MiningResult *out)
+{
+    uint32_t pos = g_submitTail.load(std::memory_order_relaxed);
+    uint32_t seq = g_submitSeq[pos & SUBMIT_QUEUE_MASK].load(std::memory_order_acquire);
+    if ((int32_t)(seq - (pos + 1)) < 0) {
+        return false;  // Empty
+    }
+
+    *out = g_submitSlots[pos & SUBMIT_QUEUE_MASK];
+    g_submitSeq[pos & SUBMIT_QUEUE_MASK].store(pos + SUBMIT_QUEUE_SIZE, std::memory_order_release);
+    g_submitTail.store(pos + 1, std::memory_order_relaxed);
+    return true;
+}
+
+// Drain the share queue, sending mining.submit calls back to back
+// without waiting for responses
+static void submit_thread_main(StratumClient *client)
+{
+    while (g_submitRunning.load(std::memory_order_relaxed)) {
+        MiningResult result;
+        if (!submit_queue_pop(&result)) {
+#ifdef _WIN32
+            Sleep(1);
+#else
+            usleep(1000);
+#endif
+            continue;
+        }
+
+        char params[512];
+        snprintf(params, sizeof(params),
+            "[\"%s\",\"%s\",\"%s\",\"%08x\",\"%08x\"]",
+            client->config.user,
+            result.jobId,
+            "0000",  // extranonce2
+            client->currentJob.nTime,
+            (uint32_t)result.nonce);
+
+        int id;
+        if (send_json_id(client, "mining.submit", params, &id) == 0) {
+            inflight_add(id);
+            client->sharesSent++;
+        }
+    }
+}
+
+int stratum_start_submitter(StratumClient *client)
+{
+    if (g_submitRunning.load()) return 0;
+
+    for (uint32_t i = 0; i < SUBMIT_QUEUE_SIZE; i++) {
+        g_submitSeq[i].store(i, std::memory_order_relaxed);
+    }
+    g_submitHead.store(0);
+    g_submitTail.store(0);
+    g_numInflight = 0;
+
+    g_submitRunning.store(true);
+    g_submitThread = std::thread(submit_thread_main, client);
+    return 0;
+}
+
+void stratum_stop_submitter(StratumClient *client)
+{
+    (void)client;
+
+    if (!g_submitRunning.load()) return;
+    g_submitRunning.store(false);
+    if (g_submitThread.joinable()) {
+        g_submitThread.join();
+    }
+}
+
 // Disconnect
 void stratum_disconnect(StratumClient *client)
 {
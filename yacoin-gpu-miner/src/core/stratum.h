@@ -41,6 +41,7 @@ typedef struct {
     int           extraNonce2Size;
     MiningJob     currentJob;
     bool          hasJob;
+    double        difficulty;     // Pool share difficulty, 0 until set_difficulty
     uint64_t      sharesSent;
     uint64_t      sharesAccepted;
     uint64_t      sharesRejected;
@@ -61,9 +62,19 @@ int stratum_authorize(StratumClient *client);
 // Poll for new jobs (non-blocking)
 int stratum_poll(StratumClient *client);
 
-// Submit share
+// Submit share and wait for the pool's response
 int stratum_submit(StratumClient *client, const MiningResult *result);
 
+// Queue a share for the background submitter and return immediately.
+// Returns -1 if the queue is full (the share is dropped).
+int stratum_submit_async(StratumClient *client, const MiningResult *result);
+
+// Start/stop the background submission thread. While it runs, responses
+// to queued submits are matched by request id in stratum_poll, so the
+// mining loop never waits on a submission round-trip.
+int stratum_start_submitter(StratumClient *client);
+void stratum_stop_submitter(StratumClient *client);
+
 // Disconnect
 void stratum_disconnect(StratumClient *client);
 
@@ -0,0 +1,215 @@
+/*
+ * Scrypt Coin GPU Miner - Telemetry Ring Buffer and Stats Endpoint
+ *
+ * The ring uses per-slot sequence counters (seqlock style): the writer
+ * marks a slot odd while filling it, readers retry a slot whose sequence
+ * changed underneath them. One writer (the mining loop), any readers.
+ */
+
+#include "telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <atomic>
+#include <thread>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    typedef int socklen_t;
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    #define closesocket close
+    #define INVALID_SOCKET -1
+#endif
+
+// Ring capacity: at one sample per second per device this holds several
+// minutes of history for an 8-GPU rig
+#define TELEMETRY_RING_SIZE 1024
+#define TELEMETRY_RING_MASK (TELEMETRY_RING_SIZE - 1)
+
+static TelemetrySample g_samples[TELEMETRY_RING_SIZE];
+static std::atomic<uint32_t> g_slotSeq[TELEMETRY_RING_SIZE];
+static std::atomic<uint32_t> g_head(0);
+
+static std::thread g_httpThread;
+static std::atomic<bool> g_httpRunning(false);
+static int g_listenSocket = INVALID_SOCKET;
+
+void telemetry_record(const TelemetrySample *sample)
+{
+    if (!sample) return;
+
+    uint32_t pos = g_head.load(std::memory_order_relaxed);
+    uint32_t slot = pos & TELEMETRY_RING_MASK;
+
+    // Odd sequence = slot being written; readers retry
+    uint32_t seq = g_slotSeq[slot].load(std::memory_order_relaxed);
+    g_slotSeq[slot].store(seq + 1, std::memory_order_release);
+    g_samples[slot] = *sample;
+    g_slotSeq[slot].store(seq + 2, std::memory_order_release);
+
+    g_head.store(pos + 1, std::memory_order_release);
+}
+
+int telemetry_snapshot(TelemetrySample *out, int maxSamples)
+{
+    if (!out || maxSamples <= 0) return 0;
+
+    uint32_t head = g_head.load(std::memory_order_acquire);
+    uint32_t available = (head < TELEMETRY_RING_SIZE) ? head : TELEMETRY_RING_SIZE;
+    uint32_t want = ((uint32_t)maxSamples < available) ? (uint32_t)maxSamples : available;
+
+    int copied = 0;
+    for (uint32_t i = 0; i < want; i++) {
+        uint32_t pos = head - want + i;
+        uint32_t slot = pos & TELEMETRY_RING_MASK;
+
+        // Seqlock read: retry while the writer is in the slot
+        for (int attempt = 0; attempt < 4; attempt++) {
+            uint32_t seqBefore = g_slotSeq[slot].load(std::memory_order_acquire);
+            if (seqBefore & 1) continue;
+            TelemetrySample sample = g_samples[slot];
+            uint32_t seqAfter = g_slotSeq[slot].load(std::memory_order_acquire);
+            if (seqBefore == seqAfter) {
+                out[copied++] = sample;
+                break;
+            }
+        }
+    }
+
+    return copied;
+}
+
+// Append one sample as a JSON object
+static int append_sample_json(char *buf, size_t bufSize, const TelemetrySample *s, bool first)
+{
+    return snprintf(buf, bufSize,
+        "%s{\"time\":%llu,\"device\":%d,\"hashrate\":%.0f,"
+        "\"accepted\":%llu,\"rejected\":%llu,\"stale\":%llu,"
+        "\"temp\":%.1f,\"batch_ms\":%.2f}",
+        first ? "" : ",",
+        (unsigned long long)s->timestamp, s->deviceId, s->hashrate,
+        (unsigned long long)s->acceptedShares,
+        (unsigned long long)s->rejectedShares,
+        (unsigned long long)s->staleResults,
+        s->gpuTemp, s->lastBatchMs);
+}
+
+// Serve one connection: ignore the request, answer with the sample
+// window as JSON
+static void serve_client(int client)
+{
+    char reqBuf[1024];
+    recv(client, reqBuf, sizeof(reqBuf) - 1, 0);
+
+    static TelemetrySample samples[TELEMETRY_RING_SIZE];
+    int count = telemetry_snapshot(samples, TELEMETRY_RING_SIZE);
+
+    // Worst case ~160 bytes per sample
+    size_t bodyCap = (size_t)count * 192 + 16;
+    char *body = (char*)malloc(bodyCap);
+    if (!body) {
+        closesocket(client);
+        return;
+    }
+
+    size_t bodyLen = 0;
+    body[bodyLen++] = '[';
+    for (int i = 0; i < count; i++) {
+        int n = append_sample_json(body + bodyLen, bodyCap - bodyLen - 2,
+                                   &samples[i], i == 0);
+        if (n < 0 || (size_t)n >= bodyCap - bodyLen - 2) break;
+        bodyLen += n;
+    }
+    body[bodyLen++] = ']';
+    body[bodyLen] = '\0';
+
+    char header[256];
+    int headerLen = snprintf(header, sizeof(header),
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: %zu\r\n"
+        "Connection: close\r\n"
+        "\r\n",
+        bodyLen);
+
+    send(client, header, headerLen, 0);
+    send(client, body, bodyLen, 0);
+
+    free(body);
+    closesocket(client);
+}
+
+static void http_thread_main(void)
+{
+    while (g_httpRunning.load(std::memory_order_relaxed)) {
+        // Wait for a connection with a timeout so shutdown is prompt
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(g_listenSocket, &readfds);
+        struct timeval tv;
+        tv.tv_sec = 0;
+        tv.tv_usec = 200 * 1000;
+
+        int ready = select(g_listenSocket + 1, &readfds, NULL, NULL, &tv);
+        if (ready <= 0) continue;
+
+        int client = accept(g_listenSocket, NULL, NULL);
+        if (client == INVALID_SOCKET) continue;
+
+        serve_client(client);
+    }
+}
+
+int telemetry_http_start(int port)
+{
+    if (g_httpRunning.load()) return 0;
+
+    g_listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (g_listenSocket == INVALID_SOCKET) {
+        fprintf(stderr, "Telemetry: failed to create socket\n");
+        return -1;
+    }
+
+    int reuse = 1;
+    setsockopt(g_listenSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    if (bind(g_listenSocket, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(g_listenSocket, 8) != 0) {
+        fprintf(stderr, "Telemetry: failed to bind port %d: %s\n", port, strerror(errno));
+        closesocket(g_listenSocket);
+        g_listenSocket = INVALID_SOCKET;
+        return -1;
+    }
+
+    g_httpRunning.store(true);
+    g_httpThread = std::thread(http_thread_main);
+
+    printf("Telemetry: stats endpoint on http://0.0.0.0:%d/\n", port);
+    return 0;
+}
+
+void telemetry_http_stop(void)
+{
+    if (!g_httpRunning.load()) return;
+
+    g_httpRunning.store(false);
+    if (g_httpThread.joinable()) {
+        g_httpThread.join();
+    }
+    if (g_listenSocket != INVALID_SOCKET) {
+        closesocket(g_listenSocket);
+        g_listenSocket = INVALID_SOCKET;
+    }
+}
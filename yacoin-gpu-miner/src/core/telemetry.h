@@ -0,0 +1,47 @@
+/*
+ * Scrypt Coin GPU Miner - Telemetry Ring Buffer and Stats Endpoint
+ *
+ * Keeps a lock-free time series of per-device samples and serves the
+ * recent window as JSON over a minimal embedded HTTP endpoint, so fleet
+ * monitors can poll rigs every second without log scraping.
+ */
+
+#ifndef SCRYPT_TELEMETRY_H
+#define SCRYPT_TELEMETRY_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One per-device sample
+typedef struct {
+    uint64_t timestamp;        // Unix time the sample was taken
+    int      deviceId;
+    double   hashrate;         // Hashes per second over the last interval
+    uint64_t acceptedShares;
+    uint64_t rejectedShares;
+    uint64_t staleResults;
+    double   gpuTemp;          // Celsius (0 if unavailable)
+    double   lastBatchMs;      // Wall time of the most recent GPU batch
+} TelemetrySample;
+
+// Record a sample. Lock-free; safe to call from the mining loop while
+// the HTTP thread reads.
+void telemetry_record(const TelemetrySample *sample);
+
+// Copy up to maxSamples of the most recent samples (oldest first).
+// Returns the number copied.
+int telemetry_snapshot(TelemetrySample *out, int maxSamples);
+
+// Start/stop the HTTP stats endpoint on the given port. GET / returns
+// the sample window as a JSON array.
+int telemetry_http_start(int port);
+void telemetry_http_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCRYPT_TELEMETRY_H
@@ -0,0 +1,317 @@
+/*
+ * Scrypt Coin GPU Miner - CPU Solution Verification
+ *
+ * Re-hashes candidate shares on the CPU before submission, mirroring the
+ * scrypt-jane ChaCha20/8 computation in cuda/scrypt_jane.cu. The ChaCha
+ * core is SSE2-vectorized (same row layout as the node's
+ * scrypt-jane-mix_chacha-sse2.h), and batches share one scratch buffer
+ * per worker thread so verification keeps up with 8-GPU share rates.
+ */
+
+#include "miner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #define VERIFY_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+// Scrypt-jane parameters (r = 1, matching the GPU kernel)
+#define SCRYPT_BLOCK_WORDS 16
+#define SCRYPT_CHUNK_WORDS (SCRYPT_BLOCK_WORDS * 2)
+
+// Batches at least this large are split across worker threads
+#define VERIFY_THREAD_MIN  4
+#define VERIFY_MAX_THREADS 4
+
+#ifdef VERIFY_SSE2
+
+#define ROTL128(x, n) _mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n)))
+
+// ChaCha20/8 core, four columns per row register. The diagonal rounds
+// shuffle rows into column position and back, which is equivalent to the
+// scalar quarter-round pattern in the CUDA kernel.
+static void chacha_core(uint32_t state[16])
+{
+    __m128i a = _mm_loadu_si128((const __m128i*)&state[0]);
+    __m128i b = _mm_loadu_si128((const __m128i*)&state[4]);
+    __m128i c = _mm_loadu_si128((const __m128i*)&state[8]);
+    __m128i d = _mm_loadu_si128((const __m128i*)&state[12]);
+    __m128i a0 = a, b0 = b, c0 = c, d0 = d;
+
+    for (int i = 0; i < 4; i++) {
+        // Column rounds
+        a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL128(d, 16);
+        c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL128(b, 12);
+        a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL128(d, 8);
+        c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL128(b, 7);
+
+        // Rotate rows into diagonal position
+        b = _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 3, 2, 1));
+        c = _mm_shuffle_epi32(c, _MM_SHUFFLE(1, 0, 3, 2));
+        d = _mm_shuffle_epi32(d, _MM_SHUFFLE(2, 1, 0, 3));
+
+        // Diagonal rounds
+        a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL128(d, 16);
+        c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL128(b, 12);
+        a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL128(d, 8);
+        c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL128(b, 7);
+
+        // Rotate back
+        b = _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 1, 0, 3));
+        c = _mm_shuffle_epi32(c, _MM_SHUFFLE(1, 0, 3, 2));
+        d = _mm_shuffle_epi32(d, _MM_SHUFFLE(0, 3, 2, 1));
+    }
+
+    _mm_storeu_si128((__m128i*)&state[0],  _mm_add_epi32(a, a0));
+    _mm_storeu_si128((__m128i*)&state[4],  _mm_add_epi32(b, b0));
+    _mm_storeu_si128((__m128i*)&state[8],  _mm_add_epi32(c, c0));
+    _mm_storeu_si128((__m128i*)&state[12], _mm_add_epi32(d, d0));
+}
+
+#else // scalar fallback
+
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define QUARTER_ROUND(a, b, c, d) \
+    a += b; d ^= a; d = ROTL32(d, 16); \
+    c += d; b ^= c; b = ROTL32(b, 12); \
+    a += b; d ^= a; d = ROTL32(d, 8);  \
+    c += d; b ^= c; b = ROTL32(b, 7);
+
+static void chacha_core(uint32_t state[16])
+{
+    uint32_t x[16];
+    memcpy(x, state, sizeof(x));
+
+    for (int i = 0; i < 4; i++) {
+        QUARTER_ROUND(x[0], x[4], x[8],  x[12]);
+        QUARTER_ROUND(x[1], x[5], x[9],  x[13]);
+        QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        QUARTER_ROUND(x[2], x[7], x[8],  x[13]);
+        QUARTER_ROUND(x[3], x[4], x[9],  x[14]);
+    }
+
+    for (int i = 0; i < 16; i++) {
+        state[i] += x[i];
+    }
+}
+
+#endif // VERIFY_SSE2
+
+// Block mixing, identical structure to the GPU kernel (r = 1)
+static void scrypt_block_mix(const uint32_t *B, uint32_t *Bout)
+{
+    uint32_t X[SCRYPT_BLOCK_WORDS];
+
+    memcpy(X, &B[SCRYPT_BLOCK_WORDS], SCRYPT_BLOCK_WORDS * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < 2; i++) {
+        for (int j = 0; j < SCRYPT_BLOCK_WORDS; j++) {
+            X[j] ^= B[i * SCRYPT_BLOCK_WORDS + j];
+        }
+        chacha_core(X);
+        uint32_t outIdx = (i / 2) + (i & 1);
+        memcpy(&Bout[outIdx * SCRYPT_BLOCK_WORDS], X, SCRYPT_BLOCK_WORDS * sizeof(uint32_t));
+    }
+}
+
+// ROMix over a caller-provided scratch buffer of N chunks
+static void scrypt_romix(uint32_t *X, uint32_t *V, uint32_t N)
+{
+    uint32_t Y[SCRYPT_CHUNK_WORDS];
+
+    for (uint32_t i = 0; i < N; i++) {
+        memcpy(&V[i * SCRYPT_CHUNK_WORDS], X, SCRYPT_CHUNK_WORDS * sizeof(uint32_t));
+        scrypt_block_mix(X, Y);
+        memcpy(X, Y, SCRYPT_CHUNK_WORDS * sizeof(uint32_t));
+    }
+
+    for (uint32_t i = 0; i < N; i++) {
+        uint32_t j = X[SCRYPT_CHUNK_WORDS - SCRYPT_BLOCK_WORDS] & (N - 1);
+        for (uint32_t k = 0; k < SCRYPT_CHUNK_WORDS; k++) {
+            X[k] ^= V[j * SCRYPT_CHUNK_WORDS + k];
+        }
+        scrypt_block_mix(X, Y);
+        memcpy(X, Y, SCRYPT_CHUNK_WORDS * sizeof(uint32_t));
+    }
+}
+
+// Re-hash one candidate exactly as the GPU kernel does and compare the
+// high hash word against the target
+static bool verify_one(const uint32_t header[20], uint32_t nonce,
+                       uint32_t N, uint32_t targetHigh, uint32_t *V)
+{
+    uint32_t h[20];
+    uint32_t X[SCRYPT_CHUNK_WORDS];
+
+    memcpy(h, header, sizeof(h));
+    h[19] = nonce;
+
+    for (int i = 0; i < SCRYPT_CHUNK_WORDS; i++) {
+        X[i] = h[i % 20];
+    }
+
+    scrypt_romix(X, V, N);
+
+    return X[7] <= targetHigh;
+}
+
+// Verify a contiguous range of results with one scratch buffer
+static void verify_range(const uint32_t *header, MiningResult *results,
+                         int start, int end, uint32_t N, uint32_t targetHigh,
+                         int *validOut)
+{
+    uint32_t *V = (uint32_t*)malloc((size_t)N * SCRYPT_CHUNK_WORDS * sizeof(uint32_t));
+    if (!V) {
+        *validOut = -1;
+        return;
+    }
+
+    int valid = 0;
+    for (int i = start; i < end; i++) {
+        if (!results[i].found) continue;
+        if (verify_one(header, (uint32_t)results[i].nonce, N, targetHigh, V)) {
+            valid++;
+        } else {
+            results[i].found = false;
+        }
+    }
+
+    free(V);
+    *validOut = valid;
+}
+
+extern "C" int verify_solutions(const MiningJob *job, MiningResult *results,
+                                int count, uint32_t Nfactor)
+{
+    if (!job || !results || count <= 0) return -1;
+
+    uint32_t N = 1u << (Nfactor + 1);
+    uint32_t targetHigh = (uint32_t)(job->target >> 32);
+
+    // Header layout matches miner_run_search
+    uint32_t header[20];
+    memset(header, 0, sizeof(header));
+    memcpy(&header[0], job->prevHash, 32);
+    memcpy(&header[8], job->merkleRoot, 32);
+    header[16] = job->nTime;
+    header[17] = job->nBits;
+
+    int numThreads = 1;
+    if (count >= VERIFY_THREAD_MIN) {
+        numThreads = (int)std::thread::hardware_concurrency();
+        if (numThreads > VERIFY_MAX_THREADS) numThreads = VERIFY_MAX_THREADS;
+        if (numThreads > count) numThreads = count;
+        if (numThreads < 1) numThreads = 1;
+    }
+
+    if (numThreads == 1) {
+        int valid = 0;
+        verify_range(header, results, 0, count, N, targetHigh, &valid);
+        return valid;
+    }
+
+    std::thread workers[VERIFY_MAX_THREADS];
+    int validCounts[VERIFY_MAX_THREADS];
+    int perThread = (count + numThreads - 1) / numThreads;
+
+    for (int t = 0; t < numThreads; t++) {
+        int start = t * perThread;
+        int end = (start + perThread < count) ? start + perThread : count;
+        workers[t] = std::thread(verify_range, header, results, start, end,
+                                 N, targetHigh, &validCounts[t]);
+    }
+
+    int valid = 0;
+    for (int t = 0; t < numThreads; t++) {
+        workers[t].join();
+        if (validCounts[t] < 0) valid = -1;
+        if (valid >= 0) valid += validCounts[t];
+    }
+
+    return valid;
+}
+
+// ==================== Result scoreboard ====================
+
+extern "C" bool hash_meets_target256(const uint8_t hash[32], const uint8_t target[32])
+{
+#ifdef VERIFY_SSE2
+    // Equality-scan 16 bytes at a time from the significant end; the
+    // highest differing byte decides the little-endian comparison
+    for (int lane = 1; lane >= 0; lane--) {
+        __m128i h = _mm_loadu_si128((const __m128i*)(hash + lane * 16));
+        __m128i t = _mm_loadu_si128((const __m128i*)(target + lane * 16));
+        int eq = _mm_movemask_epi8(_mm_cmpeq_epi8(h, t));
+        if (eq != 0xFFFF) {
+            for (int i = lane * 16 + 15; i >= lane * 16; i--) {
+                if (hash[i] != target[i]) return hash[i] < target[i];
+            }
+        }
+    }
+    return true;
+#else
+    for (int i = 31; i >= 0; i--) {
+        if (hash[i] != target[i]) return hash[i] < target[i];
+    }
+    return true;
+#endif
+}
+
+extern "C" void scoreboard_reset(ResultScoreboard *sb)
+{
+    if (sb) sb->count = 0;
+}
+
+extern "C" int scoreboard_push(ResultScoreboard *sb, const MiningResult *result)
+{
+    if (!sb || !result || sb->count >= SCOREBOARD_SIZE) return -1;
+    sb->results[sb->count++] = *result;
+    return 0;
+}
+
+static bool hash_is_zero(const uint8_t hash[32])
+{
+    for (int i = 0; i < 32; i++) {
+        if (hash[i]) return false;
+    }
+    return true;
+}
+
+extern "C" int scoreboard_flush(ResultScoreboard *sb, const MiningJob *job)
+{
+    if (!sb || !job) return -1;
+    if (sb->count == 0) return 0;
+
+    // Pass 1: cheap batched compare against the precomputed 256-bit
+    // target. The GPU only enforced the coarse 64-bit target, so this
+    // drops most false candidates without touching scrypt
+    int candidates = 0;
+    for (int i = 0; i < sb->count; i++) {
+        MiningResult *r = &sb->results[i];
+        if (!r->found) continue;
+        if (strncmp(r->jobId, job->jobId, sizeof(r->jobId)) != 0) {
+            r->found = false;  // stale, batch straddled a job switch
+            continue;
+        }
+        if (!hash_is_zero(r->hash) && !hash_meets_target256(r->hash, job->target256)) {
+            r->found = false;
+            continue;
+        }
+        candidates++;
+    }
+    if (candidates == 0) return 0;
+
+    // Pass 2: full re-hash, survivors only. AdaptivePow jobs carry no
+    // N-factor and have no CPU re-hash path; the GPU's check stands
+    if (job->nFactor == 0) return candidates;
+    return verify_solutions(job, sb->results, sb->count, job->nFactor);
+}
@@ -9,6 +9,10 @@
 
 #include <cuda_runtime.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../core/autotune.h"
 
 // Algorithm parameters
 #define DAG_BASE_SIZE      (1ULL << 30)  // 1 GB
@@ -223,9 +227,10 @@ __global__ void generate_dag_kernel(
     const uint32_t* __restrict__ cache,
     uint32_t cache_size,
     uint32_t* dag,
-    uint32_t dag_items
+    uint32_t dag_items,
+    uint32_t item_offset
 ) {
-    uint32_t idx = blockIdx.x * blockDim.x + threadIdx.x;
+    uint32_t idx = item_offset + blockIdx.x * blockDim.x + threadIdx.x;
     if (idx >= dag_items) return;
 
     uint32_t mix[16];
@@ -277,8 +282,21 @@ typedef struct {
     uint32_t epoch;
     uint32_t threads_per_block;
     uint32_t grid_size;
+
+    // Background build of the next epoch's DAG into a second buffer, a
+    // slice at a time on a low-priority stream so mining keeps running
+    uint32_t* d_next_dag;
+    uint32_t* d_next_cache;
+    uint64_t next_dag_size;
+    uint32_t next_epoch;
+    uint32_t next_progress;    // DAG items generated so far
+    cudaStream_t next_stream;
 } AdaptivePowContext;
 
+// DAG items generated per background slice. Small enough that a slice
+// finishes well inside one search batch.
+#define DAG_SLICE_ITEMS (256 * 1024)
+
 // Initialize miner
 int adaptivepow_init(AdaptivePowContext* ctx, int device_id, uint32_t epoch) {
     cudaError_t err;
@@ -288,6 +306,9 @@ int adaptivepow_init(AdaptivePowContext* ctx, int device_id, uint32_t epoch) {
     ctx->dag_size = get_dag_size(epoch);
     ctx->threads_per_block = 256;
     ctx->grid_size = 8192;
+    ctx->d_next_dag = nullptr;
+    ctx->d_next_cache = nullptr;
+    ctx->next_progress = 0;
 
     err = cudaSetDevice(device_id);
     if (err != cudaSuccess) return -1;
@@ -335,7 +356,8 @@ int adaptivepow_generate_dag(AdaptivePowContext* ctx, const uint32_t* seed) {
         ctx->d_cache,
         cache_size / HASH_BYTES,
         ctx->d_dag,
-        dag_items
+        dag_items,
+        0
     );
 
     err = cudaDeviceSynchronize();
@@ -404,14 +426,226 @@ int adaptivepow_search(
     return 0;  // Not found
 }
 
+// Start building the DAG for the given epoch into a second buffer. The
+// actual generation happens a slice at a time via adaptivepow_dag_slice,
+// on a low-priority stream so search kernels keep the device busy.
+int adaptivepow_prepare_epoch(AdaptivePowContext* ctx, uint32_t epoch) {
+    if (ctx->d_next_dag) return 0;  // Already preparing
+
+    cudaError_t err;
+    ctx->next_epoch = epoch;
+    ctx->next_dag_size = get_dag_size(epoch);
+    ctx->next_progress = 0;
+
+    err = cudaMalloc(&ctx->d_next_dag, ctx->next_dag_size);
+    if (err != cudaSuccess) {
+        printf("Failed to allocate next-epoch DAG: %s (need %.2f GB)\n",
+               cudaGetErrorString(err), ctx->next_dag_size / 1e9);
+        ctx->d_next_dag = nullptr;
+        return -1;
+    }
+
+    uint64_t cache_size = ctx->next_dag_size / 64;
+    err = cudaMalloc(&ctx->d_next_cache, cache_size);
+    if (err != cudaSuccess) {
+        cudaFree(ctx->d_next_dag);
+        ctx->d_next_dag = nullptr;
+        return -2;
+    }
+
+    // TODO: Generate cache from seed
+
+    int least_priority, greatest_priority;
+    cudaDeviceGetStreamPriorityRange(&least_priority, &greatest_priority);
+    err = cudaStreamCreateWithPriority(&ctx->next_stream, cudaStreamNonBlocking,
+                                       least_priority);
+    if (err != cudaSuccess) {
+        cudaFree(ctx->d_next_dag);
+        cudaFree(ctx->d_next_cache);
+        ctx->d_next_dag = nullptr;
+        ctx->d_next_cache = nullptr;
+        return -3;
+    }
+
+    printf("Preparing epoch %u DAG in background (%.2f GB)\n",
+           epoch, ctx->next_dag_size / 1e9);
+    return 0;
+}
+
+// Generate one slice of the next epoch's DAG. Non-blocking: if the
+// previous slice is still running, does nothing. Returns 1 once the DAG
+// is complete, 0 while in progress, negative if none is being prepared.
+int adaptivepow_dag_slice(AdaptivePowContext* ctx) {
+    if (!ctx->d_next_dag) return -1;
+
+    uint32_t dag_items = ctx->next_dag_size / HASH_BYTES;
+
+    // Let the queued slice finish before judging progress or queuing more
+    if (cudaStreamQuery(ctx->next_stream) == cudaErrorNotReady) return 0;
+
+    if (ctx->next_progress >= dag_items) return 1;
+
+    uint32_t remaining = dag_items - ctx->next_progress;
+    uint32_t this_items = (remaining < DAG_SLICE_ITEMS) ? remaining : DAG_SLICE_ITEMS;
+    int threads = 256;
+    int blocks = (this_items + threads - 1) / threads;
+    uint64_t cache_size = ctx->next_dag_size / 64;
+
+    generate_dag_kernel<<<blocks, threads, 0, ctx->next_stream>>>(
+        ctx->d_next_cache,
+        cache_size / HASH_BYTES,
+        ctx->d_next_dag,
+        dag_items,
+        ctx->next_progress
+    );
+
+    ctx->next_progress += this_items;
+    return 0;
+}
+
+// Swap the finished next-epoch DAG in for the active one. Only valid
+// after adaptivepow_dag_slice has returned 1.
+int adaptivepow_switch_epoch(AdaptivePowContext* ctx) {
+    if (!ctx->d_next_dag) return -1;
+
+    uint32_t dag_items = ctx->next_dag_size / HASH_BYTES;
+    if (ctx->next_progress < dag_items) return -2;
+    cudaStreamSynchronize(ctx->next_stream);
+
+    cudaFree(ctx->d_dag);
+    ctx->d_dag = ctx->d_next_dag;
+    ctx->dag_size = ctx->next_dag_size;
+    ctx->epoch = ctx->next_epoch;
+
+    cudaFree(ctx->d_next_cache);
+    cudaStreamDestroy(ctx->next_stream);
+    ctx->d_next_dag = nullptr;
+    ctx->d_next_cache = nullptr;
+    ctx->next_progress = 0;
+
+    printf("Switched to epoch %u DAG without stopping\n", ctx->epoch);
+    return 0;
+}
+
+// Time the current launch configuration: one warm-up batch, then timed
+// batches. Returns hashes per second, or 0 on failure.
+static double adaptivepow_benchmark(AdaptivePowContext* ctx) {
+    const int timed_batches = 2;
+    uint32_t header[20];
+    uint64_t found_nonce;
+    uint32_t hash_count;
+    cudaEvent_t start, stop;
+    float ms = 0;
+
+    memset(header, 0, sizeof(header));
+
+    if (adaptivepow_search(ctx, header, 0, 0, &found_nonce, &hash_count) < 0) return 0;
+
+    cudaEventCreate(&start);
+    cudaEventCreate(&stop);
+    cudaEventRecord(start);
+    uint64_t total_hashes = 0;
+    for (int i = 0; i < timed_batches; i++) {
+        if (adaptivepow_search(ctx, header, 0, 0, &found_nonce, &hash_count) < 0) {
+            cudaEventDestroy(start);
+            cudaEventDestroy(stop);
+            return 0;
+        }
+        total_hashes += hash_count;
+    }
+    cudaEventRecord(stop);
+    cudaEventSynchronize(stop);
+    cudaEventElapsedTime(&ms, start, stop);
+    cudaEventDestroy(start);
+    cudaEventDestroy(stop);
+
+    if (ms <= 0) return 0;
+    return (double)total_hashes / (ms / 1000.0);
+}
+
+// Pick the best (threads_per_block, grid_size) for this device and epoch.
+// A stored profile skips the sweep; otherwise every candidate is timed and
+// the winner persisted. Call after the DAG is generated.
+int adaptivepow_autotune(AdaptivePowContext* ctx, const char* profile_path) {
+    static const uint32_t block_sizes[] = { 128, 256, 512 };
+    static const uint32_t grid_sizes[] = { 4096, 8192, 16384 };
+
+    cudaDeviceProp prop;
+    if (cudaGetDeviceProperties(&prop, ctx->device_id) != cudaSuccess) return -1;
+
+    TuneProfile profile;
+    if (profile_path &&
+        tune_profile_load(profile_path, prop.name, ctx->epoch, &profile) == 1) {
+        printf("Autotune: using stored profile for %s epoch %u: "
+               "block=%u grid=%u (%.2f MH/s)\n",
+               prop.name, ctx->epoch, profile.blockSize,
+               profile.batchSize / profile.blockSize, profile.hashrate / 1e6);
+        ctx->threads_per_block = profile.blockSize;
+        ctx->grid_size = profile.batchSize / profile.blockSize;
+        return 0;
+    }
+
+    printf("Autotune: sweeping configurations for %s, epoch %u...\n",
+           prop.name, ctx->epoch);
+
+    uint32_t best_block = ctx->threads_per_block;
+    uint32_t best_grid = ctx->grid_size;
+    double best_rate = 0;
+
+    for (unsigned b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); b++) {
+        for (unsigned g = 0; g < sizeof(grid_sizes) / sizeof(grid_sizes[0]); g++) {
+            ctx->threads_per_block = block_sizes[b];
+            ctx->grid_size = grid_sizes[g];
+
+            double rate = adaptivepow_benchmark(ctx);
+            printf("  block=%u grid=%u: %.2f MH/s\n",
+                   block_sizes[b], grid_sizes[g], rate / 1e6);
+
+            if (rate > best_rate) {
+                best_rate = rate;
+                best_block = block_sizes[b];
+                best_grid = grid_sizes[g];
+            }
+        }
+    }
+
+    ctx->threads_per_block = best_block;
+    ctx->grid_size = best_grid;
+
+    if (best_rate == 0) return -2;
+
+    printf("Autotune: best is block=%u grid=%u (%.2f MH/s)\n",
+           best_block, best_grid, best_rate / 1e6);
+
+    if (profile_path) {
+        memset(&profile, 0, sizeof(profile));
+        strncpy(profile.deviceName, prop.name, sizeof(profile.deviceName) - 1);
+        profile.nParam = ctx->epoch;
+        profile.blockSize = best_block;
+        profile.batchSize = best_block * best_grid;
+        profile.lookupGap = 1;
+        profile.hashrate = best_rate;
+        tune_profile_save(profile_path, &profile);
+    }
+
+    return 0;
+}
+
 // Cleanup
 void adaptivepow_cleanup(AdaptivePowContext* ctx) {
     if (ctx->d_dag) cudaFree(ctx->d_dag);
     if (ctx->d_results) cudaFree(ctx->d_results);
     if (ctx->d_result_count) cudaFree(ctx->d_result_count);
+    if (ctx->d_next_dag) {
+        cudaFree(ctx->d_next_dag);
+        cudaFree(ctx->d_next_cache);
+        cudaStreamDestroy(ctx->next_stream);
+    }
     ctx->d_dag = nullptr;
     ctx->d_results = nullptr;
     ctx->d_result_count = nullptr;
+    ctx->d_next_dag = nullptr;
+    ctx->d_next_cache = nullptr;
 }
 
 } // extern "C"
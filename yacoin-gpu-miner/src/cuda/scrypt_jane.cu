@@ -8,6 +8,9 @@
 #include <cuda_runtime.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+
+#include "../core/autotune.h"
 
 // Scrypt-Jane parameters for YaCoin
 #define SCRYPT_BLOCK_SIZE 64
@@ -88,19 +91,26 @@ __device__ __forceinline__ void scrypt_block_mix(
 // ROMix - the core memory-hard function
 __device__ void scrypt_romix(
     uint32_t *X,      // Input/output chunk
-    uint32_t *V,      // Scratch memory (N chunks)
+    uint32_t *V,      // Scratch memory (N / lookupGap chunks)
     uint32_t N,       // Number of iterations (2^(Nfactor+1))
-    uint32_t r        // Block size parameter
+    uint32_t r,       // Block size parameter
+    uint32_t lookupGap // Store every lookupGap-th chunk (1 = store all)
 )
 {
     uint32_t chunkWords = SCRYPT_BLOCK_WORDS * r * 2;
     uint32_t Y[SCRYPT_BLOCK_WORDS * 2]; // Temporary buffer for r=1
+    uint32_t W[SCRYPT_BLOCK_WORDS * 2]; // Recompute buffer for lookupGap > 1
 
-    // Step 1: Sequential writes to V
+    // Step 1: Sequential writes to V, keeping every lookupGap-th chunk.
+    // A gap > 1 shrinks the scratchpad at the cost of recomputation in
+    // step 2 - on cards where the sweep finds bandwidth, not ALUs, to be
+    // the bottleneck, that trade wins.
     for (uint32_t i = 0; i < N; i++) {
-        // V[i] = X
-        for (uint32_t j = 0; j < chunkWords; j++) {
-            V[i * chunkWords + j] = X[j];
+        if (i % lookupGap == 0) {
+            // V[i / lookupGap] = X
+            for (uint32_t j = 0; j < chunkWords; j++) {
+                V[(i / lookupGap) * chunkWords + j] = X[j];
+            }
         }
         // X = BlockMix(X)
         scrypt_block_mix(X, Y, r);
@@ -115,9 +125,21 @@ __device__ void scrypt_romix(
         // j = Integerify(X) mod N
         uint32_t j = X[chunkWords - SCRYPT_BLOCK_WORDS] & (N - 1);
 
-        // X = X ^ V[j]
+        // W = V[j], recomputed forward from the nearest stored chunk
+        uint32_t extra = j % lookupGap;
         for (uint32_t k = 0; k < chunkWords; k++) {
-            X[k] ^= V[j * chunkWords + k];
+            W[k] = V[(j / lookupGap) * chunkWords + k];
+        }
+        for (uint32_t t = 0; t < extra; t++) {
+            scrypt_block_mix(W, Y, r);
+            for (uint32_t k = 0; k < chunkWords; k++) {
+                W[k] = Y[k];
+            }
+        }
+
+        // X = X ^ W
+        for (uint32_t k = 0; k < chunkWords; k++) {
+            X[k] ^= W[k];
         }
 
         // X = BlockMix(X)
@@ -145,7 +167,8 @@ __global__ void scrypt_jane_kernel(
     uint32_t r,                 // Always 1 for YaCoin
     uint32_t startNonce,        // Starting nonce
     uint32_t *foundNonce,       // Output: found nonce
-    uint32_t *targetHigh        // Target difficulty (high 32 bits)
+    uint32_t *targetHigh,       // Target difficulty (high 32 bits)
+    uint32_t lookupGap          // Scratchpad lookup gap
 )
 {
     uint32_t thread = blockIdx.x * blockDim.x + threadIdx.x;
@@ -153,7 +176,7 @@ __global__ void scrypt_jane_kernel(
 
     // Calculate per-thread scratch memory offset
     uint32_t chunkWords = SCRYPT_BLOCK_WORDS * r * 2;
-    uint32_t *myV = V + thread * N * chunkWords;
+    uint32_t *myV = V + thread * (N / lookupGap) * chunkWords;
 
     // Prepare input with nonce
     uint32_t header[20];
@@ -172,7 +195,7 @@ __global__ void scrypt_jane_kernel(
     }
 
     // Step 2: ROMix(X)
-    scrypt_romix(X, myV, N, r);
+    scrypt_romix(X, myV, N, r, lookupGap);
 
     // Step 3: PBKDF2(password=header, salt=X) -> hash
     uint32_t hash[8];
@@ -195,15 +218,25 @@ __global__ void scrypt_jane_kernel(
 // Host function to launch mining
 extern "C" {
 
+// Two streams double-buffer the batch: each takes half the threads and its
+// own half of the scratch memory, so while one half computes the other
+// half's header upload and result download are in flight.
+#define MINER_NUM_STREAMS 2
+
 typedef struct {
     int deviceId;
-    uint32_t *d_input;
+    uint32_t *d_input[MINER_NUM_STREAMS];
     uint32_t *d_output;
     uint32_t *d_V;
-    uint32_t *d_foundNonce;
-    uint32_t *d_target;
+    uint32_t *d_foundNonce[MINER_NUM_STREAMS];
+    uint32_t *d_target[MINER_NUM_STREAMS];
+    uint32_t *h_input;        // Pinned staging for async header uploads
+    uint32_t *h_foundNonce;   // Pinned result buffer, one entry per stream
+    cudaStream_t streams[MINER_NUM_STREAMS];
     uint32_t N;
     uint32_t threads;
+    uint32_t blockSize;
+    uint32_t lookupGap;
     size_t scratchSize;
 } MinerContext;
 
@@ -214,34 +247,52 @@ int miner_init(MinerContext *ctx, int deviceId, uint32_t Nfactor, uint32_t threa
     ctx->deviceId = deviceId;
     ctx->threads = threads;
     ctx->N = 1 << (Nfactor + 1);
+    ctx->blockSize = 256;
+    ctx->lookupGap = 1;
 
     err = cudaSetDevice(deviceId);
     if (err != cudaSuccess) return -1;
 
-    // Allocate input buffer (80 bytes header)
-    err = cudaMalloc(&ctx->d_input, 80);
-    if (err != cudaSuccess) return -2;
+    // Per-stream input buffers (80 bytes header each)
+    for (int s = 0; s < MINER_NUM_STREAMS; s++) {
+        err = cudaMalloc(&ctx->d_input[s], 80);
+        if (err != cudaSuccess) return -2;
+    }
 
     // Allocate output buffer (32 bytes per thread)
     err = cudaMalloc(&ctx->d_output, threads * 32);
     if (err != cudaSuccess) return -3;
 
     // Allocate scratch memory
-    // Each thread needs N * 128 bytes (for r=1)
-    ctx->scratchSize = (size_t)threads * ctx->N * 128;
+    // Each thread needs (N / lookupGap) * 128 bytes (for r=1); each stream
+    // works on its own half of the threads, and therefore its own half of
+    // the scratch
+    ctx->scratchSize = (size_t)threads * (ctx->N / ctx->lookupGap) * 128;
     err = cudaMalloc(&ctx->d_V, ctx->scratchSize);
     if (err != cudaSuccess) return -4;
 
-    // Allocate found nonce
-    err = cudaMalloc(&ctx->d_foundNonce, sizeof(uint32_t));
-    if (err != cudaSuccess) return -5;
+    // Per-stream found nonce and target
+    for (int s = 0; s < MINER_NUM_STREAMS; s++) {
+        err = cudaMalloc(&ctx->d_foundNonce[s], sizeof(uint32_t));
+        if (err != cudaSuccess) return -5;
+        err = cudaMalloc(&ctx->d_target[s], sizeof(uint32_t));
+        if (err != cudaSuccess) return -6;
+    }
 
-    // Allocate target
-    err = cudaMalloc(&ctx->d_target, sizeof(uint32_t));
-    if (err != cudaSuccess) return -6;
+    // Pinned host buffers so the async copies really overlap: pageable
+    // memory would force the driver to stage them synchronously
+    err = cudaHostAlloc(&ctx->h_input, MINER_NUM_STREAMS * 80, cudaHostAllocDefault);
+    if (err != cudaSuccess) return -7;
+    err = cudaHostAlloc(&ctx->h_foundNonce, MINER_NUM_STREAMS * sizeof(uint32_t), cudaHostAllocDefault);
+    if (err != cudaSuccess) return -7;
 
-    printf("Miner initialized: Device %d, N=%u, Threads=%u, Scratch=%.2f MB\n",
-           deviceId, ctx->N, threads, ctx->scratchSize / (1024.0 * 1024.0));
+    for (int s = 0; s < MINER_NUM_STREAMS; s++) {
+        err = cudaStreamCreate(&ctx->streams[s]);
+        if (err != cudaSuccess) return -8;
+    }
+
+    printf("Miner initialized: Device %d, N=%u, Threads=%u, Streams=%d, Scratch=%.2f MB\n",
+           deviceId, ctx->N, threads, MINER_NUM_STREAMS, ctx->scratchSize / (1024.0 * 1024.0));
 
     return 0;
 }
@@ -249,56 +300,220 @@ int miner_init(MinerContext *ctx, int deviceId, uint32_t Nfactor, uint32_t threa
 int miner_hash(MinerContext *ctx, const uint32_t *header, uint32_t startNonce, uint32_t target)
 {
     cudaError_t err;
+    uint32_t blockSize = ctx->blockSize;
+    uint32_t threadsPerStream = ctx->threads / MINER_NUM_STREAMS;
+    int numBlocks = (threadsPerStream + blockSize - 1) / blockSize;
+    uint32_t chunkWords = SCRYPT_BLOCK_WORDS * 2; // r = 1
+
+    // Queue each half-batch on its own stream: upload, reset, kernel and
+    // download are all asynchronous, so stream 1's upload overlaps stream
+    // 0's compute and the host returns without waiting for either.
+    for (int s = 0; s < MINER_NUM_STREAMS; s++) {
+        uint32_t *h_in = ctx->h_input + s * 20;
+        for (int i = 0; i < 20; i++) {
+            h_in[i] = header[i];
+        }
+        ctx->h_foundNonce[s] = 0xFFFFFFFF;
+
+        err = cudaMemcpyAsync(ctx->d_input[s], h_in, 80,
+                              cudaMemcpyHostToDevice, ctx->streams[s]);
+        if (err != cudaSuccess) return -1;
+
+        err = cudaMemcpyAsync(ctx->d_foundNonce[s], &ctx->h_foundNonce[s], sizeof(uint32_t),
+                              cudaMemcpyHostToDevice, ctx->streams[s]);
+        if (err != cudaSuccess) return -2;
+
+        err = cudaMemcpyAsync(ctx->d_target[s], &target, sizeof(uint32_t),
+                              cudaMemcpyHostToDevice, ctx->streams[s]);
+        if (err != cudaSuccess) return -3;
+
+        scrypt_jane_kernel<<<numBlocks, blockSize, 0, ctx->streams[s]>>>(
+            ctx->d_input[s],
+            ctx->d_output + (size_t)s * threadsPerStream * 8,
+            ctx->d_V + (size_t)s * threadsPerStream * (ctx->N / ctx->lookupGap) * chunkWords,
+            ctx->N,
+            1,  // r = 1
+            startNonce + s * threadsPerStream,
+            ctx->d_foundNonce[s],
+            ctx->d_target[s],
+            ctx->lookupGap
+        );
+
+        err = cudaMemcpyAsync(&ctx->h_foundNonce[s], ctx->d_foundNonce[s], sizeof(uint32_t),
+                              cudaMemcpyDeviceToHost, ctx->streams[s]);
+        if (err != cudaSuccess) return -4;
+    }
 
-    // Copy header to device
-    err = cudaMemcpy(ctx->d_input, header, 80, cudaMemcpyHostToDevice);
-    if (err != cudaSuccess) return -1;
-
-    // Reset found nonce
-    uint32_t maxNonce = 0xFFFFFFFF;
-    err = cudaMemcpy(ctx->d_foundNonce, &maxNonce, sizeof(uint32_t), cudaMemcpyHostToDevice);
-    if (err != cudaSuccess) return -2;
-
-    // Copy target
-    err = cudaMemcpy(ctx->d_target, &target, sizeof(uint32_t), cudaMemcpyHostToDevice);
-    if (err != cudaSuccess) return -3;
+    return 0;
+}
 
-    // Launch kernel
-    int blockSize = 256;
-    int numBlocks = (ctx->threads + blockSize - 1) / blockSize;
-
-    scrypt_jane_kernel<<<numBlocks, blockSize>>>(
-        ctx->d_input,
-        ctx->d_output,
-        ctx->d_V,
-        ctx->N,
-        1,  // r = 1
-        startNonce,
-        ctx->d_foundNonce,
-        ctx->d_target
-    );
-
-    err = cudaDeviceSynchronize();
-    if (err != cudaSuccess) return -4;
+int miner_get_result(MinerContext *ctx, uint32_t *foundNonce)
+{
+    cudaError_t err;
+    uint32_t best = 0xFFFFFFFF;
+
+    // Drain both streams; the result copies already landed in the pinned
+    // buffer by the time each stream runs dry
+    for (int s = 0; s < MINER_NUM_STREAMS; s++) {
+        err = cudaStreamSynchronize(ctx->streams[s]);
+        if (err != cudaSuccess) return -1;
+        if (ctx->h_foundNonce[s] < best) {
+            best = ctx->h_foundNonce[s];
+        }
+    }
 
+    *foundNonce = best;
     return 0;
 }
 
-int miner_get_result(MinerContext *ctx, uint32_t *foundNonce)
+// Switch to a new launch configuration, reallocating the batch-sized
+// buffers. Returns 0 on success; on allocation failure the context is
+// unusable until the next successful call.
+static int miner_apply_config(MinerContext *ctx, uint32_t blockSize,
+                              uint32_t batchSize, uint32_t lookupGap)
 {
     cudaError_t err;
-    err = cudaMemcpy(foundNonce, ctx->d_foundNonce, sizeof(uint32_t), cudaMemcpyDeviceToHost);
+
+    cudaFree(ctx->d_output);
+    cudaFree(ctx->d_V);
+    ctx->d_output = NULL;
+    ctx->d_V = NULL;
+
+    ctx->blockSize = blockSize;
+    ctx->threads = batchSize;
+    ctx->lookupGap = lookupGap;
+
+    err = cudaMalloc(&ctx->d_output, (size_t)batchSize * 32);
     if (err != cudaSuccess) return -1;
+
+    ctx->scratchSize = (size_t)batchSize * (ctx->N / lookupGap) * 128;
+    err = cudaMalloc(&ctx->d_V, ctx->scratchSize);
+    if (err != cudaSuccess) return -2;
+
     return 0;
 }
 
+// Time one configuration: a warm-up batch, then timed batches over the
+// whole pipeline. Returns hashes per second, or 0 on failure.
+static double miner_benchmark_config(MinerContext *ctx)
+{
+    const int timedBatches = 2;
+    uint32_t header[20];
+    uint32_t foundNonce;
+    cudaEvent_t start, stop;
+    float ms = 0;
+
+    memset(header, 0, sizeof(header));
+
+    if (miner_hash(ctx, header, 0, 0) != 0) return 0;
+    if (miner_get_result(ctx, &foundNonce) != 0) return 0;
+
+    cudaEventCreate(&start);
+    cudaEventCreate(&stop);
+    cudaEventRecord(start);
+    for (int i = 0; i < timedBatches; i++) {
+        if (miner_hash(ctx, header, 0, 0) != 0 ||
+            miner_get_result(ctx, &foundNonce) != 0) {
+            cudaEventDestroy(start);
+            cudaEventDestroy(stop);
+            return 0;
+        }
+    }
+    cudaEventRecord(stop);
+    cudaEventSynchronize(stop);
+    cudaEventElapsedTime(&ms, start, stop);
+    cudaEventDestroy(start);
+    cudaEventDestroy(stop);
+
+    if (ms <= 0) return 0;
+    return (double)timedBatches * ctx->threads / (ms / 1000.0);
+}
+
+// Pick the best (blockSize, batchSize, lookupGap) for this device and
+// Nfactor. A stored profile short-circuits the sweep; otherwise every
+// candidate is timed and the winner persisted for the next start.
+int miner_autotune(MinerContext *ctx, uint32_t Nfactor, const char *profilePath)
+{
+    static const uint32_t blockSizes[] = { 128, 256, 512 };
+    static const uint32_t gaps[] = { 1, 2, 4 };
+    static const uint32_t batchMults[] = { 1, 2 };
+
+    cudaDeviceProp prop;
+    if (cudaGetDeviceProperties(&prop, ctx->deviceId) != cudaSuccess) return -1;
+
+    TuneProfile profile;
+    if (profilePath &&
+        tune_profile_load(profilePath, prop.name, Nfactor, &profile) == 1) {
+        printf("Autotune: using stored profile for %s N-factor %u: "
+               "block=%u batch=%u gap=%u (%.2f MH/s)\n",
+               prop.name, Nfactor, profile.blockSize, profile.batchSize,
+               profile.lookupGap, profile.hashrate / 1e6);
+        return miner_apply_config(ctx, profile.blockSize, profile.batchSize,
+                                  profile.lookupGap);
+    }
+
+    printf("Autotune: sweeping configurations for %s, N-factor %u...\n",
+           prop.name, Nfactor);
+
+    uint32_t baseBatch = ctx->threads;
+    uint32_t bestBlock = ctx->blockSize;
+    uint32_t bestBatch = ctx->threads;
+    uint32_t bestGap = ctx->lookupGap;
+    double bestRate = 0;
+
+    for (unsigned g = 0; g < sizeof(gaps) / sizeof(gaps[0]); g++) {
+        for (unsigned b = 0; b < sizeof(blockSizes) / sizeof(blockSizes[0]); b++) {
+            for (unsigned m = 0; m < sizeof(batchMults) / sizeof(batchMults[0]); m++) {
+                uint32_t batch = baseBatch * batchMults[m];
+                if (miner_apply_config(ctx, blockSizes[b], batch, gaps[g]) != 0) {
+                    continue;  // Out of memory at this batch size
+                }
+
+                double rate = miner_benchmark_config(ctx);
+                printf("  block=%u batch=%u gap=%u: %.2f MH/s\n",
+                       blockSizes[b], batch, gaps[g], rate / 1e6);
+
+                if (rate > bestRate) {
+                    bestRate = rate;
+                    bestBlock = blockSizes[b];
+                    bestBatch = batch;
+                    bestGap = gaps[g];
+                }
+            }
+        }
+    }
+
+    if (bestRate == 0) return -2;
+
+    printf("Autotune: best is block=%u batch=%u gap=%u (%.2f MH/s)\n",
+           bestBlock, bestBatch, bestGap, bestRate / 1e6);
+
+    if (profilePath) {
+        memset(&profile, 0, sizeof(profile));
+        strncpy(profile.deviceName, prop.name, sizeof(profile.deviceName) - 1);
+        profile.nParam = Nfactor;
+        profile.blockSize = bestBlock;
+        profile.batchSize = bestBatch;
+        profile.lookupGap = bestGap;
+        profile.hashrate = bestRate;
+        tune_profile_save(profilePath, &profile);
+    }
+
+    return miner_apply_config(ctx, bestBlock, bestBatch, bestGap);
+}
+
 void miner_cleanup(MinerContext *ctx)
 {
-    cudaFree(ctx->d_input);
+    for (int s = 0; s < MINER_NUM_STREAMS; s++) {
+        cudaStreamDestroy(ctx->streams[s]);
+        cudaFree(ctx->d_input[s]);
+        cudaFree(ctx->d_foundNonce[s]);
+        cudaFree(ctx->d_target[s]);
+    }
     cudaFree(ctx->d_output);
     cudaFree(ctx->d_V);
-    cudaFree(ctx->d_foundNonce);
-    cudaFree(ctx->d_target);
+    cudaFreeHost(ctx->h_input);
+    cudaFreeHost(ctx->h_foundNonce);
 }
 
 } // extern "C"
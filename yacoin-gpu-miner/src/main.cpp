@@ -23,6 +23,8 @@
 
 #include "core/miner.h"
 #include "core/stratum.h"
+#include "core/telemetry.h"
+#include "core/cluster.h"
 
 // Version
 #define SCRYPT_MINER_VERSION "1.0.0"
@@ -30,10 +32,15 @@
 // Genesis time for Scrypt Coin (Feb 7, 2026 00:00:00 UTC)
 #define SCRYPT_GENESIS_TIME 1738886400ULL
 
+// Start building the next epoch's DAG this far ahead of the boundary
+#define DAG_PREPARE_LEAD (60 * 60)
+
 // Global state
 static volatile bool g_running = true;
 static MinerContext* g_miner = NULL;
+static WorkScheduler* g_scheduler = NULL;
 static StratumClient g_stratum;
+static ClusterCoordinator g_cluster;
 
 // Configuration
 typedef struct {
@@ -41,6 +48,12 @@ typedef struct {
     char user[256];
     char pass[256];
     char address[128];     // Payout address for solo mining
+    char tuneFile[256];    // Autotune profile file
+    int  statsPort;        // Telemetry HTTP port (0 = disabled)
+    int  clusterPort;      // Coordinator listen port (0 = disabled)
+    char workerHost[256];  // Coordinator to mine for (empty = standalone)
+    int  workerPort;
+    char rigName[64];      // This rig's name in cluster mode
     int  deviceId;
     int  intensity;
     bool benchmark;
@@ -48,6 +61,18 @@ typedef struct {
     bool listDevices;
 } Config;
 
+// Monotonic wall clock in milliseconds, for batch timing
+static double now_ms(void)
+{
+#ifdef _WIN32
+    return (double)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+#endif
+}
+
 // Signal handler
 void signal_handler(int sig)
 {
@@ -68,6 +93,11 @@ void print_usage(const char *program)
     printf("  -d, --device <id>     GPU device ID (default: 0)\n");
     printf("  -i, --intensity <n>   Mining intensity (8-25, default: auto)\n");
     printf("  --address <addr>      Payout address for solo mining\n");
+    printf("  --tune-file <path>    Autotune profile file (default: scrypt-miner-tune.conf)\n");
+    printf("  --stats-port <n>      Serve JSON telemetry on this HTTP port (default: off)\n");
+    printf("  --coordinator <port>  Distribute work to worker rigs on this port\n");
+    printf("  --worker <host[:port]> Mine for a coordinator instead of a pool\n");
+    printf("  --rig-name <name>     Name reported to the coordinator (default: hostname)\n");
     printf("  --solo                Solo mining mode (direct to node)\n");
     printf("  --benchmark           Run hashrate benchmark\n");
     printf("  --list-devices        List available GPUs\n");
@@ -79,6 +109,9 @@ void print_usage(const char *program)
     printf("    %s -o stratum+tcp://pool.scrypt.org:3333 -u SYourAddress -p x\n", program);
     printf("  Benchmark:\n");
     printf("    %s --benchmark\n", program);
+    printf("  Fleet (one pool connection, 40 rigs):\n");
+    printf("    coordinator: %s -o stratum+tcp://pool:3333 -u SAddr --coordinator %d\n", program, CLUSTER_DEFAULT_PORT);
+    printf("    each rig:    %s --worker coordinator-host --rig-name rig01\n", program);
 }
 
 // Parse command line arguments
@@ -86,8 +119,10 @@ int parse_args(int argc, char **argv, Config *config)
 {
     memset(config, 0, sizeof(Config));
     strcpy(config->pass, "x");
+    strcpy(config->tuneFile, "scrypt-miner-tune.conf");
     config->deviceId = 0;
     config->intensity = 0;  // Auto
+    config->workerPort = CLUSTER_DEFAULT_PORT;
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--url") == 0) {
@@ -114,6 +149,31 @@ int parse_args(int argc, char **argv, Config *config)
             if (++i >= argc) return -1;
             strncpy(config->address, argv[i], sizeof(config->address) - 1);
         }
+        else if (strcmp(argv[i], "--tune-file") == 0) {
+            if (++i >= argc) return -1;
+            strncpy(config->tuneFile, argv[i], sizeof(config->tuneFile) - 1);
+        }
+        else if (strcmp(argv[i], "--stats-port") == 0) {
+            if (++i >= argc) return -1;
+            config->statsPort = atoi(argv[i]);
+        }
+        else if (strcmp(argv[i], "--coordinator") == 0) {
+            if (++i >= argc) return -1;
+            config->clusterPort = atoi(argv[i]);
+        }
+        else if (strcmp(argv[i], "--worker") == 0) {
+            if (++i >= argc) return -1;
+            strncpy(config->workerHost, argv[i], sizeof(config->workerHost) - 1);
+            char *colon = strchr(config->workerHost, ':');
+            if (colon) {
+                *colon = '\0';
+                config->workerPort = atoi(colon + 1);
+            }
+        }
+        else if (strcmp(argv[i], "--rig-name") == 0) {
+            if (++i >= argc) return -1;
+            strncpy(config->rigName, argv[i], sizeof(config->rigName) - 1);
+        }
         else if (strcmp(argv[i], "--solo") == 0) {
             config->solo = true;
         }
@@ -252,6 +312,11 @@ int run_benchmark(Config *config)
     time_t dagEnd = time(NULL);
     printf("DAG generated in %ld seconds\n\n", (long)(dagEnd - dagStart));
 
+    // Pick the measured-best launch configuration for this device and epoch
+    if (miner_autotune(g_miner, config->tuneFile) != 0) {
+        fprintf(stderr, "Warning: autotune failed, using default launch config\n");
+    }
+
     // Create test job
     MiningJob job = {0};
     strcpy(job.jobId, "benchmark");
@@ -382,6 +447,11 @@ int mining_loop(Config *config)
     }
     printf("DAG ready!\n\n");
 
+    // Pick the measured-best launch configuration for this device and epoch
+    if (miner_autotune(g_miner, config->tuneFile) != 0) {
+        fprintf(stderr, "Warning: autotune failed, using default launch config\n");
+    }
+
     // Wait for first job
     printf("Waiting for work...\n");
     while (g_running && !g_stratum.hasJob) {
@@ -397,38 +467,141 @@ int mining_loop(Config *config)
 
     printf("Mining started!\n\n");
 
+    // Background submitter: found shares are queued and pipelined to the
+    // pool without the mining loop waiting on a response round-trip
+    stratum_start_submitter(&g_stratum);
+
+    // Fleet monitoring: per-second samples served as JSON
+    if (config->statsPort > 0) {
+        telemetry_http_start(config->statsPort);
+    }
+
+    // Coordinator mode: worker rigs mine this pool connection's jobs on
+    // disjoint nonce slices and send their shares back through us
+    bool coordinating = false;
+    if (config->clusterPort > 0) {
+        coordinating = (cluster_coordinator_start(&g_cluster, config->clusterPort) == 0);
+        if (!coordinating) {
+            fprintf(stderr, "Warning: coordinator disabled, mining standalone\n");
+        }
+    }
+
+    // Shared work scheduler: every device mining this job pulls nonce
+    // chunks from it, so adding contexts for more GPUs needs no range split
+    g_scheduler = scheduler_create();
+    scheduler_new_job(g_scheduler, &g_stratum.currentJob);
+
+    // Per-GPU result scoreboard: candidates are batched here and filtered
+    // against the 256-bit target before the expensive CPU re-hash
+    ResultScoreboard scoreboard;
+    scoreboard_reset(&scoreboard);
+
     // Main mining loop
     time_t lastStatTime = time(NULL);
     uint64_t lastHashes = 0;
     uint32_t currentEpoch = epoch;
+    bool dagPreparing = false;
+    bool nextDagReady = false;
+    time_t lastSampleTime = time(NULL);
+    uint64_t sampleLastHashes = 0;
+    double lastBatchMs = 0;
 
     while (g_running) {
         // Check for new jobs
         stratum_poll(&g_stratum);
 
-        // Submit job to GPU
-        miner_submit_job(g_miner, &g_stratum.currentJob);
+        // Service the fleet: forward worker shares to the pool, rebroadcast
+        // the job when it changed, collect worker stats
+        if (coordinating) {
+            cluster_coordinator_poll(&g_cluster, &g_stratum);
+            cluster_coordinator_update_job(&g_cluster, &g_stratum.currentJob,
+                                           g_stratum.difficulty);
+        }
 
-        // Check for results
+        // Submit job to GPU, pulling the nonce range from the scheduler
+        double batchStart = now_ms();
+        miner_submit_job_scheduled(g_miner, &g_stratum.currentJob, g_scheduler);
+        lastBatchMs = now_ms() - batchStart;
+
+        // Check for results, collecting everything pending on the scoreboard
         MiningResult result;
-        if (miner_get_result(g_miner, &result) > 0 && result.found) {
+        while (miner_get_result(g_miner, &result) > 0 && result.found) {
             printf("\n*** SHARE FOUND! Nonce: %016llx ***\n\n",
                    (unsigned long long)result.nonce);
-            stratum_submit(&g_stratum, &result);
+            if (scoreboard_push(&scoreboard, &result) != 0) {
+                break;  // full; flush below, catch up next iteration
+            }
+        }
+        if (scoreboard.count > 0) {
+            // Batch-filter against the precomputed 256-bit target, then
+            // re-hash only the survivors on the CPU
+            scoreboard_flush(&scoreboard, &g_stratum.currentJob);
+            for (int i = 0; i < scoreboard.count; i++) {
+                if (!scoreboard.results[i].found) {
+                    fprintf(stderr, "Warning: candidate failed verification, not submitted\n");
+                } else if (stratum_submit_async(&g_stratum, &scoreboard.results[i]) != 0) {
+                    fprintf(stderr, "Warning: submit queue full, share dropped\n");
+                }
+            }
+            scoreboard_reset(&scoreboard);
         }
 
-        // Check for epoch change
+        // Build the next epoch's DAG ahead of the boundary so the switch
+        // is instant and the hash rate never drops to zero
         now = (uint64_t)time(NULL);
+        uint32_t upcomingEpoch = adaptivepow_get_epoch(now + DAG_PREPARE_LEAD,
+                                                       SCRYPT_GENESIS_TIME);
+        if (upcomingEpoch != currentEpoch && !dagPreparing) {
+            dagPreparing = (miner_prepare_epoch(g_miner, upcomingEpoch) == 0);
+            // Tell the fleet so every rig starts its background build now
+            // and nobody stalls regenerating at the boundary
+            if (coordinating) {
+                cluster_coordinator_announce_epoch(&g_cluster, upcomingEpoch);
+            }
+        }
+        if (dagPreparing && !nextDagReady) {
+            nextDagReady = (miner_poll_epoch(g_miner) == 1);
+        }
+
+        // Check for epoch change
         uint32_t newEpoch = adaptivepow_get_epoch(now, SCRYPT_GENESIS_TIME);
         if (newEpoch != currentEpoch) {
-            printf("\nEpoch changed! Regenerating DAG...\n");
-            miner_update_epoch(g_miner, newEpoch);
+            if (nextDagReady && miner_switch_epoch(g_miner, newEpoch) == 0) {
+                printf("\nEpoch changed! Switched to prepared DAG.\n\n");
+            } else {
+                // Boundary arrived before the background build finished
+                printf("\nEpoch changed! Regenerating DAG...\n");
+                miner_update_epoch(g_miner, newEpoch);
+                printf("New DAG ready!\n\n");
+            }
             currentEpoch = newEpoch;
-            printf("New DAG ready!\n\n");
+            dagPreparing = false;
+            nextDagReady = false;
         }
 
-        // Print stats every 30 seconds
+        // Record a telemetry sample every second
         time_t statNow = time(NULL);
+        if (config->statsPort > 0 && statNow - lastSampleTime >= 1) {
+            MinerStats stats;
+            miner_get_stats(g_miner, &stats);
+
+            TelemetrySample sample;
+            sample.timestamp = (uint64_t)statNow;
+            sample.deviceId = config->deviceId;
+            sample.hashrate = (stats.totalHashes - sampleLastHashes) /
+                              (double)(statNow - lastSampleTime);
+            sample.acceptedShares = g_stratum.sharesAccepted;
+            sample.rejectedShares = g_stratum.sharesRejected;
+            sample.staleResults = stats.staleResults;
+            sample.gpuTemp = stats.gpuTemp;
+            sample.lastBatchMs = lastBatchMs;
+            telemetry_record(&sample);
+
+            lastSampleTime = statNow;
+            sampleLastHashes = stats.totalHashes;
+        }
+
+        // Print stats every 30 seconds
         if (statNow - lastStatTime >= 30) {
             MinerStats stats;
             miner_get_stats(g_miner, &stats);
@@ -442,6 +615,15 @@ int mining_loop(Config *config)
                    (unsigned long long)(stats.acceptedShares + stats.rejectedShares),
                    stats.gpuTemp);
 
+            if (coordinating) {
+                MinerStats fleet;
+                int numRigs = cluster_coordinator_stats(&g_cluster, &fleet);
+                printf("[fleet] %d rigs | %.2f MH/s | %llu shares forwarded\n",
+                       numRigs,
+                       (hashrate + fleet.hashrate) / 1000000.0,
+                       (unsigned long long)g_cluster.sharesForwarded);
+            }
+
             lastStatTime = statNow;
             lastHashes = stats.totalHashes;
         }
@@ -450,9 +632,244 @@ int mining_loop(Config *config)
     }
 
     // Cleanup
+    if (coordinating) {
+        cluster_coordinator_stop(&g_cluster);
+    }
+    telemetry_http_stop();
+    stratum_stop_submitter(&g_stratum);
     miner_shutdown(g_miner);
+    scheduler_destroy(g_scheduler);
     stratum_cleanup(&g_stratum);
     g_miner = NULL;
+    g_scheduler = NULL;
+
+    return 0;
+}
+
+
+// Worker-rig loop: no pool connection. Jobs, nonce slices and epoch
+// announcements come from the coordinator; verified shares and stats go
+// back to it over the same link.
+int worker_loop(Config *config)
+{
+    printf("\n");
+    printf("+=============================================+\n");
+    printf("|     SCRYPT COIN GPU MINER - WORKER RIG     |\n");
+    printf("+=============================================+\n\n");
+
+    GPUDevice devices[8];
+    int numDevices = enumerate_gpus(devices, 8);
+
+    if (numDevices <= 0 || config->deviceId >= numDevices) {
+        fprintf(stderr, "Invalid GPU device!\n");
+        return -1;
+    }
+
+    GPUDevice* dev = &devices[config->deviceId];
+    printf("GPU: %s (%.2f GB)\n", dev->name, dev->memory / (1024.0 * 1024.0 * 1024.0));
+
+    uint64_t now = (uint64_t)time(NULL);
+    uint32_t epoch = adaptivepow_get_epoch(now, SCRYPT_GENESIS_TIME);
+    printf("Epoch: %u\n", epoch);
+    printf("Coordinator: %s:%d\n\n", config->workerHost, config->workerPort);
+
+    if (config->rigName[0] == '\0') {
+#ifndef _WIN32
+        if (gethostname(config->rigName, sizeof(config->rigName) - 1) != 0)
+#endif
+            snprintf(config->rigName, sizeof(config->rigName), "rig-gpu%d", config->deviceId);
+    }
+
+    printf("Initializing GPU miner...\n");
+    g_miner = miner_init(config->deviceId, epoch);
+    if (!g_miner) {
+        fprintf(stderr, "Failed to initialize miner!\n");
+        return -1;
+    }
+
+    printf("Generating DAG...\n");
+    if (miner_generate_dag(g_miner) != 0) {
+        fprintf(stderr, "Failed to generate DAG!\n");
+        miner_shutdown(g_miner);
+        return -1;
+    }
+    printf("DAG ready!\n\n");
+
+    if (miner_autotune(g_miner, config->tuneFile) != 0) {
+        fprintf(stderr, "Warning: autotune failed, using default launch config\n");
+    }
+
+    ClusterWorker worker;
+    while (g_running &&
+           cluster_worker_connect(&worker, config->workerHost, config->workerPort,
+                                  config->rigName, 1) != 0) {
+        fprintf(stderr, "Retrying coordinator in 5 seconds...\n");
+        sleep(5);
+    }
+    if (!g_running) {
+        miner_shutdown(g_miner);
+        g_miner = NULL;
+        return 0;
+    }
+
+    printf("Waiting for work...\n");
+    while (g_running && !worker.hasJob) {
+        if (cluster_worker_poll(&worker) < 0) {
+            sleep(5);
+            cluster_worker_connect(&worker, config->workerHost, config->workerPort,
+                                   config->rigName, 1);
+        }
+        msleep(100);
+    }
+
+    printf("Mining started!\n\n");
+
+    if (config->statsPort > 0) {
+        telemetry_http_start(config->statsPort);
+    }
+
+    g_scheduler = scheduler_create();
+    scheduler_set_base(g_scheduler, &worker.currentJob, worker.nonceBase);
+    worker.jobChanged = false;
+
+    ResultScoreboard scoreboard;
+    scoreboard_reset(&scoreboard);
+
+    time_t lastStatTime = time(NULL);
+    uint64_t lastHashes = 0;
+    uint32_t currentEpoch = epoch;
+    bool dagPreparing = false;
+    bool nextDagReady = false;
+    time_t lastSampleTime = time(NULL);
+    uint64_t sampleLastHashes = 0;
+    double lastBatchMs = 0;
+
+    while (g_running) {
+        // Service the coordinator link, reconnecting if it dropped
+        if (cluster_worker_poll(&worker) < 0) {
+            fprintf(stderr, "Cluster: coordinator lost, reconnecting...\n");
+            while (g_running &&
+                   cluster_worker_connect(&worker, config->workerHost, config->workerPort,
+                                          config->rigName, 1) != 0) {
+                sleep(5);
+            }
+            continue;  // wait for a fresh job before mining again
+        }
+        if (!worker.hasJob) {
+            msleep(100);
+            continue;
+        }
+        if (worker.jobChanged) {
+            // Start this rig's slice of the new job's nonce space
+            scheduler_set_base(g_scheduler, &worker.currentJob, worker.nonceBase);
+            worker.jobChanged = false;
+        }
+
+        double batchStart = now_ms();
+        miner_submit_job_scheduled(g_miner, &worker.currentJob, g_scheduler);
+        lastBatchMs = now_ms() - batchStart;
+
+        MiningResult result;
+        while (miner_get_result(g_miner, &result) > 0 && result.found) {
+            printf("\n*** SHARE FOUND! Nonce: %016llx ***\n\n",
+                   (unsigned long long)result.nonce);
+            if (scoreboard_push(&scoreboard, &result) != 0) {
+                break;  // full; flush below, catch up next iteration
+            }
+        }
+        if (scoreboard.count > 0) {
+            // Verify locally so the coordinator only ever relays; a bad
+            // rig burns its own CPU, not the fleet's submit pipeline
+            scoreboard_flush(&scoreboard, &worker.currentJob);
+            for (int i = 0; i < scoreboard.count; i++) {
+                if (!scoreboard.results[i].found) {
+                    fprintf(stderr, "Warning: candidate failed verification, not sent\n");
+                } else if (cluster_worker_submit(&worker, &scoreboard.results[i]) != 0) {
+                    fprintf(stderr, "Warning: share lost, coordinator link down\n");
+                }
+            }
+            scoreboard_reset(&scoreboard);
+        }
+
+        // Background DAG build: triggered by the coordinator's epoch
+        // announcement, or by the local clock if we missed it
+        now = (uint64_t)time(NULL);
+        uint32_t upcomingEpoch = adaptivepow_get_epoch(now + DAG_PREPARE_LEAD,
+                                                       SCRYPT_GENESIS_TIME);
+        if (worker.hasPrepare) {
+            upcomingEpoch = worker.prepareEpoch;
+            worker.hasPrepare = false;
+        }
+        if (upcomingEpoch != currentEpoch && !dagPreparing) {
+            dagPreparing = (miner_prepare_epoch(g_miner, upcomingEpoch) == 0);
+        }
+        if (dagPreparing && !nextDagReady) {
+            nextDagReady = (miner_poll_epoch(g_miner) == 1);
+        }
+
+        uint32_t newEpoch = adaptivepow_get_epoch(now, SCRYPT_GENESIS_TIME);
+        if (newEpoch != currentEpoch) {
+            if (nextDagReady && miner_switch_epoch(g_miner, newEpoch) == 0) {
+                printf("\nEpoch changed! Switched to prepared DAG.\n\n");
+            } else {
+                printf("\nEpoch changed! Regenerating DAG...\n");
+                miner_update_epoch(g_miner, newEpoch);
+                printf("New DAG ready!\n\n");
+            }
+            currentEpoch = newEpoch;
+            dagPreparing = false;
+            nextDagReady = false;
+        }
+
+        // Report to the coordinator (and telemetry) every second
+        time_t statNow = time(NULL);
+        if (statNow - lastSampleTime >= 1) {
+            MinerStats stats;
+            miner_get_stats(g_miner, &stats);
+            stats.hashrate = (stats.totalHashes - sampleLastHashes) /
+                             (double)(statNow - lastSampleTime);
+            cluster_worker_send_stats(&worker, &stats);
+
+            if (config->statsPort > 0) {
+                TelemetrySample sample;
+                sample.timestamp = (uint64_t)statNow;
+                sample.deviceId = config->deviceId;
+                sample.hashrate = stats.hashrate;
+                sample.acceptedShares = stats.acceptedShares;
+                sample.rejectedShares = stats.rejectedShares;
+                sample.staleResults = stats.staleResults;
+                sample.gpuTemp = stats.gpuTemp;
+                sample.lastBatchMs = lastBatchMs;
+                telemetry_record(&sample);
+            }
+
+            lastSampleTime = statNow;
+            sampleLastHashes = stats.totalHashes;
+        }
+
+        if (statNow - lastStatTime >= 30) {
+            MinerStats stats;
+            miner_get_stats(g_miner, &stats);
+
+            double hashrate = (stats.totalHashes - lastHashes) / (double)(statNow - lastStatTime);
+            printf("[%s] %.2f MH/s | job %s | GPU: %.0fC\n",
+                   dev->name, hashrate / 1000000.0,
+                   worker.currentJob.jobId, stats.gpuTemp);
+
+            lastStatTime = statNow;
+            lastHashes = stats.totalHashes;
+        }
+
+        msleep(10);
+    }
+
+    // Cleanup
+    telemetry_http_stop();
+    cluster_worker_disconnect(&worker);
+    miner_shutdown(g_miner);
+    scheduler_destroy(g_scheduler);
+    g_miner = NULL;
+    g_scheduler = NULL;
 
     return 0;
 }
@@ -489,6 +906,9 @@ int main(int argc, char **argv)
     else if (config.benchmark) {
         result = run_benchmark(&config);
     }
+    else if (strlen(config.workerHost) > 0) {
+        result = worker_loop(&config);
+    }
     else if (strlen(config.url) == 0) {
         fprintf(stderr, "Error: URL required (-o)\n");
         fprintf(stderr, "Use --help for usage information\n");
@@ -7,9 +7,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <fstream>
 #include <sstream>
 
+#include "../core/autotune.h"
+
 // AdaptivePow constants
 #define DAG_BASE_SIZE      (1ULL << 30)  // 1 GB
 #define EPOCH_LENGTH       (180 * 24 * 60 * 60)
@@ -40,6 +43,10 @@ struct OpenCLContext {
     uint32_t epoch;
     uint64_t dagSize;
     bool dagReady;
+
+    // Launch configuration (autotunable)
+    size_t localSize;
+    size_t batchSize;
 };
 
 // Load kernel source from file or embedded string
@@ -83,6 +90,86 @@ static uint64_t getDagSize(uint32_t epoch)
     return DAG_BASE_SIZE << doublings;
 }
 
+// FNV-1a 64-bit, used to key the kernel binary cache
+static uint64_t fnv1a64(uint64_t hash, const void *data, size_t len)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Cache file for the compiled program, keyed by device name, driver
+// version and kernel source so a driver update or kernel edit misses
+// cleanly and falls back to a source build.
+static std::string kernelCachePath(cl_device_id device, const std::string &source)
+{
+    char deviceName[256] = {0};
+    char driverVersion[128] = {0};
+    clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(deviceName) - 1, deviceName, NULL);
+    clGetDeviceInfo(device, CL_DRIVER_VERSION, sizeof(driverVersion) - 1, driverVersion, NULL);
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = fnv1a64(hash, deviceName, strlen(deviceName));
+    hash = fnv1a64(hash, driverVersion, strlen(driverVersion));
+    hash = fnv1a64(hash, source.data(), source.length());
+
+    char path[64];
+    snprintf(path, sizeof(path), "scrypt-miner-kernel-%016llx.bin",
+             (unsigned long long)hash);
+    return std::string(path);
+}
+
+// Try to create the program from a cached binary. Returns NULL on any
+// miss or mismatch; the caller then builds from source.
+static cl_program loadCachedProgram(cl_context context, cl_device_id device,
+                                    const std::string &path)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file.is_open()) return NULL;
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string binary = buffer.str();
+    if (binary.empty()) return NULL;
+
+    const unsigned char *binPtr = (const unsigned char *)binary.data();
+    size_t binLen = binary.length();
+    cl_int binStatus = CL_SUCCESS;
+    cl_int err;
+
+    cl_program program = clCreateProgramWithBinary(context, 1, &device,
+                                                   &binLen, &binPtr,
+                                                   &binStatus, &err);
+    if (err != CL_SUCCESS || binStatus != CL_SUCCESS) {
+        if (program) clReleaseProgram(program);
+        return NULL;
+    }
+    return program;
+}
+
+// Store the built program's binary for the next start
+static void saveCachedProgram(cl_program program, const std::string &path)
+{
+    size_t binLen = 0;
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(binLen),
+                         &binLen, NULL) != CL_SUCCESS || binLen == 0) {
+        return;
+    }
+
+    unsigned char *binary = new unsigned char[binLen];
+    unsigned char *binaries[1] = { binary };
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binaries),
+                         binaries, NULL) == CL_SUCCESS) {
+        std::ofstream file(path.c_str(), std::ios::binary);
+        if (file.is_open()) {
+            file.write((const char *)binary, binLen);
+        }
+    }
+    delete[] binary;
+}
+
 extern "C" {
 
 int adaptivepow_opencl_init(int deviceId, uint32_t epoch, void** ctx)
@@ -91,6 +178,8 @@ int adaptivepow_opencl_init(int deviceId, uint32_t epoch, void** ctx)
     memset(oclCtx, 0, sizeof(OpenCLContext));
     oclCtx->epoch = epoch;
     oclCtx->dagSize = getDagSize(epoch);
+    oclCtx->localSize = 256;
+    oclCtx->batchSize = BATCH_SIZE;
 
     cl_int err;
 
@@ -151,31 +240,54 @@ int adaptivepow_opencl_init(int deviceId, uint32_t epoch, void** ctx)
         return -5;
     }
 
-    const char* srcPtr = source.c_str();
-    size_t srcLen = source.length();
-    oclCtx->program = clCreateProgramWithSource(oclCtx->context, 1, &srcPtr, &srcLen, &err);
-    if (err != CL_SUCCESS) {
-        clReleaseCommandQueue(oclCtx->queue);
-        clReleaseContext(oclCtx->context);
-        delete oclCtx;
-        return -6;
+    const char* buildOptions = "-cl-mad-enable -cl-fast-relaxed-math";
+    std::string cachePath = kernelCachePath(oclCtx->device, source);
+
+    // Try the binary cache first; compiling from source costs tens of
+    // seconds per start on AMD drivers
+    bool fromCache = false;
+    oclCtx->program = loadCachedProgram(oclCtx->context, oclCtx->device, cachePath);
+    if (oclCtx->program) {
+        err = clBuildProgram(oclCtx->program, 1, &oclCtx->device, buildOptions, NULL, NULL);
+        if (err == CL_SUCCESS) {
+            fromCache = true;
+            printf("OpenCL: loaded cached kernel binary (%s)\n", cachePath.c_str());
+        } else {
+            // Stale or incompatible binary - rebuild from source
+            clReleaseProgram(oclCtx->program);
+            oclCtx->program = NULL;
+        }
     }
 
-    err = clBuildProgram(oclCtx->program, 1, &oclCtx->device, "-cl-mad-enable -cl-fast-relaxed-math", NULL, NULL);
-    if (err != CL_SUCCESS) {
-        // Get build log
-        size_t logSize;
-        clGetProgramBuildInfo(oclCtx->program, oclCtx->device, CL_PROGRAM_BUILD_LOG, 0, NULL, &logSize);
-        char* log = new char[logSize];
-        clGetProgramBuildInfo(oclCtx->program, oclCtx->device, CL_PROGRAM_BUILD_LOG, logSize, log, NULL);
-        fprintf(stderr, "OpenCL build error:\n%s\n", log);
-        delete[] log;
+    if (!fromCache) {
+        const char* srcPtr = source.c_str();
+        size_t srcLen = source.length();
+        oclCtx->program = clCreateProgramWithSource(oclCtx->context, 1, &srcPtr, &srcLen, &err);
+        if (err != CL_SUCCESS) {
+            clReleaseCommandQueue(oclCtx->queue);
+            clReleaseContext(oclCtx->context);
+            delete oclCtx;
+            return -6;
+        }
 
-        clReleaseProgram(oclCtx->program);
-        clReleaseCommandQueue(oclCtx->queue);
-        clReleaseContext(oclCtx->context);
-        delete oclCtx;
-        return -7;
+        err = clBuildProgram(oclCtx->program, 1, &oclCtx->device, buildOptions, NULL, NULL);
+        if (err != CL_SUCCESS) {
+            // Get build log
+            size_t logSize;
+            clGetProgramBuildInfo(oclCtx->program, oclCtx->device, CL_PROGRAM_BUILD_LOG, 0, NULL, &logSize);
+            char* log = new char[logSize];
+            clGetProgramBuildInfo(oclCtx->program, oclCtx->device, CL_PROGRAM_BUILD_LOG, logSize, log, NULL);
+            fprintf(stderr, "OpenCL build error:\n%s\n", log);
+            delete[] log;
+
+            clReleaseProgram(oclCtx->program);
+            clReleaseCommandQueue(oclCtx->queue);
+            clReleaseContext(oclCtx->context);
+            delete oclCtx;
+            return -7;
+        }
+
+        saveCachedProgram(oclCtx->program, cachePath);
     }
 
     // Create kernels
@@ -316,13 +428,13 @@ int adaptivepow_opencl_search(void* ctx, const uint32_t* header, uint64_t target
     clSetKernelArg(oclCtx->searchKernel, 6, sizeof(cl_mem), &oclCtx->resultCountBuffer);
 
     // Launch kernel
-    size_t globalSize = BATCH_SIZE;
-    size_t localSize = 256;
+    size_t globalSize = oclCtx->batchSize;
+    size_t localSize = oclCtx->localSize;
 
     err = clEnqueueNDRangeKernel(oclCtx->queue, oclCtx->searchKernel, 1, NULL, &globalSize, &localSize, 0, NULL, NULL);
     clFinish(oclCtx->queue);
 
-    *hashCount = BATCH_SIZE;
+    *hashCount = oclCtx->batchSize;
 
     // Check for results
     uint32_t resultCount;
@@ -338,6 +450,106 @@ int adaptivepow_opencl_search(void* ctx, const uint32_t* header, uint64_t target
     return 0;  // Not found
 }
 
+// Time the current launch configuration: one warm-up batch, then timed
+// batches. Returns hashes per second, or 0 on failure.
+static double opencl_benchmark(OpenCLContext* oclCtx)
+{
+    const int timedBatches = 2;
+    uint32_t header[20];
+    uint64_t foundNonce;
+    uint32_t hashCount;
+    struct timespec t0, t1;
+
+    memset(header, 0, sizeof(header));
+
+    if (adaptivepow_opencl_search(oclCtx, header, 0, 0, &foundNonce, &hashCount) < 0) return 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    uint64_t totalHashes = 0;
+    for (int i = 0; i < timedBatches; i++) {
+        if (adaptivepow_opencl_search(oclCtx, header, 0, 0, &foundNonce, &hashCount) < 0) return 0;
+        totalHashes += hashCount;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    double seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    if (seconds <= 0) return 0;
+    return totalHashes / seconds;
+}
+
+// Pick the best (local work size, batch size) for this device and epoch.
+// A stored profile skips the sweep; otherwise every candidate is timed and
+// the winner persisted. Call after the DAG is generated.
+int adaptivepow_opencl_autotune(void* ctx, const char* profilePath)
+{
+    static const size_t localSizes[] = { 64, 128, 256 };
+    static const size_t batchMults[] = { 1, 2 };
+
+    OpenCLContext* oclCtx = (OpenCLContext*)ctx;
+    if (!oclCtx || !oclCtx->dagReady) return -1;
+
+    char deviceName[256];
+    memset(deviceName, 0, sizeof(deviceName));
+    clGetDeviceInfo(oclCtx->device, CL_DEVICE_NAME, sizeof(deviceName) - 1, deviceName, NULL);
+
+    TuneProfile profile;
+    if (profilePath &&
+        tune_profile_load(profilePath, deviceName, oclCtx->epoch, &profile) == 1) {
+        printf("Autotune: using stored profile for %s epoch %u: "
+               "local=%u batch=%u (%.2f MH/s)\n",
+               deviceName, oclCtx->epoch, profile.blockSize,
+               profile.batchSize, profile.hashrate / 1e6);
+        oclCtx->localSize = profile.blockSize;
+        oclCtx->batchSize = profile.batchSize;
+        return 0;
+    }
+
+    printf("Autotune: sweeping configurations for %s, epoch %u...\n",
+           deviceName, oclCtx->epoch);
+
+    size_t bestLocal = oclCtx->localSize;
+    size_t bestBatch = oclCtx->batchSize;
+    double bestRate = 0;
+
+    for (unsigned l = 0; l < sizeof(localSizes) / sizeof(localSizes[0]); l++) {
+        for (unsigned m = 0; m < sizeof(batchMults) / sizeof(batchMults[0]); m++) {
+            oclCtx->localSize = localSizes[l];
+            oclCtx->batchSize = BATCH_SIZE * batchMults[m];
+
+            double rate = opencl_benchmark(oclCtx);
+            printf("  local=%u batch=%u: %.2f MH/s\n",
+                   (unsigned)oclCtx->localSize, (unsigned)oclCtx->batchSize, rate / 1e6);
+
+            if (rate > bestRate) {
+                bestRate = rate;
+                bestLocal = oclCtx->localSize;
+                bestBatch = oclCtx->batchSize;
+            }
+        }
+    }
+
+    oclCtx->localSize = bestLocal;
+    oclCtx->batchSize = bestBatch;
+
+    if (bestRate == 0) return -2;
+
+    printf("Autotune: best is local=%u batch=%u (%.2f MH/s)\n",
+           (unsigned)bestLocal, (unsigned)bestBatch, bestRate / 1e6);
+
+    if (profilePath) {
+        memset(&profile, 0, sizeof(profile));
+        strncpy(profile.deviceName, deviceName, sizeof(profile.deviceName) - 1);
+        profile.nParam = oclCtx->epoch;
+        profile.blockSize = bestLocal;
+        profile.batchSize = bestBatch;
+        profile.lookupGap = 1;
+        profile.hashrate = bestRate;
+        tune_profile_save(profilePath, &profile);
+    }
+
+    return 0;
+}
+
 void adaptivepow_opencl_cleanup(void* ctx)
 {
     OpenCLContext* oclCtx = (OpenCLContext*)ctx;
@@ -92,7 +92,7 @@ bool CHashCalculation::operator()()
         if (mi != mapHash.end())
         {
             pBlock->blockHash = (*mi).second;
-            LogPrintf(
+            LogPrint(BCLog::NET,
                 "[HashCalcThread:%ld] Already have header %s (sha256: %s)\n",
                 threadId, pBlock->blockHash.ToString(),
                 blockSHA256Hash.ToString());
@@ -102,7 +102,7 @@ bool CHashCalculation::operator()()
     if (pBlock->blockHash == 0)
     {
         uint256 blockHash = pBlock->GetHash();
-        LogPrintf(
+        LogPrint(BCLog::NET,
             "[HashCalcThread:%ld] Received header %s (sha256: %s) from node "
             "%s\n",
             threadId, blockHash.ToString(),
@@ -1341,8 +1341,12 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, std::vector<C
     }
 
     {
-        // Calculate header hash
-        LogPrintf("Start calculating hash for %d block headers\n", nCount);
+        // Calculate header hash. Per-header progress below is logged under the
+        // net category only: a full 2000-header message would otherwise push
+        // thousands of lines through the debug.log lock, serializing the hash
+        // calculation threads and stalling the message loop they exist to
+        // unblock.
+        LogPrint(BCLog::NET, "Start calculating hash for %d block headers\n", nCount);
         if (nHashCalcThreads > 1)
         {
             CCheckQueueControl<CHashCalculation> control(&hashCalculationQueue);
@@ -1375,7 +1379,7 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, std::vector<C
                 if (mi != mapHash.end())
                 {
                     header.blockHash = (*mi).second;
-                    LogPrintf("Already have header %s (sha256: %s)\n",
+                    LogPrint(BCLog::NET, "Already have header %s (sha256: %s)\n",
                               header.blockHash.ToString(),
                               blockSHA256Hash.ToString());
                 }
@@ -1383,7 +1387,7 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, std::vector<C
                 if (header.blockHash == 0)
                 {
                     uint256 blockHash = header.GetHash();
-                    LogPrintf("Received header %s (sha256: %s) from node %s\n",
+                    LogPrint(BCLog::NET, "Received header %s (sha256: %s) from node %s\n",
                               blockHash.ToString(),
                               blockSHA256Hash.ToString(),
                               pfrom->GetAddrName());
@@ -1396,7 +1400,7 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, std::vector<C
                 }
             }
         }
-        LogPrintf("Finish calculating hash for %d block headers\n", nCount);
+        LogPrint(BCLog::NET, "Finish calculating hash for %d block headers\n", nCount);
     }
     {
         LOCK(cs_main);